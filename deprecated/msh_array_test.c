@@ -1,8 +1,13 @@
 // TODO(maciej): Test hashtable.h
 #define MSH_IMPLEMENTATION
 #define HASHTABLE_IMPLEMENTATION
+#define MSH_ALLOC_IMPLEMENTATION
+#define MSH_BENCH_IMPLEMENTATION
 #include "msh.h"
 #include "hashtable/hashtable.h"
+#include "../msh_alloc.h"
+#include "../msh_bench.h"
+#include <pthread.h>
 // #include <vector>
 // #include <unordered_map>
 
@@ -220,6 +225,377 @@ inline int hashMem(void *hash)
 }
 //--------------------------------------------------
 
+///-------------------------------------------------
+// Swiss table
+//   Open addressing map in the style of Abseil's flat_hash_map. Every slot has a control byte -
+//   empty, deleted, or 7 bits of the key hash if full. Slots are split into groups of 16, and
+//   a lookup compares all 16 control bytes of a group at once with SSE2, touching key/value
+//   pairs only for slots whose hash bits match. Groups are probed with triangular steps.
+//
+//   Erasing marks a slot as empty if its group still has an empty slot (no lookup could have
+//   probed past such group), otherwise as deleted. When the table runs out of empty slots, it
+//   is rehashed at the same capacity if it is mostly tombstones, and doubled otherwise, so
+//   that insert/erase churn does not trigger a rehash storm.
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define MSH_SWISSMAP_SSE2 1
+#include <emmintrin.h>
+#endif
+
+enum
+{
+  MSH_SWISSMAP_GROUP_SIZE = 16,
+  MSH_SWISSMAP_EMPTY      = -128, // 0x80
+  MSH_SWISSMAP_DELETED    = -2    // 0xFE
+};
+
+typedef struct msh_swissmap_slot
+{
+  uint64_t key;
+  uint64_t val;
+} msh_swissmap_slot_t;
+
+typedef struct msh_swissmap
+{
+  int8_t* ctrl;
+  msh_swissmap_slot_t* slots;
+  size_t cap;          // number of slots, power of two and multiple of group size
+  size_t len;
+  size_t n_deleted;
+  size_t growth_left;  // empty slots that can be filled before we need to rehash
+  size_t n_rehashes;
+  msh_allocator_t allocator;  // zero means heap
+} msh_swissmap_t;
+
+static inline uint64_t
+msh__swissmap_hash( uint64_t x )
+{
+  x ^= x >> 30; x *= 0xbf58476d1ce4e5b9ULL;
+  x ^= x >> 27; x *= 0x94d049bb133111ebULL;
+  x ^= x >> 31;
+  return x;
+}
+
+// Bit i of result is set if control byte i of the group equals h.
+static inline uint32_t
+msh__swissmap_match( const int8_t* group, int8_t h )
+{
+#if MSH_SWISSMAP_SSE2
+  __m128i ctrl = _mm_load_si128( (const __m128i*)group );
+  return (uint32_t)_mm_movemask_epi8( _mm_cmpeq_epi8( ctrl, _mm_set1_epi8( h ) ) );
+#else
+  uint32_t mask = 0;
+  for( int i = 0; i < MSH_SWISSMAP_GROUP_SIZE; ++i ) { mask |= (uint32_t)(group[i] == h) << i; }
+  return mask;
+#endif
+}
+
+// Bit i of result is set if slot i of the group is empty or deleted.
+static inline uint32_t
+msh__swissmap_match_free( const int8_t* group )
+{
+#if MSH_SWISSMAP_SSE2
+  return (uint32_t)_mm_movemask_epi8( _mm_load_si128( (const __m128i*)group ) );
+#else
+  uint32_t mask = 0;
+  for( int i = 0; i < MSH_SWISSMAP_GROUP_SIZE; ++i ) { mask |= (uint32_t)(group[i] < 0) << i; }
+  return mask;
+#endif
+}
+
+static inline int
+msh__swissmap_ctz( uint32_t x )
+{
+#if defined(_MSC_VER)
+  unsigned long idx;
+  _BitScanForward( &idx, x );
+  return (int)idx;
+#else
+  return __builtin_ctz( x );
+#endif
+}
+
+static void
+msh__swissmap_alloc( msh_swissmap_t* map, size_t cap )
+{
+  map->cap = cap;
+  map->len = 0;
+  map->n_deleted = 0;
+  map->growth_left = cap - cap / 8;
+  // Control bytes are loaded with aligned loads, so they share allocation with slots.
+  map->slots = msh_allocator_alloc( &map->allocator, cap * (sizeof(msh_swissmap_slot_t) + 1) );
+  map->ctrl = (int8_t*)(map->slots + cap);
+  memset( map->ctrl, MSH_SWISSMAP_EMPTY, cap );
+}
+
+void
+msh_swissmap_init( msh_swissmap_t* map, size_t cap, msh_allocator_t allocator )
+{
+  size_t c = MSH_SWISSMAP_GROUP_SIZE;
+  while( c - c / 8 < cap ) { c *= 2; }
+  memset( map, 0, sizeof(*map) );
+  map->allocator = allocator;
+  msh__swissmap_alloc( map, c );
+}
+
+void
+msh_swissmap_free( msh_swissmap_t* map )
+{
+  msh_allocator_free( &map->allocator, map->slots, map->cap * (sizeof(msh_swissmap_slot_t) + 1) );
+  memset( map, 0, sizeof(*map) );
+}
+
+size_t
+msh_swissmap_len( const msh_swissmap_t* map )
+{
+  return map->len;
+}
+
+uint64_t*
+msh_swissmap_get( const msh_swissmap_t* map, uint64_t key )
+{
+  if( !map->cap ) { return NULL; }
+  uint64_t h = msh__swissmap_hash( key );
+  int8_t h2 = (int8_t)(h & 0x7F);
+  size_t group_mask = map->cap / MSH_SWISSMAP_GROUP_SIZE - 1;
+  size_t g = (size_t)(h >> 7) & group_mask;
+  for( size_t step = 1; ; ++step )
+  {
+    const int8_t* group = map->ctrl + g * MSH_SWISSMAP_GROUP_SIZE;
+    uint32_t match = msh__swissmap_match( group, h2 );
+    while( match )
+    {
+      size_t i = g * MSH_SWISSMAP_GROUP_SIZE + msh__swissmap_ctz( match );
+      if( map->slots[i].key == key ) { return &map->slots[i].val; }
+      match &= match - 1;
+    }
+    if( msh__swissmap_match( group, MSH_SWISSMAP_EMPTY ) ) { return NULL; }
+    g = (g + step) & group_mask;
+  }
+}
+
+// Finds first empty or deleted slot on the probe sequence of hash h.
+static size_t
+msh__swissmap_find_free( const msh_swissmap_t* map, uint64_t h )
+{
+  size_t group_mask = map->cap / MSH_SWISSMAP_GROUP_SIZE - 1;
+  size_t g = (size_t)(h >> 7) & group_mask;
+  for( size_t step = 1; ; ++step )
+  {
+    uint32_t free_mask = msh__swissmap_match_free( map->ctrl + g * MSH_SWISSMAP_GROUP_SIZE );
+    if( free_mask ) { return g * MSH_SWISSMAP_GROUP_SIZE + msh__swissmap_ctz( free_mask ); }
+    g = (g + step) & group_mask;
+  }
+}
+
+static void
+msh__swissmap_rehash( msh_swissmap_t* map, size_t new_cap )
+{
+  msh_swissmap_t old = *map;
+  msh__swissmap_alloc( map, new_cap );
+  map->n_rehashes = old.n_rehashes + 1;
+  for( size_t i = 0; i < old.cap; ++i )
+  {
+    if( old.ctrl[i] < 0 ) { continue; }
+    uint64_t h = msh__swissmap_hash( old.slots[i].key );
+    size_t j = msh__swissmap_find_free( map, h );
+    map->ctrl[j] = (int8_t)(h & 0x7F);
+    map->slots[j] = old.slots[i];
+  }
+  map->len = old.len;
+  map->growth_left -= old.len;
+  msh_allocator_free( &map->allocator, old.slots, old.cap * (sizeof(msh_swissmap_slot_t) + 1) );
+}
+
+void
+msh_swissmap_insert( msh_swissmap_t* map, uint64_t key, uint64_t val )
+{
+  if( !map->cap ) { msh_swissmap_init( map, MSH_SWISSMAP_GROUP_SIZE, map->allocator ); }
+  uint64_t* existing = msh_swissmap_get( map, key );
+  if( existing ) { *existing = val; return; }
+
+  uint64_t h = msh__swissmap_hash( key );
+  size_t i = msh__swissmap_find_free( map, h );
+  if( map->growth_left == 0 && map->ctrl[i] == MSH_SWISSMAP_EMPTY )
+  {
+    // Mostly tombstones - clean them up in place, otherwise grow.
+    size_t new_cap = (map->len * 32 <= map->cap * 25) ? map->cap : 2 * map->cap;
+    msh__swissmap_rehash( map, new_cap );
+    i = msh__swissmap_find_free( map, h );
+  }
+  if( map->ctrl[i] == MSH_SWISSMAP_EMPTY ) { map->growth_left--; }
+  else                                     { map->n_deleted--; }
+  map->ctrl[i] = (int8_t)(h & 0x7F);
+  map->slots[i].key = key;
+  map->slots[i].val = val;
+  map->len++;
+}
+
+// Returns 1 if key was present.
+int
+msh_swissmap_remove( msh_swissmap_t* map, uint64_t key )
+{
+  uint64_t* val = msh_swissmap_get( map, key );
+  if( !val ) { return 0; }
+  size_t i = (size_t)((msh_swissmap_slot_t*)((char*)val - offsetof(msh_swissmap_slot_t, val)) - map->slots);
+  const int8_t* group = map->ctrl + (i & ~(size_t)(MSH_SWISSMAP_GROUP_SIZE - 1));
+  if( msh__swissmap_match( group, MSH_SWISSMAP_EMPTY ) )
+  {
+    map->ctrl[i] = MSH_SWISSMAP_EMPTY;
+    map->growth_left++;
+  }
+  else
+  {
+    map->ctrl[i] = MSH_SWISSMAP_DELETED;
+    map->n_deleted++;
+  }
+  map->len--;
+  return 1;
+}
+//--------------------------------------------------
+
+///-------------------------------------------------
+// Concurrent map
+//   Lock-free insert-or-get on 64-bit keys, for filling a shared map from many threads. Slots
+//   are claimed by compare-and-swap on the key, and linear probing means a key, once claimed,
+//   never moves. Table does not grow - it is presized from an estimate of the number of keys,
+//   and insert returns 0 once it is full. Key MSH_CMAP_EMPTY and value MSH_CMAP_PENDING are
+//   reserved.
+#if defined(_MSC_VER)
+#include <intrin.h>
+#define msh__cmap_cas( ptr, expected, desired ) \
+  ((uint64_t)_InterlockedCompareExchange64( (volatile __int64*)(ptr), (__int64)(desired), (__int64)(expected) ) == (expected))
+#define msh__cmap_load( ptr )         (*(volatile uint64_t*)(ptr))
+#define msh__cmap_store( ptr, val )   (*(volatile uint64_t*)(ptr) = (val))
+#define msh__cmap_add( ptr, val )     _InterlockedExchangeAdd64( (volatile __int64*)(ptr), (val) )
+#else
+static inline int
+msh__cmap_cas( uint64_t* ptr, uint64_t expected, uint64_t desired )
+{
+  return __atomic_compare_exchange_n( ptr, &expected, desired, 0, __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE );
+}
+#define msh__cmap_load( ptr )         __atomic_load_n( (ptr), __ATOMIC_ACQUIRE )
+#define msh__cmap_store( ptr, val )   __atomic_store_n( (ptr), (val), __ATOMIC_RELEASE )
+#define msh__cmap_add( ptr, val )     __atomic_fetch_add( (ptr), (val), __ATOMIC_RELAXED )
+#endif
+
+#define MSH_CMAP_EMPTY   UINT64_MAX
+#define MSH_CMAP_PENDING UINT64_MAX
+
+typedef struct msh_cmap_slot
+{
+  uint64_t key;
+  uint64_t val;
+} msh_cmap_slot_t;
+
+typedef struct msh_cmap
+{
+  msh_cmap_slot_t* slots;
+  uint64_t cap;
+  uint64_t max_len;  // insert fails past this load, to keep probe sequences short
+  uint64_t len;
+} msh_cmap_t;
+
+// Not thread-safe, call before spawning the workers.
+void
+msh_cmap_init( msh_cmap_t* map, uint64_t expected_len )
+{
+  uint64_t cap = 16;
+  while( cap * 3 / 4 < expected_len ) { cap *= 2; }
+  map->cap = cap;
+  map->max_len = cap - cap / 8;
+  map->len = 0;
+  map->slots = malloc( cap * sizeof(msh_cmap_slot_t) );
+  memset( map->slots, 0xFF, cap * sizeof(msh_cmap_slot_t) );
+}
+
+void
+msh_cmap_free( msh_cmap_t* map )
+{
+  free( map->slots );
+  memset( map, 0, sizeof(*map) );
+}
+
+uint64_t
+msh_cmap_len( msh_cmap_t* map )
+{
+  return msh__cmap_load( &map->len );
+}
+
+static inline uint64_t
+msh__cmap_hash( uint64_t x )
+{
+  x ^= x >> 30; x *= 0xbf58476d1ce4e5b9ULL;
+  x ^= x >> 27; x *= 0x94d049bb133111ebULL;
+  x ^= x >> 31;
+  return x;
+}
+
+// Value of a claimed slot may not be published yet.
+static inline uint64_t
+msh__cmap_wait_val( msh_cmap_slot_t* slot )
+{
+  uint64_t val;
+  while( (val = msh__cmap_load( &slot->val )) == MSH_CMAP_PENDING ) {}
+  return val;
+}
+
+// Inserts key with val unless key is already present. Returns 1 and writes the value stored in
+// the map to 'out_val' (val if this call inserted it, or the existing value), or 0 if map is full.
+int
+msh_cmap_insert_or_get( msh_cmap_t* map, uint64_t key, uint64_t val, uint64_t* out_val, int* inserted )
+{
+  uint64_t mask = map->cap - 1;
+  uint64_t i = msh__cmap_hash( key ) & mask;
+  for( uint64_t n_probes = 0; n_probes < map->cap; ++n_probes, i = (i + 1) & mask )
+  {
+    msh_cmap_slot_t* slot = &map->slots[i];
+    uint64_t slot_key = msh__cmap_load( &slot->key );
+    if( slot_key == MSH_CMAP_EMPTY )
+    {
+      if( msh__cmap_load( &map->len ) >= map->max_len ) { return 0; }
+      if( msh__cmap_cas( &slot->key, MSH_CMAP_EMPTY, key ) )
+      {
+        msh__cmap_add( &map->len, 1 );
+        msh__cmap_store( &slot->val, val );
+        if( out_val )  { *out_val = val; }
+        if( inserted ) { *inserted = 1; }
+        return 1;
+      }
+      // Lost the race for this slot - see who won it.
+      slot_key = msh__cmap_load( &slot->key );
+    }
+    if( slot_key == key )
+    {
+      uint64_t existing = msh__cmap_wait_val( slot );
+      if( out_val )  { *out_val = existing; }
+      if( inserted ) { *inserted = 0; }
+      return 1;
+    }
+  }
+  return 0;
+}
+
+// Returns 1 and writes value to 'out_val' if key is present. Safe to call during inserts.
+int
+msh_cmap_get( msh_cmap_t* map, uint64_t key, uint64_t* out_val )
+{
+  uint64_t mask = map->cap - 1;
+  uint64_t i = msh__cmap_hash( key ) & mask;
+  for( uint64_t n_probes = 0; n_probes < map->cap; ++n_probes, i = (i + 1) & mask )
+  {
+    msh_cmap_slot_t* slot = &map->slots[i];
+    uint64_t slot_key = msh__cmap_load( &slot->key );
+    if( slot_key == key )
+    {
+      if( out_val ) { *out_val = msh__cmap_wait_val( slot ); }
+      return 1;
+    }
+    if( slot_key == MSH_CMAP_EMPTY ) { return 0; }
+  }
+  return 0;
+}
+//--------------------------------------------------
+
 
 
 void msh_array_test(void) {
@@ -247,9 +623,277 @@ void msh_array_test(void) {
 }
 
 
+void*
+copying_realloc( void* ctx, void* ptr, size_t old_size, size_t new_size )
+{
+  (void)ctx;
+  void* new_ptr = new_size ? malloc( new_size ) : NULL;
+  if( ptr && new_ptr ) { memcpy( new_ptr, ptr, old_size < new_size ? old_size : new_size ); }
+  free( ptr );
+  return new_ptr;
+}
+
+typedef struct cmap_bench_job
+{
+  msh_cmap_t* map;
+  const uint64_t* keys;
+  const uint64_t* vals;
+  uint64_t* out;
+  uint64_t tag;
+  int start, end;
+  int n_failed;
+} cmap_bench_job_t;
+
+void*
+cmap_bench_insert( void* arg )
+{
+  cmap_bench_job_t* job = (cmap_bench_job_t*)arg;
+  for( int i = job->start; i < job->end; ++i )
+  {
+    job->n_failed += !msh_cmap_insert_or_get( job->map, job->keys[i], job->vals[i], NULL, NULL );
+  }
+  return NULL;
+}
+
+void*
+cmap_bench_find( void* arg )
+{
+  cmap_bench_job_t* job = (cmap_bench_job_t*)arg;
+  for( int i = job->start; i < job->end; ++i )
+  {
+    uint64_t val;
+    job->n_failed += !msh_cmap_get( job->map, job->keys[i], &val ) || val != job->vals[i];
+  }
+  return NULL;
+}
+
+// Every thread inserts all the keys, tagged with its own value, so threads race on every slot.
+// All threads must see the same value for a key - the one stored by the winner.
+void*
+cmap_bench_contend( void* arg )
+{
+  cmap_bench_job_t* job = (cmap_bench_job_t*)arg;
+  for( int i = job->start; i < job->end; ++i )
+  {
+    job->n_failed += !msh_cmap_insert_or_get( job->map, job->keys[i], job->tag, &job->out[i], NULL );
+  }
+  return NULL;
+}
+
+double
+cmap_bench_run( void* (*fn)(void*), cmap_bench_job_t* jobs, int n_threads )
+{
+  pthread_t threads[64];
+  uint64_t t1 = msh_time_now();
+  for( int t = 0; t < n_threads; ++t ) { pthread_create( &threads[t], NULL, fn, &jobs[t] ); }
+  for( int t = 0; t < n_threads; ++t ) { pthread_join( threads[t], NULL ); }
+  uint64_t t2 = msh_time_now();
+  return msh_time_diff( MSHT_MICROSECONDS, t2, t1 );
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+// Benchmarks, run with --bench. Same pushes and map operations as below, repeated until timings
+// are stable instead of timed once, cold.
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+typedef struct array_bench_data
+{
+  int n;
+  const uint64_t* keys;
+  const uint64_t* vals;
+  msh_arena_t arena;
+  msh_map_t map;
+  hashtable_t ht_map;
+  void* stb_map;
+  msh_swissmap_t swiss_map;
+} array_bench_data_t;
+
+void bench_push_array( void* data, size_t n_iters )
+{
+  array_bench_data_t* d = data;
+  for( size_t it = 0; it < n_iters; ++it )
+  {
+    msh_array(int) buf = NULL;
+    for( int i = 0; i < d->n; i++ ) { msh_array_push( buf, i ); }
+    MSH_BENCH_CLOBBER();
+    msh_array_free( buf );
+  }
+}
+
+void bench_push_aarray_heap( void* data, size_t n_iters )
+{
+  array_bench_data_t* d = data;
+  for( size_t it = 0; it < n_iters; ++it )
+  {
+    msh_aarray(int) buf = NULL;
+    for( int i = 0; i < d->n; i++ ) { msh_aarray_push( buf, i ); }
+    MSH_BENCH_CLOBBER();
+    msh_aarray_free( buf );
+  }
+}
+
+void bench_push_aarray_arena( void* data, size_t n_iters )
+{
+  array_bench_data_t* d = data;
+  for( size_t it = 0; it < n_iters; ++it )
+  {
+    msh_arena_reset( &d->arena );
+    msh_aarray(int) buf = NULL;
+    msh_aarray_init( buf, 16, msh_arena_allocator( &d->arena ) );
+    for( int i = 0; i < d->n; i++ ) { msh_aarray_push( buf, i ); }
+    MSH_BENCH_CLOBBER();
+  }
+}
+
+void bench_insert_map( void* data, size_t n_iters )
+{
+  array_bench_data_t* d = data;
+  for( size_t it = 0; it < n_iters; ++it )
+  {
+    msh_map_t map = {0};
+    for( int i = 0; i < d->n; ++i ) { msh_map_insert( &map, d->keys[i], d->vals[i] ); }
+    MSH_BENCH_CLOBBER();
+    msh_map_free( &map );
+  }
+}
+
+void bench_find_map( void* data, size_t n_iters )
+{
+  array_bench_data_t* d = data;
+  for( size_t it = 0; it < n_iters; ++it )
+  {
+    uint64_t sum = 0;
+    for( int i = 0; i < d->n; ++i ) { sum += *msh_map_get( &d->map, d->keys[i] ); }
+    MSH_BENCH_DO_NOT_OPTIMIZE( sum );
+  }
+}
+
+void bench_insert_hashtable( void* data, size_t n_iters )
+{
+  array_bench_data_t* d = data;
+  for( size_t it = 0; it < n_iters; ++it )
+  {
+    hashtable_t ht_map;
+    hashtable_init( &ht_map, sizeof(uint64_t), 16, NULL );
+    for( int i = 0; i < d->n; ++i ) { hashtable_insert( &ht_map, d->keys[i], &d->vals[i] ); }
+    MSH_BENCH_CLOBBER();
+    hashtable_term( &ht_map );
+  }
+}
+
+void bench_find_hashtable( void* data, size_t n_iters )
+{
+  array_bench_data_t* d = data;
+  for( size_t it = 0; it < n_iters; ++it )
+  {
+    uint64_t sum = 0;
+    for( int i = 0; i < d->n; ++i ) { sum += *(uint64_t*)hashtable_find( &d->ht_map, d->keys[i] ); }
+    MSH_BENCH_DO_NOT_OPTIMIZE( sum );
+  }
+}
+
+void bench_insert_stb_map( void* data, size_t n_iters )
+{
+  array_bench_data_t* d = data;
+  for( size_t it = 0; it < n_iters; ++it )
+  {
+    void* stb_map = hashCreate( 16 );
+    for( int i = 0; i < d->n; ++i ) { *hashInsert( stb_map, (uint32_t)d->keys[i] ) = (uint32_t)d->vals[i]; }
+    MSH_BENCH_CLOBBER();
+    hashFree( stb_map );
+  }
+}
+
+void bench_find_stb_map( void* data, size_t n_iters )
+{
+  array_bench_data_t* d = data;
+  for( size_t it = 0; it < n_iters; ++it )
+  {
+    uint64_t sum = 0;
+    for( int i = 0; i < d->n; ++i ) { sum += *hashFind( d->stb_map, (uint32_t)d->keys[i] ); }
+    MSH_BENCH_DO_NOT_OPTIMIZE( sum );
+  }
+}
+
+void bench_insert_swissmap( void* data, size_t n_iters )
+{
+  array_bench_data_t* d = data;
+  for( size_t it = 0; it < n_iters; ++it )
+  {
+    msh_swissmap_t swiss_map = {0};
+    for( int i = 0; i < d->n; ++i ) { msh_swissmap_insert( &swiss_map, d->keys[i], d->vals[i] ); }
+    MSH_BENCH_CLOBBER();
+    msh_swissmap_free( &swiss_map );
+  }
+}
+
+void bench_find_swissmap( void* data, size_t n_iters )
+{
+  array_bench_data_t* d = data;
+  for( size_t it = 0; it < n_iters; ++it )
+  {
+    uint64_t sum = 0;
+    for( int i = 0; i < d->n; ++i ) { sum += *msh_swissmap_get( &d->swiss_map, d->keys[i] ); }
+    MSH_BENCH_DO_NOT_OPTIMIZE( sum );
+  }
+}
+
+int
+run_benchmarks( int argc, char** argv )
+{
+  int n = 1 << 19;
+  uint64_t* keys = (uint64_t*)malloc( n * sizeof(uint64_t) );
+  uint64_t* vals = (uint64_t*)malloc( n * sizeof(uint64_t) );
+  for( int i = 0; i < n; ++i )
+  {
+    keys[i] = 6 * (uint64_t)i + rand() % 6;
+    vals[i] = rand() % n;
+  }
+
+  array_bench_data_t d = {0};
+  d.n = n;
+  d.keys = keys;
+  d.vals = vals;
+  msh_arena_init( &d.arena, 64 << 20 );
+  hashtable_init( &d.ht_map, sizeof(uint64_t), 16, NULL );
+  d.stb_map = hashCreate( 16 );
+  for( int i = 0; i < n; ++i )
+  {
+    msh_map_insert( &d.map, keys[i], vals[i] );
+    hashtable_insert( &d.ht_map, keys[i], &vals[i] );
+    *hashInsert( d.stb_map, (uint32_t)keys[i] ) = (uint32_t)vals[i];
+    msh_swissmap_insert( &d.swiss_map, keys[i], vals[i] );
+  }
+
+  msh_bench_t* b = msh_bench_create( argc, argv );
+  msh_bench_add( b, "push, msh_array", bench_push_array, &d, n );
+  msh_bench_add( b, "push, msh_aarray (heap)", bench_push_aarray_heap, &d, n );
+  msh_bench_add( b, "push, msh_aarray (arena)", bench_push_aarray_arena, &d, n );
+  msh_bench_add( b, "insert, msh_map", bench_insert_map, &d, n );
+  msh_bench_add( b, "find, msh_map", bench_find_map, &d, n );
+  msh_bench_add( b, "insert, hashtable_t", bench_insert_hashtable, &d, n );
+  msh_bench_add( b, "find, hashtable_t", bench_find_hashtable, &d, n );
+  msh_bench_add( b, "insert, stb_map", bench_insert_stb_map, &d, n );
+  msh_bench_add( b, "find, stb_map", bench_find_stb_map, &d, n );
+  msh_bench_add( b, "insert, msh_swissmap", bench_insert_swissmap, &d, n );
+  msh_bench_add( b, "find, msh_swissmap", bench_find_swissmap, &d, n );
+  int n_regressions = msh_bench_run( b );
+  msh_bench_destroy( b );
+
+  msh_map_free( &d.map );
+  hashtable_term( &d.ht_map );
+  hashFree( d.stb_map );
+  msh_swissmap_free( &d.swiss_map );
+  msh_arena_term( &d.arena );
+  free( keys );
+  free( vals );
+  return n_regressions ? 1 : 0;
+}
+
 int 
 main( int argc, char** argv )
 {
+  if( msh_bench_requested( argc, argv ) ) { return run_benchmarks( argc, argv ); }
   msh_array_test();
   uint64_t t1, t2;
   int32_t n = pow(2, 19);
@@ -265,6 +909,121 @@ main( int argc, char** argv )
     assert(buf_a[i] == i);
   }
 
+  // Same pushes through allocator-aware array, using heap and then an arena. Array is the last
+  // allocation of the arena, so it grows in place instead of being copied.
+  msh_aarray(int) buf_heap = NULL;
+  t1 = msh_time_now();
+  for( int i = 0; i < n; i++ )
+  {
+    msh_aarray_push( buf_heap, i );
+  }
+  t2 = msh_time_now();
+  printf("time to push %lu elements onto msh_aarray (heap): %fus\n", msh_aarray_len(buf_heap), msh_time_diff(MSHT_MICROSECONDS, t2, t1));
+  msh_aarray_free( buf_heap );
+
+  msh_arena_t arena;
+  msh_arena_init( &arena, 64 << 20 );
+  msh_aarray(int) buf_arena = NULL;
+  t1 = msh_time_now();
+  msh_aarray_init( buf_arena, 16, msh_arena_allocator( &arena ) );
+  for( int i = 0; i < n; i++ )
+  {
+    msh_aarray_push( buf_arena, i );
+  }
+  t2 = msh_time_now();
+  printf("time to push %lu elements onto msh_aarray (arena): %fus\n", msh_aarray_len(buf_arena), msh_time_diff(MSHT_MICROSECONDS, t2, t1));
+  for( int i = 0; i < n; i++ )
+  {
+    assert( buf_arena[i] == i );
+  }
+  assert( arena.n_blocks == 1 );
+
+  // Arena reset to a mark releases everything allocated after it.
+  msh_arena_mark_t mark = msh_arena_mark( &arena );
+  int* tmp = msh_arena_alloc( &arena, 1024 * sizeof(int) );
+  assert( tmp && ((uintptr_t)tmp % MSH_ALLOC_DEFAULT_ALIGNMENT) == 0 );
+  msh_arena_reset_to( &arena, mark );
+  assert( msh_arena_alloc( &arena, 1024 * sizeof(int) ) == tmp );
+  msh_arena_term( &arena );
+
+  // Scratch allocations nest, and reuse the same memory once released.
+  msh_scratch_t outer = msh_scratch_begin();
+  void* a = msh_arena_alloc( outer.arena, 256 );
+  msh_scratch_t inner = msh_scratch_begin();
+  void* b = msh_arena_alloc( inner.arena, 256 );
+  assert( a != b );
+  msh_scratch_end( inner );
+  assert( msh_arena_alloc( outer.arena, 256 ) == b );
+  msh_scratch_end( outer );
+  msh_scratch_t again = msh_scratch_begin();
+  assert( msh_arena_alloc( again.arena, 256 ) == a );
+  msh_scratch_end( again );
+  msh_scratch_term();
+
+  // Pool against malloc on many small allocations that are released out of order.
+  void** ptrs = (void**)malloc( n * sizeof(void*) );
+  t1 = msh_time_now();
+  for( int i = 0; i < n; i++ ) { ptrs[i] = malloc( 48 ); }
+  for( int i = 0; i < n; i += 2 ) { free( ptrs[i] ); }
+  for( int i = 0; i < n; i += 2 ) { ptrs[i] = malloc( 48 ); }
+  for( int i = 0; i < n; i++ ) { free( ptrs[i] ); }
+  t2 = msh_time_now();
+  printf("time to alloc/free %d 48-byte elements with malloc: %fus\n", n + n / 2, msh_time_diff(MSHT_MICROSECONDS, t2, t1));
+
+  msh_pool_t pool;
+  msh_pool_init( &pool, 48, 4096 );
+  t1 = msh_time_now();
+  for( int i = 0; i < n; i++ ) { ptrs[i] = msh_pool_alloc( &pool ); }
+  for( int i = 0; i < n; i += 2 ) { msh_pool_free( &pool, ptrs[i] ); }
+  for( int i = 0; i < n; i += 2 ) { ptrs[i] = msh_pool_alloc( &pool ); }
+  for( int i = 0; i < n; i++ ) { msh_pool_free( &pool, ptrs[i] ); }
+  t2 = msh_time_now();
+  printf("time to alloc/free %d 48-byte elements with msh_pool: %fus\n", n + n / 2, msh_time_diff(MSHT_MICROSECONDS, t2, t1));
+  assert( pool.n_used == 0 );
+  msh_pool_term( &pool );
+  free( ptrs );
+
+  // Bulk operations - a single capacity check and memcpy instead of one per element.
+  msh_aarray(int) buf_bulk = NULL;
+  msh_aarray_reserve( buf_bulk, n );
+  assert( msh_aarray_cap( buf_bulk ) == (size_t)n );
+  t1 = msh_time_now();
+  msh_aarray_append( buf_bulk, buf_a, n );
+  t2 = msh_time_now();
+  printf("time to append %lu elements onto msh_aarray: %fus\n", msh_aarray_len(buf_bulk), msh_time_diff(MSHT_MICROSECONDS, t2, t1));
+  assert( msh_aarray_cap( buf_bulk ) == (size_t)n );
+  assert( memcmp( buf_bulk, buf_a, n * sizeof(int) ) == 0 );
+  msh_aarray_clear( buf_bulk );
+  t1 = msh_time_now();
+  int* dst = msh_aarray_grow_uninit( buf_bulk, n );
+  for( int i = 0; i < n; i++ ) { dst[i] = i; }
+  t2 = msh_time_now();
+  printf("time to write %lu elements into uninitialized msh_aarray storage: %fus\n", msh_aarray_len(buf_bulk), msh_time_diff(MSHT_MICROSECONDS, t2, t1));
+  for( int i = 0; i < n; i++ ) { assert( buf_bulk[i] == i ); }
+  msh_aarray_free( buf_bulk );
+
+  // Growing a very large array. Past MSH_ALLOC_MREMAP_THRESHOLD heap allocator remaps pages on
+  // Linux, compared against an allocator that always copies, like realloc that cannot extend.
+  size_t n_large = (size_t)1 << 27;
+  size_t chunk = (size_t)1 << 20;
+  msh_allocator_t copy_allocator = { copying_realloc, NULL };
+  for( int pass = 0; pass < 2; ++pass )
+  {
+    msh_aarray(uint32_t) large = NULL;
+    msh_aarray_init( large, 16, pass ? copy_allocator : msh_heap_allocator() );
+    t1 = msh_time_now();
+    for( size_t i = 0; i < n_large; i += chunk )
+    {
+      uint32_t* dst_large = msh_aarray_grow_uninit( large, chunk );
+      for( size_t j = 0; j < chunk; ++j ) { dst_large[j] = (uint32_t)(i + j); }
+    }
+    t2 = msh_time_now();
+    printf("time to grow msh_aarray to %lu MB (%s): %fus\n", (msh_aarray_len(large) * sizeof(uint32_t)) >> 20,
+           pass ? "copying realloc" : "heap", msh_time_diff(MSHT_MICROSECONDS, t2, t1));
+    for( size_t i = 0; i < n_large; i += 4099 ) { assert( large[i] == (uint32_t)i ); }
+    msh_aarray_free( large );
+  }
+
   // std::vector<int> buf_b;
   // t1 = msh_time_now();
   // for( int i = 0; i < n; i++ )
@@ -363,6 +1122,121 @@ main( int argc, char** argv )
   t2 = msh_time_now();
   printf("time to find  %d elements in stb_map: %fus\n", hashCount(stb_map), msh_time_diff(MSHT_MICROSECONDS, t2, t1));
 
+  //==================================
+  msh_swissmap_t swiss_map = {0};
+  t1 = msh_time_now();
+  for( uint64_t i = 0; i < m; ++i )
+  {
+    msh_swissmap_insert( &swiss_map, keys[i], vals[i] );
+  }
+  t2 = msh_time_now();
+  printf("time to insert %lu elements onto msh_swissmap: %fus\n", msh_swissmap_len(&swiss_map), msh_time_diff(MSHT_MICROSECONDS, t2, t1));
+
+  t1 = msh_time_now();
+  for( uint64_t i = 0; i < m; ++i )
+  {
+    uint64_t val = *msh_swissmap_get( &swiss_map, keys[i] );
+    assert( val == vals[i] );
+  }
+  t2 = msh_time_now();
+  printf("time to find  %lu elements in msh_swissmap: %fus\n", msh_swissmap_len(&swiss_map), msh_time_diff(MSHT_MICROSECONDS, t2, t1));
+
+  // Misses probe until the first group with an empty slot.
+  uint64_t n_found = 0;
+  t1 = msh_time_now();
+  for( uint64_t i = 0; i < m; ++i )
+  {
+    n_found += msh_swissmap_get( &swiss_map, 6*(uint64_t)m + keys[i] ) != NULL;
+  }
+  t2 = msh_time_now();
+  assert( n_found == 0 );
+  printf("time to miss  %d elements in msh_swissmap: %fus\n", m, msh_time_diff(MSHT_MICROSECONDS, t2, t1));
+
+  // Churn - remove and reinsert keys, so that table keeps accumulating tombstones.
+  int n_churn = 4 * m;
+  size_t swiss_rehashes = swiss_map.n_rehashes;
+  t1 = msh_time_now();
+  for( int i = 0; i < n_churn; ++i )
+  {
+    int j = i % m;
+    int removed = msh_swissmap_remove( &swiss_map, keys[j] );
+    assert( removed );
+    keys[j] += 6*(uint64_t)m;
+    msh_swissmap_insert( &swiss_map, keys[j], vals[j] );
+  }
+  t2 = msh_time_now();
+  printf("time to remove/insert %d elements in msh_swissmap: %fus (%lu rehashes)\n", n_churn, msh_time_diff(MSHT_MICROSECONDS, t2, t1), swiss_map.n_rehashes - swiss_rehashes);
+  for( uint64_t i = 0; i < m; ++i )
+  {
+    assert( *msh_swissmap_get( &swiss_map, keys[i] ) == vals[i] );
+  }
+  assert( msh_swissmap_len( &swiss_map ) == (size_t)m );
+  msh_swissmap_free( &swiss_map );
+
+  // Tables are allocated through an allocator, here an arena that is released all at once.
+  msh_arena_t map_arena;
+  msh_arena_init( &map_arena, 1 << 20 );
+  msh_swissmap_t arena_map = {0};
+  msh_swissmap_init( &arena_map, 16, msh_arena_allocator( &map_arena ) );
+  t1 = msh_time_now();
+  for( uint64_t i = 0; i < m; ++i )
+  {
+    msh_swissmap_insert( &arena_map, keys[i], vals[i] );
+  }
+  t2 = msh_time_now();
+  printf("time to insert %lu elements onto msh_swissmap (arena): %fus\n", msh_swissmap_len(&arena_map), msh_time_diff(MSHT_MICROSECONDS, t2, t1));
+  for( uint64_t i = 0; i < m; ++i )
+  {
+    assert( *msh_swissmap_get( &arena_map, keys[i] ) == vals[i] );
+  }
+  msh_arena_term( &map_arena );
+
+  //==================================
+  // Concurrent map - throughput against number of threads. Keys are split into contiguous
+  // ranges, one per thread.
+  enum { MAX_THREADS = 8 };
+  cmap_bench_job_t jobs[MAX_THREADS];
+  uint64_t* outs = (uint64_t*)malloc( MAX_THREADS * m * sizeof(uint64_t) );
+  for( int n_threads = 1; n_threads <= MAX_THREADS; n_threads *= 2 )
+  {
+    msh_cmap_t cmap;
+    msh_cmap_init( &cmap, m );
+    for( int t = 0; t < n_threads; ++t )
+    {
+      jobs[t] = (cmap_bench_job_t){ .map = &cmap, .keys = keys, .vals = vals,
+                                    .start = (int)((int64_t)m * t / n_threads),
+                                    .end = (int)((int64_t)m * (t + 1) / n_threads) };
+    }
+    double insert_time = cmap_bench_run( cmap_bench_insert, jobs, n_threads );
+    double find_time = cmap_bench_run( cmap_bench_find, jobs, n_threads );
+    int n_failed = 0;
+    for( int t = 0; t < n_threads; ++t ) { n_failed += jobs[t].n_failed; }
+    assert( n_failed == 0 );
+    assert( msh_cmap_len( &cmap ) == (uint64_t)m );
+    printf("msh_cmap, %d threads: insert %fus (%.1f Mops/s), find %fus (%.1f Mops/s)\n",
+           n_threads, insert_time, m / insert_time, find_time, m / find_time );
+    msh_cmap_free( &cmap );
+
+    msh_cmap_init( &cmap, m );
+    for( int t = 0; t < n_threads; ++t )
+    {
+      jobs[t] = (cmap_bench_job_t){ .map = &cmap, .keys = keys, .out = outs + (size_t)t * m,
+                                    .tag = (uint64_t)t, .start = 0, .end = m };
+    }
+    double contend_time = cmap_bench_run( cmap_bench_contend, jobs, n_threads );
+    for( int i = 0; i < m; ++i )
+    {
+      uint64_t val;
+      int found = msh_cmap_get( &cmap, keys[i], &val );
+      assert( found );
+      for( int t = 0; t < n_threads; ++t ) { assert( outs[(size_t)t * m + i] == val ); }
+    }
+    assert( msh_cmap_len( &cmap ) == (uint64_t)m );
+    printf("msh_cmap, %d threads: contended insert of %d keys per thread %fus\n", n_threads, m, contend_time );
+    msh_cmap_free( &cmap );
+  }
+  free( outs );
+
   return 0;
   
 
@@ -0,0 +1,715 @@
+/*
+  ==============================================================================
+
+  MSH_ALLOC.H v0.1
+
+  A single header library providing simple allocators, for code that would otherwise pay for
+  malloc/free of many short lived buffers:
+
+    - linear arena - bump allocation from large blocks, freed all at once or reset to a mark
+    - pool         - fixed-size elements with O(1) alloc/free through an intrusive free list
+    - scratch      - per-thread arena for temporaries, used through begin/end pairs
+
+  and a stretchy array (msh_aarray) that grows through any of them.
+
+  To use the library you simply add:
+
+  #define MSH_ALLOC_IMPLEMENTATION
+  #include "msh_alloc.h"
+
+  ==============================================================================
+  DOCUMENTATION
+
+  Allocator interface
+    Allocators are described by msh_allocator_t - a single resize function and a context
+    pointer. Resize function follows realloc semantics, except that it is also told the old
+    size of the block, which is what lets an arena grow its last allocation in place:
+      - ptr == NULL          -> allocate new_size bytes
+      - new_size == 0        -> free ptr
+      - otherwise            -> resize ptr from old_size to new_size bytes
+    Zero-initialized msh_allocator_t means heap (malloc/realloc/free), so containers that
+    store an allocator use heap by default.
+
+  Arena
+    msh_arena_t arena = {0};
+    msh_arena_init( &arena, 1 << 20 );          // minimal size of a block
+    float* a = msh_arena_alloc( &arena, 1024 * sizeof(float) );
+    msh_arena_mark_t mark = msh_arena_mark( &arena );
+    ...                                         // temporary allocations
+    msh_arena_reset_to( &arena, mark );         // everything after mark is released
+    msh_arena_term( &arena );
+
+    Blocks are kept on reset and reused, so an arena reset every frame stops calling malloc
+    once it has reached its peak size. Freeing individual allocations is a no-op, except for
+    the most recent allocation, which also can be grown and shrunk in place.
+
+  Pool
+    msh_pool_t pool = {0};
+    msh_pool_init( &pool, sizeof(node_t), 4096 );   // element size, elements per chunk
+    node_t* n = msh_pool_alloc( &pool );
+    msh_pool_free( &pool, n );
+    msh_pool_term( &pool );
+
+  Scratch
+    msh_scratch_t scratch = msh_scratch_begin();
+    int* tmp = msh_arena_alloc( scratch.arena, n * sizeof(int) );
+    ...
+    msh_scratch_end( scratch );
+
+    Each thread has its own scratch arena, so no locking is needed. Begin/end pairs can be
+    nested. Call msh_scratch_term() before a thread exits to release its blocks.
+
+  Allocator-aware array
+    msh_aarray(int) arr = NULL;
+    msh_aarray_init( arr, 1024, msh_arena_allocator( &arena ) );  // optional, heap if skipped
+    msh_aarray_push( arr, 42 );
+    msh_aarray_len( arr );
+    msh_aarray_free( arr );
+
+    Same layout as msh_array - header is stored before the first element - with the
+    allocator stored in the header. Pushing into an array that is the last allocation of an
+    arena grows it in place, without copying. If the allocator cannot provide the memory, the
+    program aborts with a message.
+
+    Bulk operations avoid per-element capacity checks:
+    msh_aarray_reserve( arr, n );                 // capacity of exactly n, if it was smaller
+    msh_aarray_append( arr, src, n );             // n elements copied with a single memcpy
+    int* dst = msh_aarray_grow_uninit( arr, n );  // n uninitialized elements to write into
+    Macros may evaluate 'n' more than once.
+
+  Large heap blocks (Linux)
+    Heap allocations of at least MSH_ALLOC_MREMAP_THRESHOLD bytes made through msh_allocator_t
+    are served by mmap, advised to use transparent huge pages, and resized with mremap, which
+    moves page table entries instead of copying, so multi-GB arrays grow in constant time per
+    page. Whether a block is mapped is derived from its size, so such blocks have to be
+    released through the allocator with their correct size, never with free(). Define
+    MSH_ALLOC_NO_MREMAP to always use malloc/realloc.
+
+  Memory tracking
+    Blocks that allocators take from the heap go through MSH_ALLOC_MALLOC, MSH_ALLOC_REALLOC
+    and MSH_ALLOC_FREE. When msh_mem.h is included before this header they are tracked under
+    "msh_alloc", mapped blocks included, so live and peak bytes of arenas and pools show up in
+    its reports; allocations made inside an arena are not tracked separately.
+
+  ==============================================================================
+  AUTHORS:
+    Maciej Halber
+
+  LICENSE:
+    CC0
+  ==============================================================================
+*/
+
+#ifndef MSH_ALLOC_H
+#define MSH_ALLOC_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <assert.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#ifndef MSH_ALLOC_DEF
+#ifdef MSH_ALLOC_STATIC
+#define MSH_ALLOC_DEF static
+#else
+#define MSH_ALLOC_DEF extern
+#endif
+#endif
+
+#ifndef MSH_ALLOC_DEFAULT_ALIGNMENT
+#define MSH_ALLOC_DEFAULT_ALIGNMENT 16
+#endif
+
+#ifndef MSH_ALLOC_SCRATCH_BLOCK_SIZE
+#define MSH_ALLOC_SCRATCH_BLOCK_SIZE (1 << 20)
+#endif
+
+#ifndef MSH_ALLOC_MREMAP_THRESHOLD
+#define MSH_ALLOC_MREMAP_THRESHOLD (64 << 20)
+#endif
+
+#if defined(_MSC_VER)
+#define MSH_ALLOC_THREAD_LOCAL __declspec(thread)
+#else
+#define MSH_ALLOC_THREAD_LOCAL __thread
+#endif
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+// Allocator interface
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+typedef void* (*msh_realloc_fn)( void* ctx, void* ptr, size_t old_size, size_t new_size );
+
+typedef struct msh_allocator
+{
+  msh_realloc_fn realloc;  // NULL means heap
+  void* ctx;
+} msh_allocator_t;
+
+MSH_ALLOC_DEF msh_allocator_t msh_heap_allocator( void );
+MSH_ALLOC_DEF void* msh_allocator_realloc( const msh_allocator_t* allocator, void* ptr,
+                                           size_t old_size, size_t new_size );
+MSH_ALLOC_DEF void* msh_allocator_alloc( const msh_allocator_t* allocator, size_t size );
+MSH_ALLOC_DEF void  msh_allocator_free( const msh_allocator_t* allocator, void* ptr, size_t size );
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+// Arena
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+typedef struct msh__arena_block
+{
+  struct msh__arena_block* next;
+  uint8_t* data;
+  size_t cap;
+  size_t used;
+} msh__arena_block_t;
+
+typedef struct msh_arena
+{
+  msh__arena_block_t* first;
+  msh__arena_block_t* cur;
+  void* last_alloc;        // most recent allocation, can be resized in place
+  size_t min_block_size;
+  size_t n_blocks;
+  size_t n_bytes_reserved;
+} msh_arena_t;
+
+typedef struct msh_arena_mark
+{
+  msh__arena_block_t* block;
+  size_t used;
+} msh_arena_mark_t;
+
+MSH_ALLOC_DEF void  msh_arena_init( msh_arena_t* arena, size_t min_block_size );
+MSH_ALLOC_DEF void  msh_arena_term( msh_arena_t* arena );
+MSH_ALLOC_DEF void* msh_arena_alloc( msh_arena_t* arena, size_t size );
+MSH_ALLOC_DEF void* msh_arena_alloc_aligned( msh_arena_t* arena, size_t size, size_t alignment );
+MSH_ALLOC_DEF void* msh_arena_realloc( msh_arena_t* arena, void* ptr, size_t old_size, size_t new_size );
+MSH_ALLOC_DEF msh_arena_mark_t msh_arena_mark( const msh_arena_t* arena );
+MSH_ALLOC_DEF void  msh_arena_reset_to( msh_arena_t* arena, msh_arena_mark_t mark );
+MSH_ALLOC_DEF void  msh_arena_reset( msh_arena_t* arena );
+MSH_ALLOC_DEF msh_allocator_t msh_arena_allocator( msh_arena_t* arena );
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+// Pool
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+typedef struct msh__pool_chunk
+{
+  struct msh__pool_chunk* next;
+} msh__pool_chunk_t;
+
+typedef struct msh_pool
+{
+  msh__pool_chunk_t* chunks;
+  void* free_list;
+  size_t elem_size;
+  size_t elems_per_chunk;
+  size_t n_used;
+} msh_pool_t;
+
+MSH_ALLOC_DEF void  msh_pool_init( msh_pool_t* pool, size_t elem_size, size_t elems_per_chunk );
+MSH_ALLOC_DEF void  msh_pool_term( msh_pool_t* pool );
+MSH_ALLOC_DEF void* msh_pool_alloc( msh_pool_t* pool );
+MSH_ALLOC_DEF void  msh_pool_free( msh_pool_t* pool, void* ptr );
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+// Scratch
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+typedef struct msh_scratch
+{
+  msh_arena_t* arena;
+  msh_arena_mark_t mark;
+} msh_scratch_t;
+
+MSH_ALLOC_DEF msh_scratch_t msh_scratch_begin( void );
+MSH_ALLOC_DEF void          msh_scratch_end( msh_scratch_t scratch );
+MSH_ALLOC_DEF void          msh_scratch_term( void );
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+// Allocator-aware array
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+typedef struct msh_aarray_hdr
+{
+  size_t len;
+  size_t cap;
+  msh_allocator_t allocator;
+} msh_aarray_hdr_t;
+
+#define msh_aarray(T) T*
+#define msh_aarray_hdr(a)  ((msh_aarray_hdr_t*)(a) - 1)
+#define msh_aarray_len(a)  ((a) ? msh_aarray_hdr(a)->len : 0)
+#define msh_aarray_cap(a)  ((a) ? msh_aarray_hdr(a)->cap : 0)
+#define msh_aarray_front(a) (a)
+#define msh_aarray_back(a) ((a) + msh_aarray_len(a) - 1)
+
+#define msh_aarray_init(a, n, allocator) \
+  (*(void**)&(a) = msh__aarray_grow( (a), (n), sizeof(*(a)), (allocator) ))
+#define msh_aarray_fit(a, n) \
+  ((n) <= msh_aarray_cap(a) ? 0 : (*(void**)&(a) = msh__aarray_grow( (a), (n), sizeof(*(a)), msh_heap_allocator() ), 0))
+#define msh_aarray_push(a, ...) \
+  (msh_aarray_fit( (a), msh_aarray_len(a) + 1 ), (a)[msh_aarray_hdr(a)->len++] = (__VA_ARGS__))
+#define msh_aarray_reserve(a, n) \
+  ((size_t)(n) <= msh_aarray_cap(a) ? 0 : (*(void**)&(a) = msh__aarray_resize( (a), (n), sizeof(*(a)), msh_heap_allocator() ), 0))
+#define msh_aarray_append(a, src, n) \
+  msh__aarray_append( (void**)&(a), (src), (n), sizeof(*(a)) )
+#define msh_aarray_grow_uninit(a, n) \
+  (msh__aarray_add_len( (void**)&(a), (n), sizeof(*(a)) ), (a) + msh_aarray_len(a) - (n))
+#define msh_aarray_pop(a)   ((a)[--msh_aarray_hdr(a)->len])
+#define msh_aarray_clear(a) ((a) ? (msh_aarray_hdr(a)->len = 0) : 0)
+#define msh_aarray_free(a)  (msh__aarray_free( (a), sizeof(*(a)) ), (a) = NULL)
+
+// Allocator is only used if 'a' is NULL, otherwise array keeps the one it was created with.
+MSH_ALLOC_DEF void* msh__aarray_grow( void* a, size_t min_cap, size_t elem_size,
+                                      msh_allocator_t allocator );
+MSH_ALLOC_DEF void* msh__aarray_resize( void* a, size_t new_cap, size_t elem_size,
+                                        msh_allocator_t allocator );
+MSH_ALLOC_DEF void  msh__aarray_add_len( void** a, size_t n, size_t elem_size );
+MSH_ALLOC_DEF void  msh__aarray_append( void** a, const void* src, size_t n, size_t elem_size );
+MSH_ALLOC_DEF void  msh__aarray_free( void* a, size_t elem_size );
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* MSH_ALLOC_H */
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+// IMPLEMENTATION
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+#ifdef MSH_ALLOC_IMPLEMENTATION
+
+// Arena blocks, pool chunks and heap allocations are tracked under "msh_alloc" when msh_mem.h is
+// included first, mapped blocks included.
+#ifndef MSH_ALLOC_MALLOC
+#ifdef MSH_MEM_H
+#define MSH_ALLOC_MALLOC( size )        msh_mem_alloc( "msh_alloc", size )
+#define MSH_ALLOC_REALLOC( ptr, size )  msh_mem_realloc( "msh_alloc", ptr, size )
+#define MSH_ALLOC_FREE( ptr )           msh_mem_free( ptr )
+#else
+#define MSH_ALLOC_MALLOC( size )        malloc( size )
+#define MSH_ALLOC_REALLOC( ptr, size )  realloc( ptr, size )
+#define MSH_ALLOC_FREE( ptr )           free( ptr )
+#endif
+#endif
+
+#ifdef MSH_MEM_H
+#define MSH__ALLOC_TRACK( ptr, size )   msh_mem_track( "msh_alloc", ptr, size )
+#define MSH__ALLOC_UNTRACK( ptr )       msh_mem_untrack( ptr )
+#else
+#define MSH__ALLOC_TRACK( ptr, size )
+#define MSH__ALLOC_UNTRACK( ptr )
+#endif
+
+#if defined(__linux__) && !defined(MSH_ALLOC_NO_MREMAP)
+#define MSH_ALLOC_MREMAP 1
+#include <sys/mman.h>
+#include <unistd.h>
+// Without _GNU_SOURCE/_DEFAULT_SOURCE these are hidden by glibc headers, but always available.
+#ifndef MAP_ANONYMOUS
+#define MAP_ANONYMOUS 0x20
+#endif
+#ifndef MREMAP_MAYMOVE
+#define MREMAP_MAYMOVE 1
+extern void* mremap( void* old_address, size_t old_size, size_t new_size, int flags, ... );
+#endif
+#ifndef MADV_HUGEPAGE
+#define MADV_HUGEPAGE 14
+extern int madvise( void* addr, size_t length, int advice );
+#endif
+
+static size_t
+msh__page_round( size_t size )
+{
+  static size_t page_size = 0;
+  if( !page_size ) { page_size = (size_t)sysconf( _SC_PAGESIZE ); }
+  return (size + page_size - 1) & ~(page_size - 1);
+}
+
+static void*
+msh__mapped_realloc( void* ptr, size_t old_size, size_t new_size )
+{
+  int old_mapped = ptr && old_size >= MSH_ALLOC_MREMAP_THRESHOLD;
+  int new_mapped = new_size >= MSH_ALLOC_MREMAP_THRESHOLD;
+  void* new_ptr = NULL;
+  if( new_size == 0 )
+  {
+    munmap( ptr, msh__page_round( old_size ) );
+    MSH__ALLOC_UNTRACK( ptr );
+  }
+  else if( old_mapped && new_mapped )
+  {
+    new_ptr = mremap( ptr, msh__page_round( old_size ), msh__page_round( new_size ), MREMAP_MAYMOVE );
+    if( new_ptr == MAP_FAILED ) { return NULL; }
+    madvise( new_ptr, msh__page_round( new_size ), MADV_HUGEPAGE );
+    MSH__ALLOC_UNTRACK( ptr );
+    MSH__ALLOC_TRACK( new_ptr, new_size );
+  }
+  else if( new_mapped )
+  {
+    new_ptr = mmap( NULL, msh__page_round( new_size ), PROT_READ | PROT_WRITE,
+                    MAP_PRIVATE | MAP_ANONYMOUS, -1, 0 );
+    if( new_ptr == MAP_FAILED ) { return NULL; }
+    madvise( new_ptr, msh__page_round( new_size ), MADV_HUGEPAGE );
+    MSH__ALLOC_TRACK( new_ptr, new_size );
+    if( ptr ) { memcpy( new_ptr, ptr, old_size ); MSH_ALLOC_FREE( ptr ); }
+  }
+  else
+  {
+    new_ptr = MSH_ALLOC_MALLOC( new_size );
+    if( !new_ptr ) { return NULL; }
+    memcpy( new_ptr, ptr, new_size );
+    munmap( ptr, msh__page_round( old_size ) );
+    MSH__ALLOC_UNTRACK( ptr );
+  }
+  return new_ptr;
+}
+#endif
+
+static void*
+msh__heap_realloc( void* ctx, void* ptr, size_t old_size, size_t new_size )
+{
+  (void)ctx; (void)old_size;
+#if MSH_ALLOC_MREMAP
+  if( (ptr && old_size >= MSH_ALLOC_MREMAP_THRESHOLD) || new_size >= MSH_ALLOC_MREMAP_THRESHOLD )
+  {
+    return msh__mapped_realloc( ptr, old_size, new_size );
+  }
+#endif
+  if( new_size == 0 ) { MSH_ALLOC_FREE( ptr ); return NULL; }
+  return MSH_ALLOC_REALLOC( ptr, new_size );
+}
+
+MSH_ALLOC_DEF msh_allocator_t
+msh_heap_allocator( void )
+{
+  msh_allocator_t allocator = { msh__heap_realloc, NULL };
+  return allocator;
+}
+
+MSH_ALLOC_DEF void*
+msh_allocator_realloc( const msh_allocator_t* allocator, void* ptr, size_t old_size, size_t new_size )
+{
+  if( !allocator || !allocator->realloc ) { return msh__heap_realloc( NULL, ptr, old_size, new_size ); }
+  // In parentheses, so that realloc redirected by msh_mem.h does not expand here.
+  return ( allocator->realloc )( allocator->ctx, ptr, old_size, new_size );
+}
+
+MSH_ALLOC_DEF void*
+msh_allocator_alloc( const msh_allocator_t* allocator, size_t size )
+{
+  return msh_allocator_realloc( allocator, NULL, 0, size );
+}
+
+MSH_ALLOC_DEF void
+msh_allocator_free( const msh_allocator_t* allocator, void* ptr, size_t size )
+{
+  if( ptr ) { msh_allocator_realloc( allocator, ptr, size, 0 ); }
+}
+
+//--------------------------------------------------------------------------------------------------
+
+static inline uintptr_t
+msh__align_up( uintptr_t x, size_t alignment )
+{
+  return (x + (alignment - 1)) & ~(uintptr_t)(alignment - 1);
+}
+
+MSH_ALLOC_DEF void
+msh_arena_init( msh_arena_t* arena, size_t min_block_size )
+{
+  memset( arena, 0, sizeof(*arena) );
+  arena->min_block_size = min_block_size;
+}
+
+MSH_ALLOC_DEF void
+msh_arena_term( msh_arena_t* arena )
+{
+  msh__arena_block_t* block = arena->first;
+  while( block )
+  {
+    msh__arena_block_t* next = block->next;
+    MSH_ALLOC_FREE( block );
+    block = next;
+  }
+  memset( arena, 0, sizeof(*arena) );
+}
+
+static msh__arena_block_t*
+msh__arena_new_block( msh_arena_t* arena, size_t size )
+{
+  size_t cap = size > arena->min_block_size ? size : arena->min_block_size;
+  msh__arena_block_t* block = (msh__arena_block_t*)MSH_ALLOC_MALLOC( sizeof(msh__arena_block_t) + cap + MSH_ALLOC_DEFAULT_ALIGNMENT );
+  if( !block ) { return NULL; }
+  block->next = NULL;
+  block->data = (uint8_t*)msh__align_up( (uintptr_t)(block + 1), MSH_ALLOC_DEFAULT_ALIGNMENT );
+  block->cap = cap;
+  block->used = 0;
+  arena->n_blocks++;
+  arena->n_bytes_reserved += cap;
+  return block;
+}
+
+MSH_ALLOC_DEF void*
+msh_arena_alloc_aligned( msh_arena_t* arena, size_t size, size_t alignment )
+{
+  assert( alignment && !(alignment & (alignment - 1)) );
+  msh__arena_block_t* block = arena->cur;
+  if( block )
+  {
+    uintptr_t start = msh__align_up( (uintptr_t)(block->data + block->used), alignment );
+    if( start + size <= (uintptr_t)(block->data + block->cap) )
+    {
+      block->used = (size_t)(start + size - (uintptr_t)block->data);
+      arena->last_alloc = (void*)start;
+      return (void*)start;
+    }
+  }
+
+  // Current block is full - move to the next one kept from before a reset, if it is big enough,
+  // otherwise insert a fresh block after the current one.
+  size_t needed = size + (alignment > MSH_ALLOC_DEFAULT_ALIGNMENT ? alignment : 0);
+  msh__arena_block_t* next = block ? block->next : arena->first;
+  if( !next || next->cap < needed )
+  {
+    msh__arena_block_t* new_block = msh__arena_new_block( arena, needed );
+    if( !new_block ) { return NULL; }
+    new_block->next = next;
+    if( block ) { block->next = new_block; }
+    else        { arena->first = new_block; }
+    next = new_block;
+  }
+  arena->cur = next;
+  next->used = 0;
+  uintptr_t start = msh__align_up( (uintptr_t)next->data, alignment );
+  next->used = (size_t)(start + size - (uintptr_t)next->data);
+  arena->last_alloc = (void*)start;
+  return (void*)start;
+}
+
+MSH_ALLOC_DEF void*
+msh_arena_alloc( msh_arena_t* arena, size_t size )
+{
+  return msh_arena_alloc_aligned( arena, size, MSH_ALLOC_DEFAULT_ALIGNMENT );
+}
+
+MSH_ALLOC_DEF void*
+msh_arena_realloc( msh_arena_t* arena, void* ptr, size_t old_size, size_t new_size )
+{
+  if( !ptr ) { return new_size ? msh_arena_alloc( arena, new_size ) : NULL; }
+
+  // Only the most recent allocation can be resized or released in place.
+  msh__arena_block_t* block = arena->cur;
+  if( ptr == arena->last_alloc )
+  {
+    size_t offset = (size_t)((uint8_t*)ptr - block->data);
+    if( offset + new_size <= block->cap )
+    {
+      block->used = offset + new_size;
+      if( new_size == 0 ) { arena->last_alloc = NULL; }
+      return new_size ? ptr : NULL;
+    }
+  }
+  if( new_size == 0 ) { return NULL; }
+  if( new_size <= old_size ) { return ptr; }
+
+  void* new_ptr = msh_arena_alloc( arena, new_size );
+  if( new_ptr ) { memcpy( new_ptr, ptr, old_size ); }
+  return new_ptr;
+}
+
+MSH_ALLOC_DEF msh_arena_mark_t
+msh_arena_mark( const msh_arena_t* arena )
+{
+  msh_arena_mark_t mark = { arena->cur, arena->cur ? arena->cur->used : 0 };
+  return mark;
+}
+
+MSH_ALLOC_DEF void
+msh_arena_reset_to( msh_arena_t* arena, msh_arena_mark_t mark )
+{
+  arena->cur = mark.block;
+  if( arena->cur ) { arena->cur->used = mark.used; }
+  arena->last_alloc = NULL;
+}
+
+MSH_ALLOC_DEF void
+msh_arena_reset( msh_arena_t* arena )
+{
+  msh_arena_mark_t mark = { NULL, 0 };
+  msh_arena_reset_to( arena, mark );
+}
+
+static void*
+msh__arena_realloc_fn( void* ctx, void* ptr, size_t old_size, size_t new_size )
+{
+  return msh_arena_realloc( (msh_arena_t*)ctx, ptr, old_size, new_size );
+}
+
+MSH_ALLOC_DEF msh_allocator_t
+msh_arena_allocator( msh_arena_t* arena )
+{
+  msh_allocator_t allocator = { msh__arena_realloc_fn, arena };
+  return allocator;
+}
+
+//--------------------------------------------------------------------------------------------------
+
+MSH_ALLOC_DEF void
+msh_pool_init( msh_pool_t* pool, size_t elem_size, size_t elems_per_chunk )
+{
+  memset( pool, 0, sizeof(*pool) );
+  // Free elements store the free list link in place.
+  size_t min_size = sizeof(void*);
+  pool->elem_size = msh__align_up( elem_size > min_size ? elem_size : min_size, sizeof(void*) );
+  pool->elems_per_chunk = elems_per_chunk ? elems_per_chunk : 1;
+}
+
+MSH_ALLOC_DEF void
+msh_pool_term( msh_pool_t* pool )
+{
+  msh__pool_chunk_t* chunk = pool->chunks;
+  while( chunk )
+  {
+    msh__pool_chunk_t* next = chunk->next;
+    MSH_ALLOC_FREE( chunk );
+    chunk = next;
+  }
+  memset( pool, 0, sizeof(*pool) );
+}
+
+MSH_ALLOC_DEF void*
+msh_pool_alloc( msh_pool_t* pool )
+{
+  if( !pool->free_list )
+  {
+    size_t header_size = msh__align_up( sizeof(msh__pool_chunk_t), MSH_ALLOC_DEFAULT_ALIGNMENT );
+    msh__pool_chunk_t* chunk = (msh__pool_chunk_t*)MSH_ALLOC_MALLOC( header_size + pool->elem_size * pool->elems_per_chunk );
+    if( !chunk ) { return NULL; }
+    chunk->next = pool->chunks;
+    pool->chunks = chunk;
+
+    // Thread new elements onto free list back to front, so they are handed out in address order.
+    uint8_t* elems = (uint8_t*)chunk + header_size;
+    for( size_t i = pool->elems_per_chunk; i > 0; --i )
+    {
+      void* elem = elems + (i - 1) * pool->elem_size;
+      *(void**)elem = pool->free_list;
+      pool->free_list = elem;
+    }
+  }
+  void* elem = pool->free_list;
+  pool->free_list = *(void**)elem;
+  pool->n_used++;
+  return elem;
+}
+
+MSH_ALLOC_DEF void
+msh_pool_free( msh_pool_t* pool, void* ptr )
+{
+  if( !ptr ) { return; }
+  *(void**)ptr = pool->free_list;
+  pool->free_list = ptr;
+  pool->n_used--;
+}
+
+//--------------------------------------------------------------------------------------------------
+
+static MSH_ALLOC_THREAD_LOCAL msh_arena_t msh__scratch_arena;
+
+MSH_ALLOC_DEF msh_scratch_t
+msh_scratch_begin( void )
+{
+  msh_scratch_t scratch;
+  if( !msh__scratch_arena.min_block_size )
+  {
+    msh_arena_init( &msh__scratch_arena, MSH_ALLOC_SCRATCH_BLOCK_SIZE );
+  }
+  scratch.arena = &msh__scratch_arena;
+  scratch.mark = msh_arena_mark( &msh__scratch_arena );
+  return scratch;
+}
+
+MSH_ALLOC_DEF void
+msh_scratch_end( msh_scratch_t scratch )
+{
+  msh_arena_reset_to( scratch.arena, scratch.mark );
+}
+
+MSH_ALLOC_DEF void
+msh_scratch_term( void )
+{
+  msh_arena_term( &msh__scratch_arena );
+}
+
+//--------------------------------------------------------------------------------------------------
+
+MSH_ALLOC_DEF void*
+msh__aarray_grow( void* a, size_t min_cap, size_t elem_size, msh_allocator_t allocator )
+{
+  size_t old_cap = msh_aarray_cap( a );
+  if( min_cap <= old_cap ) { return a; }
+  size_t new_cap = old_cap ? 2 * old_cap : 16;
+  if( new_cap < min_cap ) { new_cap = min_cap; }
+  return msh__aarray_resize( a, new_cap, elem_size, allocator );
+}
+
+MSH_ALLOC_DEF void*
+msh__aarray_resize( void* a, size_t new_cap, size_t elem_size, msh_allocator_t allocator )
+{
+  msh_aarray_hdr_t* hdr = a ? msh_aarray_hdr( a ) : NULL;
+  size_t old_cap = hdr ? hdr->cap : 0;
+  msh_allocator_t alloc = hdr ? hdr->allocator : allocator;
+  assert( new_cap >= msh_aarray_len( a ) );
+  size_t old_size = hdr ? sizeof(msh_aarray_hdr_t) + old_cap * elem_size : 0;
+  size_t new_size = sizeof(msh_aarray_hdr_t) + new_cap * elem_size;
+  msh_aarray_hdr_t* new_hdr = (msh_aarray_hdr_t*)msh_allocator_realloc( &alloc, hdr, old_size, new_size );
+  if( !new_hdr )
+  {
+    fprintf( stderr, "msh_aarray: allocation of %zu bytes failed\n", new_size );
+    abort();
+  }
+  if( !hdr ) { new_hdr->len = 0; }
+  new_hdr->cap = new_cap;
+  new_hdr->allocator = alloc;
+  return new_hdr + 1;
+}
+
+MSH_ALLOC_DEF void
+msh__aarray_add_len( void** a, size_t n, size_t elem_size )
+{
+  size_t len = msh_aarray_len( *a );
+  if( len + n > msh_aarray_cap( *a ) )
+  {
+    *a = msh__aarray_grow( *a, len + n, elem_size, msh_heap_allocator() );
+  }
+  if( *a ) { msh_aarray_hdr( *a )->len += n; }
+}
+
+MSH_ALLOC_DEF void
+msh__aarray_append( void** a, const void* src, size_t n, size_t elem_size )
+{
+  size_t len = msh_aarray_len( *a );
+  msh__aarray_add_len( a, n, elem_size );
+  if( n ) { memcpy( (uint8_t*)*a + len * elem_size, src, n * elem_size ); }
+}
+
+MSH_ALLOC_DEF void
+msh__aarray_free( void* a, size_t elem_size )
+{
+  if( !a ) { return; }
+  msh_aarray_hdr_t* hdr = msh_aarray_hdr( a );
+  msh_allocator_t alloc = hdr->allocator;
+  msh_allocator_free( &alloc, hdr, sizeof(msh_aarray_hdr_t) + hdr->cap * elem_size );
+}
+
+#endif /* MSH_ALLOC_IMPLEMENTATION */
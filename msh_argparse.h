@@ -0,0 +1,750 @@
+/*
+  ==============================================================================
+
+  MSH_ARGPARSE.H v0.2
+
+  A single header library for parsing command line arguments:
+
+    - positional and optional arguments of bool, integer, floating point and string types,
+      with a fixed number of values or any number of values stored in an msh_array
+    - argument names and shorthands looked up in a hash table, so that parsing is linear in
+      the number of tokens, no matter how many arguments are registered
+    - @file arguments expanded from response files, read with a single mmap and tokenized in
+      place, so that long file lists do not have to fit on the command line
+    - generated help message
+
+  To use the library you simply add:
+
+  #include "msh_std.h"
+  #define MSH_ARGPARSE_IMPLEMENTATION
+  #include "msh_argparse.h"
+
+  ==============================================================================
+  DOCUMENTATION
+
+  Registering arguments
+    msh_argparse_t parser;
+    msh_init_argparse( "Program", "What the program does", &parser );
+    msh_add_string_argument( "filename", NULL, "File to read", &opts.filename, 1, &parser );
+    msh_add_float_argument( "--rectangle_size", "-r", "Size of a rectangle", &opts.size[0], 2, &parser );
+    msh_add_bool_argument( "--verbose", "-v", "Print more", &opts.verbose, 0, &parser );
+
+    msh_array(float) gains = NULL;
+    msh_add_float_array_argument( "--gains", "-g", "Gain of every channel", &gains, &parser );
+
+    Arguments whose names start with '-' are optional, others are positional and required,
+    filled in the order they were registered. A fixed argument takes exactly num_vals
+    values, written to 'values'; a bool option with num_vals of 0 is a flag, set to true
+    when present, and any other fixed argument needs num_vals > 0. An array argument takes all values up to the next registered option and
+    appends them to the msh_array; a positional array also takes positional values that
+    follow later options. Names, shorthands and messages are not copied. Registering a name
+    or shorthand twice returns 0.
+
+    Types are bool, int, uint (unsigned int), int64, uint64, float, double and string, e.g.
+    msh_add_int64_argument, msh_add_double_array_argument. Bools are given as 1/0 or
+    true/false. Tokens starting with '-' that are not registered options are values if they
+    are numbers, like -1.5, and errors otherwise, so a string value cannot start with '-'
+    unless it follows "--", after which everything is positional.
+
+  Parsing
+    if( !msh_parse_arguments( argc, argv, &parser ) )
+    {
+      msh_display_help( &parser );       // prints the error first
+      exit( -1 );
+    }
+    ...
+    msh_argparse_term( &parser );
+
+    msh_parse_arguments returns 1 on success and 0 on error, with the message available
+    from msh_argparse_error. String values point into argv, or into response files, which
+    stay loaded until msh_argparse_term. Array values are owned by the caller and are freed
+    with msh_array_free.
+
+  Response files
+    ./program @files.txt --verbose
+
+    A token @path is replaced by the tokens of the file at path. Tokens are separated by
+    whitespace; single or double quotes group whitespace into a token, backslash escapes the
+    next character outside of single quotes, and a token starting with '#' comments out the
+    rest of the line. Response files may refer to other response files, up to
+    MSH_ARGPARSE_MAX_FILE_DEPTH (8) levels. On POSIX systems the file is mapped privately and
+    tokens are terminated in place, so a file is read once and never copied; elsewhere it is
+    read into a buffer.
+
+  Performance
+    Parsing 50k values of an array argument, or 50k tokens of a response file, takes a few
+    milliseconds, mostly in strtod/strtol. The help message sorts optional arguments by name.
+
+  ==============================================================================
+  AUTHORS:
+    Maciej Halber
+
+  LICENSE:
+    CC0
+  ==============================================================================
+*/
+
+#ifndef MSH_ARGPARSE_H
+#define MSH_ARGPARSE_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdbool.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#ifndef MSH_ARGPARSE_DEF
+#ifdef MSH_ARGPARSE_STATIC
+#define MSH_ARGPARSE_DEF static
+#else
+#define MSH_ARGPARSE_DEF extern
+#endif
+#endif
+
+#ifndef MSH_ARGPARSE_MAX_FILE_DEPTH
+#define MSH_ARGPARSE_MAX_FILE_DEPTH 8
+#endif
+
+typedef enum msh_argparse_type
+{
+  MSH_ARGPARSE_BOOL,
+  MSH_ARGPARSE_INT,
+  MSH_ARGPARSE_UINT,
+  MSH_ARGPARSE_INT64,
+  MSH_ARGPARSE_UINT64,
+  MSH_ARGPARSE_FLOAT,
+  MSH_ARGPARSE_DOUBLE,
+  MSH_ARGPARSE_STRING
+} msh_argparse_type_t;
+
+typedef struct msh_arg
+{
+  const char* name;
+  const char* shorthand;
+  const char* message;
+  void* values;                 // num_vals elements, or msh_array of elements for arrays
+  size_t num_vals;
+  msh_argparse_type_t type;
+  int is_array;
+  int n_set;                    // times given on the command line
+} msh_arg_t;
+
+typedef struct msh__argparse_slot
+{
+  const char* key;              // name or shorthand, NULL if empty
+  uint32_t idx;
+} msh__argparse_slot_t;
+
+typedef struct msh__argparse_file
+{
+  char* data;
+  size_t size;
+  int mapped;
+} msh__argparse_file_t;
+
+typedef struct msh_argparse
+{
+  const char* program_name;
+  const char* program_description;
+  msh_array(msh_arg_t) args;
+  msh__argparse_slot_t* slots;  // open addressing, power of two capacity
+  size_t n_slots;
+  size_t cap_slots;
+  msh_array(char*) tokens;
+  msh_array(msh__argparse_file_t) files;
+  char error[256];
+} msh_argparse_t;
+
+MSH_ARGPARSE_DEF int  msh_init_argparse( const char* program_name, const char* program_description,
+                                         msh_argparse_t* parser );
+MSH_ARGPARSE_DEF void msh_argparse_term( msh_argparse_t* parser );
+
+MSH_ARGPARSE_DEF int msh_add_bool_argument( const char* name, const char* shorthand, const char* message,
+                                            bool* values, size_t num_vals, msh_argparse_t* parser );
+MSH_ARGPARSE_DEF int msh_add_int_argument( const char* name, const char* shorthand, const char* message,
+                                           int* values, size_t num_vals, msh_argparse_t* parser );
+MSH_ARGPARSE_DEF int msh_add_uint_argument( const char* name, const char* shorthand, const char* message,
+                                            unsigned int* values, size_t num_vals, msh_argparse_t* parser );
+MSH_ARGPARSE_DEF int msh_add_int64_argument( const char* name, const char* shorthand, const char* message,
+                                             int64_t* values, size_t num_vals, msh_argparse_t* parser );
+MSH_ARGPARSE_DEF int msh_add_uint64_argument( const char* name, const char* shorthand, const char* message,
+                                              uint64_t* values, size_t num_vals, msh_argparse_t* parser );
+MSH_ARGPARSE_DEF int msh_add_float_argument( const char* name, const char* shorthand, const char* message,
+                                             float* values, size_t num_vals, msh_argparse_t* parser );
+MSH_ARGPARSE_DEF int msh_add_double_argument( const char* name, const char* shorthand, const char* message,
+                                              double* values, size_t num_vals, msh_argparse_t* parser );
+MSH_ARGPARSE_DEF int msh_add_string_argument( const char* name, const char* shorthand, const char* message,
+                                              char** values, size_t num_vals, msh_argparse_t* parser );
+
+MSH_ARGPARSE_DEF int msh_add_bool_array_argument( const char* name, const char* shorthand, const char* message,
+                                                  msh_array(bool)* values, msh_argparse_t* parser );
+MSH_ARGPARSE_DEF int msh_add_int_array_argument( const char* name, const char* shorthand, const char* message,
+                                                 msh_array(int)* values, msh_argparse_t* parser );
+MSH_ARGPARSE_DEF int msh_add_uint_array_argument( const char* name, const char* shorthand, const char* message,
+                                                  msh_array(unsigned int)* values, msh_argparse_t* parser );
+MSH_ARGPARSE_DEF int msh_add_int64_array_argument( const char* name, const char* shorthand, const char* message,
+                                                   msh_array(int64_t)* values, msh_argparse_t* parser );
+MSH_ARGPARSE_DEF int msh_add_uint64_array_argument( const char* name, const char* shorthand, const char* message,
+                                                    msh_array(uint64_t)* values, msh_argparse_t* parser );
+MSH_ARGPARSE_DEF int msh_add_float_array_argument( const char* name, const char* shorthand, const char* message,
+                                                   msh_array(float)* values, msh_argparse_t* parser );
+MSH_ARGPARSE_DEF int msh_add_double_array_argument( const char* name, const char* shorthand, const char* message,
+                                                    msh_array(double)* values, msh_argparse_t* parser );
+MSH_ARGPARSE_DEF int msh_add_string_array_argument( const char* name, const char* shorthand, const char* message,
+                                                    msh_array(char*)* values, msh_argparse_t* parser );
+
+MSH_ARGPARSE_DEF int         msh_parse_arguments( int argc, char** argv, msh_argparse_t* parser );
+MSH_ARGPARSE_DEF const char* msh_argparse_error( const msh_argparse_t* parser );
+MSH_ARGPARSE_DEF void        msh_display_help( const msh_argparse_t* parser );
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* MSH_ARGPARSE_H */
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+// IMPLEMENTATION
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+#ifdef MSH_ARGPARSE_IMPLEMENTATION
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdarg.h>
+#include <errno.h>
+#include <limits.h>
+
+#if defined(__unix__) || defined(__APPLE__)
+#define MSH__ARGPARSE_MMAP 1
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#endif
+
+static const char* msh__argparse_type_names[] = { "bool", "int", "uint", "int64", "uint64",
+                                                  "float", "double", "string" };
+
+static void
+msh__argparse_set_error( msh_argparse_t* parser, const char* format, ... )
+{
+  va_list args;
+  va_start( args, format );
+  vsnprintf( parser->error, sizeof(parser->error), format, args );
+  va_end( args );
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+// Name lookup
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+static inline uint64_t
+msh__argparse_hash( const char* key )
+{
+  uint64_t h = 14695981039346656037ULL;
+  for( const unsigned char* c = (const unsigned char*)key; *c; ++c ) { h = ( h ^ *c ) * 1099511628211ULL; }
+  return h;
+}
+
+static int
+msh__argparse_find( const msh_argparse_t* parser, const char* key )
+{
+  if( !parser->cap_slots ) { return -1; }
+  size_t mask = parser->cap_slots - 1;
+  for( size_t i = msh__argparse_hash( key ) & mask; parser->slots[i].key; i = ( i + 1 ) & mask )
+  {
+    if( !strcmp( parser->slots[i].key, key ) ) { return (int)parser->slots[i].idx; }
+  }
+  return -1;
+}
+
+static void
+msh__argparse_insert_slot( msh__argparse_slot_t* slots, size_t cap, const char* key, uint32_t idx )
+{
+  size_t i = msh__argparse_hash( key ) & ( cap - 1 );
+  while( slots[i].key ) { i = ( i + 1 ) & ( cap - 1 ); }
+  slots[i].key = key;
+  slots[i].idx = idx;
+}
+
+static int
+msh__argparse_insert( msh_argparse_t* parser, const char* key, uint32_t idx )
+{
+  if( ( parser->n_slots + 1 ) * 2 > parser->cap_slots )
+  {
+    size_t new_cap = parser->cap_slots ? 2 * parser->cap_slots : 64;
+    msh__argparse_slot_t* slots = (msh__argparse_slot_t*)calloc( new_cap, sizeof(msh__argparse_slot_t) );
+    if( !slots ) { return 0; }
+    for( size_t i = 0; i < parser->cap_slots; ++i )
+    {
+      if( parser->slots[i].key ) { msh__argparse_insert_slot( slots, new_cap, parser->slots[i].key, parser->slots[i].idx ); }
+    }
+    free( parser->slots );
+    parser->slots = slots;
+    parser->cap_slots = new_cap;
+  }
+  msh__argparse_insert_slot( parser->slots, parser->cap_slots, key, idx );
+  parser->n_slots++;
+  return 1;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+// Registration
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+MSH_ARGPARSE_DEF int
+msh_init_argparse( const char* program_name, const char* program_description, msh_argparse_t* parser )
+{
+  memset( parser, 0, sizeof(*parser) );
+  parser->program_name = program_name;
+  parser->program_description = program_description;
+  return 1;
+}
+
+MSH_ARGPARSE_DEF void
+msh_argparse_term( msh_argparse_t* parser )
+{
+  for( size_t i = 0; i < msh_array_len( parser->files ); ++i )
+  {
+    msh__argparse_file_t* f = &parser->files[i];
+#ifdef MSH__ARGPARSE_MMAP
+    if( f->mapped ) { munmap( f->data, f->size + 1 ); continue; }
+#endif
+    free( f->data );
+  }
+  msh_array_free( parser->files );
+  msh_array_free( parser->tokens );
+  msh_array_free( parser->args );
+  free( parser->slots );
+  memset( parser, 0, sizeof(*parser) );
+}
+
+static int
+msh__argparse_add( msh_argparse_t* parser, const char* name, const char* shorthand, const char* message,
+                   void* values, size_t num_vals, msh_argparse_type_t type, int is_array )
+{
+  if( !name || !name[0] || !values )
+  {
+    msh__argparse_set_error( parser, "Argument needs a name and values" );
+    return 0;
+  }
+  int is_positional = name[0] != '-';
+  if( ( shorthand && ( is_positional || shorthand[0] != '-' ) ) ||
+      ( !is_array && num_vals == 0 && ( is_positional || type != MSH_ARGPARSE_BOOL ) ) )
+  {
+    msh__argparse_set_error( parser, "Invalid definition of argument %s", name );
+    return 0;
+  }
+  if( ( !is_positional && msh__argparse_find( parser, name ) >= 0 ) ||
+      ( shorthand && msh__argparse_find( parser, shorthand ) >= 0 ) )
+  {
+    msh__argparse_set_error( parser, "Argument %s is already defined", name );
+    return 0;
+  }
+
+  // Positional names are not looked up, so a value can never be mistaken for them.
+  uint32_t idx = (uint32_t)msh_array_len( parser->args );
+  if( !is_positional && !msh__argparse_insert( parser, name, idx ) ) { return 0; }
+  if( shorthand && !msh__argparse_insert( parser, shorthand, idx ) ) { return 0; }
+  msh_arg_t arg = { name, shorthand, message, values, num_vals, type, is_array, 0 };
+  msh_array_push( parser->args, arg );
+  return 1;
+}
+
+#define MSH__ARGPARSE_ADD_FUNCTIONS( suffix, type, type_id )                                        \
+  MSH_ARGPARSE_DEF int                                                                             \
+  msh_add_##suffix##_argument( const char* name, const char* shorthand, const char* message,        \
+                               type* values, size_t num_vals, msh_argparse_t* parser )             \
+  {                                                                                                \
+    return msh__argparse_add( parser, name, shorthand, message, values, num_vals, type_id, 0 );    \
+  }                                                                                                \
+                                                                                                   \
+  MSH_ARGPARSE_DEF int                                                                             \
+  msh_add_##suffix##_array_argument( const char* name, const char* shorthand, const char* message,  \
+                                     msh_array(type)* values, msh_argparse_t* parser )             \
+  {                                                                                                \
+    return msh__argparse_add( parser, name, shorthand, message, values, 0, type_id, 1 );           \
+  }
+
+MSH__ARGPARSE_ADD_FUNCTIONS( bool, bool, MSH_ARGPARSE_BOOL )
+MSH__ARGPARSE_ADD_FUNCTIONS( int, int, MSH_ARGPARSE_INT )
+MSH__ARGPARSE_ADD_FUNCTIONS( uint, unsigned int, MSH_ARGPARSE_UINT )
+MSH__ARGPARSE_ADD_FUNCTIONS( int64, int64_t, MSH_ARGPARSE_INT64 )
+MSH__ARGPARSE_ADD_FUNCTIONS( uint64, uint64_t, MSH_ARGPARSE_UINT64 )
+MSH__ARGPARSE_ADD_FUNCTIONS( float, float, MSH_ARGPARSE_FLOAT )
+MSH__ARGPARSE_ADD_FUNCTIONS( double, double, MSH_ARGPARSE_DOUBLE )
+MSH__ARGPARSE_ADD_FUNCTIONS( string, char*, MSH_ARGPARSE_STRING )
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+// Values
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+typedef union msh__argparse_value
+{
+  bool b;
+  int i;
+  unsigned int u;
+  int64_t i64;
+  uint64_t u64;
+  float f;
+  double d;
+  char* s;
+} msh__argparse_value_t;
+
+static int
+msh__argparse_convert( msh_argparse_type_t type, char* token, msh__argparse_value_t* value )
+{
+  char* end = token;
+  errno = 0;
+  switch( type )
+  {
+    case MSH_ARGPARSE_BOOL:
+      if( !strcmp( token, "1" ) || !strcmp( token, "true" ) )  { value->b = true; return 1; }
+      if( !strcmp( token, "0" ) || !strcmp( token, "false" ) ) { value->b = false; return 1; }
+      return 0;
+    case MSH_ARGPARSE_INT:
+    {
+      long v = strtol( token, &end, 10 );
+      if( v < INT_MIN || v > INT_MAX ) { return 0; }
+      value->i = (int)v;
+      break;
+    }
+    case MSH_ARGPARSE_UINT:
+    {
+      unsigned long v = strtoul( token, &end, 10 );
+      if( token[0] == '-' || v > UINT_MAX ) { return 0; }
+      value->u = (unsigned int)v;
+      break;
+    }
+    case MSH_ARGPARSE_INT64:  value->i64 = (int64_t)strtoll( token, &end, 10 ); break;
+    case MSH_ARGPARSE_UINT64: value->u64 = (uint64_t)strtoull( token, &end, 10 );
+                              if( token[0] == '-' ) { return 0; }
+                              break;
+    case MSH_ARGPARSE_FLOAT:  value->f = strtof( token, &end ); break;
+    case MSH_ARGPARSE_DOUBLE: value->d = strtod( token, &end ); break;
+    case MSH_ARGPARSE_STRING: value->s = token; return 1;
+  }
+  return end != token && *end == 0 && errno != ERANGE;
+}
+
+static void
+msh__argparse_store( msh_arg_t* arg, size_t i, const msh__argparse_value_t* value )
+{
+  switch( arg->type )
+  {
+    case MSH_ARGPARSE_BOOL:   ((bool*)arg->values)[i] = value->b; break;
+    case MSH_ARGPARSE_INT:    ((int*)arg->values)[i] = value->i; break;
+    case MSH_ARGPARSE_UINT:   ((unsigned int*)arg->values)[i] = value->u; break;
+    case MSH_ARGPARSE_INT64:  ((int64_t*)arg->values)[i] = value->i64; break;
+    case MSH_ARGPARSE_UINT64: ((uint64_t*)arg->values)[i] = value->u64; break;
+    case MSH_ARGPARSE_FLOAT:  ((float*)arg->values)[i] = value->f; break;
+    case MSH_ARGPARSE_DOUBLE: ((double*)arg->values)[i] = value->d; break;
+    case MSH_ARGPARSE_STRING: ((char**)arg->values)[i] = value->s; break;
+  }
+}
+
+static void
+msh__argparse_push( msh_arg_t* arg, const msh__argparse_value_t* value )
+{
+  switch( arg->type )
+  {
+    case MSH_ARGPARSE_BOOL:   msh_array_push( *(msh_array(bool)*)arg->values, value->b ); break;
+    case MSH_ARGPARSE_INT:    msh_array_push( *(msh_array(int)*)arg->values, value->i ); break;
+    case MSH_ARGPARSE_UINT:   msh_array_push( *(msh_array(unsigned int)*)arg->values, value->u ); break;
+    case MSH_ARGPARSE_INT64:  msh_array_push( *(msh_array(int64_t)*)arg->values, value->i64 ); break;
+    case MSH_ARGPARSE_UINT64: msh_array_push( *(msh_array(uint64_t)*)arg->values, value->u64 ); break;
+    case MSH_ARGPARSE_FLOAT:  msh_array_push( *(msh_array(float)*)arg->values, value->f ); break;
+    case MSH_ARGPARSE_DOUBLE: msh_array_push( *(msh_array(double)*)arg->values, value->d ); break;
+    case MSH_ARGPARSE_STRING: msh_array_push( *(msh_array(char*)*)arg->values, value->s ); break;
+  }
+}
+
+static int
+msh__argparse_is_number( const char* token )
+{
+  char* end = NULL;
+  strtod( token, &end );
+  return end != token && *end == 0;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+// Response files
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+// Loads the file with a zero byte after its end, so that the last token can be terminated in
+// place. A mapping of size + 1 bytes reads that byte from the zero filled rest of the last
+// page, unless the size is a multiple of the page size, in which case the file is read.
+static int
+msh__argparse_load_file( const char* path, msh__argparse_file_t* file )
+{
+  memset( file, 0, sizeof(*file) );
+#ifdef MSH__ARGPARSE_MMAP
+  int fd = open( path, O_RDONLY );
+  if( fd < 0 ) { return 0; }
+  struct stat st;
+  if( fstat( fd, &st ) != 0 ) { close( fd ); return 0; }
+  file->size = (size_t)st.st_size;
+  long page_size = sysconf( _SC_PAGESIZE );
+  if( file->size && page_size > 0 && file->size % (size_t)page_size )
+  {
+    void* data = mmap( NULL, file->size + 1, PROT_READ | PROT_WRITE, MAP_PRIVATE, fd, 0 );
+    if( data != MAP_FAILED )
+    {
+      close( fd );
+      file->data = (char*)data;
+      file->mapped = 1;
+      return 1;
+    }
+  }
+  file->data = (char*)malloc( file->size + 1 );
+  size_t n_read = 0;
+  while( file->data && n_read < file->size )
+  {
+    ssize_t n = read( fd, file->data + n_read, file->size - n_read );
+    if( n <= 0 ) { break; }
+    n_read += (size_t)n;
+  }
+  close( fd );
+#else
+  FILE* fp = fopen( path, "rb" );
+  if( !fp ) { return 0; }
+  fseek( fp, 0, SEEK_END );
+  long size = ftell( fp );
+  fseek( fp, 0, SEEK_SET );
+  file->size = size > 0 ? (size_t)size : 0;
+  file->data = (char*)malloc( file->size + 1 );
+  size_t n_read = file->data ? fread( file->data, 1, file->size, fp ) : 0;
+  fclose( fp );
+#endif
+  if( !file->data || n_read != file->size ) { free( file->data ); file->data = NULL; return 0; }
+  file->data[file->size] = 0;
+  return 1;
+}
+
+static int msh__argparse_add_token( msh_argparse_t* parser, char* token, int depth );
+
+// Splits the file into tokens in place, writing unquoted tokens over the original text.
+static int
+msh__argparse_tokenize_file( msh_argparse_t* parser, const char* path, int depth )
+{
+  if( depth >= MSH_ARGPARSE_MAX_FILE_DEPTH )
+  {
+    msh__argparse_set_error( parser, "Argument files nested too deep at %s", path );
+    return 0;
+  }
+  msh__argparse_file_t file;
+  if( !msh__argparse_load_file( path, &file ) )
+  {
+    msh__argparse_set_error( parser, "Could not read argument file %s", path );
+    return 0;
+  }
+  msh_array_push( parser->files, file );
+
+  char* r = file.data;
+  char* end = file.data + file.size;
+  while( r < end )
+  {
+    while( r < end && ( *r == ' ' || *r == '\t' || *r == '\n' || *r == '\r' ) ) { r++; }
+    if( r == end ) { break; }
+    if( *r == '#' )
+    {
+      while( r < end && *r != '\n' ) { r++; }
+      continue;
+    }
+
+    char* token = r;
+    char* w = r;
+    while( r < end && *r != ' ' && *r != '\t' && *r != '\n' && *r != '\r' )
+    {
+      if( *r == '"' || *r == '\'' )
+      {
+        char quote = *r++;
+        while( r < end && *r != quote )
+        {
+          if( quote == '"' && *r == '\\' && r + 1 < end ) { r++; }
+          *w++ = *r++;
+        }
+        if( r < end ) { r++; }
+      }
+      else if( *r == '\\' && r + 1 < end ) { r++; *w++ = *r++; }
+      else { *w++ = *r++; }
+    }
+    // w never passes r, and the byte at end is the extra zero, so this is always in bounds.
+    *w = 0;
+    if( r < end ) { r++; }
+    if( !msh__argparse_add_token( parser, token, depth ) ) { return 0; }
+  }
+  return 1;
+}
+
+static int
+msh__argparse_add_token( msh_argparse_t* parser, char* token, int depth )
+{
+  if( token[0] == '@' && token[1] ) { return msh__argparse_tokenize_file( parser, token + 1, depth + 1 ); }
+  msh_array_push( parser->tokens, token );
+  return 1;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+// Parsing
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+MSH_ARGPARSE_DEF int
+msh_parse_arguments( int argc, char** argv, msh_argparse_t* parser )
+{
+  parser->error[0] = 0;
+  msh_array_clear( parser->tokens );
+  for( int i = 1; i < argc; ++i )
+  {
+    if( !msh__argparse_add_token( parser, argv[i], 0 ) ) { return 0; }
+  }
+
+  size_t n_args = msh_array_len( parser->args );
+  size_t n_tokens = msh_array_len( parser->tokens );
+  size_t next_positional = 0;
+  int only_positional = 0;
+  for( size_t i = 0; i < n_args; ++i ) { parser->args[i].n_set = 0; }
+
+  size_t t = 0;
+  while( t < n_tokens )
+  {
+    char* token = parser->tokens[t];
+    msh_arg_t* arg = NULL;
+    int is_option = 0;
+    if( !only_positional && token[0] == '-' && token[1] )
+    {
+      if( !strcmp( token, "--" ) ) { only_positional = 1; t++; continue; }
+      int idx = msh__argparse_find( parser, token );
+      if( idx >= 0 ) { arg = &parser->args[idx]; is_option = 1; t++; }
+      else if( !msh__argparse_is_number( token ) )
+      {
+        msh__argparse_set_error( parser, "Unknown argument %s", token );
+        return 0;
+      }
+    }
+
+    // Values that do not follow an option go to the next positional argument. A positional
+    // array stays current, so that all positional values after it are appended to it.
+    if( !arg )
+    {
+      while( next_positional < n_args && parser->args[next_positional].name[0] == '-' ) { next_positional++; }
+      if( next_positional == n_args )
+      {
+        msh__argparse_set_error( parser, "Unexpected value %s", token );
+        return 0;
+      }
+      arg = &parser->args[next_positional];
+      if( !arg->is_array ) { next_positional++; }
+    }
+    arg->n_set++;
+
+    if( is_option && !arg->is_array && arg->num_vals == 0 )
+    {
+      *(bool*)arg->values = true;
+      continue;
+    }
+
+    size_t n_vals = 0;
+    while( t < n_tokens && ( arg->is_array || n_vals < arg->num_vals ) )
+    {
+      token = parser->tokens[t];
+      if( !only_positional && token[0] == '-' && token[1] )
+      {
+        if( msh__argparse_find( parser, token ) >= 0 || !msh__argparse_is_number( token ) ) { break; }
+      }
+      msh__argparse_value_t value;
+      if( !msh__argparse_convert( arg->type, token, &value ) )
+      {
+        msh__argparse_set_error( parser, "Invalid value %s for argument %s, expected %s", token,
+                                 arg->name, msh__argparse_type_names[arg->type] );
+        return 0;
+      }
+      if( arg->is_array ) { msh__argparse_push( arg, &value ); }
+      else                { msh__argparse_store( arg, n_vals, &value ); }
+      n_vals++;
+      t++;
+    }
+    if( ( !arg->is_array && n_vals != arg->num_vals ) || ( arg->is_array && is_option && !n_vals ) )
+    {
+      msh__argparse_set_error( parser, "Wrong number of parameters for argument %s. Correct value is: %s%zu",
+                               arg->name, arg->is_array ? "at least " : "", arg->is_array ? (size_t)1 : arg->num_vals );
+      return 0;
+    }
+  }
+
+  for( size_t i = 0; i < n_args; ++i )
+  {
+    msh_arg_t* arg = &parser->args[i];
+    if( arg->name[0] != '-' && !arg->n_set )
+    {
+      msh__argparse_set_error( parser, "Wrong number of parameters for argument %s. Correct value is: %s%zu",
+                               arg->name, arg->is_array ? "at least " : "", arg->is_array ? (size_t)1 : arg->num_vals );
+      return 0;
+    }
+  }
+  return 1;
+}
+
+MSH_ARGPARSE_DEF const char*
+msh_argparse_error( const msh_argparse_t* parser )
+{
+  return parser->error[0] ? parser->error : NULL;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+// Help
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+static int
+msh__argparse_compare_names( const void* a, const void* b )
+{
+  const msh_arg_t* arg_a = *(const msh_arg_t* const*)a;
+  const msh_arg_t* arg_b = *(const msh_arg_t* const*)b;
+  return strcmp( arg_a->name, arg_b->name );
+}
+
+static void
+msh__argparse_print_arg( const msh_arg_t* arg )
+{
+  char names[64];
+  if( arg->shorthand ) { snprintf( names, sizeof(names), "%s, %s", arg->name, arg->shorthand ); }
+  else                 { snprintf( names, sizeof(names), "%s", arg->name ); }
+  char count[32];
+  if( arg->is_array ) { snprintf( count, sizeof(count), "..." ); }
+  else                { snprintf( count, sizeof(count), "%zu", arg->num_vals ); }
+  printf( "       %-32s - %s <%s %s>\n", names, arg->message ? arg->message : "", count,
+          msh__argparse_type_names[arg->type] );
+}
+
+MSH_ARGPARSE_DEF void
+msh_display_help( const msh_argparse_t* parser )
+{
+  if( parser->error[0] ) { printf( "Argparse Error: %s\n\n", parser->error ); }
+  printf( "%s\n", parser->program_name ? parser->program_name : "" );
+  if( parser->program_description ) { printf( "       %s\n", parser->program_description ); }
+  printf( "\nUsage:\n Required Arguments:\n" );
+  size_t n_args = msh_array_len( parser->args );
+  for( size_t i = 0; i < n_args; ++i )
+  {
+    if( parser->args[i].name[0] != '-' ) { msh__argparse_print_arg( &parser->args[i] ); }
+  }
+
+  const msh_arg_t** optional = (const msh_arg_t**)malloc( ( n_args ? n_args : 1 ) * sizeof(msh_arg_t*) );
+  if( !optional ) { return; }
+  size_t n_optional = 0;
+  for( size_t i = 0; i < n_args; ++i )
+  {
+    if( parser->args[i].name[0] == '-' ) { optional[n_optional++] = &parser->args[i]; }
+  }
+  qsort( optional, n_optional, sizeof(msh_arg_t*), msh__argparse_compare_names );
+  printf( "\n Optional Arguments:\n" );
+  for( size_t i = 0; i < n_optional; ++i ) { msh__argparse_print_arg( optional[i] ); }
+  printf( "\\----------------------------------------------------------------\n" );
+  free( optional );
+}
+
+#endif /* MSH_ARGPARSE_IMPLEMENTATION */
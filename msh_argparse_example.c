@@ -0,0 +1,392 @@
+/*
+  Author: Maciej Halber
+  Date : Oct 18, 2026
+  License: CC0
+
+  Compilation: gcc -std=c99 -O2 -I<path_to_msh_libraries> msh_argparse_example.c -o msh_argparse_example -lm
+  Usage:       msh_argparse_example [filename [--your_name first last] [--lucky_number n] ...] [--bench]
+  Description: This program showcases msh_argparse.h. Run with arguments, it parses them like
+               any program would:
+
+                 msh_argparse_example test.txt --your_name Maciej Halber --lucky_number 13
+
+               prints the values, and without the required filename prints the error and the
+               generated help. Run without arguments, it:
+
+               1) Validates fixed and array arguments, positional values, negative numbers,
+               "--", and the errors for unknown arguments, invalid and missing values.
+
+               2) Validates response files, with quotes, escapes, comments and nesting.
+
+               3) Reports parse time of a 50k token invocation - a file list and per channel
+               values, with a thousand registered options - passed directly and through a
+               response file.
+
+               Program returns non-zero if validation fails. With --bench, the 50k token parses
+               are measured with msh_bench.h instead.
+*/
+
+#define MSH_STD_INCLUDE_HEADERS
+#define MSH_STD_IMPLEMENTATION
+#define MSH_ARGPARSE_IMPLEMENTATION
+#define MSH_BENCH_IMPLEMENTATION
+#include "msh_std.h"
+#include "msh_argparse.h"
+#include "msh_bench.h"
+
+typedef struct options
+{
+  char* filename;
+  int lucky_number;
+  float rectangle_size[2];
+  double cuboid_size[3];
+  char* your_name[2];
+  bool print_verbose;
+} options_t;
+
+int run_demo( int argc, char** argv )
+{
+  options_t opts = {0};
+  msh_argparse_t parser;
+  msh_init_argparse( "Argparse Example Program",
+                     "This program showcases the capabilities of msh_argparse_t", &parser );
+  msh_add_string_argument( "filename", NULL, "Name of a file we need to read", &opts.filename, 1, &parser );
+  msh_add_int_argument( "--lucky_number", "-l", "Your lucky number", &opts.lucky_number, 1, &parser );
+  msh_add_float_argument( "--rectangle_size", "-r", "Size of some rectangle", &opts.rectangle_size[0], 2, &parser );
+  msh_add_double_argument( "--cuboid_size", "-c", "Size of some cuboid", &opts.cuboid_size[0], 3, &parser );
+  msh_add_string_argument( "--your_name", "-n", "Your first and last name", &opts.your_name[0], 2, &parser );
+  msh_add_bool_argument( "--verbose", "-v", "Print verbose information", &opts.print_verbose, 0, &parser );
+
+  if( !msh_parse_arguments( argc, argv, &parser ) )
+  {
+    msh_display_help( &parser );
+    msh_argparse_term( &parser );
+    return 1;
+  }
+
+  printf( "Supplied filename to read: %s\n", opts.filename );
+  if( opts.lucky_number ) { printf( "Your lucky number is %d\n", opts.lucky_number ); }
+  if( opts.rectangle_size[0] && opts.rectangle_size[1] )
+  {
+    printf( "Rectangle size : %fx%f\n", opts.rectangle_size[0], opts.rectangle_size[1] );
+  }
+  if( opts.cuboid_size[0] && opts.cuboid_size[1] && opts.cuboid_size[2] )
+  {
+    printf( "Cuboid size : %fx%fx%f\n", opts.cuboid_size[0], opts.cuboid_size[1], opts.cuboid_size[2] );
+  }
+  if( opts.your_name[0] && opts.your_name[1] ) { printf( "Your name is %s %s\n", opts.your_name[0], opts.your_name[1] ); }
+  if( opts.print_verbose )
+  {
+    printf( "Verbosity requested! Below you can see the auto-generated help message:\n" );
+    msh_display_help( &parser );
+  }
+  msh_argparse_term( &parser );
+  return 0;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+// Validation
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+typedef struct test_args
+{
+  msh_argparse_t parser;
+  options_t opts;
+  msh_array(char*) files;
+  msh_array(float) gains;
+  msh_array(int) ids;
+} test_args_t;
+
+void test_args_init( test_args_t* t )
+{
+  memset( t, 0, sizeof(*t) );
+  options_t* o = &t->opts;
+  msh_argparse_t* p = &t->parser;
+  msh_init_argparse( "test", NULL, p );
+  msh_add_string_array_argument( "files", NULL, "Input files", &t->files, p );
+  msh_add_int_argument( "--lucky_number", "-l", "Lucky number", &o->lucky_number, 1, p );
+  msh_add_float_argument( "--rectangle_size", "-r", "Rectangle", &o->rectangle_size[0], 2, p );
+  msh_add_double_argument( "--cuboid_size", "-c", "Cuboid", &o->cuboid_size[0], 3, p );
+  msh_add_bool_argument( "--verbose", "-v", "Verbose", &o->print_verbose, 0, p );
+  msh_add_float_array_argument( "--gains", "-g", "Gains", &t->gains, p );
+  msh_add_int_array_argument( "--ids", NULL, "Ids", &t->ids, p );
+}
+
+void test_args_term( test_args_t* t )
+{
+  msh_array_free( t->files );
+  msh_array_free( t->gains );
+  msh_array_free( t->ids );
+  msh_argparse_term( &t->parser );
+}
+
+// Parses a command line given as a single string, split on spaces.
+int parse_line( test_args_t* t, const char* line )
+{
+  static char buf[1024];
+  char* argv[64] = { "test" };
+  int argc = 1;
+  snprintf( buf, sizeof(buf), "%s", line );
+  for( char* tok = strtok( buf, " " ); tok && argc < 64; tok = strtok( NULL, " " ) ) { argv[argc++] = tok; }
+  return msh_parse_arguments( argc, argv, &t->parser );
+}
+
+int check( const char* name, int ok )
+{
+  if( !ok ) { printf("  %s: FAILED\n", name ); }
+  return !ok;
+}
+
+int validate_parsing( void )
+{
+  int n_failed = 0;
+  test_args_t t;
+
+  test_args_init( &t );
+  int ok = parse_line( &t, "a.ply -l 13 b.ply --gains 1 -2.5 3e1 --verbose c.ply -r -1 2" );
+  n_failed += check( "mixed arguments", ok && msh_array_len( t.files ) == 3 && !strcmp( t.files[2], "c.ply" ) &&
+                                        t.opts.lucky_number == 13 && t.opts.print_verbose &&
+                                        msh_array_len( t.gains ) == 3 && t.gains[1] == -2.5f && t.gains[2] == 30.0f &&
+                                        t.opts.rectangle_size[0] == -1.0f && t.opts.rectangle_size[1] == 2.0f );
+  test_args_term( &t );
+
+  test_args_init( &t );
+  ok = parse_line( &t, "a.ply --ids 1 2 3 --ids 4 -- --verbose -5" );
+  n_failed += check( "repeated array and --", ok && msh_array_len( t.ids ) == 4 && t.ids[3] == 4 &&
+                                              msh_array_len( t.files ) == 3 && !strcmp( t.files[1], "--verbose" ) &&
+                                              !t.opts.print_verbose );
+  test_args_term( &t );
+
+  static const char* bad_lines[] = { "",                            // missing positional
+                                     "a.ply --unknown 3",           // unknown option
+                                     "a.ply -l",                    // missing value
+                                     "a.ply -l 1.5",                // invalid int
+                                     "a.ply -c 1 2 -v",             // too few values
+                                     "a.ply --gains",               // empty array
+                                     "a.ply --ids 99999999999" };   // out of range
+  for( size_t i = 0; i < sizeof(bad_lines) / sizeof(bad_lines[0]); ++i )
+  {
+    test_args_init( &t );
+    ok = !parse_line( &t, bad_lines[i] ) && msh_argparse_error( &t.parser );
+    if( !ok ) { printf("  '%s' accepted\n", bad_lines[i] ); }
+    n_failed += check( "error reported", ok );
+    test_args_term( &t );
+  }
+
+  test_args_init( &t );
+  ok = !msh_add_int_argument( "--other", "-l", "Duplicate shorthand", &t.opts.lucky_number, 1, &t.parser ) &&
+       !msh_add_bool_argument( "--verbose", NULL, "Duplicate name", &t.opts.print_verbose, 0, &t.parser );
+  n_failed += check( "duplicates rejected", ok );
+  test_args_term( &t );
+
+  // Only bool options may take no values, as nothing else could be written for them.
+  test_args_init( &t );
+  int count = 0x11223344;
+  double size = 0.0;
+  ok = !msh_add_int_argument( "--count", NULL, "No values", &count, 0, &t.parser ) &&
+       !msh_add_double_argument( "size", NULL, "No values", &size, 0, &t.parser ) &&
+       !msh_add_bool_argument( "flag", NULL, "Positional flag", &t.opts.print_verbose, 0, &t.parser ) &&
+       !msh_add_int_argument( "--other", "o", "Shorthand without dash", &count, 1, &t.parser ) &&
+       !parse_line( &t, "a.ply --count" ) && count == 0x11223344;
+  n_failed += check( "invalid definitions rejected", ok );
+  test_args_term( &t );
+  return n_failed;
+}
+
+int write_file( const char* path, const char* content )
+{
+  FILE* fp = fopen( path, "wb" );
+  if( !fp ) { return 0; }
+  fputs( content, fp );
+  fclose( fp );
+  return 1;
+}
+
+int validate_response_files( void )
+{
+  int n_failed = 0;
+  test_args_t t;
+  write_file( "msh_argparse_example_nested.rsp", "\"last file.ply\"\n--ids 7 8" );
+  write_file( "msh_argparse_example.rsp", "# files to process\n"
+                                          "first.ply 'second file.ply' third\\ file.ply\n"
+                                          "\"quoted \\\"name\\\".ply\" @msh_argparse_example_nested.rsp\n"
+                                          "-l 42 --gains 0.5 -0.5   # per channel\n" );
+  test_args_init( &t );
+  int ok = parse_line( &t, "@msh_argparse_example.rsp -v" );
+  n_failed += check( "response file", ok && msh_array_len( t.files ) == 5 &&
+                                      !strcmp( t.files[1], "second file.ply" ) &&
+                                      !strcmp( t.files[2], "third file.ply" ) &&
+                                      !strcmp( t.files[3], "quoted \"name\".ply" ) &&
+                                      !strcmp( t.files[4], "last file.ply" ) &&
+                                      msh_array_len( t.gains ) == 2 && t.gains[1] == -0.5f &&
+                                      msh_array_len( t.ids ) == 2 && t.ids[1] == 8 &&
+                                      t.opts.lucky_number == 42 && t.opts.print_verbose );
+  if( !ok && msh_argparse_error( &t.parser ) ) { printf("  %s\n", msh_argparse_error( &t.parser ) ); }
+  test_args_term( &t );
+
+  test_args_init( &t );
+  n_failed += check( "missing response file", !parse_line( &t, "@msh_argparse_example_missing.rsp" ) );
+  test_args_term( &t );
+
+  write_file( "msh_argparse_example_loop.rsp", "@msh_argparse_example_loop.rsp" );
+  test_args_init( &t );
+  n_failed += check( "nested too deep", !parse_line( &t, "@msh_argparse_example_loop.rsp" ) );
+  test_args_term( &t );
+
+  remove( "msh_argparse_example.rsp" );
+  remove( "msh_argparse_example_nested.rsp" );
+  remove( "msh_argparse_example_loop.rsp" );
+  return n_failed;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+// Large invocations
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+enum { N_FILES = 25000, N_GAINS = 23000, N_OPTIONS = 1000 };
+
+typedef struct large_invocation
+{
+  msh_array(char*) argv;
+  char* strings;
+  const char* rsp_argv[2];
+  int option_values[N_OPTIONS];
+  char option_names[N_OPTIONS][24];
+} large_invocation_t;
+
+// N_FILES file names, N_GAINS values of an array and N_OPTIONS options with a value each -
+// 50k tokens - as argv and as a response file.
+void large_invocation_init( large_invocation_t* inv )
+{
+  memset( inv, 0, sizeof(*inv) );
+  inv->strings = malloc( 64 * ( N_FILES + N_GAINS + 2 * N_OPTIONS ) );
+  char* s = inv->strings;
+  msh_array_push( inv->argv, "test" );
+  for( int i = 0; i < N_FILES; ++i ) { msh_array_push( inv->argv, s ); s += sprintf( s, "scan_%05d.ply", i ) + 1; }
+  msh_array_push( inv->argv, "--gains" );
+  for( int i = 0; i < N_GAINS; ++i ) { msh_array_push( inv->argv, s ); s += sprintf( s, "%.3f", i * 0.001 ) + 1; }
+  for( int i = 0; i < N_OPTIONS; ++i )
+  {
+    snprintf( inv->option_names[i], 24, "--param_%d", i );
+    msh_array_push( inv->argv, inv->option_names[i] );
+    msh_array_push( inv->argv, s ); s += sprintf( s, "%d", i ) + 1;
+  }
+
+  FILE* fp = fopen( "msh_argparse_example_large.rsp", "wb" );
+  for( size_t i = 1; fp && i < msh_array_len( inv->argv ); ++i ) { fprintf( fp, "%s\n", inv->argv[i] ); }
+  if( fp ) { fclose( fp ); }
+  inv->rsp_argv[0] = "test";
+  inv->rsp_argv[1] = "@msh_argparse_example_large.rsp";
+}
+
+void large_invocation_term( large_invocation_t* inv )
+{
+  remove( "msh_argparse_example_large.rsp" );
+  msh_array_free( inv->argv );
+  free( inv->strings );
+}
+
+// Registers arguments and parses, as a program would at startup. Returns number of tokens.
+size_t parse_large( large_invocation_t* inv, int use_response_file, int* ok )
+{
+  msh_argparse_t parser;
+  msh_array(char*) files = NULL;
+  msh_array(float) gains = NULL;
+  msh_init_argparse( "large", NULL, &parser );
+  msh_add_string_array_argument( "files", NULL, "Input files", &files, &parser );
+  msh_add_float_array_argument( "--gains", NULL, "Gains", &gains, &parser );
+  for( int i = 0; i < N_OPTIONS; ++i )
+  {
+    msh_add_int_argument( inv->option_names[i], NULL, "Parameter", &inv->option_values[i], 1, &parser );
+  }
+  if( use_response_file ) { *ok = msh_parse_arguments( 2, (char**)inv->rsp_argv, &parser ); }
+  else                    { *ok = msh_parse_arguments( (int)msh_array_len( inv->argv ), inv->argv, &parser ); }
+  *ok = *ok && msh_array_len( files ) == N_FILES && msh_array_len( gains ) == N_GAINS &&
+        !strcmp( files[N_FILES - 1], "scan_24999.ply" ) && fabsf( gains[N_GAINS - 1] - 22.999f ) < 1e-4f &&
+        inv->option_values[N_OPTIONS - 1] == N_OPTIONS - 1;
+  size_t n_tokens = msh_array_len( parser.tokens );
+  msh_array_free( files );
+  msh_array_free( gains );
+  msh_argparse_term( &parser );
+  return n_tokens;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+// Benchmarks, run with --bench
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void bench_parse_argv( void* data, size_t n_iters )
+{
+  int ok = 0;
+  for( size_t it = 0; it < n_iters; ++it ) { parse_large( data, 0, &ok ); MSH_BENCH_DO_NOT_OPTIMIZE( ok ); }
+}
+
+void bench_parse_response_file( void* data, size_t n_iters )
+{
+  int ok = 0;
+  for( size_t it = 0; it < n_iters; ++it ) { parse_large( data, 1, &ok ); MSH_BENCH_DO_NOT_OPTIMIZE( ok ); }
+}
+
+int run_benchmarks( int argc, char** argv )
+{
+  large_invocation_t* inv = malloc( sizeof(large_invocation_t) );
+  large_invocation_init( inv );
+  double n_tokens = (double)( msh_array_len( inv->argv ) - 1 );
+  msh_bench_t* b = msh_bench_create( argc, argv );
+  msh_bench_add( b, "parse argv, per token", bench_parse_argv, inv, n_tokens );
+  msh_bench_add( b, "parse response file, per token", bench_parse_response_file, inv, n_tokens );
+  int n_regressions = msh_bench_run( b );
+  msh_bench_destroy( b );
+  large_invocation_term( inv );
+  free( inv );
+  return n_regressions ? 1 : 0;
+}
+
+int main( int argc, char** argv )
+{
+  if( msh_bench_requested( argc, argv ) ) { return run_benchmarks( argc, argv ); }
+  if( argc > 1 ) { return run_demo( argc, argv ); }
+  int n_failed = 0;
+
+  //----------------------------------------------------------------------------------------------
+  printf("Parsing:\n");
+  {
+    n_failed += validate_parsing();
+  }
+
+  //----------------------------------------------------------------------------------------------
+  printf("Response files:\n");
+  {
+    n_failed += validate_response_files();
+  }
+
+  //----------------------------------------------------------------------------------------------
+  printf("Large invocations:\n");
+  {
+    large_invocation_t* inv = malloc( sizeof(large_invocation_t) );
+    large_invocation_init( inv );
+    for( int use_response_file = 0; use_response_file < 2; ++use_response_file )
+    {
+      int ok = 0;
+      size_t n_tokens = 0;
+      double best_ms = 1e9;
+      for( int r = 0; r < 5; ++r )
+      {
+        uint64_t t1 = msh_time_now();
+        n_tokens = parse_large( inv, use_response_file, &ok );
+        uint64_t t2 = msh_time_now();
+        best_ms = msh_min( best_ms, msh_time_diff( MSHT_MILLISECONDS, t2, t1 ) );
+        if( !ok ) { break; }
+      }
+      printf("  %zu tokens, %d registered options, %-14s %8.3f ms\n", n_tokens, N_OPTIONS + 2,
+             use_response_file ? "response file:" : "argv:", best_ms );
+      n_failed += check( "large invocation", ok && n_tokens == msh_array_len( inv->argv ) - 1 );
+      n_failed += check( "parse time", best_ms < 250.0 );
+    }
+    large_invocation_term( inv );
+    free( inv );
+  }
+
+  printf("%d failed\n", n_failed );
+  return n_failed ? 1 : 0;
+}
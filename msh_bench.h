@@ -0,0 +1,514 @@
+/*
+  ==============================================================================
+
+  MSH_BENCH.H v0.1
+
+  A single header library for microbenchmarks that give repeatable numbers:
+
+    - iteration counts calibrated so that every trial runs for a set minimum time
+    - warm up trials, thread pinned to a single CPU (Linux)
+    - repeated trials with median absolute deviation outlier rejection
+    - ns per operation with a 95% confidence interval
+    - comparison with a baseline saved by an earlier run
+
+  To use the library you simply add:
+
+  #include "msh_std.h"
+  #define MSH_BENCH_IMPLEMENTATION
+  #include "msh_bench.h"
+
+  ==============================================================================
+  DOCUMENTATION
+
+  Benchmarks
+    void bench_sum( void* data, size_t n_iters )
+    {
+      for( size_t i = 0; i < n_iters; ++i )
+      {
+        float s = sum( (const float*)data, 1024 );
+        MSH_BENCH_DO_NOT_OPTIMIZE( s );
+      }
+    }
+
+    A benchmark runs its operation n_iters times. MSH_BENCH_DO_NOT_OPTIMIZE( value ) keeps a
+    value alive, so that the compiler cannot remove the computation of it, and
+    MSH_BENCH_CLOBBER() forces memory writes to be completed, e.g. after writing to an output
+    array.
+
+  Running
+    if( msh_bench_requested( argc, argv ) )
+    {
+      msh_bench_t* b = msh_bench_create( argc, argv );
+      msh_bench_add( b, "sum 1024", bench_sum, data, 1024 );
+      int n_regressions = msh_bench_run( b );
+      msh_bench_destroy( b );
+      return n_regressions ? 1 : 0;
+    }
+
+    msh_bench_requested checks for --bench on the command line. msh_bench_add registers a
+    benchmark, with the number of operations a single iteration performs, so that results
+    are per element rather than per call. msh_bench_run runs all benchmarks and prints a
+    table. It returns the number of significant regressions against the baseline.
+
+    Programs that print their own reports can instead time one benchmark at a time:
+      msh_bench_result_t r;
+      msh_bench_measure( b, "sum 1024", bench_sum, data, 1024, &r );
+    which prints nothing and does not use the filter or the baseline.
+
+    For each benchmark, the iteration count is doubled until a trial takes a tenth of
+    min_trial_ms, then scaled to take min_trial_ms. After warm up trials, n_trials trials are
+    timed. Trials further than 3 scaled median absolute deviations from the median are
+    rejected as outliers (interrupts, frequency changes). The mean of the rest is reported
+    with a 95% confidence interval from Student's t distribution. Median and 10th/90th
+    percentiles are taken over all trials.
+
+    Command line options:
+      --bench                   run benchmarks
+      --bench-filter=<text>     only run benchmarks whose names contain text
+      --bench-trials=<n>        number of timed trials (default 20)
+      --bench-min-ms=<ms>       minimum time of a trial (default 10)
+      --bench-cpu=<i>           CPU to pin to (default: CPU the program starts on, -1 to not pin)
+      --bench-save=<file>       save results as a baseline
+      --bench-baseline=<file>   compare with a baseline saved before
+      --bench-threshold=<pct>   smallest slowdown reported as a regression (default 5)
+
+    A benchmark is a regression if it is slower than its baseline by more than the threshold
+    and the confidence intervals do not overlap. Baselines are text files, with one line of
+    mean ns, confidence interval ns and name per benchmark.
+
+    When msh_perf.h is included before msh_bench.h, msh_bench_run also runs one more trial of
+    each benchmark with hardware counters and prints cache misses, branch misses and
+    instructions per operation under the table.
+
+    Pinning uses sched_setaffinity, which is only available when compiling with _GNU_SOURCE
+    defined; otherwise the report notes that the thread is not pinned. The calling thread is
+    pinned only while benchmarks run, so threads it creates outside of them are not pinned.
+
+  ==============================================================================
+  AUTHORS:
+    Maciej Halber
+
+  LICENSE:
+    CC0
+  ==============================================================================
+*/
+
+#ifndef MSH_BENCH_H
+#define MSH_BENCH_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#ifndef MSH_BENCH_DEF
+#ifdef MSH_BENCH_STATIC
+#define MSH_BENCH_DEF static
+#else
+#define MSH_BENCH_DEF extern
+#endif
+#endif
+
+#if defined(__GNUC__) || defined(__clang__)
+#define MSH_BENCH_DO_NOT_OPTIMIZE( v ) __asm__ __volatile__( "" : : "r,m"( v ) : "memory" )
+#define MSH_BENCH_CLOBBER()            __asm__ __volatile__( "" : : : "memory" )
+#else
+#define MSH_BENCH_DO_NOT_OPTIMIZE( v ) msh__bench_sink( &(v) )
+#define MSH_BENCH_CLOBBER()            msh__bench_sink( NULL )
+MSH_BENCH_DEF void msh__bench_sink( const void* p );
+#endif
+
+typedef void (*msh_bench_fn_t)( void* data, size_t n_iters );
+
+typedef struct msh_bench_result
+{
+  const char* name;
+  double ns_per_op;         // mean of trials left after outlier rejection
+  double ci_ns;             // half width of the 95% confidence interval
+  double median_ns;
+  double p10_ns;            // 10th and 90th percentile of all trials
+  double p90_ns;
+  double min_ns;
+  size_t n_iters;           // iterations per trial
+  int n_trials;
+  int n_outliers;
+  int has_baseline;
+  double baseline_ns;
+  double baseline_ci_ns;
+  int is_regression;
+} msh_bench_result_t;
+
+typedef struct msh_bench msh_bench_t;
+
+MSH_BENCH_DEF int          msh_bench_requested( int argc, char** argv );
+MSH_BENCH_DEF msh_bench_t* msh_bench_create( int argc, char** argv );
+MSH_BENCH_DEF void         msh_bench_destroy( msh_bench_t* b );
+
+MSH_BENCH_DEF void msh_bench_add( msh_bench_t* b, const char* name, msh_bench_fn_t fn, void* data,
+                                  double ops_per_iter );
+MSH_BENCH_DEF int  msh_bench_run( msh_bench_t* b );
+MSH_BENCH_DEF void msh_bench_measure( msh_bench_t* b, const char* name, msh_bench_fn_t fn, void* data,
+                                      double ops_per_iter, msh_bench_result_t* result );
+MSH_BENCH_DEF const msh_bench_result_t* msh_bench_get_results( const msh_bench_t* b, size_t* n_results );
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* MSH_BENCH_H */
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+// IMPLEMENTATION
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+#ifdef MSH_BENCH_IMPLEMENTATION
+
+#include <math.h>
+
+#ifdef __linux__
+#include <sched.h>
+#endif
+
+typedef struct msh__bench_entry
+{
+  const char* name;
+  msh_bench_fn_t fn;
+  void* data;
+  double ops_per_iter;
+} msh__bench_entry_t;
+
+struct msh_bench
+{
+  int n_trials;
+  int n_warmup;
+  double min_trial_ms;
+  int cpu;
+  double threshold;
+  const char* filter;
+  const char* save_file;
+  const char* baseline_file;
+
+  msh_array(msh__bench_entry_t) entries;
+  msh_array(msh_bench_result_t) results;
+#ifdef MSH_PERF_H
+  msh_array(msh_perf_counters_t) counters;
+  msh_array(double) counter_ops;
+#endif
+
+#if defined(__linux__) && defined(CPU_SET)
+  cpu_set_t prev_affinity;
+#endif
+};
+
+#if !defined(__GNUC__) && !defined(__clang__)
+static volatile const void* msh__bench_sink_ptr;
+MSH_BENCH_DEF void msh__bench_sink( const void* p ) { msh__bench_sink_ptr = p; }
+#endif
+
+MSH_BENCH_DEF int
+msh_bench_requested( int argc, char** argv )
+{
+  for( int i = 1; i < argc; ++i ) { if( !strcmp( argv[i], "--bench" ) ) { return 1; } }
+  return 0;
+}
+
+static const char*
+msh__bench_option( const char* arg, const char* name )
+{
+  size_t len = strlen( name );
+  return !strncmp( arg, name, len ) && arg[len] == '=' ? arg + len + 1 : NULL;
+}
+
+MSH_BENCH_DEF msh_bench_t*
+msh_bench_create( int argc, char** argv )
+{
+  msh_bench_t* b = calloc( 1, sizeof(msh_bench_t) );
+  b->n_trials = 20;
+  b->n_warmup = 2;
+  b->min_trial_ms = 10.0;
+  b->threshold = 5.0;
+  b->cpu = -2;   // CPU the program runs on
+  for( int i = 1; i < argc; ++i )
+  {
+    const char* v;
+    if( ( v = msh__bench_option( argv[i], "--bench-filter" ) ) )    { b->filter = v; }
+    if( ( v = msh__bench_option( argv[i], "--bench-trials" ) ) )    { b->n_trials = msh_max( 3, atoi( v ) ); }
+    if( ( v = msh__bench_option( argv[i], "--bench-min-ms" ) ) )    { b->min_trial_ms = msh_max( 0.01, atof( v ) ); }
+    if( ( v = msh__bench_option( argv[i], "--bench-cpu" ) ) )       { b->cpu = atoi( v ); }
+    if( ( v = msh__bench_option( argv[i], "--bench-save" ) ) )      { b->save_file = v; }
+    if( ( v = msh__bench_option( argv[i], "--bench-baseline" ) ) )  { b->baseline_file = v; }
+    if( ( v = msh__bench_option( argv[i], "--bench-threshold" ) ) ) { b->threshold = atof( v ); }
+  }
+  return b;
+}
+
+MSH_BENCH_DEF void
+msh_bench_destroy( msh_bench_t* b )
+{
+  if( !b ) { return; }
+  msh_array_free( b->entries );
+  msh_array_free( b->results );
+#ifdef MSH_PERF_H
+  msh_array_free( b->counters );
+  msh_array_free( b->counter_ops );
+#endif
+  free( b );
+}
+
+MSH_BENCH_DEF void
+msh_bench_add( msh_bench_t* b, const char* name, msh_bench_fn_t fn, void* data, double ops_per_iter )
+{
+  msh__bench_entry_t e = { name, fn, data, ops_per_iter > 0.0 ? ops_per_iter : 1.0 };
+  msh_array_push( b->entries, e );
+}
+
+MSH_BENCH_DEF const msh_bench_result_t*
+msh_bench_get_results( const msh_bench_t* b, size_t* n_results )
+{
+  *n_results = msh_array_len( b->results );
+  return b->results;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+// Running
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+// Returns the CPU the thread got pinned to, or -1. Previous affinity is restored by msh__bench_unpin.
+static int
+msh__bench_pin( msh_bench_t* b )
+{
+#if defined(__linux__) && defined(CPU_SET)
+  int cpu = b->cpu;
+  if( cpu == -1 ) { return -1; }
+  if( cpu < 0 ) { cpu = sched_getcpu(); }
+  if( cpu < 0 || sched_getaffinity( 0, sizeof(b->prev_affinity), &b->prev_affinity ) ) { return -1; }
+  cpu_set_t set;
+  CPU_ZERO( &set );
+  CPU_SET( cpu, &set );
+  return sched_setaffinity( 0, sizeof(set), &set ) == 0 ? cpu : -1;
+#else
+  (void)b;
+  return -1;
+#endif
+}
+
+static void
+msh__bench_unpin( msh_bench_t* b, int cpu )
+{
+#if defined(__linux__) && defined(CPU_SET)
+  if( cpu >= 0 ) { sched_setaffinity( 0, sizeof(b->prev_affinity), &b->prev_affinity ); }
+#else
+  (void)b; (void)cpu;
+#endif
+}
+
+static double
+msh__bench_trial_ns( const msh__bench_entry_t* e, size_t n_iters )
+{
+  uint64_t t1 = msh_time_now();
+  e->fn( e->data, n_iters );
+  uint64_t t2 = msh_time_now();
+  return msh_time_diff( MSHT_NANOSECONDS, t2, t1 );
+}
+
+static int
+msh__bench_cmp_double( const void* a, const void* b )
+{
+  double x = *(const double*)a, y = *(const double*)b;
+  return ( x > y ) - ( x < y );
+}
+
+// Two-sided 97.5% quantile of Student's t distribution for df degrees of freedom.
+static double
+msh__bench_t975( int df )
+{
+  static const double table[] = { 12.706, 4.303, 3.182, 2.776, 2.571, 2.447, 2.365, 2.306, 2.262, 2.228,
+                                  2.201, 2.179, 2.160, 2.145, 2.131, 2.120, 2.110, 2.101, 2.093, 2.086,
+                                  2.080, 2.074, 2.069, 2.064, 2.060, 2.056, 2.052, 2.048, 2.045, 2.042 };
+  if( df < 1 ) { return table[0]; }
+  if( df <= 30 ) { return table[df - 1]; }
+  return df <= 60 ? 2.00 : 1.96;
+}
+
+static void
+msh__bench_measure( const msh_bench_t* b, const msh__bench_entry_t* e, msh_bench_result_t* r )
+{
+  // Calibrate, doubling until a trial is long enough to be scaled reliably.
+  double target_ns = b->min_trial_ms * 1e6;
+  size_t n_iters = 1;
+  double ns = msh__bench_trial_ns( e, n_iters );
+  while( ns < 0.1 * target_ns && n_iters < ( (size_t)1 << 40 ) )
+  {
+    n_iters *= 2;
+    ns = msh__bench_trial_ns( e, n_iters );
+  }
+  if( ns < target_ns ) { n_iters = (size_t)ceil( n_iters * target_ns / msh_max( ns, 1.0 ) ); }
+
+  for( int i = 0; i < b->n_warmup; ++i ) { msh__bench_trial_ns( e, n_iters ); }
+
+  int n = b->n_trials;
+  double* per_op = malloc( 2 * n * sizeof(double) );
+  double* sorted = per_op + n;
+  double ops = (double)n_iters * e->ops_per_iter;
+  for( int i = 0; i < n; ++i ) { per_op[i] = msh__bench_trial_ns( e, n_iters ) / ops; }
+
+  memcpy( sorted, per_op, n * sizeof(double) );
+  qsort( sorted, n, sizeof(double), msh__bench_cmp_double );
+  double median = sorted[n / 2];
+  double p10 = sorted[( n - 1 ) / 10];
+  double p90 = sorted[( n - 1 ) * 9 / 10];
+  for( int i = 0; i < n; ++i ) { sorted[i] = fabs( sorted[i] - median ); }
+  qsort( sorted, n, sizeof(double), msh__bench_cmp_double );
+  double mad = 1.4826 * sorted[n / 2];
+
+  // Outliers are rejected only when the spread is measurable, otherwise all trials are kept.
+  double sum = 0.0, sum_sq = 0.0, min = per_op[0];
+  int n_kept = 0;
+  for( int i = 0; i < n; ++i )
+  {
+    min = msh_min( min, per_op[i] );
+    if( mad > 0.0 && fabs( per_op[i] - median ) > 3.0 * mad ) { continue; }
+    sum += per_op[i];
+    sum_sq += per_op[i] * per_op[i];
+    n_kept++;
+  }
+  double mean = sum / n_kept;
+  double var = n_kept > 1 ? msh_max( 0.0, ( sum_sq - n_kept * mean * mean ) / ( n_kept - 1 ) ) : 0.0;
+
+  r->name       = e->name;
+  r->ns_per_op  = mean;
+  r->ci_ns      = msh__bench_t975( n_kept - 1 ) * sqrt( var / n_kept );
+  r->median_ns  = median;
+  r->p10_ns     = p10;
+  r->p90_ns     = p90;
+  r->min_ns     = min;
+  r->n_iters    = n_iters;
+  r->n_trials   = n;
+  r->n_outliers = n - n_kept;
+  free( per_op );
+}
+
+static void
+msh__bench_read_baseline( msh_bench_t* b )
+{
+  FILE* fp = fopen( b->baseline_file, "r" );
+  if( !fp ) { printf("Could not read baseline %s\n", b->baseline_file ); return; }
+  char line[512];
+  while( fgets( line, sizeof(line), fp ) )
+  {
+    double mean, ci;
+    int name_start = 0;
+    if( sscanf( line, "%lf %lf %n", &mean, &ci, &name_start ) < 2 || !name_start ) { continue; }
+    char* name = line + name_start;
+    name[strcspn( name, "\r\n" )] = 0;
+    for( size_t i = 0; i < msh_array_len( b->results ); ++i )
+    {
+      msh_bench_result_t* r = &b->results[i];
+      if( strcmp( r->name, name ) ) { continue; }
+      r->has_baseline = 1;
+      r->baseline_ns = mean;
+      r->baseline_ci_ns = ci;
+      r->is_regression = r->ns_per_op > mean * ( 1.0 + 0.01 * b->threshold ) &&
+                         r->ns_per_op - r->ci_ns > mean + ci;
+    }
+  }
+  fclose( fp );
+}
+
+static void
+msh__bench_format_ns( char* buf, size_t size, double ns )
+{
+  if( ns < 1e3 )      { snprintf( buf, size, "%.3f ns", ns ); }
+  else if( ns < 1e6 ) { snprintf( buf, size, "%.3f us", ns * 1e-3 ); }
+  else                { snprintf( buf, size, "%.3f ms", ns * 1e-6 ); }
+}
+
+MSH_BENCH_DEF int
+msh_bench_run( msh_bench_t* b )
+{
+  int cpu = msh__bench_pin( b );
+  if( cpu >= 0 ) { printf("Benchmarks (pinned to CPU %d, %d trials of at least %g ms):\n", cpu, b->n_trials, b->min_trial_ms ); }
+  else           { printf("Benchmarks (not pinned, %d trials of at least %g ms):\n", b->n_trials, b->min_trial_ms ); }
+  printf("  %-36s %14s %10s %14s %10s %8s\n", "", "per op", "+-95%", "median", "outliers", "vs base" );
+
+  msh_array_clear( b->results );
+#ifdef MSH_PERF_H
+  msh_perf_t* perf = msh_perf_create();
+  msh_array_clear( b->counters );
+  msh_array_clear( b->counter_ops );
+#endif
+  for( size_t i = 0; i < msh_array_len( b->entries ); ++i )
+  {
+    const msh__bench_entry_t* e = &b->entries[i];
+    if( b->filter && !strstr( e->name, b->filter ) ) { continue; }
+    msh_bench_result_t r = {0};
+    msh__bench_measure( b, e, &r );
+    msh_array_push( b->results, r );
+#ifdef MSH_PERF_H
+    msh_perf_counters_t c = {0};
+    if( msh_perf_available( perf ) ) { MSH_PERF_SCOPE( perf, &c ) { e->fn( e->data, r.n_iters ); } }
+    msh_array_push( b->counters, c );
+    msh_array_push( b->counter_ops, r.n_iters * e->ops_per_iter );
+#endif
+  }
+  msh__bench_unpin( b, cpu );
+  if( b->baseline_file ) { msh__bench_read_baseline( b ); }
+
+  int n_regressions = 0;
+  for( size_t i = 0; i < msh_array_len( b->results ); ++i )
+  {
+    const msh_bench_result_t* r = &b->results[i];
+    char mean[32], median[32], diff[32] = "";
+    msh__bench_format_ns( mean, sizeof(mean), r->ns_per_op );
+    msh__bench_format_ns( median, sizeof(median), r->median_ns );
+    if( r->has_baseline ) { snprintf( diff, sizeof(diff), "%+.1f%%", 100.0 * ( r->ns_per_op / r->baseline_ns - 1.0 ) ); }
+    printf("  %-36s %14s %9.1f%% %14s %7d/%-2d %8s%s\n", r->name, mean, 100.0 * r->ci_ns / r->ns_per_op, median,
+           r->n_outliers, r->n_trials, diff, r->is_regression ? " REGRESSION" : "" );
+    n_regressions += r->is_regression;
+  }
+
+#ifdef MSH_PERF_H
+  if( msh_perf_available( perf ) )
+  {
+    printf("Counters per op (one more trial):\n");
+    for( size_t i = 0; i < msh_array_len( b->results ); ++i )
+    {
+      msh_perf_print( stdout, b->results[i].name, &b->counters[i], b->counter_ops[i], "op" );
+    }
+  }
+  if( msh_perf_error( perf ) ) { printf("Some hardware counters are not available: %s\n", msh_perf_error( perf ) ); }
+  msh_perf_destroy( perf );
+#endif
+
+  if( b->save_file )
+  {
+    FILE* fp = fopen( b->save_file, "w" );
+    if( fp )
+    {
+      for( size_t i = 0; i < msh_array_len( b->results ); ++i )
+      {
+        fprintf( fp, "%.6g %.6g %s\n", b->results[i].ns_per_op, b->results[i].ci_ns, b->results[i].name );
+      }
+      fclose( fp );
+      printf("Baseline saved to %s\n", b->save_file );
+    }
+    else { printf("Could not write baseline %s\n", b->save_file ); }
+  }
+  return n_regressions;
+}
+
+MSH_BENCH_DEF void
+msh_bench_measure( msh_bench_t* b, const char* name, msh_bench_fn_t fn, void* data, double ops_per_iter,
+                   msh_bench_result_t* result )
+{
+  msh__bench_entry_t e = { name, fn, data, ops_per_iter > 0.0 ? ops_per_iter : 1.0 };
+  msh_bench_result_t r = {0};
+  int cpu = msh__bench_pin( b );
+  msh__bench_measure( b, &e, &r );
+  msh__bench_unpin( b, cpu );
+  *result = r;
+}
+
+#endif /* MSH_BENCH_IMPLEMENTATION */
@@ -0,0 +1,416 @@
+/*
+  ==============================================================================
+
+  MSH_CULL.H v0.1
+
+  A single header library for CPU side visibility of many objects, without any graphics API:
+
+    - frustum plane extraction from view and projection matrices (e.g. msh_camera_t's view
+      and msh_perspective)
+    - culling of bounding spheres and axis aligned boxes against a frustum, 8 per iteration
+    - level of detail selection by distance from the eye
+
+  To use the library you simply add:
+
+  #include "msh_vec_math.h"
+  #define MSH_CULL_IMPLEMENTATION
+  #include "msh_cull.h"
+
+  msh_vec_math.h needs to be included first, as it defines the matrix types.
+
+  ==============================================================================
+  DOCUMENTATION
+
+  Frustum
+    msh_frustum_t frustum;
+    msh_frustum_init( &frustum, &camera.view, &projection );
+
+    Extracts the six planes of the frustum from the rows of projection * view (Gribb and
+    Hartmann, "Fast Extraction of Viewing Frustum Planes from the World-View-Projection
+    Matrix"), normalized so that plane equations give signed distances in world units, with
+    positive values inside. The eye position is recovered from the view matrix for level of
+    detail selection. msh_frustum_from_matrix does the same from a single view-projection
+    matrix, which leaves the eye at the origin.
+
+  Culling
+    msh_spheres_soa_t spheres = { xs, ys, zs, radii };
+    size_t n_visible = msh_frustum_cull_spheres( &frustum, &spheres, n, visible );
+
+    msh_aabbs_soa_t boxes = { min_xs, min_ys, min_zs, max_xs, max_ys, max_zs };
+    size_t n_visible = msh_frustum_cull_aabbs( &frustum, &boxes, n, visible );
+
+    Writes the indices of objects that intersect or are inside the frustum to 'visible' (which
+    needs room for n indices, in increasing order) and returns their number. Objects are given
+    in SoA layout, one array per coordinate, so that 8 of them (AVX2, -mavx2) or 4 (SSE2) are
+    tested against a plane with a few vector instructions. Indices are appended without
+    branches. Define MSH_CULL_NO_SIMD to use the scalar code paths.
+
+    Tests are conservative: an object is culled only if it is entirely behind one plane, so
+    some large objects near the frustum corners are kept even if they are not visible.
+
+  Level of detail
+    float distances[] = { 10.0f, 50.0f, 200.0f };
+    msh_frustum_select_lod( &frustum, &spheres, visible, n_visible, distances, 3, lods );
+
+    For each object listed in 'visible' (or every object if it is NULL), computes the distance
+    from the eye to the sphere surface and writes the number of thresholds in 'distances'
+    (ascending) that it reaches to lods[i], i.e. 0 for the finest level. With AVX2, spheres
+    listed in 'visible' are fetched with gathers.
+
+  ==============================================================================
+  AUTHORS:
+    Maciej Halber
+
+  LICENSE:
+    CC0
+  ==============================================================================
+*/
+
+#ifndef MSH_CULL_H
+#define MSH_CULL_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#ifndef MSH_CULL_DEF
+#ifdef MSH_CULL_STATIC
+#define MSH_CULL_DEF static
+#else
+#define MSH_CULL_DEF extern
+#endif
+#endif
+
+typedef struct msh_frustum
+{
+  float nx[6], ny[6], nz[6], d[6];   // left, right, bottom, top, near, far
+  float eye[3];
+} msh_frustum_t;
+
+typedef struct msh_spheres_soa
+{
+  const float* x;
+  const float* y;
+  const float* z;
+  const float* radius;
+} msh_spheres_soa_t;
+
+typedef struct msh_aabbs_soa
+{
+  const float* min_x;
+  const float* min_y;
+  const float* min_z;
+  const float* max_x;
+  const float* max_y;
+  const float* max_z;
+} msh_aabbs_soa_t;
+
+MSH_CULL_DEF void msh_frustum_init( msh_frustum_t* f, const msh_mat4_t* view, const msh_mat4_t* proj );
+MSH_CULL_DEF void msh_frustum_from_matrix( msh_frustum_t* f, const msh_mat4_t* view_proj );
+
+MSH_CULL_DEF size_t msh_frustum_cull_spheres( const msh_frustum_t* f, const msh_spheres_soa_t* spheres,
+                                              size_t n, uint32_t* visible );
+MSH_CULL_DEF size_t msh_frustum_cull_aabbs( const msh_frustum_t* f, const msh_aabbs_soa_t* boxes,
+                                            size_t n, uint32_t* visible );
+MSH_CULL_DEF void msh_frustum_select_lod( const msh_frustum_t* f, const msh_spheres_soa_t* spheres,
+                                          const uint32_t* visible, size_t n,
+                                          const float* distances, int n_distances, uint8_t* lods );
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* MSH_CULL_H */
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+// IMPLEMENTATION
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+#ifdef MSH_CULL_IMPLEMENTATION
+
+#include <math.h>
+
+#if !defined(MSH_CULL_NO_SIMD) && (defined(__SSE2__) || defined(_M_X64))
+#define MSH__CULL_SSE2 1
+#include <emmintrin.h>
+#if defined(__AVX2__)
+#define MSH__CULL_AVX2 1
+#include <immintrin.h>
+#endif
+#endif
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+// Frustum
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+MSH_CULL_DEF void
+msh_frustum_from_matrix( msh_frustum_t* f, const msh_mat4_t* view_proj )
+{
+  // Rows of the column major matrix; plane i is row 3 +/- row i / 2.
+  const float* m = view_proj->data;
+  float rows[4][4];
+  for( int i = 0; i < 4; ++i )
+  {
+    for( int j = 0; j < 4; ++j ) { rows[i][j] = m[j * 4 + i]; }
+  }
+  for( int p = 0; p < 6; ++p )
+  {
+    float sign = ( p & 1 ) ? -1.0f : 1.0f;
+    const float* r = rows[p / 2];
+    float a = rows[3][0] + sign * r[0];
+    float b = rows[3][1] + sign * r[1];
+    float c = rows[3][2] + sign * r[2];
+    float d = rows[3][3] + sign * r[3];
+    float inv_len = 1.0f / sqrtf( a * a + b * b + c * c );
+    f->nx[p] = a * inv_len;
+    f->ny[p] = b * inv_len;
+    f->nz[p] = c * inv_len;
+    f->d[p] = d * inv_len;
+  }
+  f->eye[0] = f->eye[1] = f->eye[2] = 0.0f;
+}
+
+MSH_CULL_DEF void
+msh_frustum_init( msh_frustum_t* f, const msh_mat4_t* view, const msh_mat4_t* proj )
+{
+  msh_mat4_t view_proj;
+  for( int j = 0; j < 4; ++j )
+  {
+    for( int i = 0; i < 4; ++i )
+    {
+      float acc = 0.0f;
+      for( int k = 0; k < 4; ++k ) { acc += proj->data[k * 4 + i] * view->data[j * 4 + k]; }
+      view_proj.data[j * 4 + i] = acc;
+    }
+  }
+  msh_frustum_from_matrix( f, &view_proj );
+
+  // View is a rigid transform [R | t], so the eye is at -R^T t.
+  const float* v = view->data;
+  for( int i = 0; i < 3; ++i )
+  {
+    f->eye[i] = -( v[i * 4 + 0] * v[12] + v[i * 4 + 1] * v[13] + v[i * 4 + 2] * v[14] );
+  }
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+// Culling
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+static inline int
+msh__cull_sphere1( const msh_frustum_t* f, float x, float y, float z, float r )
+{
+  // No early out; which plane rejects an object is unpredictable, so branches cost more than
+  // testing all six.
+  int outside = 0;
+  for( int p = 0; p < 6; ++p ) { outside |= f->nx[p] * x + f->ny[p] * y + f->nz[p] * z + f->d[p] < -r; }
+  return !outside;
+}
+
+// Box is outside if its corner furthest along the plane normal is behind the plane. Center and
+// half extents give that corner's distance as dot(n, c) + d + dot(|n|, e).
+static inline int
+msh__cull_aabb1( const msh_frustum_t* f, const msh_aabbs_soa_t* b, size_t i )
+{
+  float cx = 0.5f * ( b->max_x[i] + b->min_x[i] ), ex = 0.5f * ( b->max_x[i] - b->min_x[i] );
+  float cy = 0.5f * ( b->max_y[i] + b->min_y[i] ), ey = 0.5f * ( b->max_y[i] - b->min_y[i] );
+  float cz = 0.5f * ( b->max_z[i] + b->min_z[i] ), ez = 0.5f * ( b->max_z[i] - b->min_z[i] );
+  int outside = 0;
+  for( int p = 0; p < 6; ++p )
+  {
+    float dist = f->nx[p] * cx + f->ny[p] * cy + f->nz[p] * cz + f->d[p];
+    float radius = fabsf( f->nx[p] ) * ex + fabsf( f->ny[p] ) * ey + fabsf( f->nz[p] ) * ez;
+    outside |= dist < -radius;
+  }
+  return !outside;
+}
+
+// Appends indices base + k whose bit k is set in 'mask'. Every lane is stored, but the output only
+// advances for set ones.
+static inline size_t
+msh__cull_append( uint32_t* visible, size_t count, uint32_t base, int mask, int n_lanes )
+{
+  for( int k = 0; k < n_lanes; ++k )
+  {
+    visible[count] = base + k;
+    count += ( mask >> k ) & 1;
+  }
+  return count;
+}
+
+MSH_CULL_DEF size_t
+msh_frustum_cull_spheres( const msh_frustum_t* f, const msh_spheres_soa_t* s, size_t n,
+                          uint32_t* visible )
+{
+  size_t i = 0, count = 0;
+#if MSH__CULL_AVX2
+  for( ; i + 8 <= n; i += 8 )
+  {
+    __m256 x = _mm256_loadu_ps( s->x + i ), y = _mm256_loadu_ps( s->y + i );
+    __m256 z = _mm256_loadu_ps( s->z + i );
+    __m256 neg_r = _mm256_sub_ps( _mm256_setzero_ps(), _mm256_loadu_ps( s->radius + i ) );
+    __m256 outside = _mm256_setzero_ps();
+    for( int p = 0; p < 6; ++p )
+    {
+      __m256 dist = _mm256_add_ps( _mm256_add_ps( _mm256_mul_ps( _mm256_set1_ps( f->nx[p] ), x ),
+                                                  _mm256_mul_ps( _mm256_set1_ps( f->ny[p] ), y ) ),
+                                   _mm256_add_ps( _mm256_mul_ps( _mm256_set1_ps( f->nz[p] ), z ),
+                                                  _mm256_set1_ps( f->d[p] ) ) );
+      outside = _mm256_or_ps( outside, _mm256_cmp_ps( dist, neg_r, _CMP_LT_OQ ) );
+    }
+    count = msh__cull_append( visible, count, (uint32_t)i, ~_mm256_movemask_ps( outside ) & 0xFF, 8 );
+  }
+#elif MSH__CULL_SSE2
+  for( ; i + 4 <= n; i += 4 )
+  {
+    __m128 x = _mm_loadu_ps( s->x + i ), y = _mm_loadu_ps( s->y + i ), z = _mm_loadu_ps( s->z + i );
+    __m128 neg_r = _mm_sub_ps( _mm_setzero_ps(), _mm_loadu_ps( s->radius + i ) );
+    __m128 outside = _mm_setzero_ps();
+    for( int p = 0; p < 6; ++p )
+    {
+      __m128 dist = _mm_add_ps( _mm_add_ps( _mm_mul_ps( _mm_set1_ps( f->nx[p] ), x ),
+                                            _mm_mul_ps( _mm_set1_ps( f->ny[p] ), y ) ),
+                                _mm_add_ps( _mm_mul_ps( _mm_set1_ps( f->nz[p] ), z ),
+                                            _mm_set1_ps( f->d[p] ) ) );
+      outside = _mm_or_ps( outside, _mm_cmplt_ps( dist, neg_r ) );
+    }
+    count = msh__cull_append( visible, count, (uint32_t)i, ~_mm_movemask_ps( outside ) & 0xF, 4 );
+  }
+#endif
+  for( ; i < n; ++i )
+  {
+    visible[count] = (uint32_t)i;
+    count += msh__cull_sphere1( f, s->x[i], s->y[i], s->z[i], s->radius[i] );
+  }
+  return count;
+}
+
+MSH_CULL_DEF size_t
+msh_frustum_cull_aabbs( const msh_frustum_t* f, const msh_aabbs_soa_t* b, size_t n,
+                        uint32_t* visible )
+{
+  size_t i = 0, count = 0;
+#if MSH__CULL_AVX2
+  __m256 half = _mm256_set1_ps( 0.5f );
+  for( ; i + 8 <= n; i += 8 )
+  {
+    __m256 min_x = _mm256_loadu_ps( b->min_x + i ), max_x = _mm256_loadu_ps( b->max_x + i );
+    __m256 min_y = _mm256_loadu_ps( b->min_y + i ), max_y = _mm256_loadu_ps( b->max_y + i );
+    __m256 min_z = _mm256_loadu_ps( b->min_z + i ), max_z = _mm256_loadu_ps( b->max_z + i );
+    __m256 cx = _mm256_mul_ps( half, _mm256_add_ps( max_x, min_x ) ), ex = _mm256_mul_ps( half, _mm256_sub_ps( max_x, min_x ) );
+    __m256 cy = _mm256_mul_ps( half, _mm256_add_ps( max_y, min_y ) ), ey = _mm256_mul_ps( half, _mm256_sub_ps( max_y, min_y ) );
+    __m256 cz = _mm256_mul_ps( half, _mm256_add_ps( max_z, min_z ) ), ez = _mm256_mul_ps( half, _mm256_sub_ps( max_z, min_z ) );
+    __m256 outside = _mm256_setzero_ps();
+    for( int p = 0; p < 6; ++p )
+    {
+      __m256 dist = _mm256_add_ps( _mm256_add_ps( _mm256_mul_ps( _mm256_set1_ps( f->nx[p] ), cx ),
+                                                  _mm256_mul_ps( _mm256_set1_ps( f->ny[p] ), cy ) ),
+                                   _mm256_add_ps( _mm256_mul_ps( _mm256_set1_ps( f->nz[p] ), cz ),
+                                                  _mm256_set1_ps( f->d[p] ) ) );
+      __m256 radius = _mm256_add_ps( _mm256_add_ps( _mm256_mul_ps( _mm256_set1_ps( fabsf( f->nx[p] ) ), ex ),
+                                                    _mm256_mul_ps( _mm256_set1_ps( fabsf( f->ny[p] ) ), ey ) ),
+                                     _mm256_mul_ps( _mm256_set1_ps( fabsf( f->nz[p] ) ), ez ) );
+      outside = _mm256_or_ps( outside, _mm256_cmp_ps( _mm256_add_ps( dist, radius ), _mm256_setzero_ps(), _CMP_LT_OQ ) );
+    }
+    count = msh__cull_append( visible, count, (uint32_t)i, ~_mm256_movemask_ps( outside ) & 0xFF, 8 );
+  }
+#elif MSH__CULL_SSE2
+  __m128 half = _mm_set1_ps( 0.5f );
+  for( ; i + 4 <= n; i += 4 )
+  {
+    __m128 min_x = _mm_loadu_ps( b->min_x + i ), max_x = _mm_loadu_ps( b->max_x + i );
+    __m128 min_y = _mm_loadu_ps( b->min_y + i ), max_y = _mm_loadu_ps( b->max_y + i );
+    __m128 min_z = _mm_loadu_ps( b->min_z + i ), max_z = _mm_loadu_ps( b->max_z + i );
+    __m128 cx = _mm_mul_ps( half, _mm_add_ps( max_x, min_x ) ), ex = _mm_mul_ps( half, _mm_sub_ps( max_x, min_x ) );
+    __m128 cy = _mm_mul_ps( half, _mm_add_ps( max_y, min_y ) ), ey = _mm_mul_ps( half, _mm_sub_ps( max_y, min_y ) );
+    __m128 cz = _mm_mul_ps( half, _mm_add_ps( max_z, min_z ) ), ez = _mm_mul_ps( half, _mm_sub_ps( max_z, min_z ) );
+    __m128 outside = _mm_setzero_ps();
+    for( int p = 0; p < 6; ++p )
+    {
+      __m128 dist = _mm_add_ps( _mm_add_ps( _mm_mul_ps( _mm_set1_ps( f->nx[p] ), cx ),
+                                            _mm_mul_ps( _mm_set1_ps( f->ny[p] ), cy ) ),
+                                _mm_add_ps( _mm_mul_ps( _mm_set1_ps( f->nz[p] ), cz ),
+                                            _mm_set1_ps( f->d[p] ) ) );
+      __m128 radius = _mm_add_ps( _mm_add_ps( _mm_mul_ps( _mm_set1_ps( fabsf( f->nx[p] ) ), ex ),
+                                              _mm_mul_ps( _mm_set1_ps( fabsf( f->ny[p] ) ), ey ) ),
+                                  _mm_mul_ps( _mm_set1_ps( fabsf( f->nz[p] ) ), ez ) );
+      outside = _mm_or_ps( outside, _mm_cmplt_ps( _mm_add_ps( dist, radius ), _mm_setzero_ps() ) );
+    }
+    count = msh__cull_append( visible, count, (uint32_t)i, ~_mm_movemask_ps( outside ) & 0xF, 4 );
+  }
+#endif
+  for( ; i < n; ++i )
+  {
+    visible[count] = (uint32_t)i;
+    count += msh__cull_aabb1( f, b, i );
+  }
+  return count;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+// Level of detail
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+static inline uint8_t
+msh__cull_lod1( const msh_frustum_t* f, float x, float y, float z, float r,
+                const float* distances, int n_distances )
+{
+  float dx = x - f->eye[0], dy = y - f->eye[1], dz = z - f->eye[2];
+  float dist = sqrtf( dx * dx + dy * dy + dz * dz ) - r;
+  uint8_t lod = 0;
+  for( int k = 0; k < n_distances; ++k ) { lod += dist >= distances[k]; }
+  return lod;
+}
+
+MSH_CULL_DEF void
+msh_frustum_select_lod( const msh_frustum_t* f, const msh_spheres_soa_t* s, const uint32_t* visible,
+                        size_t n, const float* distances, int n_distances, uint8_t* lods )
+{
+  size_t i = 0;
+#if MSH__CULL_AVX2
+  __m256 eye_x = _mm256_set1_ps( f->eye[0] ), eye_y = _mm256_set1_ps( f->eye[1] );
+  __m256 eye_z = _mm256_set1_ps( f->eye[2] );
+  for( ; i + 8 <= n; i += 8 )
+  {
+    __m256 x, y, z, r;
+    if( visible )
+    {
+      __m256i idx = _mm256_loadu_si256( (const __m256i*)( visible + i ) );
+      x = _mm256_i32gather_ps( s->x, idx, 4 );
+      y = _mm256_i32gather_ps( s->y, idx, 4 );
+      z = _mm256_i32gather_ps( s->z, idx, 4 );
+      r = _mm256_i32gather_ps( s->radius, idx, 4 );
+    }
+    else
+    {
+      x = _mm256_loadu_ps( s->x + i );
+      y = _mm256_loadu_ps( s->y + i );
+      z = _mm256_loadu_ps( s->z + i );
+      r = _mm256_loadu_ps( s->radius + i );
+    }
+    __m256 dx = _mm256_sub_ps( x, eye_x ), dy = _mm256_sub_ps( y, eye_y ), dz = _mm256_sub_ps( z, eye_z );
+    __m256 dist = _mm256_sub_ps( _mm256_sqrt_ps( _mm256_add_ps( _mm256_add_ps( _mm256_mul_ps( dx, dx ), _mm256_mul_ps( dy, dy ) ),
+                                                                _mm256_mul_ps( dz, dz ) ) ), r );
+    // Comparison masks are -1 where a threshold is reached.
+    __m256i lod = _mm256_setzero_si256();
+    for( int k = 0; k < n_distances; ++k )
+    {
+      __m256 reached = _mm256_cmp_ps( dist, _mm256_set1_ps( distances[k] ), _CMP_GE_OQ );
+      lod = _mm256_sub_epi32( lod, _mm256_castps_si256( reached ) );
+    }
+    int32_t values[8];
+    _mm256_storeu_si256( (__m256i*)values, lod );
+    for( int k = 0; k < 8; ++k ) { lods[i + k] = (uint8_t)values[k]; }
+  }
+#endif
+  for( ; i < n; ++i )
+  {
+    size_t j = visible ? visible[i] : i;
+    lods[i] = msh__cull_lod1( f, s->x[j], s->y[j], s->z[j], s->radius[j], distances, n_distances );
+  }
+}
+
+#endif /* MSH_CULL_IMPLEMENTATION */
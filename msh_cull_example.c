@@ -0,0 +1,409 @@
+/*
+  Author: Maciej Halber
+  Date : Oct 18, 2026
+  License: CC0
+
+  Compilation: gcc -std=c99 -O2 -mavx2 -D_GNU_SOURCE -I<path_to_msh_libraries> msh_cull_example.c -o msh_cull_example -lm
+  Usage:       msh_cull_example [--bench]
+  Description: This program showcases msh_cull.h, frustum culling and level of detail selection
+               done on the CPU, without a window or GL context. It:
+
+               1) Validates the frustum planes extracted from a msh_look_at / msh_perspective
+               camera against clip space tests of random points, and the eye position.
+
+               2) Validates culling of spheres and boxes, and level of detail selection, against
+               a per-object reference written with msh_vec_math.h, for object counts that exercise
+               the vector remainders. Objects lying within a small tolerance of a plane or a
+               threshold are not compared.
+
+               3) Reports throughput in objects/ms for the per-object reference and msh_cull.h,
+               for a million objects scattered around the camera.
+
+               Program returns non-zero if validation fails. Compile without -mavx2 for the SSE2
+               paths, or with -DMSH_CULL_NO_SIMD for the scalar ones. With --bench, culling and
+               level of detail selection are measured with msh_bench.h instead, with cache misses
+               per object from msh_perf.h where hardware counters are available.
+*/
+
+#define MSH_STD_INCLUDE_HEADERS
+#define MSH_STD_IMPLEMENTATION
+#define MSH_VEC_MATH_IMPLEMENTATION
+#define MSH_CULL_IMPLEMENTATION
+#define MSH_PERF_IMPLEMENTATION
+#define MSH_BENCH_IMPLEMENTATION
+#include "msh_std.h"
+#include "msh_vec_math.h"
+#include "msh_cull.h"
+#include "msh_perf.h"
+#include "msh_bench.h"
+#include <float.h>
+
+enum { N_OBJECTS = 1 << 20, N_RUNS = 5 };
+
+static const float lod_distances[] = { 25.0f, 100.0f, 300.0f };
+
+typedef struct scene
+{
+  size_t n;
+  float* data;
+  msh_spheres_soa_t spheres;
+  msh_aabbs_soa_t boxes;
+} scene_t;
+
+void scene_init( scene_t* s, size_t n, float extent, msh_rand_ctx_t* rand_gen )
+{
+  // One extra element so that zero sized scenes still get valid pointers.
+  s->n = n;
+  s->data = malloc( 10 * ( n + 1 ) * sizeof(float) );
+  float* x = s->data;            float* y = x + n + 1;          float* z = y + n + 1;
+  float* r = z + n + 1;
+  float* min_x = r + n + 1;      float* min_y = min_x + n + 1;  float* min_z = min_y + n + 1;
+  float* max_x = min_z + n + 1;  float* max_y = max_x + n + 1;  float* max_z = max_y + n + 1;
+  for( size_t i = 0; i < n; ++i )
+  {
+    x[i] = ( msh_rand_nextf( rand_gen ) * 2.0f - 1.0f ) * extent;
+    y[i] = ( msh_rand_nextf( rand_gen ) * 2.0f - 1.0f ) * extent;
+    z[i] = ( msh_rand_nextf( rand_gen ) * 2.0f - 1.0f ) * extent;
+    r[i] = 0.5f + msh_rand_nextf( rand_gen ) * 0.02f * extent;
+    min_x[i] = x[i] - msh_rand_nextf( rand_gen ) * r[i];  max_x[i] = x[i] + msh_rand_nextf( rand_gen ) * r[i];
+    min_y[i] = y[i] - msh_rand_nextf( rand_gen ) * r[i];  max_y[i] = y[i] + msh_rand_nextf( rand_gen ) * r[i];
+    min_z[i] = z[i] - msh_rand_nextf( rand_gen ) * r[i];  max_z[i] = z[i] + msh_rand_nextf( rand_gen ) * r[i];
+  }
+  s->spheres = (msh_spheres_soa_t){ x, y, z, r };
+  s->boxes = (msh_aabbs_soa_t){ min_x, min_y, min_z, max_x, max_y, max_z };
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+// Per-object reference
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+typedef struct reference_frustum
+{
+  msh_vec4_t planes[6];
+  msh_vec3_t eye;
+} reference_frustum_t;
+
+reference_frustum_t reference_frustum( msh_mat4_t view, msh_mat4_t proj, msh_vec3_t eye )
+{
+  reference_frustum_t f;
+  msh_mat4_t vp = msh_mat4_transpose( msh_mat4_mul( proj, view ) );
+  for( int p = 0; p < 6; ++p )
+  {
+    msh_vec4_t row = vp.col[p / 2], w = vp.col[3];
+    float sign = ( p & 1 ) ? -1.0f : 1.0f;
+    msh_vec4_t plane = msh_vec4( w.x + sign * row.x, w.y + sign * row.y, w.z + sign * row.z, w.w + sign * row.w );
+    float len = msh_vec3_norm( msh_vec3( plane.x, plane.y, plane.z ) );
+    f.planes[p] = msh_vec4( plane.x / len, plane.y / len, plane.z / len, plane.w / len );
+  }
+  f.eye = eye;
+  return f;
+}
+
+float plane_distance( msh_vec4_t plane, msh_vec3_t p )
+{
+  return msh_vec3_dot( msh_vec3( plane.x, plane.y, plane.z ), p ) + plane.w;
+}
+
+// Smallest signed margin of the sphere over all planes; negative means culled.
+float sphere_margin( const reference_frustum_t* f, msh_vec3_t c, float r )
+{
+  float margin = FLT_MAX;
+  for( int p = 0; p < 6; ++p ) { margin = msh_min( margin, plane_distance( f->planes[p], c ) + r ); }
+  return margin;
+}
+
+float aabb_margin( const reference_frustum_t* f, msh_vec3_t min_p, msh_vec3_t max_p )
+{
+  float margin = FLT_MAX;
+  for( int p = 0; p < 6; ++p )
+  {
+    msh_vec4_t pl = f->planes[p];
+    msh_vec3_t corner = msh_vec3( pl.x > 0.0f ? max_p.x : min_p.x, pl.y > 0.0f ? max_p.y : min_p.y,
+                                  pl.z > 0.0f ? max_p.z : min_p.z );
+    margin = msh_min( margin, plane_distance( pl, corner ) );
+  }
+  return margin;
+}
+
+float lod_distance( const reference_frustum_t* f, msh_vec3_t c, float r )
+{
+  return msh_vec3_norm( msh_vec3_sub( c, f->eye ) ) - r;
+}
+
+int reference_lod( float dist )
+{
+  int lod = 0;
+  while( lod < (int)msh_count_of( lod_distances ) && dist >= lod_distances[lod] ) { lod++; }
+  return lod;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+// Validation
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+int validate_planes( msh_mat4_t view, msh_mat4_t proj, msh_vec3_t eye, msh_rand_ctx_t* rand_gen )
+{
+  msh_frustum_t frustum;
+  msh_frustum_init( &frustum, &view, &proj );
+  msh_mat4_t vp = msh_mat4_mul( proj, view );
+  int n_wrong = 0;
+  for( int i = 0; i < 100000; ++i )
+  {
+    msh_vec3_t p = msh_vec3( ( msh_rand_nextf( rand_gen ) * 2.0f - 1.0f ) * 200.0f,
+                             ( msh_rand_nextf( rand_gen ) * 2.0f - 1.0f ) * 200.0f,
+                             ( msh_rand_nextf( rand_gen ) * 2.0f - 1.0f ) * 200.0f );
+    msh_vec4_t clip = msh_mat4_vec4_mul( vp, msh_vec4( p.x, p.y, p.z, 1.0f ) );
+    float clip_margin = msh_min( msh_min( clip.w - fabsf( clip.x ), clip.w - fabsf( clip.y ) ), clip.w - fabsf( clip.z ) );
+    float plane_margin = FLT_MAX;
+    for( int k = 0; k < 6; ++k )
+    {
+      plane_margin = msh_min( plane_margin, frustum.nx[k] * p.x + frustum.ny[k] * p.y + frustum.nz[k] * p.z + frustum.d[k] );
+    }
+    if( fabsf( clip_margin ) < 1e-3f * msh_max( 1.0f, fabsf( clip.w ) ) ) { continue; }
+    n_wrong += ( clip_margin > 0.0f ) != ( plane_margin > 0.0f );
+  }
+  float eye_err = msh_vec3_norm( msh_vec3_sub( msh_vec3( frustum.eye[0], frustum.eye[1], frustum.eye[2] ), eye ) );
+  int ok = n_wrong == 0 && eye_err < 1e-3f;
+  if( !ok ) { printf("  planes: %d points misclassified, eye error %g FAILED\n", n_wrong, eye_err ); }
+  return ok;
+}
+
+// Checks a list of visible indices against per-object margins, skipping ambiguous objects.
+int check_visible( const char* name, size_t n, const uint32_t* visible, size_t n_visible, const float* margins )
+{
+  uint8_t* flags = calloc( n + 1, 1 );
+  int n_wrong = 0;
+  for( size_t i = 0; i < n_visible; ++i )
+  {
+    if( visible[i] >= n || ( i > 0 && visible[i] <= visible[i - 1] ) ) { n_wrong++; continue; }
+    flags[visible[i]] = 1;
+  }
+  for( size_t i = 0; i < n; ++i )
+  {
+    if( fabsf( margins[i] ) < 1e-3f ) { continue; }
+    n_wrong += flags[i] != ( margins[i] >= 0.0f );
+  }
+  free( flags );
+  if( n_wrong ) { printf("  %-7s n = %5zu: %d objects misclassified FAILED\n", name, n, n_wrong ); }
+  return n_wrong == 0;
+}
+
+int validate_culling( size_t n, msh_mat4_t view, msh_mat4_t proj, msh_vec3_t eye, msh_rand_ctx_t* rand_gen )
+{
+  scene_t s;
+  scene_init( &s, n, 150.0f, rand_gen );
+  msh_frustum_t frustum;
+  msh_frustum_init( &frustum, &view, &proj );
+  reference_frustum_t ref = reference_frustum( view, proj, eye );
+
+  uint32_t* visible = malloc( ( n + 1 ) * sizeof(uint32_t) );
+  uint8_t* lods = malloc( n + 1 );
+  float* margins = malloc( ( n + 1 ) * sizeof(float) );
+  int ok = 1;
+
+  for( size_t i = 0; i < n; ++i )
+  {
+    msh_vec3_t c = msh_vec3( s.spheres.x[i], s.spheres.y[i], s.spheres.z[i] );
+    margins[i] = sphere_margin( &ref, c, s.spheres.radius[i] );
+  }
+  size_t n_visible = msh_frustum_cull_spheres( &frustum, &s.spheres, n, visible );
+  ok &= check_visible( "spheres", n, visible, n_visible, margins );
+
+  // Level of detail for the visible spheres, and for all of them.
+  for( int all = 0; all < 2; ++all )
+  {
+    size_t n_lod = all ? n : n_visible;
+    msh_frustum_select_lod( &frustum, &s.spheres, all ? NULL : visible, n_lod, lod_distances,
+                            msh_count_of( lod_distances ), lods );
+    int n_wrong = 0;
+    for( size_t i = 0; i < n_lod; ++i )
+    {
+      size_t j = all ? i : visible[i];
+      float dist = lod_distance( &ref, msh_vec3( s.spheres.x[j], s.spheres.y[j], s.spheres.z[j] ), s.spheres.radius[j] );
+      int near_threshold = 0;
+      for( int k = 0; k < (int)msh_count_of( lod_distances ); ++k ) { near_threshold |= fabsf( dist - lod_distances[k] ) < 1e-3f; }
+      n_wrong += !near_threshold && lods[i] != reference_lod( dist );
+    }
+    if( n_wrong ) { printf("  lod     n = %5zu: %d objects wrong FAILED\n", n, n_wrong ); ok = 0; }
+  }
+
+  for( size_t i = 0; i < n; ++i )
+  {
+    margins[i] = aabb_margin( &ref, msh_vec3( s.boxes.min_x[i], s.boxes.min_y[i], s.boxes.min_z[i] ),
+                              msh_vec3( s.boxes.max_x[i], s.boxes.max_y[i], s.boxes.max_z[i] ) );
+  }
+  n_visible = msh_frustum_cull_aabbs( &frustum, &s.boxes, n, visible );
+  ok &= check_visible( "boxes", n, visible, n_visible, margins );
+
+  free( visible );
+  free( lods );
+  free( margins );
+  free( s.data );
+  return ok;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+// Benchmarks, run with --bench
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+typedef struct bench_data
+{
+  scene_t scene;
+  msh_frustum_t frustum;
+  uint32_t* visible;
+  uint8_t* lods;
+} bench_data_t;
+
+void bench_cull_spheres( void* data, size_t n_iters )
+{
+  bench_data_t* d = data;
+  for( size_t it = 0; it < n_iters; ++it )
+  {
+    size_t n_visible = msh_frustum_cull_spheres( &d->frustum, &d->scene.spheres, d->scene.n, d->visible );
+    MSH_BENCH_DO_NOT_OPTIMIZE( n_visible );
+  }
+}
+
+void bench_cull_aabbs( void* data, size_t n_iters )
+{
+  bench_data_t* d = data;
+  for( size_t it = 0; it < n_iters; ++it )
+  {
+    size_t n_visible = msh_frustum_cull_aabbs( &d->frustum, &d->scene.boxes, d->scene.n, d->visible );
+    MSH_BENCH_DO_NOT_OPTIMIZE( n_visible );
+  }
+}
+
+void bench_select_lod( void* data, size_t n_iters )
+{
+  bench_data_t* d = data;
+  for( size_t it = 0; it < n_iters; ++it )
+  {
+    msh_frustum_select_lod( &d->frustum, &d->scene.spheres, NULL, d->scene.n, lod_distances,
+                            msh_count_of( lod_distances ), d->lods );
+    MSH_BENCH_CLOBBER();
+  }
+}
+
+int run_benchmarks( int argc, char** argv )
+{
+  msh_rand_ctx_t rand_gen = {0};
+  msh_rand_init( &rand_gen, 12345ULL );
+  bench_data_t d;
+  scene_init( &d.scene, N_OBJECTS, 400.0f, &rand_gen );
+  msh_mat4_t view = msh_look_at( msh_vec3( 0.0f, 0.0f, 40.0f ), msh_vec3( 0.0f, 0.0f, 0.0f ), msh_vec3( 0.0f, 1.0f, 0.0f ) );
+  msh_mat4_t proj = msh_perspective( 0.75f, 1.5f, 0.1f, 250.0f );
+  msh_frustum_init( &d.frustum, &view, &proj );
+  d.visible = malloc( N_OBJECTS * sizeof(uint32_t) );
+  d.lods = malloc( N_OBJECTS );
+
+  msh_bench_t* b = msh_bench_create( argc, argv );
+  msh_bench_add( b, "cull spheres, 1M", bench_cull_spheres, &d, N_OBJECTS );
+  msh_bench_add( b, "cull boxes, 1M", bench_cull_aabbs, &d, N_OBJECTS );
+  msh_bench_add( b, "select lod, 1M", bench_select_lod, &d, N_OBJECTS );
+  int n_regressions = msh_bench_run( b );
+  msh_bench_destroy( b );
+  free( d.visible );
+  free( d.lods );
+  free( d.scene.data );
+  return n_regressions ? 1 : 0;
+}
+
+int main( int argc, char** argv )
+{
+  if( msh_bench_requested( argc, argv ) ) { return run_benchmarks( argc, argv ); }
+  int n_failed = 0;
+  msh_rand_ctx_t rand_gen = {0};
+  msh_rand_init( &rand_gen, 12345ULL );
+
+  msh_vec3_t eyes[] = { msh_vec3( 0.0f, 0.0f, 40.0f ), msh_vec3( 30.0f, -20.0f, 5.0f ), msh_vec3( -3.0f, 50.0f, -60.0f ) };
+  msh_vec3_t centers[] = { msh_vec3( 0.0f, 0.0f, 0.0f ), msh_vec3( 0.0f, 10.0f, 0.0f ), msh_vec3( 5.0f, 0.0f, 20.0f ) };
+  msh_mat4_t proj = msh_perspective( 0.75f, 1.5f, 0.1f, 250.0f );
+
+  //----------------------------------------------------------------------------------------------
+  printf("Validation against per-object msh_vec_math tests:\n");
+  {
+    size_t sizes[] = { 0, 1, 3, 4, 5, 7, 8, 9, 17, 1000, 100000 };
+    int n_cases = 0, n_ok = 0;
+    for( int c = 0; c < (int)msh_count_of( eyes ); ++c )
+    {
+      msh_mat4_t view = msh_look_at( eyes[c], centers[c], msh_vec3( 0.0f, 1.0f, 0.0f ) );
+      n_ok += validate_planes( view, proj, eyes[c], &rand_gen );
+      n_cases++;
+      for( int k = 0; k < (int)msh_count_of( sizes ); ++k )
+      {
+        n_ok += validate_culling( sizes[k], view, proj, eyes[c], &rand_gen );
+        n_cases++;
+      }
+    }
+    n_failed += n_cases - n_ok;
+    printf("  %d/%d cases within tolerance\n", n_ok, n_cases );
+  }
+
+  //----------------------------------------------------------------------------------------------
+  printf("Throughput for %d objects in objects/ms (best of %d runs):\n", N_OBJECTS, N_RUNS );
+  {
+    scene_t s;
+    scene_init( &s, N_OBJECTS, 400.0f, &rand_gen );
+    msh_mat4_t view = msh_look_at( eyes[0], centers[0], msh_vec3( 0.0f, 1.0f, 0.0f ) );
+    msh_frustum_t frustum;
+    msh_frustum_init( &frustum, &view, &proj );
+    reference_frustum_t ref = reference_frustum( view, proj, eyes[0] );
+    uint32_t* visible = malloc( N_OBJECTS * sizeof(uint32_t) );
+    uint8_t* lods = malloc( N_OBJECTS );
+    memset( visible, 0, N_OBJECTS * sizeof(uint32_t) );
+    memset( lods, 0, N_OBJECTS );
+
+    double best[5] = { 1e30, 1e30, 1e30, 1e30, 1e30 };
+    size_t n_visible = 0, n_visible_boxes = 0;
+    for( int r = 0; r < N_RUNS; ++r )
+    {
+      uint64_t t1 = msh_time_now();
+      size_t count = 0;
+      for( int i = 0; i < N_OBJECTS; ++i )
+      {
+        msh_vec3_t c = msh_vec3( s.spheres.x[i], s.spheres.y[i], s.spheres.z[i] );
+        if( sphere_margin( &ref, c, s.spheres.radius[i] ) >= 0.0f ) { visible[count++] = i; }
+      }
+      uint64_t t2 = msh_time_now();
+      best[0] = msh_min( best[0], msh_time_diff( MSHT_MILLISECONDS, t2, t1 ) );
+
+      t1 = msh_time_now();
+      count = 0;
+      for( int i = 0; i < N_OBJECTS; ++i )
+      {
+        msh_vec3_t min_p = msh_vec3( s.boxes.min_x[i], s.boxes.min_y[i], s.boxes.min_z[i] );
+        msh_vec3_t max_p = msh_vec3( s.boxes.max_x[i], s.boxes.max_y[i], s.boxes.max_z[i] );
+        if( aabb_margin( &ref, min_p, max_p ) >= 0.0f ) { visible[count++] = i; }
+      }
+      t2 = msh_time_now();
+      best[1] = msh_min( best[1], msh_time_diff( MSHT_MILLISECONDS, t2, t1 ) );
+
+      t1 = msh_time_now();
+      n_visible = msh_frustum_cull_spheres( &frustum, &s.spheres, N_OBJECTS, visible );
+      t2 = msh_time_now();
+      best[2] = msh_min( best[2], msh_time_diff( MSHT_MILLISECONDS, t2, t1 ) );
+
+      t1 = msh_time_now();
+      n_visible_boxes = msh_frustum_cull_aabbs( &frustum, &s.boxes, N_OBJECTS, visible );
+      t2 = msh_time_now();
+      best[3] = msh_min( best[3], msh_time_diff( MSHT_MILLISECONDS, t2, t1 ) );
+
+      t1 = msh_time_now();
+      msh_frustum_select_lod( &frustum, &s.spheres, NULL, N_OBJECTS, lod_distances, msh_count_of( lod_distances ), lods );
+      t2 = msh_time_now();
+      best[4] = msh_min( best[4], msh_time_diff( MSHT_MILLISECONDS, t2, t1 ) );
+    }
+    printf("  %-8s %12s %12s %8s %10s\n", "", "per-object", "msh_cull", "speedup", "visible" );
+    printf("  %-8s %12.0f %12.0f %7.1fx %10zu\n", "spheres", N_OBJECTS / best[0], N_OBJECTS / best[2], best[0] / best[2], n_visible );
+    printf("  %-8s %12.0f %12.0f %7.1fx %10zu\n", "boxes", N_OBJECTS / best[1], N_OBJECTS / best[3], best[1] / best[3], n_visible_boxes );
+    printf("  %-8s %12s %12.0f\n", "lod", "", N_OBJECTS / best[4] );
+
+    free( visible );
+    free( lods );
+    free( s.data );
+  }
+
+  printf("%d failed\n", n_failed );
+  return n_failed ? 1 : 0;
+}
@@ -0,0 +1,649 @@
+/*
+  ==============================================================================
+
+  MSH_DRAW_BATCH.H v0.1
+
+  A single header library for submitting large amounts of 2D geometry with few draw calls:
+
+    - retained command buffer of triangles, lines and discs with per-vertex colors
+    - commands are sorted by a state key (layer, blend mode, user state) and merged into a few
+      large vertex/index batches
+    - per frame statistics of commands, batches, vertices and build time
+    - optional OpenGL 3 submission; batching itself does not need a GPU
+
+  To use the library you simply add:
+
+  #include "msh_std.h"
+  #include "msh_sort.h"
+  #define MSH_DRAW_BATCH_IMPLEMENTATION
+  #include "msh_draw_batch.h"
+
+  To also get the OpenGL submission functions, include GL headers (glew, glad or similar) first
+  and define MSH_DRAW_BATCH_GL.
+
+  ==============================================================================
+  DOCUMENTATION
+
+  Recording
+    msh_draw_cmdbuf_t* cb = msh_draw_cmdbuf_create( 0 );
+    msh_draw_cmdbuf_reset( cb );                                      // every frame
+    uint32_t key = MSH_DRAW_STATE_KEY( layer, MSH_DRAW_BLEND_ALPHA, 0 );
+    msh_draw_lines( cb, key, xy, colors, n_lines, width );
+    msh_draw_triangles( cb, key, xy, colors, n_vertices, indices, n_indices );
+    msh_draw_discs( cb, key, xy, radii, colors, n_discs, n_segments );
+
+    Every call records one command. Positions are interleaved x and y floats and colors are
+    non-premultiplied RGBA packed with MSH_DRAW_RGBA, one per vertex (per disc for discs).
+    msh_draw_lines takes two points and two colors per line and expands each line into a quad
+    of the given width, interpolating the colors along it. Recording only appends to arrays,
+    so it is cheap to call once per primitive.
+
+  State keys
+    MSH_DRAW_STATE_KEY( layer, blend, user )
+
+    32 bit key, built from a layer (8 bits), a blend mode (8 bits, MSH_DRAW_BLEND_ALPHA, _ADD
+    or _OPAQUE) and 16 bits of user state, e.g. a shader or texture id. Layer is the most
+    significant part, so layers are drawn in ascending order. Within a layer, commands with
+    different state are drawn in key order rather than submission order; commands with the
+    same key keep the submission order.
+
+  Building batches
+    msh_draw_batches_t out = msh_draw_cmdbuf_build( cb );
+    for( size_t i = 0; i < out.n_batches; ++i )
+    {
+      // draw out.batches[i].n_indices of out.indices starting at out.batches[i].first_index
+    }
+
+    Commands are sorted by key with a stable radix sort, and consecutive commands with the same
+    key are merged into a single batch, with vertices and indices copied into one shared
+    vertex and one index array, so the whole frame can be uploaded once. Indices are relative
+    to the first vertex of their batch (out.batches[i].first_vertex), so a batch is drawn with
+    a base vertex, or uploaded on its own. A batch is split when it would exceed
+    max_batch_vertices given to msh_draw_cmdbuf_create (0 selects MSH_DRAW_BATCH_MAX_VERTICES,
+    1M); a single larger command is kept whole. With a limit of at most 65536, every index of
+    a batch made of commands within the limit fits in 16 bits. If commands are already in key
+    order, the recorded vertices are returned without copying, and so are the indices if there
+    is a single batch. Output stays valid until the next reset or record call.
+
+  Statistics
+    msh_draw_stats_t stats = msh_draw_cmdbuf_get_stats( cb );
+
+    Number of commands, batches, vertices and indices, and CPU time of the last build. If
+    msh_prof.h is included first, builds are also recorded as "msh_draw_cmdbuf_build" scopes.
+
+  OpenGL
+    msh_draw_gl_t gl = {0};
+    msh_draw_gl_init( &gl );
+    msh_draw_gl_submit( &gl, &out, window_width, window_height );
+    msh_draw_gl_term( &gl );
+
+    Uploads a frame to a streaming vertex and index buffer and issues one
+    glDrawElementsBaseVertex call per batch. Positions are in window coordinates, with (0, 0)
+    at the top left corner. Needs an OpenGL 3.2 context; the function pointers have to be
+    loaded by the application.
+
+  ==============================================================================
+  AUTHORS:
+    Maciej Halber
+
+  LICENSE:
+    CC0
+  ==============================================================================
+*/
+
+#ifndef MSH_DRAW_BATCH_H
+#define MSH_DRAW_BATCH_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#ifndef MSH_DRAW_BATCH_DEF
+#ifdef MSH_DRAW_BATCH_STATIC
+#define MSH_DRAW_BATCH_DEF static
+#else
+#define MSH_DRAW_BATCH_DEF extern
+#endif
+#endif
+
+#ifndef MSH_DRAW_BATCH_MAX_VERTICES
+#define MSH_DRAW_BATCH_MAX_VERTICES ( 1u << 20 )
+#endif
+
+#define MSH_DRAW_RGBA( r, g, b, a ) \
+  ( (uint32_t)(r) | ( (uint32_t)(g) << 8 ) | ( (uint32_t)(b) << 16 ) | ( (uint32_t)(a) << 24 ) )
+
+#define MSH_DRAW_STATE_KEY( layer, blend, user ) \
+  ( ( (uint32_t)(layer) << 24 ) | ( ( (uint32_t)(blend) & 0xFF ) << 16 ) | ( (uint32_t)(user) & 0xFFFF ) )
+
+#define MSH_DRAW_KEY_LAYER( key ) ( (key) >> 24 )
+#define MSH_DRAW_KEY_BLEND( key ) ( ( (key) >> 16 ) & 0xFF )
+#define MSH_DRAW_KEY_USER( key )  ( (key) & 0xFFFF )
+
+typedef enum msh_draw_blend
+{
+  MSH_DRAW_BLEND_ALPHA = 0,
+  MSH_DRAW_BLEND_ADD,
+  MSH_DRAW_BLEND_OPAQUE
+} msh_draw_blend_t;
+
+typedef struct msh_draw_vertex
+{
+  float x, y;
+  uint32_t color;
+} msh_draw_vertex_t;
+
+typedef struct msh_draw_batch
+{
+  uint32_t state_key;
+  uint32_t first_index;
+  uint32_t n_indices;
+  uint32_t first_vertex;
+  uint32_t n_vertices;
+} msh_draw_batch_t;
+
+typedef struct msh_draw_batches
+{
+  const msh_draw_vertex_t* vertices;
+  const uint32_t* indices;
+  const msh_draw_batch_t* batches;
+  size_t n_vertices;
+  size_t n_indices;
+  size_t n_batches;
+} msh_draw_batches_t;
+
+typedef struct msh_draw_stats
+{
+  size_t n_commands;
+  size_t n_batches;
+  size_t n_vertices;
+  size_t n_indices;
+  double build_ms;
+} msh_draw_stats_t;
+
+typedef struct msh_draw_cmdbuf msh_draw_cmdbuf_t;
+
+MSH_DRAW_BATCH_DEF msh_draw_cmdbuf_t* msh_draw_cmdbuf_create( uint32_t max_batch_vertices );
+MSH_DRAW_BATCH_DEF void               msh_draw_cmdbuf_destroy( msh_draw_cmdbuf_t* cb );
+MSH_DRAW_BATCH_DEF void               msh_draw_cmdbuf_reset( msh_draw_cmdbuf_t* cb );
+
+MSH_DRAW_BATCH_DEF void msh_draw_triangles( msh_draw_cmdbuf_t* cb, uint32_t key, const float* xy,
+                                            const uint32_t* colors, int n_vertices,
+                                            const int* indices, int n_indices );
+MSH_DRAW_BATCH_DEF void msh_draw_lines( msh_draw_cmdbuf_t* cb, uint32_t key, const float* xy,
+                                        const uint32_t* colors, int n_lines, float width );
+MSH_DRAW_BATCH_DEF void msh_draw_discs( msh_draw_cmdbuf_t* cb, uint32_t key, const float* xy,
+                                        const float* radii, const uint32_t* colors, int n_discs,
+                                        int n_segments );
+
+MSH_DRAW_BATCH_DEF msh_draw_batches_t msh_draw_cmdbuf_build( msh_draw_cmdbuf_t* cb );
+MSH_DRAW_BATCH_DEF msh_draw_stats_t   msh_draw_cmdbuf_get_stats( const msh_draw_cmdbuf_t* cb );
+
+#ifdef MSH_DRAW_BATCH_GL
+typedef struct msh_draw_gl
+{
+  unsigned int program;
+  unsigned int vao;
+  unsigned int vbo;
+  unsigned int ibo;
+  int viewport_loc;
+} msh_draw_gl_t;
+
+MSH_DRAW_BATCH_DEF int  msh_draw_gl_init( msh_draw_gl_t* gl );
+MSH_DRAW_BATCH_DEF void msh_draw_gl_submit( msh_draw_gl_t* gl, const msh_draw_batches_t* batches,
+                                            int width, int height );
+MSH_DRAW_BATCH_DEF void msh_draw_gl_term( msh_draw_gl_t* gl );
+#endif
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* MSH_DRAW_BATCH_H */
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+// IMPLEMENTATION
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+#ifdef MSH_DRAW_BATCH_IMPLEMENTATION
+
+#include <math.h>
+
+// Building is recorded as a profiler scope when msh_prof.h is included first.
+#ifdef MSH_PROF_H
+#define MSH__DRAW_PROF_BEGIN( name ) MSH_PROF_BEGIN( name )
+#define MSH__DRAW_PROF_END()         MSH_PROF_END()
+#else
+#define MSH__DRAW_PROF_BEGIN( name )
+#define MSH__DRAW_PROF_END()
+#endif
+
+// Command buffers are tracked under "msh_draw_batch" when msh_mem.h is included first. Their
+// arrays are msh_arrays, tracked only with MSH_MEM_OVERRIDE.
+#ifndef MSH_DRAW_BATCH_CALLOC
+#ifdef MSH_MEM_H
+#define MSH_DRAW_BATCH_CALLOC( count, size ) msh_mem_calloc( "msh_draw_batch", count, size )
+#define MSH_DRAW_BATCH_FREE( ptr )           msh_mem_free( ptr )
+#else
+#define MSH_DRAW_BATCH_CALLOC( count, size ) calloc( count, size )
+#define MSH_DRAW_BATCH_FREE( ptr )           free( ptr )
+#endif
+#endif
+
+typedef struct msh__draw_cmd
+{
+  uint32_t key;
+  uint32_t first_vertex;
+  uint32_t n_vertices;
+  uint32_t first_index;
+  uint32_t n_indices;
+} msh__draw_cmd_t;
+
+struct msh_draw_cmdbuf
+{
+  uint32_t max_batch_vertices;
+  int is_sorted;
+
+  // Recorded in submission order, indices are absolute.
+  msh_array(msh__draw_cmd_t) cmds;
+  msh_array(msh_draw_vertex_t) vertices;
+  msh_array(uint32_t) indices;
+
+  msh_array(uint32_t) sort_keys;
+  msh_array(uint32_t) sort_order;
+  msh_array(msh_draw_vertex_t) out_vertices;
+  msh_array(uint32_t) out_indices;
+  msh_array(msh_draw_batch_t) batches;
+  msh_draw_stats_t stats;
+};
+
+MSH_DRAW_BATCH_DEF msh_draw_cmdbuf_t*
+msh_draw_cmdbuf_create( uint32_t max_batch_vertices )
+{
+  msh_draw_cmdbuf_t* cb = MSH_DRAW_BATCH_CALLOC( 1, sizeof(msh_draw_cmdbuf_t) );
+  cb->max_batch_vertices = max_batch_vertices ? max_batch_vertices : MSH_DRAW_BATCH_MAX_VERTICES;
+  cb->is_sorted = 1;
+  return cb;
+}
+
+MSH_DRAW_BATCH_DEF void
+msh_draw_cmdbuf_destroy( msh_draw_cmdbuf_t* cb )
+{
+  if( !cb ) { return; }
+  msh_array_free( cb->cmds );
+  msh_array_free( cb->vertices );
+  msh_array_free( cb->indices );
+  msh_array_free( cb->sort_keys );
+  msh_array_free( cb->sort_order );
+  msh_array_free( cb->out_vertices );
+  msh_array_free( cb->out_indices );
+  msh_array_free( cb->batches );
+  MSH_DRAW_BATCH_FREE( cb );
+}
+
+MSH_DRAW_BATCH_DEF void
+msh_draw_cmdbuf_reset( msh_draw_cmdbuf_t* cb )
+{
+  msh_array_clear( cb->cmds );
+  msh_array_clear( cb->vertices );
+  msh_array_clear( cb->indices );
+  cb->is_sorted = 1;
+}
+
+MSH_DRAW_BATCH_DEF msh_draw_stats_t
+msh_draw_cmdbuf_get_stats( const msh_draw_cmdbuf_t* cb )
+{
+  return cb->stats;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+// Recording
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+// Starts a command and reserves space for its vertices and indices, which the caller pushes.
+// Returns index of the first vertex of the command.
+static uint32_t
+msh__draw_begin_cmd( msh_draw_cmdbuf_t* cb, uint32_t key, size_t n_vertices, size_t n_indices )
+{
+  size_t n_cmds = msh_array_len( cb->cmds );
+  if( n_cmds && cb->cmds[n_cmds - 1].key > key ) { cb->is_sorted = 0; }
+
+  msh__draw_cmd_t cmd;
+  cmd.key          = key;
+  cmd.first_vertex = (uint32_t)msh_array_len( cb->vertices );
+  cmd.n_vertices   = (uint32_t)n_vertices;
+  cmd.first_index  = (uint32_t)msh_array_len( cb->indices );
+  cmd.n_indices    = (uint32_t)n_indices;
+  msh_array_push( cb->cmds, cmd );
+
+  msh_array_fit( cb->vertices, cmd.first_vertex + n_vertices );
+  msh_array_fit( cb->indices, cmd.first_index + n_indices );
+  return cmd.first_vertex;
+}
+
+static inline void
+msh__draw_push_vertex( msh_draw_cmdbuf_t* cb, float x, float y, uint32_t color )
+{
+  msh_draw_vertex_t v = { x, y, color };
+  msh_array_push( cb->vertices, v );
+}
+
+MSH_DRAW_BATCH_DEF void
+msh_draw_triangles( msh_draw_cmdbuf_t* cb, uint32_t key, const float* xy, const uint32_t* colors,
+                    int n_vertices, const int* indices, int n_indices )
+{
+  if( n_vertices <= 0 || n_indices < 3 ) { return; }
+  n_indices -= n_indices % 3;
+  uint32_t base = msh__draw_begin_cmd( cb, key, n_vertices, n_indices );
+  for( int i = 0; i < n_vertices; ++i ) { msh__draw_push_vertex( cb, xy[2 * i], xy[2 * i + 1], colors[i] ); }
+  for( int i = 0; i < n_indices; ++i ) { msh_array_push( cb->indices, base + (uint32_t)indices[i] ); }
+}
+
+MSH_DRAW_BATCH_DEF void
+msh_draw_lines( msh_draw_cmdbuf_t* cb, uint32_t key, const float* xy, const uint32_t* colors,
+                int n_lines, float width )
+{
+  if( n_lines <= 0 ) { return; }
+  uint32_t base = msh__draw_begin_cmd( cb, key, 4 * (size_t)n_lines, 6 * (size_t)n_lines );
+  float hw = 0.5f * width;
+  for( int i = 0; i < n_lines; ++i )
+  {
+    float ax = xy[4 * i + 0], ay = xy[4 * i + 1];
+    float bx = xy[4 * i + 2], by = xy[4 * i + 3];
+    float dx = bx - ax, dy = by - ay;
+    float len = sqrtf( dx * dx + dy * dy );
+    float s = len > 0.0f ? hw / len : 0.0f;
+    float nx = -dy * s, ny = dx * s;
+    msh__draw_push_vertex( cb, ax + nx, ay + ny, colors[2 * i] );
+    msh__draw_push_vertex( cb, ax - nx, ay - ny, colors[2 * i] );
+    msh__draw_push_vertex( cb, bx - nx, by - ny, colors[2 * i + 1] );
+    msh__draw_push_vertex( cb, bx + nx, by + ny, colors[2 * i + 1] );
+    uint32_t b = base + 4 * i;
+    msh_array_push( cb->indices, b );
+    msh_array_push( cb->indices, b + 1 );
+    msh_array_push( cb->indices, b + 2 );
+    msh_array_push( cb->indices, b );
+    msh_array_push( cb->indices, b + 2 );
+    msh_array_push( cb->indices, b + 3 );
+  }
+}
+
+MSH_DRAW_BATCH_DEF void
+msh_draw_discs( msh_draw_cmdbuf_t* cb, uint32_t key, const float* xy, const float* radii,
+                const uint32_t* colors, int n_discs, int n_segments )
+{
+  if( n_discs <= 0 ) { return; }
+  n_segments = msh_max( n_segments, 3 );
+  size_t verts_per_disc = (size_t)n_segments + 1;
+  uint32_t base = msh__draw_begin_cmd( cb, key, verts_per_disc * n_discs, 3 * (size_t)n_segments * n_discs );
+
+  // Unit circle is computed once per command.
+  float unit[2 * 64];
+  int n_unit = msh_min( n_segments, 64 );
+  for( int k = 0; k < n_unit; ++k )
+  {
+    float theta = (float)( 2.0 * 3.14159265358979323846 * k / n_segments );
+    unit[2 * k + 0] = cosf( theta );
+    unit[2 * k + 1] = sinf( theta );
+  }
+  for( int i = 0; i < n_discs; ++i )
+  {
+    float cx = xy[2 * i + 0], cy = xy[2 * i + 1], r = radii[i];
+    msh__draw_push_vertex( cb, cx, cy, colors[i] );
+    for( int k = 0; k < n_segments; ++k )
+    {
+      float ux, uy;
+      if( k < n_unit ) { ux = unit[2 * k]; uy = unit[2 * k + 1]; }
+      else
+      {
+        float theta = (float)( 2.0 * 3.14159265358979323846 * k / n_segments );
+        ux = cosf( theta ); uy = sinf( theta );
+      }
+      msh__draw_push_vertex( cb, cx + r * ux, cy + r * uy, colors[i] );
+    }
+    uint32_t b = base + (uint32_t)( verts_per_disc * i );
+    for( int k = 0; k < n_segments; ++k )
+    {
+      msh_array_push( cb->indices, b );
+      msh_array_push( cb->indices, b + 1 + k );
+      msh_array_push( cb->indices, b + 1 + ( k + 1 ) % n_segments );
+    }
+  }
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+// Batching
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+MSH_DRAW_BATCH_DEF msh_draw_batches_t
+msh_draw_cmdbuf_build( msh_draw_cmdbuf_t* cb )
+{
+  uint64_t t1 = msh_time_now();
+  MSH__DRAW_PROF_BEGIN( "msh_draw_cmdbuf_build" );
+  size_t n_cmds = msh_array_len( cb->cmds );
+  msh_array_clear( cb->batches );
+
+  // Stable sort keeps submission order among commands with the same key.
+  const uint32_t* order = NULL;
+  if( !cb->is_sorted )
+  {
+    msh_array_fit( cb->sort_keys, n_cmds );
+    msh_array_fit( cb->sort_order, n_cmds );
+    for( size_t i = 0; i < n_cmds; ++i )
+    {
+      cb->sort_keys[i] = cb->cmds[i].key;
+      cb->sort_order[i] = (uint32_t)i;
+    }
+    msh_radix_sort_u32( cb->sort_keys, cb->sort_order, n_cmds );
+    order = cb->sort_order;
+  }
+
+  // Consecutive commands with the same key are merged, up to max_batch_vertices.
+  uint32_t first_vertex = 0, first_index = 0;
+  for( size_t i = 0; i < n_cmds; ++i )
+  {
+    const msh__draw_cmd_t* cmd = &cb->cmds[order ? order[i] : i];
+    size_t n_batches = msh_array_len( cb->batches );
+    msh_draw_batch_t* last = n_batches ? &cb->batches[n_batches - 1] : NULL;
+    if( last && last->state_key == cmd->key &&
+        (uint64_t)last->n_vertices + cmd->n_vertices <= cb->max_batch_vertices )
+    {
+      last->n_vertices += cmd->n_vertices;
+      last->n_indices += cmd->n_indices;
+    }
+    else
+    {
+      msh_draw_batch_t batch = { cmd->key, first_index, cmd->n_indices, first_vertex, cmd->n_vertices };
+      msh_array_push( cb->batches, batch );
+    }
+    first_vertex += cmd->n_vertices;
+    first_index += cmd->n_indices;
+  }
+
+  // Out of order commands are gathered into the output arrays, and indices are rebased to the
+  // first vertex of their batch. Recorded indices are absolute, so they are returned as they are
+  // only if commands are in order and form a single batch.
+  const msh_draw_vertex_t* vertices = cb->vertices;
+  const uint32_t* indices = cb->indices;
+  if( order || msh_array_len( cb->batches ) > 1 )
+  {
+    if( order ) { msh_array_fit( cb->out_vertices, msh_array_len( cb->vertices ) ); }
+    msh_array_fit( cb->out_indices, msh_array_len( cb->indices ) );
+    const msh_draw_batch_t* batch = cb->batches;
+    uint32_t n_vertices = 0, n_indices = 0;
+    for( size_t i = 0; i < n_cmds; ++i )
+    {
+      const msh__draw_cmd_t* cmd = &cb->cmds[order ? order[i] : i];
+      if( n_vertices >= batch->first_vertex + batch->n_vertices ) { batch++; }
+      if( order )
+      {
+        memcpy( cb->out_vertices + n_vertices, cb->vertices + cmd->first_vertex,
+                cmd->n_vertices * sizeof(msh_draw_vertex_t) );
+      }
+      uint32_t shift = n_vertices - batch->first_vertex - cmd->first_vertex;   // may wrap around
+      const uint32_t* src = cb->indices + cmd->first_index;
+      uint32_t* dst = cb->out_indices + n_indices;
+      for( uint32_t k = 0; k < cmd->n_indices; ++k ) { dst[k] = src[k] + shift; }
+      n_vertices += cmd->n_vertices;
+      n_indices += cmd->n_indices;
+    }
+    if( order ) { vertices = cb->out_vertices; }
+    indices = cb->out_indices;
+  }
+
+  msh_draw_batches_t out;
+  out.vertices   = vertices;
+  out.indices    = indices;
+  out.batches    = cb->batches;
+  out.n_vertices = first_vertex;
+  out.n_indices  = first_index;
+  out.n_batches  = msh_array_len( cb->batches );
+
+  MSH__DRAW_PROF_END();
+  uint64_t t2 = msh_time_now();
+  cb->stats.n_commands = n_cmds;
+  cb->stats.n_batches  = out.n_batches;
+  cb->stats.n_vertices = out.n_vertices;
+  cb->stats.n_indices  = out.n_indices;
+  cb->stats.build_ms   = msh_time_diff( MSHT_MILLISECONDS, t2, t1 );
+  return out;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+// OpenGL
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+#ifdef MSH_DRAW_BATCH_GL
+
+static const char* msh__draw_gl_vs =
+  "#version 150\n"
+  "uniform vec2 u_viewport;\n"
+  "in vec2 a_position;\n"
+  "in vec4 a_color;\n"
+  "out vec4 v_color;\n"
+  "void main() {\n"
+  "  v_color = a_color;\n"
+  "  gl_Position = vec4( 2.0 * a_position.x / u_viewport.x - 1.0, 1.0 - 2.0 * a_position.y / u_viewport.y, 0.0, 1.0 );\n"
+  "}\n";
+
+static const char* msh__draw_gl_fs =
+  "#version 150\n"
+  "in vec4 v_color;\n"
+  "out vec4 frag_color;\n"
+  "void main() { frag_color = v_color; }\n";
+
+static GLuint
+msh__draw_gl_compile( GLenum type, const char* src )
+{
+  GLuint shader = glCreateShader( type );
+  glShaderSource( shader, 1, &src, NULL );
+  glCompileShader( shader );
+  GLint status;
+  glGetShaderiv( shader, GL_COMPILE_STATUS, &status );
+  if( !status )
+  {
+    char log[1024];
+    glGetShaderInfoLog( shader, sizeof(log), NULL, log );
+    fprintf( stderr, "msh_draw_batch: shader compilation failed: %s\n", log );
+    glDeleteShader( shader );
+    return 0;
+  }
+  return shader;
+}
+
+MSH_DRAW_BATCH_DEF int
+msh_draw_gl_init( msh_draw_gl_t* gl )
+{
+  GLuint vs = msh__draw_gl_compile( GL_VERTEX_SHADER, msh__draw_gl_vs );
+  GLuint fs = msh__draw_gl_compile( GL_FRAGMENT_SHADER, msh__draw_gl_fs );
+  if( !vs || !fs ) { return 0; }
+  gl->program = glCreateProgram();
+  glAttachShader( gl->program, vs );
+  glAttachShader( gl->program, fs );
+  glBindAttribLocation( gl->program, 0, "a_position" );
+  glBindAttribLocation( gl->program, 1, "a_color" );
+  glBindFragDataLocation( gl->program, 0, "frag_color" );
+  glLinkProgram( gl->program );
+  glDeleteShader( vs );
+  glDeleteShader( fs );
+  GLint status;
+  glGetProgramiv( gl->program, GL_LINK_STATUS, &status );
+  if( !status )
+  {
+    fprintf( stderr, "msh_draw_batch: program linking failed\n" );
+    return 0;
+  }
+  gl->viewport_loc = glGetUniformLocation( gl->program, "u_viewport" );
+
+  glGenVertexArrays( 1, &gl->vao );
+  glGenBuffers( 1, &gl->vbo );
+  glGenBuffers( 1, &gl->ibo );
+  glBindVertexArray( gl->vao );
+  glBindBuffer( GL_ARRAY_BUFFER, gl->vbo );
+  glBindBuffer( GL_ELEMENT_ARRAY_BUFFER, gl->ibo );
+  glEnableVertexAttribArray( 0 );
+  glEnableVertexAttribArray( 1 );
+  glVertexAttribPointer( 0, 2, GL_FLOAT, GL_FALSE, sizeof(msh_draw_vertex_t),
+                         (void*)offsetof( msh_draw_vertex_t, x ) );
+  glVertexAttribPointer( 1, 4, GL_UNSIGNED_BYTE, GL_TRUE, sizeof(msh_draw_vertex_t),
+                         (void*)offsetof( msh_draw_vertex_t, color ) );
+  glBindVertexArray( 0 );
+  return 1;
+}
+
+MSH_DRAW_BATCH_DEF void
+msh_draw_gl_submit( msh_draw_gl_t* gl, const msh_draw_batches_t* b, int width, int height )
+{
+  if( !b->n_batches ) { return; }
+  glUseProgram( gl->program );
+  glUniform2f( gl->viewport_loc, (float)width, (float)height );
+  glBindVertexArray( gl->vao );
+
+  // Orphaning the buffers lets the driver hand out fresh storage instead of waiting.
+  glBindBuffer( GL_ARRAY_BUFFER, gl->vbo );
+  glBufferData( GL_ARRAY_BUFFER, b->n_vertices * sizeof(msh_draw_vertex_t), NULL, GL_STREAM_DRAW );
+  glBufferSubData( GL_ARRAY_BUFFER, 0, b->n_vertices * sizeof(msh_draw_vertex_t), b->vertices );
+  glBufferData( GL_ELEMENT_ARRAY_BUFFER, b->n_indices * sizeof(uint32_t), NULL, GL_STREAM_DRAW );
+  glBufferSubData( GL_ELEMENT_ARRAY_BUFFER, 0, b->n_indices * sizeof(uint32_t), b->indices );
+
+  glDisable( GL_DEPTH_TEST );
+  glDisable( GL_CULL_FACE );
+  glDisable( GL_STENCIL_TEST );
+  uint32_t blend = ~0u;
+  for( size_t i = 0; i < b->n_batches; ++i )
+  {
+    const msh_draw_batch_t* batch = &b->batches[i];
+    if( MSH_DRAW_KEY_BLEND( batch->state_key ) != blend )
+    {
+      blend = MSH_DRAW_KEY_BLEND( batch->state_key );
+      if( blend == MSH_DRAW_BLEND_OPAQUE ) { glDisable( GL_BLEND ); }
+      else
+      {
+        glEnable( GL_BLEND );
+        glBlendFunc( GL_SRC_ALPHA, blend == MSH_DRAW_BLEND_ADD ? GL_ONE : GL_ONE_MINUS_SRC_ALPHA );
+      }
+    }
+    glDrawElementsBaseVertex( GL_TRIANGLES, batch->n_indices, GL_UNSIGNED_INT,
+                              (void*)( (size_t)batch->first_index * sizeof(uint32_t) ),
+                              (GLint)batch->first_vertex );
+  }
+  glBindVertexArray( 0 );
+  glUseProgram( 0 );
+}
+
+MSH_DRAW_BATCH_DEF void
+msh_draw_gl_term( msh_draw_gl_t* gl )
+{
+  glDeleteBuffers( 1, &gl->vbo );
+  glDeleteBuffers( 1, &gl->ibo );
+  glDeleteVertexArrays( 1, &gl->vao );
+  glDeleteProgram( gl->program );
+  gl->program = gl->vao = gl->vbo = gl->ibo = 0;
+}
+
+#endif /* MSH_DRAW_BATCH_GL */
+
+#endif /* MSH_DRAW_BATCH_IMPLEMENTATION */
@@ -0,0 +1,321 @@
+/*
+  Author: Maciej Halber
+  Date : Oct 18, 2026
+  License: CC0
+
+  Compilation: gcc -std=c99 -O2 -I<path_to_msh_libraries> msh_draw_batch_example.c -o msh_draw_batch_example -lm
+  Usage:       msh_draw_batch_example [--bench]
+  Description: This program showcases msh_draw_batch.h, which turns many small draw commands into a
+               few large batches, without a GPU. It:
+
+               1) Records a random mix of lines, triangles and discs with different state keys
+               and checks that the batches are sorted by key, are not split unnecessarily, keep
+               submission order within a key and reproduce every recorded triangle exactly.
+
+               2) Checks the geometry that lines and discs are expanded into.
+
+               3) Measures CPU time per frame of recording and batching 100k lines with
+               per-vertex alpha, as in msh_hash_grid_example.c, recorded one line per command,
+               all lines in a single command, and one line per command with alternating state.
+
+               Program returns non-zero if validation fails. With --bench, recording and batching
+               a frame of lines is measured with msh_bench.h instead.
+*/
+
+#define MSH_STD_INCLUDE_HEADERS
+#define MSH_STD_IMPLEMENTATION
+#define MSH_SORT_IMPLEMENTATION
+#define MSH_DRAW_BATCH_IMPLEMENTATION
+#define MSH_BENCH_IMPLEMENTATION
+#include "msh_std.h"
+#include "msh_sort.h"
+#include "msh_draw_batch.h"
+#include "msh_bench.h"
+
+enum { N_RUNS = 10, N_KEYS = 8 };
+
+// Records a random command into the main buffer and the same command into the buffer of its key.
+void
+record_random( msh_draw_cmdbuf_t* cb, msh_draw_cmdbuf_t* by_key, uint32_t key, msh_rand_ctx_t* rand_gen )
+{
+  enum { MAX_N = 40 };
+  float xy[4 * MAX_N], radii[MAX_N];
+  uint32_t colors[2 * MAX_N];
+  int indices[3 * MAX_N];
+  int n = 1 + (int)( msh_rand_nextf( rand_gen ) * ( MAX_N - 1 ) );
+  for( int i = 0; i < 4 * n; ++i ) { xy[i] = msh_rand_nextf( rand_gen ) * 512.0f; }
+  for( int i = 0; i < 2 * n; ++i ) { colors[i] = MSH_DRAW_RGBA( i, 255 - i, 2 * i, 128 + i ); }
+  for( int i = 0; i < n; ++i ) { radii[i] = 1.0f + msh_rand_nextf( rand_gen ) * 10.0f; }
+  for( int i = 0; i < 3 * n; ++i ) { indices[i] = (int)( msh_rand_nextf( rand_gen ) * n ); }
+
+  int type = (int)( msh_rand_nextf( rand_gen ) * 3 );
+  msh_draw_cmdbuf_t* cbs[2] = { cb, by_key };
+  for( int k = 0; k < 2; ++k )
+  {
+    if( type == 0 )      { msh_draw_lines( cbs[k], key, xy, colors, n, 2.0f ); }
+    else if( type == 1 ) { msh_draw_triangles( cbs[k], key, xy, colors, n, indices, 3 * n ); }
+    else                 { msh_draw_discs( cbs[k], key, xy, radii, colors, n, 3 + n % 12 ); }
+  }
+}
+
+int
+same_vertex( msh_draw_vertex_t a, msh_draw_vertex_t b )
+{
+  return a.x == b.x && a.y == b.y && a.color == b.color;
+}
+
+// Vertex referenced by an index of a frame; *batch is advanced to the batch holding the index.
+const msh_draw_vertex_t*
+index_vertex( const msh_draw_batches_t* out, size_t* batch, size_t index )
+{
+  while( index >= out->batches[*batch].first_index + out->batches[*batch].n_indices ) { (*batch)++; }
+  return &out->vertices[out->batches[*batch].first_vertex + out->indices[index]];
+}
+
+int
+validate_batching( int n_cmds, uint32_t max_batch_vertices, msh_rand_ctx_t* rand_gen )
+{
+  msh_draw_cmdbuf_t* cb = msh_draw_cmdbuf_create( max_batch_vertices );
+  msh_draw_cmdbuf_t* by_key[N_KEYS];
+  uint32_t keys[N_KEYS];
+  for( int k = 0; k < N_KEYS; ++k )
+  {
+    by_key[k] = msh_draw_cmdbuf_create( max_batch_vertices );
+    keys[k] = MSH_DRAW_STATE_KEY( k % 3, ( k / 3 ) % 3, k & 1 );
+  }
+  msh_radix_sort_u32( keys, NULL, N_KEYS );
+  for( int i = 0; i < n_cmds; ++i )
+  {
+    int k = (int)( msh_rand_nextf( rand_gen ) * N_KEYS );
+    record_random( cb, by_key[k], keys[k], rand_gen );
+  }
+  msh_draw_batches_t out = msh_draw_cmdbuf_build( cb );
+  uint32_t max_n = max_batch_vertices ? max_batch_vertices : MSH_DRAW_BATCH_MAX_VERTICES;
+
+  int ok = 1;
+  uint32_t next_index = 0, next_vertex = 0;
+  for( size_t i = 0; i < out.n_batches; ++i )
+  {
+    const msh_draw_batch_t* b = &out.batches[i];
+    ok &= b->first_index == next_index && b->first_vertex == next_vertex;
+    if( i > 0 )
+    {
+      // Batches with the same key are only split when they could not be merged.
+      const msh_draw_batch_t* prev = &out.batches[i - 1];
+      ok &= prev->state_key < b->state_key ||
+            ( prev->state_key == b->state_key && prev->n_vertices + b->n_vertices > max_n );
+    }
+    for( uint32_t j = 0; j < b->n_indices; ++j )
+    {
+      ok &= out.indices[b->first_index + j] < b->n_vertices;
+    }
+    next_index += b->n_indices;
+    next_vertex += b->n_vertices;
+  }
+  ok &= next_index == out.n_indices && next_vertex == out.n_vertices;
+
+  // Batches of each key, concatenated, have to reproduce the commands recorded for that key.
+  size_t n_keys_used = 0;
+  size_t b = 0;
+  for( int k = 0; k < N_KEYS; ++k )
+  {
+    msh_draw_batches_t ref = msh_draw_cmdbuf_build( by_key[k] );
+    if( ref.n_indices == 0 ) { continue; }
+    ok &= ref.n_batches >= 1 && ref.vertices != NULL;
+    size_t ref_index = 0, ref_batch = 0;
+    uint32_t batch_vertices = 0;
+    while( b < out.n_batches && out.batches[b].state_key == keys[k] )
+    {
+      const msh_draw_batch_t* batch = &out.batches[b];
+      for( uint32_t j = 0; j < batch->n_indices && ref_index < ref.n_indices; ++j, ++ref_index )
+      {
+        const msh_draw_vertex_t* v = &out.vertices[batch->first_vertex + out.indices[batch->first_index + j]];
+        ok &= same_vertex( *v, *index_vertex( &ref, &ref_batch, ref_index ) );
+      }
+      batch_vertices += batch->n_vertices;
+      b++;
+    }
+    ok &= ref_index == ref.n_indices && batch_vertices == ref.n_vertices;
+    n_keys_used++;
+  }
+  ok &= b == out.n_batches;
+
+  // Without a limit, there is exactly one batch per key used.
+  if( !max_batch_vertices ) { ok &= out.n_batches == n_keys_used; }
+
+  msh_draw_stats_t stats = msh_draw_cmdbuf_get_stats( cb );
+  ok &= stats.n_commands == (size_t)n_cmds && stats.n_batches == out.n_batches && stats.n_vertices == out.n_vertices;
+  if( !ok ) { printf("  %d commands, max %u vertices per batch: FAILED\n", n_cmds, max_batch_vertices ); }
+
+  for( int k = 0; k < N_KEYS; ++k ) { msh_draw_cmdbuf_destroy( by_key[k] ); }
+  msh_draw_cmdbuf_destroy( cb );
+  return ok;
+}
+
+int
+validate_geometry( void )
+{
+  int ok = 1;
+  msh_draw_cmdbuf_t* cb = msh_draw_cmdbuf_create( 0 );
+  float line[] = { 10.0f, 10.0f, 20.0f, 10.0f };
+  uint32_t line_colors[] = { MSH_DRAW_RGBA( 0, 0, 0, 255 ), MSH_DRAW_RGBA( 0, 0, 0, 0 ) };
+  msh_draw_lines( cb, 0, line, line_colors, 1, 4.0f );
+  msh_draw_batches_t out = msh_draw_cmdbuf_build( cb );
+  msh_draw_vertex_t expected[] = { { 10.0f, 12.0f, line_colors[0] }, { 10.0f, 8.0f, line_colors[0] },
+                                   { 20.0f, 8.0f, line_colors[1] }, { 20.0f, 12.0f, line_colors[1] } };
+  ok &= out.n_vertices == 4 && out.n_indices == 6;
+  for( int i = 0; i < 4 && ok; ++i ) { ok &= same_vertex( out.vertices[i], expected[i] ); }
+
+  msh_draw_cmdbuf_reset( cb );
+  float center[] = { 100.0f, 50.0f }, radius = 7.0f;
+  uint32_t color = MSH_DRAW_RGBA( 1, 2, 3, 4 );
+  msh_draw_discs( cb, 0, center, &radius, &color, 1, 16 );
+  out = msh_draw_cmdbuf_build( cb );
+  ok &= out.n_vertices == 17 && out.n_indices == 48;
+  for( size_t i = 1; i < out.n_vertices; ++i )
+  {
+    float dx = out.vertices[i].x - center[0], dy = out.vertices[i].y - center[1];
+    ok &= fabsf( sqrtf( dx * dx + dy * dy ) - radius ) < 1e-4f && out.vertices[i].color == color;
+  }
+  if( !ok ) { printf("  line and disc geometry: FAILED\n"); }
+  msh_draw_cmdbuf_destroy( cb );
+  return ok;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+// Benchmarks, run with --bench
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+enum { N_BENCH_LINES = 10000 };
+
+typedef struct bench_data
+{
+  msh_draw_cmdbuf_t* cb;
+  float* xy;
+  uint32_t* colors;
+  int n_keys;
+} bench_data_t;
+
+// One frame: every line recorded as its own command, cycling through 'n_keys' state keys, then batched.
+void bench_frame( void* data, size_t n_iters )
+{
+  bench_data_t* d = data;
+  for( size_t it = 0; it < n_iters; ++it )
+  {
+    msh_draw_cmdbuf_reset( d->cb );
+    for( int i = 0; i < N_BENCH_LINES; ++i )
+    {
+      uint32_t key = MSH_DRAW_STATE_KEY( 0, MSH_DRAW_BLEND_ALPHA, i % d->n_keys );
+      msh_draw_lines( d->cb, key, d->xy + 4 * i, d->colors + 2 * i, 1, 2.0f );
+    }
+    msh_draw_batches_t batches = msh_draw_cmdbuf_build( d->cb );
+    MSH_BENCH_DO_NOT_OPTIMIZE( batches );
+  }
+}
+
+int run_benchmarks( int argc, char** argv )
+{
+  msh_rand_ctx_t rand_gen = {0};
+  msh_rand_init( &rand_gen, 12346 );
+  float* xy = malloc( 4 * N_BENCH_LINES * sizeof(float) );
+  uint32_t* colors = malloc( 2 * N_BENCH_LINES * sizeof(uint32_t) );
+  for( int i = 0; i < 4 * N_BENCH_LINES; ++i ) { xy[i] = msh_rand_nextf( &rand_gen ) * 256.0f; }
+  for( int i = 0; i < 2 * N_BENCH_LINES; ++i ) { colors[i] = MSH_DRAW_RGBA( 0, 0, 0, i & 255 ); }
+
+  bench_data_t d[3] = { { NULL, xy, colors, 1 }, { NULL, xy, colors, 4 }, { NULL, xy, colors, N_KEYS } };
+  const char* names[3] = { "lines, 1 state", "lines, 4 states", "lines, 8 states" };
+  msh_bench_t* b = msh_bench_create( argc, argv );
+  for( int k = 0; k < 3; ++k )
+  {
+    d[k].cb = msh_draw_cmdbuf_create( 0 );
+    msh_bench_add( b, names[k], bench_frame, &d[k], N_BENCH_LINES );
+  }
+  int n_regressions = msh_bench_run( b );
+  msh_bench_destroy( b );
+  for( int k = 0; k < 3; ++k ) { msh_draw_cmdbuf_destroy( d[k].cb ); }
+  free( xy );
+  free( colors );
+  return n_regressions ? 1 : 0;
+}
+
+int main( int argc, char** argv )
+{
+  if( msh_bench_requested( argc, argv ) ) { return run_benchmarks( argc, argv ); }
+  int n_failed = 0;
+  msh_rand_ctx_t rand_gen = {0};
+  msh_rand_init( &rand_gen, 12346 );
+
+  //----------------------------------------------------------------------------------------------
+  printf("Validation:\n");
+  {
+    int n_cmds[] = { 1, 2, 10, 100, 3000 };
+    uint32_t limits[] = { 0, 64, 1000 };
+    int n_cases = 0, n_ok = 0;
+    for( int i = 0; i < (int)msh_count_of( n_cmds ); ++i )
+    {
+      for( int j = 0; j < (int)msh_count_of( limits ); ++j )
+      {
+        n_ok += validate_batching( n_cmds[i], limits[j], &rand_gen );
+        n_cases++;
+      }
+    }
+    n_ok += validate_geometry();
+    n_cases++;
+    n_failed += n_cases - n_ok;
+    printf("  %d/%d cases passed\n", n_ok, n_cases );
+  }
+
+  //----------------------------------------------------------------------------------------------
+  enum { N_LINES = 100000 };
+  printf("CPU time per frame, %d lines with per-vertex alpha (best of %d frames):\n", N_LINES, N_RUNS );
+  {
+    float* xy = malloc( 4 * N_LINES * sizeof(float) );
+    uint32_t* colors = malloc( 2 * N_LINES * sizeof(uint32_t) );
+    for( int i = 0; i < N_LINES; ++i )
+    {
+      xy[4 * i + 0] = 128.0f;
+      xy[4 * i + 1] = 128.0f;
+      xy[4 * i + 2] = msh_rand_nextf( &rand_gen ) * 256.0f;
+      xy[4 * i + 3] = msh_rand_nextf( &rand_gen ) * 256.0f;
+      int alpha = (int)( 255 * msh_rand_nextf( &rand_gen ) );
+      colors[2 * i] = colors[2 * i + 1] = MSH_DRAW_RGBA( 0, 0, 0, alpha );
+    }
+
+    printf("  %-30s %10s %10s %10s %10s %10s\n", "", "record ms", "build ms", "commands", "batches", "vertices" );
+    const char* names[] = { "one line per command", "all lines in one command", "alternating 4 states" };
+    msh_draw_cmdbuf_t* cb = msh_draw_cmdbuf_create( 0 );
+    for( int mode = 0; mode < 3; ++mode )
+    {
+      double best_record = 1e30, best_build = 1e30;
+      msh_draw_stats_t stats = {0};
+      for( int run = 0; run < N_RUNS; ++run )
+      {
+        uint64_t t1 = msh_time_now();
+        msh_draw_cmdbuf_reset( cb );
+        if( mode == 1 ) { msh_draw_lines( cb, 0, xy, colors, N_LINES, 2.0f ); }
+        else
+        {
+          for( int i = 0; i < N_LINES; ++i )
+          {
+            uint32_t key = mode == 2 ? MSH_DRAW_STATE_KEY( 0, MSH_DRAW_BLEND_ALPHA, i & 3 ) : 0;
+            msh_draw_lines( cb, key, xy + 4 * i, colors + 2 * i, 1, 2.0f );
+          }
+        }
+        uint64_t t2 = msh_time_now();
+        msh_draw_cmdbuf_build( cb );
+        stats = msh_draw_cmdbuf_get_stats( cb );
+        best_record = msh_min( best_record, msh_time_diff( MSHT_MILLISECONDS, t2, t1 ) );
+        best_build = msh_min( best_build, stats.build_ms );
+      }
+      printf("  %-30s %10.3f %10.3f %10zu %10zu %10zu\n", names[mode], best_record, best_build,
+             stats.n_commands, stats.n_batches, stats.n_vertices );
+    }
+    printf("  (drawing every line with its own path, as before, takes %d draw calls)\n", N_LINES );
+    msh_draw_cmdbuf_destroy( cb );
+    free( xy );
+    free( colors );
+  }
+
+  printf("%d failed\n", n_failed );
+  return n_failed ? 1 : 0;
+}
@@ -4,25 +4,48 @@
   License: CC0
  
   Compilation: gcc -std=c99 -I<path_to_msh_libraries> msh_hash_grid_example.c -o msh_hash_grid_example -lglfw3 -lopengl32 -lglew32 -lnanovg
-  Usage:       msh_hash_grid_example
+  Usage:       msh_hash_grid_example [--bench]
   Description: This program showcases the usage of msh_hash_grid.h. It creates a window in which
                we visualize neighbors of a moving 2D point. Requires OpenGL, GLFW, GLEW and nanovg
-               to build.
+               to build. Lines to the neighbors are recorded into msh_draw_batch.h command buffer
+               and submitted in a few batches; the window title shows the batching statistics.
+               Frames are profiled with msh_prof.h; a report is printed on exit and a Chrome trace
+               is written to msh_hash_grid_example.json. With --bench, radius and nearest neighbor
+               searches over 100k points are measured with msh_bench.h instead, without a window,
+               with cache misses per query from msh_perf.h where hardware counters are available,
+               after reporting memory of the grid per point. Allocations are tracked per library
+               with msh_mem.h; memory per tag and allocations still live are printed on exit.
 */
 
+#define MSH_MEM_OVERRIDE
+#define MSH_MEM_IMPLEMENTATION
 #define MSH_STD_INCLUDE_LIBC_HEADERS
 #define MSH_STD_IMPLEMENTATION
 #define MSH_HASH_GRID_IMPLEMENTATION
 #define MSH_VEC_MATH_IMPLEMENTATION
+#define MSH_ALLOC_IMPLEMENTATION
+#define MSH_SORT_IMPLEMENTATION
+#define MSH_PROF_IMPLEMENTATION
+#define MSH_DRAW_BATCH_IMPLEMENTATION
+#define MSH_PERF_IMPLEMENTATION
+#define MSH_BENCH_IMPLEMENTATION
+#define MSH_DRAW_BATCH_GL
 #define GLFW_INCLUDE_GLEXT
 #define NANOVG_GL3_IMPLEMENTATION
 
 #include <GL/glew.h>    // TODO: replace with flextgl or smth
 #include <GLFW/glfw3.h> // TODO: replace with sokol_app.h
 
+#include "msh_mem.h"
 #include "msh/msh_std.h"
 #include "msh/msh_hash_grid.h"
 #include "msh/msh_vec_math.h"
+#include "msh_alloc.h"
+#include "msh_sort.h"
+#include "msh_prof.h"
+#include "msh_draw_batch.h"
+#include "msh_perf.h"
+#include "msh_bench.h"
 #include "nanovg/nanovg.h"
 #include "nanovg/nanovg_gl.h"
 
@@ -83,26 +106,98 @@ draw_lines( NVGcontext* vg, const msh_vec2_t* lines, size_t n_lines, style_t sty
   nvgStroke( vg );
 }
 
+uint32_t
+nvg_to_rgba( NVGcolor c )
+{
+  return MSH_DRAW_RGBA( c.r * 255.0f, c.g * 255.0f, c.b * 255.0f, c.a * 255.0f );
+}
+
+// All lines go into a single command, so they are drawn with one draw call.
 void
-draw_lines_alpha( NVGcontext* vg, const msh_vec2_t* lines, const float* alphas, size_t n_lines, style_t style )
+draw_lines_alpha( msh_draw_cmdbuf_t* cb, msh_arena_t* arena, const msh_vec2_t* lines,
+                  const float* alphas, size_t n_lines, style_t style )
 {
-  nvgStrokeWidth( vg, style.stroke_size );
-  for( size_t i = 0; i < n_lines ; i++)
+  uint32_t* colors = msh_arena_alloc( arena, 2 * n_lines * sizeof(uint32_t) );
+  for( size_t i = 0; i < n_lines; i++)
   {
     NVGcolor c = style.stroke_color;
     c.a = alphas[i];
-    nvgBeginPath( vg );
-    nvgStrokeColor( vg, c );
-    msh_vec2_t a = lines[2*i];
-    msh_vec2_t b = lines[2*i+1];
-    nvgMoveTo( vg, a.x, a.y );
-    nvgLineTo( vg, b.x, b.y );
-    nvgStroke( vg );
+    colors[2*i] = colors[2*i+1] = nvg_to_rgba( c );
   }
+  uint32_t key = MSH_DRAW_STATE_KEY( 0, MSH_DRAW_BLEND_ALPHA, 0 );
+  msh_draw_lines( cb, key, (const float*)lines, colors, n_lines, style.stroke_size );
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+// Benchmarks, run with --bench, before any window is created
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+enum { BENCH_N_PTS = 100000, BENCH_N_QUERIES = 1024, BENCH_MAX_N_NEIGH = 16 };
+
+typedef struct bench_data
+{
+  msh_hash_grid_t grid;
+  msh_hash_grid_search_desc_t search_opts;
+} bench_data_t;
+
+void bench_radius_search( void* data, size_t n_iters )
+{
+  bench_data_t* d = data;
+  for( size_t it = 0; it < n_iters; ++it )
+  {
+    int n_results = msh_hash_grid_radius_search( &d->grid, &d->search_opts );
+    MSH_BENCH_DO_NOT_OPTIMIZE( n_results );
+  }
+}
+
+void bench_knn_search( void* data, size_t n_iters )
+{
+  bench_data_t* d = data;
+  for( size_t it = 0; it < n_iters; ++it )
+  {
+    int n_results = msh_hash_grid_knn_search( &d->grid, &d->search_opts );
+    MSH_BENCH_DO_NOT_OPTIMIZE( n_results );
+  }
+}
+
+int run_benchmarks( int argc, char** argv )
+{
+  float domain_radius = 1000.0f;
+  msh_vec2_t* pts = generate_random_points_within_a_circle( msh_vec2( 0.0f, 0.0f ), domain_radius, BENCH_N_PTS );
+  msh_vec2_t* query_pts = generate_random_points_within_a_circle( msh_vec2( 0.0f, 0.0f ), domain_radius, BENCH_N_QUERIES );
+  float search_radius = 8.0f;
+  bench_data_t d = {0};
+  msh_mem_stats_t mem;
+  MSH_MEM_TAG_SCOPE( "msh_hash_grid" ) { msh_hash_grid_init_2d( &d.grid, (float*)&pts[0], BENCH_N_PTS, search_radius ); }
+  msh_mem_get_stats( "msh_hash_grid", &mem );
+  printf("Grid of %d points: %.2f bytes per point live, %.2f at peak, %zu allocations\n", BENCH_N_PTS,
+         mem.live_bytes / (double)BENCH_N_PTS, mem.peak_bytes / (double)BENCH_N_PTS, mem.n_allocs );
+  d.search_opts = (msh_hash_grid_search_desc_t){ .query_pts = (float*)&query_pts[0],
+                                                 .n_query_pts = BENCH_N_QUERIES,
+                                                 .radius = search_radius,
+                                                 .max_n_neigh = BENCH_MAX_N_NEIGH,
+                                                 .sort = 1,
+                                                 .distances_sq = malloc( BENCH_N_QUERIES * BENCH_MAX_N_NEIGH * sizeof(float) ),
+                                                 .indices = malloc( BENCH_N_QUERIES * BENCH_MAX_N_NEIGH * sizeof(int32_t) ),
+                                                 .n_neighbors = malloc( BENCH_N_QUERIES * sizeof(size_t) ) };
+
+  msh_bench_t* b = msh_bench_create( argc, argv );
+  msh_bench_add( b, "radius search, per query", bench_radius_search, &d, BENCH_N_QUERIES );
+  msh_bench_add( b, "knn search, per query", bench_knn_search, &d, BENCH_N_QUERIES );
+  int n_regressions = msh_bench_run( b );
+  msh_bench_destroy( b );
+  msh_hash_grid_term( &d.grid );
+  free( d.search_opts.distances_sq );
+  free( d.search_opts.indices );
+  free( d.search_opts.n_neighbors );
+  free( pts );
+  free( query_pts );
+  return n_regressions ? 1 : 0;
 }
 
 int main( int argc, char** argv )
 {
+  if( msh_bench_requested( argc, argv ) ) { return run_benchmarks( argc, argv ); }
   GLFWwindow* window;
   NVGcontext* vg = NULL;
   double prevt = 0;
@@ -139,6 +234,15 @@ int main( int argc, char** argv )
   }
 
   glfwSwapInterval(0);
+  msh_prof_init();
+  msh_mem_report_at_exit();
+
+  msh_draw_cmdbuf_t* draw_cmds = msh_draw_cmdbuf_create( 0 );
+  msh_draw_gl_t draw_gl = {0};
+  if( !msh_draw_gl_init( &draw_gl ) ) {
+    printf("Could not init msh_draw_batch.\n");
+    return -1;
+  }
 
   
   style_t lines_style = { .stroke_size  = 2.0f,
@@ -166,7 +270,7 @@ int main( int argc, char** argv )
 
   msh_hash_grid_t search_grid = {0};
   float search_radius = 64.0f;
-  msh_hash_grid_init_2d( &search_grid, (float*)&pts[0], n_pts, search_radius );
+  MSH_MEM_TAG_SCOPE( "msh_hash_grid" ) { msh_hash_grid_init_2d( &search_grid, (float*)&pts[0], n_pts, search_radius ); }
   int max_n_neigh = 10;
   msh_hash_grid_search_desc_t search_opts = { .radius = search_radius,
                                               .max_n_neigh = max_n_neigh,
@@ -181,6 +285,8 @@ int main( int argc, char** argv )
   float query_r = window_size/4.0f;
   while( !glfwWindowShouldClose(window) )
   {
+    MSH_PROF_BEGIN( "frame" );
+    MSH_PROF_BEGIN( "search" );
     uint64_t t1 = msh_time_now();
     uint64_t lt1 = msh_time_now();
     int win_width, win_height;
@@ -192,13 +298,16 @@ int main( int argc, char** argv )
     search_opts.query_pts = (float*)&query_pt;
     int n_results = msh_hash_grid_radius_search( &search_grid, &search_opts );
     // int n_results = msh_hash_grid_knn_search( &search_grid, &search_opts );
-    msh_vec2_t *result_pts = malloc( n_results * sizeof(msh_vec2_t) );
+
+    // Per-frame temporaries come from scratch arena, and are all released at the end of frame.
+    msh_scratch_t frame_scratch = msh_scratch_begin();
+    msh_vec2_t *result_pts = msh_arena_alloc( frame_scratch.arena, n_results * sizeof(msh_vec2_t) );
     for( int i = 0; i < n_results; ++i )
     {
       result_pts[i] = pts[ search_opts.indices[i] ];
     }
-    msh_vec2_t* connector_lines = malloc( n_results * 2 * sizeof(msh_vec2_t));
-    float* lines_intensity = malloc( n_results *  sizeof(float));
+    msh_vec2_t* connector_lines = msh_arena_alloc( frame_scratch.arena, n_results * 2 * sizeof(msh_vec2_t) );
+    float* lines_intensity = msh_arena_alloc( frame_scratch.arena, n_results * sizeof(float) );
     for( int i = n_results-1; i >= 0; --i )
     {
       connector_lines[2*i] = query_pt;
@@ -206,6 +315,7 @@ int main( int argc, char** argv )
       lines_intensity[i] = 1.0 - sqrt(search_opts.distances_sq[i]) / search_radius;
     }
     uint64_t lt2 = msh_time_now();
+    MSH_PROF_END();
     float logic_time = msh_time_diff(MSHT_MILLISECONDS, lt2, lt1);
     // Calculate pixel ration for hi-dpi devices.
     glfwGetWindowSize(window, &win_width, &win_height);
@@ -218,33 +328,53 @@ int main( int argc, char** argv )
     glClearColor(1.0f, 1.0f, 1.0f, 1.0f);
     glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT | GL_STENCIL_BUFFER_BIT);
 
+    MSH_PROF_BEGIN( "draw" );
     lt1 = msh_time_now();
     nvgBeginFrame(vg, win_width, win_height, px_ratio);
     draw_points( vg, &domain_origin, 1, domain_radius + 0.5*domain_style.stroke_size, domain_style );
     draw_points( vg, pts, n_pts, 3.0f, database_style );
-    draw_lines_alpha(  vg, connector_lines, lines_intensity, n_results, lines_style );
+    nvgEndFrame(vg);
+
+    // Lines are drawn between the two nanovg frames, so that they end up below result points.
+    msh_draw_cmdbuf_reset( draw_cmds );
+    draw_lines_alpha( draw_cmds, frame_scratch.arena, connector_lines, lines_intensity, n_results, lines_style );
+    msh_draw_batches_t line_batches = msh_draw_cmdbuf_build( draw_cmds );
+    msh_draw_gl_submit( &draw_gl, &line_batches, win_width, win_height );
+    msh_draw_stats_t draw_stats = msh_draw_cmdbuf_get_stats( draw_cmds );
+
+    nvgBeginFrame(vg, win_width, win_height, px_ratio);
     draw_points( vg, result_pts, n_results, 3.0f, result_style );
     draw_points( vg, &query_pt, 1, 4.5f, query_style );
     lt2 = msh_time_now();
     float upload_time = msh_time_diff(MSHT_MILLISECONDS, lt2, lt1);
 
     nvgEndFrame(vg);
+    MSH_PROF_END();
 
-    free( result_pts );
-    free( connector_lines );
-    free( lines_intensity );
+    msh_scratch_end( frame_scratch );
 
 
-    glfwSwapBuffers(window);
-    glfwPollEvents();
+    MSH_PROF_SCOPE( "swap" )
+    {
+      glfwSwapBuffers(window);
+      glfwPollEvents();
+    }
+    MSH_PROF_END(); // frame
     uint64_t t2 = msh_time_now();
     float elapsed_time = msh_time_diff( MSHT_SECONDS, t2, t1);
     query_theta += elapsed_time;
     char buf[1024];
-    sprintf(buf, "TEST: %fms.| %fms. | %fms.", logic_time, upload_time, msh_time_diff(MSHT_MILLISECONDS, t2, t1) );
+    sprintf(buf, "TEST: %fms.| %fms. | %fms. | %zu batches, %zu vertices, %fms.", logic_time, upload_time,
+            msh_time_diff(MSHT_MILLISECONDS, t2, t1), draw_stats.n_batches, draw_stats.n_vertices, draw_stats.build_ms );
     glfwSetWindowTitle( window, buf );
   }
 
+  msh_prof_print( stdout );
+  msh_prof_write_chrome_trace( "msh_hash_grid_example.json" );
+
+  msh_scratch_term();
+  msh_draw_gl_term( &draw_gl );
+  msh_draw_cmdbuf_destroy( draw_cmds );
   nvgDeleteGL3(vg);
   glfwTerminate();
   return 0;
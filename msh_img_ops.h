@@ -0,0 +1,2016 @@
+/*
+  ==============================================================================
+
+  MSH_IMG_OPS.H v0.1
+
+  A single header library with whole-image operations for the image types of msh_img_proc.h
+  (msh_img_ui8_t and msh_img_f32_t, 1-4 interleaved channels):
+
+    - resizing with nearest, bilinear, box and Lanczos filters
+    - separable convolution, box blur and Gaussian blur
+    - planar image types, conversion from and to interleaved layout, and planar sampling
+    - pipelines that chain operations and run them fused, band by band, on a job system
+
+  To use the library you simply add:
+
+  #include "msh_img_proc.h"
+  #include "msh_jobs.h"
+  #define MSH_IMG_OPS_IMPLEMENTATION
+  #include "msh_img_ops.h"
+
+  msh_img_proc.h and msh_jobs.h need to be included first, as they define the image types and
+  the job system pipelines run on.
+
+  ==============================================================================
+  DOCUMENTATION
+
+  Resizing
+    msh_img_ui8_t dst = mship_img_ui8_init( dst_width, dst_height, src.n_comp, 0 );
+    mship_resize_ui8( &src, &dst, MSHIP_FILTER_LANCZOS3 );
+
+    Resizes 'src' to the size of 'dst', which needs to be allocated and have the same number
+    of channels. Pixel centers are aligned, i.e. output pixel x samples the source at
+    (x + 0.5) * src_width / dst_width - 0.5, and source pixels outside the image are clamped
+    to the edge. Available filters:
+
+      MSHIP_FILTER_NEAREST  - copies the closest source pixel
+      MSHIP_FILTER_BILINEAR - interpolates 2x2 source pixels, same as mship_sample_bl_*
+      MSHIP_FILTER_BOX      - averages all source pixels covered by the output pixel
+      MSHIP_FILTER_LANCZOS3 - windowed sinc with 3 lobes, sharpest but may ring at edges
+
+    Bilinear filter does not widen when downscaling, so it aliases for factors below 0.5; use
+    box or Lanczos for thumbnails. Box and Lanczos filters are stretched by the downscaling
+    factor so that every source pixel contributes.
+
+    Filter weights are computed once per output row and column, and the image is filtered one
+    row at a time, horizontally then vertically or the other way around, whichever does less
+    work. Only as many rows of the first pass as the filter has taps are kept, so no
+    intermediate image is allocated. Inner loops are vectorized with SSE2, or AVX2 if the
+    compiler targets it (-mavx2). Define MSH_IMG_OPS_NO_SIMD to use the scalar code paths. ui8
+    images are filtered in float and rounded to nearest on output. Non-nearest resizing is a
+    single stage pipeline, run on the calling thread.
+
+  Filtering
+    float kernel[2 * 4 + 1];
+    mship_gaussian_kernel( 2.0f, 4, kernel );
+    mship_convolve_ui8( &src, &dst, kernel, 4, kernel, 4, MSHIP_BORDER_MIRROR );
+    mship_box_blur_ui8( &src, &dst, 5, MSHIP_BORDER_CLAMP );
+    mship_gaussian_blur_ui8( &src, &dst, 8.0f, MSHIP_BORDER_CLAMP );
+
+    Destination has the size and number of channels of the source. Convolution applies a
+    separable kernel, 'kernel_x' of 2 * radius_x + 1 weights along rows and 'kernel_y' along
+    columns (NULL skips an axis). Pixels outside of the image are taken from:
+
+      MSHIP_BORDER_CLAMP  - the closest edge pixel        aaa|abcd|ddd
+      MSHIP_BORDER_MIRROR - reflection about edge pixel   dcb|abcd|cba
+      MSHIP_BORDER_WRAP   - the opposite side of image    bcd|abcd|abc
+      MSHIP_BORDER_ZERO   - zeros                         000|abcd|000
+
+    Convolution costs O(radius) per pixel. Box blur averages (2 * radius + 1)^2 pixels in O(1)
+    per pixel, keeping running sums along rows and down columns in double precision. Gaussian
+    blur approximates a Gaussian of given sigma with three box blurs whose radii are returned by
+    mship_gaussian_box_radii, so it also runs in constant time per pixel. The approximation is
+    coarse for sigma below 2; use convolution with mship_gaussian_kernel when an exact Gaussian
+    is needed. Filtering runs as a pipeline on the calling thread; each operation is also
+    available as a pipeline stage.
+
+  Planar images
+    msh_img_planar_f32_t planar = mship_img_planar_f32_init( img.width, img.height, img.n_comp, 0 );
+    mship_deinterleave_f32( &img, &planar );                  // rgbrgb... -> rr..., gg..., bb...
+    float* red = mship_planar_plane_f32( &planar, 0 );
+    msh_img_f32_t green = mship_planar_view_f32( &planar, 1 ); // 1 channel image, no copy
+    mship_interleave_f32( &planar, &img );
+    mship_img_planar_f32_free( &planar );
+
+    Interleaved images keep the channels of a pixel together, so code that works on one channel
+    at a time reads them with a stride. Planar images store each channel contiguously, and
+    each plane can be viewed as a 1 channel image, so any operation in this file (and any loop
+    over a plane) uses full width vector loads. Conversions between layouts use SSE2 shuffles
+    for f32 images and byte packing for 2 and 4 channel ui8 images.
+
+    float rgb[3];
+    mship_planar_sample_bl_f32( &planar, x, y, rgb );
+    mship_planar_sample_many_bl_f32( &planar, xs, ys, n, out_planes );
+
+    Sampling puts pixel centers at integer coordinates and clamps coordinates to the image.
+    mship_planar_sample_many_* sample 'n' positions and write channel c of sample i to
+    out_planes[c][i]; with AVX2, they compute the indices and weights of 8 positions at once and
+    gather each plane with them.
+
+  Pipelines
+    mship_pipeline_t* p = mship_pipeline_create_ui8( &src );   // source is read as float
+    mship_pipeline_resize( p, src.width / 2, src.height / 2, MSHIP_FILTER_LANCZOS3 );
+    mship_pipeline_gaussian_blur( p, 1.5f, MSHIP_BORDER_MIRROR );
+    mship_pipeline_map_rows( p, fn, data );                    // custom per row operation
+    mship_pipeline_run_ui8( p, &dst, jobs );                   // or mship_pipeline_run_f32
+    mship_pipeline_destroy( p );
+
+    Stages are recorded and executed when the pipeline runs. Output image is split into bands of
+    rows, which are processed in parallel as jobs of 'jobs' (or on the calling thread if it is
+    NULL). Within a band, rows are pulled through the stages one at a time: a stage keeps a
+    ring of as many rows of the previous stage as it needs for one output row, so the working
+    set is a few rows per stage and no intermediate image is ever materialized. Rows near the
+    top of a band are recomputed by every band that needs them. All stages work on float rows;
+    ui8 sources are converted when read and ui8 outputs when written, so ui8 -> f32 -> ui8
+    conversion chains cost nothing extra.
+
+    void fn( float* row, int width, int n_comp, int y, void* data );
+
+    Row functions get one row of the previous stage output to modify in place, and are called
+    concurrently for different rows.
+
+    By default a run uses four bands per thread, at least MSHIP_PIPELINE_MIN_BAND_HEIGHT rows
+    each. mship_pipeline_set_band_height overrides it. Source image needs to stay alive until
+    the pipeline is destroyed, and a pipeline can be run many times.
+
+  ==============================================================================
+  AUTHORS:
+    Maciej Halber
+
+  LICENSE:
+    CC0
+  ==============================================================================
+*/
+
+#ifndef MSH_IMG_OPS_H
+#define MSH_IMG_OPS_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#ifndef MSH_IMG_OPS_DEF
+#ifdef MSH_IMG_OPS_STATIC
+#define MSH_IMG_OPS_DEF static
+#else
+#define MSH_IMG_OPS_DEF extern
+#endif
+#endif
+
+#ifndef MSHIP_PIPELINE_MAX_STAGES
+#define MSHIP_PIPELINE_MAX_STAGES 16
+#endif
+
+#ifndef MSHIP_PIPELINE_MIN_BAND_HEIGHT
+#define MSHIP_PIPELINE_MIN_BAND_HEIGHT 32
+#endif
+
+typedef enum mship_filter
+{
+  MSHIP_FILTER_NEAREST = 0,
+  MSHIP_FILTER_BILINEAR,
+  MSHIP_FILTER_BOX,
+  MSHIP_FILTER_LANCZOS3
+} mship_filter_t;
+
+typedef enum mship_border
+{
+  MSHIP_BORDER_CLAMP = 0,
+  MSHIP_BORDER_MIRROR,
+  MSHIP_BORDER_WRAP,
+  MSHIP_BORDER_ZERO
+} mship_border_t;
+
+// Planar images store each channel in its own plane of width * height values, 'plane_size'
+// values apart. Planes are padded so that each starts at a 64 byte offset from 'data'.
+typedef struct msh_img_planar_f32
+{
+  float* data;
+  int width, height, n_comp;
+  size_t plane_size;
+} msh_img_planar_f32_t;
+
+typedef struct msh_img_planar_ui8
+{
+  uint8_t* data;
+  int width, height, n_comp;
+  size_t plane_size;
+} msh_img_planar_ui8_t;
+
+typedef struct mship_pipeline mship_pipeline_t;
+typedef void (*mship_row_fn)( float* row, int width, int n_comp, int y, void* data );
+
+MSH_IMG_OPS_DEF void mship_resize_ui8( const msh_img_ui8_t* src, msh_img_ui8_t* dst,
+                                       mship_filter_t filter );
+MSH_IMG_OPS_DEF void mship_resize_f32( const msh_img_f32_t* src, msh_img_f32_t* dst,
+                                       mship_filter_t filter );
+
+MSH_IMG_OPS_DEF void mship_convolve_ui8( const msh_img_ui8_t* src, msh_img_ui8_t* dst,
+                                         const float* kernel_x, int radius_x,
+                                         const float* kernel_y, int radius_y,
+                                         mship_border_t border );
+MSH_IMG_OPS_DEF void mship_convolve_f32( const msh_img_f32_t* src, msh_img_f32_t* dst,
+                                         const float* kernel_x, int radius_x,
+                                         const float* kernel_y, int radius_y,
+                                         mship_border_t border );
+MSH_IMG_OPS_DEF void mship_box_blur_ui8( const msh_img_ui8_t* src, msh_img_ui8_t* dst,
+                                         int radius, mship_border_t border );
+MSH_IMG_OPS_DEF void mship_box_blur_f32( const msh_img_f32_t* src, msh_img_f32_t* dst,
+                                         int radius, mship_border_t border );
+MSH_IMG_OPS_DEF void mship_gaussian_blur_ui8( const msh_img_ui8_t* src, msh_img_ui8_t* dst,
+                                              float sigma, mship_border_t border );
+MSH_IMG_OPS_DEF void mship_gaussian_blur_f32( const msh_img_f32_t* src, msh_img_f32_t* dst,
+                                              float sigma, mship_border_t border );
+MSH_IMG_OPS_DEF void mship_gaussian_kernel( float sigma, int radius, float* kernel );
+MSH_IMG_OPS_DEF void mship_gaussian_box_radii( float sigma, int radii[3] );
+
+MSH_IMG_OPS_DEF msh_img_planar_f32_t mship_img_planar_f32_init( int width, int height, int n_comp,
+                                                                int zero_init );
+MSH_IMG_OPS_DEF msh_img_planar_ui8_t mship_img_planar_ui8_init( int width, int height, int n_comp,
+                                                                int zero_init );
+MSH_IMG_OPS_DEF void mship_img_planar_f32_free( msh_img_planar_f32_t* img );
+MSH_IMG_OPS_DEF void mship_img_planar_ui8_free( msh_img_planar_ui8_t* img );
+MSH_IMG_OPS_DEF float* mship_planar_plane_f32( const msh_img_planar_f32_t* img, int c );
+MSH_IMG_OPS_DEF uint8_t* mship_planar_plane_ui8( const msh_img_planar_ui8_t* img, int c );
+MSH_IMG_OPS_DEF msh_img_f32_t mship_planar_view_f32( const msh_img_planar_f32_t* img, int c );
+MSH_IMG_OPS_DEF msh_img_ui8_t mship_planar_view_ui8( const msh_img_planar_ui8_t* img, int c );
+MSH_IMG_OPS_DEF void mship_deinterleave_f32( const msh_img_f32_t* src, msh_img_planar_f32_t* dst );
+MSH_IMG_OPS_DEF void mship_interleave_f32( const msh_img_planar_f32_t* src, msh_img_f32_t* dst );
+MSH_IMG_OPS_DEF void mship_deinterleave_ui8( const msh_img_ui8_t* src, msh_img_planar_ui8_t* dst );
+MSH_IMG_OPS_DEF void mship_interleave_ui8( const msh_img_planar_ui8_t* src, msh_img_ui8_t* dst );
+MSH_IMG_OPS_DEF void mship_planar_sample_nn_f32( const msh_img_planar_f32_t* img, float x, float y,
+                                                 float* out );
+MSH_IMG_OPS_DEF void mship_planar_sample_bl_f32( const msh_img_planar_f32_t* img, float x, float y,
+                                                 float* out );
+MSH_IMG_OPS_DEF void mship_planar_sample_many_nn_f32( const msh_img_planar_f32_t* img,
+                                                      const float* xs, const float* ys, int n,
+                                                      float* const* out );
+MSH_IMG_OPS_DEF void mship_planar_sample_many_bl_f32( const msh_img_planar_f32_t* img,
+                                                      const float* xs, const float* ys, int n,
+                                                      float* const* out );
+
+MSH_IMG_OPS_DEF mship_pipeline_t* mship_pipeline_create_ui8( const msh_img_ui8_t* src );
+MSH_IMG_OPS_DEF mship_pipeline_t* mship_pipeline_create_f32( const msh_img_f32_t* src );
+MSH_IMG_OPS_DEF void mship_pipeline_destroy( mship_pipeline_t* p );
+MSH_IMG_OPS_DEF void mship_pipeline_resize( mship_pipeline_t* p, int width, int height,
+                                            mship_filter_t filter );
+MSH_IMG_OPS_DEF void mship_pipeline_convolve( mship_pipeline_t* p,
+                                              const float* kernel_x, int radius_x,
+                                              const float* kernel_y, int radius_y,
+                                              mship_border_t border );
+MSH_IMG_OPS_DEF void mship_pipeline_box_blur( mship_pipeline_t* p, int radius,
+                                              mship_border_t border );
+MSH_IMG_OPS_DEF void mship_pipeline_gaussian_blur( mship_pipeline_t* p, float sigma,
+                                                   mship_border_t border );
+MSH_IMG_OPS_DEF void mship_pipeline_map_rows( mship_pipeline_t* p, mship_row_fn fn, void* data );
+MSH_IMG_OPS_DEF void mship_pipeline_set_band_height( mship_pipeline_t* p, int n_rows );
+MSH_IMG_OPS_DEF void mship_pipeline_run_ui8( mship_pipeline_t* p, msh_img_ui8_t* dst,
+                                             msh_jobs_t* jobs );
+MSH_IMG_OPS_DEF void mship_pipeline_run_f32( mship_pipeline_t* p, msh_img_f32_t* dst,
+                                             msh_jobs_t* jobs );
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* MSH_IMG_OPS_H */
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+// IMPLEMENTATION
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+#ifdef MSH_IMG_OPS_IMPLEMENTATION
+
+#include <assert.h>
+#include <math.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#if !defined(MSH_IMG_OPS_NO_SIMD) && (defined(__SSE2__) || defined(_M_X64))
+#define MSH__IMG_SSE2 1
+#include <emmintrin.h>
+#if defined(__AVX2__)
+#define MSH__IMG_AVX2 1
+#include <immintrin.h>
+#endif
+#endif
+
+// Filters, pipeline buffers and images are tracked under "msh_img_ops" when msh_mem.h is
+// included first.
+#ifndef MSH_IMG_OPS_MALLOC
+#ifdef MSH_MEM_H
+#define MSH_IMG_OPS_MALLOC( size )        msh_mem_alloc( "msh_img_ops", size )
+#define MSH_IMG_OPS_CALLOC( count, size ) msh_mem_calloc( "msh_img_ops", count, size )
+#define MSH_IMG_OPS_FREE( ptr )           msh_mem_free( ptr )
+#else
+#define MSH_IMG_OPS_MALLOC( size )        malloc( size )
+#define MSH_IMG_OPS_CALLOC( count, size ) calloc( count, size )
+#define MSH_IMG_OPS_FREE( ptr )           free( ptr )
+#endif
+#endif
+
+// Filter weights of every output pixel are padded with zeros to a multiple of this, so that
+// single channel rows can be filtered with full vector loads.
+#define MSH__IMG_TAP_ALIGN 8
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+// Row conversions
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+static void
+mship__row_ui8_to_f32( const uint8_t* src, float* dst, int n )
+{
+  int i = 0;
+#if MSH__IMG_AVX2
+  for( ; i + 8 <= n; i += 8 )
+  {
+    __m128i b = _mm_loadl_epi64( (const __m128i*)(src + i) );
+    _mm256_storeu_ps( dst + i, _mm256_cvtepi32_ps( _mm256_cvtepu8_epi32( b ) ) );
+  }
+#elif MSH__IMG_SSE2
+  __m128i zero = _mm_setzero_si128();
+  for( ; i + 16 <= n; i += 16 )
+  {
+    __m128i b = _mm_loadu_si128( (const __m128i*)(src + i) );
+    __m128i lo = _mm_unpacklo_epi8( b, zero );
+    __m128i hi = _mm_unpackhi_epi8( b, zero );
+    _mm_storeu_ps( dst + i,      _mm_cvtepi32_ps( _mm_unpacklo_epi16( lo, zero ) ) );
+    _mm_storeu_ps( dst + i + 4,  _mm_cvtepi32_ps( _mm_unpackhi_epi16( lo, zero ) ) );
+    _mm_storeu_ps( dst + i + 8,  _mm_cvtepi32_ps( _mm_unpacklo_epi16( hi, zero ) ) );
+    _mm_storeu_ps( dst + i + 12, _mm_cvtepi32_ps( _mm_unpackhi_epi16( hi, zero ) ) );
+  }
+#endif
+  for( ; i < n; ++i ) { dst[i] = (float)src[i]; }
+}
+
+// Rounds to nearest, ties away from zero, and saturates to [0, 255].
+static void
+mship__row_f32_to_ui8( const float* src, uint8_t* dst, int n )
+{
+  int i = 0;
+#if MSH__IMG_SSE2
+  __m128 half = _mm_set1_ps( 0.5f );
+  __m128 zero = _mm_setzero_ps();
+  __m128 max = _mm_set1_ps( 255.0f );
+  for( ; i + 16 <= n; i += 16 )
+  {
+    __m128i a = _mm_cvttps_epi32( _mm_min_ps( _mm_max_ps( _mm_add_ps( _mm_loadu_ps( src + i ), half ), zero ), max ) );
+    __m128i b = _mm_cvttps_epi32( _mm_min_ps( _mm_max_ps( _mm_add_ps( _mm_loadu_ps( src + i + 4 ), half ), zero ), max ) );
+    __m128i c = _mm_cvttps_epi32( _mm_min_ps( _mm_max_ps( _mm_add_ps( _mm_loadu_ps( src + i + 8 ), half ), zero ), max ) );
+    __m128i d = _mm_cvttps_epi32( _mm_min_ps( _mm_max_ps( _mm_add_ps( _mm_loadu_ps( src + i + 12 ), half ), zero ), max ) );
+    _mm_storeu_si128( (__m128i*)(dst + i), _mm_packus_epi16( _mm_packs_epi32( a, b ), _mm_packs_epi32( c, d ) ) );
+  }
+#endif
+  for( ; i < n; ++i )
+  {
+    float v = src[i] + 0.5f;
+    v = v < 0.0f ? 0.0f : (v > 255.0f ? 255.0f : v);
+    dst[i] = (uint8_t)v;
+  }
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+// Filter weights
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+typedef struct mship__contribs
+{
+  int* first;        // first source pixel of each output pixel
+  float* weights;    // 'stride' weights per output pixel, of which 'n_taps' may be non-zero
+  int n_taps;
+  int stride;
+} mship__contribs_t;
+
+static double
+mship__filter_support( mship_filter_t filter )
+{
+  switch( filter )
+  {
+    case MSHIP_FILTER_BILINEAR: return 1.0;
+    case MSHIP_FILTER_BOX:      return 0.5;
+    case MSHIP_FILTER_LANCZOS3: return 3.0;
+    default:                    return 0.5;
+  }
+}
+
+static double
+mship__filter_eval( mship_filter_t filter, double x )
+{
+  switch( filter )
+  {
+    case MSHIP_FILTER_BILINEAR:
+      x = fabs( x );
+      return x < 1.0 ? 1.0 - x : 0.0;
+    case MSHIP_FILTER_BOX:
+      return ( x >= -0.5 && x < 0.5 ) ? 1.0 : 0.0;
+    case MSHIP_FILTER_LANCZOS3:
+    {
+      if( x == 0.0 ) { return 1.0; }
+      if( fabs( x ) >= 3.0 ) { return 0.0; }
+      double px = 3.14159265358979323846 * x;
+      return 3.0 * sin( px ) * sin( px / 3.0 ) / ( px * px );
+    }
+    default:
+      return 0.0;
+  }
+}
+
+// Every output pixel gets the same number of taps, and a window of taps always lies inside the
+// source, so kernels need no bounds checks. Taps that fall outside are folded into the edge
+// pixels, and the window is shifted inwards near the end of the source.
+static void
+mship__contribs_init( mship__contribs_t* c, int src_size, int dst_size, mship_filter_t filter )
+{
+  double scale = (double)dst_size / src_size;
+  double filter_scale = ( filter != MSHIP_FILTER_BILINEAR && scale < 1.0 ) ? scale : 1.0;
+  double support = mship__filter_support( filter ) / filter_scale;
+
+  int n_taps = 1;
+  for( int x = 0; x < dst_size; ++x )
+  {
+    double center = ( x + 0.5 ) / scale - 0.5;
+    int lo = (int)ceil( center - support );
+    int hi = (int)floor( center + support );
+    if( hi - lo + 1 > n_taps ) { n_taps = hi - lo + 1; }
+  }
+  if( n_taps > src_size ) { n_taps = src_size; }
+
+  c->n_taps = n_taps;
+  c->stride = ( n_taps + MSH__IMG_TAP_ALIGN - 1 ) / MSH__IMG_TAP_ALIGN * MSH__IMG_TAP_ALIGN;
+  c->first = (int*)MSH_IMG_OPS_MALLOC( dst_size * sizeof(int) );
+  c->weights = (float*)MSH_IMG_OPS_CALLOC( (size_t)dst_size * c->stride, sizeof(float) );
+
+  double* w = (double*)MSH_IMG_OPS_MALLOC( n_taps * sizeof(double) );
+  for( int x = 0; x < dst_size; ++x )
+  {
+    double center = ( x + 0.5 ) / scale - 0.5;
+    int lo = (int)ceil( center - support );
+    int hi = (int)floor( center + support );
+    int first = lo < 0 ? 0 : lo;
+    if( first > src_size - n_taps ) { first = src_size - n_taps; }
+
+    double sum = 0.0;
+    for( int k = 0; k < n_taps; ++k ) { w[k] = 0.0; }
+    for( int j = lo; j <= hi; ++j )
+    {
+      int idx = j < 0 ? 0 : ( j >= src_size ? src_size - 1 : j );
+      double v = mship__filter_eval( filter, ( j - center ) * filter_scale );
+      w[idx - first] += v;
+      sum += v;
+    }
+    if( sum == 0.0 )
+    {
+      int idx = (int)floor( center + 0.5 );
+      idx = idx < 0 ? 0 : ( idx >= src_size ? src_size - 1 : idx );
+      w[idx - first] = 1.0;
+      sum = 1.0;
+    }
+
+    c->first[x] = first;
+    float* cw = c->weights + (size_t)x * c->stride;
+    for( int k = 0; k < n_taps; ++k ) { cw[k] = (float)( w[k] / sum ); }
+  }
+  MSH_IMG_OPS_FREE( w );
+}
+
+static void
+mship__contribs_term( mship__contribs_t* c )
+{
+  MSH_IMG_OPS_FREE( c->first );
+  MSH_IMG_OPS_FREE( c->weights );
+  memset( c, 0, sizeof(*c) );
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+// Kernels
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+#if MSH__IMG_SSE2
+static inline float
+mship__hsum_ps( __m128 v )
+{
+  v = _mm_add_ps( v, _mm_movehl_ps( v, v ) );
+  v = _mm_add_ss( v, _mm_shuffle_ps( v, v, 1 ) );
+  return _mm_cvtss_f32( v );
+}
+#endif
+
+// Filters one row of 'n_comp' interleaved channels horizontally. 'src' needs to be readable for
+// stride pixels past its end, and 'dst' for 4 floats past its end. Kernels run over taps in
+// groups (weights past n_taps are zero), with two accumulators to hide the latency of adds.
+static void
+mship__filter_row_h( const float* src, float* dst, int dst_width, int n_comp,
+                     const mship__contribs_t* c )
+{
+  int n_taps = c->n_taps;
+#if MSH__IMG_SSE2
+  if( n_comp == 1 )
+  {
+    for( int x = 0; x < dst_width; ++x )
+    {
+      const float* w = c->weights + (size_t)x * c->stride;
+      const float* s = src + c->first[x];
+#if MSH__IMG_AVX2
+      __m256 acc8 = _mm256_setzero_ps();
+      for( int k = 0; k < n_taps; k += 8 )
+      {
+        acc8 = _mm256_add_ps( acc8, _mm256_mul_ps( _mm256_loadu_ps( w + k ), _mm256_loadu_ps( s + k ) ) );
+      }
+      __m128 acc = _mm_add_ps( _mm256_castps256_ps128( acc8 ), _mm256_extractf128_ps( acc8, 1 ) );
+#else
+      __m128 acc0 = _mm_setzero_ps(), acc1 = _mm_setzero_ps();
+      for( int k = 0; k < n_taps; k += 8 )
+      {
+        acc0 = _mm_add_ps( acc0, _mm_mul_ps( _mm_loadu_ps( w + k ), _mm_loadu_ps( s + k ) ) );
+        acc1 = _mm_add_ps( acc1, _mm_mul_ps( _mm_loadu_ps( w + k + 4 ), _mm_loadu_ps( s + k + 4 ) ) );
+      }
+      __m128 acc = _mm_add_ps( acc0, acc1 );
+#endif
+      dst[x] = mship__hsum_ps( acc );
+    }
+    return;
+  }
+  if( n_comp == 2 )
+  {
+    for( int x = 0; x < dst_width; ++x )
+    {
+      const float* w = c->weights + (size_t)x * c->stride;
+      const float* s = src + 2 * c->first[x];
+      __m128 acc0 = _mm_setzero_ps(), acc1 = _mm_setzero_ps();
+      for( int k = 0; k < n_taps; k += 4 )
+      {
+        __m128 wk = _mm_loadu_ps( w + k );
+        acc0 = _mm_add_ps( acc0, _mm_mul_ps( _mm_unpacklo_ps( wk, wk ), _mm_loadu_ps( s + 2 * k ) ) );
+        acc1 = _mm_add_ps( acc1, _mm_mul_ps( _mm_unpackhi_ps( wk, wk ), _mm_loadu_ps( s + 2 * k + 4 ) ) );
+      }
+      __m128 acc = _mm_add_ps( acc0, acc1 );
+      acc = _mm_add_ps( acc, _mm_movehl_ps( acc, acc ) );
+      _mm_storel_pi( (__m64*)( dst + 2 * x ), acc );
+    }
+    return;
+  }
+  if( n_comp == 4 )
+  {
+    for( int x = 0; x < dst_width; ++x )
+    {
+      const float* w = c->weights + (size_t)x * c->stride;
+      const float* s = src + 4 * c->first[x];
+#if MSH__IMG_AVX2
+      // Each 256-bit register holds two consecutive pixels.
+      __m256 acc0 = _mm256_setzero_ps(), acc1 = _mm256_setzero_ps();
+      for( int k = 0; k < n_taps; k += 4 )
+      {
+        __m256 w01 = _mm256_insertf128_ps( _mm256_castps128_ps256( _mm_set1_ps( w[k] ) ),
+                                           _mm_set1_ps( w[k + 1] ), 1 );
+        __m256 w23 = _mm256_insertf128_ps( _mm256_castps128_ps256( _mm_set1_ps( w[k + 2] ) ),
+                                           _mm_set1_ps( w[k + 3] ), 1 );
+        acc0 = _mm256_add_ps( acc0, _mm256_mul_ps( w01, _mm256_loadu_ps( s + 4 * k ) ) );
+        acc1 = _mm256_add_ps( acc1, _mm256_mul_ps( w23, _mm256_loadu_ps( s + 4 * k + 8 ) ) );
+      }
+      __m256 acc8 = _mm256_add_ps( acc0, acc1 );
+      __m128 acc = _mm_add_ps( _mm256_castps256_ps128( acc8 ), _mm256_extractf128_ps( acc8, 1 ) );
+#else
+      __m128 acc0 = _mm_setzero_ps(), acc1 = _mm_setzero_ps();
+      for( int k = 0; k < n_taps; k += 2 )
+      {
+        acc0 = _mm_add_ps( acc0, _mm_mul_ps( _mm_set1_ps( w[k] ), _mm_loadu_ps( s + 4 * k ) ) );
+        acc1 = _mm_add_ps( acc1, _mm_mul_ps( _mm_set1_ps( w[k + 1] ), _mm_loadu_ps( s + 4 * k + 4 ) ) );
+      }
+      __m128 acc = _mm_add_ps( acc0, acc1 );
+#endif
+      _mm_storeu_ps( dst + 4 * x, acc );
+    }
+    return;
+  }
+  if( n_comp == 3 )
+  {
+    // Fourth lane reads the next pixel and is overwritten by the next store.
+    for( int x = 0; x < dst_width; ++x )
+    {
+      const float* w = c->weights + (size_t)x * c->stride;
+      const float* s = src + 3 * c->first[x];
+      __m128 acc0 = _mm_setzero_ps(), acc1 = _mm_setzero_ps();
+      for( int k = 0; k < n_taps; k += 2 )
+      {
+        acc0 = _mm_add_ps( acc0, _mm_mul_ps( _mm_set1_ps( w[k] ), _mm_loadu_ps( s + 3 * k ) ) );
+        acc1 = _mm_add_ps( acc1, _mm_mul_ps( _mm_set1_ps( w[k + 1] ), _mm_loadu_ps( s + 3 * k + 3 ) ) );
+      }
+      _mm_storeu_ps( dst + 3 * x, _mm_add_ps( acc0, acc1 ) );
+    }
+    return;
+  }
+#endif
+  for( int x = 0; x < dst_width; ++x )
+  {
+    const float* w = c->weights + (size_t)x * c->stride;
+    const float* s = src + n_comp * c->first[x];
+    for( int ch = 0; ch < n_comp; ++ch )
+    {
+      float acc = 0.0f;
+      for( int k = 0; k < n_taps; ++k ) { acc += w[k] * s[k * n_comp + ch]; }
+      dst[x * n_comp + ch] = acc;
+    }
+  }
+}
+
+// dst[i] = sum_k w[k] * rows[k][i]
+static void
+mship__filter_rows_v( const float* const* rows, const float* w, int n_taps, float* dst, int n )
+{
+  int i = 0;
+#if MSH__IMG_AVX2
+  for( ; i + 32 <= n; i += 32 )
+  {
+    __m256 acc0 = _mm256_setzero_ps(), acc1 = _mm256_setzero_ps();
+    __m256 acc2 = _mm256_setzero_ps(), acc3 = _mm256_setzero_ps();
+    for( int k = 0; k < n_taps; ++k )
+    {
+      __m256 wk = _mm256_set1_ps( w[k] );
+      const float* r = rows[k] + i;
+      acc0 = _mm256_add_ps( acc0, _mm256_mul_ps( wk, _mm256_loadu_ps( r ) ) );
+      acc1 = _mm256_add_ps( acc1, _mm256_mul_ps( wk, _mm256_loadu_ps( r + 8 ) ) );
+      acc2 = _mm256_add_ps( acc2, _mm256_mul_ps( wk, _mm256_loadu_ps( r + 16 ) ) );
+      acc3 = _mm256_add_ps( acc3, _mm256_mul_ps( wk, _mm256_loadu_ps( r + 24 ) ) );
+    }
+    _mm256_storeu_ps( dst + i, acc0 );
+    _mm256_storeu_ps( dst + i + 8, acc1 );
+    _mm256_storeu_ps( dst + i + 16, acc2 );
+    _mm256_storeu_ps( dst + i + 24, acc3 );
+  }
+  for( ; i + 8 <= n; i += 8 )
+  {
+    __m256 acc = _mm256_setzero_ps();
+    for( int k = 0; k < n_taps; ++k )
+    {
+      acc = _mm256_add_ps( acc, _mm256_mul_ps( _mm256_set1_ps( w[k] ), _mm256_loadu_ps( rows[k] + i ) ) );
+    }
+    _mm256_storeu_ps( dst + i, acc );
+  }
+#elif MSH__IMG_SSE2
+  for( ; i + 16 <= n; i += 16 )
+  {
+    __m128 acc0 = _mm_setzero_ps(), acc1 = _mm_setzero_ps();
+    __m128 acc2 = _mm_setzero_ps(), acc3 = _mm_setzero_ps();
+    for( int k = 0; k < n_taps; ++k )
+    {
+      __m128 wk = _mm_set1_ps( w[k] );
+      const float* r = rows[k] + i;
+      acc0 = _mm_add_ps( acc0, _mm_mul_ps( wk, _mm_loadu_ps( r ) ) );
+      acc1 = _mm_add_ps( acc1, _mm_mul_ps( wk, _mm_loadu_ps( r + 4 ) ) );
+      acc2 = _mm_add_ps( acc2, _mm_mul_ps( wk, _mm_loadu_ps( r + 8 ) ) );
+      acc3 = _mm_add_ps( acc3, _mm_mul_ps( wk, _mm_loadu_ps( r + 12 ) ) );
+    }
+    _mm_storeu_ps( dst + i, acc0 );
+    _mm_storeu_ps( dst + i + 4, acc1 );
+    _mm_storeu_ps( dst + i + 8, acc2 );
+    _mm_storeu_ps( dst + i + 12, acc3 );
+  }
+  for( ; i + 4 <= n; i += 4 )
+  {
+    __m128 acc = _mm_setzero_ps();
+    for( int k = 0; k < n_taps; ++k )
+    {
+      acc = _mm_add_ps( acc, _mm_mul_ps( _mm_set1_ps( w[k] ), _mm_loadu_ps( rows[k] + i ) ) );
+    }
+    _mm_storeu_ps( dst + i, acc );
+  }
+#endif
+  for( ; i < n; ++i )
+  {
+    float acc = 0.0f;
+    for( int k = 0; k < n_taps; ++k ) { acc += w[k] * rows[k][i]; }
+    dst[i] = acc;
+  }
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+// Nearest neighbor resizing
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+// Copies whole pixels; the switch gives the compiler fixed size copies.
+static void
+mship__resize_nearest( const uint8_t* src, int src_width, int src_height, int pixel_size,
+                       uint8_t* dst, int dst_width, int dst_height )
+{
+  size_t* offsets = (size_t*)MSH_IMG_OPS_MALLOC( dst_width * sizeof(size_t) );
+  for( int x = 0; x < dst_width; ++x )
+  {
+    int sx = (int)( ( x + 0.5 ) * src_width / dst_width );
+    offsets[x] = (size_t)( sx < src_width ? sx : src_width - 1 ) * pixel_size;
+  }
+  for( int y = 0; y < dst_height; ++y )
+  {
+    int sy = (int)( ( y + 0.5 ) * src_height / dst_height );
+    sy = sy < src_height ? sy : src_height - 1;
+    const uint8_t* s = src + (size_t)sy * src_width * pixel_size;
+    uint8_t* d = dst + (size_t)y * dst_width * pixel_size;
+    switch( pixel_size )
+    {
+#define MSH__IMG_COPY_ROW( size ) \
+      case size: for( int x = 0; x < dst_width; ++x ) { memcpy( d + x * size, s + offsets[x], size ); } break;
+      MSH__IMG_COPY_ROW( 1 )
+      MSH__IMG_COPY_ROW( 2 )
+      MSH__IMG_COPY_ROW( 3 )
+      MSH__IMG_COPY_ROW( 4 )
+      MSH__IMG_COPY_ROW( 8 )
+      MSH__IMG_COPY_ROW( 12 )
+      MSH__IMG_COPY_ROW( 16 )
+#undef MSH__IMG_COPY_ROW
+      default:
+        for( int x = 0; x < dst_width; ++x ) { memcpy( d + x * pixel_size, s + offsets[x], pixel_size ); }
+    }
+  }
+  MSH_IMG_OPS_FREE( offsets );
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+// Pipelines
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+// Every stage produces one row of its output at a time, from 'n_taps' rows of the previous stage
+// output, given by 'rows' (-1 stands for a row of zeros). These input rows are kept in a ring of
+// n_taps rows. Row r is looked for in slot r % n_taps first; since windows of consecutive output
+// rows mostly move forward, each input row is produced once per band. Near the image borders
+// windows may repeat or jump back, and rows are then placed in the least recently used slot not
+// taken by the current window. Stages may transform rows on their way into the ring ('prepare'),
+// e.g. to filter them horizontally before they are combined vertically.
+typedef struct mship__stage mship__stage_t;
+
+// Per band state of a stage.
+typedef struct mship__stage_ctx
+{
+  float* scratch;             // 'scratch_len' floats, or a row of the larger of input and output
+  double* acc;                // running sums, one per element of an input row
+  const float** taps;
+  const float* zero_row;
+  int last_y;                 // last row produced, for stages that update running sums
+} mship__stage_ctx_t;
+
+struct mship__stage
+{
+  int width, height;          // of the stage output
+  int n_taps;
+  size_t ring_row_len;
+  size_t scratch_len;
+  void (*rows)( const mship__stage_t* s, int y, int* rows );
+  void (*prepare)( const mship__stage_t* s, const float* in, float* ring_row,
+                   mship__stage_ctx_t* ctx );
+  void (*produce)( const mship__stage_t* s, const float* const* rows, int y, float* out,
+                   mship__stage_ctx_t* ctx );
+
+  int in_width, in_height;
+  size_t in_row_len;
+  int n_comp;
+  mship__contribs_t cx, cy;
+  float* kernel_x;
+  float* kernel_y;
+  int radius_x, radius_y;
+  mship_border_t border;
+  mship_row_fn fn;
+  void* data;
+};
+
+struct mship_pipeline
+{
+  const void* src;
+  int src_width, src_height, n_comp;
+  int src_is_ui8;
+  int band_height;
+  int n_stages;
+  mship__stage_t stages[MSHIP_PIPELINE_MAX_STAGES];
+};
+
+// Per band state of a pipeline run; bands run independently, each with its own rings.
+typedef struct mship__band
+{
+  const mship_pipeline_t* p;
+  float* ring[MSHIP_PIPELINE_MAX_STAGES];
+  int* ring_ids[MSHIP_PIPELINE_MAX_STAGES];
+  int64_t* ring_stamps[MSHIP_PIPELINE_MAX_STAGES];
+  int64_t row_start[MSHIP_PIPELINE_MAX_STAGES];
+  size_t ring_stride[MSHIP_PIPELINE_MAX_STAGES];
+  float* tmp[MSHIP_PIPELINE_MAX_STAGES];
+  const float** taps[MSHIP_PIPELINE_MAX_STAGES];
+  int* idx[MSHIP_PIPELINE_MAX_STAGES];
+  mship__stage_ctx_t ctx[MSHIP_PIPELINE_MAX_STAGES];
+  int64_t clock;
+  float* zero_row;
+  float* out;
+} mship__band_t;
+
+static void
+mship__pipeline_out_size( const mship_pipeline_t* p, int* width, int* height )
+{
+  if( p->n_stages ) { *width = p->stages[p->n_stages - 1].width; *height = p->stages[p->n_stages - 1].height; }
+  else              { *width = p->src_width; *height = p->src_height; }
+}
+
+// Kernels may read a filter window past the end of a row and store a vector past its end, so
+// all row buffers get this many extra floats.
+static size_t
+mship__pipeline_row_pad( const mship_pipeline_t* p )
+{
+  size_t pad = 8;
+  for( int i = 0; i < p->n_stages; ++i )
+  {
+    size_t stage_pad = (size_t)( p->stages[i].cx.stride + 1 ) * p->n_comp + 8;
+    if( stage_pad > pad ) { pad = stage_pad; }
+  }
+  return pad;
+}
+
+static void
+mship__band_init( mship__band_t* b, const mship_pipeline_t* p )
+{
+  memset( b, 0, sizeof(*b) );
+  b->p = p;
+  size_t pad = mship__pipeline_row_pad( p );
+  size_t in_row_len = (size_t)p->src_width * p->n_comp;
+  size_t max_row_len = in_row_len;
+  for( int i = 0; i < p->n_stages; ++i )
+  {
+    const mship__stage_t* s = &p->stages[i];
+    size_t out_row_len = (size_t)s->width * p->n_comp;
+    size_t scratch_len = in_row_len > out_row_len ? in_row_len : out_row_len;
+    if( s->scratch_len > scratch_len ) { scratch_len = s->scratch_len; }
+    b->ring_stride[i] = s->ring_row_len + pad;
+    b->ring[i] = (float*)MSH_IMG_OPS_CALLOC( s->n_taps * b->ring_stride[i], sizeof(float) );
+    b->ring_ids[i] = (int*)MSH_IMG_OPS_MALLOC( s->n_taps * sizeof(int) );
+    b->ring_stamps[i] = (int64_t*)MSH_IMG_OPS_CALLOC( s->n_taps, sizeof(int64_t) );
+    for( int k = 0; k < s->n_taps; ++k ) { b->ring_ids[i][k] = -1; }
+    b->tmp[i] = s->prepare ? (float*)MSH_IMG_OPS_CALLOC( in_row_len + pad, sizeof(float) ) : NULL;
+    b->taps[i] = (const float**)MSH_IMG_OPS_MALLOC( s->n_taps * sizeof(float*) );
+    b->idx[i] = (int*)MSH_IMG_OPS_MALLOC( s->n_taps * sizeof(int) );
+    b->ctx[i].scratch = (float*)MSH_IMG_OPS_CALLOC( scratch_len + pad, sizeof(float) );
+    b->ctx[i].acc = (double*)MSH_IMG_OPS_CALLOC( in_row_len + 4, sizeof(double) );
+    b->ctx[i].taps = (const float**)MSH_IMG_OPS_MALLOC( ( 2 * s->radius_x + 1 ) * sizeof(float*) );
+    b->ctx[i].last_y = -2;
+    in_row_len = out_row_len;
+    if( out_row_len > max_row_len ) { max_row_len = out_row_len; }
+  }
+  b->zero_row = (float*)MSH_IMG_OPS_CALLOC( max_row_len + pad, sizeof(float) );
+  for( int i = 0; i < p->n_stages; ++i ) { b->ctx[i].zero_row = b->zero_row; }
+  b->out = (float*)MSH_IMG_OPS_CALLOC( in_row_len + pad, sizeof(float) );
+}
+
+static void
+mship__band_term( mship__band_t* b )
+{
+  for( int i = 0; i < b->p->n_stages; ++i )
+  {
+    MSH_IMG_OPS_FREE( b->ring[i] );
+    MSH_IMG_OPS_FREE( b->ring_ids[i] );
+    MSH_IMG_OPS_FREE( b->ring_stamps[i] );
+    MSH_IMG_OPS_FREE( b->tmp[i] );
+    MSH_IMG_OPS_FREE( (void*)b->taps[i] );
+    MSH_IMG_OPS_FREE( b->idx[i] );
+    MSH_IMG_OPS_FREE( b->ctx[i].scratch );
+    MSH_IMG_OPS_FREE( b->ctx[i].acc );
+    MSH_IMG_OPS_FREE( (void*)b->ctx[i].taps );
+  }
+  MSH_IMG_OPS_FREE( b->zero_row );
+  MSH_IMG_OPS_FREE( b->out );
+}
+
+static void mship__pipeline_row( mship__band_t* b, int stage, int y, float* out );
+
+static const float*
+mship__pipeline_fetch( mship__band_t* b, int stage, int r )
+{
+  if( r < 0 ) { return b->zero_row; }
+  const mship__stage_t* s = &b->p->stages[stage];
+  int n = s->n_taps;
+  int* ids = b->ring_ids[stage];
+  int64_t* stamps = b->ring_stamps[stage];
+  int slot = r % n;
+  if( ids[slot] != r )
+  {
+    int found = -1;
+    for( int k = 0; k < n && found < 0; ++k ) { if( ids[k] == r ) { found = k; } }
+    if( found >= 0 ) { slot = found; }
+    else
+    {
+      if( stamps[slot] >= b->row_start[stage] )
+      {
+        for( int k = 0; k < n; ++k ) { if( stamps[k] < stamps[slot] ) { slot = k; } }
+      }
+      float* ring_row = b->ring[stage] + slot * b->ring_stride[stage];
+      float* in = s->prepare ? b->tmp[stage] : ring_row;
+      mship__pipeline_row( b, stage - 1, r, in );
+      if( s->prepare ) { s->prepare( s, in, ring_row, &b->ctx[stage] ); }
+      ids[slot] = r;
+    }
+  }
+  stamps[slot] = ++b->clock;
+  return b->ring[stage] + slot * b->ring_stride[stage];
+}
+
+// Produces row y of the output of 'stage'; stage -1 is the source image.
+static void
+mship__pipeline_row( mship__band_t* b, int stage, int y, float* out )
+{
+  const mship_pipeline_t* p = b->p;
+  if( stage < 0 )
+  {
+    size_t row_len = (size_t)p->src_width * p->n_comp;
+    if( p->src_is_ui8 ) { mship__row_ui8_to_f32( (const uint8_t*)p->src + y * row_len, out, (int)row_len ); }
+    else                { memcpy( out, (const float*)p->src + y * row_len, row_len * sizeof(float) ); }
+    return;
+  }
+  const mship__stage_t* s = &p->stages[stage];
+  s->rows( s, y, b->idx[stage] );
+  b->row_start[stage] = b->clock + 1;
+  for( int k = 0; k < s->n_taps; ++k ) { b->taps[stage][k] = mship__pipeline_fetch( b, stage, b->idx[stage][k] ); }
+  s->produce( s, b->taps[stage], y, out, &b->ctx[stage] );
+}
+
+typedef struct mship__pipeline_run
+{
+  const mship_pipeline_t* p;
+  void* dst;
+  int dst_is_ui8;
+  int band_height;
+} mship__pipeline_run_t;
+
+static void
+mship__pipeline_band_job( void* data, size_t start, size_t end )
+{
+  mship__pipeline_run_t* run = (mship__pipeline_run_t*)data;
+  int width, height;
+  mship__pipeline_out_size( run->p, &width, &height );
+  size_t row_len = (size_t)width * run->p->n_comp;
+  for( size_t band = start; band < end; ++band )
+  {
+    mship__band_t b;
+    mship__band_init( &b, run->p );
+    int y0 = (int)band * run->band_height;
+    int y1 = y0 + run->band_height < height ? y0 + run->band_height : height;
+    for( int y = y0; y < y1; ++y )
+    {
+      mship__pipeline_row( &b, run->p->n_stages - 1, y, b.out );
+      if( run->dst_is_ui8 ) { mship__row_f32_to_ui8( b.out, (uint8_t*)run->dst + y * row_len, (int)row_len ); }
+      else                  { memcpy( (float*)run->dst + y * row_len, b.out, row_len * sizeof(float) ); }
+    }
+    mship__band_term( &b );
+  }
+}
+
+static void
+mship__pipeline_run( mship_pipeline_t* p, void* dst, int dst_is_ui8, msh_jobs_t* jobs )
+{
+  int width, height;
+  mship__pipeline_out_size( p, &width, &height );
+  int band_height = p->band_height;
+  if( band_height <= 0 )
+  {
+    // Few bands per thread for load balancing, but tall enough that refilling the rings at the
+    // top of every band stays cheap.
+    int n_bands = jobs ? 4 * msh_jobs_n_threads( jobs ) : 1;
+    band_height = ( height + n_bands - 1 ) / n_bands;
+    if( band_height < MSHIP_PIPELINE_MIN_BAND_HEIGHT ) { band_height = MSHIP_PIPELINE_MIN_BAND_HEIGHT; }
+  }
+  mship__pipeline_run_t run = { p, dst, dst_is_ui8, band_height };
+  size_t n_bands = ( height + band_height - 1 ) / band_height;
+  if( jobs && n_bands > 1 ) { msh_jobs_parallel_for( jobs, n_bands, 1, mship__pipeline_band_job, &run ); }
+  else                      { mship__pipeline_band_job( &run, 0, n_bands ); }
+}
+
+static mship_pipeline_t*
+mship__pipeline_create( const void* src, int width, int height, int n_comp, int is_ui8 )
+{
+  assert( n_comp >= 1 && n_comp <= 4 );
+  mship_pipeline_t* p = (mship_pipeline_t*)MSH_IMG_OPS_CALLOC( 1, sizeof(mship_pipeline_t) );
+  p->src = src;
+  p->src_width = width;
+  p->src_height = height;
+  p->n_comp = n_comp;
+  p->src_is_ui8 = is_ui8;
+  return p;
+}
+
+static mship__stage_t*
+mship__pipeline_push( mship_pipeline_t* p, int width, int height, int n_taps )
+{
+  assert( p->n_stages < MSHIP_PIPELINE_MAX_STAGES );
+  int in_width, in_height;
+  mship__pipeline_out_size( p, &in_width, &in_height );
+  mship__stage_t* s = &p->stages[p->n_stages++];
+  memset( s, 0, sizeof(*s) );
+  s->width = width;
+  s->height = height;
+  s->n_taps = n_taps;
+  s->n_comp = p->n_comp;
+  s->in_width = in_width;
+  s->in_height = in_height;
+  s->in_row_len = (size_t)in_width * p->n_comp;
+  return s;
+}
+
+MSH_IMG_OPS_DEF mship_pipeline_t*
+mship_pipeline_create_ui8( const msh_img_ui8_t* src )
+{
+  return mship__pipeline_create( src->data, src->width, src->height, src->n_comp, 1 );
+}
+
+MSH_IMG_OPS_DEF mship_pipeline_t*
+mship_pipeline_create_f32( const msh_img_f32_t* src )
+{
+  return mship__pipeline_create( src->data, src->width, src->height, src->n_comp, 0 );
+}
+
+MSH_IMG_OPS_DEF void
+mship_pipeline_destroy( mship_pipeline_t* p )
+{
+  for( int i = 0; i < p->n_stages; ++i )
+  {
+    mship__contribs_term( &p->stages[i].cx );
+    mship__contribs_term( &p->stages[i].cy );
+    MSH_IMG_OPS_FREE( p->stages[i].kernel_x );
+    MSH_IMG_OPS_FREE( p->stages[i].kernel_y );
+  }
+  MSH_IMG_OPS_FREE( p );
+}
+
+MSH_IMG_OPS_DEF void
+mship_pipeline_set_band_height( mship_pipeline_t* p, int n_rows )
+{
+  p->band_height = n_rows;
+}
+
+MSH_IMG_OPS_DEF void
+mship_pipeline_run_ui8( mship_pipeline_t* p, msh_img_ui8_t* dst, msh_jobs_t* jobs )
+{
+  int width, height;
+  mship__pipeline_out_size( p, &width, &height );
+  assert( dst->width == width && dst->height == height && dst->n_comp == p->n_comp );
+  mship__pipeline_run( p, dst->data, 1, jobs );
+}
+
+MSH_IMG_OPS_DEF void
+mship_pipeline_run_f32( mship_pipeline_t* p, msh_img_f32_t* dst, msh_jobs_t* jobs )
+{
+  int width, height;
+  mship__pipeline_out_size( p, &width, &height );
+  assert( dst->width == width && dst->height == height && dst->n_comp == p->n_comp );
+  mship__pipeline_run( p, dst->data, 0, jobs );
+}
+
+//--------------------------------------------------------------------------------------------------
+// Resize stage
+//--------------------------------------------------------------------------------------------------
+
+static void
+mship__resize_rows( const mship__stage_t* s, int y, int* rows )
+{
+  for( int k = 0; k < s->n_taps; ++k ) { rows[k] = s->cy.first[y] + k; }
+}
+
+static void
+mship__resize_prepare_h( const mship__stage_t* s, const float* in, float* ring_row,
+                         mship__stage_ctx_t* ctx )
+{
+  (void)ctx;
+  mship__filter_row_h( in, ring_row, s->width, s->n_comp, &s->cx );
+}
+
+static void
+mship__resize_produce_v( const mship__stage_t* s, const float* const* rows, int y, float* out,
+                         mship__stage_ctx_t* ctx )
+{
+  (void)ctx;
+  mship__filter_rows_v( rows, s->cy.weights + (size_t)y * s->cy.stride, s->n_taps, out,
+                        s->width * s->n_comp );
+}
+
+static void
+mship__resize_produce_vh( const mship__stage_t* s, const float* const* rows, int y, float* out,
+                          mship__stage_ctx_t* ctx )
+{
+  mship__filter_rows_v( rows, s->cy.weights + (size_t)y * s->cy.stride, s->n_taps, ctx->scratch,
+                        (int)s->in_row_len );
+  mship__filter_row_h( ctx->scratch, out, s->width, s->n_comp, &s->cx );
+}
+
+// Rows are filtered in whichever pass order does less work: filtering input rows horizontally
+// first is cheaper when upscaling, while filtering vertically first touches far fewer pixels when
+// downscaling.
+MSH_IMG_OPS_DEF void
+mship_pipeline_resize( mship_pipeline_t* p, int width, int height, mship_filter_t filter )
+{
+  int in_width, in_height;
+  mship__pipeline_out_size( p, &in_width, &in_height );
+  mship__contribs_t cx, cy;
+  mship__contribs_init( &cx, in_width, width, filter );
+  mship__contribs_init( &cy, in_height, height, filter );
+
+  double n_rows_read = (double)height * cy.n_taps;
+  if( n_rows_read > in_height ) { n_rows_read = in_height; }
+  double cost_h_first = n_rows_read * width * cx.n_taps + (double)height * width * cy.n_taps;
+  double cost_v_first = (double)height * in_width * cy.n_taps + (double)height * width * cx.n_taps;
+
+  mship__stage_t* s = mship__pipeline_push( p, width, height, cy.n_taps );
+  s->cx = cx;
+  s->cy = cy;
+  s->rows = mship__resize_rows;
+  if( cost_h_first <= cost_v_first )
+  {
+    s->ring_row_len = (size_t)width * p->n_comp;
+    s->prepare = mship__resize_prepare_h;
+    s->produce = mship__resize_produce_v;
+  }
+  else
+  {
+    s->ring_row_len = s->in_row_len;
+    s->produce = mship__resize_produce_vh;
+  }
+}
+
+//--------------------------------------------------------------------------------------------------
+// Row function stage
+//--------------------------------------------------------------------------------------------------
+
+static void
+mship__map_rows( const mship__stage_t* s, int y, int* rows )
+{
+  (void)s;
+  rows[0] = y;
+}
+
+static void
+mship__map_produce( const mship__stage_t* s, const float* const* rows, int y, float* out,
+                    mship__stage_ctx_t* ctx )
+{
+  (void)ctx;
+  memcpy( out, rows[0], s->in_row_len * sizeof(float) );
+  s->fn( out, s->width, s->n_comp, y, s->data );
+}
+
+MSH_IMG_OPS_DEF void
+mship_pipeline_map_rows( mship_pipeline_t* p, mship_row_fn fn, void* data )
+{
+  int width, height;
+  mship__pipeline_out_size( p, &width, &height );
+  mship__stage_t* s = mship__pipeline_push( p, width, height, 1 );
+  s->ring_row_len = s->in_row_len;
+  s->rows = mship__map_rows;
+  s->produce = mship__map_produce;
+  s->fn = fn;
+  s->data = data;
+}
+
+//--------------------------------------------------------------------------------------------------
+// Convolution stages
+//--------------------------------------------------------------------------------------------------
+
+// Maps row or column i of an n pixel wide axis inside the image, or returns -1 for zero borders.
+static int
+mship__border_index( int i, int n, mship_border_t border )
+{
+  if( i >= 0 && i < n ) { return i; }
+  switch( border )
+  {
+    case MSHIP_BORDER_CLAMP:  return i < 0 ? 0 : n - 1;
+    case MSHIP_BORDER_WRAP:   i %= n; return i < 0 ? i + n : i;
+    case MSHIP_BORDER_MIRROR:
+    {
+      if( n == 1 ) { return 0; }
+      int period = 2 * n - 2;
+      i %= period;
+      if( i < 0 ) { i += period; }
+      return i < n ? i : period - i;
+    }
+    default: return -1;
+  }
+}
+
+// Copies a row into 'ext' with 'left' and 'right' pixels of border added on either side.
+static void
+mship__border_extend( const float* in, int width, int n_comp, int left, int right,
+                      mship_border_t border, float* ext )
+{
+  memcpy( ext + left * n_comp, in, (size_t)width * n_comp * sizeof(float) );
+  for( int j = 0; j < left + right; ++j )
+  {
+    int x = j < left ? j - left : width + j - left;
+    float* dst = ext + ( x + left ) * n_comp;
+    int i = mship__border_index( x, width, border );
+    if( i < 0 ) { memset( dst, 0, n_comp * sizeof(float) ); }
+    else        { memcpy( dst, in + i * n_comp, n_comp * sizeof(float) ); }
+  }
+}
+
+static void
+mship__convolve_rows( const mship__stage_t* s, int y, int* rows )
+{
+  for( int k = 0; k < s->n_taps; ++k )
+  {
+    rows[k] = mship__border_index( y - s->radius_y + k, s->in_height, s->border );
+  }
+}
+
+// Shifted copies of the extended row line up the taps of all pixels, so the horizontal pass is a
+// weighted sum of rows, vectorized across pixels and channels alike.
+static void
+mship__convolve_prepare_h( const mship__stage_t* s, const float* in, float* ring_row,
+                           mship__stage_ctx_t* ctx )
+{
+  int r = s->radius_x;
+  mship__border_extend( in, s->in_width, s->n_comp, r, r, s->border, ctx->scratch );
+  for( int k = 0; k < 2 * r + 1; ++k ) { ctx->taps[k] = ctx->scratch + k * s->n_comp; }
+  mship__filter_rows_v( ctx->taps, s->kernel_x, 2 * r + 1, ring_row, s->width * s->n_comp );
+}
+
+static void
+mship__convolve_produce_v( const mship__stage_t* s, const float* const* rows, int y, float* out,
+                           mship__stage_ctx_t* ctx )
+{
+  (void)y; (void)ctx;
+  mship__filter_rows_v( rows, s->kernel_y, s->n_taps, out, s->width * s->n_comp );
+}
+
+static float*
+mship__kernel_copy( const float* kernel, int radius )
+{
+  float* copy = (float*)MSH_IMG_OPS_MALLOC( ( 2 * radius + 1 ) * sizeof(float) );
+  if( kernel ) { memcpy( copy, kernel, ( 2 * radius + 1 ) * sizeof(float) ); }
+  else         { copy[0] = 1.0f; }
+  return copy;
+}
+
+MSH_IMG_OPS_DEF void
+mship_pipeline_convolve( mship_pipeline_t* p, const float* kernel_x, int radius_x,
+                         const float* kernel_y, int radius_y, mship_border_t border )
+{
+  if( !kernel_x ) { radius_x = 0; }
+  if( !kernel_y ) { radius_y = 0; }
+  int width, height;
+  mship__pipeline_out_size( p, &width, &height );
+  mship__stage_t* s = mship__pipeline_push( p, width, height, 2 * radius_y + 1 );
+  s->ring_row_len = s->in_row_len;
+  s->scratch_len = (size_t)( width + 2 * radius_x ) * p->n_comp;
+  s->kernel_x = mship__kernel_copy( kernel_x, radius_x );
+  s->kernel_y = mship__kernel_copy( kernel_y, radius_y );
+  s->radius_x = radius_x;
+  s->radius_y = radius_y;
+  s->border = border;
+  s->rows = mship__convolve_rows;
+  s->prepare = mship__convolve_prepare_h;
+  s->produce = mship__convolve_produce_v;
+}
+
+MSH_IMG_OPS_DEF void
+mship_gaussian_kernel( float sigma, int radius, float* kernel )
+{
+  double sum = 0.0;
+  for( int k = -radius; k <= radius; ++k )
+  {
+    kernel[k + radius] = sigma > 0.0f ? expf( -0.5f * k * k / ( sigma * sigma ) ) : (float)( k == 0 );
+    sum += kernel[k + radius];
+  }
+  for( int k = 0; k < 2 * radius + 1; ++k ) { kernel[k] = (float)( kernel[k] / sum ); }
+}
+
+//--------------------------------------------------------------------------------------------------
+// Box blur stage
+//--------------------------------------------------------------------------------------------------
+
+// Box filters keep running sums, so their cost does not depend on the radius. Sums are kept in
+// double, where adding and removing float values is exact enough not to drift over a row.
+static void
+mship__box_row_h( const float* ext, float* out, int width, int n_comp, int r )
+{
+  double scale = 1.0 / ( 2 * r + 1 );
+  const float* add = ext + ( 2 * r + 1 ) * n_comp;
+  const float* sub = ext;
+  int x = 0;
+#if MSH__IMG_AVX2
+  if( n_comp >= 3 )
+  {
+    // 3 channel pixels carry the next pixel's first channel along in the fourth lane. Its sum is
+    // stored past the pixel and overwritten by the next one.
+    __m256d acc = _mm256_setzero_pd();
+    for( int k = 1; k <= 2 * r + 1; ++k ) { acc = _mm256_add_pd( acc, _mm256_cvtps_pd( _mm_loadu_ps( ext + k * n_comp ) ) ); }
+    _mm_storeu_ps( out, _mm256_cvtpd_ps( _mm256_mul_pd( acc, _mm256_set1_pd( scale ) ) ) );
+    for( x = 1; x < width; ++x )
+    {
+      __m256d a = _mm256_cvtps_pd( _mm_loadu_ps( add + x * n_comp ) );
+      __m256d b = _mm256_cvtps_pd( _mm_loadu_ps( sub + x * n_comp ) );
+      acc = _mm256_add_pd( acc, _mm256_sub_pd( a, b ) );
+      _mm_storeu_ps( out + x * n_comp, _mm256_cvtpd_ps( _mm256_mul_pd( acc, _mm256_set1_pd( scale ) ) ) );
+    }
+    return;
+  }
+#elif MSH__IMG_SSE2
+  if( n_comp >= 3 )
+  {
+    __m128d acc_lo = _mm_setzero_pd(), acc_hi = _mm_setzero_pd();
+    __m128d s = _mm_set1_pd( scale );
+    for( int k = 1; k <= 2 * r + 1; ++k )
+    {
+      __m128 v = _mm_loadu_ps( ext + k * n_comp );
+      acc_lo = _mm_add_pd( acc_lo, _mm_cvtps_pd( v ) );
+      acc_hi = _mm_add_pd( acc_hi, _mm_cvtps_pd( _mm_movehl_ps( v, v ) ) );
+    }
+    for( x = 0; x < width; ++x )
+    {
+      if( x > 0 )
+      {
+        __m128 a = _mm_loadu_ps( add + x * n_comp );
+        __m128 b = _mm_loadu_ps( sub + x * n_comp );
+        acc_lo = _mm_add_pd( acc_lo, _mm_sub_pd( _mm_cvtps_pd( a ), _mm_cvtps_pd( b ) ) );
+        acc_hi = _mm_add_pd( acc_hi, _mm_sub_pd( _mm_cvtps_pd( _mm_movehl_ps( a, a ) ),
+                                                 _mm_cvtps_pd( _mm_movehl_ps( b, b ) ) ) );
+      }
+      __m128 lo = _mm_cvtpd_ps( _mm_mul_pd( acc_lo, s ) );
+      __m128 hi = _mm_cvtpd_ps( _mm_mul_pd( acc_hi, s ) );
+      _mm_storeu_ps( out + x * n_comp, _mm_movelh_ps( lo, hi ) );
+    }
+    return;
+  }
+#endif
+  double acc[4] = { 0.0, 0.0, 0.0, 0.0 };
+  for( int k = 1; k <= 2 * r + 1; ++k )
+  {
+    for( int c = 0; c < n_comp; ++c ) { acc[c] += ext[k * n_comp + c]; }
+  }
+  for( ; x < width; ++x )
+  {
+    for( int c = 0; c < n_comp; ++c )
+    {
+      if( x > 0 ) { acc[c] += (double)add[x * n_comp + c] - sub[x * n_comp + c]; }
+      out[x * n_comp + c] = (float)( acc[c] * scale );
+    }
+  }
+}
+
+// acc[i] += add[i] - sub[i], out[i] = acc[i] * scale
+static void
+mship__box_update_v( double* acc, const float* add, const float* sub, double scale, float* out,
+                     int n )
+{
+  int i = 0;
+#if MSH__IMG_AVX2
+  __m256d s = _mm256_set1_pd( scale );
+  for( ; i + 4 <= n; i += 4 )
+  {
+    __m256d a = _mm256_cvtps_pd( _mm_loadu_ps( add + i ) );
+    __m256d b = _mm256_cvtps_pd( _mm_loadu_ps( sub + i ) );
+    __m256d v = _mm256_add_pd( _mm256_loadu_pd( acc + i ), _mm256_sub_pd( a, b ) );
+    _mm256_storeu_pd( acc + i, v );
+    _mm_storeu_ps( out + i, _mm256_cvtpd_ps( _mm256_mul_pd( v, s ) ) );
+  }
+#elif MSH__IMG_SSE2
+  __m128d s = _mm_set1_pd( scale );
+  for( ; i + 4 <= n; i += 4 )
+  {
+    __m128 a = _mm_loadu_ps( add + i );
+    __m128 b = _mm_loadu_ps( sub + i );
+    __m128d lo = _mm_add_pd( _mm_loadu_pd( acc + i ), _mm_sub_pd( _mm_cvtps_pd( a ), _mm_cvtps_pd( b ) ) );
+    __m128d hi = _mm_add_pd( _mm_loadu_pd( acc + i + 2 ),
+                             _mm_sub_pd( _mm_cvtps_pd( _mm_movehl_ps( a, a ) ), _mm_cvtps_pd( _mm_movehl_ps( b, b ) ) ) );
+    _mm_storeu_pd( acc + i, lo );
+    _mm_storeu_pd( acc + i + 2, hi );
+    _mm_storeu_ps( out + i, _mm_movelh_ps( _mm_cvtpd_ps( _mm_mul_pd( lo, s ) ),
+                                           _mm_cvtpd_ps( _mm_mul_pd( hi, s ) ) ) );
+  }
+#endif
+  for( ; i < n; ++i )
+  {
+    acc[i] += (double)add[i] - sub[i];
+    out[i] = (float)( acc[i] * scale );
+  }
+}
+
+// Window of output row y spans input rows y - r - 1 to y + r; the first row only leaves the sum.
+static void
+mship__box_rows( const mship__stage_t* s, int y, int* rows )
+{
+  for( int k = 0; k < s->n_taps; ++k )
+  {
+    rows[k] = mship__border_index( y - s->radius_y - 1 + k, s->in_height, s->border );
+  }
+}
+
+static void
+mship__box_prepare_h( const mship__stage_t* s, const float* in, float* ring_row,
+                      mship__stage_ctx_t* ctx )
+{
+  int r = s->radius_x;
+  mship__border_extend( in, s->in_width, s->n_comp, r + 1, r, s->border, ctx->scratch );
+  mship__box_row_h( ctx->scratch, ring_row, s->width, s->n_comp, r );
+}
+
+static void
+mship__box_produce_v( const mship__stage_t* s, const float* const* rows, int y, float* out,
+                      mship__stage_ctx_t* ctx )
+{
+  int n = s->width * s->n_comp;
+  int n_taps = s->n_taps;
+  double scale = 1.0 / ( n_taps - 1 );
+  if( ctx->last_y != y - 1 )
+  {
+    memset( ctx->acc, 0, n * sizeof(double) );
+    for( int k = 1; k < n_taps - 1; ++k )
+    {
+      for( int i = 0; i < n; ++i ) { ctx->acc[i] += rows[k][i]; }
+    }
+    mship__box_update_v( ctx->acc, rows[n_taps - 1], ctx->zero_row, scale, out, n );
+  }
+  else
+  {
+    mship__box_update_v( ctx->acc, rows[n_taps - 1], rows[0], scale, out, n );
+  }
+  ctx->last_y = y;
+}
+
+MSH_IMG_OPS_DEF void
+mship_pipeline_box_blur( mship_pipeline_t* p, int radius, mship_border_t border )
+{
+  int width, height;
+  mship__pipeline_out_size( p, &width, &height );
+  mship__stage_t* s = mship__pipeline_push( p, width, height, 2 * radius + 2 );
+  s->ring_row_len = s->in_row_len;
+  s->scratch_len = (size_t)( width + 2 * radius + 1 ) * p->n_comp;
+  s->radius_x = radius;
+  s->radius_y = radius;
+  s->border = border;
+  s->rows = mship__box_rows;
+  s->prepare = mship__box_prepare_h;
+  s->produce = mship__box_produce_v;
+}
+
+// Radii of three boxes whose variances add up as close as possible to sigma^2, following
+// P. Kovesi, "Fast Almost-Gaussian Filtering", 2010.
+MSH_IMG_OPS_DEF void
+mship_gaussian_box_radii( float sigma, int radii[3] )
+{
+  int n = 3;
+  double v = 12.0 * sigma * sigma;
+  int wl = (int)floor( sqrt( v / n + 1.0 ) );
+  if( wl % 2 == 0 ) { wl--; }
+  if( wl < 1 ) { wl = 1; }
+  int m = (int)floor( ( v - n * wl * wl - 4.0 * n * wl - 3.0 * n ) / ( -4.0 * wl - 4.0 ) + 0.5 );
+  for( int i = 0; i < n; ++i ) { radii[i] = ( ( i < m ? wl : wl + 2 ) - 1 ) / 2; }
+}
+
+MSH_IMG_OPS_DEF void
+mship_pipeline_gaussian_blur( mship_pipeline_t* p, float sigma, mship_border_t border )
+{
+  int radii[3];
+  mship_gaussian_box_radii( sigma, radii );
+  for( int i = 0; i < 3; ++i ) { if( radii[i] > 0 ) { mship_pipeline_box_blur( p, radii[i], border ); } }
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+// Resizing
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+MSH_IMG_OPS_DEF void
+mship_resize_ui8( const msh_img_ui8_t* src, msh_img_ui8_t* dst, mship_filter_t filter )
+{
+  assert( src->n_comp == dst->n_comp && src->n_comp >= 1 && src->n_comp <= 4 );
+  if( filter == MSHIP_FILTER_NEAREST )
+  {
+    mship__resize_nearest( src->data, src->width, src->height, src->n_comp,
+                           dst->data, dst->width, dst->height );
+    return;
+  }
+  mship_pipeline_t* p = mship_pipeline_create_ui8( src );
+  mship_pipeline_resize( p, dst->width, dst->height, filter );
+  mship_pipeline_run_ui8( p, dst, NULL );
+  mship_pipeline_destroy( p );
+}
+
+MSH_IMG_OPS_DEF void
+mship_resize_f32( const msh_img_f32_t* src, msh_img_f32_t* dst, mship_filter_t filter )
+{
+  assert( src->n_comp == dst->n_comp && src->n_comp >= 1 && src->n_comp <= 4 );
+  if( filter == MSHIP_FILTER_NEAREST )
+  {
+    mship__resize_nearest( (const uint8_t*)src->data, src->width, src->height,
+                           src->n_comp * (int)sizeof(float),
+                           (uint8_t*)dst->data, dst->width, dst->height );
+    return;
+  }
+  mship_pipeline_t* p = mship_pipeline_create_f32( src );
+  mship_pipeline_resize( p, dst->width, dst->height, filter );
+  mship_pipeline_run_f32( p, dst, NULL );
+  mship_pipeline_destroy( p );
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+// Filtering
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+MSH_IMG_OPS_DEF void
+mship_convolve_ui8( const msh_img_ui8_t* src, msh_img_ui8_t* dst, const float* kernel_x,
+                    int radius_x, const float* kernel_y, int radius_y, mship_border_t border )
+{
+  mship_pipeline_t* p = mship_pipeline_create_ui8( src );
+  mship_pipeline_convolve( p, kernel_x, radius_x, kernel_y, radius_y, border );
+  mship_pipeline_run_ui8( p, dst, NULL );
+  mship_pipeline_destroy( p );
+}
+
+MSH_IMG_OPS_DEF void
+mship_convolve_f32( const msh_img_f32_t* src, msh_img_f32_t* dst, const float* kernel_x,
+                    int radius_x, const float* kernel_y, int radius_y, mship_border_t border )
+{
+  mship_pipeline_t* p = mship_pipeline_create_f32( src );
+  mship_pipeline_convolve( p, kernel_x, radius_x, kernel_y, radius_y, border );
+  mship_pipeline_run_f32( p, dst, NULL );
+  mship_pipeline_destroy( p );
+}
+
+MSH_IMG_OPS_DEF void
+mship_box_blur_ui8( const msh_img_ui8_t* src, msh_img_ui8_t* dst, int radius,
+                    mship_border_t border )
+{
+  mship_pipeline_t* p = mship_pipeline_create_ui8( src );
+  mship_pipeline_box_blur( p, radius, border );
+  mship_pipeline_run_ui8( p, dst, NULL );
+  mship_pipeline_destroy( p );
+}
+
+MSH_IMG_OPS_DEF void
+mship_box_blur_f32( const msh_img_f32_t* src, msh_img_f32_t* dst, int radius,
+                    mship_border_t border )
+{
+  mship_pipeline_t* p = mship_pipeline_create_f32( src );
+  mship_pipeline_box_blur( p, radius, border );
+  mship_pipeline_run_f32( p, dst, NULL );
+  mship_pipeline_destroy( p );
+}
+
+MSH_IMG_OPS_DEF void
+mship_gaussian_blur_ui8( const msh_img_ui8_t* src, msh_img_ui8_t* dst, float sigma,
+                         mship_border_t border )
+{
+  mship_pipeline_t* p = mship_pipeline_create_ui8( src );
+  mship_pipeline_gaussian_blur( p, sigma, border );
+  mship_pipeline_run_ui8( p, dst, NULL );
+  mship_pipeline_destroy( p );
+}
+
+MSH_IMG_OPS_DEF void
+mship_gaussian_blur_f32( const msh_img_f32_t* src, msh_img_f32_t* dst, float sigma,
+                         mship_border_t border )
+{
+  mship_pipeline_t* p = mship_pipeline_create_f32( src );
+  mship_pipeline_gaussian_blur( p, sigma, border );
+  mship_pipeline_run_f32( p, dst, NULL );
+  mship_pipeline_destroy( p );
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+// Planar images
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+// Planes are padded to a multiple of 64 bytes, so that each starts as aligned as the allocation.
+static size_t
+mship__plane_size( int width, int height, size_t elem_size )
+{
+  size_t n_per_line = 64 / elem_size;
+  return ( (size_t)width * height + n_per_line - 1 ) / n_per_line * n_per_line;
+}
+
+MSH_IMG_OPS_DEF msh_img_planar_f32_t
+mship_img_planar_f32_init( int width, int height, int n_comp, int zero_init )
+{
+  msh_img_planar_f32_t img;
+  img.width = width;
+  img.height = height;
+  img.n_comp = n_comp;
+  img.plane_size = mship__plane_size( width, height, sizeof(float) );
+  size_t n_bytes = img.plane_size * n_comp * sizeof(float);
+  img.data = (float*)( zero_init ? MSH_IMG_OPS_CALLOC( n_bytes, 1 ) : MSH_IMG_OPS_MALLOC( n_bytes ) );
+  return img;
+}
+
+MSH_IMG_OPS_DEF msh_img_planar_ui8_t
+mship_img_planar_ui8_init( int width, int height, int n_comp, int zero_init )
+{
+  msh_img_planar_ui8_t img;
+  img.width = width;
+  img.height = height;
+  img.n_comp = n_comp;
+  img.plane_size = mship__plane_size( width, height, 1 );
+  size_t n_bytes = img.plane_size * n_comp;
+  img.data = (uint8_t*)( zero_init ? MSH_IMG_OPS_CALLOC( n_bytes, 1 ) : MSH_IMG_OPS_MALLOC( n_bytes ) );
+  return img;
+}
+
+MSH_IMG_OPS_DEF void
+mship_img_planar_f32_free( msh_img_planar_f32_t* img )
+{
+  MSH_IMG_OPS_FREE( img->data );
+  img->data = NULL;
+}
+
+MSH_IMG_OPS_DEF void
+mship_img_planar_ui8_free( msh_img_planar_ui8_t* img )
+{
+  MSH_IMG_OPS_FREE( img->data );
+  img->data = NULL;
+}
+
+MSH_IMG_OPS_DEF float*
+mship_planar_plane_f32( const msh_img_planar_f32_t* img, int c )
+{
+  return img->data + c * img->plane_size;
+}
+
+MSH_IMG_OPS_DEF uint8_t*
+mship_planar_plane_ui8( const msh_img_planar_ui8_t* img, int c )
+{
+  return img->data + c * img->plane_size;
+}
+
+MSH_IMG_OPS_DEF msh_img_f32_t
+mship_planar_view_f32( const msh_img_planar_f32_t* img, int c )
+{
+  msh_img_f32_t view;
+  memset( &view, 0, sizeof(view) );
+  view.data = mship_planar_plane_f32( img, c );
+  view.width = img->width;
+  view.height = img->height;
+  view.n_comp = 1;
+  return view;
+}
+
+MSH_IMG_OPS_DEF msh_img_ui8_t
+mship_planar_view_ui8( const msh_img_planar_ui8_t* img, int c )
+{
+  msh_img_ui8_t view;
+  memset( &view, 0, sizeof(view) );
+  view.data = mship_planar_plane_ui8( img, c );
+  view.width = img->width;
+  view.height = img->height;
+  view.n_comp = 1;
+  return view;
+}
+
+//--------------------------------------------------------------------------------------------------
+// Layout conversion
+//--------------------------------------------------------------------------------------------------
+
+// Vector loops move 4 (f32) or 16 (ui8) pixels at a time, using shuffles for f32 and
+// unpacking/packing for ui8, and leave the remaining pixels to the scalar loops.
+static void
+mship__deinterleave_f32( const float* src, float* const* dst, int n_comp, size_t n )
+{
+  size_t i = 0;
+#if MSH__IMG_SSE2
+  if( n_comp == 2 )
+  {
+    for( ; i + 4 <= n; i += 4 )
+    {
+      __m128 v0 = _mm_loadu_ps( src + 2 * i ), v1 = _mm_loadu_ps( src + 2 * i + 4 );
+      _mm_storeu_ps( dst[0] + i, _mm_shuffle_ps( v0, v1, _MM_SHUFFLE( 2, 0, 2, 0 ) ) );
+      _mm_storeu_ps( dst[1] + i, _mm_shuffle_ps( v0, v1, _MM_SHUFFLE( 3, 1, 3, 1 ) ) );
+    }
+  }
+  else if( n_comp == 3 )
+  {
+    for( ; i + 4 <= n; i += 4 )
+    {
+      // v0 = r0 g0 b0 r1, v1 = g1 b1 r2 g2, v2 = b2 r3 g3 b3
+      __m128 v0 = _mm_loadu_ps( src + 3 * i );
+      __m128 v1 = _mm_loadu_ps( src + 3 * i + 4 );
+      __m128 v2 = _mm_loadu_ps( src + 3 * i + 8 );
+      __m128 r01 = _mm_shuffle_ps( v0, v1, _MM_SHUFFLE( 3, 2, 3, 0 ) );   // r0 r1 r2 g2
+      __m128 r23 = _mm_shuffle_ps( r01, v2, _MM_SHUFFLE( 1, 1, 2, 2 ) );  // r2 r2 r3 r3
+      __m128 g01 = _mm_shuffle_ps( v0, v1, _MM_SHUFFLE( 3, 0, 1, 1 ) );   // g0 g0 g1 g2
+      __m128 g23 = _mm_shuffle_ps( g01, v2, _MM_SHUFFLE( 2, 2, 3, 2 ) );  // g1 g2 g3 g3
+      __m128 b01 = _mm_shuffle_ps( v0, v1, _MM_SHUFFLE( 1, 1, 2, 2 ) );   // b0 b0 b1 b1
+      __m128 b23 = _mm_shuffle_ps( v2, v2, _MM_SHUFFLE( 3, 0, 3, 0 ) );   // b2 b3 b2 b3
+      _mm_storeu_ps( dst[0] + i, _mm_shuffle_ps( r01, r23, _MM_SHUFFLE( 2, 0, 1, 0 ) ) );
+      _mm_storeu_ps( dst[1] + i, _mm_shuffle_ps( g01, g23, _MM_SHUFFLE( 2, 1, 2, 0 ) ) );
+      _mm_storeu_ps( dst[2] + i, _mm_shuffle_ps( b01, b23, _MM_SHUFFLE( 1, 0, 2, 0 ) ) );
+    }
+  }
+  else if( n_comp == 4 )
+  {
+    for( ; i + 4 <= n; i += 4 )
+    {
+      __m128 v0 = _mm_loadu_ps( src + 4 * i ), v1 = _mm_loadu_ps( src + 4 * i + 4 );
+      __m128 v2 = _mm_loadu_ps( src + 4 * i + 8 ), v3 = _mm_loadu_ps( src + 4 * i + 12 );
+      _MM_TRANSPOSE4_PS( v0, v1, v2, v3 );
+      _mm_storeu_ps( dst[0] + i, v0 );
+      _mm_storeu_ps( dst[1] + i, v1 );
+      _mm_storeu_ps( dst[2] + i, v2 );
+      _mm_storeu_ps( dst[3] + i, v3 );
+    }
+  }
+#endif
+  for( ; i < n; ++i )
+  {
+    for( int c = 0; c < n_comp; ++c ) { dst[c][i] = src[i * n_comp + c]; }
+  }
+}
+
+static void
+mship__interleave_f32( const float* const* src, float* dst, int n_comp, size_t n )
+{
+  size_t i = 0;
+#if MSH__IMG_SSE2
+  if( n_comp == 2 )
+  {
+    for( ; i + 4 <= n; i += 4 )
+    {
+      __m128 a = _mm_loadu_ps( src[0] + i ), b = _mm_loadu_ps( src[1] + i );
+      _mm_storeu_ps( dst + 2 * i, _mm_unpacklo_ps( a, b ) );
+      _mm_storeu_ps( dst + 2 * i + 4, _mm_unpackhi_ps( a, b ) );
+    }
+  }
+  else if( n_comp == 3 )
+  {
+    for( ; i + 4 <= n; i += 4 )
+    {
+      __m128 r = _mm_loadu_ps( src[0] + i );
+      __m128 g = _mm_loadu_ps( src[1] + i );
+      __m128 b = _mm_loadu_ps( src[2] + i );
+      __m128 rg = _mm_unpacklo_ps( r, g );                              // r0 g0 r1 g1
+      __m128 br = _mm_shuffle_ps( b, r, _MM_SHUFFLE( 1, 1, 0, 0 ) );    // b0 b0 r1 r1
+      __m128 gb = _mm_shuffle_ps( g, b, _MM_SHUFFLE( 1, 1, 1, 1 ) );    // g1 g1 b1 b1
+      __m128 rg2 = _mm_shuffle_ps( r, g, _MM_SHUFFLE( 2, 2, 2, 2 ) );   // r2 r2 g2 g2
+      __m128 br3 = _mm_shuffle_ps( b, r, _MM_SHUFFLE( 3, 3, 2, 2 ) );   // b2 b2 r3 r3
+      __m128 gb3 = _mm_shuffle_ps( g, b, _MM_SHUFFLE( 3, 3, 3, 3 ) );   // g3 g3 b3 b3
+      _mm_storeu_ps( dst + 3 * i, _mm_shuffle_ps( rg, br, _MM_SHUFFLE( 2, 0, 1, 0 ) ) );
+      _mm_storeu_ps( dst + 3 * i + 4, _mm_shuffle_ps( gb, rg2, _MM_SHUFFLE( 2, 0, 2, 0 ) ) );
+      _mm_storeu_ps( dst + 3 * i + 8, _mm_shuffle_ps( br3, gb3, _MM_SHUFFLE( 2, 0, 2, 0 ) ) );
+    }
+  }
+  else if( n_comp == 4 )
+  {
+    for( ; i + 4 <= n; i += 4 )
+    {
+      __m128 v0 = _mm_loadu_ps( src[0] + i ), v1 = _mm_loadu_ps( src[1] + i );
+      __m128 v2 = _mm_loadu_ps( src[2] + i ), v3 = _mm_loadu_ps( src[3] + i );
+      _MM_TRANSPOSE4_PS( v0, v1, v2, v3 );
+      _mm_storeu_ps( dst + 4 * i, v0 );
+      _mm_storeu_ps( dst + 4 * i + 4, v1 );
+      _mm_storeu_ps( dst + 4 * i + 8, v2 );
+      _mm_storeu_ps( dst + 4 * i + 12, v3 );
+    }
+  }
+#endif
+  for( ; i < n; ++i )
+  {
+    for( int c = 0; c < n_comp; ++c ) { dst[i * n_comp + c] = src[c][i]; }
+  }
+}
+
+#if MSH__IMG_SSE2
+// Splits 32 interleaved byte pairs into 16 first and 16 second bytes.
+static inline void
+mship__unzip_epi8( __m128i v0, __m128i v1, __m128i* even, __m128i* odd )
+{
+  __m128i mask = _mm_set1_epi16( 0x00FF );
+  *even = _mm_packus_epi16( _mm_and_si128( v0, mask ), _mm_and_si128( v1, mask ) );
+  *odd = _mm_packus_epi16( _mm_srli_epi16( v0, 8 ), _mm_srli_epi16( v1, 8 ) );
+}
+#endif
+
+// 3 channel ui8 images are converted by an unrolled scalar loop, as SSE2 has no byte shuffle.
+static void
+mship__deinterleave_ui8( const uint8_t* src, uint8_t* const* dst, int n_comp, size_t n )
+{
+  size_t i = 0;
+#if MSH__IMG_SSE2
+  if( n_comp == 2 )
+  {
+    for( ; i + 16 <= n; i += 16 )
+    {
+      __m128i c0, c1;
+      mship__unzip_epi8( _mm_loadu_si128( (const __m128i*)( src + 2 * i ) ),
+                         _mm_loadu_si128( (const __m128i*)( src + 2 * i + 16 ) ), &c0, &c1 );
+      _mm_storeu_si128( (__m128i*)( dst[0] + i ), c0 );
+      _mm_storeu_si128( (__m128i*)( dst[1] + i ), c1 );
+    }
+  }
+  else if( n_comp == 4 )
+  {
+    // Unzipping bytes splits channels 0, 2 from 1, 3, and unzipping again separates them.
+    for( ; i + 16 <= n; i += 16 )
+    {
+      const __m128i* s = (const __m128i*)( src + 4 * i );
+      __m128i e0, o0, e1, o1, c0, c1, c2, c3;
+      mship__unzip_epi8( _mm_loadu_si128( s ), _mm_loadu_si128( s + 1 ), &e0, &o0 );
+      mship__unzip_epi8( _mm_loadu_si128( s + 2 ), _mm_loadu_si128( s + 3 ), &e1, &o1 );
+      mship__unzip_epi8( e0, e1, &c0, &c2 );
+      mship__unzip_epi8( o0, o1, &c1, &c3 );
+      _mm_storeu_si128( (__m128i*)( dst[0] + i ), c0 );
+      _mm_storeu_si128( (__m128i*)( dst[1] + i ), c1 );
+      _mm_storeu_si128( (__m128i*)( dst[2] + i ), c2 );
+      _mm_storeu_si128( (__m128i*)( dst[3] + i ), c3 );
+    }
+  }
+#endif
+  if( n_comp == 3 )
+  {
+    for( ; i < n; ++i )
+    {
+      dst[0][i] = src[3 * i];
+      dst[1][i] = src[3 * i + 1];
+      dst[2][i] = src[3 * i + 2];
+    }
+  }
+  for( ; i < n; ++i )
+  {
+    for( int c = 0; c < n_comp; ++c ) { dst[c][i] = src[i * n_comp + c]; }
+  }
+}
+
+static void
+mship__interleave_ui8( const uint8_t* const* src, uint8_t* dst, int n_comp, size_t n )
+{
+  size_t i = 0;
+#if MSH__IMG_SSE2
+  if( n_comp == 2 )
+  {
+    for( ; i + 16 <= n; i += 16 )
+    {
+      __m128i a = _mm_loadu_si128( (const __m128i*)( src[0] + i ) );
+      __m128i b = _mm_loadu_si128( (const __m128i*)( src[1] + i ) );
+      _mm_storeu_si128( (__m128i*)( dst + 2 * i ), _mm_unpacklo_epi8( a, b ) );
+      _mm_storeu_si128( (__m128i*)( dst + 2 * i + 16 ), _mm_unpackhi_epi8( a, b ) );
+    }
+  }
+  else if( n_comp == 4 )
+  {
+    for( ; i + 16 <= n; i += 16 )
+    {
+      __m128i c0 = _mm_loadu_si128( (const __m128i*)( src[0] + i ) );
+      __m128i c1 = _mm_loadu_si128( (const __m128i*)( src[1] + i ) );
+      __m128i c2 = _mm_loadu_si128( (const __m128i*)( src[2] + i ) );
+      __m128i c3 = _mm_loadu_si128( (const __m128i*)( src[3] + i ) );
+      __m128i lo01 = _mm_unpacklo_epi8( c0, c1 ), hi01 = _mm_unpackhi_epi8( c0, c1 );
+      __m128i lo23 = _mm_unpacklo_epi8( c2, c3 ), hi23 = _mm_unpackhi_epi8( c2, c3 );
+      __m128i* d = (__m128i*)( dst + 4 * i );
+      _mm_storeu_si128( d, _mm_unpacklo_epi16( lo01, lo23 ) );
+      _mm_storeu_si128( d + 1, _mm_unpackhi_epi16( lo01, lo23 ) );
+      _mm_storeu_si128( d + 2, _mm_unpacklo_epi16( hi01, hi23 ) );
+      _mm_storeu_si128( d + 3, _mm_unpackhi_epi16( hi01, hi23 ) );
+    }
+  }
+#endif
+  if( n_comp == 3 )
+  {
+    for( ; i < n; ++i )
+    {
+      dst[3 * i] = src[0][i];
+      dst[3 * i + 1] = src[1][i];
+      dst[3 * i + 2] = src[2][i];
+    }
+  }
+  for( ; i < n; ++i )
+  {
+    for( int c = 0; c < n_comp; ++c ) { dst[i * n_comp + c] = src[c][i]; }
+  }
+}
+
+MSH_IMG_OPS_DEF void
+mship_deinterleave_f32( const msh_img_f32_t* src, msh_img_planar_f32_t* dst )
+{
+  assert( src->width == dst->width && src->height == dst->height && src->n_comp == dst->n_comp );
+  float* planes[4];
+  for( int c = 0; c < src->n_comp; ++c ) { planes[c] = mship_planar_plane_f32( dst, c ); }
+  mship__deinterleave_f32( src->data, planes, src->n_comp, (size_t)src->width * src->height );
+}
+
+MSH_IMG_OPS_DEF void
+mship_interleave_f32( const msh_img_planar_f32_t* src, msh_img_f32_t* dst )
+{
+  assert( src->width == dst->width && src->height == dst->height && src->n_comp == dst->n_comp );
+  const float* planes[4];
+  for( int c = 0; c < src->n_comp; ++c ) { planes[c] = mship_planar_plane_f32( src, c ); }
+  mship__interleave_f32( planes, dst->data, src->n_comp, (size_t)src->width * src->height );
+}
+
+MSH_IMG_OPS_DEF void
+mship_deinterleave_ui8( const msh_img_ui8_t* src, msh_img_planar_ui8_t* dst )
+{
+  assert( src->width == dst->width && src->height == dst->height && src->n_comp == dst->n_comp );
+  uint8_t* planes[4];
+  for( int c = 0; c < src->n_comp; ++c ) { planes[c] = mship_planar_plane_ui8( dst, c ); }
+  mship__deinterleave_ui8( src->data, planes, src->n_comp, (size_t)src->width * src->height );
+}
+
+MSH_IMG_OPS_DEF void
+mship_interleave_ui8( const msh_img_planar_ui8_t* src, msh_img_ui8_t* dst )
+{
+  assert( src->width == dst->width && src->height == dst->height && src->n_comp == dst->n_comp );
+  const uint8_t* planes[4];
+  for( int c = 0; c < src->n_comp; ++c ) { planes[c] = mship_planar_plane_ui8( src, c ); }
+  mship__interleave_ui8( planes, dst->data, src->n_comp, (size_t)src->width * src->height );
+}
+
+//--------------------------------------------------------------------------------------------------
+// Planar sampling
+//--------------------------------------------------------------------------------------------------
+
+static inline float
+mship__clampf( float v, float lo, float hi )
+{
+  return v < lo ? lo : ( v > hi ? hi : v );
+}
+
+// Pixel centers are at integer coordinates; coordinates outside of the image are clamped to the
+// edge pixel centers.
+MSH_IMG_OPS_DEF void
+mship_planar_sample_nn_f32( const msh_img_planar_f32_t* img, float x, float y, float* out )
+{
+  int xi = (int)( mship__clampf( x, 0.0f, (float)( img->width - 1 ) ) + 0.5f );
+  int yi = (int)( mship__clampf( y, 0.0f, (float)( img->height - 1 ) ) + 0.5f );
+  size_t idx = (size_t)yi * img->width + xi;
+  for( int c = 0; c < img->n_comp; ++c ) { out[c] = img->data[c * img->plane_size + idx]; }
+}
+
+MSH_IMG_OPS_DEF void
+mship_planar_sample_bl_f32( const msh_img_planar_f32_t* img, float x, float y, float* out )
+{
+  x = mship__clampf( x, 0.0f, (float)( img->width - 1 ) );
+  y = mship__clampf( y, 0.0f, (float)( img->height - 1 ) );
+  int x0 = (int)x, y0 = (int)y;
+  int x1 = x0 + ( x0 < img->width - 1 ), y1 = y0 + ( y0 < img->height - 1 );
+  float fx = x - x0, fy = y - y0;
+  size_t i00 = (size_t)y0 * img->width + x0, i01 = (size_t)y0 * img->width + x1;
+  size_t i10 = (size_t)y1 * img->width + x0, i11 = (size_t)y1 * img->width + x1;
+  for( int c = 0; c < img->n_comp; ++c )
+  {
+    const float* p = img->data + c * img->plane_size;
+    float top = p[i00] + fx * ( p[i01] - p[i00] );
+    float bottom = p[i10] + fx * ( p[i11] - p[i10] );
+    out[c] = top + fy * ( bottom - top );
+  }
+}
+
+// Positions are processed 8 at a time: indices and weights are computed once and reused for
+// every plane, and values are fetched with AVX2 gathers.
+MSH_IMG_OPS_DEF void
+mship_planar_sample_many_nn_f32( const msh_img_planar_f32_t* img, const float* xs,
+                                 const float* ys, int n, float* const* out )
+{
+  int i = 0;
+#if MSH__IMG_AVX2
+  __m256 max_x = _mm256_set1_ps( (float)( img->width - 1 ) );
+  __m256 max_y = _mm256_set1_ps( (float)( img->height - 1 ) );
+  __m256 half = _mm256_set1_ps( 0.5f );
+  __m256i w = _mm256_set1_epi32( img->width );
+  for( ; i + 8 <= n; i += 8 )
+  {
+    __m256 x = _mm256_min_ps( _mm256_max_ps( _mm256_loadu_ps( xs + i ), _mm256_setzero_ps() ), max_x );
+    __m256 y = _mm256_min_ps( _mm256_max_ps( _mm256_loadu_ps( ys + i ), _mm256_setzero_ps() ), max_y );
+    __m256i xi = _mm256_cvttps_epi32( _mm256_add_ps( x, half ) );
+    __m256i yi = _mm256_cvttps_epi32( _mm256_add_ps( y, half ) );
+    __m256i idx = _mm256_add_epi32( _mm256_mullo_epi32( yi, w ), xi );
+    for( int c = 0; c < img->n_comp; ++c )
+    {
+      _mm256_storeu_ps( out[c] + i, _mm256_i32gather_ps( img->data + c * img->plane_size, idx, 4 ) );
+    }
+  }
+#endif
+  for( ; i < n; ++i )
+  {
+    float v[4];
+    mship_planar_sample_nn_f32( img, xs[i], ys[i], v );
+    for( int c = 0; c < img->n_comp; ++c ) { out[c][i] = v[c]; }
+  }
+}
+
+MSH_IMG_OPS_DEF void
+mship_planar_sample_many_bl_f32( const msh_img_planar_f32_t* img, const float* xs,
+                                 const float* ys, int n, float* const* out )
+{
+  int i = 0;
+#if MSH__IMG_AVX2
+  __m256 max_x = _mm256_set1_ps( (float)( img->width - 1 ) );
+  __m256 max_y = _mm256_set1_ps( (float)( img->height - 1 ) );
+  __m256i max_xi = _mm256_set1_epi32( img->width - 1 );
+  __m256i max_yi = _mm256_set1_epi32( img->height - 1 );
+  __m256i one = _mm256_set1_epi32( 1 );
+  __m256i w = _mm256_set1_epi32( img->width );
+  for( ; i + 8 <= n; i += 8 )
+  {
+    __m256 x = _mm256_min_ps( _mm256_max_ps( _mm256_loadu_ps( xs + i ), _mm256_setzero_ps() ), max_x );
+    __m256 y = _mm256_min_ps( _mm256_max_ps( _mm256_loadu_ps( ys + i ), _mm256_setzero_ps() ), max_y );
+    __m256i x0 = _mm256_cvttps_epi32( x ), y0 = _mm256_cvttps_epi32( y );
+    __m256 fx = _mm256_sub_ps( x, _mm256_cvtepi32_ps( x0 ) );
+    __m256 fy = _mm256_sub_ps( y, _mm256_cvtepi32_ps( y0 ) );
+    __m256i dx = _mm256_min_epi32( _mm256_add_epi32( x0, one ), max_xi );
+    __m256i row0 = _mm256_mullo_epi32( y0, w );
+    __m256i row1 = _mm256_mullo_epi32( _mm256_min_epi32( _mm256_add_epi32( y0, one ), max_yi ), w );
+    __m256i i00 = _mm256_add_epi32( row0, x0 ), i01 = _mm256_add_epi32( row0, dx );
+    __m256i i10 = _mm256_add_epi32( row1, x0 ), i11 = _mm256_add_epi32( row1, dx );
+    for( int c = 0; c < img->n_comp; ++c )
+    {
+      const float* p = img->data + c * img->plane_size;
+      __m256 v00 = _mm256_i32gather_ps( p, i00, 4 ), v01 = _mm256_i32gather_ps( p, i01, 4 );
+      __m256 v10 = _mm256_i32gather_ps( p, i10, 4 ), v11 = _mm256_i32gather_ps( p, i11, 4 );
+      __m256 top = _mm256_add_ps( v00, _mm256_mul_ps( fx, _mm256_sub_ps( v01, v00 ) ) );
+      __m256 bottom = _mm256_add_ps( v10, _mm256_mul_ps( fx, _mm256_sub_ps( v11, v10 ) ) );
+      _mm256_storeu_ps( out[c] + i, _mm256_add_ps( top, _mm256_mul_ps( fy, _mm256_sub_ps( bottom, top ) ) ) );
+    }
+  }
+#endif
+  for( ; i < n; ++i )
+  {
+    float v[4];
+    mship_planar_sample_bl_f32( img, xs[i], ys[i], v );
+    for( int c = 0; c < img->n_comp; ++c ) { out[c][i] = v[c]; }
+  }
+}
+
+#endif /* MSH_IMG_OPS_IMPLEMENTATION */
@@ -0,0 +1,981 @@
+/*
+  Author: Maciej Halber
+  Date : Oct 18, 2026
+  License: CC0
+
+  Compilation: gcc -std=c99 -O2 -mavx2 -I<path_to_msh_libraries> msh_img_ops_example.c -o msh_img_ops_example -lm -lpthread
+  Usage:       msh_img_ops_example [max_n_threads | --bench]
+  Description: This program showcases whole-image operations from msh_img_ops.h. It:
+
+               1) Validates mship_resize_ui8/f32 against a direct double precision evaluation
+               of the same filters, for all filters, 1-4 channels and a mix of up- and
+               downscaling factors.
+
+               2) Compares resizing a whole image against a loop that calls
+               mship_sample3_bl_ui8/mship_sample3_nn_ui8 once per output pixel, as done in
+               deprecated/msh_image_example.c, both for 2x upscaling and for thumbnails.
+
+               3) Reports throughput of every filter, channel count and pixel type for
+               downscaling and upscaling, in output megapixels per second.
+
+               4) Validates separable convolution, box blur and Gaussian blur against direct
+               2D convolution for every border mode, including radii larger than the image.
+
+               5) Compares, for growing radii, a per-pixel 2D convolution loop, separable
+               convolution, running sum box blur and the three box Gaussian approximation.
+
+               6) Checks that interleaved <-> planar conversions round trip exactly, and times
+               them, a blur of every plane of a planar image against the interleaved blur, and
+               batched planar bilinear sampling against a per-point interleaved loop.
+
+               7) Runs a chain of operations on a 12 megapixel image (convert ui8 to f32,
+               downscale, adjust contrast, convert back to ui8) once as separate whole-image
+               passes with intermediate images, and once as a fused pipeline on a growing
+               number of threads. Both results have to be identical.
+
+               Program returns non-zero if validation fails. Compile without -mavx2 for the SSE2
+               paths, or with -DMSH_IMG_OPS_NO_SIMD for the scalar ones. With --bench, single
+               threaded resizing, blurs and layout conversion are measured with msh_bench.h instead.
+*/
+
+#define MSH_STD_INCLUDE_HEADERS
+#define MSH_STD_IMPLEMENTATION
+#define MSH_IMG_PROC_IMPLEMENTATION
+#define MSH_JOBS_IMPLEMENTATION
+#define MSH_IMG_OPS_IMPLEMENTATION
+#define MSH_BENCH_IMPLEMENTATION
+#include "msh_std.h"
+#include "msh_img_proc.h"
+#include "msh_jobs.h"
+#include "msh_img_ops.h"
+#include "msh_bench.h"
+
+static const char* filter_names[] = { "nearest", "bilinear", "box", "lanczos3" };
+static const char* border_names[] = { "clamp", "mirror", "wrap", "zero" };
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+// Reference
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+double reference_filter( mship_filter_t filter, double x, double* support )
+{
+  switch( filter )
+  {
+    case MSHIP_FILTER_BILINEAR:
+      *support = 1.0;
+      return fabs( x ) < 1.0 ? 1.0 - fabs( x ) : 0.0;
+    case MSHIP_FILTER_BOX:
+      *support = 0.5;
+      return ( x >= -0.5 && x < 0.5 ) ? 1.0 : 0.0;
+    case MSHIP_FILTER_LANCZOS3:
+      *support = 3.0;
+      if( x == 0.0 ) { return 1.0; }
+      if( fabs( x ) >= 3.0 ) { return 0.0; }
+      return 3.0 * sin( MSH_PI * x ) * sin( MSH_PI * x / 3.0 ) / ( MSH_PI * MSH_PI * x * x );
+    default:
+      *support = 0.5;
+      return 0.0;
+  }
+}
+
+// Weights of all source pixels for output pixel x, with clamp-to-edge.
+void reference_weights( mship_filter_t filter, int src_size, int dst_size, int x, double* w )
+{
+  for( int i = 0; i < src_size; ++i ) { w[i] = 0.0; }
+  if( filter == MSHIP_FILTER_NEAREST )
+  {
+    int sx = (int)floor( ( x + 0.5 ) * src_size / dst_size );
+    w[msh_min( sx, src_size - 1 )] = 1.0;
+    return;
+  }
+  double scale = (double)dst_size / src_size;
+  double filter_scale = ( filter != MSHIP_FILTER_BILINEAR && scale < 1.0 ) ? scale : 1.0;
+  double support;
+  reference_filter( filter, 0.0, &support );
+  support /= filter_scale;
+  double center = ( x + 0.5 ) / scale - 0.5;
+  double sum = 0.0;
+  for( int j = (int)ceil( center - support ); j <= (int)floor( center + support ); ++j )
+  {
+    double unused;
+    double v = reference_filter( filter, ( j - center ) * filter_scale, &unused );
+    w[msh_clamp( j, 0, src_size - 1 )] += v;
+    sum += v;
+  }
+  for( int i = 0; i < src_size; ++i ) { w[i] /= sum; }
+}
+
+void reference_resize( const float* src, int sw, int sh, int nc, float* dst, int dw, int dh,
+                       mship_filter_t filter )
+{
+  double* wx = malloc( sw * sizeof(double) );
+  double* wy = malloc( sh * sizeof(double) );
+  for( int y = 0; y < dh; ++y )
+  {
+    reference_weights( filter, sh, dh, y, wy );
+    for( int x = 0; x < dw; ++x )
+    {
+      reference_weights( filter, sw, dw, x, wx );
+      for( int c = 0; c < nc; ++c )
+      {
+        double acc = 0.0;
+        for( int j = 0; j < sh; ++j )
+        {
+          if( wy[j] == 0.0 ) { continue; }
+          for( int i = 0; i < sw; ++i ) { acc += wy[j] * wx[i] * src[( j * sw + i ) * nc + c]; }
+        }
+        dst[( y * dw + x ) * nc + c] = (float)acc;
+      }
+    }
+  }
+  free( wx );
+  free( wy );
+}
+
+int validate( mship_filter_t filter, int nc, int sw, int sh, int dw, int dh, msh_rand_ctx_t* rand_gen )
+{
+  msh_img_f32_t src_f32 = mship_img_f32_init( sw, sh, nc, 0 );
+  msh_img_ui8_t src_ui8 = mship_img_ui8_init( sw, sh, nc, 0 );
+  msh_img_f32_t dst_f32 = mship_img_f32_init( dw, dh, nc, 0 );
+  msh_img_ui8_t dst_ui8 = mship_img_ui8_init( dw, dh, nc, 0 );
+  float* src_ref = malloc( sw * sh * nc * sizeof(float) );
+  float* ref = malloc( dw * dh * nc * sizeof(float) );
+  for( int i = 0; i < sw * sh * nc; ++i )
+  {
+    src_ui8.data[i] = (unsigned char)( msh_rand_next( rand_gen ) & 0xFF );
+    src_f32.data[i] = src_ref[i] = (float)src_ui8.data[i];
+  }
+
+  mship_resize_f32( &src_f32, &dst_f32, filter );
+  mship_resize_ui8( &src_ui8, &dst_ui8, filter );
+  reference_resize( src_ref, sw, sh, nc, ref, dw, dh, filter );
+
+  double max_err_f32 = 0.0, max_err_ui8 = 0.0;
+  for( int i = 0; i < dw * dh * nc; ++i )
+  {
+    max_err_f32 = msh_max( max_err_f32, fabs( dst_f32.data[i] - ref[i] ) );
+    double rounded = msh_clamp( floor( ref[i] + 0.5 ), 0.0, 255.0 );
+    max_err_ui8 = msh_max( max_err_ui8, fabs( dst_ui8.data[i] - rounded ) );
+  }
+  int ok = max_err_f32 < 1e-3 && max_err_ui8 <= 1.0;
+  if( !ok )
+  {
+    printf("  %-8s %d ch %3dx%-3d -> %3dx%-3d: max. error f32 %g, ui8 %g FAILED\n",
+           filter_names[filter], nc, sw, sh, dw, dh, max_err_f32, max_err_ui8 );
+  }
+
+  free( src_f32.data );
+  free( src_ui8.data );
+  free( dst_f32.data );
+  free( dst_ui8.data );
+  free( src_ref );
+  free( ref );
+  return ok;
+}
+
+// Folds an out of image index back by repeated reflection, -1 for zero border.
+int reference_border( int i, int n, mship_border_t border )
+{
+  if( i >= 0 && i < n ) { return i; }
+  switch( border )
+  {
+    case MSHIP_BORDER_CLAMP: return msh_clamp( i, 0, n - 1 );
+    case MSHIP_BORDER_WRAP:  return ( ( i % n ) + n ) % n;
+    case MSHIP_BORDER_MIRROR:
+      if( n == 1 ) { return 0; }
+      while( i < 0 || i >= n ) { i = i < 0 ? -i : 2 * ( n - 1 ) - i; }
+      return i;
+    default: return -1;
+  }
+}
+
+void reference_convolve( const float* src, int w, int h, int nc, const double* kx, int rx,
+                         const double* ky, int ry, mship_border_t border, float* dst )
+{
+  for( int y = 0; y < h; ++y )
+  {
+    for( int x = 0; x < w; ++x )
+    {
+      for( int c = 0; c < nc; ++c )
+      {
+        double acc = 0.0;
+        for( int j = -ry; j <= ry; ++j )
+        {
+          int sy = reference_border( y + j, h, border );
+          if( sy < 0 ) { continue; }
+          for( int i = -rx; i <= rx; ++i )
+          {
+            int sx = reference_border( x + i, w, border );
+            if( sx < 0 ) { continue; }
+            acc += ky[j + ry] * kx[i + rx] * src[( sy * w + sx ) * nc + c];
+          }
+        }
+        dst[( y * w + x ) * nc + c] = (float)acc;
+      }
+    }
+  }
+}
+
+void reference_box( const float* src, int w, int h, int nc, int r, mship_border_t border, float* dst )
+{
+  double* k = malloc( ( 2 * r + 1 ) * sizeof(double) );
+  for( int i = 0; i < 2 * r + 1; ++i ) { k[i] = 1.0 / ( 2 * r + 1 ); }
+  reference_convolve( src, w, h, nc, k, r, k, r, border, dst );
+  free( k );
+}
+
+typedef enum { FILTER_CONVOLVE, FILTER_BOX, FILTER_GAUSSIAN } filter_kind_t;
+
+// 'size' is the radius of convolution and box filters, and sigma of the Gaussian.
+int validate_filter( filter_kind_t kind, int nc, int w, int h, int size, mship_border_t border,
+                     msh_rand_ctx_t* rand_gen )
+{
+  static const char* kind_names[] = { "convolve", "box", "gaussian" };
+  size_t n = (size_t)w * h * nc;
+  msh_img_f32_t src_f32 = mship_img_f32_init( w, h, nc, 0 );
+  msh_img_ui8_t src_ui8 = mship_img_ui8_init( w, h, nc, 0 );
+  msh_img_f32_t dst_f32 = mship_img_f32_init( w, h, nc, 0 );
+  msh_img_ui8_t dst_ui8 = mship_img_ui8_init( w, h, nc, 0 );
+  msh_img_f32_t banded = mship_img_f32_init( w, h, nc, 0 );
+  float* ref = malloc( n * sizeof(float) );
+  float* tmp = malloc( n * sizeof(float) );
+  for( size_t i = 0; i < n; ++i )
+  {
+    src_ui8.data[i] = (unsigned char)( msh_rand_next( rand_gen ) & 0xFF );
+    src_f32.data[i] = (float)src_ui8.data[i];
+  }
+
+  mship_pipeline_t* p = mship_pipeline_create_f32( &src_f32 );
+  if( kind == FILTER_CONVOLVE )
+  {
+    int r = size;
+    float* kx = malloc( ( 2 * r + 1 ) * sizeof(float) );
+    float* ky = malloc( ( 2 * r + 3 ) * sizeof(float) );
+    double* dkx = malloc( ( 2 * r + 1 ) * sizeof(double) );
+    double* dky = malloc( ( 2 * r + 3 ) * sizeof(double) );
+    for( int i = 0; i < 2 * r + 1; ++i ) { dkx[i] = kx[i] = msh_rand_nextf( rand_gen ) - 0.3f; }
+    for( int i = 0; i < 2 * r + 3; ++i ) { dky[i] = ky[i] = msh_rand_nextf( rand_gen ) / ( r + 1 ); }
+    mship_convolve_f32( &src_f32, &dst_f32, kx, r, ky, r + 1, border );
+    mship_convolve_ui8( &src_ui8, &dst_ui8, kx, r, ky, r + 1, border );
+    mship_pipeline_convolve( p, kx, r, ky, r + 1, border );
+    reference_convolve( src_f32.data, w, h, nc, dkx, r, dky, r + 1, border, ref );
+    free( kx ); free( ky ); free( dkx ); free( dky );
+  }
+  else if( kind == FILTER_BOX )
+  {
+    mship_box_blur_f32( &src_f32, &dst_f32, size, border );
+    mship_box_blur_ui8( &src_ui8, &dst_ui8, size, border );
+    mship_pipeline_box_blur( p, size, border );
+    reference_box( src_f32.data, w, h, nc, size, border, ref );
+  }
+  else
+  {
+    int radii[3];
+    mship_gaussian_box_radii( (float)size, radii );
+    mship_gaussian_blur_f32( &src_f32, &dst_f32, (float)size, border );
+    mship_gaussian_blur_ui8( &src_ui8, &dst_ui8, (float)size, border );
+    mship_pipeline_gaussian_blur( p, (float)size, border );
+    memcpy( ref, src_f32.data, n * sizeof(float) );
+    for( int i = 0; i < 3; ++i )
+    {
+      reference_box( ref, w, h, nc, radii[i], border, tmp );
+      memcpy( ref, tmp, n * sizeof(float) );
+    }
+  }
+  // Narrow bands start many times in the middle of the image and in its borders.
+  msh_jobs_t* jobs = msh_jobs_create( 2 );
+  mship_pipeline_set_band_height( p, 3 );
+  mship_pipeline_run_f32( p, &banded, jobs );
+  msh_jobs_destroy( jobs );
+  mship_pipeline_destroy( p );
+
+  double max_err_f32 = 0.0, max_err_ui8 = 0.0, max_err_banded = 0.0;
+  for( size_t i = 0; i < n; ++i )
+  {
+    max_err_f32 = msh_max( max_err_f32, fabs( dst_f32.data[i] - ref[i] ) );
+    max_err_banded = msh_max( max_err_banded, fabs( banded.data[i] - ref[i] ) );
+    double rounded = msh_clamp( floor( ref[i] + 0.5 ), 0.0, 255.0 );
+    max_err_ui8 = msh_max( max_err_ui8, fabs( dst_ui8.data[i] - rounded ) );
+  }
+  int ok = max_err_f32 < 1e-3 && max_err_banded < 1e-3 && max_err_ui8 <= 1.0;
+  if( !ok )
+  {
+    printf("  %-8s %d ch %3dx%-3d size %2d %-6s: max. error f32 %g, banded %g, ui8 %g FAILED\n",
+           kind_names[kind], nc, w, h, size, border_names[border], max_err_f32, max_err_banded,
+           max_err_ui8 );
+  }
+
+  free( src_f32.data );
+  free( src_ui8.data );
+  free( dst_f32.data );
+  free( dst_ui8.data );
+  free( banded.data );
+  free( ref );
+  free( tmp );
+  return ok;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+// Benchmarks
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void fill_test_image( msh_img_ui8_t* img )
+{
+  // Smooth gradients with a fine checkerboard, so that aliasing would be visible.
+  for( int y = 0; y < img->height; ++y )
+  {
+    for( int x = 0; x < img->width; ++x )
+    {
+      unsigned char* p = mship_pixel_ptr_ui8( img, x, y );
+      for( int c = 0; c < img->n_comp; ++c )
+      {
+        int v = ( x * 255 / img->width + y * 127 / img->height + c * 64 ) & 0xFF;
+        p[c] = (unsigned char)( ( ( x ^ y ) & 4 ) ? v : 255 - v );
+      }
+    }
+  }
+}
+
+double per_pixel_resize( msh_img_ui8_t* src, msh_img_ui8_t* dst, int bilinear )
+{
+  float sx = (float)src->width / dst->width;
+  float sy = (float)src->height / dst->height;
+  uint64_t t1 = msh_time_now();
+  for( int y = 0; y < dst->height; ++y )
+  {
+    for( int x = 0; x < dst->width; ++x )
+    {
+      float ox = ( x + 0.5f ) * sx - 0.5f;
+      float oy = ( y + 0.5f ) * sy - 0.5f;
+      msh_pixel3_ui8_t opix = bilinear ? mship_sample3_bl_ui8( src, ox, oy )
+                                       : mship_sample3_nn_ui8( src, ox, oy );
+      unsigned char* rpix = mship_pixel_ptr_ui8( dst, x, y );
+      rpix[0] = opix.data[0];
+      rpix[1] = opix.data[1];
+      rpix[2] = opix.data[2];
+    }
+  }
+  uint64_t t2 = msh_time_now();
+  return msh_time_diff( MSHT_MILLISECONDS, t2, t1 );
+}
+
+// Best of a few runs.
+double time_resize_ui8( msh_img_ui8_t* src, msh_img_ui8_t* dst, mship_filter_t filter, int n_runs )
+{
+  double best = 1e30;
+  for( int r = 0; r < n_runs; ++r )
+  {
+    uint64_t t1 = msh_time_now();
+    mship_resize_ui8( src, dst, filter );
+    uint64_t t2 = msh_time_now();
+    best = msh_min( best, msh_time_diff( MSHT_MILLISECONDS, t2, t1 ) );
+  }
+  return best;
+}
+
+double time_resize_f32( msh_img_f32_t* src, msh_img_f32_t* dst, mship_filter_t filter, int n_runs )
+{
+  double best = 1e30;
+  for( int r = 0; r < n_runs; ++r )
+  {
+    uint64_t t1 = msh_time_now();
+    mship_resize_f32( src, dst, filter );
+    uint64_t t2 = msh_time_now();
+    best = msh_min( best, msh_time_diff( MSHT_MILLISECONDS, t2, t1 ) );
+  }
+  return best;
+}
+
+// Direct 2D convolution with clamped borders, as one would write it with mship_pixel_ptr_ui8.
+double per_pixel_box_blur( msh_img_ui8_t* src, msh_img_ui8_t* dst, int r )
+{
+  uint64_t t1 = msh_time_now();
+  float scale = 1.0f / ( ( 2 * r + 1 ) * ( 2 * r + 1 ) );
+  for( int y = 0; y < dst->height; ++y )
+  {
+    for( int x = 0; x < dst->width; ++x )
+    {
+      float acc[4] = { 0.0f, 0.0f, 0.0f, 0.0f };
+      for( int j = -r; j <= r; ++j )
+      {
+        for( int i = -r; i <= r; ++i )
+        {
+          unsigned char* spix = mship_pixel_ptr_ui8( src, msh_clamp( x + i, 0, src->width - 1 ),
+                                                     msh_clamp( y + j, 0, src->height - 1 ) );
+          for( int c = 0; c < src->n_comp; ++c ) { acc[c] += spix[c]; }
+        }
+      }
+      unsigned char* dpix = mship_pixel_ptr_ui8( dst, x, y );
+      for( int c = 0; c < src->n_comp; ++c ) { dpix[c] = (unsigned char)( acc[c] * scale + 0.5f ); }
+    }
+  }
+  uint64_t t2 = msh_time_now();
+  return msh_time_diff( MSHT_MILLISECONDS, t2, t1 );
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+// Planar images
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+int validate_layouts( int nc, int w, int h, msh_rand_ctx_t* rand_gen )
+{
+  msh_img_f32_t src_f32 = mship_img_f32_init( w, h, nc, 0 );
+  msh_img_f32_t dst_f32 = mship_img_f32_init( w, h, nc, 1 );
+  msh_img_ui8_t src_ui8 = mship_img_ui8_init( w, h, nc, 0 );
+  msh_img_ui8_t dst_ui8 = mship_img_ui8_init( w, h, nc, 1 );
+  msh_img_planar_f32_t planar_f32 = mship_img_planar_f32_init( w, h, nc, 0 );
+  msh_img_planar_ui8_t planar_ui8 = mship_img_planar_ui8_init( w, h, nc, 0 );
+  for( int i = 0; i < w * h * nc; ++i )
+  {
+    src_ui8.data[i] = (unsigned char)( msh_rand_next( rand_gen ) & 0xFF );
+    src_f32.data[i] = msh_rand_nextf( rand_gen );
+  }
+  mship_deinterleave_f32( &src_f32, &planar_f32 );
+  mship_deinterleave_ui8( &src_ui8, &planar_ui8 );
+  int ok = 1;
+  for( int y = 0; y < h; ++y )
+  {
+    for( int x = 0; x < w; ++x )
+    {
+      for( int c = 0; c < nc; ++c )
+      {
+        ok &= mship_planar_plane_f32( &planar_f32, c )[y * w + x] == mship_pixel_ptr_f32( &src_f32, x, y )[c];
+        ok &= mship_planar_plane_ui8( &planar_ui8, c )[y * w + x] == mship_pixel_ptr_ui8( &src_ui8, x, y )[c];
+      }
+    }
+  }
+  mship_interleave_f32( &planar_f32, &dst_f32 );
+  mship_interleave_ui8( &planar_ui8, &dst_ui8 );
+  ok &= !memcmp( src_f32.data, dst_f32.data, (size_t)w * h * nc * sizeof(float) );
+  ok &= !memcmp( src_ui8.data, dst_ui8.data, (size_t)w * h * nc );
+  if( !ok ) { printf("  %d ch %dx%d: round trip FAILED\n", nc, w, h ); }
+
+  free( src_f32.data );
+  free( dst_f32.data );
+  free( src_ui8.data );
+  free( dst_ui8.data );
+  mship_img_planar_f32_free( &planar_f32 );
+  mship_img_planar_ui8_free( &planar_ui8 );
+  return ok;
+}
+
+// Bilinear sampling of an interleaved image, one point and all channels at a time.
+void sample_bl_interleaved( msh_img_f32_t* img, float x, float y, float* out )
+{
+  x = msh_clamp( x, 0.0f, (float)( img->width - 1 ) );
+  y = msh_clamp( y, 0.0f, (float)( img->height - 1 ) );
+  int x0 = (int)x, y0 = (int)y;
+  int x1 = msh_min( x0 + 1, img->width - 1 ), y1 = msh_min( y0 + 1, img->height - 1 );
+  float fx = x - x0, fy = y - y0;
+  float* p00 = mship_pixel_ptr_f32( img, x0, y0 );
+  float* p01 = mship_pixel_ptr_f32( img, x1, y0 );
+  float* p10 = mship_pixel_ptr_f32( img, x0, y1 );
+  float* p11 = mship_pixel_ptr_f32( img, x1, y1 );
+  for( int c = 0; c < img->n_comp; ++c )
+  {
+    float top = p00[c] + fx * ( p01[c] - p00[c] );
+    float bottom = p10[c] + fx * ( p11[c] - p10[c] );
+    out[c] = top + fy * ( bottom - top );
+  }
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+// Pipeline
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void contrast_row( float* row, int width, int n_comp, int y, void* data )
+{
+  (void)y;
+  float gain = *(float*)data;
+  for( int i = 0; i < width * n_comp; ++i ) { row[i] = ( row[i] - 128.0f ) * gain + 128.0f; }
+}
+
+// Same rounding as the pipeline uses for ui8 output.
+void convert_to_ui8( const float* src, unsigned char* dst, size_t n )
+{
+  for( size_t i = 0; i < n; ++i )
+  {
+    float v = src[i] + 0.5f;
+    dst[i] = (unsigned char)( v < 0.0f ? 0.0f : ( v > 255.0f ? 255.0f : v ) );
+  }
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+// Benchmarks, run with --bench
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+typedef enum { BENCH_RESIZE_BILINEAR, BENCH_RESIZE_LANCZOS3, BENCH_BOX_BLUR, BENCH_GAUSSIAN_BLUR,
+               BENCH_DEINTERLEAVE } bench_op_t;
+
+typedef struct bench_data
+{
+  bench_op_t op;
+  msh_img_ui8_t* src;
+  msh_img_ui8_t* dst;
+  msh_img_planar_ui8_t* planar;
+} bench_data_t;
+
+void bench_img_op( void* data, size_t n_iters )
+{
+  bench_data_t* d = data;
+  for( size_t it = 0; it < n_iters; ++it )
+  {
+    switch( d->op )
+    {
+      case BENCH_RESIZE_BILINEAR: mship_resize_ui8( d->src, d->dst, MSHIP_FILTER_BILINEAR ); break;
+      case BENCH_RESIZE_LANCZOS3: mship_resize_ui8( d->src, d->dst, MSHIP_FILTER_LANCZOS3 ); break;
+      case BENCH_BOX_BLUR:        mship_box_blur_ui8( d->src, d->dst, 5, MSHIP_BORDER_CLAMP ); break;
+      case BENCH_GAUSSIAN_BLUR:   mship_gaussian_blur_ui8( d->src, d->dst, 8.0f, MSHIP_BORDER_CLAMP ); break;
+      case BENCH_DEINTERLEAVE:    mship_deinterleave_ui8( d->src, d->planar ); break;
+    }
+    MSH_BENCH_CLOBBER();
+  }
+}
+
+int run_benchmarks( int argc, char** argv )
+{
+  msh_img_ui8_t src = mship_img_ui8_init( 1024, 768, 3, 0 );
+  msh_img_ui8_t half = mship_img_ui8_init( 512, 384, 3, 0 );
+  msh_img_ui8_t full = mship_img_ui8_init( 1024, 768, 3, 0 );
+  msh_img_planar_ui8_t planar = mship_img_planar_ui8_init( 1024, 768, 3, 0 );
+  fill_test_image( &src );
+
+  bench_data_t d[] = { { BENCH_RESIZE_BILINEAR, &src, &half, NULL },
+                       { BENCH_RESIZE_LANCZOS3, &src, &half, NULL },
+                       { BENCH_BOX_BLUR, &src, &full, NULL },
+                       { BENCH_GAUSSIAN_BLUR, &src, &full, NULL },
+                       { BENCH_DEINTERLEAVE, &src, NULL, &planar } };
+  const char* names[] = { "resize bilinear 1/2, per px", "resize lanczos3 1/2, per px", "box blur r5, per px",
+                          "gaussian blur s8, per px", "deinterleave, per px" };
+  msh_bench_t* b = msh_bench_create( argc, argv );
+  for( int k = 0; k < (int)msh_count_of( d ); ++k )
+  {
+    size_t n_pixels = d[k].dst ? (size_t)d[k].dst->width * d[k].dst->height : (size_t)src.width * src.height;
+    msh_bench_add( b, names[k], bench_img_op, &d[k], n_pixels );
+  }
+  int n_regressions = msh_bench_run( b );
+  msh_bench_destroy( b );
+  mship_img_ui8_free( &src );
+  mship_img_ui8_free( &half );
+  mship_img_ui8_free( &full );
+  mship_img_planar_ui8_free( &planar );
+  return n_regressions ? 1 : 0;
+}
+
+int main( int argc, char** argv )
+{
+  if( msh_bench_requested( argc, argv ) ) { return run_benchmarks( argc, argv ); }
+  int max_n_threads = argc > 1 ? atoi( argv[1] ) : 8;
+  int n_failed = 0;
+  msh_rand_ctx_t rand_gen = {0};
+  msh_rand_init( &rand_gen, 12345ULL );
+
+  //----------------------------------------------------------------------------------------------
+  printf("Validation against direct evaluation:\n");
+  {
+    int sizes[][4] = { { 37, 23, 80, 50 }, { 37, 23, 13, 7 }, { 37, 23, 37, 23 },
+                       { 37, 23, 5, 40 }, { 64, 64, 3, 3 }, { 2, 3, 17, 1 } };
+    int n_cases = 0;
+    for( int f = MSHIP_FILTER_NEAREST; f <= MSHIP_FILTER_LANCZOS3; ++f )
+    {
+      for( int nc = 1; nc <= 4; ++nc )
+      {
+        for( size_t s = 0; s < msh_count_of( sizes ); ++s )
+        {
+          n_failed += !validate( (mship_filter_t)f, nc, sizes[s][0], sizes[s][1],
+                                 sizes[s][2], sizes[s][3], &rand_gen );
+          n_cases++;
+        }
+      }
+    }
+    printf("  %d cases, %d failed\n", n_cases, n_failed );
+  }
+
+  //----------------------------------------------------------------------------------------------
+  printf("Per-pixel sampling vs. whole image resize (3 channels, ui8):\n");
+  {
+    int cases[][4] = { { 1024, 768, 2048, 1536 }, { 4000, 3000, 256, 192 } };
+    for( size_t i = 0; i < msh_count_of( cases ); ++i )
+    {
+      msh_img_ui8_t src = mship_img_ui8_init( cases[i][0], cases[i][1], 3, 0 );
+      msh_img_ui8_t dst = mship_img_ui8_init( cases[i][2], cases[i][3], 3, 0 );
+      fill_test_image( &src );
+      double loop_nn = per_pixel_resize( &src, &dst, 0 );
+      double loop_bl = per_pixel_resize( &src, &dst, 1 );
+      double nn = time_resize_ui8( &src, &dst, MSHIP_FILTER_NEAREST, 3 );
+      double bl = time_resize_ui8( &src, &dst, MSHIP_FILTER_BILINEAR, 3 );
+      printf("  %4dx%-4d -> %4dx%-4d: nearest loop %8.3fms, resize %8.3fms (%5.1fx) | "
+             "bilinear loop %8.3fms, resize %8.3fms (%5.1fx)\n",
+             cases[i][0], cases[i][1], cases[i][2], cases[i][3],
+             loop_nn, nn, loop_nn / nn, loop_bl, bl, loop_bl / bl );
+      if( cases[i][2] < cases[i][0] )
+      {
+        double box = time_resize_ui8( &src, &dst, MSHIP_FILTER_BOX, 3 );
+        double lanczos = time_resize_ui8( &src, &dst, MSHIP_FILTER_LANCZOS3, 3 );
+        printf("  %21s  box %8.3fms, lanczos3 %8.3fms (antialiased thumbnail)\n", "", box, lanczos );
+      }
+      free( src.data );
+      free( dst.data );
+    }
+  }
+
+  //----------------------------------------------------------------------------------------------
+  printf("Throughput in output Mpix/s:\n");
+  {
+    int cases[][4] = { { 1920, 1080, 480, 270 }, { 640, 360, 1920, 1080 } };
+    for( size_t i = 0; i < msh_count_of( cases ); ++i )
+    {
+      int sw = cases[i][0], sh = cases[i][1], dw = cases[i][2], dh = cases[i][3];
+      printf("  %dx%d -> %dx%d\n", sw, sh, dw, dh );
+      printf("  %-10s", "" );
+      for( int nc = 1; nc <= 4; ++nc ) { printf("  ui8 %dch  f32 %dch", nc, nc ); }
+      printf("\n");
+      for( int f = MSHIP_FILTER_NEAREST; f <= MSHIP_FILTER_LANCZOS3; ++f )
+      {
+        printf("  %-10s", filter_names[f] );
+        for( int nc = 1; nc <= 4; ++nc )
+        {
+          msh_img_ui8_t src_ui8 = mship_img_ui8_init( sw, sh, nc, 0 );
+          msh_img_ui8_t dst_ui8 = mship_img_ui8_init( dw, dh, nc, 0 );
+          msh_img_f32_t src_f32 = mship_img_f32_init( sw, sh, nc, 0 );
+          msh_img_f32_t dst_f32 = mship_img_f32_init( dw, dh, nc, 0 );
+          fill_test_image( &src_ui8 );
+          for( int p = 0; p < sw * sh * nc; ++p ) { src_f32.data[p] = src_ui8.data[p]; }
+          double t_ui8 = time_resize_ui8( &src_ui8, &dst_ui8, (mship_filter_t)f, 3 );
+          double t_f32 = time_resize_f32( &src_f32, &dst_f32, (mship_filter_t)f, 3 );
+          double mpix = dw * dh * 1e-6;
+          printf("  %8.1f %8.1f", mpix / ( t_ui8 * 1e-3 ), mpix / ( t_f32 * 1e-3 ) );
+          free( src_ui8.data );
+          free( dst_ui8.data );
+          free( src_f32.data );
+          free( dst_f32.data );
+        }
+        printf("\n");
+      }
+    }
+  }
+
+  //----------------------------------------------------------------------------------------------
+  printf("Filter validation against direct 2D convolution:\n");
+  {
+    int n_cases = 0, n_ok = 0;
+    int sizes[] = { 1, 2, 5, 9 };
+    for( int kind = FILTER_CONVOLVE; kind <= FILTER_GAUSSIAN; ++kind )
+    {
+      for( int border = MSHIP_BORDER_CLAMP; border <= MSHIP_BORDER_ZERO; ++border )
+      {
+        for( int nc = 1; nc <= 4; ++nc )
+        {
+          for( int i = 0; i < (int)msh_count_of( sizes ); ++i )
+          {
+            // Small images make the kernel reach past both edges, several times for mirror and wrap.
+            n_ok += validate_filter( (filter_kind_t)kind, nc, 37, 29, sizes[i], (mship_border_t)border, &rand_gen );
+            n_ok += validate_filter( (filter_kind_t)kind, nc, 5, 7, sizes[i], (mship_border_t)border, &rand_gen );
+            n_cases += 2;
+          }
+        }
+      }
+    }
+    n_failed += n_cases - n_ok;
+    printf("  %d/%d cases within tolerance\n", n_ok, n_cases );
+
+    // How far the three box approximation is from a true Gaussian, on a smooth image.
+    int w = 256, h = 256;
+    msh_img_f32_t src = mship_img_f32_init( w, h, 1, 0 );
+    msh_img_f32_t approx = mship_img_f32_init( w, h, 1, 0 );
+    msh_img_f32_t exact = mship_img_f32_init( w, h, 1, 0 );
+    for( int y = 0; y < h; ++y )
+    {
+      for( int x = 0; x < w; ++x ) { src.data[y * w + x] = ( ( x / 16 + y / 16 ) & 1 ) ? 255.0f : 0.0f; }
+    }
+    float sigmas[] = { 1.0f, 2.0f, 4.0f, 8.0f };
+    for( int i = 0; i < (int)msh_count_of( sigmas ); ++i )
+    {
+      int r = (int)ceilf( 3.0f * sigmas[i] );
+      float* kernel = malloc( ( 2 * r + 1 ) * sizeof(float) );
+      mship_gaussian_kernel( sigmas[i], r, kernel );
+      mship_convolve_f32( &src, &exact, kernel, r, kernel, r, MSHIP_BORDER_MIRROR );
+      mship_gaussian_blur_f32( &src, &approx, sigmas[i], MSHIP_BORDER_MIRROR );
+      double max_diff = 0.0;
+      for( int j = 0; j < w * h; ++j ) { max_diff = msh_max( max_diff, fabs( approx.data[j] - exact.data[j] ) ); }
+      int radii[3];
+      mship_gaussian_box_radii( sigmas[i], radii );
+      printf("  Gaussian sigma %4.1f as boxes of radii %d, %d, %d: max. difference to exact %5.2f/255\n",
+             sigmas[i], radii[0], radii[1], radii[2], max_diff );
+      free( kernel );
+    }
+    free( src.data );
+    free( approx.data );
+    free( exact.data );
+  }
+
+  //----------------------------------------------------------------------------------------------
+  printf("Blur times in ms for growing radius (1920x1080, 3 channels ui8 / 4 channels f32):\n");
+  {
+    int w = 1920, h = 1080;
+    msh_img_ui8_t src_ui8 = mship_img_ui8_init( w, h, 3, 0 );
+    msh_img_ui8_t dst_ui8 = mship_img_ui8_init( w, h, 3, 0 );
+    msh_img_ui8_t tmp_ui8 = mship_img_ui8_init( w, h, 4, 0 );
+    msh_img_f32_t src_f32 = mship_img_f32_init( w, h, 4, 0 );
+    msh_img_f32_t dst_f32 = mship_img_f32_init( w, h, 4, 0 );
+    fill_test_image( &src_ui8 );
+    fill_test_image( &tmp_ui8 );
+    for( size_t i = 0; i < (size_t)w * h * 4; ++i ) { src_f32.data[i] = tmp_ui8.data[i]; }
+
+    printf("  %6s | %10s | %21s | %21s | %21s | %21s\n", "radius", "per-pixel",
+           "convolve (box kernel)", "box blur", "gaussian conv. r/3", "gaussian 3 boxes r/3" );
+    int radii[] = { 1, 2, 4, 8, 16, 32, 64 };
+    for( int i = 0; i < (int)msh_count_of( radii ); ++i )
+    {
+      int r = radii[i];
+      float sigma = msh_max( r / 3.0f, 0.5f );
+      float* box_kernel = malloc( ( 2 * r + 1 ) * sizeof(float) );
+      float* gauss_kernel = malloc( ( 2 * r + 1 ) * sizeof(float) );
+      for( int k = 0; k < 2 * r + 1; ++k ) { box_kernel[k] = 1.0f / ( 2 * r + 1 ); }
+      mship_gaussian_kernel( sigma, r, gauss_kernel );
+
+      double t[4][2];
+      for( int m = 0; m < 4; ++m )
+      {
+        for( int f = 0; f < 2; ++f )
+        {
+          uint64_t t1 = msh_time_now();
+          if( m == 0 && !f ) { mship_convolve_ui8( &src_ui8, &dst_ui8, box_kernel, r, box_kernel, r, MSHIP_BORDER_CLAMP ); }
+          if( m == 0 &&  f ) { mship_convolve_f32( &src_f32, &dst_f32, box_kernel, r, box_kernel, r, MSHIP_BORDER_CLAMP ); }
+          if( m == 1 && !f ) { mship_box_blur_ui8( &src_ui8, &dst_ui8, r, MSHIP_BORDER_CLAMP ); }
+          if( m == 1 &&  f ) { mship_box_blur_f32( &src_f32, &dst_f32, r, MSHIP_BORDER_CLAMP ); }
+          if( m == 2 && !f ) { mship_convolve_ui8( &src_ui8, &dst_ui8, gauss_kernel, r, gauss_kernel, r, MSHIP_BORDER_CLAMP ); }
+          if( m == 2 &&  f ) { mship_convolve_f32( &src_f32, &dst_f32, gauss_kernel, r, gauss_kernel, r, MSHIP_BORDER_CLAMP ); }
+          if( m == 3 && !f ) { mship_gaussian_blur_ui8( &src_ui8, &dst_ui8, sigma, MSHIP_BORDER_CLAMP ); }
+          if( m == 3 &&  f ) { mship_gaussian_blur_f32( &src_f32, &dst_f32, sigma, MSHIP_BORDER_CLAMP ); }
+          uint64_t t2 = msh_time_now();
+          t[m][f] = msh_time_diff( MSHT_MILLISECONDS, t2, t1 );
+        }
+      }
+      char per_pixel[32] = "-";
+      if( r <= 8 ) { snprintf( per_pixel, sizeof(per_pixel), "%.1f", per_pixel_box_blur( &src_ui8, &dst_ui8, r ) ); }
+      printf("  %6d | %10s | %9.1f / %9.1f | %9.1f / %9.1f | %9.1f / %9.1f | %9.1f / %9.1f\n", r,
+             per_pixel, t[0][0], t[0][1], t[1][0], t[1][1], t[2][0], t[2][1], t[3][0], t[3][1] );
+      free( box_kernel );
+      free( gauss_kernel );
+    }
+    free( src_ui8.data );
+    free( dst_ui8.data );
+    free( tmp_ui8.data );
+    free( src_f32.data );
+    free( dst_f32.data );
+  }
+
+  //----------------------------------------------------------------------------------------------
+  printf("Planar images:\n");
+  {
+    int n_cases = 0, n_ok = 0;
+    for( int nc = 1; nc <= 4; ++nc )
+    {
+      n_ok += validate_layouts( nc, 101, 7, &rand_gen );
+      n_ok += validate_layouts( nc, 3, 5, &rand_gen );
+      n_cases += 2;
+    }
+    n_failed += n_cases - n_ok;
+    printf("  Layout round trips: %d/%d cases exact\n", n_ok, n_cases );
+
+    int w = 4096, h = 3072;
+    for( int nc = 2; nc <= 4; ++nc )
+    {
+      msh_img_f32_t img_f32 = mship_img_f32_init( w, h, nc, 0 );
+      msh_img_ui8_t img_ui8 = mship_img_ui8_init( w, h, nc, 0 );
+      msh_img_planar_f32_t planar_f32 = mship_img_planar_f32_init( w, h, nc, 0 );
+      msh_img_planar_ui8_t planar_ui8 = mship_img_planar_ui8_init( w, h, nc, 0 );
+      size_t n = (size_t)w * h;
+      // Touch all pages up front, so that no timing includes page faults.
+      memset( img_f32.data, 1, n * nc * sizeof(float) );
+      memset( img_ui8.data, 1, n * nc );
+      memset( planar_f32.data, 1, planar_f32.plane_size * nc * sizeof(float) );
+      memset( planar_ui8.data, 1, planar_ui8.plane_size * nc );
+
+      // Plain loop over pixels and channels, as one would write without the conversion functions.
+      uint64_t t1 = msh_time_now();
+      for( int c = 0; c < nc; ++c )
+      {
+        float* plane = mship_planar_plane_f32( &planar_f32, c );
+        for( size_t i = 0; i < n; ++i ) { plane[i] = img_f32.data[i * nc + c]; }
+      }
+      uint64_t t2 = msh_time_now();
+      double loop_f32 = msh_time_diff( MSHT_MILLISECONDS, t2, t1 );
+      t1 = msh_time_now();
+      mship_deinterleave_f32( &img_f32, &planar_f32 );
+      t2 = msh_time_now();
+      double deinterleave_f32 = msh_time_diff( MSHT_MILLISECONDS, t2, t1 );
+      t1 = msh_time_now();
+      mship_interleave_f32( &planar_f32, &img_f32 );
+      t2 = msh_time_now();
+      double interleave_f32 = msh_time_diff( MSHT_MILLISECONDS, t2, t1 );
+
+      t1 = msh_time_now();
+      for( int c = 0; c < nc; ++c )
+      {
+        uint8_t* plane = mship_planar_plane_ui8( &planar_ui8, c );
+        for( size_t i = 0; i < n; ++i ) { plane[i] = img_ui8.data[i * nc + c]; }
+      }
+      t2 = msh_time_now();
+      double loop_ui8 = msh_time_diff( MSHT_MILLISECONDS, t2, t1 );
+      t1 = msh_time_now();
+      mship_deinterleave_ui8( &img_ui8, &planar_ui8 );
+      t2 = msh_time_now();
+      double deinterleave_ui8 = msh_time_diff( MSHT_MILLISECONDS, t2, t1 );
+      t1 = msh_time_now();
+      mship_interleave_ui8( &planar_ui8, &img_ui8 );
+      t2 = msh_time_now();
+      double interleave_ui8 = msh_time_diff( MSHT_MILLISECONDS, t2, t1 );
+
+      printf("  %dx%d %d ch deinterleave f32: loop %7.2fms, simd %7.2fms, interleave %7.2fms | "
+             "ui8: loop %7.2fms, simd %7.2fms, interleave %7.2fms\n", w, h, nc, loop_f32,
+             deinterleave_f32, interleave_f32, loop_ui8, deinterleave_ui8, interleave_ui8 );
+      free( img_f32.data );
+      free( img_ui8.data );
+      mship_img_planar_f32_free( &planar_f32 );
+      mship_img_planar_ui8_free( &planar_ui8 );
+    }
+
+    // Blurring each plane as a 1 channel view gives the same result as the interleaved blur.
+    {
+      int bw = 1920, bh = 1080, nc = 4;
+      msh_img_ui8_t tmp = mship_img_ui8_init( bw, bh, nc, 0 );
+      msh_img_f32_t src = mship_img_f32_init( bw, bh, nc, 0 );
+      msh_img_f32_t dst = mship_img_f32_init( bw, bh, nc, 0 );
+      msh_img_f32_t result = mship_img_f32_init( bw, bh, nc, 0 );
+      msh_img_planar_f32_t planar = mship_img_planar_f32_init( bw, bh, nc, 0 );
+      msh_img_planar_f32_t planar_dst = mship_img_planar_f32_init( bw, bh, nc, 0 );
+      fill_test_image( &tmp );
+      for( size_t i = 0; i < (size_t)bw * bh * nc; ++i ) { src.data[i] = tmp.data[i]; }
+      float kernel[2 * 6 + 1];
+      mship_gaussian_kernel( 2.0f, 6, kernel );
+      memset( dst.data, 0, (size_t)bw * bh * nc * sizeof(float) );
+      memset( result.data, 0, (size_t)bw * bh * nc * sizeof(float) );
+      memset( planar.data, 0, planar.plane_size * nc * sizeof(float) );
+      memset( planar_dst.data, 0, planar_dst.plane_size * nc * sizeof(float) );
+
+      uint64_t t1 = msh_time_now();
+      mship_convolve_f32( &src, &dst, kernel, 6, kernel, 6, MSHIP_BORDER_MIRROR );
+      uint64_t t2 = msh_time_now();
+      double interleaved_time = msh_time_diff( MSHT_MILLISECONDS, t2, t1 );
+      t1 = msh_time_now();
+      mship_deinterleave_f32( &src, &planar );
+      for( int c = 0; c < nc; ++c )
+      {
+        msh_img_f32_t plane_src = mship_planar_view_f32( &planar, c );
+        msh_img_f32_t plane_dst = mship_planar_view_f32( &planar_dst, c );
+        mship_convolve_f32( &plane_src, &plane_dst, kernel, 6, kernel, 6, MSHIP_BORDER_MIRROR );
+      }
+      mship_interleave_f32( &planar_dst, &result );
+      t2 = msh_time_now();
+      double planar_time = msh_time_diff( MSHT_MILLISECONDS, t2, t1 );
+      double max_diff = 0.0;
+      for( size_t i = 0; i < (size_t)bw * bh * nc; ++i ) { max_diff = msh_max( max_diff, fabs( dst.data[i] - result.data[i] ) ); }
+      int ok = max_diff < 1e-3;
+      n_failed += !ok;
+      printf("  %dx%d %d ch gaussian convolution: interleaved %7.2fms, per plane incl. conversions "
+             "%7.2fms%s\n", bw, bh, nc, interleaved_time, planar_time, ok ? "" : " MISMATCH" );
+      free( tmp.data );
+      free( src.data );
+      free( dst.data );
+      free( result.data );
+      mship_img_planar_f32_free( &planar );
+      mship_img_planar_f32_free( &planar_dst );
+    }
+
+    // Bilinear sampling at random positions.
+    {
+      int sw = 2048, sh = 2048, nc = 3, n = 1 << 22;
+      msh_img_f32_t img = mship_img_f32_init( sw, sh, nc, 0 );
+      msh_img_planar_f32_t planar = mship_img_planar_f32_init( sw, sh, nc, 0 );
+      for( int i = 0; i < sw * sh * nc; ++i ) { img.data[i] = msh_rand_nextf( &rand_gen ) * 255.0f; }
+      mship_deinterleave_f32( &img, &planar );
+      float* xs = malloc( n * sizeof(float) );
+      float* ys = malloc( n * sizeof(float) );
+      float* interleaved_out = malloc( n * nc * sizeof(float) );
+      float* planar_out[3];
+      for( int c = 0; c < nc; ++c ) { planar_out[c] = malloc( n * sizeof(float) ); }
+      for( int i = 0; i < n; ++i )
+      {
+        // Some positions fall outside to exercise clamping.
+        xs[i] = msh_rand_nextf( &rand_gen ) * ( sw + 4 ) - 2.0f;
+        ys[i] = msh_rand_nextf( &rand_gen ) * ( sh + 4 ) - 2.0f;
+      }
+      uint64_t t1 = msh_time_now();
+      for( int i = 0; i < n; ++i ) { sample_bl_interleaved( &img, xs[i], ys[i], interleaved_out + i * nc ); }
+      uint64_t t2 = msh_time_now();
+      double interleaved_time = msh_time_diff( MSHT_MILLISECONDS, t2, t1 );
+      t1 = msh_time_now();
+      mship_planar_sample_many_bl_f32( &planar, xs, ys, n, planar_out );
+      t2 = msh_time_now();
+      double planar_time = msh_time_diff( MSHT_MILLISECONDS, t2, t1 );
+      double max_diff = 0.0;
+      for( int i = 0; i < n; ++i )
+      {
+        for( int c = 0; c < nc; ++c ) { max_diff = msh_max( max_diff, fabs( planar_out[c][i] - interleaved_out[i * nc + c] ) ); }
+      }
+      int ok = max_diff < 1e-3;
+      n_failed += !ok;
+      printf("  %d bilinear samples of %dx%d %d ch: interleaved loop %7.2fms, planar batch %7.2fms (%4.1fx)%s\n",
+             n, sw, sh, nc, interleaved_time, planar_time, interleaved_time / planar_time, ok ? "" : " MISMATCH" );
+      free( img.data );
+      mship_img_planar_f32_free( &planar );
+      free( xs );
+      free( ys );
+      free( interleaved_out );
+      for( int c = 0; c < nc; ++c ) { free( planar_out[c] ); }
+    }
+  }
+
+  //----------------------------------------------------------------------------------------------
+  printf("Fused pipeline vs. separate passes (ui8 -> f32 -> lanczos3 1/2 -> contrast -> ui8):\n");
+  {
+    int sw = 4096, sh = 3072, nc = 3;
+    int dw = sw / 2, dh = sh / 2;
+    float gain = 1.2f;
+    msh_img_ui8_t src = mship_img_ui8_init( sw, sh, nc, 0 );
+    msh_img_ui8_t reference = mship_img_ui8_init( dw, dh, nc, 0 );
+    msh_img_ui8_t dst = mship_img_ui8_init( dw, dh, nc, 0 );
+    fill_test_image( &src );
+
+    uint64_t t1 = msh_time_now();
+    msh_img_f32_t src_f32 = mship_img_f32_init( sw, sh, nc, 0 );
+    msh_img_f32_t resized_f32 = mship_img_f32_init( dw, dh, nc, 0 );
+    for( size_t i = 0; i < (size_t)sw * sh * nc; ++i ) { src_f32.data[i] = src.data[i]; }
+    mship_resize_f32( &src_f32, &resized_f32, MSHIP_FILTER_LANCZOS3 );
+    for( int y = 0; y < dh; ++y ) { contrast_row( resized_f32.data + (size_t)y * dw * nc, dw, nc, y, &gain ); }
+    convert_to_ui8( resized_f32.data, reference.data, (size_t)dw * dh * nc );
+    uint64_t t2 = msh_time_now();
+    double separate_time = msh_time_diff( MSHT_MILLISECONDS, t2, t1 );
+    double intermediate_mb = ( (double)sw * sh + (double)dw * dh ) * nc * sizeof(float) / ( 1024.0 * 1024.0 );
+    printf("  Separate passes: %9.3fms, %.1fMB of intermediate images\n", separate_time, intermediate_mb );
+    free( src_f32.data );
+    free( resized_f32.data );
+
+    for( int n_threads = 1; n_threads <= max_n_threads; n_threads *= 2 )
+    {
+      msh_jobs_t* jobs = msh_jobs_create( n_threads - 1 );
+      mship_pipeline_t* p = mship_pipeline_create_ui8( &src );
+      mship_pipeline_resize( p, dw, dh, MSHIP_FILTER_LANCZOS3 );
+      mship_pipeline_map_rows( p, contrast_row, &gain );
+      memset( dst.data, 0, (size_t)dw * dh * nc );
+      t1 = msh_time_now();
+      mship_pipeline_run_ui8( p, &dst, jobs );
+      t2 = msh_time_now();
+      double pipeline_time = msh_time_diff( MSHT_MILLISECONDS, t2, t1 );
+      int ok = !memcmp( dst.data, reference.data, (size_t)dw * dh * nc );
+      n_failed += !ok;
+      printf("  Pipeline, %2d threads: %9.3fms (%5.2fx)%s\n", n_threads, pipeline_time,
+             separate_time / pipeline_time, ok ? "" : " MISMATCH" );
+      mship_pipeline_destroy( p );
+      msh_jobs_destroy( jobs );
+    }
+    free( src.data );
+    free( reference.data );
+    free( dst.data );
+  }
+
+  printf("%d failed\n", n_failed );
+  return n_failed ? 1 : 0;
+}
@@ -0,0 +1,528 @@
+/*
+  ==============================================================================
+
+  MSH_JOBS.H v0.1
+
+  A single header library implementing a small work-stealing job system:
+
+    - fixed pool of worker threads, each with its own job queue
+    - idle workers steal from the other queues
+    - parallel-for with a grain size, split recursively so that work spreads by stealing
+    - job counters for waiting on a group of jobs, and continuations that start once a
+      counter reaches zero
+    - thread that waits on a counter executes jobs instead of blocking
+
+  To use the library you simply add:
+
+  #define MSH_JOBS_IMPLEMENTATION
+  #include "msh_jobs.h"
+
+  ==============================================================================
+  DOCUMENTATION
+
+  Setup
+    msh_jobs_t* jobs = msh_jobs_create( -1 );  // number of workers, -1 -> one per core minus one
+    ...
+    msh_jobs_destroy( jobs );
+
+    Thread that calls msh_jobs_wait also executes jobs, so msh_jobs_n_threads() - the number
+    of workers plus one - is the amount of parallelism to split work for. With zero workers all
+    jobs run on the waiting thread. Number of workers is capped at MSH_JOBS_MAX_WORKERS.
+
+  Jobs and counters
+    msh_job_counter_t counter = {0};
+    msh_jobs_submit( jobs, fn, data, &counter );        // counter incremented now,
+    msh_jobs_submit( jobs, fn, data, &counter );        // decremented when job completes
+    msh_jobs_wait( jobs, &counter );                    // helps until counter drops to zero
+
+    Jobs can submit more jobs, and wait on counters themselves. Counters need to stay alive
+    until waiting on them returns, and should not be reused before that.
+
+  Continuations
+    msh_job_counter_t stage_a = {0}, stage_b = {0};
+    ...                                                 // submit jobs counted by stage_a
+    msh_jobs_submit_after( jobs, fn, data, &stage_b, &stage_a );
+
+    Job is queued once all jobs counted by 'stage_a' completed, or immediately if there are
+    none. It counts towards 'stage_b' from the moment it is submitted, so waiting on stage_b
+    waits for the whole chain. Dependencies on many jobs are expressed by counting them with
+    one counter.
+
+  Parallel for
+    void fn( void* data, size_t start, size_t end );
+    msh_jobs_parallel_for( jobs, n, grain, fn, data );  // blocks, calling thread helps
+    msh_jobs_submit_range( jobs, n, grain, fn, data, &counter );  // asynchronous version
+
+    Range [0, n) is split in halves until pieces are at most 'grain' long. Halves are pushed to
+    the queue of the thread that split them, and idle threads steal the largest pieces first.
+
+  Implementation notes
+    Queues are ring buffers protected by a mutex each. Owner pushes and pops at the bottom,
+    thieves take from the top, so a thread works through its own most recent jobs while others
+    take the oldest (and for parallel-for, largest) ones. Threads that are not workers submit to
+    a shared queue. Idle workers spin briefly before sleeping on a condition variable.
+
+  ==============================================================================
+  AUTHORS:
+    Maciej Halber
+
+  LICENSE:
+    CC0
+  ==============================================================================
+*/
+
+#ifndef MSH_JOBS_H
+#define MSH_JOBS_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#ifndef MSH_JOBS_DEF
+#ifdef MSH_JOBS_STATIC
+#define MSH_JOBS_DEF static
+#else
+#define MSH_JOBS_DEF extern
+#endif
+#endif
+
+typedef void (*msh_job_fn)( void* data );
+typedef void (*msh_job_range_fn)( void* data, size_t start, size_t end );
+
+typedef struct msh__job_node msh__job_node_t;
+
+typedef struct msh_job_counter
+{
+  int64_t count;
+  int lock;                          // protects continuations
+  msh__job_node_t* continuations;
+} msh_job_counter_t;
+
+typedef struct msh_jobs msh_jobs_t;
+
+MSH_JOBS_DEF msh_jobs_t* msh_jobs_create( int n_workers );
+MSH_JOBS_DEF void        msh_jobs_destroy( msh_jobs_t* jobs );
+MSH_JOBS_DEF int         msh_jobs_n_threads( const msh_jobs_t* jobs );
+
+MSH_JOBS_DEF void msh_jobs_submit( msh_jobs_t* jobs, msh_job_fn fn, void* data, msh_job_counter_t* counter );
+MSH_JOBS_DEF void msh_jobs_submit_after( msh_jobs_t* jobs, msh_job_fn fn, void* data,
+                                         msh_job_counter_t* counter, msh_job_counter_t* dependency );
+MSH_JOBS_DEF void msh_jobs_submit_range( msh_jobs_t* jobs, size_t n, size_t grain, msh_job_range_fn fn,
+                                         void* data, msh_job_counter_t* counter );
+MSH_JOBS_DEF void msh_jobs_wait( msh_jobs_t* jobs, msh_job_counter_t* counter );
+MSH_JOBS_DEF void msh_jobs_parallel_for( msh_jobs_t* jobs, size_t n, size_t grain,
+                                         msh_job_range_fn fn, void* data );
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* MSH_JOBS_H */
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+// IMPLEMENTATION
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+#ifdef MSH_JOBS_IMPLEMENTATION
+
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+#include <sched.h>
+#include <unistd.h>
+
+#ifndef MSH_JOBS_SPIN_COUNT
+#define MSH_JOBS_SPIN_COUNT 256
+#endif
+
+#ifndef MSH_JOBS_MAX_WORKERS
+#define MSH_JOBS_MAX_WORKERS 255
+#endif
+
+// Queues, workers and continuation nodes are tracked under "msh_jobs" when msh_mem.h is
+// included first.
+#ifndef MSH_JOBS_MALLOC
+#ifdef MSH_MEM_H
+#define MSH_JOBS_MALLOC( size )        msh_mem_alloc( "msh_jobs", size )
+#define MSH_JOBS_CALLOC( count, size ) msh_mem_calloc( "msh_jobs", count, size )
+#define MSH_JOBS_FREE( ptr )           msh_mem_free( ptr )
+#else
+#define MSH_JOBS_MALLOC( size )        malloc( size )
+#define MSH_JOBS_CALLOC( count, size ) calloc( count, size )
+#define MSH_JOBS_FREE( ptr )           free( ptr )
+#endif
+#endif
+
+#define msh__jobs_load( ptr )        __atomic_load_n( (ptr), __ATOMIC_SEQ_CST )
+#define msh__jobs_store( ptr, val )  __atomic_store_n( (ptr), (val), __ATOMIC_SEQ_CST )
+#define msh__jobs_add( ptr, val )    __atomic_add_fetch( (ptr), (val), __ATOMIC_SEQ_CST )
+
+#define msh__jobs_min( a, b )        ((a) < (b) ? (a) : (b))
+
+// Counter value while the last job of a group releases its continuations.
+#define MSH__JOBS_RELEASING INT64_MIN
+
+typedef struct msh__job
+{
+  msh_job_fn fn;
+  msh_job_range_fn range_fn;
+  void* data;
+  size_t start, end, grain;
+  msh_job_counter_t* counter;
+} msh__job_t;
+
+struct msh__job_node
+{
+  msh__job_t job;
+  msh__job_node_t* next;
+};
+
+typedef struct msh__job_queue
+{
+  pthread_mutex_t mutex;
+  msh__job_t* jobs;
+  size_t cap;        // power of two
+  size_t top;        // thieves take from here
+  size_t bottom;     // owner pushes and pops here
+  int64_t size;      // read without lock, to skip empty queues
+} msh__job_queue_t;
+
+struct msh_jobs
+{
+  int n_workers;
+  pthread_t* threads;
+  msh__job_queue_t* queues;   // one per worker, and a shared one for all other threads
+  int64_t n_queued;
+  int n_sleeping;
+  int shutdown;
+  pthread_mutex_t sleep_mutex;
+  pthread_cond_t sleep_cv;
+};
+
+// Queue of the current thread. Threads that are not workers of a given job system use its
+// shared queue.
+static __thread msh_jobs_t* msh__jobs_tls_owner = NULL;
+static __thread int msh__jobs_tls_queue_idx = 0;
+static __thread uint32_t msh__jobs_tls_rand = 0;
+
+static int
+msh__jobs_queue_idx( const msh_jobs_t* jobs )
+{
+  return msh__jobs_tls_owner == jobs ? msh__jobs_tls_queue_idx : jobs->n_workers;
+}
+
+static void
+msh__job_queue_init( msh__job_queue_t* queue )
+{
+  pthread_mutex_init( &queue->mutex, NULL );
+  queue->cap = 256;
+  queue->jobs = (msh__job_t*)MSH_JOBS_MALLOC( queue->cap * sizeof(msh__job_t) );
+  queue->top = queue->bottom = 0;
+  queue->size = 0;
+}
+
+static void
+msh__job_queue_term( msh__job_queue_t* queue )
+{
+  pthread_mutex_destroy( &queue->mutex );
+  MSH_JOBS_FREE( queue->jobs );
+}
+
+static void
+msh__job_queue_push( msh__job_queue_t* queue, const msh__job_t* job )
+{
+  pthread_mutex_lock( &queue->mutex );
+  if( queue->bottom - queue->top == queue->cap )
+  {
+    msh__job_t* new_jobs = (msh__job_t*)MSH_JOBS_MALLOC( 2 * queue->cap * sizeof(msh__job_t) );
+    for( size_t i = queue->top; i != queue->bottom; ++i )
+    {
+      new_jobs[i & (2 * queue->cap - 1)] = queue->jobs[i & (queue->cap - 1)];
+    }
+    MSH_JOBS_FREE( queue->jobs );
+    queue->jobs = new_jobs;
+    queue->cap *= 2;
+  }
+  queue->jobs[queue->bottom++ & (queue->cap - 1)] = *job;
+  msh__jobs_store( &queue->size, (int64_t)(queue->bottom - queue->top) );
+  pthread_mutex_unlock( &queue->mutex );
+}
+
+static int
+msh__job_queue_take( msh__job_queue_t* queue, msh__job_t* job, int from_top )
+{
+  if( msh__jobs_load( &queue->size ) == 0 ) { return 0; }
+  int found = 0;
+  pthread_mutex_lock( &queue->mutex );
+  if( queue->bottom != queue->top )
+  {
+    if( from_top ) { *job = queue->jobs[queue->top++ & (queue->cap - 1)]; }
+    else           { *job = queue->jobs[--queue->bottom & (queue->cap - 1)]; }
+    msh__jobs_store( &queue->size, (int64_t)(queue->bottom - queue->top) );
+    found = 1;
+  }
+  pthread_mutex_unlock( &queue->mutex );
+  return found;
+}
+
+static void
+msh__jobs_push( msh_jobs_t* jobs, const msh__job_t* job )
+{
+  msh__job_queue_push( &jobs->queues[msh__jobs_queue_idx( jobs )], job );
+  msh__jobs_add( &jobs->n_queued, 1 );
+  if( msh__jobs_load( &jobs->n_sleeping ) > 0 )
+  {
+    pthread_mutex_lock( &jobs->sleep_mutex );
+    pthread_cond_signal( &jobs->sleep_cv );
+    pthread_mutex_unlock( &jobs->sleep_mutex );
+  }
+}
+
+// Own queue first, then the other queues starting from a random one.
+static int
+msh__jobs_get( msh_jobs_t* jobs, msh__job_t* job )
+{
+  int n_queues = jobs->n_workers + 1;
+  int own_idx = msh__jobs_queue_idx( jobs );
+  int found = msh__job_queue_take( &jobs->queues[own_idx], job, 0 );
+  if( !found )
+  {
+    uint32_t x = msh__jobs_tls_rand ? msh__jobs_tls_rand : (uint32_t)(uintptr_t)&x | 1;
+    x ^= x << 13; x ^= x >> 17; x ^= x << 5;
+    msh__jobs_tls_rand = x;
+    int start = (int)(x % (uint32_t)n_queues);
+    for( int i = 0; i < n_queues && !found; ++i )
+    {
+      int idx = (start + i) % n_queues;
+      if( idx != own_idx ) { found = msh__job_queue_take( &jobs->queues[idx], job, 1 ); }
+    }
+  }
+  if( found ) { msh__jobs_add( &jobs->n_queued, -1 ); }
+  return found;
+}
+
+static void
+msh__jobs_spin_lock( int* lock )
+{
+  while( __atomic_exchange_n( lock, 1, __ATOMIC_ACQUIRE ) ) { while( msh__jobs_load( lock ) ) {} }
+}
+
+static void
+msh__jobs_spin_unlock( int* lock )
+{
+  __atomic_store_n( lock, 0, __ATOMIC_RELEASE );
+}
+
+static void
+msh__jobs_finish( msh_jobs_t* jobs, msh_job_counter_t* counter )
+{
+  if( !counter ) { return; }
+  int64_t count = msh__jobs_load( &counter->count );
+  for( ;; )
+  {
+    int64_t new_count = count > 1 ? count - 1 : MSH__JOBS_RELEASING;
+    if( __atomic_compare_exchange_n( &counter->count, &count, new_count, 0,
+                                     __ATOMIC_SEQ_CST, __ATOMIC_SEQ_CST ) ) { break; }
+  }
+  if( count > 1 ) { return; }
+
+  // Last job of the group - release continuations. Count only drops to zero afterwards, as the
+  // waiting thread may free the counter as soon as it sees zero. Continuations registered in the
+  // meantime see the group as done, and are queued directly.
+  msh__jobs_spin_lock( &counter->lock );
+  msh__job_node_t* node = counter->continuations;
+  counter->continuations = NULL;
+  msh__jobs_spin_unlock( &counter->lock );
+  msh__jobs_store( &counter->count, 0 );
+  while( node )
+  {
+    msh__job_node_t* next = node->next;
+    msh__jobs_push( jobs, &node->job );
+    MSH_JOBS_FREE( node );
+    node = next;
+  }
+}
+
+static void
+msh__jobs_run( msh_jobs_t* jobs, msh__job_t* job )
+{
+  if( job->range_fn )
+  {
+    // Keep the first half, and leave the second one for others to steal.
+    while( job->end - job->start > job->grain )
+    {
+      msh__job_t half = *job;
+      half.start = job->start + (job->end - job->start) / 2;
+      job->end = half.start;
+      if( half.counter ) { msh__jobs_add( &half.counter->count, 1 ); }
+      msh__jobs_push( jobs, &half );
+    }
+    job->range_fn( job->data, job->start, job->end );
+  }
+  else
+  {
+    job->fn( job->data );
+  }
+  msh__jobs_finish( jobs, job->counter );
+}
+
+typedef struct msh__jobs_worker_arg
+{
+  msh_jobs_t* jobs;
+  int idx;
+} msh__jobs_worker_arg_t;
+
+static void*
+msh__jobs_worker( void* arg )
+{
+  msh__jobs_worker_arg_t* worker = (msh__jobs_worker_arg_t*)arg;
+  msh_jobs_t* jobs = worker->jobs;
+  msh__jobs_tls_owner = jobs;
+  msh__jobs_tls_queue_idx = worker->idx;
+  msh__jobs_tls_rand = 0x9e3779b9u * (uint32_t)(worker->idx + 1);
+  MSH_JOBS_FREE( worker );
+
+  int n_idle_spins = 0;
+  while( !msh__jobs_load( &jobs->shutdown ) )
+  {
+    msh__job_t job;
+    if( msh__jobs_get( jobs, &job ) )
+    {
+      msh__jobs_run( jobs, &job );
+      n_idle_spins = 0;
+      continue;
+    }
+    if( ++n_idle_spins < MSH_JOBS_SPIN_COUNT ) { sched_yield(); continue; }
+
+    // Announce sleeping before checking for work, so a concurrent push either sees a sleeper to
+    // signal, or this thread sees the queued job.
+    pthread_mutex_lock( &jobs->sleep_mutex );
+    msh__jobs_add( &jobs->n_sleeping, 1 );
+    while( !msh__jobs_load( &jobs->n_queued ) && !msh__jobs_load( &jobs->shutdown ) )
+    {
+      pthread_cond_wait( &jobs->sleep_cv, &jobs->sleep_mutex );
+    }
+    msh__jobs_add( &jobs->n_sleeping, -1 );
+    pthread_mutex_unlock( &jobs->sleep_mutex );
+    n_idle_spins = 0;
+  }
+  return NULL;
+}
+
+MSH_JOBS_DEF msh_jobs_t*
+msh_jobs_create( int n_workers )
+{
+  if( n_workers < 0 )
+  {
+    long n_cores = sysconf( _SC_NPROCESSORS_ONLN );
+    n_workers = n_cores > 1 ? (int)msh__jobs_min( n_cores - 1, MSH_JOBS_MAX_WORKERS ) : 0;
+  }
+  n_workers = msh__jobs_min( n_workers, MSH_JOBS_MAX_WORKERS );
+  msh_jobs_t* jobs = (msh_jobs_t*)MSH_JOBS_CALLOC( 1, sizeof(msh_jobs_t) );
+  jobs->n_workers = n_workers;
+  jobs->queues = (msh__job_queue_t*)MSH_JOBS_MALLOC( (size_t)(n_workers + 1) * sizeof(msh__job_queue_t) );
+  for( int i = 0; i < n_workers + 1; ++i ) { msh__job_queue_init( &jobs->queues[i] ); }
+  pthread_mutex_init( &jobs->sleep_mutex, NULL );
+  pthread_cond_init( &jobs->sleep_cv, NULL );
+  jobs->threads = (pthread_t*)MSH_JOBS_MALLOC( (size_t)(n_workers ? n_workers : 1) * sizeof(pthread_t) );
+  for( int i = 0; i < n_workers; ++i )
+  {
+    msh__jobs_worker_arg_t* arg = (msh__jobs_worker_arg_t*)MSH_JOBS_MALLOC( sizeof(msh__jobs_worker_arg_t) );
+    arg->jobs = jobs;
+    arg->idx = i;
+    pthread_create( &jobs->threads[i], NULL, msh__jobs_worker, arg );
+  }
+  return jobs;
+}
+
+MSH_JOBS_DEF void
+msh_jobs_destroy( msh_jobs_t* jobs )
+{
+  if( !jobs ) { return; }
+  pthread_mutex_lock( &jobs->sleep_mutex );
+  msh__jobs_store( &jobs->shutdown, 1 );
+  pthread_cond_broadcast( &jobs->sleep_cv );
+  pthread_mutex_unlock( &jobs->sleep_mutex );
+  for( int i = 0; i < jobs->n_workers; ++i ) { pthread_join( jobs->threads[i], NULL ); }
+  for( int i = 0; i < jobs->n_workers + 1; ++i ) { msh__job_queue_term( &jobs->queues[i] ); }
+  pthread_mutex_destroy( &jobs->sleep_mutex );
+  pthread_cond_destroy( &jobs->sleep_cv );
+  MSH_JOBS_FREE( jobs->queues );
+  MSH_JOBS_FREE( jobs->threads );
+  MSH_JOBS_FREE( jobs );
+}
+
+MSH_JOBS_DEF int
+msh_jobs_n_threads( const msh_jobs_t* jobs )
+{
+  return jobs->n_workers + 1;
+}
+
+MSH_JOBS_DEF void
+msh_jobs_submit( msh_jobs_t* jobs, msh_job_fn fn, void* data, msh_job_counter_t* counter )
+{
+  msh__job_t job = { fn, NULL, data, 0, 0, 0, counter };
+  if( counter ) { msh__jobs_add( &counter->count, 1 ); }
+  msh__jobs_push( jobs, &job );
+}
+
+MSH_JOBS_DEF void
+msh_jobs_submit_after( msh_jobs_t* jobs, msh_job_fn fn, void* data,
+                       msh_job_counter_t* counter, msh_job_counter_t* dependency )
+{
+  msh__job_t job = { fn, NULL, data, 0, 0, 0, counter };
+  if( counter ) { msh__jobs_add( &counter->count, 1 ); }
+
+  msh__jobs_spin_lock( &dependency->lock );
+  if( msh__jobs_load( &dependency->count ) > 0 )
+  {
+    msh__job_node_t* node = (msh__job_node_t*)MSH_JOBS_MALLOC( sizeof(msh__job_node_t) );
+    node->job = job;
+    node->next = dependency->continuations;
+    dependency->continuations = node;
+    msh__jobs_spin_unlock( &dependency->lock );
+    return;
+  }
+  msh__jobs_spin_unlock( &dependency->lock );
+  msh__jobs_push( jobs, &job );
+}
+
+MSH_JOBS_DEF void
+msh_jobs_submit_range( msh_jobs_t* jobs, size_t n, size_t grain, msh_job_range_fn fn,
+                       void* data, msh_job_counter_t* counter )
+{
+  if( !n ) { return; }
+  msh__job_t job = { NULL, fn, data, 0, n, grain ? grain : 1, counter };
+  if( counter ) { msh__jobs_add( &counter->count, 1 ); }
+  msh__jobs_push( jobs, &job );
+}
+
+MSH_JOBS_DEF void
+msh_jobs_wait( msh_jobs_t* jobs, msh_job_counter_t* counter )
+{
+  while( msh__jobs_load( &counter->count ) != 0 )
+  {
+    msh__job_t job;
+    if( msh__jobs_get( jobs, &job ) ) { msh__jobs_run( jobs, &job ); }
+    else                              { sched_yield(); }
+  }
+}
+
+MSH_JOBS_DEF void
+msh_jobs_parallel_for( msh_jobs_t* jobs, size_t n, size_t grain, msh_job_range_fn fn, void* data )
+{
+  if( !n ) { return; }
+  if( grain == 0 ) { grain = 1; }
+  // Run it directly if there is nothing to split, or nobody to help.
+  if( n <= grain || jobs->n_workers == 0 ) { fn( data, 0, n ); return; }
+  msh_job_counter_t counter = {0};
+  msh__job_t job = { NULL, fn, data, 0, n, grain, &counter };
+  counter.count = 1;
+  msh__jobs_run( jobs, &job );
+  msh_jobs_wait( jobs, &counter );
+}
+
+#endif /* MSH_JOBS_IMPLEMENTATION */
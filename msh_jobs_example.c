@@ -0,0 +1,363 @@
+/*
+  Author: Maciej Halber
+  Date : Oct 18, 2026
+  License: CC0
+
+  Compilation: gcc -std=c99 -O2 -I<path_to_msh_libraries> msh_jobs_example.c -o msh_jobs_example -lm -lpthread
+  Usage:       msh_jobs_example [max_n_threads | --bench]
+  Description: This program showcases msh_jobs.h, a small work-stealing job system. It measures:
+
+               1) Spawn overhead - time to submit and complete empty jobs, both from the main
+               thread, and recursively from within jobs, where work spreads through stealing.
+
+               2) Dependencies - stages of jobs chained with continuations, checking that no
+               job of a stage starts before all jobs of the previous stage completed.
+
+               3) Parallel-for scaling - a compute bound loop (rendering a Mandelbrot set) and a
+               memory bound loop (summing a large array), for a growing number of threads and
+               different grain sizes. Results are compared against a serial loop.
+
+               Program returns non-zero if any of the checks fails. With --bench, job overhead and
+               parallel loops on all cores are measured with msh_bench.h instead.
+*/
+
+#define MSH_STD_INCLUDE_HEADERS
+#define MSH_STD_IMPLEMENTATION
+#define MSH_JOBS_IMPLEMENTATION
+#define MSH_BENCH_IMPLEMENTATION
+#include "msh_std.h"
+#include "msh_jobs.h"
+#include "msh_bench.h"
+
+enum { A_N_JOBS = 1 << 20, A_TREE_DEPTH = 18 };
+enum { B_N_STAGES = 64, B_N_JOBS_PER_STAGE = 256 };
+enum { C_WIDTH = 1024, C_HEIGHT = 768, C_MAX_ITER = 256, C_N_ELEMS = 1 << 24 };
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+// Spawn overhead
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void empty_job( void* data )
+{
+  (void)data;
+}
+
+typedef struct tree_job
+{
+  msh_jobs_t* jobs;
+  int depth;
+  int64_t* n_leaves;
+} tree_job_t;
+
+// Each node spawns two children and waits on them, so the waiting thread helps with the subtree.
+void tree_job( void* data )
+{
+  tree_job_t* node = (tree_job_t*)data;
+  if( node->depth == 0 )
+  {
+    __atomic_add_fetch( node->n_leaves, 1, __ATOMIC_RELAXED );
+    return;
+  }
+  tree_job_t children[2] = { { node->jobs, node->depth - 1, node->n_leaves },
+                             { node->jobs, node->depth - 1, node->n_leaves } };
+  msh_job_counter_t counter = {0};
+  msh_jobs_submit( node->jobs, tree_job, &children[0], &counter );
+  msh_jobs_submit( node->jobs, tree_job, &children[1], &counter );
+  msh_jobs_wait( node->jobs, &counter );
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+// Dependencies
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+typedef struct stage_ctx
+{
+  int64_t n_completed[B_N_STAGES];
+  int64_t n_violations;
+} stage_ctx_t;
+
+typedef struct stage_job
+{
+  stage_ctx_t* ctx;
+  int stage;
+} stage_job_t;
+
+void stage_job( void* data )
+{
+  stage_job_t* job = (stage_job_t*)data;
+  stage_ctx_t* ctx = job->ctx;
+  if( job->stage > 0 &&
+      __atomic_load_n( &ctx->n_completed[job->stage - 1], __ATOMIC_SEQ_CST ) != B_N_JOBS_PER_STAGE )
+  {
+    __atomic_add_fetch( &ctx->n_violations, 1, __ATOMIC_SEQ_CST );
+  }
+  __atomic_add_fetch( &ctx->n_completed[job->stage], 1, __ATOMIC_SEQ_CST );
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+// Parallel for
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+typedef struct mandelbrot_ctx
+{
+  uint8_t* image;
+} mandelbrot_ctx_t;
+
+void mandelbrot_rows( void* data, size_t start, size_t end )
+{
+  mandelbrot_ctx_t* ctx = (mandelbrot_ctx_t*)data;
+  for( size_t y = start; y < end; ++y )
+  {
+    for( int x = 0; x < C_WIDTH; ++x )
+    {
+      float cr = -2.0f + 2.5f * x / C_WIDTH;
+      float ci = -1.0f + 2.0f * y / C_HEIGHT;
+      float zr = 0.0f, zi = 0.0f;
+      int i = 0;
+      for( ; i < C_MAX_ITER && zr * zr + zi * zi < 4.0f; ++i )
+      {
+        float t = zr * zr - zi * zi + cr;
+        zi = 2.0f * zr * zi + ci;
+        zr = t;
+      }
+      ctx->image[y * C_WIDTH + x] = (uint8_t)(i & 0xFF);
+    }
+  }
+}
+
+typedef struct sum_ctx
+{
+  const float* values;
+  size_t grain;
+  double* partial_sums;   // one per grain sized block, so result does not depend on scheduling
+} sum_ctx_t;
+
+void sum_blocks( void* data, size_t start, size_t end )
+{
+  sum_ctx_t* ctx = (sum_ctx_t*)data;
+  for( size_t b = start; b < end; ++b )
+  {
+    double sum = 0.0;
+    const float* v = ctx->values + b * ctx->grain;
+    for( size_t i = 0; i < ctx->grain; ++i ) { sum += v[i]; }
+    ctx->partial_sums[b] = sum;
+  }
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+// Benchmarks, run with --bench
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+enum { BENCH_N_JOBS = 4096, BENCH_TREE_DEPTH = 12, BENCH_N_BLOCKS = 256 };
+
+typedef struct bench_data
+{
+  msh_jobs_t* jobs;
+  mandelbrot_ctx_t mctx;
+  sum_ctx_t sctx;
+} bench_data_t;
+
+void bench_submit( void* data, size_t n_iters )
+{
+  bench_data_t* d = data;
+  for( size_t it = 0; it < n_iters; ++it )
+  {
+    msh_job_counter_t counter = {0};
+    for( int i = 0; i < BENCH_N_JOBS; ++i ) { msh_jobs_submit( d->jobs, empty_job, NULL, &counter ); }
+    msh_jobs_wait( d->jobs, &counter );
+  }
+}
+
+void bench_tree( void* data, size_t n_iters )
+{
+  bench_data_t* d = data;
+  for( size_t it = 0; it < n_iters; ++it )
+  {
+    int64_t n_leaves = 0;
+    tree_job_t root = { d->jobs, BENCH_TREE_DEPTH, &n_leaves };
+    tree_job( &root );
+    MSH_BENCH_DO_NOT_OPTIMIZE( n_leaves );
+  }
+}
+
+void bench_mandelbrot( void* data, size_t n_iters )
+{
+  bench_data_t* d = data;
+  for( size_t it = 0; it < n_iters; ++it )
+  {
+    msh_jobs_parallel_for( d->jobs, C_HEIGHT, 8, mandelbrot_rows, &d->mctx );
+    MSH_BENCH_CLOBBER();
+  }
+}
+
+void bench_sum( void* data, size_t n_iters )
+{
+  bench_data_t* d = data;
+  for( size_t it = 0; it < n_iters; ++it )
+  {
+    msh_jobs_parallel_for( d->jobs, BENCH_N_BLOCKS, 8, sum_blocks, &d->sctx );
+    MSH_BENCH_CLOBBER();
+  }
+}
+
+int run_benchmarks( int argc, char** argv )
+{
+  // Workers are created before msh_bench_run pins the calling thread, so they are not pinned.
+  bench_data_t d;
+  d.jobs = msh_jobs_create( -1 );
+  d.mctx.image = malloc( C_WIDTH * C_HEIGHT );
+  size_t grain = 1 << 12;
+  float* values = malloc( BENCH_N_BLOCKS * grain * sizeof(float) );
+  for( size_t i = 0; i < BENCH_N_BLOCKS * grain; ++i ) { values[i] = (float)( i & 1023 ) / 1024.0f; }
+  double* partial_sums = malloc( BENCH_N_BLOCKS * sizeof(double) );
+  d.sctx = (sum_ctx_t){ values, grain, partial_sums };
+
+  msh_bench_t* b = msh_bench_create( argc, argv );
+  msh_bench_add( b, "submit empty jobs", bench_submit, &d, BENCH_N_JOBS );
+  msh_bench_add( b, "recursive tree of jobs", bench_tree, &d, ( 1 << ( BENCH_TREE_DEPTH + 1 ) ) - 1 );
+  msh_bench_add( b, "mandelbrot, per pixel", bench_mandelbrot, &d, C_WIDTH * C_HEIGHT );
+  msh_bench_add( b, "sum, per element", bench_sum, &d, BENCH_N_BLOCKS * grain );
+  int n_regressions = msh_bench_run( b );
+  msh_bench_destroy( b );
+  msh_jobs_destroy( d.jobs );
+  free( d.mctx.image );
+  free( values );
+  free( partial_sums );
+  return n_regressions ? 1 : 0;
+}
+
+int main( int argc, char** argv )
+{
+  if( msh_bench_requested( argc, argv ) ) { return run_benchmarks( argc, argv ); }
+  int max_n_threads = argc > 1 ? atoi( argv[1] ) : 8;
+  int n_failed = 0;
+  uint64_t t1, t2;
+
+  //----------------------------------------------------------------------------------------------
+  printf("Spawn overhead:\n");
+  for( int n_threads = 1; n_threads <= max_n_threads; n_threads *= 2 )
+  {
+    msh_jobs_t* jobs = msh_jobs_create( n_threads - 1 );
+
+    msh_job_counter_t counter = {0};
+    t1 = msh_time_now();
+    for( int i = 0; i < A_N_JOBS; ++i ) { msh_jobs_submit( jobs, empty_job, NULL, &counter ); }
+    msh_jobs_wait( jobs, &counter );
+    t2 = msh_time_now();
+    double flat_time = msh_time_diff( MSHT_NANOSECONDS, t2, t1 ) / A_N_JOBS;
+
+    int64_t n_leaves = 0;
+    tree_job_t root = { jobs, A_TREE_DEPTH, &n_leaves };
+    int n_tree_jobs = (1 << (A_TREE_DEPTH + 1)) - 1;
+    t1 = msh_time_now();
+    tree_job( &root );
+    t2 = msh_time_now();
+    double tree_time = msh_time_diff( MSHT_NANOSECONDS, t2, t1 ) / n_tree_jobs;
+    n_failed += n_leaves != (1 << A_TREE_DEPTH);
+
+    printf("  %2d threads: %7.1fns per job submitted from main thread, %7.1fns per job in a "
+           "recursive tree of %d jobs\n", n_threads, flat_time, tree_time, n_tree_jobs );
+    msh_jobs_destroy( jobs );
+  }
+
+  //----------------------------------------------------------------------------------------------
+  printf("Dependencies:\n");
+  {
+    msh_jobs_t* jobs = msh_jobs_create( max_n_threads - 1 );
+    stage_ctx_t ctx = {0};
+    stage_job_t* stage_jobs = malloc( B_N_STAGES * B_N_JOBS_PER_STAGE * sizeof(stage_job_t) );
+    msh_job_counter_t* stage_counters = calloc( B_N_STAGES, sizeof(msh_job_counter_t) );
+
+    // All stages are submitted up front; every stage waits for the previous one to finish.
+    t1 = msh_time_now();
+    for( int s = 0; s < B_N_STAGES; ++s )
+    {
+      for( int j = 0; j < B_N_JOBS_PER_STAGE; ++j )
+      {
+        stage_job_t* job = &stage_jobs[s * B_N_JOBS_PER_STAGE + j];
+        job->ctx = &ctx;
+        job->stage = s;
+        if( s == 0 ) { msh_jobs_submit( jobs, stage_job, job, &stage_counters[s] ); }
+        else         { msh_jobs_submit_after( jobs, stage_job, job, &stage_counters[s], &stage_counters[s - 1] ); }
+      }
+    }
+    msh_jobs_wait( jobs, &stage_counters[B_N_STAGES - 1] );
+    t2 = msh_time_now();
+    for( int s = 0; s < B_N_STAGES; ++s ) { msh_jobs_wait( jobs, &stage_counters[s] ); }
+
+    int ok = ctx.n_violations == 0;
+    for( int s = 0; s < B_N_STAGES; ++s ) { ok &= ctx.n_completed[s] == B_N_JOBS_PER_STAGE; }
+    n_failed += !ok;
+    printf("  %d stages of %d jobs, %d threads: %fms, %s\n", B_N_STAGES, B_N_JOBS_PER_STAGE,
+           max_n_threads, msh_time_diff( MSHT_MILLISECONDS, t2, t1 ), ok ? "ordering ok" : "ORDERING VIOLATED" );
+    free( stage_jobs );
+    free( stage_counters );
+    msh_jobs_destroy( jobs );
+  }
+
+  //----------------------------------------------------------------------------------------------
+  printf("Parallel for:\n");
+  {
+    uint8_t* reference_image = malloc( C_WIDTH * C_HEIGHT );
+    uint8_t* image = malloc( C_WIDTH * C_HEIGHT );
+    mandelbrot_ctx_t mctx = { reference_image };
+    t1 = msh_time_now();
+    mandelbrot_rows( &mctx, 0, C_HEIGHT );
+    t2 = msh_time_now();
+    double mandelbrot_serial_time = msh_time_diff( MSHT_MILLISECONDS, t2, t1 );
+
+    float* values = malloc( C_N_ELEMS * sizeof(float) );
+    msh_rand_ctx_t rand_gen = {0};
+    msh_rand_init( &rand_gen, 12345ULL );
+    for( int i = 0; i < C_N_ELEMS; ++i ) { values[i] = msh_rand_nextf( &rand_gen ); }
+    size_t sum_grain = 1 << 14;
+    size_t n_blocks = C_N_ELEMS / sum_grain;
+    double* partial_sums = malloc( n_blocks * sizeof(double) );
+    sum_ctx_t sctx = { values, sum_grain, partial_sums };
+    t1 = msh_time_now();
+    sum_blocks( &sctx, 0, n_blocks );
+    t2 = msh_time_now();
+    double sum_serial_time = msh_time_diff( MSHT_MILLISECONDS, t2, t1 );
+    double reference_sum = 0.0;
+    for( size_t b = 0; b < n_blocks; ++b ) { reference_sum += partial_sums[b]; }
+
+    printf("  Serial: mandelbrot %fms, sum %fms\n", mandelbrot_serial_time, sum_serial_time );
+    size_t grains[] = { 1, 8, 64 };
+    for( int n_threads = 1; n_threads <= max_n_threads; n_threads *= 2 )
+    {
+      msh_jobs_t* jobs = msh_jobs_create( n_threads - 1 );
+      for( size_t g = 0; g < sizeof(grains) / sizeof(grains[0]); ++g )
+      {
+        memset( image, 0, C_WIDTH * C_HEIGHT );
+        mctx.image = image;
+        t1 = msh_time_now();
+        msh_jobs_parallel_for( jobs, C_HEIGHT, grains[g], mandelbrot_rows, &mctx );
+        t2 = msh_time_now();
+        double mandelbrot_time = msh_time_diff( MSHT_MILLISECONDS, t2, t1 );
+        int ok = !memcmp( image, reference_image, C_WIDTH * C_HEIGHT );
+
+        memset( partial_sums, 0, n_blocks * sizeof(double) );
+        t1 = msh_time_now();
+        msh_jobs_parallel_for( jobs, n_blocks, grains[g], sum_blocks, &sctx );
+        t2 = msh_time_now();
+        double sum_time = msh_time_diff( MSHT_MILLISECONDS, t2, t1 );
+        double sum = 0.0;
+        for( size_t b = 0; b < n_blocks; ++b ) { sum += partial_sums[b]; }
+        ok &= sum == reference_sum;
+        n_failed += !ok;
+
+        printf("  %2d threads, grain %3zu: mandelbrot %9.3fms (%5.2fx), sum %9.3fms (%5.2fx)%s\n",
+               n_threads, grains[g], mandelbrot_time, mandelbrot_serial_time / mandelbrot_time,
+               sum_time, sum_serial_time / sum_time, ok ? "" : " MISMATCH" );
+      }
+      msh_jobs_destroy( jobs );
+    }
+    free( reference_image );
+    free( image );
+    free( values );
+    free( partial_sums );
+  }
+
+  printf("%d failed\n", n_failed );
+  return n_failed ? 1 : 0;
+}
@@ -0,0 +1,626 @@
+/*
+  ==============================================================================
+
+  MSH_MEM.H v0.1
+
+  A single header library for tracking heap allocations, opt-in, per subsystem:
+
+    - allocations are tagged with a name - of the library that made them, or of the scope they
+      were made in - and live bytes, peak bytes and allocation counts are kept per tag
+    - leak report listing allocations that are still live, grouped by tag and call site
+    - malloc/calloc/realloc/free of a translation unit can be redirected to the tracker, which
+      covers libraries that do not have allocation hooks
+    - msh libraries that allocate (msh_alloc, msh_img_ops, msh_jobs, msh_sort, msh_prof,
+      msh_triangulate, msh_draw_batch, msh_raster, msh_sampling) tag their allocations with
+      their own name when this header is included before them
+
+  To use the library you simply add:
+
+  #define MSH_MEM_IMPLEMENTATION
+  #include "msh_mem.h"
+
+  ==============================================================================
+  DOCUMENTATION
+
+  Tracked allocations
+    float* a = msh_mem_alloc( "points", n * sizeof(float) );
+    int* b = msh_mem_calloc( "grid", n_cells, sizeof(int) );
+    a = msh_mem_realloc( "points", a, 2 * n * sizeof(float) );
+    msh_mem_free( a );
+
+    Same semantics as malloc/calloc/realloc/free. Tags have to be string literals, or otherwise
+    outlive the tracker, since only the pointer is stored; tags with the same name are the same
+    tag. A reallocation stays with the tag it was allocated with. Up to MSH_MEM_MAX_TAGS (64)
+    tags are kept, later tags are counted under "other".
+
+    Blocks are not given a header; the tracker keeps an open addressing table from pointer to
+    size, tag and call site, behind a spin lock. msh_mem_free and msh_mem_realloc of pointers
+    the tracker does not know pass them to free/realloc unchanged, so memory allocated by libc
+    or by untracked code can be freed through them. Memory obtained elsewhere, like from mmap,
+    is reported with msh_mem_track( tag, ptr, size ) and msh_mem_untrack( ptr ).
+
+  Tag scopes
+    MSH_MEM_TAG_SCOPE( "msh_hash_grid" )
+    {
+      msh_hash_grid_init_2d( &grid, pts, n_pts, radius );
+    }
+
+    msh_mem_push_tag / msh_mem_pop_tag do the same, for scopes that do not fit a statement.
+    Scopes are per thread and nest up to MSH_MEM_MAX_TAG_DEPTH (32) levels; outside of all
+    scopes the tag is "untagged". The current tag is used by the redirected functions below.
+
+  Redirecting malloc
+    #define MSH_MEM_OVERRIDE
+    #define MSH_MEM_IMPLEMENTATION
+    #include "msh_mem.h"                 // before the headers whose allocations are tracked
+    #include "msh_std.h"
+    #include "msh_ply.h"
+
+    With MSH_MEM_OVERRIDE, malloc, calloc, realloc and free are macros for the tracked
+    functions, tagged with the current tag, in the rest of the translation unit. Libraries
+    without allocation hooks, like msh_std.h (msh_array), msh_ply.h and msh_hash_grid.h, are
+    tracked this way when their implementation is compiled in that unit. Calls through struct
+    members named like these functions have to be wrapped in parentheses, as in
+    ( allocator->realloc )( ... ).
+
+  Library hooks
+    msh libraries allocate through MSH_<LIB>_MALLOC / _CALLOC / _REALLOC / _FREE macros, which
+    default to msh_mem_alloc( "msh_<lib>", ... ) and friends when msh_mem.h is included before
+    them, and to the libc functions otherwise.
+
+  Reporting
+    msh_mem_stats_t stats;
+    msh_mem_get_stats( "msh_hash_grid", &stats );       // returns 0 for an unknown tag
+    printf( "%.1f bytes per point\n", stats.live_bytes / (double)n_pts );
+
+    msh_mem_get_stats( NULL, &stats ) returns totals over all tags. msh_mem_get_all_stats
+    copies stats of every tag, in the order tags were first used. msh_mem_reset_peaks sets
+    peaks to current live bytes, so the peak of a single phase can be measured.
+
+    msh_mem_print( stdout );             // table of all tags
+    msh_mem_report_leaks( stderr );      // live allocations, by tag and call site
+    msh_mem_report_at_exit();            // both, to stderr, when the program exits
+
+    msh_mem_report_leaks returns the number of live allocations. Call sites are the file and
+    line of the tracked call, which for redirected functions is inside the library, e.g.
+    where msh_array grows.
+
+  Cost
+    A tracked call takes the lock and does a table lookup, about 50 ns on top of malloc/free
+    without contention; all threads share the lock. The table takes 32 bytes per live
+    allocation, at most half full. Do not include msh_mem.h in builds where that matters.
+
+  ==============================================================================
+  AUTHORS:
+    Maciej Halber
+
+  LICENSE:
+    CC0
+  ==============================================================================
+*/
+
+#ifndef MSH_MEM_H
+#define MSH_MEM_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#ifndef MSH_MEM_DEF
+#ifdef MSH_MEM_STATIC
+#define MSH_MEM_DEF static
+#else
+#define MSH_MEM_DEF extern
+#endif
+#endif
+
+#ifndef MSH_MEM_MAX_TAGS
+#define MSH_MEM_MAX_TAGS 64
+#endif
+
+#ifndef MSH_MEM_MAX_TAG_DEPTH
+#define MSH_MEM_MAX_TAG_DEPTH 32
+#endif
+
+#ifndef MSH_MEM_MAX_LEAK_SITES
+#define MSH_MEM_MAX_LEAK_SITES 32
+#endif
+
+typedef struct msh_mem_stats
+{
+  const char* tag;
+  size_t live_bytes;
+  size_t peak_bytes;
+  size_t total_bytes;   // allocated over the lifetime, including growth by realloc
+  size_t n_live;
+  size_t n_allocs;
+  size_t n_reallocs;
+  size_t n_frees;
+} msh_mem_stats_t;
+
+#define msh_mem_alloc( tag, size )          msh__mem_alloc( (tag), (size), __FILE__, __LINE__ )
+#define msh_mem_calloc( tag, count, size )  msh__mem_calloc( (tag), (count), (size), __FILE__, __LINE__ )
+#define msh_mem_realloc( tag, ptr, size )   msh__mem_realloc( (tag), (ptr), (size), __FILE__, __LINE__ )
+#define msh_mem_free( ptr )                 msh__mem_free( (ptr) )
+#define msh_mem_track( tag, ptr, size )     msh__mem_track( (tag), (ptr), (size), __FILE__, __LINE__ )
+#define msh_mem_untrack( ptr )              msh__mem_untrack( (ptr) )
+
+#define MSH_MEM_TAG_SCOPE( tag ) \
+  for( int msh__mem_once = ( msh_mem_push_tag( tag ), 1 ); msh__mem_once; msh__mem_once = ( msh_mem_pop_tag(), 0 ) )
+
+MSH_MEM_DEF void* msh__mem_alloc( const char* tag, size_t size, const char* file, int line );
+MSH_MEM_DEF void* msh__mem_calloc( const char* tag, size_t count, size_t size, const char* file, int line );
+MSH_MEM_DEF void* msh__mem_realloc( const char* tag, void* ptr, size_t size, const char* file, int line );
+MSH_MEM_DEF void  msh__mem_free( void* ptr );
+MSH_MEM_DEF void  msh__mem_track( const char* tag, void* ptr, size_t size, const char* file, int line );
+MSH_MEM_DEF void  msh__mem_untrack( void* ptr );
+
+MSH_MEM_DEF void        msh_mem_push_tag( const char* tag );
+MSH_MEM_DEF void        msh_mem_pop_tag( void );
+MSH_MEM_DEF const char* msh_mem_current_tag( void );
+
+MSH_MEM_DEF int    msh_mem_get_stats( const char* tag, msh_mem_stats_t* stats );
+MSH_MEM_DEF size_t msh_mem_get_all_stats( msh_mem_stats_t* stats, size_t max_stats );
+MSH_MEM_DEF void   msh_mem_reset_peaks( void );
+MSH_MEM_DEF void   msh_mem_print( FILE* fp );
+MSH_MEM_DEF size_t msh_mem_report_leaks( FILE* fp );
+MSH_MEM_DEF void   msh_mem_report_at_exit( void );
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* MSH_MEM_H */
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+// IMPLEMENTATION
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+#ifdef MSH_MEM_IMPLEMENTATION
+
+// libc functions are called as (malloc)( ... ), so that they are not redirected by
+// MSH_MEM_OVERRIDE when this section is compiled after it.
+
+typedef struct msh__mem_entry
+{
+  void* ptr;              // NULL for empty slots, MSH__MEM_TOMBSTONE for removed entries
+  size_t size;
+  const char* file;
+  uint32_t line;
+  uint32_t tag;
+} msh__mem_entry_t;
+
+#define MSH__MEM_TOMBSTONE ((void*)1)
+
+static struct
+{
+  int lock;
+  msh__mem_entry_t* entries;
+  size_t cap;             // power of two
+  size_t n_used;          // live entries and tombstones
+  size_t n_live;
+  size_t n_tags;
+  msh_mem_stats_t tags[MSH_MEM_MAX_TAGS];
+  msh_mem_stats_t total;
+} msh__mem;
+
+static __thread const char* msh__mem_tag_stack[MSH_MEM_MAX_TAG_DEPTH];
+static __thread int msh__mem_tag_depth = 0;
+
+static void
+msh__mem_lock( void )
+{
+  while( __atomic_exchange_n( &msh__mem.lock, 1, __ATOMIC_ACQUIRE ) )
+  {
+    while( __atomic_load_n( &msh__mem.lock, __ATOMIC_RELAXED ) ) {}
+  }
+}
+
+static void
+msh__mem_unlock( void )
+{
+  __atomic_store_n( &msh__mem.lock, 0, __ATOMIC_RELEASE );
+}
+
+static inline size_t
+msh__mem_hash( const void* ptr, size_t cap )
+{
+  uint64_t h = ( (uint64_t)(uintptr_t)ptr >> 4 ) * 0x9E3779B97F4A7C15ULL;
+  return (size_t)( h >> 32 ) & ( cap - 1 );
+}
+
+// Index of the tag, added on first use. Called with the lock held.
+static uint32_t
+msh__mem_tag_index( const char* tag )
+{
+  if( !tag ) { tag = "untagged"; }
+  for( size_t i = 0; i < msh__mem.n_tags; ++i )
+  {
+    if( msh__mem.tags[i].tag == tag || !strcmp( msh__mem.tags[i].tag, tag ) ) { return (uint32_t)i; }
+  }
+  if( msh__mem.n_tags == MSH_MEM_MAX_TAGS - 1 )
+  {
+    msh__mem.tags[MSH_MEM_MAX_TAGS - 1].tag = "other";
+    return MSH_MEM_MAX_TAGS - 1;
+  }
+  msh__mem.tags[msh__mem.n_tags].tag = tag;
+  return (uint32_t)msh__mem.n_tags++;
+}
+
+// Rehashes into a table of new_cap slots, dropping tombstones. Called with the lock held.
+static int
+msh__mem_rehash( size_t new_cap )
+{
+  msh__mem_entry_t* entries = (msh__mem_entry_t*)(calloc)( new_cap, sizeof(msh__mem_entry_t) );
+  if( !entries ) { return 0; }
+  for( size_t i = 0; i < msh__mem.cap; ++i )
+  {
+    msh__mem_entry_t* e = &msh__mem.entries[i];
+    if( !e->ptr || e->ptr == MSH__MEM_TOMBSTONE ) { continue; }
+    size_t j = msh__mem_hash( e->ptr, new_cap );
+    while( entries[j].ptr ) { j = ( j + 1 ) & ( new_cap - 1 ); }
+    entries[j] = *e;
+  }
+  (free)( msh__mem.entries );
+  msh__mem.entries = entries;
+  msh__mem.cap = new_cap;
+  msh__mem.n_used = msh__mem.n_live;
+  return 1;
+}
+
+static void
+msh__mem_stats_add( msh_mem_stats_t* s, size_t size )
+{
+  s->live_bytes += size;
+  s->total_bytes += size;
+  s->n_live++;
+  s->n_allocs++;
+  if( s->live_bytes > s->peak_bytes ) { s->peak_bytes = s->live_bytes; }
+}
+
+static void
+msh__mem_stats_remove( msh_mem_stats_t* s, size_t size )
+{
+  s->live_bytes -= size;
+  s->n_live--;
+  s->n_frees++;
+}
+
+static void
+msh__mem_stats_resize( msh_mem_stats_t* s, size_t old_size, size_t new_size )
+{
+  s->live_bytes = s->live_bytes - old_size + new_size;
+  if( new_size > old_size ) { s->total_bytes += new_size - old_size; }
+  s->n_reallocs++;
+  if( s->live_bytes > s->peak_bytes ) { s->peak_bytes = s->live_bytes; }
+}
+
+// Adds an entry, without updating stats. Called with the lock held; returns 0 if the table
+// could not grow, in which case the allocation stays untracked.
+static int
+msh__mem_insert( const msh__mem_entry_t* entry )
+{
+  if( ( msh__mem.n_used + 1 ) * 2 > msh__mem.cap )
+  {
+    // Mostly tombstones - clean up in place, otherwise double.
+    size_t new_cap = msh__mem.cap ? msh__mem.cap : 1024;
+    if( ( msh__mem.n_live + 1 ) * 4 > msh__mem.cap ) { new_cap *= 2; }
+    if( !msh__mem_rehash( new_cap ) ) { return 0; }
+  }
+  size_t mask = msh__mem.cap - 1;
+  size_t i = msh__mem_hash( entry->ptr, msh__mem.cap );
+  while( msh__mem.entries[i].ptr && msh__mem.entries[i].ptr != MSH__MEM_TOMBSTONE ) { i = ( i + 1 ) & mask; }
+  if( !msh__mem.entries[i].ptr ) { msh__mem.n_used++; }
+  msh__mem.entries[i] = *entry;
+  msh__mem.n_live++;
+  return 1;
+}
+
+// Removes the entry of ptr into *entry. Called with the lock held; returns 0 if ptr is unknown.
+static int
+msh__mem_remove( void* ptr, msh__mem_entry_t* entry )
+{
+  if( !msh__mem.cap ) { return 0; }
+  size_t mask = msh__mem.cap - 1;
+  for( size_t i = msh__mem_hash( ptr, msh__mem.cap ); msh__mem.entries[i].ptr; i = ( i + 1 ) & mask )
+  {
+    if( msh__mem.entries[i].ptr == ptr )
+    {
+      *entry = msh__mem.entries[i];
+      msh__mem.entries[i].ptr = MSH__MEM_TOMBSTONE;
+      msh__mem.n_live--;
+      return 1;
+    }
+  }
+  return 0;
+}
+
+MSH_MEM_DEF void
+msh__mem_track( const char* tag, void* ptr, size_t size, const char* file, int line )
+{
+  if( !ptr ) { return; }
+  msh__mem_lock();
+  msh__mem_entry_t entry = { ptr, size, file, (uint32_t)line, msh__mem_tag_index( tag ) };
+  if( msh__mem_insert( &entry ) )
+  {
+    msh__mem_stats_add( &msh__mem.tags[entry.tag], size );
+    msh__mem_stats_add( &msh__mem.total, size );
+  }
+  msh__mem_unlock();
+}
+
+MSH_MEM_DEF void
+msh__mem_untrack( void* ptr )
+{
+  if( !ptr ) { return; }
+  msh__mem_entry_t entry;
+  msh__mem_lock();
+  if( msh__mem_remove( ptr, &entry ) )
+  {
+    msh__mem_stats_remove( &msh__mem.tags[entry.tag], entry.size );
+    msh__mem_stats_remove( &msh__mem.total, entry.size );
+  }
+  msh__mem_unlock();
+}
+
+MSH_MEM_DEF void*
+msh__mem_alloc( const char* tag, size_t size, const char* file, int line )
+{
+  void* ptr = (malloc)( size );
+  msh__mem_track( tag, ptr, size, file, line );
+  return ptr;
+}
+
+MSH_MEM_DEF void*
+msh__mem_calloc( const char* tag, size_t count, size_t size, const char* file, int line )
+{
+  void* ptr = (calloc)( count, size );
+  msh__mem_track( tag, ptr, count * size, file, line );
+  return ptr;
+}
+
+MSH_MEM_DEF void*
+msh__mem_realloc( const char* tag, void* ptr, size_t size, const char* file, int line )
+{
+  if( !ptr ) { return msh__mem_alloc( tag, size, file, line ); }
+  if( !size ) { msh__mem_free( ptr ); return NULL; }
+
+  // The entry is taken out while realloc runs without the lock, and put back, under the new
+  // pointer if it moved. Stats change only once realloc is done.
+  msh__mem_entry_t entry;
+  msh__mem_lock();
+  int tracked = msh__mem_remove( ptr, &entry );
+  msh__mem_unlock();
+  if( !tracked ) { return (realloc)( ptr, size ); }
+
+  void* new_ptr = (realloc)( ptr, size );
+  size_t old_size = entry.size;
+  msh__mem_lock();
+  if( new_ptr ) { entry.ptr = new_ptr; entry.size = size; }
+  if( msh__mem_insert( &entry ) )
+  {
+    if( new_ptr )
+    {
+      msh__mem_stats_resize( &msh__mem.tags[entry.tag], old_size, size );
+      msh__mem_stats_resize( &msh__mem.total, old_size, size );
+    }
+  }
+  else
+  {
+    msh__mem_stats_remove( &msh__mem.tags[entry.tag], old_size );
+    msh__mem_stats_remove( &msh__mem.total, old_size );
+  }
+  msh__mem_unlock();
+  return new_ptr;
+}
+
+MSH_MEM_DEF void
+msh__mem_free( void* ptr )
+{
+  msh__mem_untrack( ptr );
+  (free)( ptr );
+}
+
+MSH_MEM_DEF void
+msh_mem_push_tag( const char* tag )
+{
+  if( msh__mem_tag_depth < MSH_MEM_MAX_TAG_DEPTH ) { msh__mem_tag_stack[msh__mem_tag_depth] = tag; }
+  msh__mem_tag_depth++;
+}
+
+MSH_MEM_DEF void
+msh_mem_pop_tag( void )
+{
+  if( msh__mem_tag_depth > 0 ) { msh__mem_tag_depth--; }
+}
+
+MSH_MEM_DEF const char*
+msh_mem_current_tag( void )
+{
+  int depth = msh__mem_tag_depth;
+  if( !depth ) { return "untagged"; }
+  return msh__mem_tag_stack[( depth < MSH_MEM_MAX_TAG_DEPTH ? depth : MSH_MEM_MAX_TAG_DEPTH ) - 1];
+}
+
+//--------------------------------------------------------------------------------------------------
+
+MSH_MEM_DEF int
+msh_mem_get_stats( const char* tag, msh_mem_stats_t* stats )
+{
+  int found = 0;
+  memset( stats, 0, sizeof(*stats) );
+  stats->tag = tag;
+  msh__mem_lock();
+  if( !tag )
+  {
+    *stats = msh__mem.total;
+    stats->tag = "total";
+    found = 1;
+  }
+  for( size_t i = 0; tag && i < msh__mem.n_tags && !found; ++i )
+  {
+    if( !strcmp( msh__mem.tags[i].tag, tag ) ) { *stats = msh__mem.tags[i]; found = 1; }
+  }
+  msh__mem_unlock();
+  return found;
+}
+
+MSH_MEM_DEF size_t
+msh_mem_get_all_stats( msh_mem_stats_t* stats, size_t max_stats )
+{
+  msh__mem_lock();
+  size_t n = 0;
+  for( size_t i = 0; i < MSH_MEM_MAX_TAGS && n < max_stats; ++i )
+  {
+    if( msh__mem.tags[i].tag ) { stats[n++] = msh__mem.tags[i]; }
+  }
+  msh__mem_unlock();
+  return n;
+}
+
+MSH_MEM_DEF void
+msh_mem_reset_peaks( void )
+{
+  msh__mem_lock();
+  for( size_t i = 0; i < MSH_MEM_MAX_TAGS; ++i ) { msh__mem.tags[i].peak_bytes = msh__mem.tags[i].live_bytes; }
+  msh__mem.total.peak_bytes = msh__mem.total.live_bytes;
+  msh__mem_unlock();
+}
+
+static void
+msh__mem_print_row( FILE* fp, const msh_mem_stats_t* s )
+{
+  fprintf( fp, "%-24s %14zu %14zu %16zu %10zu %10zu %10zu %10zu\n", s->tag, s->live_bytes,
+           s->peak_bytes, s->total_bytes, s->n_live, s->n_allocs, s->n_reallocs, s->n_frees );
+}
+
+MSH_MEM_DEF void
+msh_mem_print( FILE* fp )
+{
+  msh_mem_stats_t stats[MSH_MEM_MAX_TAGS], total;
+  size_t n_tags = msh_mem_get_all_stats( stats, MSH_MEM_MAX_TAGS );
+  msh_mem_get_stats( NULL, &total );
+  fprintf( fp, "%-24s %14s %14s %16s %10s %10s %10s %10s\n", "tag", "live bytes", "peak bytes",
+           "total bytes", "live", "allocs", "reallocs", "frees" );
+  for( size_t i = 0; i < n_tags; ++i ) { msh__mem_print_row( fp, &stats[i] ); }
+  msh__mem_print_row( fp, &total );
+}
+
+static int
+msh__mem_compare_sites( const void* a, const void* b )
+{
+  const msh__mem_entry_t* ea = (const msh__mem_entry_t*)a;
+  const msh__mem_entry_t* eb = (const msh__mem_entry_t*)b;
+  if( ea->tag != eb->tag ) { return ea->tag < eb->tag ? -1 : 1; }
+  int c = strcmp( ea->file ? ea->file : "?", eb->file ? eb->file : "?" );
+  if( c ) { return c; }
+  return ea->line < eb->line ? -1 : ( ea->line > eb->line );
+}
+
+typedef struct msh__mem_site
+{
+  const msh__mem_entry_t* first;
+  size_t count;
+  size_t bytes;
+} msh__mem_site_t;
+
+static int
+msh__mem_compare_bytes( const void* a, const void* b )
+{
+  size_t sa = ((const msh__mem_site_t*)a)->bytes;
+  size_t sb = ((const msh__mem_site_t*)b)->bytes;
+  return sa > sb ? -1 : ( sa < sb );
+}
+
+MSH_MEM_DEF size_t
+msh_mem_report_leaks( FILE* fp )
+{
+  // Copy live entries out, so that the report is made without the lock.
+  msh__mem_lock();
+  size_t n_live = msh__mem.n_live;
+  msh__mem_entry_t* live = (msh__mem_entry_t*)(malloc)( ( n_live ? n_live : 1 ) * sizeof(msh__mem_entry_t) );
+  msh__mem_site_t* sites = (msh__mem_site_t*)(malloc)( ( n_live ? n_live : 1 ) * sizeof(msh__mem_site_t) );
+  const char* tag_names[MSH_MEM_MAX_TAGS];
+  for( size_t i = 0; i < MSH_MEM_MAX_TAGS; ++i ) { tag_names[i] = msh__mem.tags[i].tag; }
+  size_t n = 0;
+  for( size_t i = 0; live && sites && i < msh__mem.cap; ++i )
+  {
+    const msh__mem_entry_t* e = &msh__mem.entries[i];
+    if( e->ptr && e->ptr != MSH__MEM_TOMBSTONE ) { live[n++] = *e; }
+  }
+  msh__mem_unlock();
+
+  if( !live || !sites ) { n = n_live; fprintf( fp, "%zu allocations still live\n", n ); }
+  else if( !n ) { fprintf( fp, "No allocations still live\n" ); }
+  else
+  {
+    // Group by tag and call site, largest first.
+    qsort( live, n, sizeof(msh__mem_entry_t), msh__mem_compare_sites );
+    size_t n_sites = 0, n_bytes = 0;
+    for( size_t i = 0; i < n; ++i )
+    {
+      n_bytes += live[i].size;
+      if( !n_sites || msh__mem_compare_sites( sites[n_sites - 1].first, &live[i] ) )
+      {
+        sites[n_sites].first = &live[i];
+        sites[n_sites].count = 0;
+        sites[n_sites].bytes = 0;
+        n_sites++;
+      }
+      sites[n_sites - 1].count++;
+      sites[n_sites - 1].bytes += live[i].size;
+    }
+    qsort( sites, n_sites, sizeof(msh__mem_site_t), msh__mem_compare_bytes );
+
+    fprintf( fp, "%zu allocations, %zu bytes still live:\n", n, n_bytes );
+    fprintf( fp, "  %-24s %10s %14s  %s\n", "tag", "count", "bytes", "site" );
+    for( size_t i = 0; i < n_sites && i < MSH_MEM_MAX_LEAK_SITES; ++i )
+    {
+      const msh__mem_entry_t* e = sites[i].first;
+      fprintf( fp, "  %-24s %10zu %14zu  %s:%u\n", tag_names[e->tag], sites[i].count, sites[i].bytes,
+               e->file ? e->file : "?", e->line );
+    }
+    if( n_sites > MSH_MEM_MAX_LEAK_SITES )
+    {
+      fprintf( fp, "  ... and %zu more sites\n", n_sites - MSH_MEM_MAX_LEAK_SITES );
+    }
+  }
+  (free)( live );
+  (free)( sites );
+  return n;
+}
+
+static void
+msh__mem_at_exit( void )
+{
+  fprintf( stderr, "Memory at exit:\n" );
+  msh_mem_print( stderr );
+  msh_mem_report_leaks( stderr );
+}
+
+MSH_MEM_DEF void
+msh_mem_report_at_exit( void )
+{
+  static int registered = 0;
+  if( !__atomic_exchange_n( &registered, 1, __ATOMIC_ACQ_REL ) ) { atexit( msh__mem_at_exit ); }
+}
+
+#endif /* MSH_MEM_IMPLEMENTATION */
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+// MSH_MEM_OVERRIDE
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+#if defined(MSH_MEM_OVERRIDE) && !defined(MSH__MEM_OVERRIDE_DEFINED)
+#define MSH__MEM_OVERRIDE_DEFINED
+#define malloc( size )         msh__mem_alloc( msh_mem_current_tag(), (size), __FILE__, __LINE__ )
+#define calloc( count, size )  msh__mem_calloc( msh_mem_current_tag(), (count), (size), __FILE__, __LINE__ )
+#define realloc( ptr, size )   msh__mem_realloc( msh_mem_current_tag(), (ptr), (size), __FILE__, __LINE__ )
+#define free( ptr )            msh__mem_free( (ptr) )
+#endif
@@ -0,0 +1,250 @@
+/*
+  Author: Maciej Halber
+  Date : Oct 18, 2026
+  License: CC0
+
+  Compilation: gcc -std=c99 -O2 -I<path_to_msh_libraries> msh_mem_example.c -o msh_mem_example -lm -lpthread
+  Usage:       msh_mem_example [--bench]
+  Description: This program showcases msh_mem.h, allocation tracking per tag. It:
+
+               1) Checks live, peak and total bytes and allocation counts of explicitly tagged
+               allocations, including reallocations and pointers the tracker does not know.
+
+               2) Tracks msh_array growth through redirected realloc, inside a tag scope, and
+               reports bytes per point of an array of 2D points grown one point at a time.
+
+               3) Checks that msh_sort.h and msh_alloc.h tag their own allocations when
+               msh_mem.h is included first, and that counts stay consistent when several
+               threads allocate at once.
+
+               4) Leaks a few allocations on purpose and prints the leak report, which lists
+               them by tag and call site.
+
+               Program returns non-zero if validation fails. With --bench, the cost of a tracked
+               malloc/free pair is measured against an untracked one.
+*/
+
+#define MSH_MEM_OVERRIDE
+#define MSH_MEM_IMPLEMENTATION
+#define MSH_STD_INCLUDE_HEADERS
+#define MSH_STD_IMPLEMENTATION
+#define MSH_ALLOC_IMPLEMENTATION
+#define MSH_SORT_IMPLEMENTATION
+#define MSH_BENCH_IMPLEMENTATION
+#include "msh_mem.h"
+#include "msh_std.h"
+#include "msh_alloc.h"
+#include "msh_sort.h"
+#include "msh_bench.h"
+
+#include <pthread.h>
+
+enum { N_POINTS = 100000, N_SORT_KEYS = 1 << 16, N_THREADS = 4, N_THREAD_ALLOCS = 100000 };
+
+typedef struct point { float x, y; } point_t;
+
+int check( const char* name, int ok )
+{
+  if( !ok ) { printf("  %s: FAILED\n", name ); }
+  return !ok;
+}
+
+int validate_tagged( void )
+{
+  int n_failed = 0;
+  msh_mem_stats_t s;
+
+  char* a = msh_mem_alloc( "example", 1000 );
+  char* b = msh_mem_calloc( "example", 10, 100 );
+  n_failed += check( "calloc zeroes", b[0] == 0 && b[999] == 0 );
+  a = msh_mem_realloc( "other tag", a, 3000 );      // stays with "example"
+  msh_mem_get_stats( "example", &s );
+  n_failed += check( "live bytes", s.live_bytes == 4000 && s.n_live == 2 );
+  n_failed += check( "counts", s.n_allocs == 2 && s.n_reallocs == 1 && s.n_frees == 0 );
+  n_failed += check( "total bytes", s.total_bytes == 4000 );
+
+  a = msh_mem_realloc( "example", a, 500 );
+  msh_mem_free( b );
+  msh_mem_get_stats( "example", &s );
+  n_failed += check( "shrink and free", s.live_bytes == 500 && s.peak_bytes == 4000 && s.n_frees == 1 );
+  n_failed += check( "unused tag", !msh_mem_get_stats( "other tag", &s ) && s.live_bytes == 0 );
+
+  // Pointers the tracker does not know are passed to libc untouched.
+  msh_mem_stats_t before, after;
+  msh_mem_get_stats( NULL, &before );
+  void* untracked = (malloc)( 64 );
+  untracked = msh_mem_realloc( "example", untracked, 128 );
+  msh_mem_free( untracked );
+  msh_mem_get_stats( NULL, &after );
+  n_failed += check( "untracked pointers", before.live_bytes == after.live_bytes &&
+                                           before.n_allocs == after.n_allocs );
+
+  msh_mem_reset_peaks();
+  msh_mem_get_stats( "example", &s );
+  n_failed += check( "reset peaks", s.peak_bytes == 500 );
+  msh_mem_free( a );
+  msh_mem_get_stats( "example", &s );
+  n_failed += check( "all freed", s.live_bytes == 0 && s.n_live == 0 && s.n_allocs == s.n_frees );
+  return n_failed;
+}
+
+int validate_scopes( void )
+{
+  int n_failed = 0;
+  msh_mem_stats_t s;
+
+  // msh_array grows through realloc, redirected with MSH_MEM_OVERRIDE.
+  msh_array(point_t) pts = NULL;
+  MSH_MEM_TAG_SCOPE( "points" )
+  {
+    n_failed += check( "current tag", !strcmp( msh_mem_current_tag(), "points" ) );
+    MSH_MEM_TAG_SCOPE( "nested" ) { n_failed += check( "nested tag", !strcmp( msh_mem_current_tag(), "nested" ) ); }
+    for( int i = 0; i < N_POINTS; ++i ) { msh_array_push( pts, (point_t){ (float)i, (float)-i } ); }
+  }
+  n_failed += check( "tag after scope", !strcmp( msh_mem_current_tag(), "untagged" ) );
+  msh_mem_get_stats( "points", &s );
+  n_failed += check( "array tracked", s.n_live == 1 && s.n_reallocs > 0 &&
+                                      s.live_bytes >= N_POINTS * sizeof(point_t) );
+  printf("  msh_array of %d points: %.2f bytes per point live, %.2f at peak, %zu reallocations\n",
+         N_POINTS, s.live_bytes / (double)N_POINTS, s.peak_bytes / (double)N_POINTS, s.n_reallocs );
+
+  // Freed outside of the scope, still counted against "points".
+  msh_array_free( pts );
+  msh_mem_get_stats( "points", &s );
+  n_failed += check( "array freed", s.live_bytes == 0 && s.n_live == 0 );
+  return n_failed;
+}
+
+void* thread_allocs( void* arg )
+{
+  const char* tag = arg;
+  void* live[16] = {0};
+  for( int i = 0; i < N_THREAD_ALLOCS; ++i )
+  {
+    int slot = i & 15;
+    msh_mem_free( live[slot] );
+    live[slot] = msh_mem_alloc( tag, 16 + ( i & 255 ) );
+  }
+  for( int i = 0; i < 16; ++i ) { msh_mem_free( live[i] ); }
+  return NULL;
+}
+
+int validate_libraries( void )
+{
+  int n_failed = 0;
+  msh_mem_stats_t s;
+
+  // Radix sort allocates temporary buffers of keys and values.
+  uint32_t* keys = malloc( N_SORT_KEYS * sizeof(uint32_t) );
+  uint32_t* vals = malloc( N_SORT_KEYS * sizeof(uint32_t) );
+  for( uint32_t i = 0; i < N_SORT_KEYS; ++i ) { keys[i] = ( i * 2654435761u ) >> 8; vals[i] = i; }
+  msh_radix_sort_u32( keys, vals, N_SORT_KEYS );
+  msh_mem_get_stats( "msh_sort", &s );
+  n_failed += check( "msh_sort tagged", s.n_allocs >= 2 && s.live_bytes == 0 &&
+                                        s.peak_bytes >= 2 * N_SORT_KEYS * sizeof(uint32_t) );
+  free( keys );
+  free( vals );
+
+  // Arena blocks are tracked, allocations inside them are not.
+  msh_arena_t arena = {0};
+  msh_arena_init( &arena, 1 << 20 );
+  for( int i = 0; i < 1000; ++i ) { msh_arena_alloc( &arena, 1000 ); }
+  msh_mem_get_stats( "msh_alloc", &s );
+  n_failed += check( "msh_alloc tagged", s.n_live == 1 && s.live_bytes > ( 1 << 20 ) );
+  msh_arena_term( &arena );
+  msh_mem_get_stats( "msh_alloc", &s );
+  n_failed += check( "msh_alloc freed", s.live_bytes == 0 );
+
+  // Threads allocating under their own tags.
+  static const char* tags[N_THREADS] = { "thread 0", "thread 1", "thread 2", "thread 3" };
+  pthread_t threads[N_THREADS];
+  for( int i = 0; i < N_THREADS; ++i ) { pthread_create( &threads[i], NULL, thread_allocs, (void*)tags[i] ); }
+  for( int i = 0; i < N_THREADS; ++i ) { pthread_join( threads[i], NULL ); }
+  for( int i = 0; i < N_THREADS; ++i )
+  {
+    msh_mem_get_stats( tags[i], &s );
+    n_failed += check( tags[i], s.n_allocs == N_THREAD_ALLOCS && s.n_frees == N_THREAD_ALLOCS && s.live_bytes == 0 );
+  }
+  return n_failed;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+// Benchmarks, run with --bench
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void bench_untracked( void* data, size_t n_iters )
+{
+  (void)data;
+  for( size_t it = 0; it < n_iters; ++it ) { void* p = (malloc)( 64 ); MSH_BENCH_DO_NOT_OPTIMIZE( p ); (free)( p ); }
+}
+
+void bench_tracked( void* data, size_t n_iters )
+{
+  (void)data;
+  for( size_t it = 0; it < n_iters; ++it ) { void* p = msh_mem_alloc( "bench", 64 ); MSH_BENCH_DO_NOT_OPTIMIZE( p ); msh_mem_free( p ); }
+}
+
+int run_benchmarks( int argc, char** argv )
+{
+  // Keep the table populated, so that lookups probe a realistic table.
+  enum { N_LIVE = 100000 };
+  void** live = (malloc)( N_LIVE * sizeof(void*) );
+  for( int i = 0; i < N_LIVE; ++i ) { live[i] = msh_mem_alloc( "live", 32 ); }
+
+  msh_bench_t* b = msh_bench_create( argc, argv );
+  msh_bench_add( b, "malloc/free 64B", bench_untracked, NULL, 1 );
+  msh_bench_add( b, "tracked malloc/free 64B", bench_tracked, NULL, 1 );
+  int n_regressions = msh_bench_run( b );
+  msh_bench_destroy( b );
+
+  for( int i = 0; i < N_LIVE; ++i ) { msh_mem_free( live[i] ); }
+  (free)( live );
+  return n_regressions ? 1 : 0;
+}
+
+int main( int argc, char** argv )
+{
+  if( msh_bench_requested( argc, argv ) ) { return run_benchmarks( argc, argv ); }
+  int n_failed = 0;
+
+  //----------------------------------------------------------------------------------------------
+  printf("Tagged allocations:\n");
+  {
+    n_failed += validate_tagged();
+  }
+
+  //----------------------------------------------------------------------------------------------
+  printf("Tag scopes and redirected malloc:\n");
+  {
+    n_failed += validate_scopes();
+  }
+
+  //----------------------------------------------------------------------------------------------
+  printf("Library tags and threads:\n");
+  {
+    n_failed += validate_libraries();
+  }
+
+  //----------------------------------------------------------------------------------------------
+  printf("Leak report:\n");
+  {
+    size_t n_before = msh_mem_report_leaks( stdout );
+    void* leaks[3];
+    leaks[0] = msh_mem_alloc( "leaky", 100 );
+    leaks[1] = msh_mem_alloc( "leaky", 200 );
+    MSH_MEM_TAG_SCOPE( "leaky scope" ) { leaks[2] = malloc( 300 ); }
+    size_t n_leaks = msh_mem_report_leaks( stdout );
+    n_failed += check( "leaks found", n_leaks == n_before + 3 );
+    for( int i = 0; i < 3; ++i ) { free( leaks[i] ); }
+    n_failed += check( "leaks freed", msh_mem_report_leaks( stdout ) == n_before );
+  }
+
+  //----------------------------------------------------------------------------------------------
+  printf("All tags:\n");
+  {
+    msh_mem_print( stdout );
+  }
+
+  printf("%d failed\n", n_failed );
+  return n_failed ? 1 : 0;
+}
@@ -3,8 +3,8 @@
   Date : Sep 1, 2018
   License: CC0
  
-  Compilation: gcc -std=c99 -I<path_to_msh_libraries> msh_pdf_sampling_example.c -o msh_pdf_sampling_example
-  Usage:       msh_pdf_sampling_example <path_to_ply_file
+  Compilation: gcc -std=c99 -D_GNU_SOURCE -I<path_to_msh_libraries> msh_pdf_sampling_example.c -o msh_pdf_sampling_example -lm -lpthread
+  Usage:       msh_pdf_sampling_example [--bench [--csv <file>] [--json <file>] [--bench-<option>=<value>]]
   Description: This program showcases different ways in which it is possible to sample discrete 
                distributions using msh libraries. The problem we try to tackle is essentially
                simulating a loaded dice - given set of weights describing likelihood of rolling
@@ -32,15 +32,56 @@
 
                This program will perform simulation of loaded dice and sampling from a mixture of 
                gaussian distribution, using all three methods. Timings will also be performed.
+
+               Additionally, the program showcases sampling of continuous distributions, which
+               along with the remaining samplers below are implemented in msh_sampling.h:
+
+               4) Piecewise-linear 1D - density is given by values at equally spaced vertices and
+               interpolated linearly in between. A segment is picked with an alias table built
+               over segment areas, and the remainder of the same random number is used to
+               invert the linear density within the segment analytically. Samples are continuous,
+               so there is no stair-stepping at bin boundaries.
+
+               5) Piecewise-constant 2D - e.g. an image or an environment map. Built as a marginal
+               alias table over rows and a conditional alias table per row. Sampling a point costs
+               two table lookups and returns the point together with its pdf.
+
+               Both continuous distributions are built once and then sampled many times, and they
+               have batched versions of the sampling functions.
+
+               Last sections show weighted sampling without replacement (exponential keys with
+               partial selection, and a streaming reservoir), and alias tables packed into a
+               single 64-bit or 32-bit word per entry, which halve memory traffic of the double
+               precision table for large distributions. Packed tables can also be built in
+               parallel on msh_jobs.h, which is validated against msh_distrib2pdf before timings
+               are reported.
+
+               With --bench, the program instead runs a headless harness that validates every
+               sampler with chi-square and Kolmogorov-Smirnov tests (msh_sampling.h) on a range of
+               distribution shapes and sizes, times them with msh_bench.h, and can export results
+               to csv/json. Where hardware counters are available (msh_perf.h, Linux), cache
+               misses and cycles per sample are reported as well.
 */
 
 
 #define MSH_STD_INCLUDE_HEADERS
 #define MSH_STD_IMPLEMENTATION
+#define MSH_JOBS_IMPLEMENTATION
+#define MSH_PERF_IMPLEMENTATION
+#define MSH_BENCH_IMPLEMENTATION
+#define MSH_SAMPLING_IMPLEMENTATION
 #include "msh_std.h"
+#include "msh_jobs.h"
+#include "msh_perf.h"
+#include "msh_bench.h"
+#include "msh_sampling.h"
 
 enum { A_N_ELEMS = 10,   A_N_SAMPLES = 1000000, A_INVCDF_N_BINS = 4096 };
 enum { B_N_ELEMS = 8196, B_N_BINS = 64, B_N_SAMPLES = 100000, B_INVCDF_N_BINS = 8196 };
+enum { C_WIDTH = 512, C_HEIGHT = 256, C_N_COLS = 64, C_N_ROWS = 24, C_N_SAMPLES = 4000000 };
+enum { D_N_ELEMS = 1 << 21, D_N_THREADS = 4 };
+enum { E_N_SAMPLES = 1 << 24, E_BATCH_SIZE = 4096 };
+enum { F_N_ELEMS = 1 << 20, F_N_BINS = 64, F_N_SAMPLES = 1 << 24, F_N_BUILD_ELEMS = 1 << 23 };
 
 void print_histogram( double* hist, int n_bins )
 {
@@ -55,7 +96,7 @@ void print_histogram( double* hist, int n_bins )
     for( int c = 0; c < n_cols; ++c )
     {
       int h = n_rows * hist[c];
-      if( h > n_rows - r) printf("#", h);
+      if( h > n_rows - r) printf("#");
       else printf(" ");
     }
     printf("\n");
@@ -92,10 +133,520 @@ void print_bin_counts_as_weights( int* arr, int n_elems, int n_samples )
   printf("\n");
 }
 
-int main( void )
+void print_histogram2d( const double* hist, int n_cols, int n_rows )
+{
+  const char* ramp = " .:-=+*#%@";
+  double max = 0.0;
+  for( int i = 0; i < n_cols * n_rows; ++i ) { max = msh_max( max, hist[i] ); }
+  for( int r = 0; r < n_rows; ++r )
+  {
+    for( int c = 0; c < n_cols; ++c )
+    {
+      int level = (max > 0.0) ? (int)(9.0 * hist[r * n_cols + c] / max + 0.5) : 0;
+      printf( "%c", ramp[level] );
+    }
+    printf("\n");
+  }
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+// Benchmark and validation harness, run with --bench
+//
+// Every sampler is run on a number of distribution shapes and sizes. For each combination we:
+//   - validate the samples with a chi-square test (adjacent cells are pooled until the expected
+//     count is large enough) and a Kolmogorov-Smirnov test against the source distribution,
+//     both from msh_sampling.h,
+//   - warm up, then time a number of repetitions and report median and 10th/90th percentile
+//     of ns/sample.
+// Results are printed, and optionally written to csv and json files.
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+enum { BENCH_BATCH_SIZE = 1 << 16, BENCH_N_VALIDATION_SAMPLES = 1 << 22 };
+
+typedef struct bench_sampler
+{
+  const char* name;
+  int approximate;   // not expected to pass statistical tests, reported but does not fail the run
+  int continuous;    // writes doubles in [0,1] instead of int32 indices
+  int linear_cost;   // sampling cost grows with n, so use fewer samples
+  int max_n;
+  void* (*init)( const double* weights, int n );
+  void  (*sample)( void* ctx, msh_rand_ctx_t* rand_gen, void* out, int n_samples );
+  void  (*free)( void* ctx );
+} bench_sampler_t;
+
+typedef struct bench_pdf_ctx
+{
+  int n, n_bins;
+  double* pdf;
+  double* table;
+} bench_pdf_ctx_t;
+
+void* bench_linear_init( const double* weights, int n )
+{
+  bench_pdf_ctx_t* ctx = calloc( 1, sizeof(bench_pdf_ctx_t) );
+  ctx->n = n;
+  ctx->pdf = malloc( n * sizeof(double) );
+  msh_distrib2pdf( weights, ctx->pdf, n );
+  return ctx;
+}
+
+void bench_linear_sample( void* data, msh_rand_ctx_t* rand_gen, void* out, int n_samples )
+{
+  bench_pdf_ctx_t* ctx = data;
+  int32_t* idx = out;
+  for( int i = 0; i < n_samples; ++i ) 
+  { 
+    idx[i] = msh_pdfsample_linear( ctx->pdf, msh_rand_nextf( rand_gen ), ctx->n ); 
+  }
+}
+
+void* bench_invcdf_init( const double* weights, int n )
+{
+  bench_pdf_ctx_t* ctx = bench_linear_init( weights, n );
+  double* cdf = malloc( n * sizeof(double) );
+  ctx->n_bins = msh_max( 4096, 4 * n );
+  ctx->table = malloc( ctx->n_bins * sizeof(double) );
+  msh_pdf2cdf( ctx->pdf, cdf, n );
+  msh_invert_cdf( cdf, n, ctx->table, ctx->n_bins );
+  free( cdf );
+  return ctx;
+}
+
+void bench_invcdf_sample( void* data, msh_rand_ctx_t* rand_gen, void* out, int n_samples )
+{
+  bench_pdf_ctx_t* ctx = data;
+  int32_t* idx = out;
+  for( int i = 0; i < n_samples; ++i ) 
+  { 
+    idx[i] = msh_pdfsample_invcdf( ctx->table, msh_rand_nextf( rand_gen ), ctx->n_bins ); 
+  }
+}
+
+void bench_pdf_free( void* data )
+{
+  bench_pdf_ctx_t* ctx = data;
+  free( ctx->pdf );
+  free( ctx->table );
+  free( ctx );
+}
+
+void* bench_alias_init( const double* weights, int n )
+{
+  msh_discrete_distrib_t* ctx = calloc( 1, sizeof(msh_discrete_distrib_t) );
+  msh_discrete_distribution_init( ctx, (double*)weights, n, 7123ULL );
+  return ctx;
+}
+
+// msh_discrete_distrib_t draws from the generator it owns, so the caller's stream is swapped in
+// for the batch. This keeps runs reproducible and comparable with the other samplers.
+void bench_alias_sample( void* data, msh_rand_ctx_t* rand_gen, void* out, int n_samples )
+{
+  msh_discrete_distrib_t* ctx = data;
+  int32_t* idx = out;
+  ctx->rand_gen = *rand_gen;
+  for( int i = 0; i < n_samples; ++i ) { idx[i] = msh_discrete_distribution_sample( ctx ); }
+  *rand_gen = ctx->rand_gen;
+}
+
+void bench_alias_free( void* ctx )
+{
+  msh_discrete_distribution_free( ctx );
+  free( ctx );
+}
+
+void* bench_alias64_init( const double* weights, int n )
+{
+  msh_alias64_t* ctx = calloc( 1, sizeof(msh_alias64_t) );
+  msh_alias64_init( ctx, weights, n );
+  return ctx;
+}
+
+// Job system for parallel setup, created and destroyed by run_benchmark.
+static msh_jobs_t* bench_jobs = NULL;
+
+void* bench_alias64_mt_init( const double* weights, int n )
+{
+  msh_alias64_t* ctx = calloc( 1, sizeof(msh_alias64_t) );
+  msh_alias64_init_mt( ctx, weights, n, bench_jobs );
+  return ctx;
+}
+
+void bench_alias64_sample( void* ctx, msh_rand_ctx_t* rand_gen, void* out, int n_samples )
+{
+  msh_alias64_sample_n( ctx, rand_gen, out, n_samples );
+}
+
+void bench_alias64_free( void* ctx )
+{
+  msh_alias64_free( ctx );
+  free( ctx );
+}
+
+void* bench_alias32_init( const double* weights, int n )
+{
+  msh_alias32_t* ctx = calloc( 1, sizeof(msh_alias32_t) );
+  msh_alias32_init( ctx, weights, n );
+  return ctx;
+}
+
+void bench_alias32_sample( void* ctx, msh_rand_ctx_t* rand_gen, void* out, int n_samples )
+{
+  msh_alias32_sample_n( ctx, rand_gen, out, n_samples );
+}
+
+void bench_alias32_free( void* ctx )
+{
+  msh_alias32_free( ctx );
+  free( ctx );
+}
+
+// Weights are the vertex values, samples are positions in [0,1].
+typedef struct bench_pwl_ctx
+{
+  msh_pwl_distrib_t distrib;
+  double* u;
+} bench_pwl_ctx_t;
+
+void* bench_pwl_init( const double* weights, int n )
+{
+  bench_pwl_ctx_t* ctx = calloc( 1, sizeof(bench_pwl_ctx_t) );
+  msh_pwl_distrib_init( &ctx->distrib, weights, n );
+  ctx->u = malloc( BENCH_BATCH_SIZE * sizeof(double) );
+  return ctx;
+}
+
+void bench_pwl_sample( void* data, msh_rand_ctx_t* rand_gen, void* out, int n_samples )
+{
+  bench_pwl_ctx_t* ctx = data;
+  double* x = out;
+  for( int i = 0; i < n_samples; i += BENCH_BATCH_SIZE )
+  {
+    int n = msh_min( BENCH_BATCH_SIZE, n_samples - i );
+    for( int j = 0; j < n; ++j ) { ctx->u[j] = msh_sampling_nextd( rand_gen ); }
+    msh_pwl_distrib_sample_n( &ctx->distrib, ctx->u, x + i, NULL, n );
+  }
+}
+
+void bench_pwl_free( void* data )
+{
+  bench_pwl_ctx_t* ctx = data;
+  msh_pwl_distrib_free( &ctx->distrib );
+  free( ctx->u );
+  free( ctx );
+}
+
+// Weights are laid out as a (nearly) square image, samples are converted back to cell indices.
+typedef struct bench_2d_ctx
+{
+  msh_distrib2d_t distrib;
+  double* u;
+  float* xy;
+} bench_2d_ctx_t;
+
+void* bench_2d_init( const double* weights, int n )
+{
+  int height = 1;
+  while( height * height * 4 <= n && n % (height * 2) == 0 ) { height *= 2; }
+  bench_2d_ctx_t* ctx = calloc( 1, sizeof(bench_2d_ctx_t) );
+  msh_distrib2d_init( &ctx->distrib, weights, n / height, height );
+  ctx->u = malloc( 2 * BENCH_BATCH_SIZE * sizeof(double) );
+  ctx->xy = malloc( 2 * BENCH_BATCH_SIZE * sizeof(float) );
+  return ctx;
+}
+
+void bench_2d_sample( void* data, msh_rand_ctx_t* rand_gen, void* out, int n_samples )
+{
+  bench_2d_ctx_t* ctx = data;
+  int32_t* idx = out;
+  int w = ctx->distrib.width, h = ctx->distrib.height;
+  for( int i = 0; i < n_samples; i += BENCH_BATCH_SIZE )
+  {
+    int n = msh_min( BENCH_BATCH_SIZE, n_samples - i );
+    for( int j = 0; j < 2 * n; ++j ) { ctx->u[j] = msh_sampling_nextd( rand_gen ); }
+    msh_distrib2d_sample_n( &ctx->distrib, ctx->u, ctx->xy, NULL, n );
+    for( int j = 0; j < n; ++j )
+    {
+      int px = msh_min( (int)(ctx->xy[2*j] * w), w - 1 );
+      int py = msh_min( (int)(ctx->xy[2*j+1] * h), h - 1 );
+      idx[i + j] = py * w + px;
+    }
+  }
+}
+
+void bench_2d_free( void* data )
+{
+  bench_2d_ctx_t* ctx = data;
+  msh_distrib2d_free( &ctx->distrib );
+  free( ctx->u );
+  free( ctx->xy );
+  free( ctx );
+}
+
+static const bench_sampler_t bench_samplers[] =
 {
+  { "linear",       0, 0, 1, 1 << 16, bench_linear_init,     bench_linear_sample,  bench_pdf_free },
+  { "inv_cdf",      1, 0, 0, 1 << 20, bench_invcdf_init,     bench_invcdf_sample,  bench_pdf_free },
+  { "alias",        0, 0, 0, 1 << 20, bench_alias_init,      bench_alias_sample,   bench_alias_free },
+  { "alias64",      0, 0, 0, 1 << 20, bench_alias64_init,    bench_alias64_sample, bench_alias64_free },
+  { "alias64_mt",   0, 0, 0, 1 << 20, bench_alias64_mt_init, bench_alias64_sample, bench_alias64_free },
+  { "alias32",      0, 0, 0, 1 << 16, bench_alias32_init,    bench_alias32_sample, bench_alias32_free },
+  { "pwl_1d",       0, 1, 0, 1 << 20, bench_pwl_init,        bench_pwl_sample,     bench_pwl_free },
+  { "distrib_2d",   0, 0, 0, 1 << 20, bench_2d_init,         bench_2d_sample,      bench_2d_free },
+};
+
+static const char* bench_shape_names[] = { "uniform", "gaussians", "zipf", "spiky", "sparse" };
+static const int bench_sizes[] = { 16, 1024, 1 << 16, 1 << 20 };
+
+void bench_make_shape( int shape, double* weights, int n, msh_rand_ctx_t* rand_gen )
+{
+  for( int i = 0; i < n; ++i )
+  {
+    double r = msh_sampling_nextd( rand_gen );
+    switch( shape )
+    {
+      case 0: weights[i] = 1.0; break;
+      case 1: weights[i] = msh_gauss1d( i, n/2, n/6.0 ) + msh_gauss1d( i, n/4, n/32.0 ) 
+                         + msh_gauss1d( i, 7*n/8, n/64.0 ); break;
+      case 2: weights[i] = 1.0 / (i + 1.0); break;
+      case 3: weights[i] = (r > 0.999 || i == n/3) ? 1000.0 : 0.01 * r; break;
+      default: weights[i] = (r < 0.9 && i != n/2) ? 0.0 : r; break;
+    }
+  }
+}
+
+typedef struct bench_result
+{
+  const char* sampler;
+  const char* shape;
+  int n;
+  int n_validation_samples;
+  double setup_ms;
+  double ns_mean, ns_ci95, ns_median, ns_p10, ns_p90;
+  double counters[MSH_PERF_N_COUNTERS];   // per sample, for the bits set in counters_valid
+  uint32_t counters_valid;
+  double chi2, p_value, ks_d, ks_crit;
+  int dof;
+  int impossible;    // samples that fell into cells with zero probability
+  int passed;
+} bench_result_t;
+
+void bench_validate( const bench_sampler_t* sampler, const double* weights, int n, 
+                     const void* samples, int n_samples, bench_result_t* result )
+{
+  msh_sampling_test_t test;
+  if( sampler->continuous )
+  {
+    msh_sampling_test_pwl( weights, n, samples, n_samples, &test );
+  }
+  else
+  {
+    double* pdf = malloc( n * sizeof(double) );
+    msh_distrib2pdf( weights, pdf, n );
+    msh_sampling_test_discrete( pdf, n, samples, n_samples, &test );
+    free( pdf );
+  }
+  result->chi2 = test.chi2;
+  result->dof = test.dof;
+  result->p_value = test.p_value;
+  result->ks_d = test.ks_d;
+  result->ks_crit = test.ks_crit;
+  result->impossible = test.n_impossible;
+  result->passed = msh_sampling_test_passed( &test );
+}
+
+typedef struct bench_time_ctx
+{
+  const bench_sampler_t* sampler;
+  void* ctx;
+  void* out;
+  msh_rand_ctx_t* rand_gen;
+  int n_samples;
+} bench_time_ctx_t;
+
+void bench_time_batch( void* data, size_t n_iters )
+{
+  bench_time_ctx_t* t = data;
+  for( size_t it = 0; it < n_iters; ++it )
+  {
+    t->sampler->sample( t->ctx, t->rand_gen, t->out, t->n_samples );
+    MSH_BENCH_CLOBBER();
+  }
+}
+
+void bench_time( msh_bench_t* b, msh_perf_t* perf, const bench_sampler_t* sampler, void* ctx, int n,
+                 void* out, msh_rand_ctx_t* rand_gen, bench_result_t* result )
+{
+  bench_time_ctx_t t = { sampler, ctx, out, rand_gen, BENCH_BATCH_SIZE };
+  if( sampler->linear_cost ) { t.n_samples = msh_clamp( (1 << 24) / n, 64, BENCH_BATCH_SIZE ); }
+
+  msh_bench_result_t r;
+  msh_bench_measure( b, sampler->name, bench_time_batch, &t, t.n_samples, &r );
+  result->ns_mean   = r.ns_per_op;
+  result->ns_ci95   = r.ci_ns;
+  result->ns_median = r.median_ns;
+  result->ns_p10    = r.p10_ns;
+  result->ns_p90    = r.p90_ns;
+
+  enum { N_COUNTED_BATCHES = 16 };
+  msh_perf_counters_t c = {0};
+  if( msh_perf_available( perf ) ) { MSH_PERF_SCOPE( perf, &c ) { bench_time_batch( &t, N_COUNTED_BATCHES ); } }
+  for( int i = 0; i < MSH_PERF_N_COUNTERS; ++i ) { result->counters[i] = c.values[i] / ( (double)N_COUNTED_BATCHES * t.n_samples ); }
+  result->counters_valid = c.valid;
+}
+
+// Counter per sample for reports, empty when it was not counted.
+const char* bench_format_counter( char* buf, size_t size, const bench_result_t* r, msh_perf_counter_t counter,
+                                  const char* missing )
+{
+  if( r->counters_valid & ( 1u << counter ) ) { snprintf( buf, size, "%.3f", r->counters[counter] ); }
+  else                                        { snprintf( buf, size, "%s", missing ); }
+  return buf;
+}
+
+void bench_write_csv( const char* filename, const bench_result_t* results, int n_results )
+{
+  FILE* fp = fopen( filename, "w" );
+  if( !fp ) { printf("Could not open %s for writing.\n", filename ); return; }
+  fprintf( fp, "sampler,shape,n,setup_ms,ns_mean,ns_ci95,ns_median,ns_p10,ns_p90,n_validation_samples,"
+               "chi2,dof,p_value,ks_d,ks_crit,impossible,passed,cycles,l1d_misses,llc_misses,branch_misses\n" );
+  for( int i = 0; i < n_results; ++i )
+  {
+    const bench_result_t* r = &results[i];
+    char counters[4][32];
+    fprintf( fp, "%s,%s,%d,%f,%f,%f,%f,%f,%f,%d,%f,%d,%g,%g,%g,%d,%d,%s,%s,%s,%s\n", 
+             r->sampler, r->shape, r->n, r->setup_ms, r->ns_mean, r->ns_ci95, r->ns_median,
+             r->ns_p10, r->ns_p90,
+             r->n_validation_samples, r->chi2, r->dof, r->p_value, r->ks_d, r->ks_crit, 
+             r->impossible, r->passed,
+             bench_format_counter( counters[0], 32, r, MSH_PERF_CYCLES, "" ),
+             bench_format_counter( counters[1], 32, r, MSH_PERF_L1D_MISSES, "" ),
+             bench_format_counter( counters[2], 32, r, MSH_PERF_LLC_MISSES, "" ),
+             bench_format_counter( counters[3], 32, r, MSH_PERF_BRANCH_MISSES, "" ) );
+  }
+  fclose( fp );
+}
+
+void bench_write_json( const char* filename, const bench_result_t* results, int n_results )
+{
+  FILE* fp = fopen( filename, "w" );
+  if( !fp ) { printf("Could not open %s for writing.\n", filename ); return; }
+  fprintf( fp, "[\n" );
+  for( int i = 0; i < n_results; ++i )
+  {
+    const bench_result_t* r = &results[i];
+    char counters[4][32];
+    fprintf( fp, "  { \"sampler\": \"%s\", \"shape\": \"%s\", \"n\": %d, \"setup_ms\": %f, "
+                 "\"ns_mean\": %f, \"ns_ci95\": %f, \"ns_median\": %f, \"ns_p10\": %f, \"ns_p90\": %f, "
+                 "\"n_validation_samples\": %d, \"chi2\": %f, \"dof\": %d, \"p_value\": %g, "
+                 "\"ks_d\": %g, \"ks_crit\": %g, \"impossible\": %d, \"passed\": %s, "
+                 "\"cycles\": %s, \"l1d_misses\": %s, \"llc_misses\": %s, \"branch_misses\": %s }%s\n",
+             r->sampler, r->shape, r->n, r->setup_ms, r->ns_mean, r->ns_ci95, r->ns_median,
+             r->ns_p10, r->ns_p90, r->n_validation_samples, r->chi2, r->dof, r->p_value, r->ks_d,
+             r->ks_crit, r->impossible, r->passed ? "true" : "false",
+             bench_format_counter( counters[0], 32, r, MSH_PERF_CYCLES, "null" ),
+             bench_format_counter( counters[1], 32, r, MSH_PERF_L1D_MISSES, "null" ),
+             bench_format_counter( counters[2], 32, r, MSH_PERF_LLC_MISSES, "null" ),
+             bench_format_counter( counters[3], 32, r, MSH_PERF_BRANCH_MISSES, "null" ),
+             (i < n_results - 1) ? "," : "" );
+  }
+  fprintf( fp, "]\n" );
+  fclose( fp );
+}
+
+// Returns the number of failed tests, approximate samplers are not counted.
+int run_benchmark( int argc, char** argv, const char* csv_filename, const char* json_filename )
+{
+  int n_samplers = (int)(sizeof(bench_samplers) / sizeof(bench_samplers[0]));
+  int n_shapes = (int)(sizeof(bench_shape_names) / sizeof(bench_shape_names[0]));
+  int n_sizes = (int)(sizeof(bench_sizes) / sizeof(bench_sizes[0]));
+  bench_result_t* results = calloc( n_samplers * n_shapes * n_sizes, sizeof(bench_result_t) );
+  int n_results = 0, n_failed = 0;
+
+  int max_n = bench_sizes[n_sizes - 1];
+  double* weights = malloc( max_n * sizeof(double) );
+  void* samples = malloc( (size_t)BENCH_N_VALIDATION_SAMPLES * sizeof(double) );
+  msh_rand_ctx_t rand_gen = {0};
+  msh_bench_t* b = msh_bench_create( argc, argv );
+  msh_perf_t* perf = msh_perf_create();
+  bench_jobs = msh_jobs_create( D_N_THREADS - 1 );
+
+  printf("%-12s %-10s %8s %10s %10s %10s %10s %10s %10s %10s %10s %10s %10s %s\n", "sampler", "shape", "n",
+         "setup ms", "ns mean", "+-95%", "ns median", "ns p10", "ns p90", "L1D/smp", "LLC/smp", "chi2 p",
+         "ks d", "result" );
+  for( int si = 0; si < n_sizes; ++si )
+  {
+    for( int hi = 0; hi < n_shapes; ++hi )
+    {
+      int n = bench_sizes[si];
+      msh_rand_init( &rand_gen, 1000ULL * si + hi );
+      bench_make_shape( hi, weights, n, &rand_gen );
+      for( int ki = 0; ki < n_samplers; ++ki )
+      {
+        const bench_sampler_t* sampler = &bench_samplers[ki];
+        if( n > sampler->max_n ) { continue; }
+        bench_result_t* result = &results[n_results++];
+        result->sampler = sampler->name;
+        result->shape = bench_shape_names[hi];
+        result->n = n;
+
+        uint64_t t1 = msh_time_now();
+        void* ctx = sampler->init( weights, n );
+        uint64_t t2 = msh_time_now();
+        result->setup_ms = msh_time_diff( MSHT_MILLISECONDS, t2, t1 );
+
+        int n_validation = BENCH_N_VALIDATION_SAMPLES;
+        if( sampler->linear_cost ) { n_validation = msh_clamp( (1 << 28) / n, 4096, n_validation ); }
+        result->n_validation_samples = n_validation;
+        sampler->sample( ctx, &rand_gen, samples, n_validation );
+        bench_validate( sampler, weights, n, samples, n_validation, result );
+        bench_time( b, perf, sampler, ctx, n, samples, &rand_gen, result );
+        sampler->free( ctx );
+
+        const char* status = result->passed ? "PASSED" : (sampler->approximate ? "approx." : "FAILED");
+        if( !result->passed && !sampler->approximate ) { n_failed++; }
+        char l1d[32], llc[32];
+        printf("%-12s %-10s %8d %10.3f %10.2f %10.2f %10.2f %10.2f %10.2f %10s %10s %10.2g %10.2g %s\n", 
+               result->sampler, result->shape, n, result->setup_ms, result->ns_mean, 
+               result->ns_ci95, result->ns_median, result->ns_p10, result->ns_p90,
+               bench_format_counter( l1d, 32, result, MSH_PERF_L1D_MISSES, "-" ),
+               bench_format_counter( llc, 32, result, MSH_PERF_LLC_MISSES, "-" ), result->p_value, result->ks_d, status );
+      }
+    }
+  }
+  if( msh_perf_error( perf ) ) { printf("Some hardware counters are not available: %s\n", msh_perf_error( perf ) ); }
+  printf("%d failed.\n", n_failed );
+
+  if( csv_filename )  { bench_write_csv( csv_filename, results, n_results ); }
+  if( json_filename ) { bench_write_json( json_filename, results, n_results ); }
+
+  msh_jobs_destroy( bench_jobs );
+  bench_jobs = NULL;
+  msh_perf_destroy( perf );
+  msh_bench_destroy( b );
+  free( weights );
+  free( samples );
+  free( results );
+  return n_failed;
+}
+
+int main( int argc, char** argv )
+{
+  if( argc > 1 && !strcmp( argv[1], "--bench" ) )
+  {
+    const char* csv_filename = NULL;
+    const char* json_filename = NULL;
+    for( int i = 2; i < argc - 1; ++i )
+    {
+      if( !strcmp( argv[i], "--csv" ) )  { csv_filename = argv[++i]; }
+      else if( !strcmp( argv[i], "--json" ) ) { json_filename = argv[++i]; }
+    }
+    return run_benchmark( argc, argv, csv_filename, json_filename ) ? 1 : 0;
+  }
+
   uint64_t t1, t2;
   double te = 0;
+  int n_failed = 0;
   msh_rand_ctx_t rand_gen = {0};
   msh_rand_init(&rand_gen, 7123ULL);
 
@@ -269,5 +820,350 @@ int main( void )
   print_histogram( hist_invcdf, B_N_BINS );
   printf("\n");
 
+//=============================
+
+  printf("\nSampling from a piecewise-linear mixture of gaussians:\n");
+  double* u = malloc( 2 * C_N_SAMPLES * sizeof(double) );
+  double* xs = malloc( C_N_SAMPLES * sizeof(double) );
+  for( int i = 0; i < 2 * C_N_SAMPLES; ++i ) { u[i] = msh_sampling_nextd( &rand_gen ); }
+
+  msh_pwl_distrib_t pwl_distrib = {0};
+  t1 = msh_time_now();
+  msh_pwl_distrib_init( &pwl_distrib, f, B_N_ELEMS );
+  t2 = msh_time_now();
+  printf("Setup (%fms)\n", msh_time_diff( MSHT_MILLISECONDS, t2, t1 ) );
+
+  t1 = msh_time_now();
+  msh_pwl_distrib_sample_n( &pwl_distrib, u, xs, NULL, C_N_SAMPLES );
+  t2 = msh_time_now();
+  te = msh_time_diff( MSHT_MILLISECONDS, t2, t1 );
+  printf("Piecewise-linear sampling of %d samples (%fms, %fns/sample):\n", 
+          C_N_SAMPLES, te, te * 1e6 / C_N_SAMPLES );
+  double hist_pwl[B_N_BINS] = {0};
+  for( int i = 0; i < C_N_SAMPLES; ++i )
+  {
+    int b = msh_min( (int)(xs[i] * B_N_BINS), B_N_BINS - 1 );
+    hist_pwl[b]++;
+  }
+  print_histogram( hist_pwl, B_N_BINS );
+  printf("\n");
+
+  // Discrete samplers can only ever return the 8 element positions in this window.
+  double zoom_start = B_N_ELEMS/4 - 4;
+  double zoom_width = 8;
+  double hist_zoom[B_N_BINS] = {0};
+  for( int i = 0; i < C_N_SAMPLES; ++i )
+  {
+    double x = xs[i] * (B_N_ELEMS - 1) - zoom_start;
+    if( x < 0.0 || x >= zoom_width ) { continue; }
+    hist_zoom[ (int)(x / zoom_width * B_N_BINS) ]++;
+  }
+  printf("Piecewise-linear samples between elements %d and %d:\n", 
+          (int)zoom_start, (int)(zoom_start + zoom_width) );
+  print_histogram( hist_zoom, B_N_BINS );
+  printf("\n");
+
+  msh_pwl_distrib_free( &pwl_distrib );
+
+//----
+
+  printf("\nSampling from a 2D emission map (%dx%d):\n", C_WIDTH, C_HEIGHT );
+  double* emission = malloc( C_WIDTH * C_HEIGHT * sizeof(double) );
+  for( int y = 0; y < C_HEIGHT; ++y )
+  {
+    for( int x = 0; x < C_WIDTH; ++x )
+    {
+      // Sky gets darker towards horizon, bottom quarter is black ground, plus a bright sun.
+      double sky = (y < 3 * C_HEIGHT / 4) ? 1.0 - (double)y / C_HEIGHT : 0.0;
+      double sun = 50000.0 * msh_gauss1d( x, 0.7 * C_WIDTH, 6 ) * msh_gauss1d( y, 0.3 * C_HEIGHT, 6 );
+      emission[y * C_WIDTH + x] = sky + sun;
+    }
+  }
+
+  msh_distrib2d_t emission_distrib = {0};
+  t1 = msh_time_now();
+  msh_distrib2d_init( &emission_distrib, emission, C_WIDTH, C_HEIGHT );
+  t2 = msh_time_now();
+  printf("Setup (%fms)\n", msh_time_diff( MSHT_MILLISECONDS, t2, t1 ) );
+
+  float* xy = malloc( 2 * C_N_SAMPLES * sizeof(float) );
+  float* xy_pdf = malloc( C_N_SAMPLES * sizeof(float) );
+  t1 = msh_time_now();
+  msh_distrib2d_sample_n( &emission_distrib, u, xy, xy_pdf, C_N_SAMPLES );
+  t2 = msh_time_now();
+  te = msh_time_diff( MSHT_MILLISECONDS, t2, t1 );
+  printf("2D sampling of %d samples (%fms, %fns/sample):\n", 
+          C_N_SAMPLES, te, te * 1e6 / C_N_SAMPLES );
+  double hist_2d[C_N_COLS * C_N_ROWS] = {0};
+  for( int i = 0; i < C_N_SAMPLES; ++i )
+  {
+    int c = msh_min( (int)(xy[2*i] * C_N_COLS), C_N_COLS - 1 );
+    int r = msh_min( (int)(xy[2*i+1] * C_N_ROWS), C_N_ROWS - 1 );
+    hist_2d[r * C_N_COLS + c]++;
+  }
+  // Sun dominates the map, show log-counts so that the sky is visible too.
+  for( int i = 0; i < C_N_COLS * C_N_ROWS; ++i ) { hist_2d[i] = log( 1.0 + hist_2d[i] ); }
+  print_histogram2d( hist_2d, C_N_COLS, C_N_ROWS );
+  printf("\n");
+
+  msh_distrib2d_free( &emission_distrib );
+  free( emission );
+  free( xy );
+  free( xy_pdf );
+  free( xs );
+  free( u );
+
+//=============================
+
+  printf("\nWeighted sampling without replacement:\n");
+  // Drawing a single item is the same as sampling with replacement, so it should match the 
+  // distribution of the loaded dice.
+  int n_draws = A_N_SAMPLES / 10;
+  int bin_counts_wor[A_N_ELEMS] = {0};
+  int32_t pick = 0;
+  for( int i = 0; i < n_draws; ++i )
+  {
+    msh_weighted_sample( distrib, A_N_ELEMS, 1, &rand_gen, &pick );
+    bin_counts_wor[pick]++;
+  }
+  printf("  Single item draws:\n");
+  print_bin_counts( bin_counts_wor, A_N_ELEMS );
+  print_bin_counts_as_weights( bin_counts_wor, A_N_ELEMS, n_draws );
+
+  // k is clamped to [0, n], and only the single zero weight item is left out. Without a job
+  // system the parallel version runs serially.
+  int32_t picks[A_N_ELEMS];
+  int n_none = msh_weighted_sample( distrib, A_N_ELEMS, -1, &rand_gen, picks );
+  int n_all = msh_weighted_sample( distrib, A_N_ELEMS, A_N_ELEMS + 1, &rand_gen, picks );
+  int n_all_mt = msh_weighted_sample_mt( distrib, A_N_ELEMS, A_N_ELEMS + 1, NULL, 99ULL, picks );
+  int clamp_ok = n_none == 0 && n_all == A_N_ELEMS - 1 && n_all_mt == A_N_ELEMS - 1;
+  printf("  Out of range k picks %d, %d and %d items: %s\n", n_none, n_all, n_all_mt,
+         clamp_ok ? "PASSED" : "FAILED" );
+  n_failed += !clamp_ok;
+  printf("\n");
+
+  msh_jobs_t* jobs = msh_jobs_create( D_N_THREADS - 1 );
+  double* d_weights = malloc( D_N_ELEMS * sizeof(double) );
+  int32_t* d_indices = malloc( D_N_ELEMS * sizeof(int32_t) );
+  uint8_t* d_marks = malloc( D_N_ELEMS * sizeof(uint8_t) );
+  for( int i = 0; i < D_N_ELEMS; ++i )
+  {
+    // Heavy-tailed weights, most of the mass is in few items.
+    double r = msh_sampling_nextd( &rand_gen );
+    d_weights[i] = 1e-3 + r * r * r * r;
+  }
+
+  t1 = msh_time_now();
+  msh_discrete_distribution_init( &sampling_ctx, d_weights, D_N_ELEMS, 7123ULL );
+  t2 = msh_time_now();
+  printf("  Picking k out of %d items (alias table setup %fms):\n", D_N_ELEMS,
+         msh_time_diff( MSHT_MILLISECONDS, t2, t1 ) );
+
+  int d_ks[] = { 1000, 100000, 1000000 };
+  for( int ki = 0; ki < (int)(sizeof(d_ks) / sizeof(d_ks[0])); ++ki )
+  {
+    int k = d_ks[ki];
+    printf("  k = %7d: ", k );
+
+    t1 = msh_time_now();
+    msh_weighted_sample( d_weights, D_N_ELEMS, k, &rand_gen, d_indices );
+    t2 = msh_time_now();
+    printf("keys %9.3fms | ", msh_time_diff( MSHT_MILLISECONDS, t2, t1 ) );
+
+    t1 = msh_time_now();
+    msh_weighted_sample_mt( d_weights, D_N_ELEMS, k, jobs, 1234ULL + ki, d_indices );
+    t2 = msh_time_now();
+    printf("keys x%d threads %9.3fms | ", D_N_THREADS, msh_time_diff( MSHT_MILLISECONDS, t2, t1 ) );
+
+    msh_reservoir_t reservoir = {0};
+    t1 = msh_time_now();
+    msh_reservoir_init( &reservoir, k, 4321ULL + ki );
+    for( int i = 0; i < D_N_ELEMS; ++i ) { msh_reservoir_push( &reservoir, i, d_weights[i] ); }
+    msh_reservoir_get( &reservoir, d_indices );
+    t2 = msh_time_now();
+    msh_reservoir_free( &reservoir );
+    printf("reservoir %9.3fms | ", msh_time_diff( MSHT_MILLISECONDS, t2, t1 ) );
+
+    // Repeated sampling with rejection of duplicates. Gets hopeless as k approaches n.
+    int64_t max_draws = 64LL * k, n_alias_draws = 0;
+    int n_unique = 0;
+    memset( d_marks, 0, D_N_ELEMS );
+    t1 = msh_time_now();
+    while( n_unique < k && n_alias_draws < max_draws )
+    {
+      int idx = msh_discrete_distribution_sample( &sampling_ctx );
+      n_alias_draws++;
+      if( d_marks[idx] ) { continue; }
+      d_marks[idx] = 1;
+      d_indices[n_unique++] = idx;
+    }
+    t2 = msh_time_now();
+    printf("alias rejection %9.3fms (%lld draws%s)\n", msh_time_diff( MSHT_MILLISECONDS, t2, t1 ),
+           (long long)n_alias_draws, (n_unique < k) ? ", gave up" : "" );
+  }
+
+  msh_discrete_distribution_free( &sampling_ctx );
+  free( d_weights );
+  free( d_indices );
+  free( d_marks );
+
+//=============================
+
+  printf("\nCompact alias tables:\n");
+  msh_alias64_t table64 = {0};
+  msh_alias32_t table32 = {0};
+  msh_alias64_init( &table64, distrib, A_N_ELEMS );
+  msh_alias32_init( &table32, distrib, A_N_ELEMS );
+  int32_t* e_out = malloc( E_BATCH_SIZE * sizeof(int32_t) );
+  int bin_counts_alias64[A_N_ELEMS] = {0};
+  int bin_counts_alias32[A_N_ELEMS] = {0};
+  for( int i = 0; i < A_N_SAMPLES; i += E_BATCH_SIZE )
+  {
+    int n = msh_min( E_BATCH_SIZE, A_N_SAMPLES - i );
+    msh_alias64_sample_n( &table64, &rand_gen, e_out, n );
+    for( int j = 0; j < n; ++j ) { bin_counts_alias64[e_out[j]]++; }
+    msh_alias32_sample_n( &table32, &rand_gen, e_out, n );
+    for( int j = 0; j < n; ++j ) { bin_counts_alias32[e_out[j]]++; }
+  }
+  printf("  64-bit entries:\n");
+  print_bin_counts_as_weights( bin_counts_alias64, A_N_ELEMS, A_N_SAMPLES );
+  printf("  32-bit entries (%d bit threshold):\n", 32 - table32.alias_bits );
+  print_bin_counts_as_weights( bin_counts_alias32, A_N_ELEMS, A_N_SAMPLES );
+  msh_alias64_free( &table64 );
+  msh_alias32_free( &table32 );
+  printf("\n");
+
+  // Throughput once the table no longer fits in cache. Summing every sampled index keeps the
+  // sampling loops alive.
+  int e_sizes[] = { 1 << 16, 1 << 20, 1 << 23 };
+  for( int si = 0; si < (int)(sizeof(e_sizes) / sizeof(e_sizes[0])); ++si )
+  {
+    int n = e_sizes[si];
+    double* e_weights = malloc( n * sizeof(double) );
+    for( int i = 0; i < n; ++i ) { e_weights[i] = msh_sampling_nextd( &rand_gen ); }
+    int64_t checksum = 0;
+    printf("  n = %8d: ", n );
+
+    msh_discrete_distribution_init( &sampling_ctx, e_weights, n, 7123ULL );
+    t1 = msh_time_now();
+    for( int i = 0; i < E_N_SAMPLES; i += E_BATCH_SIZE )
+    {
+      for( int j = 0; j < E_BATCH_SIZE; ++j ) { e_out[j] = msh_discrete_distribution_sample( &sampling_ctx ); }
+      for( int j = 0; j < E_BATCH_SIZE; ++j ) { checksum += e_out[j]; }
+    }
+    t2 = msh_time_now();
+    msh_discrete_distribution_free( &sampling_ctx );
+    printf("double+int %6.2fns | ", msh_time_diff( MSHT_NANOSECONDS, t2, t1 ) / E_N_SAMPLES );
+
+    msh_alias64_init( &table64, e_weights, n );
+    t1 = msh_time_now();
+    for( int i = 0; i < E_N_SAMPLES; i += E_BATCH_SIZE )
+    {
+      msh_alias64_sample_n( &table64, &rand_gen, e_out, E_BATCH_SIZE );
+      for( int j = 0; j < E_BATCH_SIZE; ++j ) { checksum += e_out[j]; }
+    }
+    t2 = msh_time_now();
+    msh_alias64_free( &table64 );
+    printf("packed64 %6.2fns | ", msh_time_diff( MSHT_NANOSECONDS, t2, t1 ) / E_N_SAMPLES );
+
+    if( msh_alias32_init( &table32, e_weights, n ) )
+    {
+      t1 = msh_time_now();
+      for( int i = 0; i < E_N_SAMPLES; i += E_BATCH_SIZE )
+      {
+        msh_alias32_sample_n( &table32, &rand_gen, e_out, E_BATCH_SIZE );
+        for( int j = 0; j < E_BATCH_SIZE; ++j ) { checksum += e_out[j]; }
+      }
+      t2 = msh_time_now();
+      msh_alias32_free( &table32 );
+      printf("packed32 %6.2fns ", msh_time_diff( MSHT_NANOSECONDS, t2, t1 ) / E_N_SAMPLES );
+    }
+    else
+    {
+      printf("packed32    n/a   ");
+    }
+    printf("per sample (checksum %lld)\n", (long long)checksum );
+    free( e_weights );
+  }
+
+//=============================
+
+  printf("\nParallel alias table construction:\n");
+  double* f_weights = malloc( F_N_ELEMS * sizeof(double) );
+  double* f_ref_pdf = malloc( F_N_ELEMS * sizeof(double) );
+  double* f_table_pdf = malloc( F_N_ELEMS * sizeof(double) );
+  for( int i = 0; i < F_N_ELEMS; ++i )
+  {
+    // Mostly small weights, some zeros and a few spikes.
+    double r = msh_sampling_nextd( &rand_gen );
+    f_weights[i] = (r < 0.1) ? 0.0 : ((r > 0.9999) ? 1000.0 * r : r);
+  }
+  msh_distrib2pdf( f_weights, f_ref_pdf, F_N_ELEMS );
+
+  // Table must imply the same pdf up to the precision of the 32-bit thresholds.
+  msh_alias64_init_mt( &table64, f_weights, F_N_ELEMS, jobs );
+  msh_alias64_to_pdf( &table64, f_table_pdf );
+  double max_err = 0.0;
+  for( int i = 0; i < F_N_ELEMS; ++i ) { max_err = msh_max( max_err, fabs( f_table_pdf[i] - f_ref_pdf[i] ) ); }
+  int table_ok = (max_err * F_N_ELEMS) < 1e-6;
+  printf("  Table pdf vs. msh_distrib2pdf, max. error %g: %s\n", max_err, table_ok ? "PASSED" : "FAILED" );
+  n_failed += !table_ok;
+
+  // Sampled histogram over coarse bins must be within 5 standard deviations everywhere.
+  double f_hist[F_N_BINS] = {0};
+  double f_expected[F_N_BINS] = {0};
+  for( int i = 0; i < F_N_ELEMS; ++i ) { f_expected[(int64_t)i * F_N_BINS / F_N_ELEMS] += f_ref_pdf[i]; }
+  for( int i = 0; i < F_N_SAMPLES; i += E_BATCH_SIZE )
+  {
+    msh_alias64_sample_n( &table64, &rand_gen, e_out, E_BATCH_SIZE );
+    for( int j = 0; j < E_BATCH_SIZE; ++j ) { f_hist[(int64_t)e_out[j] * F_N_BINS / F_N_ELEMS]++; }
+  }
+  int hist_ok = 1;
+  double max_sigma = 0.0;
+  for( int b = 0; b < F_N_BINS; ++b )
+  {
+    double p = f_expected[b];
+    double sigma = sqrt( p * (1.0 - p) / F_N_SAMPLES );
+    double dev = fabs( f_hist[b] / F_N_SAMPLES - p );
+    if( sigma > 0.0 ) { max_sigma = msh_max( max_sigma, dev / sigma ); }
+    if( dev > 5.0 * sigma + 1e-12 ) { hist_ok = 0; }
+  }
+  int zero_ok = 1;
+  for( int i = 0; i < F_N_ELEMS; ++i ) 
+  { 
+    if( f_weights[i] == 0.0 && f_table_pdf[i] != 0.0 ) { zero_ok = 0; } 
+  }
+  printf("  Sampled histogram vs. msh_distrib2pdf, max. deviation %.2f sigma: %s\n", 
+          max_sigma, hist_ok ? "PASSED" : "FAILED" );
+  printf("  Zero weight items are never sampled: %s\n", zero_ok ? "PASSED" : "FAILED" );
+  n_failed += !hist_ok + !zero_ok;
+  msh_alias64_free( &table64 );
+  free( f_weights );
+  free( f_ref_pdf );
+  free( f_table_pdf );
+
+  double* g_weights = malloc( F_N_BUILD_ELEMS * sizeof(double) );
+  for( int i = 0; i < F_N_BUILD_ELEMS; ++i ) { g_weights[i] = msh_sampling_nextd( &rand_gen ); }
+  t1 = msh_time_now();
+  msh_alias64_init( &table64, g_weights, F_N_BUILD_ELEMS );
+  t2 = msh_time_now();
+  msh_alias64_free( &table64 );
+  printf("  Build time for %d items, Vose: %fms\n", F_N_BUILD_ELEMS, msh_time_diff( MSHT_MILLISECONDS, t2, t1 ) );
+  for( int n_threads = 1; n_threads <= 16; n_threads *= 2 )
+  {
+    msh_jobs_t* build_jobs = msh_jobs_create( n_threads - 1 );
+    t1 = msh_time_now();
+    msh_alias64_init_mt( &table64, g_weights, F_N_BUILD_ELEMS, build_jobs );
+    t2 = msh_time_now();
+    msh_alias64_free( &table64 );
+    msh_jobs_destroy( build_jobs );
+    printf("  Build time for %d items, %2d threads: %fms\n", F_N_BUILD_ELEMS, n_threads, 
+           msh_time_diff( MSHT_MILLISECONDS, t2, t1 ) );
+  }
+  free( g_weights );
+  free( e_out );
+  msh_jobs_destroy( jobs );
+
+  return n_failed ? 1 : 0;
 
 }
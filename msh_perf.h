@@ -0,0 +1,324 @@
+/*
+  ==============================================================================
+
+  MSH_PERF.H v0.1
+
+  A single header library for reading hardware performance counters around a scope:
+
+    - cycles, instructions, L1 data cache misses, last level cache misses, branch misses and
+      page faults, through Linux perf_event_open
+    - counts accumulated over many scopes and reported per query or per element
+    - counters that cannot be opened (permissions, virtual machines, other platforms) are
+      reported as unavailable, with the reason, instead of failing
+
+  To use the library you simply add:
+
+  #include "msh_std.h"
+  #define MSH_PERF_IMPLEMENTATION
+  #include "msh_perf.h"
+
+  ==============================================================================
+  DOCUMENTATION
+
+  Counting
+    msh_perf_t* perf = msh_perf_create();
+    msh_perf_counters_t counters = {0};
+    MSH_PERF_SCOPE( perf, &counters )
+    {
+      for( int i = 0; i < n_queries; ++i ) { search( queries[i] ); }
+    }
+    msh_perf_print( stdout, "radius search", &counters, n_queries, "query" );
+    msh_perf_destroy( perf );
+
+    msh_perf_begin( perf ) and msh_perf_end( perf, &counters ) do the same as MSH_PERF_SCOPE.
+    msh_perf_end adds the counts since the matching begin to 'counters', so a sum over many
+    scopes, e.g. the same section over many frames, can be collected in one struct. Scopes of
+    one msh_perf_t do not nest.
+
+    Counters follow the thread that called msh_perf_create, in user space only; work done on
+    other threads, e.g. msh_jobs.h workers, is not counted. Beginning and ending a scope reads
+    every counter with a system call, which costs microseconds, so scopes should wrap
+    batches of work rather than single operations.
+
+    When the CPU has fewer counter registers than requested events, the kernel multiplexes
+    them and counts are scaled by the fraction of time each event was counted.
+
+  Availability
+    msh_perf_available( perf ) returns a bit mask with bit MSH_PERF_* set for each counter that
+    could be opened, and msh_perf_error( perf ) the reason for the missing ones, or NULL.
+    Common reasons are /proc/sys/kernel/perf_event_paranoid above 2, seccomp filters of
+    containers, and virtual machines that do not expose the PMU, in which case only page faults,
+    a software counter, are available. msh_perf_counters_t.valid has the bits of counters
+    that were counted in every scope added to it. On other platforms, or when syscall is not
+    declared (compile with _GNU_SOURCE), no counters are available.
+
+  Reporting
+    msh_perf_print( fp, name, &counters, n, "element" ) prints each valid counter divided by n,
+    and instructions per cycle. msh_perf_counter_name( MSH_PERF_LLC_MISSES ) returns a short name.
+
+  ==============================================================================
+  AUTHORS:
+    Maciej Halber
+
+  LICENSE:
+    CC0
+  ==============================================================================
+*/
+
+#ifndef MSH_PERF_H
+#define MSH_PERF_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#ifndef MSH_PERF_DEF
+#ifdef MSH_PERF_STATIC
+#define MSH_PERF_DEF static
+#else
+#define MSH_PERF_DEF extern
+#endif
+#endif
+
+#define MSH_PERF_SCOPE( perf, counters ) \
+  for( int msh__perf_once = ( msh_perf_begin( perf ), 1 ); msh__perf_once; \
+       msh__perf_once = ( msh_perf_end( perf, counters ), 0 ) )
+
+typedef enum msh_perf_counter
+{
+  MSH_PERF_CYCLES = 0,
+  MSH_PERF_INSTRUCTIONS,
+  MSH_PERF_L1D_MISSES,
+  MSH_PERF_LLC_MISSES,
+  MSH_PERF_BRANCH_MISSES,
+  MSH_PERF_PAGE_FAULTS,
+  MSH_PERF_N_COUNTERS
+} msh_perf_counter_t;
+
+typedef struct msh_perf_counters
+{
+  double values[MSH_PERF_N_COUNTERS];
+  uint32_t valid;        // bit per counter that was counted in every scope
+  size_t n_scopes;
+  double time_ms;
+} msh_perf_counters_t;
+
+typedef struct msh_perf msh_perf_t;
+
+MSH_PERF_DEF msh_perf_t* msh_perf_create( void );
+MSH_PERF_DEF void        msh_perf_destroy( msh_perf_t* perf );
+MSH_PERF_DEF uint32_t    msh_perf_available( const msh_perf_t* perf );
+MSH_PERF_DEF const char* msh_perf_error( const msh_perf_t* perf );
+
+MSH_PERF_DEF void msh_perf_begin( msh_perf_t* perf );
+MSH_PERF_DEF void msh_perf_end( msh_perf_t* perf, msh_perf_counters_t* counters );
+
+MSH_PERF_DEF const char* msh_perf_counter_name( msh_perf_counter_t counter );
+MSH_PERF_DEF void        msh_perf_print( FILE* fp, const char* name, const msh_perf_counters_t* counters,
+                                         double n, const char* unit );
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* MSH_PERF_H */
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+// IMPLEMENTATION
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+#ifdef MSH_PERF_IMPLEMENTATION
+
+#ifdef __linux__
+#include <errno.h>
+#include <unistd.h>
+#include <sys/syscall.h>
+#include <linux/perf_event.h>
+#if defined(SYS_perf_event_open) && defined(_DEFAULT_SOURCE)
+#define MSH__PERF_LINUX 1
+#endif
+#endif
+
+typedef struct msh__perf_reading
+{
+  uint64_t value;
+  uint64_t time_enabled;
+  uint64_t time_running;
+} msh__perf_reading_t;
+
+struct msh_perf
+{
+  int fds[MSH_PERF_N_COUNTERS];
+  uint32_t available;
+  const char* error;
+  msh__perf_reading_t start[MSH_PERF_N_COUNTERS];
+  uint64_t start_time;
+};
+
+static const char* msh__perf_names[MSH_PERF_N_COUNTERS] =
+{
+  "cycles", "instructions", "L1D misses", "LLC misses", "branch misses", "page faults"
+};
+
+#ifdef MSH__PERF_LINUX
+
+static int
+msh__perf_open( msh_perf_counter_t counter )
+{
+  struct perf_event_attr attr;
+  memset( &attr, 0, sizeof(attr) );
+  attr.size = sizeof(attr);
+  attr.read_format = PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING;
+  attr.exclude_kernel = 1;
+  attr.exclude_hv = 1;
+  attr.type = PERF_TYPE_HARDWARE;
+  switch( counter )
+  {
+    case MSH_PERF_CYCLES:        attr.config = PERF_COUNT_HW_CPU_CYCLES; break;
+    case MSH_PERF_INSTRUCTIONS:  attr.config = PERF_COUNT_HW_INSTRUCTIONS; break;
+    case MSH_PERF_LLC_MISSES:    attr.config = PERF_COUNT_HW_CACHE_MISSES; break;
+    case MSH_PERF_BRANCH_MISSES: attr.config = PERF_COUNT_HW_BRANCH_MISSES; break;
+    case MSH_PERF_L1D_MISSES:
+      attr.type = PERF_TYPE_HW_CACHE;
+      attr.config = PERF_COUNT_HW_CACHE_L1D | ( PERF_COUNT_HW_CACHE_OP_READ << 8 ) |
+                    ( PERF_COUNT_HW_CACHE_RESULT_MISS << 16 );
+      break;
+    case MSH_PERF_PAGE_FAULTS:
+      attr.type = PERF_TYPE_SOFTWARE;
+      attr.config = PERF_COUNT_SW_PAGE_FAULTS;
+      break;
+    default: return -1;
+  }
+  return (int)syscall( SYS_perf_event_open, &attr, 0, -1, -1, 0 );
+}
+
+static const char*
+msh__perf_error_string( int err )
+{
+  switch( err )
+  {
+    case EACCES:
+    case EPERM:      return "permission denied, see /proc/sys/kernel/perf_event_paranoid";
+    case ENOENT:
+    case EOPNOTSUPP: return "not supported by this CPU or virtual machine";
+    case ENOSYS:     return "perf_event_open is not available in this kernel";
+    default:         return "perf_event_open failed";
+  }
+}
+
+#endif
+
+MSH_PERF_DEF msh_perf_t*
+msh_perf_create( void )
+{
+  msh_perf_t* perf = calloc( 1, sizeof(msh_perf_t) );
+  for( int i = 0; i < MSH_PERF_N_COUNTERS; ++i ) { perf->fds[i] = -1; }
+#ifdef MSH__PERF_LINUX
+  for( int i = 0; i < MSH_PERF_N_COUNTERS; ++i )
+  {
+    perf->fds[i] = msh__perf_open( (msh_perf_counter_t)i );
+    if( perf->fds[i] >= 0 ) { perf->available |= 1u << i; }
+    else if( !perf->error ) { perf->error = msh__perf_error_string( errno ); }
+  }
+#else
+  perf->error = "hardware counters need Linux and syscall, compile with _GNU_SOURCE";
+#endif
+  return perf;
+}
+
+MSH_PERF_DEF void
+msh_perf_destroy( msh_perf_t* perf )
+{
+  if( !perf ) { return; }
+#ifdef MSH__PERF_LINUX
+  for( int i = 0; i < MSH_PERF_N_COUNTERS; ++i ) { if( perf->fds[i] >= 0 ) { close( perf->fds[i] ); } }
+#endif
+  free( perf );
+}
+
+MSH_PERF_DEF uint32_t
+msh_perf_available( const msh_perf_t* perf )
+{
+  return perf->available;
+}
+
+MSH_PERF_DEF const char*
+msh_perf_error( const msh_perf_t* perf )
+{
+  return perf->error;
+}
+
+static int
+msh__perf_read( const msh_perf_t* perf, int i, msh__perf_reading_t* r )
+{
+#ifdef MSH__PERF_LINUX
+  return perf->fds[i] >= 0 && read( perf->fds[i], r, sizeof(*r) ) == (ssize_t)sizeof(*r);
+#else
+  (void)perf; (void)i; (void)r;
+  return 0;
+#endif
+}
+
+MSH_PERF_DEF void
+msh_perf_begin( msh_perf_t* perf )
+{
+  for( int i = 0; i < MSH_PERF_N_COUNTERS; ++i )
+  {
+    if( !msh__perf_read( perf, i, &perf->start[i] ) ) { memset( &perf->start[i], 0, sizeof(perf->start[i]) ); }
+  }
+  perf->start_time = msh_time_now();
+}
+
+MSH_PERF_DEF void
+msh_perf_end( msh_perf_t* perf, msh_perf_counters_t* counters )
+{
+  uint64_t end_time = msh_time_now();
+  uint32_t valid = 0;
+  double values[MSH_PERF_N_COUNTERS] = {0};
+  for( int i = 0; i < MSH_PERF_N_COUNTERS; ++i )
+  {
+    msh__perf_reading_t r;
+    if( !msh__perf_read( perf, i, &r ) ) { continue; }
+    uint64_t enabled = r.time_enabled - perf->start[i].time_enabled;
+    uint64_t running = r.time_running - perf->start[i].time_running;
+    uint64_t count = r.value - perf->start[i].value;
+    // An event that was never scheduled during the scope tells nothing, rather than zero.
+    if( running == 0 && enabled != 0 ) { continue; }
+    values[i] = ( running && running < enabled ) ? (double)count * enabled / running : (double)count;
+    valid |= 1u << i;
+  }
+
+  counters->valid = counters->n_scopes ? ( counters->valid & valid ) : valid;
+  for( int i = 0; i < MSH_PERF_N_COUNTERS; ++i ) { counters->values[i] += values[i]; }
+  counters->n_scopes++;
+  counters->time_ms += msh_time_diff( MSHT_MILLISECONDS, end_time, perf->start_time );
+}
+
+MSH_PERF_DEF const char*
+msh_perf_counter_name( msh_perf_counter_t counter )
+{
+  return ( counter >= 0 && counter < MSH_PERF_N_COUNTERS ) ? msh__perf_names[counter] : "unknown";
+}
+
+MSH_PERF_DEF void
+msh_perf_print( FILE* fp, const char* name, const msh_perf_counters_t* counters, double n, const char* unit )
+{
+  n = n > 0.0 ? n : 1.0;
+  fprintf( fp, "  %-28s %10.3f ns/%s", name, counters->time_ms * 1e6 / n, unit );
+  for( int i = 0; i < MSH_PERF_N_COUNTERS; ++i )
+  {
+    if( counters->valid & ( 1u << i ) ) { fprintf( fp, ", %.3f %s", counters->values[i] / n, msh__perf_names[i] ); }
+  }
+  uint32_t ipc_bits = ( 1u << MSH_PERF_CYCLES ) | ( 1u << MSH_PERF_INSTRUCTIONS );
+  if( ( counters->valid & ipc_bits ) == ipc_bits && counters->values[MSH_PERF_CYCLES] > 0.0 )
+  {
+    fprintf( fp, ", %.2f IPC", counters->values[MSH_PERF_INSTRUCTIONS] / counters->values[MSH_PERF_CYCLES] );
+  }
+  fprintf( fp, "\n" );
+}
+
+#endif /* MSH_PERF_IMPLEMENTATION */
@@ -0,0 +1,252 @@
+/*
+  Author: Maciej Halber
+  Date : Oct 18, 2026
+  License: CC0
+
+  Compilation: gcc -std=c99 -O2 -D_GNU_SOURCE -I<path_to_msh_libraries> msh_perf_example.c -o msh_perf_example -lm
+  Usage:       msh_perf_example [--bench]
+  Description: This program showcases msh_perf.h, hardware performance counters around a scope. It:
+
+               1) Reports which counters are available, and why the others are not. Without
+               permissions or in virtual machines without a PMU the program still runs, with
+               the counters it could open.
+
+               2) Checks, for every available counter, that counts add up over scopes, that
+               instructions grow with the number of loop iterations, that touching fresh memory
+               causes page faults and touching it again does not, and that a scope is cheap
+               enough to wrap batches of work.
+
+               3) Reports counters per element for summing a large array in order and in random
+               order, where the difference is in cache misses, and for a branch that is
+               predictable or random.
+
+               Program returns non-zero if validation fails. With --bench, the sums are measured
+               with msh_bench.h, which adds counters per operation when msh_perf.h is included
+               first.
+*/
+
+#define MSH_STD_INCLUDE_HEADERS
+#define MSH_STD_IMPLEMENTATION
+#define MSH_PERF_IMPLEMENTATION
+#define MSH_BENCH_IMPLEMENTATION
+#include "msh_std.h"
+#include "msh_perf.h"
+#include "msh_bench.h"
+
+enum { N_ELEMS = 1 << 24, N_PAGES = 4096, N_PAGE_BYTES = 4096 };
+
+typedef struct sum_data
+{
+  const uint32_t* values;
+  const uint32_t* order;
+  size_t n;
+} sum_data_t;
+
+uint64_t sum_in_order( const sum_data_t* d )
+{
+  uint64_t sum = 0;
+  for( size_t i = 0; i < d->n; ++i ) { sum += d->values[i]; }
+  return sum;
+}
+
+uint64_t sum_in_random_order( const sum_data_t* d )
+{
+  uint64_t sum = 0;
+  for( size_t i = 0; i < d->n; ++i ) { sum += d->values[d->order[i]]; }
+  return sum;
+}
+
+// Branch on the low bit of each value; predictable when values are sorted by it.
+uint64_t sum_odd( const sum_data_t* d )
+{
+  uint64_t sum = 0;
+  for( size_t i = 0; i < d->n; ++i )
+  {
+    uint32_t v = d->values[d->order[i]];
+    if( v & 1 ) { sum += v; }
+    else        { sum ^= v; }
+  }
+  return sum;
+}
+
+uint64_t count_loop( size_t n )
+{
+  volatile uint64_t sum = 0;
+  for( size_t i = 0; i < n; ++i ) { sum += i; }
+  return sum;
+}
+
+int has( const msh_perf_counters_t* c, msh_perf_counter_t counter )
+{
+  return ( c->valid >> counter ) & 1;
+}
+
+int validate( msh_perf_t* perf )
+{
+  int n_failed = 0;
+  uint32_t available = msh_perf_available( perf );
+
+  // Counts add up over scopes, and valid counters are a subset of the available ones. Work is
+  // compared by counted events only, as wall-clock time depends on scheduling.
+  msh_perf_counters_t once = {0}, twice = {0};
+  MSH_PERF_SCOPE( perf, &once ) { count_loop( 1000000 ); }
+  MSH_PERF_SCOPE( perf, &twice ) { count_loop( 1000000 ); }
+  MSH_PERF_SCOPE( perf, &twice ) { count_loop( 1000000 ); }
+  int ok = twice.n_scopes == 2 && once.n_scopes == 1 && ( once.valid & ~available ) == 0;
+  if( has( &once, MSH_PERF_INSTRUCTIONS ) && has( &twice, MSH_PERF_INSTRUCTIONS ) )
+  {
+    double ratio = twice.values[MSH_PERF_INSTRUCTIONS] / once.values[MSH_PERF_INSTRUCTIONS];
+    ok &= ratio > 1.9 && ratio < 2.1;
+  }
+  if( has( &once, MSH_PERF_CYCLES ) && has( &twice, MSH_PERF_CYCLES ) )
+  {
+    ok &= twice.values[MSH_PERF_CYCLES] > once.values[MSH_PERF_CYCLES] * 1.5;
+  }
+  if( !ok ) { printf("  accumulation: FAILED\n"); }
+  n_failed += !ok;
+
+  // Instructions grow with loop iterations, at least one per iteration.
+  if( available & ( 1u << MSH_PERF_INSTRUCTIONS ) )
+  {
+    msh_perf_counters_t small = {0}, large = {0};
+    MSH_PERF_SCOPE( perf, &small ) { count_loop( 100000 ); }
+    MSH_PERF_SCOPE( perf, &large ) { count_loop( 10000000 ); }
+    double per_iter = ( large.values[MSH_PERF_INSTRUCTIONS] - small.values[MSH_PERF_INSTRUCTIONS] ) / 9900000.0;
+    ok = has( &large, MSH_PERF_INSTRUCTIONS ) && per_iter >= 1.0 && per_iter < 20.0;
+    if( !ok ) { printf("  instructions, %.2f per iteration: FAILED\n", per_iter ); }
+    n_failed += !ok;
+  }
+
+  // Fresh memory faults on first touch only. Transparent huge pages may map many pages at once.
+  if( available & ( 1u << MSH_PERF_PAGE_FAULTS ) )
+  {
+    unsigned char* mem = malloc( (size_t)N_PAGES * N_PAGE_BYTES );
+    msh_perf_counters_t first = {0}, second = {0};
+    MSH_PERF_SCOPE( perf, &first ) { for( size_t i = 0; i < N_PAGES; ++i ) { mem[i * N_PAGE_BYTES] = 1; } }
+    MSH_PERF_SCOPE( perf, &second ) { for( size_t i = 0; i < N_PAGES; ++i ) { mem[i * N_PAGE_BYTES] = 2; } }
+    ok = first.values[MSH_PERF_PAGE_FAULTS] >= N_PAGES / 512 &&
+         second.values[MSH_PERF_PAGE_FAULTS] < first.values[MSH_PERF_PAGE_FAULTS] / 4 + 1;
+    if( !ok )
+    {
+      printf("  page faults, %.0f then %.0f: FAILED\n", first.values[MSH_PERF_PAGE_FAULTS],
+             second.values[MSH_PERF_PAGE_FAULTS] );
+    }
+    n_failed += !ok;
+    free( mem );
+  }
+
+  // An empty scope is cheap enough to wrap batches of work.
+  msh_perf_counters_t empty = {0};
+  for( int i = 0; i < 1000; ++i ) { MSH_PERF_SCOPE( perf, &empty ) {} }
+  uint64_t t1 = msh_time_now();
+  for( int i = 0; i < 1000; ++i ) { MSH_PERF_SCOPE( perf, &empty ) {} }
+  uint64_t t2 = msh_time_now();
+  double scope_us = msh_time_diff( MSHT_MICROSECONDS, t2, t1 ) / 1000.0;
+  ok = empty.n_scopes == 2000 && scope_us < 50.0;
+  printf("  cost of a scope: %.2f us\n", scope_us );
+  if( !ok ) { printf("  scope cost: FAILED\n"); }
+  n_failed += !ok;
+
+  return n_failed;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+// Benchmarks, run with --bench
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void bench_in_order( void* data, size_t n_iters )
+{
+  for( size_t it = 0; it < n_iters; ++it ) { uint64_t s = sum_in_order( data ); MSH_BENCH_DO_NOT_OPTIMIZE( s ); }
+}
+
+void bench_random_order( void* data, size_t n_iters )
+{
+  for( size_t it = 0; it < n_iters; ++it ) { uint64_t s = sum_in_random_order( data ); MSH_BENCH_DO_NOT_OPTIMIZE( s ); }
+}
+
+int run_benchmarks( int argc, char** argv, sum_data_t* d )
+{
+  msh_bench_t* b = msh_bench_create( argc, argv );
+  msh_bench_add( b, "sum in order", bench_in_order, d, (double)d->n );
+  msh_bench_add( b, "sum in random order", bench_random_order, d, (double)d->n );
+  int n_regressions = msh_bench_run( b );
+  msh_bench_destroy( b );
+  return n_regressions;
+}
+
+int main( int argc, char** argv )
+{
+  int n_failed = 0;
+  msh_rand_ctx_t rand_gen = {0};
+  msh_rand_init( &rand_gen, 12345ULL );
+
+  uint32_t* values = malloc( N_ELEMS * sizeof(uint32_t) );
+  uint32_t* order = malloc( N_ELEMS * sizeof(uint32_t) );
+  for( uint32_t i = 0; i < N_ELEMS; ++i ) { values[i] = msh_rand_next( &rand_gen ); order[i] = i; }
+  for( uint32_t i = N_ELEMS - 1; i > 0; --i )
+  {
+    uint32_t j = msh_rand_next( &rand_gen ) % ( i + 1 );
+    uint32_t t = order[i]; order[i] = order[j]; order[j] = t;
+  }
+  sum_data_t d = { values, order, N_ELEMS };
+
+  if( msh_bench_requested( argc, argv ) )
+  {
+    n_failed = run_benchmarks( argc, argv, &d );
+    free( values );
+    free( order );
+    return n_failed ? 1 : 0;
+  }
+
+  msh_perf_t* perf = msh_perf_create();
+
+  //----------------------------------------------------------------------------------------------
+  printf("Available counters:\n");
+  {
+    for( int i = 0; i < MSH_PERF_N_COUNTERS; ++i )
+    {
+      int available = ( msh_perf_available( perf ) >> i ) & 1;
+      printf("  %-14s %s\n", msh_perf_counter_name( (msh_perf_counter_t)i ), available ? "yes" : "no" );
+    }
+    if( msh_perf_error( perf ) ) { printf("  missing counters: %s\n", msh_perf_error( perf ) ); }
+  }
+
+  //----------------------------------------------------------------------------------------------
+  printf("Validation:\n");
+  {
+    n_failed += validate( perf );
+  }
+
+  //----------------------------------------------------------------------------------------------
+  printf("Counters per element, %d elements:\n", N_ELEMS );
+  {
+    uint64_t sums[4];
+    msh_perf_counters_t c[4];
+    memset( c, 0, sizeof(c) );
+    MSH_PERF_SCOPE( perf, &c[0] ) { sums[0] = sum_in_order( &d ); }
+    MSH_PERF_SCOPE( perf, &c[1] ) { sums[1] = sum_in_random_order( &d ); }
+    msh_perf_print( stdout, "sum in order", &c[0], N_ELEMS, "element" );
+    msh_perf_print( stdout, "sum in random order", &c[1], N_ELEMS, "element" );
+    int ok = sums[0] == sums[1];
+    if( !ok ) { printf("  sums differ: FAILED\n"); }
+    n_failed += !ok;
+
+    // Elements in memory order, where the branch is random, then odd values first, where it is not.
+    for( uint32_t i = 0; i < N_ELEMS; ++i ) { order[i] = i; }
+    MSH_PERF_SCOPE( perf, &c[2] ) { sums[2] = sum_odd( &d ); }
+    uint32_t n_odd = 0;
+    for( uint32_t i = 0; i < N_ELEMS; ++i ) { n_odd += values[i] & 1; }
+    for( uint32_t i = 0, o = 0, e = n_odd; i < N_ELEMS; ++i ) { order[( values[i] & 1 ) ? o++ : e++] = i; }
+    MSH_PERF_SCOPE( perf, &c[3] ) { sums[3] = sum_odd( &d ); }
+    msh_perf_print( stdout, "random branch", &c[2], N_ELEMS, "element" );
+    msh_perf_print( stdout, "predictable branch", &c[3], N_ELEMS, "element" );
+    MSH_BENCH_DO_NOT_OPTIMIZE( sums[2] );
+    MSH_BENCH_DO_NOT_OPTIMIZE( sums[3] );
+  }
+
+  msh_perf_destroy( perf );
+  free( values );
+  free( order );
+  printf("%d failed\n", n_failed );
+  return n_failed ? 1 : 0;
+}
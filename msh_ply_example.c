@@ -3,16 +3,27 @@
   Date : Jul 18, 2018
   License: CC0
  
-  Compilation: gcc -std=c99 -I<path_to_msh_libraries> msh_ply_example.c -o msh_ply_example
-  Usage:       msh_ply_example <path_to_ply_file>
+  Compilation: gcc -std=c99 -I<path_to_msh_libraries> msh_ply_example.c -o msh_ply_example -lm
+  Usage:       msh_ply_example <path_to_ply_file> [--bench]
   Description: This is a simple program showcasing basic functionality of msh_ply.h library. It
                saves a simple cube file to disk, and reads it back. Program also showcases a 
                function that deliberately misuses the api in order to showcase error reporting.
+               With --bench, writing and reading a larger mesh is measured with msh_bench.h
+               instead, after reporting memory of a single read, tracked by msh_mem.h, as bytes
+               per vertex.
 */
 
+#define MSH_MEM_OVERRIDE
+#define MSH_MEM_IMPLEMENTATION
+#define MSH_STD_INCLUDE_HEADERS
+#define MSH_STD_IMPLEMENTATION
 #define MSH_PLY_IMPLEMENTATION
 #define MSH_PLY_INCLUDE_HEADERS
+#define MSH_BENCH_IMPLEMENTATION
+#include "msh_mem.h"
+#include "msh_std.h"
 #include "msh_ply.h"
+#include "msh_bench.h"
 
 typedef struct Vec3f
 {
@@ -161,8 +172,96 @@ error_report_example( const char* filename, TriMeshSimple *mesh )
 
 }
 
+////////////////////////////////////////////////////////////////////////////////////////////////////
+// Benchmarks, run with --bench
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+enum { BENCH_GRID_SIZE = 317 };
+
+typedef struct bench_data
+{
+  const char* filename;
+  TriMeshSimple mesh;
+} bench_data_t;
+
+// Regular grid of BENCH_GRID_SIZE^2 vertices, two triangles per cell.
+void create_grid_simple( TriMeshSimple* mesh )
+{
+  int n = BENCH_GRID_SIZE;
+  mesh->n_vertices = n * n;
+  mesh->n_faces    = 2 * ( n - 1 ) * ( n - 1 );
+  mesh->vertices   = (Vec3f*)malloc( mesh->n_vertices * sizeof(Vec3f) );
+  mesh->faces      = (Vec3i*)malloc( mesh->n_faces * sizeof(Vec3i) );
+  for( int y = 0; y < n; ++y )
+  {
+    for( int x = 0; x < n; ++x )
+    {
+      mesh->vertices[y * n + x] = (Vec3f){ (float)x, (float)y, sinf( 0.1f * x ) * cosf( 0.1f * y ) };
+    }
+  }
+  int f = 0;
+  for( int y = 0; y < n - 1; ++y )
+  {
+    for( int x = 0; x < n - 1; ++x )
+    {
+      int i = y * n + x;
+      mesh->faces[f++] = (Vec3i){ i, i + 1, i + n };
+      mesh->faces[f++] = (Vec3i){ i + 1, i + n + 1, i + n };
+    }
+  }
+}
+
+void bench_write( void* data, size_t n_iters )
+{
+  bench_data_t* d = data;
+  for( size_t it = 0; it < n_iters; ++it ) { write_example_simple( d->filename, &d->mesh ); }
+}
+
+void bench_read( void* data, size_t n_iters )
+{
+  bench_data_t* d = data;
+  for( size_t it = 0; it < n_iters; ++it )
+  {
+    TriMeshSimple mesh = {0};
+    read_example_simple( d->filename, &mesh );
+    MSH_BENCH_DO_NOT_OPTIMIZE( mesh.n_faces );
+    free( mesh.vertices );
+    free( mesh.faces );
+  }
+}
+
+int run_benchmarks( int argc, char** argv )
+{
+  bench_data_t d = { "msh_ply_bench.ply", {0} };
+  for( int i = 1; i < argc; ++i ) { if( strncmp( argv[i], "--", 2 ) ) { d.filename = argv[i]; break; } }
+  create_grid_simple( &d.mesh );
+  write_example_simple( d.filename, &d.mesh );
+
+  // Peak includes whatever the reader needs while parsing; live is what the mesh keeps.
+  TriMeshSimple mesh = {0};
+  msh_mem_stats_t mem;
+  msh_mem_reset_peaks();
+  MSH_MEM_TAG_SCOPE( "msh_ply" ) { read_example_simple( d.filename, &mesh ); }
+  msh_mem_get_stats( "msh_ply", &mem );
+  printf("Read of %d vertices and %d faces: %.2f bytes per vertex live, %.2f at peak, %zu allocations\n",
+         mesh.n_vertices, mesh.n_faces, mem.live_bytes / (double)mesh.n_vertices,
+         mem.peak_bytes / (double)mesh.n_vertices, mem.n_allocs );
+  free( mesh.vertices );
+  free( mesh.faces );
+
+  msh_bench_t* b = msh_bench_create( argc, argv );
+  msh_bench_add( b, "write binary, per vertex", bench_write, &d, d.mesh.n_vertices );
+  msh_bench_add( b, "read binary, per vertex", bench_read, &d, d.mesh.n_vertices );
+  int n_regressions = msh_bench_run( b );
+  msh_bench_destroy( b );
+  free( d.mesh.vertices );
+  free( d.mesh.faces );
+  return n_regressions ? 1 : 0;
+}
+
 int main( int argc, char** argv )
 {
+  if( msh_bench_requested( argc, argv ) ) { return run_benchmarks( argc, argv ); }
   if( argc < 2 ) { printf("Please provide path to the ply file!\n"); return 0; }
 
   TriMeshSimple cube_0 = {0};
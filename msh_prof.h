@@ -0,0 +1,463 @@
+/*
+  ==============================================================================
+
+  MSH_PROF.H v0.1
+
+  A single header library for profiling code with named, nestable scopes:
+
+    - scopes are recorded into per-thread buffers, without locks, using rdtsc on x86 or
+      clock_gettime elsewhere
+    - aggregation into count, total, min, median, p99 and max per scope
+    - export to Chrome trace JSON (chrome://tracing, https://ui.perfetto.dev)
+    - compiled out completely with MSH_PROF_DISABLE
+
+  To use the library you simply add:
+
+  #include "msh_std.h"
+  #include "msh_sort.h"
+  #define MSH_PROF_IMPLEMENTATION
+  #include "msh_prof.h"
+
+  ==============================================================================
+  DOCUMENTATION
+
+  Recording
+    MSH_PROF_BEGIN( "load" );
+    ...
+    MSH_PROF_END();
+
+    MSH_PROF_SCOPE( "build_grid" )
+    {
+      ...
+    }
+
+    Scopes nest, up to MSH_PROF_MAX_DEPTH (64) levels; deeper scopes are not recorded. Names
+    have to be string literals, or otherwise outlive the profiler, since only the pointer is
+    stored. MSH_PROF_SCOPE wraps the following statement in a for loop, so leaving it with
+    break or return skips the end of the scope.
+
+    Each thread records into its own list of MSH_PROF_CHUNK_SIZE event chunks, registered on
+    the first scope it begins. A scope costs two timer reads and a store of 32 bytes. Complete
+    events are published with release stores, so aggregation can run while other threads
+    record, but only sees the scopes that have already ended.
+
+    msh_prof_set_thread_name( "loader" ) names the calling thread in traces.
+
+  Timing
+    On x86 timestamps are read with rdtsc, which requires an invariant TSC (all x86 CPUs of
+    the last decade). Ticks are converted to time by comparing them with msh_time_now at
+    msh_prof_init and at the time of the report; a report made less than 10 ms after
+    msh_prof_init waits for the rest of that time. Define MSH_PROF_NO_RDTSC to use msh_time_now
+    directly.
+
+  Reporting
+    msh_prof_init();                                    // at startup
+    msh_prof_print( stdout );
+    msh_prof_write_chrome_trace( "trace.json" );
+
+    msh_array(msh_prof_scope_stats_t) stats = NULL;
+    size_t n_scopes = msh_prof_aggregate( &stats );
+    msh_array_free( stats );
+
+    msh_prof_aggregate groups scopes by name, over all threads, sorted by total time. Times are
+    in milliseconds. msh_prof_write_chrome_trace returns 1 on success and 0 if the file could
+    not be written. msh_prof_reset discards all events; it may only be called while no thread
+    is inside a scope.
+
+  ==============================================================================
+  AUTHORS:
+    Maciej Halber
+
+  LICENSE:
+    CC0
+  ==============================================================================
+*/
+
+#ifndef MSH_PROF_H
+#define MSH_PROF_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#ifndef MSH_PROF_DEF
+#ifdef MSH_PROF_STATIC
+#define MSH_PROF_DEF static
+#else
+#define MSH_PROF_DEF extern
+#endif
+#endif
+
+#ifndef MSH_PROF_MAX_DEPTH
+#define MSH_PROF_MAX_DEPTH 64
+#endif
+
+#ifndef MSH_PROF_CHUNK_SIZE
+#define MSH_PROF_CHUNK_SIZE 4096
+#endif
+
+#ifndef MSH_PROF_DISABLE
+#define MSH_PROF_BEGIN( name ) msh_prof_begin( name )
+#define MSH_PROF_END()         msh_prof_end()
+#define MSH_PROF_SCOPE( name ) \
+  for( int msh__prof_once = ( msh_prof_begin( name ), 1 ); msh__prof_once; msh__prof_once = ( msh_prof_end(), 0 ) )
+#else
+#define MSH_PROF_BEGIN( name )
+#define MSH_PROF_END()
+#define MSH_PROF_SCOPE( name )
+#endif
+
+typedef struct msh_prof_scope_stats
+{
+  const char* name;
+  size_t count;
+  double total_ms;
+  double min_ms;
+  double median_ms;
+  double p99_ms;
+  double max_ms;
+} msh_prof_scope_stats_t;
+
+MSH_PROF_DEF void msh_prof_init( void );
+MSH_PROF_DEF void msh_prof_begin( const char* name );
+MSH_PROF_DEF void msh_prof_end( void );
+MSH_PROF_DEF void msh_prof_set_thread_name( const char* name );
+MSH_PROF_DEF void msh_prof_reset( void );
+
+MSH_PROF_DEF size_t msh_prof_aggregate( msh_array(msh_prof_scope_stats_t)* stats );
+MSH_PROF_DEF void   msh_prof_print( FILE* fp );
+MSH_PROF_DEF int    msh_prof_write_chrome_trace( const char* filename );
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* MSH_PROF_H */
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+// IMPLEMENTATION
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+#ifdef MSH_PROF_IMPLEMENTATION
+
+#if !defined(MSH_PROF_NO_RDTSC) && ( defined(__x86_64__) || defined(__i386__) )
+#define MSH__PROF_RDTSC 1
+#include <x86intrin.h>
+#endif
+
+// Thread records and event chunks are tracked under "msh_prof" when msh_mem.h is included first.
+// They are kept until the program exits, so they show up in its leak report.
+#ifndef MSH_PROF_CALLOC
+#ifdef MSH_MEM_H
+#define MSH_PROF_CALLOC( count, size ) msh_mem_calloc( "msh_prof", count, size )
+#else
+#define MSH_PROF_CALLOC( count, size ) calloc( count, size )
+#endif
+#endif
+
+typedef struct msh__prof_event
+{
+  const char* name;
+  uint64_t begin;
+  uint64_t end;
+  uint32_t depth;
+} msh__prof_event_t;
+
+typedef struct msh__prof_chunk
+{
+  msh__prof_event_t events[MSH_PROF_CHUNK_SIZE];
+  uint32_t count;                       // published with release stores
+  struct msh__prof_chunk* next;         // published with release stores
+} msh__prof_chunk_t;
+
+typedef struct msh__prof_thread
+{
+  struct msh__prof_thread* next;
+  uint32_t id;
+  char name[32];
+  msh__prof_chunk_t* first;
+  msh__prof_chunk_t* last;
+
+  // Scopes that have begun, only accessed by the owning thread.
+  int depth;
+  const char* open_names[MSH_PROF_MAX_DEPTH];
+  uint64_t open_begins[MSH_PROF_MAX_DEPTH];
+} msh__prof_thread_t;
+
+static msh__prof_thread_t* msh__prof_threads = NULL;
+static uint32_t msh__prof_n_threads = 0;
+static uint64_t msh__prof_base_ticks = 0;
+static uint64_t msh__prof_base_ns = 0;
+static __thread msh__prof_thread_t* msh__prof_tls = NULL;
+
+static inline uint64_t
+msh__prof_ticks( void )
+{
+#ifdef MSH__PROF_RDTSC
+  return __rdtsc();
+#else
+  return msh_time_now();
+#endif
+}
+
+// Reads the clock and the ticks at the same moment, taking the clock before and after ticks.
+static void
+msh__prof_sample_clock( uint64_t* ticks, uint64_t* ns )
+{
+  uint64_t ns1 = msh_time_now();
+  *ticks = msh__prof_ticks();
+  uint64_t ns2 = msh_time_now();
+  *ns = ns1 + ( ns2 - ns1 ) / 2;
+}
+
+MSH_PROF_DEF void
+msh_prof_init( void )
+{
+  if( __atomic_load_n( &msh__prof_base_ns, __ATOMIC_ACQUIRE ) ) { return; }
+  uint64_t ticks, ns;
+  msh__prof_sample_clock( &ticks, &ns );   // first clock read may be slow
+  msh__prof_sample_clock( &ticks, &ns );
+  msh__prof_base_ticks = ticks;
+  __atomic_store_n( &msh__prof_base_ns, ns | 1, __ATOMIC_RELEASE );
+}
+
+static msh__prof_thread_t*
+msh__prof_register_thread( void )
+{
+  msh_prof_init();
+  msh__prof_thread_t* t = MSH_PROF_CALLOC( 1, sizeof(msh__prof_thread_t) );
+  t->first = t->last = MSH_PROF_CALLOC( 1, sizeof(msh__prof_chunk_t) );
+  t->id = __atomic_fetch_add( &msh__prof_n_threads, 1, __ATOMIC_RELAXED );
+  snprintf( t->name, sizeof(t->name), "thread %u", t->id );
+
+  // Lock-free push to the front of the global list; threads are never removed.
+  t->next = __atomic_load_n( &msh__prof_threads, __ATOMIC_RELAXED );
+  while( !__atomic_compare_exchange_n( &msh__prof_threads, &t->next, t, 1, __ATOMIC_RELEASE, __ATOMIC_RELAXED ) ) {}
+  msh__prof_tls = t;
+  return t;
+}
+
+MSH_PROF_DEF void
+msh_prof_begin( const char* name )
+{
+  msh__prof_thread_t* t = msh__prof_tls ? msh__prof_tls : msh__prof_register_thread();
+  int d = t->depth++;
+  if( d < MSH_PROF_MAX_DEPTH )
+  {
+    t->open_names[d] = name;
+    t->open_begins[d] = msh__prof_ticks();
+  }
+}
+
+MSH_PROF_DEF void
+msh_prof_end( void )
+{
+  uint64_t end = msh__prof_ticks();
+  msh__prof_thread_t* t = msh__prof_tls;
+  if( !t || t->depth == 0 ) { return; }
+  int d = --t->depth;
+  if( d >= MSH_PROF_MAX_DEPTH ) { return; }
+
+  msh__prof_chunk_t* c = t->last;
+  if( c->count == MSH_PROF_CHUNK_SIZE )
+  {
+    msh__prof_chunk_t* n = c->next ? c->next : MSH_PROF_CALLOC( 1, sizeof(msh__prof_chunk_t) );
+    __atomic_store_n( &c->next, n, __ATOMIC_RELEASE );
+    t->last = c = n;
+  }
+  msh__prof_event_t* e = &c->events[c->count];
+  e->name  = t->open_names[d];
+  e->begin = t->open_begins[d];
+  e->end   = end;
+  e->depth = (uint32_t)d;
+  __atomic_store_n( &c->count, c->count + 1, __ATOMIC_RELEASE );
+}
+
+MSH_PROF_DEF void
+msh_prof_set_thread_name( const char* name )
+{
+  msh__prof_thread_t* t = msh__prof_tls ? msh__prof_tls : msh__prof_register_thread();
+  snprintf( t->name, sizeof(t->name), "%s", name );
+}
+
+MSH_PROF_DEF void
+msh_prof_reset( void )
+{
+  // Chunks are kept for reuse, so that recording after a reset does not allocate.
+  msh__prof_thread_t* t = __atomic_load_n( &msh__prof_threads, __ATOMIC_ACQUIRE );
+  for( ; t; t = t->next )
+  {
+    for( msh__prof_chunk_t* c = t->first; c; c = c->next ) { __atomic_store_n( &c->count, 0, __ATOMIC_RELEASE ); }
+    t->last = t->first;
+  }
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+// Reporting
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+// Runs the code given as the last argument for every complete event e, with its thread t.
+#define MSH__PROF_FOR_EACH_EVENT( t, e, ... )                                                 \
+  for( msh__prof_thread_t* t = __atomic_load_n( &msh__prof_threads, __ATOMIC_ACQUIRE ); t;     \
+       t = t->next )                                                                          \
+  {                                                                                           \
+    for( msh__prof_chunk_t* c_ = t->first; c_; c_ = __atomic_load_n( &c_->next, __ATOMIC_ACQUIRE ) ) \
+    {                                                                                         \
+      uint32_t n_ = __atomic_load_n( &c_->count, __ATOMIC_ACQUIRE );                          \
+      for( uint32_t i_ = 0; i_ < n_; ++i_ )                                                   \
+      {                                                                                       \
+        const msh__prof_event_t* e = &c_->events[i_];                                         \
+        __VA_ARGS__                                                                           \
+      }                                                                                       \
+      if( n_ < MSH_PROF_CHUNK_SIZE ) { break; }                                               \
+    }                                                                                         \
+  }
+
+static double
+msh__prof_ms_per_tick( void )
+{
+#ifdef MSH__PROF_RDTSC
+  msh_prof_init();
+  // Calibration needs some time to pass since msh_prof_init.
+  uint64_t ns, ticks;
+  do { msh__prof_sample_clock( &ticks, &ns ); } while( ns - msh__prof_base_ns < 10000000 );
+  return ( ns - msh__prof_base_ns ) * 1e-6 / (double)( ticks - msh__prof_base_ticks );
+#else
+  return 1e-6;
+#endif
+}
+
+static uint64_t
+msh__prof_hash( const char* s )
+{
+  uint64_t h = 0xcbf29ce484222325ull;
+  while( *s ) { h = ( h ^ (uint8_t)*s++ ) * 0x100000001b3ull; }
+  return h;
+}
+
+MSH_PROF_DEF size_t
+msh_prof_aggregate( msh_array(msh_prof_scope_stats_t)* stats )
+{
+  msh_array_clear( *stats );
+  double ms_per_tick = msh__prof_ms_per_tick();
+
+  // Events are grouped by sorting hashes of their names, then durations are sorted per scope.
+  msh_array(uint64_t) hashes = NULL;
+  msh_array(uint32_t) order = NULL;
+  msh_array(uint64_t) ticks = NULL;
+  msh_array(const char*) names = NULL;
+  MSH__PROF_FOR_EACH_EVENT( t, e,
+  {
+    msh_array_push( order, (uint32_t)msh_array_len( hashes ) );
+    msh_array_push( hashes, msh__prof_hash( e->name ) );
+    msh_array_push( ticks, e->end - e->begin );
+    msh_array_push( names, e->name );
+    (void)t;
+  } )
+  size_t n = msh_array_len( hashes );
+  msh_radix_sort_u64( hashes, order, n );
+
+  msh_array(uint64_t) scope_ticks = NULL;
+  for( size_t i = 0; i < n; )
+  {
+    size_t j = i;
+    msh_array_clear( scope_ticks );
+    while( j < n && hashes[j] == hashes[i] ) { msh_array_push( scope_ticks, ticks[order[j]] ); j++; }
+    size_t count = j - i;
+    msh_radix_sort_u64( scope_ticks, NULL, count );
+    double total = 0.0;
+    for( size_t k = 0; k < count; ++k ) { total += (double)scope_ticks[k]; }
+    msh_prof_scope_stats_t s;
+    s.name      = names[order[i]];
+    s.count     = count;
+    s.total_ms  = total * ms_per_tick;
+    s.min_ms    = scope_ticks[0] * ms_per_tick;
+    s.median_ms = scope_ticks[count / 2] * ms_per_tick;
+    s.p99_ms    = scope_ticks[( count * 99 ) / 100] * ms_per_tick;
+    s.max_ms    = scope_ticks[count - 1] * ms_per_tick;
+    msh_array_push( *stats, s );
+    i = j;
+  }
+  msh_array_free( scope_ticks );
+  msh_array_free( hashes );
+  msh_array_free( order );
+  msh_array_free( ticks );
+  msh_array_free( names );
+
+  // Few scopes, so insertion sort by total time is enough.
+  msh_prof_scope_stats_t* s = *stats;
+  size_t n_scopes = msh_array_len( s );
+  for( size_t i = 1; i < n_scopes; ++i )
+  {
+    msh_prof_scope_stats_t v = s[i];
+    size_t k = i;
+    while( k > 0 && s[k - 1].total_ms < v.total_ms ) { s[k] = s[k - 1]; k--; }
+    s[k] = v;
+  }
+  return n_scopes;
+}
+
+MSH_PROF_DEF void
+msh_prof_print( FILE* fp )
+{
+  msh_array(msh_prof_scope_stats_t) stats = NULL;
+  size_t n = msh_prof_aggregate( &stats );
+  fprintf( fp, "%-32s %10s %12s %10s %10s %10s %10s\n", "scope", "count", "total ms",
+           "min ms", "median ms", "p99 ms", "max ms" );
+  for( size_t i = 0; i < n; ++i )
+  {
+    fprintf( fp, "%-32s %10zu %12.3f %10.4f %10.4f %10.4f %10.4f\n", stats[i].name, stats[i].count,
+             stats[i].total_ms, stats[i].min_ms, stats[i].median_ms, stats[i].p99_ms, stats[i].max_ms );
+  }
+  msh_array_free( stats );
+}
+
+static void
+msh__prof_write_json_string( FILE* fp, const char* s )
+{
+  fputc( '"', fp );
+  for( ; *s; ++s )
+  {
+    if( *s == '"' || *s == '\\' ) { fputc( '\\', fp ); fputc( *s, fp ); }
+    else if( (uint8_t)*s < 0x20 ) { fprintf( fp, "\\u%04x", *s ); }
+    else { fputc( *s, fp ); }
+  }
+  fputc( '"', fp );
+}
+
+MSH_PROF_DEF int
+msh_prof_write_chrome_trace( const char* filename )
+{
+  FILE* fp = fopen( filename, "w" );
+  if( !fp ) { return 0; }
+  double us_per_tick = 1000.0 * msh__prof_ms_per_tick();
+  int first = 1;
+  fprintf( fp, "{\"traceEvents\":[\n" );
+  for( msh__prof_thread_t* t = __atomic_load_n( &msh__prof_threads, __ATOMIC_ACQUIRE ); t; t = t->next )
+  {
+    fprintf( fp, "%s{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":%u,\"args\":{\"name\":",
+             first ? "" : ",\n", t->id );
+    msh__prof_write_json_string( fp, t->name );
+    fprintf( fp, "}}" );
+    first = 0;
+  }
+  MSH__PROF_FOR_EACH_EVENT( t, e,
+  {
+    fprintf( fp, "%s{\"name\":", first ? "" : ",\n" );
+    msh__prof_write_json_string( fp, e->name );
+    fprintf( fp, ",\"ph\":\"X\",\"pid\":1,\"tid\":%u,\"ts\":%.3f,\"dur\":%.3f}", t->id,
+             (double)( e->begin - msh__prof_base_ticks ) * us_per_tick,
+             (double)( e->end - e->begin ) * us_per_tick );
+    first = 0;
+  } )
+  fprintf( fp, "\n],\"displayTimeUnit\":\"ms\"}\n" );
+  int ok = !ferror( fp );
+  fclose( fp );
+  return ok;
+}
+
+#endif /* MSH_PROF_IMPLEMENTATION */
@@ -0,0 +1,329 @@
+/*
+  Author: Maciej Halber
+  Date : Oct 18, 2026
+  License: CC0
+
+  Compilation: gcc -std=c99 -O2 -I<path_to_msh_libraries> msh_prof_example.c -o msh_prof_example -lm -lpthread
+  Usage:       msh_prof_example [trace.json | --bench]
+  Description: This program showcases msh_prof.h, a profiler with named, nestable scopes. It:
+
+               1) Checks counts, nesting and statistics of recorded scopes, recording from several
+               threads at once, scopes nested deeper than supported, resetting, timing against
+               msh_time_now and the Chrome trace output.
+
+               2) Measures the cost of a scope, compared to timing a section by hand with two
+               msh_time_now calls.
+
+               3) Profiles msh_raster.h and msh_draw_batch.h, which record their stages as scopes
+               when msh_prof.h is included first, prints the report and optionally writes a
+               Chrome trace, which can be opened in chrome://tracing or https://ui.perfetto.dev.
+
+               Program returns non-zero if validation fails. With --bench, the cost of a scope is
+               measured with msh_bench.h instead.
+*/
+
+#define MSH_STD_INCLUDE_HEADERS
+#define MSH_STD_IMPLEMENTATION
+#define MSH_IMG_PROC_IMPLEMENTATION
+#define MSH_JOBS_IMPLEMENTATION
+#define MSH_SORT_IMPLEMENTATION
+#define MSH_PROF_IMPLEMENTATION
+#define MSH_TRIANGULATE_IMPLEMENTATION
+#define MSH_RASTER_IMPLEMENTATION
+#define MSH_DRAW_BATCH_IMPLEMENTATION
+#define MSH_BENCH_IMPLEMENTATION
+#include <pthread.h>
+#include "msh_std.h"
+#include "msh_img_proc.h"
+#include "msh_jobs.h"
+#include "msh_sort.h"
+#include "msh_prof.h"
+#include "msh_triangulate.h"
+#include "msh_raster.h"
+#include "msh_draw_batch.h"
+#include "msh_bench.h"
+
+enum { N_THREADS = 4, N_SCOPES_PER_THREAD = 10000 };
+
+void
+busy_wait_us( double us )
+{
+  uint64_t t1 = msh_time_now();
+  while( msh_time_diff( MSHT_MICROSECONDS, msh_time_now(), t1 ) < us ) {}
+}
+
+const msh_prof_scope_stats_t*
+find_scope( const msh_prof_scope_stats_t* stats, const char* name )
+{
+  for( size_t i = 0; i < msh_array_len( stats ); ++i )
+  {
+    if( !strcmp( stats[i].name, name ) ) { return &stats[i]; }
+  }
+  return NULL;
+}
+
+int
+check_ordered( const msh_prof_scope_stats_t* s )
+{
+  return s->min_ms <= s->median_ms && s->median_ms <= s->p99_ms && s->p99_ms <= s->max_ms &&
+         s->total_ms >= s->count * s->min_ms * 0.999 && s->total_ms <= s->count * s->max_ms * 1.001;
+}
+
+void*
+worker( void* arg )
+{
+  char name[32];
+  snprintf( name, sizeof(name), "worker %d", (int)(size_t)arg );
+  msh_prof_set_thread_name( name );
+  for( int i = 0; i < N_SCOPES_PER_THREAD; ++i )
+  {
+    MSH_PROF_SCOPE( "worker_item" )
+    {
+      if( i % 100 == 0 ) { MSH_PROF_SCOPE( "worker_nested" ) { busy_wait_us( 1 ); } }
+    }
+  }
+  return NULL;
+}
+
+size_t
+count_occurrences( const char* filename, const char* pattern )
+{
+  FILE* fp = fopen( filename, "rb" );
+  if( !fp ) { return 0; }
+  fseek( fp, 0, SEEK_END );
+  long size = ftell( fp );
+  fseek( fp, 0, SEEK_SET );
+  char* text = calloc( size + 1, 1 );
+  size_t n_read = fread( text, 1, size, fp );
+  fclose( fp );
+  size_t count = 0;
+  for( const char* p = text; n_read && ( p = strstr( p, pattern ) ); p += strlen( pattern ) ) { count++; }
+  int well_formed = !strncmp( text, "{\"traceEvents\":[", 16 ) && strstr( text, "]," ) && text[size - 2] == '}';
+  free( text );
+  return well_formed ? count : 0;
+}
+
+int
+validate( void )
+{
+  int n_failed = 0;
+  msh_array(msh_prof_scope_stats_t) stats = NULL;
+
+  // Nesting and statistics.
+  msh_prof_reset();
+  MSH_PROF_SCOPE( "outer" )
+  {
+    for( int i = 0; i < 10; ++i ) { MSH_PROF_SCOPE( "inner" ) { busy_wait_us( 20 * ( i + 1 ) ); } }
+  }
+  MSH_PROF_BEGIN( "unbalanced end is ignored" );
+  MSH_PROF_END();
+  MSH_PROF_END();
+  msh_prof_aggregate( &stats );
+  const msh_prof_scope_stats_t* outer = find_scope( stats, "outer" );
+  const msh_prof_scope_stats_t* inner = find_scope( stats, "inner" );
+  int ok = msh_array_len( stats ) == 3 && outer && inner && outer->count == 1 && inner->count == 10 &&
+           outer->total_ms >= inner->total_ms && check_ordered( inner ) && !strcmp( stats[0].name, "outer" ) &&
+           inner->min_ms >= 0.019 && inner->max_ms >= 0.199;
+  if( !ok ) { printf("  nesting and statistics: FAILED\n"); }
+  n_failed += !ok;
+
+  // Timing compared to msh_time_now.
+  msh_prof_reset();
+  uint64_t t1 = msh_time_now();
+  MSH_PROF_SCOPE( "timed" ) { busy_wait_us( 5000 ); }
+  uint64_t t2 = msh_time_now();
+  msh_prof_aggregate( &stats );
+  double expected = msh_time_diff( MSHT_MILLISECONDS, t2, t1 );
+  ok = msh_array_len( stats ) == 1 && fabs( stats[0].total_ms - expected ) < 0.05 * expected + 0.01;
+  if( !ok ) { printf("  timing, %f ms vs %f ms: FAILED\n", msh_array_len( stats ) ? stats[0].total_ms : 0.0, expected ); }
+  n_failed += !ok;
+
+  // Several threads, each filling more than one chunk.
+  msh_prof_reset();
+  pthread_t threads[N_THREADS];
+  for( int i = 0; i < N_THREADS; ++i ) { pthread_create( &threads[i], NULL, worker, (void*)(size_t)i ); }
+  for( int i = 0; i < N_THREADS; ++i ) { pthread_join( threads[i], NULL ); }
+  msh_prof_aggregate( &stats );
+  const msh_prof_scope_stats_t* item = find_scope( stats, "worker_item" );
+  const msh_prof_scope_stats_t* nested = find_scope( stats, "worker_nested" );
+  ok = item && nested && item->count == N_THREADS * N_SCOPES_PER_THREAD &&
+       nested->count == N_THREADS * N_SCOPES_PER_THREAD / 100 && check_ordered( item );
+  if( !ok ) { printf("  multiple threads: FAILED\n"); }
+  n_failed += !ok;
+
+  // Scopes deeper than MSH_PROF_MAX_DEPTH are dropped, the rest still balance.
+  msh_prof_reset();
+  for( int i = 0; i < MSH_PROF_MAX_DEPTH + 10; ++i ) { MSH_PROF_BEGIN( "deep" ); }
+  for( int i = 0; i < MSH_PROF_MAX_DEPTH + 10; ++i ) { MSH_PROF_END(); }
+  MSH_PROF_SCOPE( "after" ) {}
+  msh_prof_aggregate( &stats );
+  ok = msh_array_len( stats ) == 2 && find_scope( stats, "deep" )->count == MSH_PROF_MAX_DEPTH &&
+       find_scope( stats, "after" )->count == 1;
+  if( !ok ) { printf("  depth limit: FAILED\n"); }
+  n_failed += !ok;
+
+  // Chrome trace has one complete event per scope, and metadata for each thread.
+  const char* filename = "msh_prof_example_validation.json";
+  ok = msh_prof_write_chrome_trace( filename ) &&
+       count_occurrences( filename, "\"ph\":\"X\"" ) == MSH_PROF_MAX_DEPTH + 1 &&
+       count_occurrences( filename, "\"ph\":\"M\"" ) == N_THREADS + 1;
+  remove( filename );
+  if( !ok ) { printf("  chrome trace: FAILED\n"); }
+  n_failed += !ok;
+
+  msh_prof_reset();
+  msh_prof_aggregate( &stats );
+  ok = msh_array_len( stats ) == 0;
+  if( !ok ) { printf("  reset: FAILED\n"); }
+  n_failed += !ok;
+
+  msh_array_free( stats );
+  return n_failed;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+// Benchmarks, run with --bench
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+// Recorded scopes are dropped at the start of every trial, so that memory does not grow with the
+// calibrated iteration count.
+void bench_scope( void* data, size_t n_iters )
+{
+  (void)data;
+  msh_prof_reset();
+  for( size_t it = 0; it < n_iters; ++it ) { MSH_PROF_SCOPE( "bench" ) { MSH_BENCH_CLOBBER(); } }
+}
+
+void bench_nested_scopes( void* data, size_t n_iters )
+{
+  (void)data;
+  msh_prof_reset();
+  for( size_t it = 0; it < n_iters; ++it )
+  {
+    MSH_PROF_SCOPE( "outer" ) { MSH_PROF_SCOPE( "inner" ) { MSH_BENCH_CLOBBER(); } }
+  }
+}
+
+void bench_time_now_pair( void* data, size_t n_iters )
+{
+  (void)data;
+  for( size_t it = 0; it < n_iters; ++it )
+  {
+    uint64_t a = msh_time_now();
+    MSH_BENCH_CLOBBER();
+    uint64_t b = msh_time_now();
+    uint64_t d = b - a;
+    MSH_BENCH_DO_NOT_OPTIMIZE( d );
+  }
+}
+
+int run_benchmarks( int argc, char** argv )
+{
+  msh_prof_init();
+  msh_bench_t* b = msh_bench_create( argc, argv );
+  msh_bench_add( b, "msh_prof scope", bench_scope, NULL, 1 );
+  msh_bench_add( b, "msh_prof nested scopes", bench_nested_scopes, NULL, 2 );
+  msh_bench_add( b, "two msh_time_now", bench_time_now_pair, NULL, 1 );
+  int n_regressions = msh_bench_run( b );
+  msh_bench_destroy( b );
+  msh_prof_reset();
+  return n_regressions ? 1 : 0;
+}
+
+int main( int argc, char** argv )
+{
+  if( msh_bench_requested( argc, argv ) ) { return run_benchmarks( argc, argv ); }
+  int n_failed = 0;
+  msh_prof_init();
+  msh_prof_set_thread_name( "main" );
+
+  //----------------------------------------------------------------------------------------------
+  printf("Validation:\n");
+  {
+    n_failed += validate();
+    printf("  %d/6 cases passed\n", 6 - n_failed );
+  }
+
+  //----------------------------------------------------------------------------------------------
+  enum { N_ITERS = 1000000 };
+  printf("Cost per scope (%d scopes):\n", N_ITERS );
+  {
+    volatile uint64_t sink = 0;
+    msh_prof_reset();
+    uint64_t t1 = msh_time_now();
+    for( int i = 0; i < N_ITERS; ++i ) { MSH_PROF_SCOPE( "empty" ) { sink += i; } }
+    uint64_t t2 = msh_time_now();
+    for( int i = 0; i < N_ITERS; ++i )
+    {
+      uint64_t a = msh_time_now();
+      sink += i;
+      uint64_t b = msh_time_now();
+      sink += b - a;
+    }
+    uint64_t t3 = msh_time_now();
+    printf("  msh_prof scope:       %6.1f ns\n", msh_time_diff( MSHT_NANOSECONDS, t2, t1 ) / N_ITERS );
+    printf("  two msh_time_now:     %6.1f ns\n", msh_time_diff( MSHT_NANOSECONDS, t3, t2 ) / N_ITERS );
+    msh_prof_reset();
+  }
+
+  //----------------------------------------------------------------------------------------------
+  printf("Profile of msh_raster and msh_draw_batch:\n");
+  {
+    msh_jobs_t* jobs = msh_jobs_create( -1 );
+    msh_rand_ctx_t rand_gen = {0};
+    msh_rand_init( &rand_gen, 12346 );
+    enum { N_TRIS = 100000 };
+    float* xy = malloc( 6 * N_TRIS * sizeof(float) );
+    uint32_t* colors = malloc( 3 * N_TRIS * sizeof(uint32_t) );
+    int* indices = malloc( 3 * N_TRIS * sizeof(int) );
+    for( int i = 0; i < N_TRIS; ++i )
+    {
+      float cx = msh_rand_nextf( &rand_gen ) * 1280.0f, cy = msh_rand_nextf( &rand_gen ) * 720.0f;
+      for( int k = 0; k < 3; ++k )
+      {
+        xy[6 * i + 2 * k + 0] = cx + ( msh_rand_nextf( &rand_gen ) - 0.5f ) * 20.0f;
+        xy[6 * i + 2 * k + 1] = cy + ( msh_rand_nextf( &rand_gen ) - 0.5f ) * 20.0f;
+        colors[3 * i + k] = MSH_DRAW_RGBA( 255, 128, 0, 128 );
+        indices[3 * i + k] = 3 * i + k;
+      }
+    }
+    msh_img_ui8_t img = mship_img_ui8_init( 1280, 720, 4, 1 );
+    msh_raster_t* r = msh_raster_create();
+    msh_draw_cmdbuf_t* cb = msh_draw_cmdbuf_create( 0 );
+    for( int frame = 0; frame < 20; ++frame )
+    {
+      MSH_PROF_SCOPE( "frame" )
+      {
+        MSH_PROF_SCOPE( "record" )
+        {
+          msh_raster_reset( r );
+          msh_raster_triangles( r, xy, NULL, N_TRIS, MSH_RASTER_RGBA( 255, 128, 0, 128 ) );
+          msh_draw_cmdbuf_reset( cb );
+          for( int i = 0; i < N_TRIS; i += 100 )
+          {
+            uint32_t key = MSH_DRAW_STATE_KEY( 0, MSH_DRAW_BLEND_ALPHA, ( i / 100 ) & 7 );
+            msh_draw_triangles( cb, key, xy + 6 * i, colors + 3 * i, 300, indices, 300 );
+          }
+        }
+        msh_raster_render( r, &img, jobs );
+        msh_draw_cmdbuf_build( cb );
+      }
+    }
+    msh_prof_print( stdout );
+    if( argc > 1 )
+    {
+      if( msh_prof_write_chrome_trace( argv[1] ) ) { printf("  trace written to %s\n", argv[1] ); }
+      else { printf("  could not write %s\n", argv[1] ); n_failed++; }
+    }
+    msh_draw_cmdbuf_destroy( cb );
+    msh_raster_destroy( r );
+    mship_img_ui8_free( &img );
+    free( xy );
+    free( colors );
+    free( indices );
+    msh_jobs_destroy( jobs );
+  }
+
+  printf("%d failed\n", n_failed );
+  return n_failed ? 1 : 0;
+}
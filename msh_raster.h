@@ -0,0 +1,582 @@
+/*
+  ==============================================================================
+
+  MSH_RASTER.H v0.1
+
+  A single header library for drawing 2D geometry into images on the CPU, without a GPU or a
+  GL context, e.g. for previews and thumbnails on headless machines:
+
+    - filled triangles (such as msh_cutouts or msh_triangulate output), polygons with holes and
+      polylines with a given width
+    - tile binning, with tiles rasterized in parallel on a job system
+    - integer edge functions, evaluated for 8 pixels at a time with AVX2
+    - deterministic output, bit exact for any number of threads and code path
+    - binning and tile drawing show up as msh_prof.h scopes, if it is included first
+
+  To use the library you simply add:
+
+  #include "msh_std.h"
+  #include "msh_img_proc.h"
+  #include "msh_jobs.h"
+  #include "msh_sort.h"
+  #include "msh_triangulate.h"
+  #define MSH_RASTER_IMPLEMENTATION
+  #include "msh_raster.h"
+
+  msh_img_proc.h defines the image types, msh_jobs.h the job system, and msh_triangulate.h (with
+  msh_sort.h) is used to fill polygons. They need to be included first.
+
+  ==============================================================================
+  DOCUMENTATION
+
+  Recording
+    msh_raster_t* r = msh_raster_create();
+    msh_raster_triangles( r, path.vertices, tris, n_tris, MSH_RASTER_RGBA( 128, 128, 143, 255 ) );
+    msh_raster_fill( r, xy, contour_counts, n_contours, color );
+    msh_raster_stroke( r, xy, n_points, closed, width, color );
+    ...
+    msh_raster_destroy( r );
+
+    Commands are recorded as triangles, in order, and kept until msh_raster_reset. Positions
+    are in pixels, with (0, 0) at the top left corner of the first pixel, and are snapped to
+    1/16th of a pixel. msh_raster_triangles takes interleaved x and y floats and three indices
+    per triangle (or NULL, for consecutive vertices). msh_raster_fill triangulates a polygon
+    with holes, laid out as in msh_triangulate_polygon_holes. msh_raster_stroke draws segments
+    as quads with mitered joins, so that consecutive segments do not overlap. Colors are
+    non-premultiplied RGBA, packed with MSH_RASTER_RGBA.
+
+  Rendering
+    msh_raster_render( r, &img, jobs );   // jobs may be NULL
+
+    Draws recorded triangles over an 8 bit RGB or RGBA image, blending with "source over". A
+    pixel is covered if its center is inside a triangle; pixels on an edge shared by two
+    triangles are covered by exactly one of them, so fills and strokes are blended once per
+    pixel. There is no antialiasing.
+
+    Triangles are binned into MSH_RASTER_TILE_SIZE (64) pixel square tiles, keeping the order
+    of submission within each tile, and tiles are drawn independently in parallel. Edge
+    functions are evaluated in 64 bit integers once per triangle and tile, and, unless they do
+    not fit, stepped in 32 bit across pixels. All arithmetic, including blending, is integer,
+    so the result is the same regardless of threads or SIMD (AVX2 with -mavx2, or define
+    MSH_RASTER_NO_SIMD), and can be compared to golden images.
+
+  Statistics
+    msh_raster_stats_t stats = msh_raster_get_stats( r );
+
+    Number of triangles, tile references created by binning and time spent binning and drawing
+    in the last msh_raster_render call.
+
+  ==============================================================================
+  AUTHORS:
+    Maciej Halber
+
+  LICENSE:
+    CC0
+  ==============================================================================
+*/
+
+#ifndef MSH_RASTER_H
+#define MSH_RASTER_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#ifndef MSH_RASTER_DEF
+#ifdef MSH_RASTER_STATIC
+#define MSH_RASTER_DEF static
+#else
+#define MSH_RASTER_DEF extern
+#endif
+#endif
+
+#ifndef MSH_RASTER_TILE_SIZE
+#define MSH_RASTER_TILE_SIZE 64
+#endif
+
+#define MSH_RASTER_RGBA( r, g, b, a ) \
+  ( (uint32_t)(r) | ( (uint32_t)(g) << 8 ) | ( (uint32_t)(b) << 16 ) | ( (uint32_t)(a) << 24 ) )
+
+typedef struct msh_raster msh_raster_t;
+
+typedef struct msh_raster_stats
+{
+  size_t n_triangles;
+  size_t n_tile_refs;
+  double bin_ms;
+  double draw_ms;
+} msh_raster_stats_t;
+
+MSH_RASTER_DEF msh_raster_t* msh_raster_create( void );
+MSH_RASTER_DEF void          msh_raster_destroy( msh_raster_t* r );
+MSH_RASTER_DEF void          msh_raster_reset( msh_raster_t* r );
+
+MSH_RASTER_DEF void msh_raster_triangles( msh_raster_t* r, const float* xy, const int* indices, int n_tris,
+                                          uint32_t color );
+MSH_RASTER_DEF void msh_raster_fill( msh_raster_t* r, const float* xy, const int* contour_counts,
+                                     int n_contours, uint32_t color );
+MSH_RASTER_DEF void msh_raster_stroke( msh_raster_t* r, const float* xy, int n_points, int closed,
+                                       float width, uint32_t color );
+
+MSH_RASTER_DEF void msh_raster_render( msh_raster_t* r, msh_img_ui8_t* img, msh_jobs_t* jobs );
+MSH_RASTER_DEF msh_raster_stats_t msh_raster_get_stats( const msh_raster_t* r );
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* MSH_RASTER_H */
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+// IMPLEMENTATION
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+#ifdef MSH_RASTER_IMPLEMENTATION
+
+#include <math.h>
+
+#if !defined(MSH_RASTER_NO_SIMD) && defined(__AVX2__)
+#define MSH__RASTER_AVX2 1
+#include <immintrin.h>
+#endif
+
+// Stages are recorded as profiler scopes when msh_prof.h is included first.
+#ifdef MSH_PROF_H
+#define MSH__RASTER_PROF_BEGIN( name ) MSH_PROF_BEGIN( name )
+#define MSH__RASTER_PROF_END()         MSH_PROF_END()
+#else
+#define MSH__RASTER_PROF_BEGIN( name )
+#define MSH__RASTER_PROF_END()
+#endif
+
+// Rasterizers are tracked under "msh_raster" when msh_mem.h is included first. Their arrays
+// are msh_arrays, tracked only with MSH_MEM_OVERRIDE.
+#ifndef MSH_RASTER_CALLOC
+#ifdef MSH_MEM_H
+#define MSH_RASTER_CALLOC( count, size ) msh_mem_calloc( "msh_raster", count, size )
+#define MSH_RASTER_FREE( ptr )           msh_mem_free( ptr )
+#else
+#define MSH_RASTER_CALLOC( count, size ) calloc( count, size )
+#define MSH_RASTER_FREE( ptr )           free( ptr )
+#endif
+#endif
+
+#define MSH__RASTER_SUBPIXEL_BITS 4
+#define MSH__RASTER_ONE ( 1 << MSH__RASTER_SUBPIXEL_BITS )
+
+// Vertices in fixed point, ordered so that edge functions are positive inside.
+typedef struct msh__raster_tri
+{
+  int32_t x[3], y[3];
+  uint32_t color;
+} msh__raster_tri_t;
+
+struct msh_raster
+{
+  msh_array(msh__raster_tri_t) tris;
+  msh_array(int) fill_indices;
+  msh_array(float) stroke_xy;
+  msh_array(float) stroke_offsets;
+
+  msh_array(uint32_t) tile_offsets;
+  msh_array(uint32_t) tile_refs;
+  msh_raster_stats_t stats;
+};
+
+MSH_RASTER_DEF msh_raster_t*
+msh_raster_create( void )
+{
+  return MSH_RASTER_CALLOC( 1, sizeof(msh_raster_t) );
+}
+
+MSH_RASTER_DEF void
+msh_raster_destroy( msh_raster_t* r )
+{
+  if( !r ) { return; }
+  msh_array_free( r->tris );
+  msh_array_free( r->fill_indices );
+  msh_array_free( r->stroke_xy );
+  msh_array_free( r->stroke_offsets );
+  msh_array_free( r->tile_offsets );
+  msh_array_free( r->tile_refs );
+  MSH_RASTER_FREE( r );
+}
+
+MSH_RASTER_DEF void
+msh_raster_reset( msh_raster_t* r )
+{
+  msh_array_clear( r->tris );
+}
+
+MSH_RASTER_DEF msh_raster_stats_t
+msh_raster_get_stats( const msh_raster_t* r )
+{
+  return r->stats;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+// Recording
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+static inline int32_t
+msh__raster_to_fixed( float v )
+{
+  // Clamped so that edge function products stay within 64 bits.
+  v = msh_clamp( v * (float)MSH__RASTER_ONE, -1e9f, 1e9f );
+  return (int32_t)lrintf( v );
+}
+
+static void
+msh__raster_push_tri( msh_raster_t* r, const float* a, const float* b, const float* c, uint32_t color )
+{
+  msh__raster_tri_t t;
+  t.x[0] = msh__raster_to_fixed( a[0] ); t.y[0] = msh__raster_to_fixed( a[1] );
+  t.x[1] = msh__raster_to_fixed( b[0] ); t.y[1] = msh__raster_to_fixed( b[1] );
+  t.x[2] = msh__raster_to_fixed( c[0] ); t.y[2] = msh__raster_to_fixed( c[1] );
+  int64_t area = (int64_t)( t.x[1] - t.x[0] ) * ( t.y[2] - t.y[0] ) - (int64_t)( t.y[1] - t.y[0] ) * ( t.x[2] - t.x[0] );
+  if( area == 0 || ( color >> 24 ) == 0 ) { return; }
+  if( area < 0 )
+  {
+    int32_t tx = t.x[1], ty = t.y[1];
+    t.x[1] = t.x[2]; t.y[1] = t.y[2];
+    t.x[2] = tx;     t.y[2] = ty;
+  }
+  t.color = color;
+  msh_array_push( r->tris, t );
+}
+
+MSH_RASTER_DEF void
+msh_raster_triangles( msh_raster_t* r, const float* xy, const int* indices, int n_tris, uint32_t color )
+{
+  msh_array_fit( r->tris, msh_array_len( r->tris ) + n_tris );
+  for( int i = 0; i < n_tris; ++i )
+  {
+    int a = indices ? indices[3 * i + 0] : 3 * i + 0;
+    int b = indices ? indices[3 * i + 1] : 3 * i + 1;
+    int c = indices ? indices[3 * i + 2] : 3 * i + 2;
+    msh__raster_push_tri( r, xy + 2 * a, xy + 2 * b, xy + 2 * c, color );
+  }
+}
+
+MSH_RASTER_DEF void
+msh_raster_fill( msh_raster_t* r, const float* xy, const int* contour_counts, int n_contours, uint32_t color )
+{
+  msh_array_clear( r->fill_indices );
+  int n_tris = msh_triangulate_polygon_holes( xy, contour_counts, n_contours, &r->fill_indices );
+  msh_raster_triangles( r, xy, r->fill_indices, n_tris, color );
+}
+
+MSH_RASTER_DEF void
+msh_raster_stroke( msh_raster_t* r, const float* xy, int n_points, int closed, float width, uint32_t color )
+{
+  // Drop repeated points, so that every segment has a direction.
+  msh_array_clear( r->stroke_xy );
+  for( int i = 0; i < n_points; ++i )
+  {
+    size_t len = msh_array_len( r->stroke_xy );
+    if( len && r->stroke_xy[len - 2] == xy[2 * i] && r->stroke_xy[len - 1] == xy[2 * i + 1] ) { continue; }
+    msh_array_push( r->stroke_xy, xy[2 * i + 0] );
+    msh_array_push( r->stroke_xy, xy[2 * i + 1] );
+  }
+  const float* pts = r->stroke_xy;
+  int n = (int)msh_array_len( pts ) / 2;
+  if( closed && n > 2 && pts[0] == pts[2 * n - 2] && pts[1] == pts[2 * n - 1] ) { n--; }
+  if( n < 2 ) { return; }
+  if( n < 3 ) { closed = 0; }
+
+  // Left and right offsets of every point, along the miter of the adjacent segment normals.
+  msh_array_fit( r->stroke_offsets, 4 * (size_t)n );
+  float* off = r->stroke_offsets;
+  float hw = 0.5f * width;
+  for( int i = 0; i < n; ++i )
+  {
+    int has_prev = closed || i > 0, has_next = closed || i < n - 1;
+    int ip = ( i + n - 1 ) % n, in = ( i + 1 ) % n;
+    float nx = 0.0f, ny = 0.0f, px = 0.0f, py = 0.0f;
+    if( has_prev )
+    {
+      float dx = pts[2 * i] - pts[2 * ip], dy = pts[2 * i + 1] - pts[2 * ip + 1];
+      float len = sqrtf( dx * dx + dy * dy );
+      px = -dy / len; py = dx / len;
+    }
+    if( has_next )
+    {
+      float dx = pts[2 * in] - pts[2 * i], dy = pts[2 * in + 1] - pts[2 * i + 1];
+      float len = sqrtf( dx * dx + dy * dy );
+      nx = -dy / len; ny = dx / len;
+    }
+    if( !has_prev ) { px = nx; py = ny; }
+    if( !has_next ) { nx = px; ny = py; }
+    float mx = px + nx, my = py + ny;
+    float mlen = sqrtf( mx * mx + my * my );
+    float scale = hw;
+    if( mlen > 1e-6f )
+    {
+      mx /= mlen; my /= mlen;
+      float cos_half = mx * nx + my * ny;
+      scale = hw / msh_max( cos_half, 0.25f );   // miter limit of 4
+    }
+    else { mx = nx; my = ny; }
+    off[4 * i + 0] = pts[2 * i + 0] + mx * scale;
+    off[4 * i + 1] = pts[2 * i + 1] + my * scale;
+    off[4 * i + 2] = pts[2 * i + 0] - mx * scale;
+    off[4 * i + 3] = pts[2 * i + 1] - my * scale;
+  }
+  int n_segments = closed ? n : n - 1;
+  msh_array_fit( r->tris, msh_array_len( r->tris ) + 2 * n_segments );
+  for( int i = 0; i < n_segments; ++i )
+  {
+    const float* a = off + 4 * i;
+    const float* b = off + 4 * ( ( i + 1 ) % n );
+    msh__raster_push_tri( r, a, b, b + 2, color );
+    msh__raster_push_tri( r, a, b + 2, a + 2, color );
+  }
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+// Rendering
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+static inline int32_t
+msh__raster_floor_div( int64_t v, int32_t d )
+{
+  return (int32_t)( v >= 0 ? v / d : -( ( -v + d - 1 ) / d ) );
+}
+
+// Source over with non-premultiplied colors, in integers; x / 255 rounded is computed as
+// ( x + 128 + ( ( x + 128 ) >> 8 ) ) >> 8.
+static inline uint8_t
+msh__raster_blend( uint32_t src, uint32_t dst, uint32_t alpha )
+{
+  uint32_t v = src * alpha + dst * ( 255 - alpha ) + 128;
+  return (uint8_t)( ( v + ( v >> 8 ) ) >> 8 );
+}
+
+static inline void
+msh__raster_blend_pixel( uint8_t* p, int n_comp, uint32_t color )
+{
+  uint32_t a = color >> 24;
+  p[0] = msh__raster_blend( color & 0xFF, p[0], a );
+  p[1] = msh__raster_blend( ( color >> 8 ) & 0xFF, p[1], a );
+  p[2] = msh__raster_blend( ( color >> 16 ) & 0xFF, p[2], a );
+  if( n_comp == 4 ) { p[3] = msh__raster_blend( 255, p[3], a ); }
+}
+
+typedef struct msh__raster_render
+{
+  const msh_raster_t* r;
+  msh_img_ui8_t* img;
+  int tiles_x;
+} msh__raster_render_t;
+
+// Edge a->b at a pixel center, E = (xb - xa)(py - ya) - (yb - ya)(px - xa), positive inside.
+// Pixels exactly on an edge belong to the triangle for which the edge points up, or right if
+// horizontal; the neighbor sharing the edge sees it reversed.
+typedef struct msh__raster_edge
+{
+  int64_t e0, dx, dy;
+} msh__raster_edge_t;
+
+static inline msh__raster_edge_t
+msh__raster_edge_setup( int32_t xa, int32_t ya, int32_t xb, int32_t yb, int px, int py )
+{
+  msh__raster_edge_t e;
+  int64_t cx = (int64_t)px * MSH__RASTER_ONE + MSH__RASTER_ONE / 2;
+  int64_t cy = (int64_t)py * MSH__RASTER_ONE + MSH__RASTER_ONE / 2;
+  e.dx = -(int64_t)( yb - ya ) * MSH__RASTER_ONE;
+  e.dy = (int64_t)( xb - xa ) * MSH__RASTER_ONE;
+  e.e0 = (int64_t)( xb - xa ) * ( cy - ya ) - (int64_t)( yb - ya ) * ( cx - xa );
+  int owns = ( yb < ya ) || ( yb == ya && xb > xa );
+  if( !owns ) { e.e0 -= 1; }
+  return e;
+}
+
+static void
+msh__raster_tile( const msh__raster_render_t* rd, size_t tile )
+{
+  const msh_raster_t* r = rd->r;
+  msh_img_ui8_t* img = rd->img;
+  int n_comp = img->n_comp;
+  int tx0 = (int)( tile % rd->tiles_x ) * MSH_RASTER_TILE_SIZE;
+  int ty0 = (int)( tile / rd->tiles_x ) * MSH_RASTER_TILE_SIZE;
+  int tx1 = msh_min( tx0 + MSH_RASTER_TILE_SIZE, img->width ) - 1;
+  int ty1 = msh_min( ty0 + MSH_RASTER_TILE_SIZE, img->height ) - 1;
+
+  for( uint32_t k = r->tile_offsets[tile]; k < r->tile_offsets[tile + 1]; ++k )
+  {
+    const msh__raster_tri_t* t = &r->tris[r->tile_refs[k]];
+    int32_t min_x = msh_min( t->x[0], msh_min( t->x[1], t->x[2] ) ), max_x = msh_max( t->x[0], msh_max( t->x[1], t->x[2] ) );
+    int32_t min_y = msh_min( t->y[0], msh_min( t->y[1], t->y[2] ) ), max_y = msh_max( t->y[0], msh_max( t->y[1], t->y[2] ) );
+    int x0 = msh_max( tx0, msh__raster_floor_div( min_x, MSH__RASTER_ONE ) );
+    int x1 = msh_min( tx1, msh__raster_floor_div( max_x, MSH__RASTER_ONE ) );
+    int y0 = msh_max( ty0, msh__raster_floor_div( min_y, MSH__RASTER_ONE ) );
+    int y1 = msh_min( ty1, msh__raster_floor_div( max_y, MSH__RASTER_ONE ) );
+    if( x0 > x1 || y0 > y1 ) { continue; }
+
+    // Edges at the top left pixel of the triangle's box within the tile. Edges that hold over
+    // the whole box are dropped, and the triangle is skipped if one fails everywhere.
+    msh__raster_edge_t edges[3];
+    int n_edges = 0, outside = 0, fits_32 = 1;
+    for( int i = 0; i < 3 && !outside; ++i )
+    {
+      int j = ( i + 1 ) % 3;
+      msh__raster_edge_t e = msh__raster_edge_setup( t->x[i], t->y[i], t->x[j], t->y[j], x0, y0 );
+      int64_t span_x = e.dx * ( x1 - x0 ), span_y = e.dy * ( y1 - y0 );
+      int64_t e_min = e.e0 + msh_min( span_x, 0 ) + msh_min( span_y, 0 );
+      int64_t e_max = e.e0 + msh_max( span_x, 0 ) + msh_max( span_y, 0 );
+      if( e_max < 0 )  { outside = 1; }
+      else if( e_min < 0 )
+      {
+        // Stepped in 32 bits below, including the 8 pixel groups overhanging the box.
+        int64_t limit = (int64_t)1 << 30;
+        int64_t pad = 8 * ( e.dx < 0 ? -e.dx : e.dx );
+        fits_32 &= e_min - pad > -limit && e_max + pad < limit;
+        edges[n_edges++] = e;
+      }
+    }
+    if( outside ) { continue; }
+
+    uint32_t color = t->color;
+#if MSH__RASTER_AVX2
+    if( fits_32 && n_comp == 4 )
+    {
+      __m256i lane = _mm256_setr_epi32( 0, 1, 2, 3, 4, 5, 6, 7 );
+      __m256i zero = _mm256_setzero_si256();
+      uint32_t a = color >> 24;
+      // Per channel src * alpha + 128, and 255 - alpha, for 16 bit lanes of two pixels.
+      __m256i src_term = _mm256_setr_epi16( (short)( ( color & 0xFF ) * a + 128 ), (short)( ( ( color >> 8 ) & 0xFF ) * a + 128 ),
+                                            (short)( ( ( color >> 16 ) & 0xFF ) * a + 128 ), (short)( 255 * a + 128 ),
+                                            (short)( ( color & 0xFF ) * a + 128 ), (short)( ( ( color >> 8 ) & 0xFF ) * a + 128 ),
+                                            (short)( ( ( color >> 16 ) & 0xFF ) * a + 128 ), (short)( 255 * a + 128 ),
+                                            (short)( ( color & 0xFF ) * a + 128 ), (short)( ( ( color >> 8 ) & 0xFF ) * a + 128 ),
+                                            (short)( ( ( color >> 16 ) & 0xFF ) * a + 128 ), (short)( 255 * a + 128 ),
+                                            (short)( ( color & 0xFF ) * a + 128 ), (short)( ( ( color >> 8 ) & 0xFF ) * a + 128 ),
+                                            (short)( ( ( color >> 16 ) & 0xFF ) * a + 128 ), (short)( 255 * a + 128 ) );
+      __m256i inv_alpha = _mm256_set1_epi16( (short)( 255 - a ) );
+      __m256i opaque = _mm256_set1_epi32( (int)( color | 0xFF000000u ) );
+      __m256i row_e[3], step_x[3];
+      for( int i = 0; i < 3; ++i )
+      {
+        // Missing edges hold everywhere.
+        int32_t e0 = i < n_edges ? (int32_t)edges[i].e0 : 0, dx = i < n_edges ? (int32_t)edges[i].dx : 0;
+        row_e[i] = _mm256_add_epi32( _mm256_set1_epi32( e0 ), _mm256_mullo_epi32( lane, _mm256_set1_epi32( dx ) ) );
+        step_x[i] = _mm256_set1_epi32( 8 * dx );
+      }
+      for( int y = y0; y <= y1; ++y )
+      {
+        uint8_t* row = img->data + ( (size_t)y * img->width ) * 4;
+        __m256i e[3] = { row_e[0], row_e[1], row_e[2] };
+        for( int x = x0; x <= x1; x += 8 )
+        {
+          __m256i inside = _mm256_or_si256( _mm256_or_si256( e[0], e[1] ), e[2] );
+          __m256i in_box = _mm256_cmpgt_epi32( _mm256_set1_epi32( x1 - x + 1 ), lane );
+          __m256i mask = _mm256_andnot_si256( _mm256_srai_epi32( inside, 31 ), in_box );
+          if( !_mm256_testz_si256( mask, mask ) )
+          {
+            int* p = (int*)( row + 4 * x );
+            __m256i out;
+            if( a == 255 ) { out = opaque; }
+            else
+            {
+              __m256i dst = _mm256_maskload_epi32( p, mask );
+              __m256i lo = _mm256_add_epi16( src_term, _mm256_mullo_epi16( _mm256_unpacklo_epi8( dst, zero ), inv_alpha ) );
+              __m256i hi = _mm256_add_epi16( src_term, _mm256_mullo_epi16( _mm256_unpackhi_epi8( dst, zero ), inv_alpha ) );
+              lo = _mm256_srli_epi16( _mm256_add_epi16( lo, _mm256_srli_epi16( lo, 8 ) ), 8 );
+              hi = _mm256_srli_epi16( _mm256_add_epi16( hi, _mm256_srli_epi16( hi, 8 ) ), 8 );
+              out = _mm256_packus_epi16( lo, hi );
+            }
+            _mm256_maskstore_epi32( p, mask, out );
+          }
+          for( int i = 0; i < 3; ++i ) { e[i] = _mm256_add_epi32( e[i], step_x[i] ); }
+        }
+        for( int i = 0; i < n_edges; ++i ) { row_e[i] = _mm256_add_epi32( row_e[i], _mm256_set1_epi32( (int32_t)edges[i].dy ) ); }
+      }
+      continue;
+    }
+#endif
+    (void)fits_32;
+    for( int y = y0; y <= y1; ++y )
+    {
+      uint8_t* row = img->data + ( (size_t)y * img->width ) * n_comp;
+      int64_t e[3] = { 0, 0, 0 };
+      for( int i = 0; i < n_edges; ++i ) { e[i] = edges[i].e0 + edges[i].dy * ( y - y0 ); }
+      for( int x = x0; x <= x1; ++x )
+      {
+        if( ( e[0] | e[1] | e[2] ) >= 0 ) { msh__raster_blend_pixel( row + n_comp * x, n_comp, color ); }
+        for( int i = 0; i < n_edges; ++i ) { e[i] += edges[i].dx; }
+      }
+    }
+  }
+}
+
+static void
+msh__raster_tile_job( void* data, size_t start, size_t end )
+{
+  MSH__RASTER_PROF_BEGIN( "msh_raster_tiles" );
+  for( size_t tile = start; tile < end; ++tile ) { msh__raster_tile( (const msh__raster_render_t*)data, tile ); }
+  MSH__RASTER_PROF_END();
+}
+
+MSH_RASTER_DEF void
+msh_raster_render( msh_raster_t* r, msh_img_ui8_t* img, msh_jobs_t* jobs )
+{
+  uint64_t t1 = msh_time_now();
+  MSH__RASTER_PROF_BEGIN( "msh_raster_bin" );
+  int tiles_x = ( img->width + MSH_RASTER_TILE_SIZE - 1 ) / MSH_RASTER_TILE_SIZE;
+  int tiles_y = ( img->height + MSH_RASTER_TILE_SIZE - 1 ) / MSH_RASTER_TILE_SIZE;
+  size_t n_tiles = (size_t)tiles_x * tiles_y, n_tris = msh_array_len( r->tris );
+
+  // Bin by bounding box, counting first, so that each tile lists triangles in submission order.
+  msh_array_clear( r->tile_offsets );
+  msh_array_fit( r->tile_offsets, n_tiles + 1 );
+  uint32_t* offsets = r->tile_offsets;
+  memset( offsets, 0, ( n_tiles + 1 ) * sizeof(uint32_t) );
+  for( int pass = 0; pass < 2; ++pass )
+  {
+    for( size_t i = 0; i < n_tris; ++i )
+    {
+      const msh__raster_tri_t* t = &r->tris[i];
+      int32_t min_x = msh_min( t->x[0], msh_min( t->x[1], t->x[2] ) ), max_x = msh_max( t->x[0], msh_max( t->x[1], t->x[2] ) );
+      int32_t min_y = msh_min( t->y[0], msh_min( t->y[1], t->y[2] ) ), max_y = msh_max( t->y[0], msh_max( t->y[1], t->y[2] ) );
+      int bx0 = msh_max( 0, msh__raster_floor_div( min_x, MSH__RASTER_ONE * MSH_RASTER_TILE_SIZE ) );
+      int bx1 = msh_min( tiles_x - 1, msh__raster_floor_div( max_x, MSH__RASTER_ONE * MSH_RASTER_TILE_SIZE ) );
+      int by0 = msh_max( 0, msh__raster_floor_div( min_y, MSH__RASTER_ONE * MSH_RASTER_TILE_SIZE ) );
+      int by1 = msh_min( tiles_y - 1, msh__raster_floor_div( max_y, MSH__RASTER_ONE * MSH_RASTER_TILE_SIZE ) );
+      for( int by = by0; by <= by1; ++by )
+      {
+        for( int bx = bx0; bx <= bx1; ++bx )
+        {
+          size_t tile = (size_t)by * tiles_x + bx;
+          if( pass == 0 ) { offsets[tile + 1]++; }
+          else            { r->tile_refs[offsets[tile]++] = (uint32_t)i; }
+        }
+      }
+    }
+    if( pass == 0 )
+    {
+      for( size_t tile = 0; tile < n_tiles; ++tile ) { offsets[tile + 1] += offsets[tile]; }
+      msh_array_clear( r->tile_refs );
+      msh_array_fit( r->tile_refs, offsets[n_tiles] + 1 );
+    }
+  }
+  // Fill pass advanced every offset to the start of the next tile.
+  memmove( offsets + 1, offsets, n_tiles * sizeof(uint32_t) );
+  offsets[0] = 0;
+  MSH__RASTER_PROF_END();
+  uint64_t t2 = msh_time_now();
+
+  msh__raster_render_t rd = { r, img, tiles_x };
+  if( jobs && n_tiles > 1 ) { msh_jobs_parallel_for( jobs, n_tiles, 1, msh__raster_tile_job, &rd ); }
+  else                      { msh__raster_tile_job( &rd, 0, n_tiles ); }
+  uint64_t t3 = msh_time_now();
+
+  r->stats.n_triangles = n_tris;
+  r->stats.n_tile_refs = offsets[n_tiles];
+  r->stats.bin_ms = msh_time_diff( MSHT_MILLISECONDS, t2, t1 );
+  r->stats.draw_ms = msh_time_diff( MSHT_MILLISECONDS, t3, t2 );
+}
+
+#endif /* MSH_RASTER_IMPLEMENTATION */
@@ -0,0 +1,496 @@
+/*
+  Author: Maciej Halber
+  Date : Oct 18, 2026
+  License: CC0
+
+  Compilation: gcc -std=c99 -O2 -mavx2 -I<path_to_msh_libraries> msh_raster_example.c -o msh_raster_example -lm -lpthread
+  Usage:       msh_raster_example [output.ppm | --bench]
+  Description: This program showcases msh_raster.h, drawing triangles, fills and strokes into
+               images without a GPU. It:
+
+               1) Compares rendered images, with and without the job system, RGB and RGBA, and
+               sizes that are not multiples of the tile size, pixel by pixel against a
+               reference that tests every pixel against every triangle.
+
+               2) Checks that triangles sharing edges (a jittered mesh, a filled polygon with
+               holes and mitered strokes) cover every pixel exactly once, by drawing them
+               translucent over black.
+
+               3) Compares a hash of a test scene with a golden value, so that a change of output
+               on any platform, thread count or code path is noticed. The scene is optionally
+               written to a ppm file.
+
+               4) Reports throughput in pixels/s for small and large triangles, opaque and
+               translucent, on one thread and on all threads.
+
+               Program returns non-zero if validation fails. Compile without -mavx2, or with
+               -DMSH_RASTER_NO_SIMD, for the scalar path, which produces identical images. With
+               --bench, single threaded rendering is measured with msh_bench.h instead.
+*/
+
+#define MSH_STD_INCLUDE_HEADERS
+#define MSH_STD_IMPLEMENTATION
+#define MSH_IMG_PROC_IMPLEMENTATION
+#define MSH_JOBS_IMPLEMENTATION
+#define MSH_SORT_IMPLEMENTATION
+#define MSH_TRIANGULATE_IMPLEMENTATION
+#define MSH_RASTER_IMPLEMENTATION
+#define MSH_BENCH_IMPLEMENTATION
+#include "msh_std.h"
+#include "msh_img_proc.h"
+#include "msh_jobs.h"
+#include "msh_sort.h"
+#include "msh_triangulate.h"
+#include "msh_raster.h"
+#include "msh_bench.h"
+
+enum { N_RUNS = 3 };
+
+// Golden scene is built from its own generator, so that it does not depend on msh_rand.
+static const uint64_t golden_hash = 0x886fe50b0f65cd7full;
+
+typedef struct lcg { uint32_t state; } lcg_t;
+
+float lcg_nextf( lcg_t* g )
+{
+  g->state = g->state * 1664525u + 1013904223u;
+  return (float)( g->state >> 8 ) / (float)( 1 << 24 );
+}
+
+uint64_t image_hash( const msh_img_ui8_t* img )
+{
+  uint64_t h = 0xcbf29ce484222325ull;   // FNV-1a
+  size_t n = (size_t)img->width * img->height * img->n_comp;
+  for( size_t i = 0; i < n; ++i ) { h = ( h ^ img->data[i] ) * 0x100000001b3ull; }
+  return h;
+}
+
+void write_ppm( const char* filename, const msh_img_ui8_t* img )
+{
+  FILE* fp = fopen( filename, "wb" );
+  if( !fp ) { printf("  could not write %s\n", filename ); return; }
+  fprintf( fp, "P6\n%d %d\n255\n", img->width, img->height );
+  for( int i = 0; i < img->width * img->height; ++i ) { fwrite( img->data + i * img->n_comp, 1, 3, fp ); }
+  fclose( fp );
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+// Reference
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+typedef struct command
+{
+  const float* xy;
+  const int* indices;
+  int n_tris;
+  uint32_t color;
+} command_t;
+
+int64_t fixed( float v )
+{
+  return lrintf( msh_clamp( v * 16.0f, -1e9f, 1e9f ) );
+}
+
+int reference_covers( const int64_t* x, const int64_t* y, int64_t cx, int64_t cy )
+{
+  for( int i = 0; i < 3; ++i )
+  {
+    int j = ( i + 1 ) % 3;
+    int64_t e = ( x[j] - x[i] ) * ( cy - y[i] ) - ( y[j] - y[i] ) * ( cx - x[i] );
+    int owns = y[j] < y[i] || ( y[j] == y[i] && x[j] > x[i] );
+    if( e < 0 || ( e == 0 && !owns ) ) { return 0; }
+  }
+  return 1;
+}
+
+uint8_t reference_blend( uint32_t s, uint32_t d, uint32_t a )
+{
+  return (uint8_t)( ( s * a + d * ( 255 - a ) + 127 ) / 255 );
+}
+
+void reference_render( msh_img_ui8_t* img, const command_t* cmds, int n_cmds )
+{
+  for( int c = 0; c < n_cmds; ++c )
+  {
+    for( int t = 0; t < cmds[c].n_tris; ++t )
+    {
+      int64_t x[3], y[3];
+      for( int k = 0; k < 3; ++k )
+      {
+        int v = cmds[c].indices ? cmds[c].indices[3 * t + k] : 3 * t + k;
+        x[k] = fixed( cmds[c].xy[2 * v] );
+        y[k] = fixed( cmds[c].xy[2 * v + 1] );
+      }
+      int64_t area = ( x[1] - x[0] ) * ( y[2] - y[0] ) - ( y[1] - y[0] ) * ( x[2] - x[0] );
+      if( area == 0 ) { continue; }
+      if( area < 0 ) { int64_t tx = x[1], ty = y[1]; x[1] = x[2]; y[1] = y[2]; x[2] = tx; y[2] = ty; }
+      uint32_t color = cmds[c].color, a = color >> 24;
+      for( int py = 0; py < img->height; ++py )
+      {
+        for( int px = 0; px < img->width; ++px )
+        {
+          if( !reference_covers( x, y, px * 16 + 8, py * 16 + 8 ) ) { continue; }
+          uint8_t* p = img->data + ( (size_t)py * img->width + px ) * img->n_comp;
+          for( int k = 0; k < 3; ++k ) { p[k] = reference_blend( ( color >> ( 8 * k ) ) & 0xFF, p[k], a ); }
+          if( img->n_comp == 4 ) { p[3] = reference_blend( 255, p[3], a ); }
+        }
+      }
+    }
+  }
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+// Scenes
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+typedef struct scene
+{
+  msh_array(float) xy;
+  msh_array(int) indices;
+  msh_array(command_t) cmds;
+} scene_t;
+
+// Random triangles of various sizes and colors, partially outside the image, plus a polygon
+// with a hole, filled through msh_triangulate.
+void scene_init( scene_t* s, int width, int height, int n_tris, lcg_t* g )
+{
+  for( int i = 0; i < n_tris; ++i )
+  {
+    float size = ( i % 10 == 0 ) ? 0.5f * width : 12.0f;
+    float cx = lcg_nextf( g ) * ( width + 40.0f ) - 20.0f, cy = lcg_nextf( g ) * ( height + 40.0f ) - 20.0f;
+    for( int k = 0; k < 3; ++k )
+    {
+      msh_array_push( s->xy, cx + ( lcg_nextf( g ) - 0.5f ) * size );
+      msh_array_push( s->xy, cy + ( lcg_nextf( g ) - 0.5f ) * size );
+    }
+  }
+  float polygon[] = { 0.1f * width, 0.2f * height, 0.9f * width, 0.1f * height, 0.7f * width, 0.9f * height,
+                      0.5f * width, 0.5f * height, 0.2f * width, 0.8f * height,
+                      0.3f * width, 0.4f * height, 0.5f * width, 0.3f * height, 0.6f * width, 0.4f * height };
+  int counts[] = { 5, 3 };
+  size_t poly_start = msh_array_len( s->xy );
+  for( int i = 0; i < (int)msh_count_of( polygon ); ++i ) { msh_array_push( s->xy, polygon[i] ); }
+  int n_poly_tris = msh_triangulate_polygon_holes( polygon, counts, 2, &s->indices );
+
+  // Commands point into the arrays, so they are created once the arrays are complete.
+  int per_cmd = msh_max( 1, n_tris / 8 );
+  for( int i = 0; i < n_tris; i += per_cmd )
+  {
+    uint32_t color = MSH_RASTER_RGBA( (int)( lcg_nextf( g ) * 255 ), (int)( lcg_nextf( g ) * 255 ),
+                                      (int)( lcg_nextf( g ) * 255 ), ( i / per_cmd ) % 2 ? 255 : 40 + (int)( lcg_nextf( g ) * 200 ) );
+    command_t cmd = { s->xy + 6 * i, NULL, msh_min( per_cmd, n_tris - i ), color };
+    msh_array_push( s->cmds, cmd );
+  }
+  command_t fill = { s->xy + poly_start, s->indices, n_poly_tris, MSH_RASTER_RGBA( 30, 200, 90, 160 ) };
+  msh_array_push( s->cmds, fill );
+}
+
+void scene_free( scene_t* s )
+{
+  msh_array_free( s->xy );
+  msh_array_free( s->indices );
+  msh_array_free( s->cmds );
+}
+
+void scene_record( msh_raster_t* r, const scene_t* s )
+{
+  for( size_t i = 0; i < msh_array_len( s->cmds ); ++i )
+  {
+    msh_raster_triangles( r, s->cmds[i].xy, s->cmds[i].indices, s->cmds[i].n_tris, s->cmds[i].color );
+  }
+}
+
+void clear_image( msh_img_ui8_t* img, uint8_t value )
+{
+  memset( img->data, value, (size_t)img->width * img->height * img->n_comp );
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+// Validation
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+int validate_against_reference( int width, int height, int n_comp, msh_jobs_t* jobs, lcg_t* g )
+{
+  scene_t s = {0};
+  scene_init( &s, width, height, 300, g );
+  msh_img_ui8_t ref = mship_img_ui8_init( width, height, n_comp, 0 );
+  msh_img_ui8_t img = mship_img_ui8_init( width, height, n_comp, 0 );
+  clear_image( &ref, 200 );
+  clear_image( &img, 200 );
+  reference_render( &ref, s.cmds, (int)msh_array_len( s.cmds ) );
+  msh_raster_t* r = msh_raster_create();
+  scene_record( r, &s );
+  msh_raster_render( r, &img, jobs );
+  size_t n = (size_t)width * height * n_comp, n_diff = 0;
+  for( size_t i = 0; i < n; ++i ) { n_diff += ref.data[i] != img.data[i]; }
+  if( n_diff ) { printf("  %dx%dx%d %s: %zu values differ FAILED\n", width, height, n_comp, jobs ? "jobs" : "serial", n_diff ); }
+  msh_raster_destroy( r );
+  mship_img_ui8_free( &ref );
+  mship_img_ui8_free( &img );
+  scene_free( &s );
+  return n_diff == 0;
+}
+
+// Everything is drawn with alpha 128 over black, so covered pixels have to be exactly 128 (once)
+// and uncovered 0.
+int check_single_coverage( const char* name, msh_img_ui8_t* img, int expect_covered )
+{
+  int n_twice = 0, n_covered = 0;
+  for( int i = 0; i < img->width * img->height; ++i )
+  {
+    uint8_t v = img->data[i * img->n_comp];
+    n_twice += v != 0 && v != 128;
+    n_covered += v == 128;
+  }
+  int ok = n_twice == 0 && ( !expect_covered || n_covered == expect_covered );
+  if( !ok ) { printf("  %s: %d pixels blended more than once, %d covered FAILED\n", name, n_twice, n_covered ); }
+  return ok;
+}
+
+int validate_coverage( msh_jobs_t* jobs, lcg_t* g )
+{
+  int ok = 1;
+  uint32_t half = MSH_RASTER_RGBA( 255, 255, 255, 128 );
+  msh_img_ui8_t img = mship_img_ui8_init( 257, 193, 4, 0 );
+  msh_raster_t* r = msh_raster_create();
+
+  // Jittered grid mesh over [8, 248] x [8, 184], which contains centers of 240 x 176 pixels.
+  {
+    enum { NX = 24, NY = 16 };
+    float xy[2 * ( NX + 1 ) * ( NY + 1 )];
+    int indices[6 * NX * NY], k = 0;
+    for( int j = 0; j <= NY; ++j )
+    {
+      for( int i = 0; i <= NX; ++i )
+      {
+        int border = i == 0 || j == 0 || i == NX || j == NY;
+        xy[2 * ( j * ( NX + 1 ) + i ) + 0] = 8.0f + 10.0f * i + ( border ? 0.0f : ( lcg_nextf( g ) - 0.5f ) * 6.0f );
+        xy[2 * ( j * ( NX + 1 ) + i ) + 1] = 8.0f + 11.0f * j + ( border ? 0.0f : ( lcg_nextf( g ) - 0.5f ) * 6.0f );
+      }
+    }
+    for( int j = 0; j < NY; ++j )
+    {
+      for( int i = 0; i < NX; ++i )
+      {
+        int a = j * ( NX + 1 ) + i, b = a + 1, c = a + NX + 1, d = c + 1;
+        indices[k++] = a; indices[k++] = b; indices[k++] = d;
+        indices[k++] = a; indices[k++] = d; indices[k++] = c;
+      }
+    }
+    clear_image( &img, 0 );
+    msh_raster_reset( r );
+    msh_raster_triangles( r, xy, indices, 2 * NX * NY, half );
+    msh_raster_render( r, &img, jobs );
+    ok &= check_single_coverage( "mesh", &img, 240 * 176 );
+  }
+
+  // Polygon with holes, through msh_triangulate.
+  {
+    float xy[] = { 10, 10, 240, 12, 230, 180, 120, 100, 15, 170,
+                   40, 40, 60, 40, 60, 60, 40, 60,
+                   180, 50, 200, 70, 180, 90, 160, 70 };
+    int counts[] = { 5, 4, 4 };
+    clear_image( &img, 0 );
+    msh_raster_reset( r );
+    msh_raster_fill( r, xy, counts, 3, half );
+    msh_raster_render( r, &img, jobs );
+    ok &= check_single_coverage( "fill", &img, 0 );
+  }
+
+  // Zig-zag polyline and a closed one; joins must not be blended twice.
+  {
+    float zigzag[2 * 12], square[] = { 150, 120, 240, 120, 240, 185, 150, 185 };
+    for( int i = 0; i < 12; ++i ) { zigzag[2 * i] = 12.0f + 11.5f * i; zigzag[2 * i + 1] = ( i & 1 ) ? 30.0f : 100.0f + 3.0f * i; }
+    clear_image( &img, 0 );
+    msh_raster_reset( r );
+    msh_raster_stroke( r, zigzag, 12, 0, 5.0f, half );
+    msh_raster_stroke( r, square, 4, 1, 7.0f, half );
+    msh_raster_render( r, &img, jobs );
+    ok &= check_single_coverage( "strokes", &img, 0 );
+  }
+
+  msh_raster_destroy( r );
+  mship_img_ui8_free( &img );
+  return ok;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+// Benchmarks, run with --bench
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+typedef struct bench_data
+{
+  msh_raster_t* raster;
+  msh_img_ui8_t* img;
+} bench_data_t;
+
+void bench_render( void* data, size_t n_iters )
+{
+  bench_data_t* d = data;
+  for( size_t it = 0; it < n_iters; ++it )
+  {
+    msh_raster_render( d->raster, d->img, NULL );
+    MSH_BENCH_CLOBBER();
+  }
+}
+
+int run_benchmarks( int argc, char** argv )
+{
+  lcg_t g = { 12345u };
+  msh_img_ui8_t img = mship_img_ui8_init( 1920, 1080, 4, 0 );
+  clear_image( &img, 0 );
+  struct { const char* name; int n; float size; int alpha; } cases[] = { { "small opaque, 100k", 100000, 8.0f, 0 },
+                                                                           { "small alpha, 100k", 100000, 8.0f, 1 },
+                                                                           { "large opaque, 1k", 1000, 200.0f, 0 },
+                                                                           { "large alpha, 1k", 1000, 200.0f, 1 } };
+  bench_data_t d[msh_count_of( cases )];
+  float* xy[msh_count_of( cases )];
+
+  msh_bench_t* b = msh_bench_create( argc, argv );
+  for( int c = 0; c < (int)msh_count_of( cases ); ++c )
+  {
+    int n = cases[c].n;
+    xy[c] = malloc( 6 * n * sizeof(float) );
+    for( int i = 0; i < n; ++i )
+    {
+      float cx = lcg_nextf( &g ) * 1920.0f, cy = lcg_nextf( &g ) * 1080.0f;
+      for( int k = 0; k < 3; ++k )
+      {
+        xy[c][6 * i + 2 * k + 0] = cx + ( lcg_nextf( &g ) - 0.5f ) * cases[c].size * 2.0f;
+        xy[c][6 * i + 2 * k + 1] = cy + ( lcg_nextf( &g ) - 0.5f ) * cases[c].size * 2.0f;
+      }
+    }
+    d[c].raster = msh_raster_create();
+    d[c].img = &img;
+    msh_raster_triangles( d[c].raster, xy[c], NULL, n, MSH_RASTER_RGBA( 200, 100, 50, cases[c].alpha ? 128 : 255 ) );
+    msh_bench_add( b, cases[c].name, bench_render, &d[c], n );
+  }
+  int n_regressions = msh_bench_run( b );
+  msh_bench_destroy( b );
+  for( int c = 0; c < (int)msh_count_of( cases ); ++c )
+  {
+    msh_raster_destroy( d[c].raster );
+    free( xy[c] );
+  }
+  mship_img_ui8_free( &img );
+  return n_regressions ? 1 : 0;
+}
+
+int main( int argc, char** argv )
+{
+  if( msh_bench_requested( argc, argv ) ) { return run_benchmarks( argc, argv ); }
+  int n_failed = 0;
+  msh_jobs_t* jobs = msh_jobs_create( -1 );
+  lcg_t g = { 12345u };
+
+  //----------------------------------------------------------------------------------------------
+  printf("Validation against per-pixel reference:\n");
+  {
+    int sizes[][2] = { { 64, 64 }, { 200, 150 }, { 131, 67 }, { 7, 300 } };
+    int n_cases = 0, n_ok = 0;
+    for( int k = 0; k < (int)msh_count_of( sizes ); ++k )
+    {
+      for( int n_comp = 3; n_comp <= 4; ++n_comp )
+      {
+        n_ok += validate_against_reference( sizes[k][0], sizes[k][1], n_comp, NULL, &g );
+        n_ok += validate_against_reference( sizes[k][0], sizes[k][1], n_comp, jobs, &g );
+        n_cases += 2;
+      }
+    }
+    n_ok += validate_coverage( NULL, &g );
+    n_ok += validate_coverage( jobs, &g );
+    n_cases += 2;
+    n_failed += n_cases - n_ok;
+    printf("  %d/%d cases identical\n", n_ok, n_cases );
+  }
+
+  //----------------------------------------------------------------------------------------------
+  printf("Golden image:\n");
+  {
+    lcg_t golden_gen = { 2026u };
+    scene_t s = {0};
+    scene_init( &s, 640, 480, 2000, &golden_gen );
+    msh_img_ui8_t img = mship_img_ui8_init( 640, 480, 4, 0 );
+    msh_raster_t* r = msh_raster_create();
+    scene_record( r, &s );
+    float walk[2 * 200];
+    for( int i = 0; i < 200; ++i ) { walk[2 * i] = 20.0f + 3.0f * i; walk[2 * i + 1] = 240.0f + 150.0f * ( lcg_nextf( &golden_gen ) - 0.5f ); }
+    msh_raster_stroke( r, walk, 200, 0, 2.5f, MSH_RASTER_RGBA( 250, 240, 20, 200 ) );
+
+    uint64_t hashes[2];
+    for( int k = 0; k < 2; ++k )
+    {
+      clear_image( &img, 255 );
+      msh_raster_render( r, &img, k ? jobs : NULL );
+      hashes[k] = image_hash( &img );
+    }
+    int ok = hashes[0] == golden_hash && hashes[1] == golden_hash;
+    printf("  hash %016llx (serial), %016llx (jobs), golden %016llx%s\n", (unsigned long long)hashes[0],
+           (unsigned long long)hashes[1], (unsigned long long)golden_hash, ok ? "" : " FAILED" );
+    n_failed += !ok;
+    if( argc > 1 ) { write_ppm( argv[1], &img ); }
+    msh_raster_destroy( r );
+    mship_img_ui8_free( &img );
+    scene_free( &s );
+  }
+
+  //----------------------------------------------------------------------------------------------
+  printf("Throughput in M pixels/s, 1920x1080 RGBA (best of %d runs, %d threads):\n", N_RUNS, msh_jobs_n_threads( jobs ) );
+  {
+    msh_img_ui8_t img = mship_img_ui8_init( 1920, 1080, 4, 0 );
+    clear_image( &img, 0 );
+    struct { const char* name; int n; float size; } cases[] = { { "small (~20 px)", 1000000, 8.0f },
+                                                                 { "large (~12k px)", 10000, 200.0f } };
+    printf("  %-16s %10s %12s %10s %12s %12s %12s\n", "", "opaque", "opaque jobs", "alpha", "alpha jobs", "px/tri", "refs/tri" );
+    for( int c = 0; c < (int)msh_count_of( cases ); ++c )
+    {
+      int n = cases[c].n;
+      float size = cases[c].size;
+      float* xy = malloc( 6 * n * sizeof(float) );
+      // Triangles stay inside the image, so their area is the number of pixels drawn.
+      double area = 0.0;
+      for( int i = 0; i < n; ++i )
+      {
+        float cx = size + lcg_nextf( &g ) * ( 1920.0f - 2.0f * size );
+        float cy = size + lcg_nextf( &g ) * ( 1080.0f - 2.0f * size );
+        float* p = xy + 6 * i;
+        for( int k = 0; k < 3; ++k )
+        {
+          p[2 * k + 0] = cx + ( lcg_nextf( &g ) - 0.5f ) * size * 2.0f;
+          p[2 * k + 1] = cy + ( lcg_nextf( &g ) - 0.5f ) * size * 2.0f;
+        }
+        area += 0.5 * fabs( (double)( p[2] - p[0] ) * ( p[5] - p[1] ) - (double)( p[4] - p[0] ) * ( p[3] - p[1] ) );
+      }
+      double results[4];
+      double refs_per_tri = 0.0;
+      for( int alpha = 0; alpha < 2; ++alpha )
+      {
+        msh_raster_t* r = msh_raster_create();
+        msh_raster_triangles( r, xy, NULL, n, MSH_RASTER_RGBA( 200, 100, 50, alpha ? 128 : 255 ) );
+        for( int use_jobs = 0; use_jobs < 2; ++use_jobs )
+        {
+          double best = 1e30;
+          for( int run = 0; run < N_RUNS; ++run )
+          {
+            uint64_t t1 = msh_time_now();
+            msh_raster_render( r, &img, use_jobs ? jobs : NULL );
+            uint64_t t2 = msh_time_now();
+            best = msh_min( best, msh_time_diff( MSHT_MILLISECONDS, t2, t1 ) );
+          }
+          results[2 * alpha + use_jobs] = area / ( best * 1e3 );
+        }
+        msh_raster_stats_t stats = msh_raster_get_stats( r );
+        refs_per_tri = (double)stats.n_tile_refs / stats.n_triangles;
+        msh_raster_destroy( r );
+      }
+      printf("  %-16s %10.1f %12.1f %10.1f %12.1f %12.1f %12.2f\n", cases[c].name, results[0], results[1], results[2],
+             results[3], area / n, refs_per_tri );
+      free( xy );
+    }
+    mship_img_ui8_free( &img );
+  }
+
+  msh_jobs_destroy( jobs );
+  printf("%d failed\n", n_failed );
+  return n_failed ? 1 : 0;
+}
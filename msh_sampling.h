@@ -0,0 +1,1268 @@
+/*
+  ==============================================================================
+
+  MSH_SAMPLING.H v0.1
+
+  A single header library for drawing random samples from discrete and continuous
+  distributions, complementing the discrete samplers of msh_std.h:
+
+    - alias tables (Vose's algorithm), also packed into one 64-bit or 32-bit word per entry
+    - parallel construction of packed alias tables, running on msh_jobs.h
+    - piecewise-linear 1D and piecewise-constant 2D continuous distributions
+    - weighted sampling without replacement, in memory and as a streaming reservoir
+    - chi-square and Kolmogorov-Smirnov tests for validating samplers
+
+  To use the library you simply add:
+
+  #include "msh_std.h"
+  #define MSH_SAMPLING_IMPLEMENTATION
+  #include "msh_sampling.h"
+
+  msh_std.h defines the random number generator (msh_rand_ctx_t) and needs to be included first.
+
+  ==============================================================================
+  DOCUMENTATION
+
+  Alias tables
+    msh_alias_build( weights, n, prob, alias );
+    msh_alias_table_build( weights, n, table );
+    i = msh_alias_table_sample( table, n, u, &u_remap );
+
+    Vose's algorithm, after description by Keith Schwartz:
+    http://www.keithschwarz.com/darts-dice-coins/. Weights do not need to be normalized, and
+    zero-sum weights produce a uniform table. msh_alias_table_sample picks a cell with a single
+    uniform number u in [0,1), and writes the unused precision of u as a fresh uniform number
+    into u_remap, so that the caller can position a sample within the cell.
+
+  Packed alias tables
+    msh_alias64_t table;
+    msh_alias64_init( &table, weights, n );
+    msh_alias64_sample_n( &table, &rand_gen, indices, n_samples );
+    msh_alias64_free( &table );
+
+    Probability and alias of an entry are packed into a single word, with probability stored as
+    a fixed point threshold compared directly against random bits. One sample reads exactly one
+    word, so for tables much larger than the cache we pay for one cache miss per sample instead
+    of two. msh_alias64_t takes 8 bytes per entry and two 32 bit random numbers per sample.
+    msh_alias32_t takes 4 bytes per entry and a single random number per sample, and
+    msh_alias32_init returns 0 for tables of more than 2^16 entries. msh_alias64_to_pdf writes
+    the probabilities implied by a table, for validation.
+
+  Parallel alias table construction
+    msh_alias64_init_mt( &table, weights, n, jobs );
+
+    Available when msh_jobs.h is included first. Builds the same distribution as
+    msh_alias64_init, split into one chunk per thread of 'jobs', after "Parallel Weighted Random
+    Sampling" by Huebschle-Schneider and Sanders. 'jobs' equal to NULL builds the table on the
+    calling thread.
+
+  Continuous distributions
+    msh_pwl_distrib_init( &pwl, values, n_values );
+    x = msh_pwl_distrib_sample( &pwl, u, &pdf );
+
+    msh_distrib2d_init( &d2, values, width, height );
+    pdf = msh_distrib2d_sample( &d2, u0, u1, &x, &y );
+
+    Piecewise-linear 1D density given by n_values >= 2 values at equally spaced points on [0,1],
+    and piecewise-constant 2D density given by width*height values in row-major order, e.g. an
+    emission map. Both pick a cell with an alias table and reuse the leftover precision of the
+    same uniform number to position the sample within the cell, so uniform numbers are passed
+    in by the caller (pcg, qmc sequences etc.). Samples lie in [0,1] (or [0,1)^2) and are
+    returned with their density. Batched versions are msh_pwl_distrib_sample_n and
+    msh_distrib2d_sample_n.
+
+  Weighted sampling without replacement
+    n_picked = msh_weighted_sample( weights, n, k, &rand_gen, indices );
+    n_picked = msh_weighted_sample_mt( weights, n, k, jobs, seed, indices );
+
+    After Efraimidis & Spirakis - every item gets a key E/w, where E is drawn from an exponential
+    distribution, and the k items with the smallest keys are picked. k is clamped to [0, n], and
+    items with zero weight are never picked, so fewer than k indices are returned if there are
+    not enough items with positive weight. The parallel version (with msh_jobs.h included
+    first) keys one chunk per thread, each with its own random stream derived from 'seed'.
+
+    msh_reservoir_t res;
+    msh_reservoir_init( &res, k, seed );
+    msh_reservoir_push( &res, idx, w );          // for every item of the stream
+    n_picked = msh_reservoir_get( &res, indices );
+    msh_reservoir_free( &res );
+
+    Streaming version with exponential jumps, with memory bounded by k.
+
+  Validation
+    msh_sampling_test_t test;
+    msh_sampling_test_discrete( pdf, n, indices, n_samples, &test );
+    msh_sampling_test_pwl( values, n_values, xs, n_samples, &test );
+    if( !msh_sampling_test_passed( &test ) ) { ... }
+
+    Tests samples against the distribution they were drawn from - a chi-square test, with
+    adjacent cells pooled until each group expects enough samples, and a Kolmogorov-Smirnov
+    test. Samples that land in cells of zero probability are counted separately. Tests pass
+    at significance level 0.001.
+
+  ==============================================================================
+  AUTHORS:
+    Maciej Halber
+
+  LICENSE:
+    CC0
+  ==============================================================================
+*/
+
+#ifndef MSH_SAMPLING_H
+#define MSH_SAMPLING_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#ifndef MSH_SAMPLING_DEF
+#ifdef MSH_SAMPLING_STATIC
+#define MSH_SAMPLING_DEF static
+#else
+#define MSH_SAMPLING_DEF extern
+#endif
+#endif
+
+typedef struct msh_alias_entry
+{
+  float prob;
+  int32_t alias;
+} msh_alias_entry_t;
+
+typedef struct msh_alias64
+{
+  int n;
+  uint64_t* entries;    // high 32 bits are the threshold, low 32 bits are the alias
+} msh_alias64_t;
+
+typedef struct msh_alias32
+{
+  int n;
+  int alias_bits;       // just enough bits to index the table, the rest is the threshold
+  uint32_t* entries;
+} msh_alias32_t;
+
+// Segment stores its own alias entry and the density values at its end points, so that
+// picking a segment that is not aliased touches a single cache line.
+typedef struct msh_pwl_segment
+{
+  float prob;
+  int32_t alias;
+  float f0, f1;
+} msh_pwl_segment_t;
+
+typedef struct msh_pwl_distrib
+{
+  int n_segments;
+  double inv_integral;
+  msh_pwl_segment_t* segments;
+} msh_pwl_distrib_t;
+
+// Rows are picked from the marginal table, columns from the conditional table of that row.
+// Density is stored so that pdf lookups (for MIS weights etc.) do not need to touch the tables.
+typedef struct msh_distrib2d
+{
+  int width, height;
+  msh_alias_entry_t* marginal;
+  msh_alias_entry_t* conditional;
+  float* density;
+} msh_distrib2d_t;
+
+typedef struct msh_keyed_index
+{
+  double key;
+  int32_t idx;
+} msh_keyed_index_t;
+
+typedef struct msh_reservoir
+{
+  int k;
+  int count;
+  double skip;
+  msh_keyed_index_t* heap;
+  msh_rand_ctx_t rand_gen;
+} msh_reservoir_t;
+
+typedef struct msh_sampling_test
+{
+  double chi2;
+  double p_value;       // upper tail of the chi-square distribution with dof degrees of freedom
+  int dof;
+  int n_impossible;     // samples in cells with zero probability, or outside of the cells
+  double ks_d;          // Kolmogorov-Smirnov statistic
+  double ks_crit;       // critical value of ks_d
+} msh_sampling_test_t;
+
+MSH_SAMPLING_DEF double msh_sampling_nextd( msh_rand_ctx_t* rand_gen );
+
+MSH_SAMPLING_DEF void msh_alias_build( const double* weights, int n, double* prob, int32_t* alias );
+MSH_SAMPLING_DEF void msh_alias_table_build( const double* weights, int n, msh_alias_entry_t* table );
+MSH_SAMPLING_DEF int  msh_alias_table_sample( const msh_alias_entry_t* table, int n, double u,
+                                              double* u_remap );
+
+MSH_SAMPLING_DEF void    msh_alias64_init( msh_alias64_t* table, const double* weights, int n );
+MSH_SAMPLING_DEF void    msh_alias64_free( msh_alias64_t* table );
+MSH_SAMPLING_DEF int32_t msh_alias64_sample( const msh_alias64_t* table, uint32_t r0, uint32_t r1 );
+MSH_SAMPLING_DEF void    msh_alias64_sample_n( const msh_alias64_t* table, msh_rand_ctx_t* rand_gen,
+                                               int32_t* out, int n );
+MSH_SAMPLING_DEF void    msh_alias64_to_pdf( const msh_alias64_t* table, double* pdf );
+
+MSH_SAMPLING_DEF int     msh_alias32_init( msh_alias32_t* table, const double* weights, int n );
+MSH_SAMPLING_DEF void    msh_alias32_free( msh_alias32_t* table );
+MSH_SAMPLING_DEF int32_t msh_alias32_sample( const msh_alias32_t* table, uint32_t r );
+MSH_SAMPLING_DEF void    msh_alias32_sample_n( const msh_alias32_t* table, msh_rand_ctx_t* rand_gen,
+                                               int32_t* out, int n );
+
+MSH_SAMPLING_DEF void   msh_pwl_distrib_init( msh_pwl_distrib_t* d, const double* values, int n_values );
+MSH_SAMPLING_DEF void   msh_pwl_distrib_free( msh_pwl_distrib_t* d );
+MSH_SAMPLING_DEF double msh_pwl_distrib_sample( const msh_pwl_distrib_t* d, double u, double* pdf );
+MSH_SAMPLING_DEF void   msh_pwl_distrib_sample_n( const msh_pwl_distrib_t* d, const double* u, double* x,
+                                                  double* pdf, int n_samples );
+
+MSH_SAMPLING_DEF void  msh_distrib2d_init( msh_distrib2d_t* d, const double* values, int width, int height );
+MSH_SAMPLING_DEF void  msh_distrib2d_free( msh_distrib2d_t* d );
+MSH_SAMPLING_DEF float msh_distrib2d_pdf( const msh_distrib2d_t* d, float x, float y );
+MSH_SAMPLING_DEF float msh_distrib2d_sample( const msh_distrib2d_t* d, double u0, double u1,
+                                             float* x, float* y );
+MSH_SAMPLING_DEF void  msh_distrib2d_sample_n( const msh_distrib2d_t* d, const double* u, float* xy,
+                                               float* pdf, int n_samples );
+
+MSH_SAMPLING_DEF void msh_keyed_index_select( msh_keyed_index_t* items, int n, int k );
+MSH_SAMPLING_DEF int  msh_weighted_sample_chunk( const double* weights, int first, int n, int k,
+                                                 msh_rand_ctx_t* rand_gen, msh_keyed_index_t* scratch );
+MSH_SAMPLING_DEF int  msh_weighted_sample( const double* weights, int n, int k, msh_rand_ctx_t* rand_gen,
+                                           int32_t* indices );
+
+MSH_SAMPLING_DEF void msh_reservoir_init( msh_reservoir_t* res, int k, uint64_t seed );
+MSH_SAMPLING_DEF void msh_reservoir_free( msh_reservoir_t* res );
+MSH_SAMPLING_DEF void msh_reservoir_push( msh_reservoir_t* res, int32_t idx, double w );
+MSH_SAMPLING_DEF int  msh_reservoir_get( const msh_reservoir_t* res, int32_t* indices );
+
+#ifdef MSH_JOBS_H
+MSH_SAMPLING_DEF void msh_alias64_init_mt( msh_alias64_t* table, const double* weights, int n,
+                                           msh_jobs_t* jobs );
+MSH_SAMPLING_DEF int  msh_weighted_sample_mt( const double* weights, int n, int k, msh_jobs_t* jobs,
+                                              uint64_t seed, int32_t* indices );
+#endif
+
+MSH_SAMPLING_DEF double msh_sampling_chi2_pvalue( double chi2, int dof );
+MSH_SAMPLING_DEF void   msh_sampling_test_discrete( const double* pdf, int n, const int32_t* samples,
+                                                    int n_samples, msh_sampling_test_t* test );
+MSH_SAMPLING_DEF void   msh_sampling_test_pwl( const double* values, int n_values, const double* samples,
+                                               int n_samples, msh_sampling_test_t* test );
+MSH_SAMPLING_DEF int    msh_sampling_test_passed( const msh_sampling_test_t* test );
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* MSH_SAMPLING_H */
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+// IMPLEMENTATION
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+#ifdef MSH_SAMPLING_IMPLEMENTATION
+
+#include <assert.h>
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+
+// Tables and scratch buffers are tracked under "msh_sampling" when msh_mem.h is included first.
+#ifndef MSH_SAMPLING_MALLOC
+#ifdef MSH_MEM_H
+#define MSH_SAMPLING_MALLOC( size )        msh_mem_alloc( "msh_sampling", size )
+#define MSH_SAMPLING_CALLOC( count, size ) msh_mem_calloc( "msh_sampling", count, size )
+#define MSH_SAMPLING_FREE( ptr )           msh_mem_free( ptr )
+#else
+#define MSH_SAMPLING_MALLOC( size )        malloc( size )
+#define MSH_SAMPLING_CALLOC( count, size ) calloc( count, size )
+#define MSH_SAMPLING_FREE( ptr )           free( ptr )
+#endif
+#endif
+
+// msh_rand_nextf only has 24 bits of precision, which is not enough to position a sample within
+// a cell of a large table.
+MSH_SAMPLING_DEF double
+msh_sampling_nextd( msh_rand_ctx_t* rand_gen )
+{
+  uint64_t a = msh_rand_next( rand_gen ) >> 5;
+  uint64_t b = msh_rand_next( rand_gen ) >> 6;
+  return (a * 67108864.0 + b) * (1.0 / 9007199254740992.0);
+}
+
+static inline double
+msh__sampling_nextexp( msh_rand_ctx_t* rand_gen )
+{
+  return -log( 1.0 - msh_sampling_nextd( rand_gen ) );
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+// Alias tables
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+// Probabilities are kept in double precision, so that fixed point thresholds can be derived
+// from them without loss.
+MSH_SAMPLING_DEF void
+msh_alias_build( const double* weights, int n, double* prob, int32_t* alias )
+{
+  int32_t* small = (int32_t*)MSH_SAMPLING_MALLOC( n * sizeof(int32_t) );
+  int32_t* large = (int32_t*)MSH_SAMPLING_MALLOC( n * sizeof(int32_t) );
+  int n_small = 0, n_large = 0;
+
+  double sum = 0.0;
+  for( int i = 0; i < n; ++i ) { sum += weights[i]; }
+  for( int i = 0; i < n; ++i )
+  {
+    prob[i] = (sum > 0.0) ? (weights[i] * n / sum) : 1.0;
+    if( prob[i] < 1.0 ) { small[n_small++] = i; }
+    else                { large[n_large++] = i; }
+  }
+
+  while( n_small && n_large )
+  {
+    int32_t s = small[--n_small];
+    int32_t l = large[--n_large];
+    alias[s] = l;
+    prob[l] = (prob[l] + prob[s]) - 1.0;
+    if( prob[l] < 1.0 ) { small[n_small++] = l; }
+    else                { large[n_large++] = l; }
+  }
+  // Leftovers are due to numerical error only, they should be 1.0
+  while( n_large ) { int32_t l = large[--n_large]; prob[l] = 1.0; alias[l] = l; }
+  while( n_small ) { int32_t s = small[--n_small]; prob[s] = 1.0; alias[s] = s; }
+
+  MSH_SAMPLING_FREE( small );
+  MSH_SAMPLING_FREE( large );
+}
+
+MSH_SAMPLING_DEF void
+msh_alias_table_build( const double* weights, int n, msh_alias_entry_t* table )
+{
+  double* prob = (double*)MSH_SAMPLING_MALLOC( n * sizeof(double) );
+  int32_t* alias = (int32_t*)MSH_SAMPLING_MALLOC( n * sizeof(int32_t) );
+  msh_alias_build( weights, n, prob, alias );
+  for( int i = 0; i < n; ++i )
+  {
+    table[i].prob  = (float)prob[i];
+    table[i].alias = alias[i];
+  }
+  MSH_SAMPLING_FREE( prob );
+  MSH_SAMPLING_FREE( alias );
+}
+
+MSH_SAMPLING_DEF int
+msh_alias_table_sample( const msh_alias_entry_t* table, int n, double u, double* u_remap )
+{
+  double x = u * n;
+  int i = msh_min( (int)x, n - 1 );
+  double f = x - i;
+  msh_alias_entry_t e = table[i];
+  if( f < e.prob )
+  {
+    *u_remap = f / e.prob;
+    return i;
+  }
+  *u_remap = msh_min( (f - e.prob) / (1.0 - e.prob), 0.99999999999999989 );
+  return e.alias;
+}
+
+//----
+
+// Converts probability to a threshold with given number of bits. Entries that should always
+// keep their own index are made to alias themselves, so the comparison never matters.
+static inline uint32_t
+msh__alias_threshold( double prob, int bits, int32_t* alias, int32_t idx )
+{
+  double scale = (double)(1ULL << bits);
+  if( prob >= 1.0 ) { *alias = idx; return (uint32_t)((1ULL << bits) - 1); }
+  return (uint32_t)msh_min( prob * scale, scale - 1.0 );
+}
+
+MSH_SAMPLING_DEF void
+msh_alias64_init( msh_alias64_t* table, const double* weights, int n )
+{
+  double* prob = (double*)MSH_SAMPLING_MALLOC( n * sizeof(double) );
+  int32_t* alias = (int32_t*)MSH_SAMPLING_MALLOC( n * sizeof(int32_t) );
+  msh_alias_build( weights, n, prob, alias );
+
+  table->n = n;
+  table->entries = (uint64_t*)MSH_SAMPLING_MALLOC( n * sizeof(uint64_t) );
+  for( int i = 0; i < n; ++i )
+  {
+    uint64_t threshold = msh__alias_threshold( prob[i], 32, &alias[i], i );
+    table->entries[i] = (threshold << 32) | (uint32_t)alias[i];
+  }
+
+  MSH_SAMPLING_FREE( prob );
+  MSH_SAMPLING_FREE( alias );
+}
+
+MSH_SAMPLING_DEF void
+msh_alias64_free( msh_alias64_t* table )
+{
+  MSH_SAMPLING_FREE( table->entries );
+  table->entries = NULL;
+  table->n = 0;
+}
+
+// r0 picks the entry, r1 is compared against the threshold.
+MSH_SAMPLING_DEF int32_t
+msh_alias64_sample( const msh_alias64_t* table, uint32_t r0, uint32_t r1 )
+{
+  uint32_t i = (uint32_t)(((uint64_t)r0 * (uint32_t)table->n) >> 32);
+  uint64_t e = table->entries[i];
+  return (r1 < (uint32_t)(e >> 32)) ? (int32_t)i : (int32_t)(uint32_t)e;
+}
+
+MSH_SAMPLING_DEF void
+msh_alias64_sample_n( const msh_alias64_t* table, msh_rand_ctx_t* rand_gen, int32_t* out, int n )
+{
+  for( int i = 0; i < n; ++i )
+  {
+    uint32_t r0 = msh_rand_next( rand_gen );
+    uint32_t r1 = msh_rand_next( rand_gen );
+    out[i] = msh_alias64_sample( table, r0, r1 );
+  }
+}
+
+MSH_SAMPLING_DEF void
+msh_alias64_to_pdf( const msh_alias64_t* table, double* pdf )
+{
+  int n = table->n;
+  for( int i = 0; i < n; ++i ) { pdf[i] = 0.0; }
+  for( int i = 0; i < n; ++i )
+  {
+    uint64_t e = table->entries[i];
+    double keep = (double)(uint32_t)(e >> 32) / 4294967296.0;
+    pdf[i] += keep / n;
+    pdf[(uint32_t)e] += (1.0 - keep) / n;
+  }
+}
+
+MSH_SAMPLING_DEF int
+msh_alias32_init( msh_alias32_t* table, const double* weights, int n )
+{
+  int alias_bits = 0;
+  while( (1 << alias_bits) < n ) { alias_bits++; }
+  if( alias_bits > 16 ) { return 0; }
+
+  double* prob = (double*)MSH_SAMPLING_MALLOC( n * sizeof(double) );
+  int32_t* alias = (int32_t*)MSH_SAMPLING_MALLOC( n * sizeof(int32_t) );
+  msh_alias_build( weights, n, prob, alias );
+
+  table->n = n;
+  table->alias_bits = alias_bits;
+  table->entries = (uint32_t*)MSH_SAMPLING_MALLOC( n * sizeof(uint32_t) );
+  for( int i = 0; i < n; ++i )
+  {
+    uint32_t threshold = msh__alias_threshold( prob[i], 32 - alias_bits, &alias[i], i );
+    table->entries[i] = (threshold << alias_bits) | (uint32_t)alias[i];
+  }
+
+  MSH_SAMPLING_FREE( prob );
+  MSH_SAMPLING_FREE( alias );
+  return 1;
+}
+
+MSH_SAMPLING_DEF void
+msh_alias32_free( msh_alias32_t* table )
+{
+  MSH_SAMPLING_FREE( table->entries );
+  table->entries = NULL;
+  table->n = 0;
+}
+
+// High bits of r * n pick the entry, low bits are uniform enough to serve as the fraction
+// (as in Lemire's bounded random numbers), since threshold has no more bits than are left.
+MSH_SAMPLING_DEF int32_t
+msh_alias32_sample( const msh_alias32_t* table, uint32_t r )
+{
+  uint64_t m = (uint64_t)r * (uint32_t)table->n;
+  uint32_t i = (uint32_t)(m >> 32);
+  uint32_t frac = (uint32_t)m;
+  uint32_t e = table->entries[i];
+  uint32_t alias_mask = (1u << table->alias_bits) - 1u;
+  return ((frac >> table->alias_bits) < (e >> table->alias_bits)) ? (int32_t)i
+                                                                  : (int32_t)(e & alias_mask);
+}
+
+MSH_SAMPLING_DEF void
+msh_alias32_sample_n( const msh_alias32_t* table, msh_rand_ctx_t* rand_gen, int32_t* out, int n )
+{
+  for( int i = 0; i < n; ++i ) { out[i] = msh_alias32_sample( table, msh_rand_next( rand_gen ) ); }
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+// Continuous distributions
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+MSH_SAMPLING_DEF void
+msh_pwl_distrib_init( msh_pwl_distrib_t* d, const double* values, int n_values )
+{
+  assert( n_values >= 2 );
+  d->n_segments = n_values - 1;
+  d->segments = (msh_pwl_segment_t*)MSH_SAMPLING_MALLOC( d->n_segments * sizeof(msh_pwl_segment_t) );
+
+  double* areas = (double*)MSH_SAMPLING_MALLOC( d->n_segments * sizeof(double) );
+  msh_alias_entry_t* table = (msh_alias_entry_t*)MSH_SAMPLING_MALLOC( d->n_segments *
+                                                                     sizeof(msh_alias_entry_t) );
+  double integral = 0.0;
+  for( int i = 0; i < d->n_segments; ++i )
+  {
+    areas[i] = 0.5 * (values[i] + values[i+1]);
+    integral += areas[i];
+  }
+  integral /= d->n_segments;
+  msh_alias_table_build( areas, d->n_segments, table );
+
+  for( int i = 0; i < d->n_segments; ++i )
+  {
+    d->segments[i].prob  = table[i].prob;
+    d->segments[i].alias = table[i].alias;
+    d->segments[i].f0    = (float)values[i];
+    d->segments[i].f1    = (float)values[i+1];
+  }
+  d->inv_integral = (integral > 0.0) ? 1.0 / integral : 0.0;
+
+  MSH_SAMPLING_FREE( areas );
+  MSH_SAMPLING_FREE( table );
+}
+
+MSH_SAMPLING_DEF void
+msh_pwl_distrib_free( msh_pwl_distrib_t* d )
+{
+  MSH_SAMPLING_FREE( d->segments );
+  d->segments = NULL;
+  d->n_segments = 0;
+}
+
+// Returns x in [0,1]. If pdf is not NULL, density at x is written to it.
+MSH_SAMPLING_DEF double
+msh_pwl_distrib_sample( const msh_pwl_distrib_t* d, double u, double* pdf )
+{
+  int n = d->n_segments;
+  double x = u * n;
+  int i = msh_min( (int)x, n - 1 );
+  double f = x - i;
+  msh_pwl_segment_t s = d->segments[i];
+  if( f < s.prob ) { f = f / s.prob; }
+  else
+  {
+    f = (f - s.prob) / (1.0 - s.prob);
+    i = s.alias;
+    s = d->segments[i];
+  }
+
+  // Invert cdf of density f0 + (f1-f0)*t on [0,1]. This form is stable when f0 ~ f1.
+  double f0 = s.f0, f1 = s.f1;
+  double t = 0.0;
+  double denom = f0 + sqrt( f0*f0 + f*(f1*f1 - f0*f0) );
+  if( denom > 0.0 ) { t = msh_min( f * (f0 + f1) / denom, 1.0 ); }
+  if( pdf ) { *pdf = (f0 + (f1 - f0) * t) * d->inv_integral; }
+  return (i + t) / n;
+}
+
+MSH_SAMPLING_DEF void
+msh_pwl_distrib_sample_n( const msh_pwl_distrib_t* d, const double* u, double* x,
+                          double* pdf, int n_samples )
+{
+  if( pdf )
+  {
+    for( int i = 0; i < n_samples; ++i ) { x[i] = msh_pwl_distrib_sample( d, u[i], &pdf[i] ); }
+  }
+  else
+  {
+    for( int i = 0; i < n_samples; ++i ) { x[i] = msh_pwl_distrib_sample( d, u[i], NULL ); }
+  }
+}
+
+//----
+
+MSH_SAMPLING_DEF void
+msh_distrib2d_init( msh_distrib2d_t* d, const double* values, int width, int height )
+{
+  d->width = width;
+  d->height = height;
+  d->marginal = (msh_alias_entry_t*)MSH_SAMPLING_MALLOC( height * sizeof(msh_alias_entry_t) );
+  d->conditional = (msh_alias_entry_t*)MSH_SAMPLING_MALLOC( (size_t)width * height *
+                                                            sizeof(msh_alias_entry_t) );
+  d->density = (float*)MSH_SAMPLING_MALLOC( (size_t)width * height * sizeof(float) );
+
+  double* row_sums = (double*)MSH_SAMPLING_CALLOC( height, sizeof(double) );
+  double total = 0.0;
+  for( int y = 0; y < height; ++y )
+  {
+    const double* row = values + (size_t)y * width;
+    for( int x = 0; x < width; ++x ) { row_sums[y] += row[x]; }
+    total += row_sums[y];
+    msh_alias_table_build( row, width, d->conditional + (size_t)y * width );
+  }
+  msh_alias_table_build( row_sums, height, d->marginal );
+
+  // Density with respect to [0,1]^2 is value divided by the mean value.
+  double inv_mean = (total > 0.0) ? ((double)width * height / total) : 0.0;
+  for( size_t i = 0; i < (size_t)width * height; ++i ) { d->density[i] = (float)(values[i] * inv_mean); }
+
+  MSH_SAMPLING_FREE( row_sums );
+}
+
+MSH_SAMPLING_DEF void
+msh_distrib2d_free( msh_distrib2d_t* d )
+{
+  MSH_SAMPLING_FREE( d->marginal );
+  MSH_SAMPLING_FREE( d->conditional );
+  MSH_SAMPLING_FREE( d->density );
+  memset( d, 0, sizeof(*d) );
+}
+
+MSH_SAMPLING_DEF float
+msh_distrib2d_pdf( const msh_distrib2d_t* d, float x, float y )
+{
+  int px = msh_min( (int)(x * d->width), d->width - 1 );
+  int py = msh_min( (int)(y * d->height), d->height - 1 );
+  return d->density[ (size_t)py * d->width + px ];
+}
+
+// Rounding to float can push a coordinate close to the cell border into the next cell, which
+// could have zero probability. Step back so that msh_distrib2d_pdf agrees with the sampled cell.
+static inline float
+msh__distrib2d_coord( int cell, double u, int n )
+{
+  float x = (float)((cell + u) / n);
+  while( (int)(x * n) > cell ) { x = nextafterf( x, 0.0f ); }
+  return x;
+}
+
+// Maps (u0, u1) in [0,1)^2 to a point in [0,1)^2. Returns the pdf of the point.
+MSH_SAMPLING_DEF float
+msh_distrib2d_sample( const msh_distrib2d_t* d, double u0, double u1, float* x, float* y )
+{
+  double ux, uy;
+  int py = msh_alias_table_sample( d->marginal, d->height, u1, &uy );
+  int px = msh_alias_table_sample( d->conditional + (size_t)py * d->width, d->width, u0, &ux );
+  *x = msh__distrib2d_coord( px, ux, d->width );
+  *y = msh__distrib2d_coord( py, uy, d->height );
+  return d->density[ (size_t)py * d->width + px ];
+}
+
+// u holds 2*n_samples interleaved uniform numbers, xy receives 2*n_samples interleaved coordinates.
+MSH_SAMPLING_DEF void
+msh_distrib2d_sample_n( const msh_distrib2d_t* d, const double* u, float* xy, float* pdf,
+                        int n_samples )
+{
+  for( int i = 0; i < n_samples; ++i )
+  {
+    float p = msh_distrib2d_sample( d, u[2*i], u[2*i+1], &xy[2*i], &xy[2*i+1] );
+    if( pdf ) { pdf[i] = p; }
+  }
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+// Weighted sampling without replacement
+//
+// Keys of disjoint chunks are independent, so chunks can select their own k smallest candidates
+// in parallel, and the final selection only needs to look at k candidates per chunk.
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+// Partial selection (quickselect) - afterwards first k items have the k smallest keys, unordered.
+MSH_SAMPLING_DEF void
+msh_keyed_index_select( msh_keyed_index_t* items, int n, int k )
+{
+  int lo = 0, hi = n - 1;
+  int kth = k - 1;
+  while( lo < hi )
+  {
+    int mid = lo + (hi - lo) / 2;
+    double a = items[lo].key, b = items[mid].key, c = items[hi].key;
+    double pivot = (a < b) ? ((b < c) ? b : ((a < c) ? c : a))
+                           : ((a < c) ? a : ((b < c) ? c : b));
+    int i = lo, j = hi;
+    while( i <= j )
+    {
+      while( items[i].key < pivot ) { i++; }
+      while( items[j].key > pivot ) { j--; }
+      if( i <= j )
+      {
+        msh_keyed_index_t tmp = items[i];
+        items[i++] = items[j];
+        items[j--] = tmp;
+      }
+    }
+    if( kth <= j )      { hi = j; }
+    else if( kth >= i ) { lo = i; }
+    else                { break; }
+  }
+}
+
+// Keys items [first, first+n) of weights. Scratch needs space for n items; on return it holds
+// the best min(k, n_positive) candidates of this chunk, and their count is returned.
+MSH_SAMPLING_DEF int
+msh_weighted_sample_chunk( const double* weights, int first, int n, int k,
+                           msh_rand_ctx_t* rand_gen, msh_keyed_index_t* scratch )
+{
+  int n_valid = 0;
+  for( int i = first; i < first + n; ++i )
+  {
+    if( weights[i] <= 0.0 ) { continue; }
+    scratch[n_valid].key = msh__sampling_nextexp( rand_gen ) / weights[i];
+    scratch[n_valid].idx = i;
+    n_valid++;
+  }
+  if( n_valid > k )
+  {
+    msh_keyed_index_select( scratch, n_valid, k );
+    n_valid = k;
+  }
+  return n_valid;
+}
+
+MSH_SAMPLING_DEF int
+msh_weighted_sample( const double* weights, int n, int k, msh_rand_ctx_t* rand_gen,
+                     int32_t* indices )
+{
+  k = msh_max( 0, msh_min( k, n ) );
+  msh_keyed_index_t* scratch = (msh_keyed_index_t*)MSH_SAMPLING_MALLOC( n * sizeof(msh_keyed_index_t) );
+  int n_selected = msh_weighted_sample_chunk( weights, 0, n, k, rand_gen, scratch );
+  for( int i = 0; i < n_selected; ++i ) { indices[i] = scratch[i].idx; }
+  MSH_SAMPLING_FREE( scratch );
+  return n_selected;
+}
+
+//----
+
+// Streaming weighted reservoir with exponential jumps (A-ExpJ). Keeps the k smallest keys in a
+// max-heap. Instead of keying every item, we draw how much weight can be skipped before next
+// item enters the reservoir, so random numbers are only generated for the O(k log(n/k))
+// insertions. A reservoir with k <= 0 keeps nothing.
+MSH_SAMPLING_DEF void
+msh_reservoir_init( msh_reservoir_t* res, int k, uint64_t seed )
+{
+  res->k = msh_max( k, 0 );
+  res->count = 0;
+  res->skip = 0.0;
+  res->heap = res->k ? (msh_keyed_index_t*)MSH_SAMPLING_MALLOC( res->k * sizeof(msh_keyed_index_t) )
+                     : NULL;
+  msh_rand_init( &res->rand_gen, seed );
+}
+
+MSH_SAMPLING_DEF void
+msh_reservoir_free( msh_reservoir_t* res )
+{
+  MSH_SAMPLING_FREE( res->heap );
+  memset( res, 0, sizeof(*res) );
+}
+
+static void
+msh__reservoir_sift_down( msh_keyed_index_t* heap, int n, int i )
+{
+  msh_keyed_index_t item = heap[i];
+  for( ;; )
+  {
+    int c = 2 * i + 1;
+    if( c >= n ) { break; }
+    if( c + 1 < n && heap[c+1].key > heap[c].key ) { c++; }
+    if( heap[c].key <= item.key ) { break; }
+    heap[i] = heap[c];
+    i = c;
+  }
+  heap[i] = item;
+}
+
+MSH_SAMPLING_DEF void
+msh_reservoir_push( msh_reservoir_t* res, int32_t idx, double w )
+{
+  if( w <= 0.0 || res->k == 0 ) { return; }
+
+  if( res->count < res->k )
+  {
+    int i = res->count++;
+    msh_keyed_index_t item = { msh__sampling_nextexp( &res->rand_gen ) / w, idx };
+    while( i > 0 && res->heap[(i - 1) / 2].key < item.key )
+    {
+      res->heap[i] = res->heap[(i - 1) / 2];
+      i = (i - 1) / 2;
+    }
+    res->heap[i] = item;
+    if( res->count == res->k )
+    {
+      res->skip = msh__sampling_nextexp( &res->rand_gen ) / res->heap[0].key;
+    }
+    return;
+  }
+
+  res->skip -= w;
+  if( res->skip > 0.0 ) { return; }
+
+  // Item enters the reservoir, so its key is conditioned to be below current threshold.
+  double threshold = res->heap[0].key;
+  double e = exp( -w * threshold );
+  double u = e + (1.0 - e) * msh_sampling_nextd( &res->rand_gen );
+  res->heap[0].key = msh_min( -log( u ) / w, threshold );
+  res->heap[0].idx = idx;
+  msh__reservoir_sift_down( res->heap, res->count, 0 );
+  res->skip = msh__sampling_nextexp( &res->rand_gen ) / res->heap[0].key;
+}
+
+// Returns number of indices written, min(k, number of items with positive weight pushed so far).
+MSH_SAMPLING_DEF int
+msh_reservoir_get( const msh_reservoir_t* res, int32_t* indices )
+{
+  for( int i = 0; i < res->count; ++i ) { indices[i] = res->heap[i].idx; }
+  return res->count;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+// Validation
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+// Upper tail of chi-square distribution, Wilson-Hilferty approximation.
+MSH_SAMPLING_DEF double
+msh_sampling_chi2_pvalue( double chi2, int dof )
+{
+  if( dof <= 0 ) { return 1.0; }
+  double k = dof;
+  double z = (pow( chi2 / k, 1.0 / 3.0 ) - (1.0 - 2.0 / (9.0 * k))) / sqrt( 2.0 / (9.0 * k) );
+  return 0.5 * erfc( z / sqrt( 2.0 ) );
+}
+
+// Chi-square with pooling of adjacent cells, so that each group expects enough samples.
+// Leftover cells at the end are merged into the last group.
+static void
+msh__sampling_chi2( const double* pdf, const double* counts, int n_cells, int n_samples,
+                    msh_sampling_test_t* test )
+{
+  double min_expected = msh_max( 5.0, n_samples / 1024.0 );
+  double group_expected = 0.0, group_observed = 0.0;
+  double last_expected = 0.0, last_observed = 0.0;
+  double chi2 = 0.0;
+  int n_groups = 0;
+  for( int i = 0; i < n_cells; ++i )
+  {
+    if( pdf[i] == 0.0 && counts[i] > 0.0 ) { test->n_impossible += (int)counts[i]; }
+    group_expected += pdf[i] * n_samples;
+    group_observed += counts[i];
+    int is_last = (i == n_cells - 1);
+    if( group_expected < min_expected && !is_last ) { continue; }
+    if( group_expected < min_expected && n_groups > 0 )
+    {
+      double d = last_observed - last_expected;
+      chi2 -= d * d / last_expected;
+      group_expected += last_expected;
+      group_observed += last_observed;
+      n_groups--;
+    }
+    if( group_expected > 0.0 )
+    {
+      double d = group_observed - group_expected;
+      chi2 += d * d / group_expected;
+    }
+    n_groups++;
+    last_expected = group_expected;
+    last_observed = group_observed;
+    group_expected = group_observed = 0.0;
+  }
+  test->chi2 = chi2;
+  test->dof = n_groups - 1;
+  test->p_value = msh_sampling_chi2_pvalue( chi2, test->dof );
+}
+
+// Samples are indices into pdf, and the cdf is compared at cell boundaries.
+MSH_SAMPLING_DEF void
+msh_sampling_test_discrete( const double* pdf, int n, const int32_t* samples, int n_samples,
+                            msh_sampling_test_t* test )
+{
+  memset( test, 0, sizeof(*test) );
+  double* counts = (double*)MSH_SAMPLING_CALLOC( n, sizeof(double) );
+  for( int i = 0; i < n_samples; ++i )
+  {
+    if( samples[i] < 0 || samples[i] >= n ) { test->n_impossible++; }
+    else                                    { counts[samples[i]]++; }
+  }
+  msh__sampling_chi2( pdf, counts, n, n_samples, test );
+  test->ks_crit = 1.95 / sqrt( (double)n_samples ); // alpha = 0.001
+
+  double cdf = 0.0, ecdf = 0.0;
+  for( int i = 0; i < n; ++i )
+  {
+    cdf += pdf[i];
+    ecdf += counts[i] / n_samples;
+    test->ks_d = msh_max( test->ks_d, fabs( cdf - ecdf ) );
+  }
+  MSH_SAMPLING_FREE( counts );
+}
+
+static int
+msh__sampling_compare_doubles( const void* a, const void* b )
+{
+  double x = *(const double*)a, y = *(const double*)b;
+  return (x > y) - (x < y);
+}
+
+// Samples are in [0,1], as returned by msh_pwl_distrib_sample. Chi-square runs over segments,
+// and sorted samples are compared against the piecewise-linear cdf.
+MSH_SAMPLING_DEF void
+msh_sampling_test_pwl( const double* values, int n_values, const double* samples, int n_samples,
+                       msh_sampling_test_t* test )
+{
+  memset( test, 0, sizeof(*test) );
+  int n_cells = n_values - 1;
+  double* pdf = (double*)MSH_SAMPLING_MALLOC( n_cells * sizeof(double) );
+  double* counts = (double*)MSH_SAMPLING_CALLOC( n_cells, sizeof(double) );
+  double* cum = (double*)MSH_SAMPLING_MALLOC( (n_cells + 1) * sizeof(double) );
+  double* sorted = (double*)MSH_SAMPLING_MALLOC( n_samples * sizeof(double) );
+
+  double sum = 0.0;
+  for( int i = 0; i < n_cells; ++i ) { pdf[i] = 0.5 * (values[i] + values[i+1]); sum += pdf[i]; }
+  for( int i = 0; i < n_cells; ++i ) { pdf[i] /= sum; }
+  cum[0] = 0.0;
+  for( int i = 0; i < n_cells; ++i ) { cum[i+1] = cum[i] + pdf[i]; }
+
+  for( int i = 0; i < n_samples; ++i )
+  {
+    double x = samples[i] * n_cells;
+    if( !(x >= 0.0 && x <= n_cells) ) { test->n_impossible++; }
+    else                              { counts[msh_min( (int)x, n_cells - 1 )]++; }
+    sorted[i] = x;
+  }
+  msh__sampling_chi2( pdf, counts, n_cells, n_samples, test );
+  test->ks_crit = 1.95 / sqrt( (double)n_samples ); // alpha = 0.001
+
+  qsort( sorted, n_samples, sizeof(double), msh__sampling_compare_doubles );
+  for( int i = 0; i < n_samples; ++i )
+  {
+    double x = sorted[i];
+    int s = msh_clamp( (int)x, 0, n_cells - 1 );
+    double t = msh_clamp( x - s, 0.0, 1.0 );
+    double f0 = values[s], f1 = values[s+1];
+    double area = 0.5 * (f0 + f1);
+    double partial = (area > 0.0) ? (f0 * t + 0.5 * (f1 - f0) * t * t) / area : 0.0;
+    double cdf = cum[s] + pdf[s] * partial;
+    test->ks_d = msh_max( test->ks_d, msh_max( fabs( (i + 1.0) / n_samples - cdf ),
+                                               fabs( (double)i / n_samples - cdf ) ) );
+  }
+
+  MSH_SAMPLING_FREE( pdf );
+  MSH_SAMPLING_FREE( counts );
+  MSH_SAMPLING_FREE( cum );
+  MSH_SAMPLING_FREE( sorted );
+}
+
+MSH_SAMPLING_DEF int
+msh_sampling_test_passed( const msh_sampling_test_t* test )
+{
+  return test->n_impossible == 0 && test->p_value > 1e-3 && test->ks_d < test->ks_crit;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+// Parallel construction
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+#ifdef MSH_JOBS_H
+
+typedef struct msh__weighted_sample_task
+{
+  const double* weights;
+  int first, n, k, n_selected;
+  uint64_t seed;
+  msh_keyed_index_t* scratch;
+} msh__weighted_sample_task_t;
+
+static void
+msh__weighted_sample_worker( void* data, size_t start, size_t end )
+{
+  msh__weighted_sample_task_t* tasks = (msh__weighted_sample_task_t*)data;
+  for( size_t t = start; t < end; ++t )
+  {
+    msh__weighted_sample_task_t* task = &tasks[t];
+    msh_rand_ctx_t rand_gen = {0};
+    msh_rand_init( &rand_gen, task->seed );
+    task->n_selected = msh_weighted_sample_chunk( task->weights, task->first, task->n, task->k,
+                                                  &rand_gen, task->scratch );
+  }
+}
+
+MSH_SAMPLING_DEF int
+msh_weighted_sample_mt( const double* weights, int n, int k, msh_jobs_t* jobs, uint64_t seed,
+                        int32_t* indices )
+{
+  if( !jobs )
+  {
+    msh_rand_ctx_t rand_gen = {0};
+    msh_rand_init( &rand_gen, seed );
+    return msh_weighted_sample( weights, n, k, &rand_gen, indices );
+  }
+  k = msh_max( 0, msh_min( k, n ) );
+  int n_chunks = msh_jobs_n_threads( jobs );
+  msh_keyed_index_t* scratch = (msh_keyed_index_t*)MSH_SAMPLING_MALLOC( n * sizeof(msh_keyed_index_t) );
+  msh__weighted_sample_task_t* tasks =
+    (msh__weighted_sample_task_t*)MSH_SAMPLING_MALLOC( n_chunks * sizeof(msh__weighted_sample_task_t) );
+  for( int t = 0; t < n_chunks; ++t )
+  {
+    int first = (int)((int64_t)n * t / n_chunks);
+    int last  = (int)((int64_t)n * (t + 1) / n_chunks);
+    tasks[t].weights = weights;
+    tasks[t].first   = first;
+    tasks[t].n       = last - first;
+    tasks[t].k       = k;
+    tasks[t].seed    = seed + 7919ULL * t;
+    tasks[t].scratch = scratch + first;
+  }
+  msh_jobs_parallel_for( jobs, n_chunks, 1, msh__weighted_sample_worker, tasks );
+
+  int n_candidates = 0;
+  for( int t = 0; t < n_chunks; ++t )
+  {
+    memmove( scratch + n_candidates, tasks[t].scratch,
+             tasks[t].n_selected * sizeof(msh_keyed_index_t) );
+    n_candidates += tasks[t].n_selected;
+  }
+  if( n_candidates > k )
+  {
+    msh_keyed_index_select( scratch, n_candidates, k );
+    n_candidates = k;
+  }
+  for( int i = 0; i < n_candidates; ++i ) { indices[i] = scratch[i].idx; }
+
+  MSH_SAMPLING_FREE( tasks );
+  MSH_SAMPLING_FREE( scratch );
+  return n_candidates;
+}
+
+//----
+
+// Vose's algorithm pairs light and heavy items in whatever order its work lists give, but the
+// sweeping variant pairs them in index order, and that pairing is fully determined by prefix
+// sums - light item i gets the heavy item whose range of surplus [S(j), S(j+1)) contains D(i),
+// the total deficit of lights before i. Heavy item j keeps whatever is left after covering
+// everything up to S(j+1), and aliases to heavy item j+1. Hence the construction is:
+//   1. sum of weights
+//   2. classify into light/heavy and count per chunk
+//   3. scatter into light/heavy lists with per-chunk prefix sums of deficit/surplus
+//   4. add chunk offsets to prefix sums
+//   5. sweep lights and heavies, each thread starting from a binary search
+// Each step runs in parallel, and only the per-chunk totals are combined serially.
+
+typedef struct msh__alias_mt_ctx
+{
+  const double* weights;
+  double scale;
+  int32_t* light_idx;
+  int32_t* heavy_idx;
+  double* deficit;      // exclusive prefix sum, n_light + 1 entries
+  double* surplus;      // exclusive prefix sum, n_heavy + 1 entries
+  int n_light, n_heavy;
+  uint64_t* entries;
+} msh__alias_mt_ctx_t;
+
+typedef struct msh__alias_mt_task
+{
+  msh__alias_mt_ctx_t* ctx;
+  int first, last;
+  int light_first, light_last;
+  int heavy_first, heavy_last;
+  int light_offset, heavy_offset;
+  int n_light, n_heavy;
+  double sum, deficit_sum, surplus_sum;
+  double deficit_offset, surplus_offset;
+} msh__alias_mt_task_t;
+
+static void
+msh__alias_mt_sum( void* data, size_t start, size_t end )
+{
+  msh__alias_mt_task_t* tasks = (msh__alias_mt_task_t*)data;
+  for( size_t t = start; t < end; ++t )
+  {
+    msh__alias_mt_task_t* task = &tasks[t];
+    task->sum = 0.0;
+    for( int i = task->first; i < task->last; ++i ) { task->sum += task->ctx->weights[i]; }
+  }
+}
+
+static void
+msh__alias_mt_classify( void* data, size_t start, size_t end )
+{
+  msh__alias_mt_task_t* tasks = (msh__alias_mt_task_t*)data;
+  for( size_t t = start; t < end; ++t )
+  {
+    msh__alias_mt_task_t* task = &tasks[t];
+    msh__alias_mt_ctx_t* ctx = task->ctx;
+    task->n_light = task->n_heavy = 0;
+    for( int i = task->first; i < task->last; ++i )
+    {
+      if( ctx->weights[i] * ctx->scale < 1.0 ) { task->n_light++; }
+      else                                     { task->n_heavy++; }
+    }
+  }
+}
+
+static void
+msh__alias_mt_scatter( void* data, size_t start, size_t end )
+{
+  msh__alias_mt_task_t* tasks = (msh__alias_mt_task_t*)data;
+  for( size_t t = start; t < end; ++t )
+  {
+    msh__alias_mt_task_t* task = &tasks[t];
+    msh__alias_mt_ctx_t* ctx = task->ctx;
+    int li = task->light_offset, hi = task->heavy_offset;
+    double deficit = 0.0, surplus = 0.0;
+    for( int i = task->first; i < task->last; ++i )
+    {
+      double w = ctx->weights[i] * ctx->scale;
+      if( w < 1.0 ) { ctx->light_idx[li] = i; ctx->deficit[li++] = deficit; deficit += 1.0 - w; }
+      else          { ctx->heavy_idx[hi] = i; ctx->surplus[hi++] = surplus; surplus += w - 1.0; }
+    }
+    task->deficit_sum = deficit;
+    task->surplus_sum = surplus;
+  }
+}
+
+static void
+msh__alias_mt_offset( void* data, size_t start, size_t end )
+{
+  msh__alias_mt_task_t* tasks = (msh__alias_mt_task_t*)data;
+  for( size_t t = start; t < end; ++t )
+  {
+    msh__alias_mt_task_t* task = &tasks[t];
+    msh__alias_mt_ctx_t* ctx = task->ctx;
+    for( int i = 0; i < task->n_light; ++i ) { ctx->deficit[task->light_offset + i] += task->deficit_offset; }
+    for( int i = 0; i < task->n_heavy; ++i ) { ctx->surplus[task->heavy_offset + i] += task->surplus_offset; }
+  }
+}
+
+// First index in sorted values[0..n) that is not less than (or with strict, greater than) x.
+static inline int
+msh__alias_mt_search( const double* values, int n, double x, int strict )
+{
+  int lo = 0, hi = n;
+  while( lo < hi )
+  {
+    int mid = lo + (hi - lo) / 2;
+    if( strict ? (values[mid] <= x) : (values[mid] < x) ) { lo = mid + 1; }
+    else                                                  { hi = mid; }
+  }
+  return lo;
+}
+
+static void
+msh__alias_mt_sweep( void* data, size_t start, size_t end )
+{
+  msh__alias_mt_task_t* tasks = (msh__alias_mt_task_t*)data;
+  for( size_t t = start; t < end; ++t )
+  {
+    msh__alias_mt_task_t* task = &tasks[t];
+    msh__alias_mt_ctx_t* ctx = task->ctx;
+    const double* deficit = ctx->deficit;
+    const double* surplus = ctx->surplus;
+    int nl = ctx->n_light, nh = ctx->n_heavy;
+
+    if( task->light_first < task->light_last )
+    {
+      int j = msh__alias_mt_search( surplus + 1, nh, deficit[task->light_first], 1 );
+      for( int i = task->light_first; i < task->light_last; ++i )
+      {
+        while( j < nh - 1 && surplus[j+1] <= deficit[i] ) { j++; }
+        int32_t idx = ctx->light_idx[i];
+        int32_t alias = (nh > 0) ? ctx->heavy_idx[msh_min( j, nh - 1 )] : idx;
+        uint64_t threshold = msh__alias_threshold( ctx->weights[idx] * ctx->scale, 32, &alias, idx );
+        ctx->entries[idx] = (threshold << 32) | (uint32_t)alias;
+      }
+    }
+
+    if( task->heavy_first < task->heavy_last )
+    {
+      int i = msh__alias_mt_search( deficit, nl, surplus[task->heavy_first + 1], 0 );
+      for( int j = task->heavy_first; j < task->heavy_last; ++j )
+      {
+        while( i < nl && deficit[i] < surplus[j+1] ) { i++; }
+        int32_t idx = ctx->heavy_idx[j];
+        int32_t alias = (j + 1 < nh) ? ctx->heavy_idx[j+1] : idx;
+        double prob = (j + 1 < nh) ? (1.0 + surplus[j+1] - deficit[i]) : 1.0;
+        prob = msh_max( prob, 0.0 );
+        uint64_t threshold = msh__alias_threshold( prob, 32, &alias, idx );
+        ctx->entries[idx] = (threshold << 32) | (uint32_t)alias;
+      }
+    }
+  }
+}
+
+MSH_SAMPLING_DEF void
+msh_alias64_init_mt( msh_alias64_t* table, const double* weights, int n, msh_jobs_t* jobs )
+{
+  if( !jobs )
+  {
+    msh_alias64_init( table, weights, n );
+    return;
+  }
+  int n_threads = msh_max( 1, msh_min( msh_jobs_n_threads( jobs ), n ) );
+  msh__alias_mt_ctx_t ctx;
+  memset( &ctx, 0, sizeof(ctx) );
+  ctx.weights = weights;
+  msh__alias_mt_task_t* tasks =
+    (msh__alias_mt_task_t*)MSH_SAMPLING_CALLOC( n_threads, sizeof(msh__alias_mt_task_t) );
+  for( int t = 0; t < n_threads; ++t )
+  {
+    tasks[t].ctx   = &ctx;
+    tasks[t].first = (int)((int64_t)n * t / n_threads);
+    tasks[t].last  = (int)((int64_t)n * (t + 1) / n_threads);
+  }
+  table->n = n;
+  table->entries = (uint64_t*)MSH_SAMPLING_MALLOC( n * sizeof(uint64_t) );
+  ctx.entries = table->entries;
+
+  msh_jobs_parallel_for( jobs, n_threads, 1, msh__alias_mt_sum, tasks );
+  double sum = 0.0;
+  for( int t = 0; t < n_threads; ++t ) { sum += tasks[t].sum; }
+  // With zero sum all items are light and alias themselves, so the table is uniform.
+  ctx.scale = (sum > 0.0) ? (n / sum) : 0.0;
+
+  msh_jobs_parallel_for( jobs, n_threads, 1, msh__alias_mt_classify, tasks );
+  for( int t = 0; t < n_threads; ++t )
+  {
+    tasks[t].light_offset = ctx.n_light;
+    tasks[t].heavy_offset = ctx.n_heavy;
+    ctx.n_light += tasks[t].n_light;
+    ctx.n_heavy += tasks[t].n_heavy;
+  }
+  ctx.light_idx = (int32_t*)MSH_SAMPLING_MALLOC( (ctx.n_light + 1) * sizeof(int32_t) );
+  ctx.heavy_idx = (int32_t*)MSH_SAMPLING_MALLOC( (ctx.n_heavy + 1) * sizeof(int32_t) );
+  ctx.deficit   = (double*)MSH_SAMPLING_MALLOC( (ctx.n_light + 1) * sizeof(double) );
+  ctx.surplus   = (double*)MSH_SAMPLING_MALLOC( (ctx.n_heavy + 1) * sizeof(double) );
+
+  msh_jobs_parallel_for( jobs, n_threads, 1, msh__alias_mt_scatter, tasks );
+  double deficit = 0.0, surplus = 0.0;
+  for( int t = 0; t < n_threads; ++t )
+  {
+    tasks[t].deficit_offset = deficit;
+    tasks[t].surplus_offset = surplus;
+    deficit += tasks[t].deficit_sum;
+    surplus += tasks[t].surplus_sum;
+  }
+  ctx.deficit[ctx.n_light] = deficit;
+  ctx.surplus[ctx.n_heavy] = surplus;
+  msh_jobs_parallel_for( jobs, n_threads, 1, msh__alias_mt_offset, tasks );
+
+  for( int t = 0; t < n_threads; ++t )
+  {
+    tasks[t].light_first = (int)((int64_t)ctx.n_light * t / n_threads);
+    tasks[t].light_last  = (int)((int64_t)ctx.n_light * (t + 1) / n_threads);
+    tasks[t].heavy_first = (int)((int64_t)ctx.n_heavy * t / n_threads);
+    tasks[t].heavy_last  = (int)((int64_t)ctx.n_heavy * (t + 1) / n_threads);
+  }
+  msh_jobs_parallel_for( jobs, n_threads, 1, msh__alias_mt_sweep, tasks );
+
+  MSH_SAMPLING_FREE( ctx.light_idx );
+  MSH_SAMPLING_FREE( ctx.heavy_idx );
+  MSH_SAMPLING_FREE( ctx.deficit );
+  MSH_SAMPLING_FREE( ctx.surplus );
+  MSH_SAMPLING_FREE( tasks );
+}
+
+#endif /* MSH_JOBS_H */
+
+#endif /* MSH_SAMPLING_IMPLEMENTATION */
@@ -0,0 +1,477 @@
+/*
+  ==============================================================================
+
+  MSH_SORT.H v0.1
+
+  A single header library with sorting primitives for keys with optional uint32 payloads
+  (typically indices):
+
+    - LSD radix sort for uint32, uint64 and float keys
+    - parallel variant of the radix sort, running on msh_jobs.h
+    - sorting networks for small arrays
+
+  To use the library you simply add:
+
+  #define MSH_SORT_IMPLEMENTATION
+  #include "msh_sort.h"
+
+  ==============================================================================
+  DOCUMENTATION
+
+  Radix sort
+    msh_radix_sort_u32( keys, vals, n );
+    msh_radix_sort_u64( keys, vals, n );
+    msh_radix_sort_f32( keys, vals, n );
+
+    Sorts keys in ascending order and applies the same permutation to vals, which may be NULL.
+    Sort is stable. It processes 8 bits per pass, and histograms for all passes are computed
+    in a single read of the keys, so passes in which all keys share the same digit (e.g. high
+    bytes of small integers) are skipped. Temporary buffers of the size of the input are
+    allocated internally. Floats are mapped to unsigned integers with the same ordering, so
+    negative values and -0.0 sort correctly; NaNs are placed after +inf, or before -inf if
+    their sign bit is set.
+
+    Arrays of at most MSH_SORT_SMALL_N elements are sorted with a sorting network if there is
+    no payload, or with insertion sort otherwise, to keep the sort stable.
+
+  Parallel radix sort
+    msh_radix_sort_u32_mt( keys, vals, n, jobs );
+    ...
+
+    Available when msh_jobs.h is included first. Keys are split into contiguous chunks, one per
+    thread of 'jobs'. In every pass chunk histograms are computed in parallel and turned into
+    per-chunk output offsets, so that the parallel scatter stays stable. No threads are created;
+    both phases run with msh_jobs_parallel_for. Inputs smaller than MSH_SORT_MT_MIN_N, or 'jobs'
+    equal to NULL, are sorted on the calling thread.
+
+  Sorting networks
+    msh_sort_network_u32( keys, vals, n );
+    msh_sort_network_f32( keys, vals, n );
+
+    Batcher's merge exchange network (Knuth, TAOCP vol. 3, Algorithm 5.2.2M) for any n, built
+    from branchless compare-exchange operations. Not stable. Best for n up to a few dozen,
+    e.g. sorting k nearest neighbors by distance.
+
+  ==============================================================================
+  AUTHORS:
+    Maciej Halber
+
+  LICENSE:
+    CC0
+  ==============================================================================
+*/
+
+#ifndef MSH_SORT_H
+#define MSH_SORT_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#ifndef MSH_SORT_DEF
+#ifdef MSH_SORT_STATIC
+#define MSH_SORT_DEF static
+#else
+#define MSH_SORT_DEF extern
+#endif
+#endif
+
+#ifndef MSH_SORT_SMALL_N
+#define MSH_SORT_SMALL_N 32
+#endif
+
+#ifndef MSH_SORT_MT_MIN_N
+#define MSH_SORT_MT_MIN_N (1 << 16)
+#endif
+
+MSH_SORT_DEF void msh_radix_sort_u32( uint32_t* keys, uint32_t* vals, size_t n );
+MSH_SORT_DEF void msh_radix_sort_u64( uint64_t* keys, uint32_t* vals, size_t n );
+MSH_SORT_DEF void msh_radix_sort_f32( float* keys, uint32_t* vals, size_t n );
+
+#ifdef MSH_JOBS_H
+MSH_SORT_DEF void msh_radix_sort_u32_mt( uint32_t* keys, uint32_t* vals, size_t n, msh_jobs_t* jobs );
+MSH_SORT_DEF void msh_radix_sort_u64_mt( uint64_t* keys, uint32_t* vals, size_t n, msh_jobs_t* jobs );
+MSH_SORT_DEF void msh_radix_sort_f32_mt( float* keys, uint32_t* vals, size_t n, msh_jobs_t* jobs );
+#endif
+
+MSH_SORT_DEF void msh_sort_network_u32( uint32_t* keys, uint32_t* vals, size_t n );
+MSH_SORT_DEF void msh_sort_network_u64( uint64_t* keys, uint32_t* vals, size_t n );
+MSH_SORT_DEF void msh_sort_network_f32( float* keys, uint32_t* vals, size_t n );
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* MSH_SORT_H */
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+// IMPLEMENTATION
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+#ifdef MSH_SORT_IMPLEMENTATION
+
+// Temporary buffers of radix sorts are tracked under "msh_sort" when msh_mem.h is included first.
+#ifndef MSH_SORT_MALLOC
+#ifdef MSH_MEM_H
+#define MSH_SORT_MALLOC( size ) msh_mem_alloc( "msh_sort", size )
+#define MSH_SORT_FREE( ptr )    msh_mem_free( ptr )
+#else
+#define MSH_SORT_MALLOC( size ) malloc( size )
+#define MSH_SORT_FREE( ptr )    free( ptr )
+#endif
+#endif
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+// Sorting networks
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+// Calls 'cmpx(i, j)' for every comparator of merge exchange network for n elements, i < j.
+#define MSH__SORT_NETWORK( n, cmpx )                                                               \
+  do {                                                                                             \
+    size_t msh__t = 0;                                                                             \
+    while( ((size_t)1 << msh__t) < (n) ) { msh__t++; }                                             \
+    for( size_t msh__p = (size_t)1 << (msh__t - 1); msh__p > 0; msh__p >>= 1 )                     \
+    {                                                                                              \
+      size_t msh__q = (size_t)1 << (msh__t - 1), msh__r = 0, msh__d = msh__p;                      \
+      for( ;; )                                                                                    \
+      {                                                                                            \
+        for( size_t msh__i = 0; msh__i + msh__d < (n); ++msh__i )                                  \
+        {                                                                                          \
+          if( (msh__i & msh__p) == msh__r ) { cmpx( msh__i, msh__i + msh__d ); }                   \
+        }                                                                                          \
+        if( msh__q == msh__p ) { break; }                                                          \
+        msh__d = msh__q - msh__p; msh__q >>= 1; msh__r = msh__p;                                   \
+      }                                                                                            \
+    }                                                                                              \
+  } while( 0 )
+
+// Compare-exchange written with selects, which compilers turn into conditional moves.
+#define MSH__CMPX_KEYS( i, j )                                                                     \
+  do {                                                                                             \
+    msh__key_t msh__a = keys[i], msh__b = keys[j];                                                 \
+    int msh__swap = msh__b < msh__a;                                                               \
+    keys[i] = msh__swap ? msh__b : msh__a;                                                         \
+    keys[j] = msh__swap ? msh__a : msh__b;                                                         \
+  } while( 0 )
+
+#define MSH__CMPX_PAIRS( i, j )                                                                    \
+  do {                                                                                             \
+    msh__key_t msh__a = keys[i], msh__b = keys[j];                                                 \
+    uint32_t msh__va = vals[i], msh__vb = vals[j];                                                 \
+    int msh__swap = msh__b < msh__a;                                                               \
+    keys[i] = msh__swap ? msh__b : msh__a;                                                         \
+    keys[j] = msh__swap ? msh__a : msh__b;                                                         \
+    vals[i] = msh__swap ? msh__vb : msh__va;                                                       \
+    vals[j] = msh__swap ? msh__va : msh__vb;                                                       \
+  } while( 0 )
+
+#define MSH__SORT_NETWORK_FN( name, key_type )                                                     \
+  MSH_SORT_DEF void                                                                                \
+  name( key_type* keys, uint32_t* vals, size_t n )                                                 \
+  {                                                                                                \
+    typedef key_type msh__key_t;                                                                   \
+    if( n < 2 ) { return; }                                                                        \
+    if( vals ) { MSH__SORT_NETWORK( n, MSH__CMPX_PAIRS ); }                                        \
+    else       { MSH__SORT_NETWORK( n, MSH__CMPX_KEYS ); }                                         \
+  }
+
+MSH__SORT_NETWORK_FN( msh_sort_network_u32, uint32_t )
+MSH__SORT_NETWORK_FN( msh_sort_network_u64, uint64_t )
+MSH__SORT_NETWORK_FN( msh_sort_network_f32, float )
+
+// Stable path for small arrays with payload.
+#define MSH__INSERTION_SORT_FN( name, key_type )                                                   \
+  static void                                                                                      \
+  name( key_type* keys, uint32_t* vals, size_t n )                                                 \
+  {                                                                                                \
+    for( size_t i = 1; i < n; ++i )                                                                \
+    {                                                                                              \
+      key_type key = keys[i];                                                                      \
+      uint32_t val = vals[i];                                                                      \
+      size_t j = i;                                                                                \
+      for( ; j > 0 && key < keys[j - 1]; --j ) { keys[j] = keys[j - 1]; vals[j] = vals[j - 1]; }   \
+      keys[j] = key;                                                                               \
+      vals[j] = val;                                                                               \
+    }                                                                                              \
+  }
+
+MSH__INSERTION_SORT_FN( msh__insertion_sort_u32, uint32_t )
+MSH__INSERTION_SORT_FN( msh__insertion_sort_u64, uint64_t )
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+// Radix sort
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+// Float to unsigned integer mapping that preserves ordering, and its inverse.
+static inline uint32_t
+msh__sort_f32_to_u32( uint32_t u )
+{
+  return u ^ ((uint32_t)(-(int32_t)(u >> 31)) | 0x80000000u);
+}
+
+static inline uint32_t
+msh__sort_u32_to_f32( uint32_t u )
+{
+  return u ^ (((u >> 31) - 1) | 0x80000000u);
+}
+
+#define MSH__RADIX_SORT_FN( name, key_type, n_passes, small_sort )                                 \
+  static void                                                                                      \
+  name( key_type* keys, uint32_t* vals, size_t n )                                                 \
+  {                                                                                                \
+    if( n <= MSH_SORT_SMALL_N ) { small_sort( keys, vals, n ); return; }                           \
+    size_t hist[n_passes][256];                                                                    \
+    memset( hist, 0, sizeof(hist) );                                                               \
+    for( size_t i = 0; i < n; ++i )                                                                \
+    {                                                                                              \
+      key_type key = keys[i];                                                                      \
+      for( int p = 0; p < n_passes; ++p ) { hist[p][(key >> (8 * p)) & 0xFF]++; }                  \
+    }                                                                                              \
+                                                                                                   \
+    key_type* tmp_keys = (key_type*)MSH_SORT_MALLOC( n * sizeof(key_type) );                       \
+    uint32_t* tmp_vals = vals ? (uint32_t*)MSH_SORT_MALLOC( n * sizeof(uint32_t) ) : NULL;         \
+    key_type* src_keys = keys; key_type* dst_keys = tmp_keys;                                      \
+    uint32_t* src_vals = vals; uint32_t* dst_vals = tmp_vals;                                      \
+    for( int p = 0; p < n_passes; ++p )                                                            \
+    {                                                                                              \
+      int shift = 8 * p;                                                                           \
+      if( hist[p][(src_keys[0] >> shift) & 0xFF] == n ) { continue; }                              \
+      size_t offsets[256];                                                                         \
+      size_t sum = 0;                                                                              \
+      for( int b = 0; b < 256; ++b ) { offsets[b] = sum; sum += hist[p][b]; }                      \
+      if( src_vals )                                                                               \
+      {                                                                                            \
+        for( size_t i = 0; i < n; ++i )                                                            \
+        {                                                                                          \
+          size_t dst = offsets[(src_keys[i] >> shift) & 0xFF]++;                                   \
+          dst_keys[dst] = src_keys[i];                                                             \
+          dst_vals[dst] = src_vals[i];                                                             \
+        }                                                                                          \
+      }                                                                                            \
+      else                                                                                         \
+      {                                                                                            \
+        for( size_t i = 0; i < n; ++i )                                                            \
+        {                                                                                          \
+          dst_keys[offsets[(src_keys[i] >> shift) & 0xFF]++] = src_keys[i];                        \
+        }                                                                                          \
+      }                                                                                            \
+      key_type* swap_keys = src_keys; src_keys = dst_keys; dst_keys = swap_keys;                   \
+      uint32_t* swap_vals = src_vals; src_vals = dst_vals; dst_vals = swap_vals;                   \
+    }                                                                                              \
+                                                                                                   \
+    if( src_keys != keys )                                                                         \
+    {                                                                                              \
+      memcpy( keys, src_keys, n * sizeof(key_type) );                                              \
+      if( vals ) { memcpy( vals, src_vals, n * sizeof(uint32_t) ); }                               \
+    }                                                                                              \
+    MSH_SORT_FREE( tmp_keys );                                                                     \
+    MSH_SORT_FREE( tmp_vals );                                                                     \
+  }
+
+static void
+msh__small_sort_u32( uint32_t* keys, uint32_t* vals, size_t n )
+{
+  if( vals ) { msh__insertion_sort_u32( keys, vals, n ); }
+  else       { msh_sort_network_u32( keys, NULL, n ); }
+}
+
+static void
+msh__small_sort_u64( uint64_t* keys, uint32_t* vals, size_t n )
+{
+  if( vals ) { msh__insertion_sort_u64( keys, vals, n ); }
+  else       { msh_sort_network_u64( keys, NULL, n ); }
+}
+
+MSH__RADIX_SORT_FN( msh__radix_sort_u32, uint32_t, 4, msh__small_sort_u32 )
+MSH__RADIX_SORT_FN( msh__radix_sort_u64, uint64_t, 8, msh__small_sort_u64 )
+
+MSH_SORT_DEF void
+msh_radix_sort_u32( uint32_t* keys, uint32_t* vals, size_t n )
+{
+  msh__radix_sort_u32( keys, vals, n );
+}
+
+MSH_SORT_DEF void
+msh_radix_sort_u64( uint64_t* keys, uint32_t* vals, size_t n )
+{
+  msh__radix_sort_u64( keys, vals, n );
+}
+
+MSH_SORT_DEF void
+msh_radix_sort_f32( float* keys, uint32_t* vals, size_t n )
+{
+  uint32_t* ukeys = (uint32_t*)keys;
+  for( size_t i = 0; i < n; ++i ) { ukeys[i] = msh__sort_f32_to_u32( ukeys[i] ); }
+  msh__radix_sort_u32( ukeys, vals, n );
+  for( size_t i = 0; i < n; ++i ) { ukeys[i] = msh__sort_u32_to_f32( ukeys[i] ); }
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+// Parallel radix sort
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+#ifdef MSH_JOBS_H
+
+// Keys are split into one contiguous chunk per thread of the job system. Every pass runs the
+// histogram and the scatter phase as a parallel-for over chunks, on the workers of 'jobs'.
+typedef struct msh__radix_mt_ctx
+{
+  void* keys[2];             // input and temporary buffer, passes alternate between them
+  uint32_t* vals[2];
+  size_t n;
+  int n_chunks;
+  int key_size;
+  int shift;
+  int cur;                   // index of the buffer read by current pass
+  size_t (*hist)[256];       // per-chunk histograms, then per-chunk output offsets
+} msh__radix_mt_ctx_t;
+
+#define MSH__RADIX_MT_HISTOGRAM( key_type )                                                        \
+  do {                                                                                             \
+    const key_type* src = (const key_type*)ctx->keys[ctx->cur];                                    \
+    memset( h, 0, 256 * sizeof(size_t) );                                                          \
+    for( size_t i = start; i < end; ++i ) { h[(src[i] >> ctx->shift) & 0xFF]++; }                  \
+  } while( 0 )
+
+#define MSH__RADIX_MT_SCATTER( key_type )                                                          \
+  do {                                                                                             \
+    const key_type* src = (const key_type*)ctx->keys[ctx->cur];                                    \
+    key_type* dst = (key_type*)ctx->keys[ctx->cur ^ 1];                                            \
+    const uint32_t* src_vals = ctx->vals[ctx->cur];                                                \
+    uint32_t* dst_vals = ctx->vals[ctx->cur ^ 1];                                                  \
+    if( src_vals )                                                                                 \
+    {                                                                                              \
+      for( size_t i = start; i < end; ++i )                                                        \
+      {                                                                                            \
+        size_t d = h[(src[i] >> ctx->shift) & 0xFF]++;                                             \
+        dst[d] = src[i];                                                                           \
+        dst_vals[d] = src_vals[i];                                                                 \
+      }                                                                                            \
+    }                                                                                              \
+    else                                                                                           \
+    {                                                                                              \
+      for( size_t i = start; i < end; ++i ) { dst[h[(src[i] >> ctx->shift) & 0xFF]++] = src[i]; } \
+    }                                                                                              \
+  } while( 0 )
+
+static void
+msh__radix_mt_histogram( void* data, size_t first_chunk, size_t last_chunk )
+{
+  msh__radix_mt_ctx_t* ctx = (msh__radix_mt_ctx_t*)data;
+  for( size_t c = first_chunk; c < last_chunk; ++c )
+  {
+    size_t start = ctx->n * c / ctx->n_chunks;
+    size_t end = ctx->n * (c + 1) / ctx->n_chunks;
+    size_t* h = ctx->hist[c];
+    if( ctx->key_size == 4 ) { MSH__RADIX_MT_HISTOGRAM( uint32_t ); }
+    else                     { MSH__RADIX_MT_HISTOGRAM( uint64_t ); }
+  }
+}
+
+static void
+msh__radix_mt_scatter( void* data, size_t first_chunk, size_t last_chunk )
+{
+  msh__radix_mt_ctx_t* ctx = (msh__radix_mt_ctx_t*)data;
+  for( size_t c = first_chunk; c < last_chunk; ++c )
+  {
+    size_t start = ctx->n * c / ctx->n_chunks;
+    size_t end = ctx->n * (c + 1) / ctx->n_chunks;
+    size_t* h = ctx->hist[c];
+    if( ctx->key_size == 4 ) { MSH__RADIX_MT_SCATTER( uint32_t ); }
+    else                     { MSH__RADIX_MT_SCATTER( uint64_t ); }
+  }
+}
+
+// Exclusive prefix sum over (digit, chunk), so each chunk writes its keys of a digit after the
+// same digit keys of all previous chunks. Returns 1 if all keys share the same digit.
+static int
+msh__radix_mt_offsets( msh__radix_mt_ctx_t* ctx )
+{
+  size_t sum = 0;
+  int trivial = 0;
+  for( int b = 0; b < 256; ++b )
+  {
+    size_t digit_count = 0;
+    for( int c = 0; c < ctx->n_chunks; ++c )
+    {
+      size_t count = ctx->hist[c][b];
+      ctx->hist[c][b] = sum;
+      sum += count;
+      digit_count += count;
+    }
+    if( digit_count == ctx->n ) { trivial = 1; }
+  }
+  return trivial;
+}
+
+static void
+msh__radix_sort_mt( void* keys, int key_size, uint32_t* vals, size_t n, msh_jobs_t* jobs )
+{
+  msh__radix_mt_ctx_t ctx = {0};
+  ctx.keys[0] = keys;
+  ctx.keys[1] = MSH_SORT_MALLOC( n * key_size );
+  ctx.vals[0] = vals;
+  ctx.vals[1] = vals ? (uint32_t*)MSH_SORT_MALLOC( n * sizeof(uint32_t) ) : NULL;
+  ctx.n = n;
+  ctx.n_chunks = msh_jobs_n_threads( jobs );
+  ctx.key_size = key_size;
+  ctx.hist = (size_t(*)[256])MSH_SORT_MALLOC( ctx.n_chunks * sizeof(*ctx.hist) );
+
+  for( int p = 0; p < key_size; ++p )
+  {
+    ctx.shift = 8 * p;
+    msh_jobs_parallel_for( jobs, ctx.n_chunks, 1, msh__radix_mt_histogram, &ctx );
+    if( msh__radix_mt_offsets( &ctx ) ) { continue; }
+    msh_jobs_parallel_for( jobs, ctx.n_chunks, 1, msh__radix_mt_scatter, &ctx );
+    ctx.cur ^= 1;
+  }
+
+  if( ctx.cur )
+  {
+    memcpy( keys, ctx.keys[1], n * key_size );
+    if( vals ) { memcpy( vals, ctx.vals[1], n * sizeof(uint32_t) ); }
+  }
+  MSH_SORT_FREE( ctx.hist );
+  MSH_SORT_FREE( ctx.keys[1] );
+  MSH_SORT_FREE( ctx.vals[1] );
+}
+
+MSH_SORT_DEF void
+msh_radix_sort_u32_mt( uint32_t* keys, uint32_t* vals, size_t n, msh_jobs_t* jobs )
+{
+  if( n < MSH_SORT_MT_MIN_N || !jobs || msh_jobs_n_threads( jobs ) <= 1 )
+  {
+    msh__radix_sort_u32( keys, vals, n );
+    return;
+  }
+  msh__radix_sort_mt( keys, sizeof(uint32_t), vals, n, jobs );
+}
+
+MSH_SORT_DEF void
+msh_radix_sort_u64_mt( uint64_t* keys, uint32_t* vals, size_t n, msh_jobs_t* jobs )
+{
+  if( n < MSH_SORT_MT_MIN_N || !jobs || msh_jobs_n_threads( jobs ) <= 1 )
+  {
+    msh__radix_sort_u64( keys, vals, n );
+    return;
+  }
+  msh__radix_sort_mt( keys, sizeof(uint64_t), vals, n, jobs );
+}
+
+MSH_SORT_DEF void
+msh_radix_sort_f32_mt( float* keys, uint32_t* vals, size_t n, msh_jobs_t* jobs )
+{
+  uint32_t* ukeys = (uint32_t*)keys;
+  for( size_t i = 0; i < n; ++i ) { ukeys[i] = msh__sort_f32_to_u32( ukeys[i] ); }
+  msh_radix_sort_u32_mt( ukeys, vals, n, jobs );
+  for( size_t i = 0; i < n; ++i ) { ukeys[i] = msh__sort_u32_to_f32( ukeys[i] ); }
+}
+
+#endif /* MSH_JOBS_H */
+
+#endif /* MSH_SORT_IMPLEMENTATION */
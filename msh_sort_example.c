@@ -0,0 +1,423 @@
+/*
+  Author: Maciej Halber
+  Date : Oct 18, 2026
+  License: CC0
+
+  Compilation: gcc -std=c99 -O2 -I<path_to_msh_libraries> msh_sort_example.c -o msh_sort_example -lpthread
+  Usage:       msh_sort_example [n_threads | --bench]
+  Description: This program compares sorting primitives of msh_sort.h against qsort, on keys and
+               key-index pairs resembling what other examples need to sort:
+
+               - random uint32 keys,
+               - small uint32 keys, like bin indices when building histograms,
+               - uint64 Morton codes of 3D points with vertex indices, like ordering or
+                 deduplicating vertices of a mesh,
+               - float squared distances with point indices, like k-nearest neighbor results.
+
+               Sizes range from 10 elements (k-NN results) and 250 elements (points in hash grid
+               example), to 2^22 elements. Arrays of up to MSH_SORT_SMALL_N elements are also
+               sorted with a sorting network. Parallel sort runs on a msh_jobs.h job system with
+               n_threads threads, 4 by default. Every result is checked against a stable reference
+               sort, and program returns non-zero if any of them differs. With --bench, the main
+               sorts are measured with msh_bench.h instead.
+*/
+
+#define MSH_STD_INCLUDE_HEADERS
+#define MSH_STD_IMPLEMENTATION
+#define MSH_JOBS_IMPLEMENTATION
+#define MSH_SORT_IMPLEMENTATION
+#define MSH_BENCH_IMPLEMENTATION
+#include "msh_std.h"
+#include "msh_jobs.h"
+#include "msh_sort.h"
+#include "msh_bench.h"
+
+enum { N_SIZES = 5, N_ELEMS_PER_TIMING = 1 << 20, N_REPEATS = 3, DEFAULT_N_THREADS = 4 };
+static const size_t sizes[N_SIZES] = { 10, 250, 1 << 16, 1 << 20, 1 << 22 };
+
+typedef enum key_type { KEY_U32, KEY_U64, KEY_F32 } key_type_t;
+
+typedef struct sort_case
+{
+  const char* name;
+  key_type_t key_type;
+  int with_payload;
+  uint32_t n_bins;  // uint32 keys are drawn from [0, n_bins) if non-zero
+} sort_case_t;
+
+// Key-index pair used by qsort and by the reference sort.
+typedef struct sort_pair
+{
+  union { uint32_t u32; uint64_t u64; float f32; } key;
+  uint32_t idx;
+} sort_pair_t;
+
+static key_type_t cmp_key_type;
+
+int cmp_u32( const void* a, const void* b )
+{
+  uint32_t ka = *(const uint32_t*)a, kb = *(const uint32_t*)b;
+  return (ka > kb) - (ka < kb);
+}
+
+int cmp_u64( const void* a, const void* b )
+{
+  uint64_t ka = *(const uint64_t*)a, kb = *(const uint64_t*)b;
+  return (ka > kb) - (ka < kb);
+}
+
+int cmp_f32( const void* a, const void* b )
+{
+  float ka = *(const float*)a, kb = *(const float*)b;
+  return (ka > kb) - (ka < kb);
+}
+
+int cmp_pair( const void* a, const void* b )
+{
+  const sort_pair_t* pa = (const sort_pair_t*)a;
+  const sort_pair_t* pb = (const sort_pair_t*)b;
+  switch( cmp_key_type )
+  {
+    case KEY_U32: return cmp_u32( &pa->key.u32, &pb->key.u32 );
+    case KEY_U64: return cmp_u64( &pa->key.u64, &pb->key.u64 );
+    default:      return cmp_f32( &pa->key.f32, &pb->key.f32 );
+  }
+}
+
+// Ties broken by index make qsort produce the stable order.
+int cmp_pair_stable( const void* a, const void* b )
+{
+  int c = cmp_pair( a, b );
+  if( c ) { return c; }
+  uint32_t ia = ((const sort_pair_t*)a)->idx, ib = ((const sort_pair_t*)b)->idx;
+  return (ia > ib) - (ia < ib);
+}
+
+uint64_t morton_spread_21( uint64_t x )
+{
+  x &= 0x1fffff;
+  x = (x | x << 32) & 0x1f00000000ffffULL;
+  x = (x | x << 16) & 0x1f0000ff0000ffULL;
+  x = (x | x << 8)  & 0x100f00f00f00f00fULL;
+  x = (x | x << 4)  & 0x10c30c30c30c30c3ULL;
+  x = (x | x << 2)  & 0x1249249249249249ULL;
+  return x;
+}
+
+void generate_keys( const sort_case_t* sc, void* keys, size_t n, msh_rand_ctx_t* rand_gen )
+{
+  for( size_t i = 0; i < n; ++i )
+  {
+    if( sc->key_type == KEY_U64 )
+    {
+      uint64_t x = msh_rand_next( rand_gen ) >> 11;
+      uint64_t y = msh_rand_next( rand_gen ) >> 11;
+      uint64_t z = msh_rand_next( rand_gen ) >> 11;
+      ((uint64_t*)keys)[i] = morton_spread_21( x ) | morton_spread_21( y ) << 1 | morton_spread_21( z ) << 2;
+    }
+    else if( sc->key_type == KEY_F32 )
+    {
+      float dx = msh_rand_nextf( rand_gen ) - 0.5f;
+      float dy = msh_rand_nextf( rand_gen ) - 0.5f;
+      ((float*)keys)[i] = dx * dx + dy * dy;
+    }
+    else if( sc->n_bins )
+    {
+      ((uint32_t*)keys)[i] = msh_rand_next( rand_gen ) % sc->n_bins;
+    }
+    else
+    {
+      ((uint32_t*)keys)[i] = msh_rand_next( rand_gen );
+    }
+  }
+}
+
+size_t key_size( key_type_t key_type )
+{
+  return key_type == KEY_U64 ? sizeof(uint64_t) : sizeof(uint32_t);
+}
+
+typedef enum sort_method { SORT_QSORT, SORT_RADIX, SORT_RADIX_MT, SORT_NETWORK } sort_method_t;
+
+void run_sort( sort_method_t method, key_type_t key_type, void* keys, uint32_t* vals,
+               sort_pair_t* pairs, size_t n, msh_jobs_t* jobs )
+{
+  switch( method )
+  {
+    case SORT_QSORT:
+      cmp_key_type = key_type;
+      if( pairs ) { qsort( pairs, n, sizeof(sort_pair_t), cmp_pair ); }
+      else        { qsort( keys, n, key_size( key_type ), key_type == KEY_U32 ? cmp_u32 :
+                                                          key_type == KEY_U64 ? cmp_u64 : cmp_f32 ); }
+      break;
+    case SORT_RADIX:
+      if( key_type == KEY_U32 )      { msh_radix_sort_u32( (uint32_t*)keys, vals, n ); }
+      else if( key_type == KEY_U64 ) { msh_radix_sort_u64( (uint64_t*)keys, vals, n ); }
+      else                           { msh_radix_sort_f32( (float*)keys, vals, n ); }
+      break;
+    case SORT_RADIX_MT:
+      if( key_type == KEY_U32 )      { msh_radix_sort_u32_mt( (uint32_t*)keys, vals, n, jobs ); }
+      else if( key_type == KEY_U64 ) { msh_radix_sort_u64_mt( (uint64_t*)keys, vals, n, jobs ); }
+      else                           { msh_radix_sort_f32_mt( (float*)keys, vals, n, jobs ); }
+      break;
+    case SORT_NETWORK:
+      if( key_type == KEY_U32 )      { msh_sort_network_u32( (uint32_t*)keys, vals, n ); }
+      else if( key_type == KEY_U64 ) { msh_sort_network_u64( (uint64_t*)keys, vals, n ); }
+      else                           { msh_sort_network_f32( (float*)keys, vals, n ); }
+      break;
+  }
+}
+
+// Compares keys against the reference; payload has to match exactly for stable sorts, and has to
+// point at an equal key otherwise.
+int check_sorted( const sort_case_t* sc, const void* keys, const uint32_t* vals, const sort_pair_t* ref,
+                  const void* orig_keys, size_t n, int stable )
+{
+  size_t ks = key_size( sc->key_type );
+  for( size_t i = 0; i < n; ++i )
+  {
+    if( memcmp( (const uint8_t*)keys + i * ks, &ref[i].key, ks ) ) { return 0; }
+    if( !vals ) { continue; }
+    if( stable && vals[i] != ref[i].idx ) { return 0; }
+    if( !stable && memcmp( (const uint8_t*)orig_keys + vals[i] * ks, &ref[i].key, ks ) ) { return 0; }
+  }
+  return 1;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+// Benchmarks, run with --bench. Every iteration restores unsorted keys first, so copying is
+// included in the times.
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+typedef struct bench_data
+{
+  size_t n;
+  uint32_t *orig_u32, *keys_u32;
+  uint64_t *orig_u64, *keys_u64;
+  float *orig_f32, *keys_f32;
+  uint32_t* vals;
+  msh_jobs_t* jobs;
+} bench_data_t;
+
+void bench_radix_u32( void* data, size_t n_iters )
+{
+  bench_data_t* d = data;
+  for( size_t it = 0; it < n_iters; ++it )
+  {
+    memcpy( d->keys_u32, d->orig_u32, d->n * sizeof(uint32_t) );
+    msh_radix_sort_u32( d->keys_u32, NULL, d->n );
+    MSH_BENCH_CLOBBER();
+  }
+}
+
+void bench_radix_u64_idx( void* data, size_t n_iters )
+{
+  bench_data_t* d = data;
+  for( size_t it = 0; it < n_iters; ++it )
+  {
+    memcpy( d->keys_u64, d->orig_u64, d->n * sizeof(uint64_t) );
+    for( size_t i = 0; i < d->n; ++i ) { d->vals[i] = (uint32_t)i; }
+    msh_radix_sort_u64( d->keys_u64, d->vals, d->n );
+    MSH_BENCH_CLOBBER();
+  }
+}
+
+void bench_radix_f32_idx( void* data, size_t n_iters )
+{
+  bench_data_t* d = data;
+  for( size_t it = 0; it < n_iters; ++it )
+  {
+    memcpy( d->keys_f32, d->orig_f32, d->n * sizeof(float) );
+    for( size_t i = 0; i < d->n; ++i ) { d->vals[i] = (uint32_t)i; }
+    msh_radix_sort_f32( d->keys_f32, d->vals, d->n );
+    MSH_BENCH_CLOBBER();
+  }
+}
+
+void bench_radix_u32_mt( void* data, size_t n_iters )
+{
+  bench_data_t* d = data;
+  for( size_t it = 0; it < n_iters; ++it )
+  {
+    memcpy( d->keys_u32, d->orig_u32, d->n * sizeof(uint32_t) );
+    msh_radix_sort_u32_mt( d->keys_u32, NULL, d->n, d->jobs );
+    MSH_BENCH_CLOBBER();
+  }
+}
+
+void bench_network_u32( void* data, size_t n_iters )
+{
+  bench_data_t* d = data;
+  for( size_t it = 0; it < n_iters; ++it )
+  {
+    memcpy( d->keys_u32, d->orig_u32, d->n * sizeof(uint32_t) );
+    msh_sort_network_u32( d->keys_u32, NULL, d->n );
+    MSH_BENCH_CLOBBER();
+  }
+}
+
+void bench_qsort_u32( void* data, size_t n_iters )
+{
+  bench_data_t* d = data;
+  for( size_t it = 0; it < n_iters; ++it )
+  {
+    memcpy( d->keys_u32, d->orig_u32, d->n * sizeof(uint32_t) );
+    qsort( d->keys_u32, d->n, sizeof(uint32_t), cmp_u32 );
+    MSH_BENCH_CLOBBER();
+  }
+}
+
+bench_data_t bench_data_init( size_t n, msh_rand_ctx_t* rand_gen )
+{
+  bench_data_t d = {0};
+  d.n = n;
+  d.orig_u32 = malloc( n * sizeof(uint32_t) ); d.keys_u32 = malloc( n * sizeof(uint32_t) );
+  d.orig_u64 = malloc( n * sizeof(uint64_t) ); d.keys_u64 = malloc( n * sizeof(uint64_t) );
+  d.orig_f32 = malloc( n * sizeof(float) );    d.keys_f32 = malloc( n * sizeof(float) );
+  d.vals = malloc( n * sizeof(uint32_t) );
+  for( size_t i = 0; i < n; ++i )
+  {
+    d.orig_u32[i] = msh_rand_next( rand_gen );
+    d.orig_u64[i] = ( (uint64_t)msh_rand_next( rand_gen ) << 32 ) | msh_rand_next( rand_gen );
+    d.orig_f32[i] = msh_rand_nextf( rand_gen ) * 100.0f;
+  }
+  return d;
+}
+
+void bench_data_free( bench_data_t* d )
+{
+  free( d->orig_u32 ); free( d->keys_u32 );
+  free( d->orig_u64 ); free( d->keys_u64 );
+  free( d->orig_f32 ); free( d->keys_f32 );
+  free( d->vals );
+}
+
+int run_benchmarks( int argc, char** argv )
+{
+  msh_rand_ctx_t rand_gen = {0};
+  msh_rand_init( &rand_gen, 8917ULL );
+  bench_data_t big = bench_data_init( 1 << 20, &rand_gen );
+  bench_data_t small = bench_data_init( 16, &rand_gen );
+  big.jobs = msh_jobs_create( DEFAULT_N_THREADS - 1 );
+  msh_bench_t* b = msh_bench_create( argc, argv );
+  msh_bench_add( b, "radix u32, 1M", bench_radix_u32, &big, big.n );
+  msh_bench_add( b, "radix_mt u32, 1M, 4 threads", bench_radix_u32_mt, &big, big.n );
+  msh_bench_add( b, "radix u64 + idx, 1M", bench_radix_u64_idx, &big, big.n );
+  msh_bench_add( b, "radix f32 + idx, 1M", bench_radix_f32_idx, &big, big.n );
+  msh_bench_add( b, "qsort u32, 1M", bench_qsort_u32, &big, big.n );
+  msh_bench_add( b, "network u32, 16", bench_network_u32, &small, small.n );
+  msh_bench_add( b, "qsort u32, 16", bench_qsort_u32, &small, small.n );
+  int n_regressions = msh_bench_run( b );
+  msh_bench_destroy( b );
+  msh_jobs_destroy( big.jobs );
+  bench_data_free( &big );
+  bench_data_free( &small );
+  return n_regressions ? 1 : 0;
+}
+
+int main( int argc, char** argv )
+{
+  if( msh_bench_requested( argc, argv ) ) { return run_benchmarks( argc, argv ); }
+  int n_threads = argc > 1 ? atoi( argv[1] ) : DEFAULT_N_THREADS;
+  if( n_threads < 1 ) { n_threads = 1; }
+  msh_jobs_t* jobs = msh_jobs_create( n_threads - 1 );
+
+  sort_case_t cases[] = { { "u32 random",       KEY_U32, 0, 0 },
+                          { "u32 bins",         KEY_U32, 1, 64 },
+                          { "u64 morton + idx", KEY_U64, 1, 0 },
+                          { "f32 dist + idx",   KEY_F32, 1, 0 } };
+  const char* method_names[] = { "qsort", "radix", "radix_mt", "network" };
+
+  size_t max_n = msh_max( sizes[N_SIZES - 1], N_ELEMS_PER_TIMING );
+  void* orig_keys = malloc( max_n * sizeof(uint64_t) );
+  void* keys = malloc( max_n * sizeof(uint64_t) );
+  uint32_t* vals = malloc( max_n * sizeof(uint32_t) );
+  sort_pair_t* pairs = malloc( max_n * sizeof(sort_pair_t) );
+  sort_pair_t* ref = malloc( max_n * sizeof(sort_pair_t) );
+  msh_rand_ctx_t rand_gen = {0};
+  msh_rand_init( &rand_gen, 8917ULL );
+
+  int n_failed = 0;
+  printf("Sorting with %d threads for parallel sort, times in ns per element (best of %d runs)\n",
+         n_threads, N_REPEATS );
+  printf("%-18s %10s", "data", "n" );
+  for( int m = 0; m < 4; ++m ) { printf(" %10s", method_names[m] ); }
+  printf("\n");
+
+  for( size_t c = 0; c < sizeof(cases) / sizeof(cases[0]); ++c )
+  {
+    const sort_case_t* sc = &cases[c];
+    size_t ks = key_size( sc->key_type );
+    for( int s = 0; s < N_SIZES; ++s )
+    {
+      size_t n = sizes[s];
+      // Small arrays are sorted many times, each copy separately, so timer resolution and
+      // warm caches matter less.
+      size_t n_copies = msh_max( N_ELEMS_PER_TIMING / n, 1 );
+      generate_keys( sc, orig_keys, n, &rand_gen );
+      for( size_t i = 0; i < n; ++i )
+      {
+        memcpy( &ref[i].key, (uint8_t*)orig_keys + i * ks, ks );
+        ref[i].idx = (uint32_t)i;
+      }
+      cmp_key_type = sc->key_type;
+      qsort( ref, n, sizeof(sort_pair_t), cmp_pair_stable );
+
+      printf("%-18s %10zu", sc->name, n );
+      for( int m = 0; m < 4; ++m )
+      {
+        sort_method_t method = (sort_method_t)m;
+        if( method == SORT_NETWORK && n > MSH_SORT_SMALL_N ) { printf(" %10s", "-" ); continue; }
+        double best_time = 1e30;
+        int ok = 1;
+        for( int r = 0; r < N_REPEATS; ++r )
+        {
+          for( size_t k = 0; k < n_copies; ++k )
+          {
+            memcpy( (uint8_t*)keys + k * n * ks, orig_keys, n * ks );
+            for( size_t i = 0; i < n; ++i )
+            {
+              vals[k * n + i] = (uint32_t)i;
+              memcpy( &pairs[k * n + i].key, (uint8_t*)orig_keys + i * ks, ks );
+              pairs[k * n + i].idx = (uint32_t)i;
+            }
+          }
+          uint64_t t1 = msh_time_now();
+          for( size_t k = 0; k < n_copies; ++k )
+          {
+            run_sort( method, sc->key_type, (uint8_t*)keys + k * n * ks,
+                      sc->with_payload ? vals + k * n : NULL,
+                      (method == SORT_QSORT && sc->with_payload) ? pairs + k * n : NULL,
+                      n, jobs );
+          }
+          uint64_t t2 = msh_time_now();
+          best_time = msh_min( best_time, msh_time_diff( MSHT_NANOSECONDS, t2, t1 ) );
+        }
+
+        // qsort with payload sorts the pairs in place, so copy them out before checking.
+        if( method == SORT_QSORT && sc->with_payload )
+        {
+          for( size_t i = 0; i < n; ++i )
+          {
+            memcpy( (uint8_t*)keys + i * ks, &pairs[i].key, ks );
+            vals[i] = pairs[i].idx;
+          }
+        }
+        int stable = method == SORT_RADIX || method == SORT_RADIX_MT;
+        ok = check_sorted( sc, keys, sc->with_payload ? vals : NULL, ref, orig_keys, n, stable );
+        n_failed += !ok;
+        printf(" %9.2f%s", best_time / (n_copies * n), ok ? " " : "!" );
+      }
+      printf("\n");
+    }
+  }
+  printf("%d failed\n", n_failed );
+
+  free( orig_keys );
+  free( keys );
+  free( vals );
+  free( pairs );
+  free( ref );
+  msh_jobs_destroy( jobs );
+  return n_failed ? 1 : 0;
+}
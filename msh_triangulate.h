@@ -0,0 +1,538 @@
+/*
+  ==============================================================================
+
+  MSH_TRIANGULATE.H v0.1
+
+  A single header library for triangulating simple polygons, optionally with holes, in
+  O(n log n) time, e.g. outlines of msh_cutouts paths, SVG shapes or GIS polygons.
+
+  To use the library you simply add:
+
+  #include "msh_std.h"
+  #include "msh_sort.h"
+  #define MSH_TRIANGULATE_IMPLEMENTATION
+  #include "msh_triangulate.h"
+
+  msh_std.h (msh_array) and msh_sort.h (radix sort, define MSH_SORT_IMPLEMENTATION in one
+  translation unit) need to be included first.
+
+  ==============================================================================
+  DOCUMENTATION
+
+  Triangulation
+    msh_array(int) tris = NULL;
+    int n_tris = msh_triangulate_polygon( path.vertices, path.idx, &tris );
+
+    int counts[] = { n_outer, n_hole_a, n_hole_b };
+    n_tris = msh_triangulate_polygon_holes( vertices, counts, 3, &tris );
+    ...
+    msh_array_free( tris );
+
+    Vertices are interleaved x and y floats, laid out contour after contour. The first contour
+    is the outer boundary, the following ones are holes inside of it. Contours may have any
+    orientation, and consecutive duplicate vertices (including the last vertex repeating the
+    first) are skipped. Vertices count as duplicates if their coordinates differ by at most
+    MSH_TRIANGULATE_EPS (1e-6 by default) times the largest coordinate magnitude in the
+    contour. Three indices per triangle, into the vertex array, are appended to 'tris', which
+    grows as needed, so the same array can collect triangles of many polygons. Triangles are
+    counter-clockwise with y pointing up. Returns the number of triangles added,
+    n - 2 + 2 * n_holes for n distinct vertices, or 0 if the outer contour has fewer than 3.
+
+    The polygon is split into y-monotone pieces by a sweep over vertices sorted with a radix
+    sort (de Berg et al., "Computational Geometry", ch. 3), keeping edges crossed by the sweep
+    line in a treap, and each piece is triangulated in linear time with a stack. Unlike ear
+    clipping, which is quadratic, 100k vertex outlines take milliseconds. Input has to be
+    simple: edges must not cross, and holes must not touch the boundary or each other.
+
+  ==============================================================================
+  AUTHORS:
+    Maciej Halber
+
+  LICENSE:
+    CC0
+  ==============================================================================
+*/
+
+#ifndef MSH_TRIANGULATE_H
+#define MSH_TRIANGULATE_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#ifndef MSH_TRIANGULATE_DEF
+#ifdef MSH_TRIANGULATE_STATIC
+#define MSH_TRIANGULATE_DEF static
+#else
+#define MSH_TRIANGULATE_DEF extern
+#endif
+#endif
+
+MSH_TRIANGULATE_DEF int msh_triangulate_polygon( const float* vertices, int n_vertices, msh_array(int)* tris );
+MSH_TRIANGULATE_DEF int msh_triangulate_polygon_holes( const float* vertices, const int* contour_counts,
+                                                       int n_contours, msh_array(int)* tris );
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* MSH_TRIANGULATE_H */
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+// IMPLEMENTATION
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+#ifdef MSH_TRIANGULATE_IMPLEMENTATION
+
+#include <math.h>
+
+#ifndef MSH_TRIANGULATE_EPS
+#define MSH_TRIANGULATE_EPS 1e-6f
+#endif
+
+// Working memory is tracked under "msh_triangulate" when msh_mem.h is included first.
+#ifndef MSH_TRIANGULATE_MALLOC
+#ifdef MSH_MEM_H
+#define MSH_TRIANGULATE_MALLOC( size ) msh_mem_alloc( "msh_triangulate", size )
+#define MSH_TRIANGULATE_FREE( ptr )    msh_mem_free( ptr )
+#else
+#define MSH_TRIANGULATE_MALLOC( size ) malloc( size )
+#define MSH_TRIANGULATE_FREE( ptr )    free( ptr )
+#endif
+#endif
+
+enum { MSH__TRI_START, MSH__TRI_END, MSH__TRI_SPLIT, MSH__TRI_MERGE, MSH__TRI_REGULAR };
+
+// Treap node of an edge crossed by the sweep line, ordered by x at the sweep line. Endpoints are
+// copied in, so that a level of the descent touches a single cache line.
+typedef struct msh__tri_node
+{
+  float ax, ay, bx, by;
+  int left, right, parent;
+  uint32_t prio;
+} msh__tri_node_t;
+
+// Vertices are referred to by their compact index, after duplicates are removed. Edge e goes
+// from vertex e to next[e].
+typedef struct msh__tri_ctx
+{
+  int n;
+  float *x, *y;
+  int *id, *prev, *next, *rank, *helper;
+  uint8_t* type;
+
+  msh__tri_node_t* nodes;
+  int root;
+
+  int* diags;
+  int n_diags;
+} msh__tri_ctx_t;
+
+static inline uint32_t
+msh__tri_ordered_bits( float f )
+{
+  union { float f; uint32_t u; } v;
+  v.f = f + 0.0f;   // -0.0 to +0.0
+  return v.u ^ ( ( v.u >> 31 ) ? 0xFFFFFFFFu : 0x80000000u );
+}
+
+static inline double
+msh__tri_cross( const msh__tri_ctx_t* c, int a, int b, int d )
+{
+  return ( (double)c->x[b] - c->x[a] ) * ( (double)c->y[d] - c->y[a] ) -
+         ( (double)c->y[b] - c->y[a] ) * ( (double)c->x[d] - c->x[a] );
+}
+
+//--------------------------------------------------------------------------------------------------
+// Sweep status
+//--------------------------------------------------------------------------------------------------
+
+// Edges in the status point down the sweep, so a point is left of an edge if it is on the
+// edge's right side, going from a to b.
+static inline int
+msh__tri_is_left( const msh__tri_node_t* e, float x, float y )
+{
+  return ( (double)e->bx - e->ax ) * ( (double)y - e->ay ) - ( (double)e->by - e->ay ) * ( (double)x - e->ax ) < 0.0;
+}
+
+static void
+msh__tri_rotate_up( msh__tri_ctx_t* c, int v )
+{
+  msh__tri_node_t* nodes = c->nodes;
+  int p = nodes[v].parent, g = nodes[p].parent;
+  if( nodes[p].left == v )
+  {
+    nodes[p].left = nodes[v].right;
+    if( nodes[v].right >= 0 ) { nodes[nodes[v].right].parent = p; }
+    nodes[v].right = p;
+  }
+  else
+  {
+    nodes[p].right = nodes[v].left;
+    if( nodes[v].left >= 0 ) { nodes[nodes[v].left].parent = p; }
+    nodes[v].left = p;
+  }
+  nodes[p].parent = v;
+  nodes[v].parent = g;
+  if( g < 0 )                   { c->root = v; }
+  else if( nodes[g].left == p ) { nodes[g].left = v; }
+  else                          { nodes[g].right = v; }
+}
+
+static void
+msh__tri_insert( msh__tri_ctx_t* c, int e )
+{
+  msh__tri_node_t* nodes = c->nodes;
+  float vx = c->x[e], vy = c->y[e];
+  int p = -1, cur = c->root, is_left = 0;
+  while( cur >= 0 )
+  {
+    p = cur;
+    is_left = msh__tri_is_left( &nodes[cur], vx, vy );
+    cur = is_left ? nodes[cur].left : nodes[cur].right;
+  }
+  msh__tri_node_t* node = &nodes[e];
+  node->ax = c->x[e];          node->ay = c->y[e];
+  node->bx = c->x[c->next[e]]; node->by = c->y[c->next[e]];
+  node->left = node->right = -1;
+  node->parent = p;
+  if( p < 0 )        { c->root = e; }
+  else if( is_left ) { nodes[p].left = e; }
+  else               { nodes[p].right = e; }
+  while( node->parent >= 0 && node->prio > nodes[node->parent].prio ) { msh__tri_rotate_up( c, e ); }
+}
+
+// Removal by handle, so no comparisons are evaluated at the edge's lower end.
+static void
+msh__tri_remove( msh__tri_ctx_t* c, int e )
+{
+  msh__tri_node_t* nodes = c->nodes;
+  while( nodes[e].left >= 0 || nodes[e].right >= 0 )
+  {
+    int l = nodes[e].left, r = nodes[e].right;
+    msh__tri_rotate_up( c, ( r < 0 || ( l >= 0 && nodes[l].prio > nodes[r].prio ) ) ? l : r );
+  }
+  int p = nodes[e].parent;
+  if( p < 0 )                   { c->root = -1; }
+  else if( nodes[p].left == e ) { nodes[p].left = -1; }
+  else                          { nodes[p].right = -1; }
+}
+
+// Edge directly left of vertex v.
+static int
+msh__tri_left_of( const msh__tri_ctx_t* c, int v )
+{
+  const msh__tri_node_t* nodes = c->nodes;
+  int cur = c->root, best = -1;
+  while( cur >= 0 )
+  {
+    if( !msh__tri_is_left( &nodes[cur], c->x[v], c->y[v] ) ) { best = cur; cur = nodes[cur].right; }
+    else                                                      { cur = nodes[cur].left; }
+  }
+  return best;
+}
+
+static inline void
+msh__tri_connect_merge_helper( msh__tri_ctx_t* c, int v, int e )
+{
+  if( e >= 0 && c->type[c->helper[e]] == MSH__TRI_MERGE )
+  {
+    c->diags[2 * c->n_diags + 0] = v;
+    c->diags[2 * c->n_diags + 1] = c->helper[e];
+    c->n_diags++;
+  }
+}
+
+//--------------------------------------------------------------------------------------------------
+// Monotone pieces
+//--------------------------------------------------------------------------------------------------
+
+static inline void
+msh__tri_emit( const msh__tri_ctx_t* c, int a, int b, int d, msh_array(int)* tris )
+{
+  if( msh__tri_cross( c, a, b, d ) < 0.0 ) { int t = b; b = d; d = t; }
+  msh_array_push( *tris, c->id[a] );
+  msh_array_push( *tris, c->id[b] );
+  msh_array_push( *tris, c->id[d] );
+}
+
+// Triangulates a y-monotone piece given counter-clockwise. 'sorted', 'chain' and 'stack' are
+// scratch space for m elements.
+static void
+msh__tri_monotone( const msh__tri_ctx_t* c, const int* face, int m, int* sorted, uint8_t* chain,
+                   int* stack, msh_array(int)* tris )
+{
+  int top = 0, bottom = 0;
+  for( int i = 1; i < m; ++i )
+  {
+    if( c->rank[face[i]] < c->rank[face[top]] )    { top = i; }
+    if( c->rank[face[i]] > c->rank[face[bottom]] ) { bottom = i; }
+  }
+
+  // Counter-clockwise from the top goes down the left chain, clockwise down the right one.
+  int li = ( top + 1 ) % m, ri = ( top + m - 1 ) % m, k = 0;
+  sorted[k] = face[top]; chain[k++] = 0;
+  while( li != bottom || ri != bottom )
+  {
+    int take_left = ri == bottom || ( li != bottom && c->rank[face[li]] < c->rank[face[ri]] );
+    if( take_left ) { sorted[k] = face[li]; chain[k++] = 0; li = ( li + 1 ) % m; }
+    else            { sorted[k] = face[ri]; chain[k++] = 1; ri = ( ri + m - 1 ) % m; }
+  }
+  sorted[k] = face[bottom]; chain[k++] = 0;
+
+  int sp = 0;
+  stack[sp++] = 0;
+  stack[sp++] = 1;
+  for( int j = 2; j < m - 1; ++j )
+  {
+    if( chain[j] != chain[stack[sp - 1]] )
+    {
+      for( int s = sp - 1; s > 0; --s ) { msh__tri_emit( c, sorted[j], sorted[stack[s]], sorted[stack[s - 1]], tris ); }
+      stack[0] = j - 1;
+      stack[1] = j;
+      sp = 2;
+    }
+    else
+    {
+      int last = stack[--sp];
+      while( sp > 0 )
+      {
+        int a = sorted[last], b = sorted[stack[sp - 1]], v = sorted[j];
+        double turn = chain[j] == 0 ? msh__tri_cross( c, b, a, v ) : msh__tri_cross( c, v, a, b );
+        if( turn <= 0.0 ) { break; }
+        msh__tri_emit( c, v, a, b, tris );
+        last = stack[--sp];
+      }
+      stack[sp++] = last;
+      stack[sp++] = j;
+    }
+  }
+  for( int s = sp - 1; s > 0; --s ) { msh__tri_emit( c, sorted[m - 1], sorted[stack[s]], sorted[stack[s - 1]], tris ); }
+}
+
+// Counter-clockwise order of directions from vertex o, starting at +x.
+static inline int
+msh__tri_angle_less( const msh__tri_ctx_t* c, int o, int a, int b )
+{
+  float ax = c->x[a] - c->x[o], ay = c->y[a] - c->y[o];
+  float bx = c->x[b] - c->x[o], by = c->y[b] - c->y[o];
+  int ha = ay < 0.0f || ( ay == 0.0f && ax < 0.0f );
+  int hb = by < 0.0f || ( by == 0.0f && bx < 0.0f );
+  if( ha != hb ) { return ha < hb; }
+  return msh__tri_cross( c, o, a, b ) > 0.0;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+// Triangulation
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+MSH_TRIANGULATE_DEF int
+msh_triangulate_polygon_holes( const float* vertices, const int* contour_counts, int n_contours,
+                               msh_array(int)* tris )
+{
+  int n_total = 0;
+  for( int i = 0; i < n_contours; ++i ) { n_total += contour_counts[i]; }
+  if( n_contours <= 0 || contour_counts[0] < 3 ) { return 0; }
+
+  // Sweep state, one block for all per-vertex arrays.
+  msh__tri_ctx_t c = {0};
+  size_t n_alloc = n_total;
+  char* block = MSH_TRIANGULATE_MALLOC( n_alloc * ( sizeof(msh__tri_node_t) + sizeof(uint64_t) + 2 * sizeof(float) +
+                                    sizeof(uint32_t) + 7 * sizeof(int) + sizeof(uint8_t) ) );
+  char* ptr = block;
+  c.nodes = (msh__tri_node_t*)ptr;  ptr += n_alloc * sizeof(msh__tri_node_t);
+  uint64_t* keys = (uint64_t*)ptr;  ptr += n_alloc * sizeof(uint64_t);
+  c.x = (float*)ptr;                ptr += n_alloc * sizeof(float);
+  c.y = (float*)ptr;                ptr += n_alloc * sizeof(float);
+  uint32_t* order = (uint32_t*)ptr; ptr += n_alloc * sizeof(uint32_t);
+  int** arrays[] = { &c.id, &c.prev, &c.next, &c.rank, &c.helper };
+  for( int i = 0; i < (int)msh_count_of( arrays ); ++i ) { *arrays[i] = (int*)ptr; ptr += n_alloc * sizeof(int); }
+  c.diags = (int*)ptr;              ptr += 2 * n_alloc * sizeof(int);
+  c.type = (uint8_t*)ptr;
+
+  // Compact contours, skipping repeated vertices, and orient them so that the interior is on
+  // the left: outer boundary counter-clockwise, holes clockwise. Vertices within a few ulps of
+  // the previous one count as repeated, as closing vertices computed from angles (e.g. at 0 and
+  // 360 degrees) rarely match exactly, and would form a tiny self intersection.
+  int n_holes = 0;
+  for( int k = 0, src = 0; k < n_contours; src += contour_counts[k++] )
+  {
+    int first = c.n;
+    float eps = 0.0f;
+    for( int i = 0; i < 2 * contour_counts[k]; ++i ) { eps = msh_max( eps, fabsf( vertices[2 * src + i] ) ); }
+    eps *= MSH_TRIANGULATE_EPS;
+    for( int i = 0; i < contour_counts[k]; ++i )
+    {
+      float vx = vertices[2 * ( src + i ) + 0], vy = vertices[2 * ( src + i ) + 1];
+      if( c.n > first && fabsf( vx - c.x[c.n - 1] ) <= eps && fabsf( vy - c.y[c.n - 1] ) <= eps ) { continue; }
+      c.x[c.n] = vx; c.y[c.n] = vy; c.id[c.n] = src + i;
+      c.n++;
+    }
+    while( c.n - first > 1 && fabsf( c.x[c.n - 1] - c.x[first] ) <= eps && fabsf( c.y[c.n - 1] - c.y[first] ) <= eps ) { c.n--; }
+    int count = c.n - first;
+    if( count < 3 )
+    {
+      c.n = first;
+      if( k == 0 ) { MSH_TRIANGULATE_FREE( block ); return 0; }
+      continue;
+    }
+    double area = 0.0;
+    for( int i = 0; i < count; ++i )
+    {
+      int a = first + i, b = first + ( i + 1 ) % count;
+      area += (double)c.x[a] * c.y[b] - (double)c.x[b] * c.y[a];
+    }
+    int reverse = ( k == 0 ) ? area < 0.0 : area > 0.0;
+    for( int i = 0; i < count; ++i )
+    {
+      int a = first + i, nb = first + ( i + 1 ) % count, pb = first + ( i + count - 1 ) % count;
+      c.next[a] = reverse ? pb : nb;
+      c.prev[a] = reverse ? nb : pb;
+    }
+    n_holes += k > 0;
+  }
+  int n = c.n;
+
+  // Sweep order: decreasing y, then increasing x.
+  for( int i = 0; i < n; ++i )
+  {
+    keys[i] = ( (uint64_t)~msh__tri_ordered_bits( c.y[i] ) << 32 ) | msh__tri_ordered_bits( c.x[i] );
+    order[i] = i;
+  }
+  msh_radix_sort_u64( keys, order, n );
+  for( int r = 0; r < n; ++r ) { c.rank[order[r]] = r; }
+
+  for( int v = 0; v < n; ++v )
+  {
+    int p = c.prev[v], q = c.next[v];
+    int convex = msh__tri_cross( &c, p, v, q ) > 0.0;
+    if( c.rank[p] > c.rank[v] && c.rank[q] > c.rank[v] )      { c.type[v] = convex ? MSH__TRI_START : MSH__TRI_SPLIT; }
+    else if( c.rank[p] < c.rank[v] && c.rank[q] < c.rank[v] ) { c.type[v] = convex ? MSH__TRI_END : MSH__TRI_MERGE; }
+    else                                                      { c.type[v] = MSH__TRI_REGULAR; }
+    uint32_t h = (uint32_t)v * 0x9E3779B1u;
+    c.nodes[v].prio = h ^ ( h >> 15 );
+  }
+
+  // Partition into monotone pieces with diagonals.
+  c.root = -1;
+  for( int r = 0; r < n; ++r )
+  {
+    int v = order[r], e_prev = c.prev[v], e_left;
+    switch( c.type[v] )
+    {
+      case MSH__TRI_START:
+        msh__tri_insert( &c, v );
+        c.helper[v] = v;
+        break;
+      case MSH__TRI_END:
+        msh__tri_connect_merge_helper( &c, v, e_prev );
+        msh__tri_remove( &c, e_prev );
+        break;
+      case MSH__TRI_SPLIT:
+        e_left = msh__tri_left_of( &c, v );
+        if( e_left >= 0 )
+        {
+          c.diags[2 * c.n_diags + 0] = v;
+          c.diags[2 * c.n_diags + 1] = c.helper[e_left];
+          c.n_diags++;
+          c.helper[e_left] = v;
+        }
+        msh__tri_insert( &c, v );
+        c.helper[v] = v;
+        break;
+      case MSH__TRI_MERGE:
+        msh__tri_connect_merge_helper( &c, v, e_prev );
+        msh__tri_remove( &c, e_prev );
+        e_left = msh__tri_left_of( &c, v );
+        msh__tri_connect_merge_helper( &c, v, e_left );
+        if( e_left >= 0 ) { c.helper[e_left] = v; }
+        break;
+      default:
+        if( c.rank[c.prev[v]] < c.rank[v] )
+        {
+          // Interior to the right, v is on the left boundary.
+          msh__tri_connect_merge_helper( &c, v, e_prev );
+          msh__tri_remove( &c, e_prev );
+          msh__tri_insert( &c, v );
+          c.helper[v] = v;
+        }
+        else
+        {
+          e_left = msh__tri_left_of( &c, v );
+          msh__tri_connect_merge_helper( &c, v, e_left );
+          if( e_left >= 0 ) { c.helper[e_left] = v; }
+        }
+        break;
+    }
+  }
+
+  // Half-edge adjacency: neighbors of each vertex sorted counter-clockwise. Half-edges are
+  // slots of this array. A face has at most n_slots vertices.
+  size_t n_slots = 2 * (size_t)n + 2 * (size_t)c.n_diags;
+  char* face_block = MSH_TRIANGULATE_MALLOC( n_slots * ( 4 * sizeof(int) + 2 * sizeof(uint8_t) ) + ( n + 1 ) * sizeof(int) );
+  int* adj = (int*)face_block;
+  int* face = adj + n_slots;
+  int* sorted = face + n_slots;
+  int* stack = sorted + n_slots;
+  int* offsets = stack + n_slots;
+  uint8_t* visited = (uint8_t*)( offsets + n + 1 );
+  uint8_t* chain = visited + n_slots;
+  int* fill = c.helper;   // free after the sweep
+
+  memset( visited, 0, n_slots );
+  memset( fill, 0, n * sizeof(int) );
+  for( int i = 0; i < 2 * c.n_diags; ++i ) { fill[c.diags[i]]++; }
+  offsets[0] = 0;
+  for( int v = 0; v < n; ++v ) { int d = fill[v] + 2; fill[v] = offsets[v]; offsets[v + 1] = offsets[v] + d; }
+  for( int v = 0; v < n; ++v ) { adj[fill[v]++] = c.next[v]; adj[fill[v]++] = c.prev[v]; }
+  for( int i = 0; i < c.n_diags; ++i )
+  {
+    int a = c.diags[2 * i], b = c.diags[2 * i + 1];
+    adj[fill[a]++] = b;
+    adj[fill[b]++] = a;
+  }
+  for( int v = 0; v < n; ++v )
+  {
+    for( int i = offsets[v] + 1; i < offsets[v + 1]; ++i )
+    {
+      int w = adj[i], j = i;
+      for( ; j > offsets[v] && msh__tri_angle_less( &c, v, w, adj[j - 1] ); --j ) { adj[j] = adj[j - 1]; }
+      adj[j] = w;
+    }
+  }
+
+  // Faces to the left of half-edges, except the reversed boundary, are the monotone pieces.
+  // Coming into w from u, the next half-edge is the first clockwise from w->u.
+  size_t len_before = msh_array_len( *tris );
+  msh_array_fit( *tris, len_before + 3 * (size_t)( n - 2 + 2 * n_holes ) );
+  for( int u = 0; u < n; ++u )
+  {
+    for( int s = offsets[u]; s < offsets[u + 1]; ++s )
+    {
+      if( visited[s] || adj[s] == c.prev[u] ) { continue; }
+      int m = 0, cur_u = u, cur = s;
+      while( !visited[cur] )
+      {
+        visited[cur] = 1;
+        face[m++] = cur_u;
+        int w = adj[cur], t = offsets[w];
+        while( adj[t] != cur_u ) { t++; }
+        cur = ( t == offsets[w] ) ? offsets[w + 1] - 1 : t - 1;
+        cur_u = w;
+      }
+      if( m >= 3 ) { msh__tri_monotone( &c, face, m, sorted, chain, stack, tris ); }
+    }
+  }
+
+  MSH_TRIANGULATE_FREE( face_block );
+  MSH_TRIANGULATE_FREE( block );
+  return (int)( ( msh_array_len( *tris ) - len_before ) / 3 );
+}
+
+MSH_TRIANGULATE_DEF int
+msh_triangulate_polygon( const float* vertices, int n_vertices, msh_array(int)* tris )
+{
+  return msh_triangulate_polygon_holes( vertices, &n_vertices, 1, tris );
+}
+
+#endif /* MSH_TRIANGULATE_IMPLEMENTATION */
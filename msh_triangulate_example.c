@@ -0,0 +1,479 @@
+/*
+  Author: Maciej Halber
+  Date : Oct 18, 2026
+  License: CC0
+
+  Compilation: gcc -std=c99 -O2 -I<path_to_msh_libraries> msh_triangulate_example.c -o msh_triangulate_example -lm
+  Usage:       msh_triangulate_example [--bench]
+  Description: This program showcases msh_triangulate.h, O(n log n) triangulation of polygons with
+               holes. It:
+
+               1) Validates triangulations of the star from deprecated/msh_draw_example.c, random
+               star shaped outlines, combs, a spiral, outlines with collinear vertices and
+               horizontal edges, and outlines with many holes, in both orientations. Each result
+               has to have the expected number of triangles, all counter-clockwise, with areas
+               summing up to the area of the polygon, and with every boundary edge used by one
+               triangle and every other edge by two triangles, in opposite directions.
+
+               2) Reports triangulation time against vertex count, from 1k to 1M vertices,
+               alongside ear clipping (as in msh_cutouts) up to the sizes where it is practical.
+
+               Program returns non-zero if validation fails. With --bench, triangulation time per
+               vertex is measured with msh_bench.h instead.
+*/
+
+#define MSH_STD_INCLUDE_HEADERS
+#define MSH_STD_IMPLEMENTATION
+#define MSH_SORT_IMPLEMENTATION
+#define MSH_TRIANGULATE_IMPLEMENTATION
+#define MSH_BENCH_IMPLEMENTATION
+#include "msh_std.h"
+#include "msh_sort.h"
+#include "msh_triangulate.h"
+#include "msh_bench.h"
+
+enum { N_RUNS = 3 };
+
+typedef struct polygon
+{
+  msh_array(float) xy;
+  msh_array(int) counts;
+} polygon_t;
+
+void polygon_free( polygon_t* p )
+{
+  msh_array_free( p->xy );
+  msh_array_free( p->counts );
+}
+
+// Adds a contour from n points; reversed if 'flip' is set.
+void add_contour( polygon_t* p, const float* pts, int n, int flip )
+{
+  for( int i = 0; i < n; ++i )
+  {
+    int j = flip ? n - 1 - i : i;
+    msh_array_push( p->xy, pts[2 * j + 0] );
+    msh_array_push( p->xy, pts[2 * j + 1] );
+  }
+  msh_array_push( p->counts, n );
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+// Shapes
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+// Star of deprecated/msh_draw_example.c, including the repeated first vertex at 360 degrees.
+void shape_draw_example_star( polygon_t* p )
+{
+  float pts[2 * 37];
+  float r = 128.0f;
+  int c = 0, n = 0;
+  for( float i = 0.0f; i <= 360.0f; i += 10.0f )
+  {
+    float theta = (float)msh_deg2rad( i );
+    pts[2 * n + 0] = 256.0f + r * sinf( theta );
+    pts[2 * n + 1] = 256.0f + r * cosf( theta );
+    n++;
+    r = ( c == 1 || c == 2 ) ? 128.0f : 100.0f;
+    c = ( c + 1 ) % 3;
+  }
+  add_contour( p, pts, n, 0 );
+}
+
+// Star shaped outline with a random radius per vertex; many reflex vertices.
+void shape_random_star( polygon_t* p, int n, float cx, float cy, float r, int flip, msh_rand_ctx_t* rand_gen )
+{
+  float* pts = malloc( 2 * n * sizeof(float) );
+  for( int i = 0; i < n; ++i )
+  {
+    float theta = (float)MSH_TWO_PI * i / n;
+    float ri = r * ( 0.3f + 0.7f * msh_rand_nextf( rand_gen ) );
+    pts[2 * i + 0] = cx + ri * cosf( theta );
+    pts[2 * i + 1] = cy + ri * sinf( theta );
+  }
+  add_contour( p, pts, n, flip );
+  free( pts );
+}
+
+// Teeth pointing up along the top and down along the bottom, so that half of the vertices are
+// split or merge vertices.
+void shape_comb( polygon_t* p, int n_teeth, int flip )
+{
+  float* pts = malloc( 8 * n_teeth * sizeof(float) );
+  int k = 0;
+  for( int i = 0; i < n_teeth; ++i )   // bottom, left to right
+  {
+    pts[k++] = 2.0f * i;        pts[k++] = -1.0f - ( i % 3 );
+    pts[k++] = 2.0f * i + 1.0f; pts[k++] = 0.0f;
+  }
+  for( int i = n_teeth - 1; i >= 0; --i )   // top, right to left
+  {
+    pts[k++] = 2.0f * i + 1.0f; pts[k++] = 2.0f + ( i % 5 );
+    pts[k++] = 2.0f * i;        pts[k++] = 1.0f;
+  }
+  add_contour( p, pts, k / 2, flip );
+  free( pts );
+}
+
+// Thick Archimedean spiral, hard for ear clipping as most ears are long and thin.
+void shape_spiral( polygon_t* p, int n, int flip )
+{
+  int half = n / 2;
+  float* pts = malloc( 2 * n * sizeof(float) );
+  for( int i = 0; i < half; ++i )
+  {
+    float t = 0.2f + 25.0f * i / half;
+    pts[2 * i + 0] = t * cosf( t );
+    pts[2 * i + 1] = t * sinf( t );
+    float u = 0.2f + 25.0f * ( half - 1 - i ) / half;
+    pts[2 * ( half + i ) + 0] = ( u + 2.0f ) * cosf( u );
+    pts[2 * ( half + i ) + 1] = ( u + 2.0f ) * sinf( u );
+  }
+  add_contour( p, pts, 2 * half, flip );
+  free( pts );
+}
+
+// Square with 'k' collinear vertices per side and a staircase cut into one corner, so that
+// many edges are horizontal or vertical.
+void shape_staircase( polygon_t* p, int k, int n_steps, int flip )
+{
+  msh_array(float) pts = NULL;
+  float size = (float)n_steps;
+  for( int i = 0; i < k; ++i ) { msh_array_push( pts, size * i / k ); msh_array_push( pts, 0.0f ); }
+  for( int i = 0; i < k; ++i ) { msh_array_push( pts, size ); msh_array_push( pts, size * i / k ); }
+  msh_array_push( pts, size ); msh_array_push( pts, size );
+  for( int i = 0; i < n_steps; ++i )
+  {
+    msh_array_push( pts, size - i - 0.25f ); msh_array_push( pts, size );
+    msh_array_push( pts, size - i - 0.25f ); msh_array_push( pts, size - 0.5f );
+    msh_array_push( pts, size - i - 0.75f ); msh_array_push( pts, size - 0.5f );
+    msh_array_push( pts, size - i - 0.75f ); msh_array_push( pts, size );
+  }
+  for( int i = 0; i < k; ++i ) { msh_array_push( pts, 0.0f ); msh_array_push( pts, size - size * i / k ); }
+  add_contour( p, pts, (int)msh_array_len( pts ) / 2, flip );
+  msh_array_free( pts );
+}
+
+// Square with a grid of holes, alternating squares, diamonds and small random stars, given in
+// alternating orientations.
+void shape_holes( polygon_t* p, int k, msh_rand_ctx_t* rand_gen )
+{
+  float s = 4.0f * k;
+  float outer[] = { 0.0f, 0.0f, s, 0.0f, s, s, 0.0f, s };
+  add_contour( p, outer, 4, 0 );
+  for( int j = 0; j < k; ++j )
+  {
+    for( int i = 0; i < k; ++i )
+    {
+      float cx = 4.0f * i + 2.0f, cy = 4.0f * j + 2.0f;
+      int flip = ( i + j ) & 1;
+      switch( ( i + 2 * j ) % 3 )
+      {
+        case 0: { float q[] = { cx - 1, cy - 1, cx + 1, cy - 1, cx + 1, cy + 1, cx - 1, cy + 1 }; add_contour( p, q, 4, flip ); } break;
+        case 1: { float q[] = { cx, cy - 1.5f, cx + 1.5f, cy, cx, cy + 1.5f, cx - 1.5f, cy }; add_contour( p, q, 4, flip ); } break;
+        default: shape_random_star( p, 12, cx, cy, 1.5f, flip, rand_gen ); break;
+      }
+    }
+  }
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+// Validation
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+double signed_area( const float* xy, int a, int b, int c )
+{
+  return 0.5 * ( ( (double)xy[2 * b] - xy[2 * a] ) * ( (double)xy[2 * c + 1] - xy[2 * a + 1] ) -
+                 ( (double)xy[2 * b + 1] - xy[2 * a + 1] ) * ( (double)xy[2 * c] - xy[2 * a] ) );
+}
+
+int contains_key( const uint64_t* keys, size_t n, uint64_t key )
+{
+  size_t lo = 0, hi = n;
+  while( lo < hi ) { size_t mid = ( lo + hi ) / 2; if( keys[mid] < key ) { lo = mid + 1; } else { hi = mid; } }
+  return lo < n && keys[lo] == key;
+}
+
+int validate( const char* name, const polygon_t* p )
+{
+  const float* xy = p->xy;
+  int n_contours = (int)msh_array_len( p->counts );
+  msh_array(int) tris = NULL;
+  msh_array_push( tris, -1 );   // triangles are appended after existing content
+  int n_tris = msh_triangulate_polygon_holes( xy, p->counts, n_contours, &tris );
+  const int* t = tris + 1;
+  int n_wrong = 0;
+
+  // Boundary edges, as unordered pairs, and the expected area and triangle count. Vertices
+  // repeating the previous one, or the first one at the end, are skipped as in the library.
+  msh_array(uint64_t) boundary = NULL;
+  msh_array(int) kept = NULL;
+  double area = 0.0;
+  int n_distinct = 0;
+  for( int k = 0, base = 0; k < n_contours; base += p->counts[k++] )
+  {
+    float eps = 0.0f;
+    for( int i = 0; i < 2 * p->counts[k]; ++i ) { eps = msh_max( eps, fabsf( xy[2 * base + i] ) * MSH_TRIANGULATE_EPS ); }
+    msh_array_clear( kept );
+    for( int i = 0; i < p->counts[k]; ++i )
+    {
+      int a = base + i, b = msh_array_len( kept ) ? kept[msh_array_len( kept ) - 1] : -1;
+      if( b >= 0 && fabsf( xy[2 * a] - xy[2 * b] ) <= eps && fabsf( xy[2 * a + 1] - xy[2 * b + 1] ) <= eps ) { continue; }
+      msh_array_push( kept, a );
+    }
+    int m = (int)msh_array_len( kept );
+    while( m > 1 && fabsf( xy[2 * kept[m - 1]] - xy[2 * kept[0]] ) <= eps &&
+           fabsf( xy[2 * kept[m - 1] + 1] - xy[2 * kept[0] + 1] ) <= eps ) { m--; }
+    double contour_area = 0.0;
+    for( int i = 0; i < m; ++i )
+    {
+      int a = kept[i], b = kept[( i + 1 ) % m];
+      contour_area += (double)xy[2 * a] * xy[2 * b + 1] - (double)xy[2 * b] * xy[2 * a + 1];
+      msh_array_push( boundary, ( (uint64_t)msh_min( a, b ) << 32 ) | (uint64_t)msh_max( a, b ) );
+    }
+    n_distinct += m;
+    area += ( k == 0 ? 0.5 : -0.5 ) * fabs( contour_area );
+  }
+  msh_array_free( kept );
+  int expected = n_distinct - 2 + 2 * ( n_contours - 1 );
+  n_wrong += n_tris != expected;
+
+  // Orientation and area.
+  double tri_area = 0.0;
+  int n_cw = 0;
+  for( int i = 0; i < n_tris; ++i )
+  {
+    double a = signed_area( xy, t[3 * i], t[3 * i + 1], t[3 * i + 2] );
+    n_cw += a < -1e-9 * fabs( area );
+    tri_area += a;
+  }
+  double area_err = fabs( tri_area - area ) / area;
+  n_wrong += n_cw + ( area_err > 1e-6 );
+
+  // Every directed edge once. Edges without a twin have to be on the boundary, and boundary
+  // edges can't have a twin.
+  size_t n_edges = 3 * (size_t)n_tris, n_boundary = msh_array_len( boundary );
+  uint64_t* edges = malloc( ( n_edges + 1 ) * sizeof(uint64_t) );
+  for( int i = 0; i < n_tris; ++i )
+  {
+    for( int j = 0; j < 3; ++j ) { edges[3 * i + j] = ( (uint64_t)t[3 * i + j] << 32 ) | (uint64_t)t[3 * i + ( j + 1 ) % 3]; }
+  }
+  msh_radix_sort_u64( edges, NULL, n_edges );
+  if( n_boundary ) { msh_radix_sort_u64( boundary, NULL, n_boundary ); }
+  int n_bad_edges = 0, n_boundary_used = 0;
+  for( size_t i = 0; i < n_edges; ++i )
+  {
+    uint32_t a = (uint32_t)( edges[i] >> 32 ), b = (uint32_t)edges[i];
+    if( i > 0 && edges[i] == edges[i - 1] ) { n_bad_edges++; continue; }
+    int has_twin = contains_key( edges, n_edges, ( (uint64_t)b << 32 ) | a );
+    int is_boundary = contains_key( boundary, n_boundary, ( (uint64_t)msh_min( a, b ) << 32 ) | msh_max( a, b ) );
+    n_bad_edges += has_twin == is_boundary;
+    n_boundary_used += is_boundary;
+  }
+  n_bad_edges += n_boundary_used != (int)n_boundary;
+  n_wrong += n_bad_edges;
+
+  if( n_wrong )
+  {
+    printf("  %-26s %d triangles (expected %d), %d clockwise, area error %g, %d bad edges FAILED\n",
+           name, n_tris, expected, n_cw, area_err, n_bad_edges );
+  }
+  free( edges );
+  msh_array_free( boundary );
+  msh_array_free( tris );
+  return n_wrong == 0;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+// Ear clipping
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+// O(n^2) ear clipping of a single contour, for comparison. Assumes counter-clockwise input.
+int ear_clip( const float* xy, int n, int* tris )
+{
+  int* prev = malloc( n * sizeof(int) );
+  int* next = malloc( n * sizeof(int) );
+  for( int i = 0; i < n; ++i ) { prev[i] = ( i + n - 1 ) % n; next[i] = ( i + 1 ) % n; }
+  int n_tris = 0, v = 0, remaining = n, since_clip = 0;
+  while( remaining > 3 && since_clip < remaining )
+  {
+    int a = prev[v], c = next[v];
+    int is_ear = signed_area( xy, a, v, c ) > 0.0;
+    for( int w = next[c]; is_ear && w != a; w = next[w] )
+    {
+      is_ear = !( signed_area( xy, a, v, w ) >= 0.0 && signed_area( xy, v, c, w ) >= 0.0 &&
+                  signed_area( xy, c, a, w ) >= 0.0 );
+    }
+    if( is_ear )
+    {
+      tris[3 * n_tris + 0] = a; tris[3 * n_tris + 1] = v; tris[3 * n_tris + 2] = c;
+      n_tris++;
+      next[a] = c; prev[c] = a;
+      remaining--;
+      since_clip = 0;
+      v = a;
+    }
+    else { v = c; since_clip++; }
+  }
+  if( remaining == 3 ) { tris[3 * n_tris + 0] = prev[v]; tris[3 * n_tris + 1] = v; tris[3 * n_tris + 2] = next[v]; n_tris++; }
+  free( prev );
+  free( next );
+  return n_tris;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+// Benchmarks, run with --bench
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+typedef struct bench_data
+{
+  polygon_t polygon;
+  msh_array(int) tris;
+} bench_data_t;
+
+void bench_triangulate( void* data, size_t n_iters )
+{
+  bench_data_t* d = data;
+  for( size_t it = 0; it < n_iters; ++it )
+  {
+    msh_array_clear( d->tris );
+    int n_tris = msh_triangulate_polygon_holes( d->polygon.xy, d->polygon.counts,
+                                                (int)msh_array_len( d->polygon.counts ), &d->tris );
+    MSH_BENCH_DO_NOT_OPTIMIZE( n_tris );
+  }
+}
+
+int run_benchmarks( int argc, char** argv )
+{
+  msh_rand_ctx_t rand_gen = {0};
+  msh_rand_init( &rand_gen, 12345ULL );
+  bench_data_t d[4];
+  memset( d, 0, sizeof(d) );
+  shape_random_star( &d[0].polygon, 10000, 0.0f, 0.0f, 100.0f, 0, &rand_gen );
+  shape_comb( &d[1].polygon, 2500, 0 );
+  shape_spiral( &d[2].polygon, 10000, 0 );
+  shape_holes( &d[3].polygon, 10, &rand_gen );
+  const char* names[4] = { "random star, 10k", "comb, 10k", "spiral, 10k", "100 holes" };
+
+  msh_bench_t* b = msh_bench_create( argc, argv );
+  for( int k = 0; k < 4; ++k )
+  {
+    msh_bench_add( b, names[k], bench_triangulate, &d[k], msh_array_len( d[k].polygon.xy ) / 2 );
+  }
+  int n_regressions = msh_bench_run( b );
+  msh_bench_destroy( b );
+  for( int k = 0; k < 4; ++k )
+  {
+    polygon_free( &d[k].polygon );
+    msh_array_free( d[k].tris );
+  }
+  return n_regressions ? 1 : 0;
+}
+
+int main( int argc, char** argv )
+{
+  if( msh_bench_requested( argc, argv ) ) { return run_benchmarks( argc, argv ); }
+  int n_failed = 0;
+  msh_rand_ctx_t rand_gen = {0};
+  msh_rand_init( &rand_gen, 12345ULL );
+
+  //----------------------------------------------------------------------------------------------
+  printf("Validation:\n");
+  {
+    int n_cases = 0, n_ok = 0;
+    polygon_t p = {0};
+    char name[64];
+
+    shape_draw_example_star( &p );
+    n_ok += validate( "msh_draw_example star", &p ); n_cases++;
+    polygon_free( &p );
+
+    for( int flip = 0; flip < 2; ++flip )
+    {
+      int sizes[] = { 3, 4, 5, 17, 100, 1000, 100000 };
+      for( int k = 0; k < (int)msh_count_of( sizes ); ++k )
+      {
+        shape_random_star( &p, sizes[k], 0.0f, 0.0f, 100.0f, flip, &rand_gen );
+        snprintf( name, sizeof(name), "random star %d%s", sizes[k], flip ? " cw" : "" );
+        n_ok += validate( name, &p ); n_cases++;
+        polygon_free( &p );
+      }
+
+      int teeth[] = { 1, 2, 10, 10000 };
+      for( int k = 0; k < (int)msh_count_of( teeth ); ++k )
+      {
+        shape_comb( &p, teeth[k], flip );
+        snprintf( name, sizeof(name), "comb %d%s", teeth[k], flip ? " cw" : "" );
+        n_ok += validate( name, &p ); n_cases++;
+        polygon_free( &p );
+      }
+
+      shape_spiral( &p, 2000, flip );
+      n_ok += validate( flip ? "spiral cw" : "spiral", &p ); n_cases++;
+      polygon_free( &p );
+
+      shape_staircase( &p, 7, 9, flip );
+      n_ok += validate( flip ? "staircase cw" : "staircase", &p ); n_cases++;
+      polygon_free( &p );
+    }
+
+    int grid[] = { 1, 3, 30 };
+    for( int k = 0; k < (int)msh_count_of( grid ); ++k )
+    {
+      shape_holes( &p, grid[k], &rand_gen );
+      snprintf( name, sizeof(name), "%d holes", grid[k] * grid[k] );
+      n_ok += validate( name, &p ); n_cases++;
+      polygon_free( &p );
+    }
+
+    n_failed += n_cases - n_ok;
+    printf("  %d/%d polygons triangulated correctly\n", n_ok, n_cases );
+  }
+
+  //----------------------------------------------------------------------------------------------
+  printf("Triangulation time in ms (best of %d runs):\n", N_RUNS );
+  {
+    printf("  %9s %14s %14s %14s %14s\n", "vertices", "random star", "ear clipping", "comb", "spiral" );
+    int sizes[] = { 1000, 10000, 100000, 1000000 };
+    msh_array(int) tris = NULL;
+    for( int k = 0; k < (int)msh_count_of( sizes ); ++k )
+    {
+      int n = sizes[k];
+      polygon_t shapes[3] = { {0} };
+      shape_random_star( &shapes[0], n, 0.0f, 0.0f, 100.0f, 0, &rand_gen );
+      shape_comb( &shapes[1], n / 4, 0 );
+      shape_spiral( &shapes[2], n, 0 );
+
+      double best[4] = { 1e30, 1e30, 1e30, 1e30 };
+      int run_ear_clip = n <= 10000;
+      int* ear_tris = run_ear_clip ? malloc( 3 * n * sizeof(int) ) : NULL;
+      for( int r = 0; r < N_RUNS; ++r )
+      {
+        for( int s = 0; s < 3; ++s )
+        {
+          msh_array_clear( tris );
+          uint64_t t1 = msh_time_now();
+          msh_triangulate_polygon( shapes[s].xy, shapes[s].counts[0], &tris );
+          uint64_t t2 = msh_time_now();
+          int slot = s == 0 ? 0 : s + 1;
+          best[slot] = msh_min( best[slot], msh_time_diff( MSHT_MILLISECONDS, t2, t1 ) );
+        }
+        if( run_ear_clip )
+        {
+          uint64_t t1 = msh_time_now();
+          ear_clip( shapes[0].xy, n, ear_tris );
+          uint64_t t2 = msh_time_now();
+          best[1] = msh_min( best[1], msh_time_diff( MSHT_MILLISECONDS, t2, t1 ) );
+        }
+      }
+      if( run_ear_clip ) { printf("  %9d %14.3f %14.3f %14.3f %14.3f\n", n, best[0], best[1], best[2], best[3] ); }
+      else               { printf("  %9d %14.3f %14s %14.3f %14.3f\n", n, best[0], "-", best[2], best[3] ); }
+      free( ear_tris );
+      for( int s = 0; s < 3; ++s ) { polygon_free( &shapes[s] ); }
+    }
+    msh_array_free( tris );
+  }
+
+  printf("%d failed\n", n_failed );
+  return n_failed ? 1 : 0;
+}
@@ -0,0 +1,430 @@
+/*
+  ==============================================================================
+
+  MSH_VEC_BATCH.H v0.1
+
+  A single header library with batched versions of the msh_vec_math.h transforms, for when
+  the same matrix is applied to many points, normals or other matrices:
+
+    - transforming points and normals by one matrix, in SoA and AoS layouts
+    - multiplying many matrices by a shared one, e.g. model matrices by a view-projection
+
+  To use the library you simply add:
+
+  #include "msh_vec_math.h"
+  #define MSH_VEC_BATCH_IMPLEMENTATION
+  #include "msh_vec_batch.h"
+
+  msh_vec_math.h needs to be included first, as it defines the vector and matrix types.
+
+  ==============================================================================
+  DOCUMENTATION
+
+  Layouts
+    SoA (structure of arrays) input keeps each coordinate in its own array:
+
+      msh_vec3_soa_t pts = { xs, ys, zs };
+
+    so that consecutive points fill the lanes of a vector register directly. These are the
+    fast paths, processing 8 points per iteration with AVX2 (-mavx2), or 4 with SSE2. AoS
+    (array of structures) input, i.e. an array of msh_vec3_t, is transposed in registers into
+    SoA four points at a time and back on output, so it costs a few shuffles more but needs
+    no temporary arrays. Both layouts allow 'out' to be the same as 'in'. Define
+    MSH_VEC_BATCH_NO_SIMD to use the scalar code paths.
+
+  Points
+    msh_mat4_transform_points_soa( &m, &in, &out, n );
+    msh_mat4_transform_points( &m, in_pts, out_pts, n );
+
+    Computes m * (p, 1) for each point, dropping the w coordinate, i.e. m is assumed to be
+    affine. For projections use:
+
+    msh_mat4_project_points_soa( &mvp, &in, &out, n );
+    msh_mat4_project_points( &mvp, in_pts, out_pts, n );
+
+    which divide by w, giving normalized device coordinates for a model-view-projection.
+
+  Normals
+    msh_mat4_transform_normals_soa( &m, &in, &out, n );
+    msh_mat4_transform_normals( &m, in_normals, out_normals, n );
+
+    Transforms normals by the inverse transpose of the upper 3x3 part of m, so that they stay
+    perpendicular to surfaces under non-uniform scaling, and normalizes the result. Inverse is
+    computed once per call.
+
+  Matrices
+    msh_mat4_mul_many( &view_projection, models, mvps, n );
+
+    Computes out[i] = a * b[i] for n matrices, e.g. model-view-projection matrices of many
+    instances. 'out' may be the same array as 'b'.
+
+  ==============================================================================
+  AUTHORS:
+    Maciej Halber
+
+  LICENSE:
+    CC0
+  ==============================================================================
+*/
+
+#ifndef MSH_VEC_BATCH_H
+#define MSH_VEC_BATCH_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#ifndef MSH_VEC_BATCH_DEF
+#ifdef MSH_VEC_BATCH_STATIC
+#define MSH_VEC_BATCH_DEF static
+#else
+#define MSH_VEC_BATCH_DEF extern
+#endif
+#endif
+
+typedef struct msh_vec3_soa
+{
+  float* x;
+  float* y;
+  float* z;
+} msh_vec3_soa_t;
+
+MSH_VEC_BATCH_DEF void msh_mat4_transform_points_soa( const msh_mat4_t* m, const msh_vec3_soa_t* in,
+                                                      msh_vec3_soa_t* out, size_t n );
+MSH_VEC_BATCH_DEF void msh_mat4_project_points_soa( const msh_mat4_t* m, const msh_vec3_soa_t* in,
+                                                    msh_vec3_soa_t* out, size_t n );
+MSH_VEC_BATCH_DEF void msh_mat4_transform_normals_soa( const msh_mat4_t* m, const msh_vec3_soa_t* in,
+                                                       msh_vec3_soa_t* out, size_t n );
+
+MSH_VEC_BATCH_DEF void msh_mat4_transform_points( const msh_mat4_t* m, const msh_vec3_t* in,
+                                                  msh_vec3_t* out, size_t n );
+MSH_VEC_BATCH_DEF void msh_mat4_project_points( const msh_mat4_t* m, const msh_vec3_t* in,
+                                                msh_vec3_t* out, size_t n );
+MSH_VEC_BATCH_DEF void msh_mat4_transform_normals( const msh_mat4_t* m, const msh_vec3_t* in,
+                                                   msh_vec3_t* out, size_t n );
+
+MSH_VEC_BATCH_DEF void msh_mat4_mul_many( const msh_mat4_t* a, const msh_mat4_t* b,
+                                          msh_mat4_t* out, size_t n );
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* MSH_VEC_BATCH_H */
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+// IMPLEMENTATION
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+#ifdef MSH_VEC_BATCH_IMPLEMENTATION
+
+#include <math.h>
+#include <stddef.h>
+
+#if !defined(MSH_VEC_BATCH_NO_SIMD) && (defined(__SSE2__) || defined(_M_X64))
+#define MSH__VB_SSE2 1
+#include <emmintrin.h>
+#if defined(__AVX2__)
+#define MSH__VB_AVX2 1
+#include <immintrin.h>
+#endif
+#endif
+
+// AoS paths reinterpret arrays of msh_vec3_t as packed floats.
+typedef char msh__vb_vec3_is_packed[sizeof(msh_vec3_t) == 3 * sizeof(float) ? 1 : -1];
+
+// Matrix coefficients in the order the kernels use them: rows of the 3x3 part, then the
+// translation, i.e. x' = r[0] * x + r[1] * y + r[2] * z + r[3], and likewise for y', z', w'.
+typedef struct msh__vb_rows
+{
+  float r[4][4];
+} msh__vb_rows_t;
+
+static msh__vb_rows_t
+msh__vb_rows( const msh_mat4_t* m )
+{
+  msh__vb_rows_t rows;
+  for( int i = 0; i < 4; ++i )
+  {
+    for( int j = 0; j < 4; ++j ) { rows.r[i][j] = m->data[j * 4 + i]; }
+  }
+  return rows;
+}
+
+// Rows of the inverse transpose of the upper 3x3 part, which is the cofactor matrix divided by
+// the determinant.
+static msh__vb_rows_t
+msh__vb_normal_rows( const msh_mat4_t* m )
+{
+  const float* d = m->data;
+  float a00 = d[0], a01 = d[4], a02 = d[8];
+  float a10 = d[1], a11 = d[5], a12 = d[9];
+  float a20 = d[2], a21 = d[6], a22 = d[10];
+  float c00 = a11 * a22 - a12 * a21, c01 = a12 * a20 - a10 * a22, c02 = a10 * a21 - a11 * a20;
+  float c10 = a02 * a21 - a01 * a22, c11 = a00 * a22 - a02 * a20, c12 = a01 * a20 - a00 * a21;
+  float c20 = a01 * a12 - a02 * a11, c21 = a02 * a10 - a00 * a12, c22 = a00 * a11 - a01 * a10;
+  float inv_det = 1.0f / ( a00 * c00 + a01 * c01 + a02 * c02 );
+  msh__vb_rows_t rows = { { { c00 * inv_det, c01 * inv_det, c02 * inv_det, 0.0f },
+                            { c10 * inv_det, c11 * inv_det, c12 * inv_det, 0.0f },
+                            { c20 * inv_det, c21 * inv_det, c22 * inv_det, 0.0f },
+                            { 0.0f, 0.0f, 0.0f, 1.0f } } };
+  return rows;
+}
+
+enum { MSH__VB_POINTS, MSH__VB_PROJECT, MSH__VB_NORMALS };
+
+static inline void
+msh__vb_transform1( const msh__vb_rows_t* m, int mode, float x, float y, float z,
+                    float* ox, float* oy, float* oz )
+{
+  float rx = m->r[0][0] * x + m->r[0][1] * y + m->r[0][2] * z + m->r[0][3];
+  float ry = m->r[1][0] * x + m->r[1][1] * y + m->r[1][2] * z + m->r[1][3];
+  float rz = m->r[2][0] * x + m->r[2][1] * y + m->r[2][2] * z + m->r[2][3];
+  float s = 1.0f;
+  if( mode == MSH__VB_PROJECT ) { s = 1.0f / ( m->r[3][0] * x + m->r[3][1] * y + m->r[3][2] * z + m->r[3][3] ); }
+  if( mode == MSH__VB_NORMALS ) { s = 1.0f / sqrtf( rx * rx + ry * ry + rz * rz ); }
+  *ox = rx * s;
+  *oy = ry * s;
+  *oz = rz * s;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+// Kernels
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+#if MSH__VB_SSE2
+static inline __m128
+msh__vb_row4( const float* r, __m128 x, __m128 y, __m128 z )
+{
+  return _mm_add_ps( _mm_add_ps( _mm_mul_ps( _mm_set1_ps( r[0] ), x ), _mm_mul_ps( _mm_set1_ps( r[1] ), y ) ),
+                     _mm_add_ps( _mm_mul_ps( _mm_set1_ps( r[2] ), z ), _mm_set1_ps( r[3] ) ) );
+}
+
+static inline void
+msh__vb_transform4( const msh__vb_rows_t* m, int mode, __m128* x, __m128* y, __m128* z )
+{
+  __m128 rx = msh__vb_row4( m->r[0], *x, *y, *z );
+  __m128 ry = msh__vb_row4( m->r[1], *x, *y, *z );
+  __m128 rz = msh__vb_row4( m->r[2], *x, *y, *z );
+  if( mode != MSH__VB_POINTS )
+  {
+    __m128 d = mode == MSH__VB_PROJECT
+             ? msh__vb_row4( m->r[3], *x, *y, *z )
+             : _mm_sqrt_ps( _mm_add_ps( _mm_add_ps( _mm_mul_ps( rx, rx ), _mm_mul_ps( ry, ry ) ), _mm_mul_ps( rz, rz ) ) );
+    __m128 s = _mm_div_ps( _mm_set1_ps( 1.0f ), d );
+    rx = _mm_mul_ps( rx, s );
+    ry = _mm_mul_ps( ry, s );
+    rz = _mm_mul_ps( rz, s );
+  }
+  *x = rx;
+  *y = ry;
+  *z = rz;
+}
+#endif
+
+#if MSH__VB_AVX2
+static inline __m256
+msh__vb_row8( const float* r, __m256 x, __m256 y, __m256 z )
+{
+  return _mm256_add_ps( _mm256_add_ps( _mm256_mul_ps( _mm256_set1_ps( r[0] ), x ), _mm256_mul_ps( _mm256_set1_ps( r[1] ), y ) ),
+                        _mm256_add_ps( _mm256_mul_ps( _mm256_set1_ps( r[2] ), z ), _mm256_set1_ps( r[3] ) ) );
+}
+#endif
+
+static void
+msh__vb_transform_soa( const msh__vb_rows_t* m, int mode, const msh_vec3_soa_t* in,
+                       msh_vec3_soa_t* out, size_t n )
+{
+  size_t i = 0;
+#if MSH__VB_AVX2
+  for( ; i + 8 <= n; i += 8 )
+  {
+    __m256 x = _mm256_loadu_ps( in->x + i ), y = _mm256_loadu_ps( in->y + i ), z = _mm256_loadu_ps( in->z + i );
+    __m256 rx = msh__vb_row8( m->r[0], x, y, z );
+    __m256 ry = msh__vb_row8( m->r[1], x, y, z );
+    __m256 rz = msh__vb_row8( m->r[2], x, y, z );
+    if( mode != MSH__VB_POINTS )
+    {
+      __m256 d = mode == MSH__VB_PROJECT
+               ? msh__vb_row8( m->r[3], x, y, z )
+               : _mm256_sqrt_ps( _mm256_add_ps( _mm256_add_ps( _mm256_mul_ps( rx, rx ), _mm256_mul_ps( ry, ry ) ), _mm256_mul_ps( rz, rz ) ) );
+      __m256 s = _mm256_div_ps( _mm256_set1_ps( 1.0f ), d );
+      rx = _mm256_mul_ps( rx, s );
+      ry = _mm256_mul_ps( ry, s );
+      rz = _mm256_mul_ps( rz, s );
+    }
+    _mm256_storeu_ps( out->x + i, rx );
+    _mm256_storeu_ps( out->y + i, ry );
+    _mm256_storeu_ps( out->z + i, rz );
+  }
+#elif MSH__VB_SSE2
+  for( ; i + 4 <= n; i += 4 )
+  {
+    __m128 x = _mm_loadu_ps( in->x + i ), y = _mm_loadu_ps( in->y + i ), z = _mm_loadu_ps( in->z + i );
+    msh__vb_transform4( m, mode, &x, &y, &z );
+    _mm_storeu_ps( out->x + i, x );
+    _mm_storeu_ps( out->y + i, y );
+    _mm_storeu_ps( out->z + i, z );
+  }
+#endif
+  for( ; i < n; ++i )
+  {
+    msh__vb_transform1( m, mode, in->x[i], in->y[i], in->z[i], &out->x[i], &out->y[i], &out->z[i] );
+  }
+}
+
+// Four packed points x0 y0 z0 x1 | y1 z1 x2 y2 | z2 x3 y3 z3 are transposed into x, y and z
+// registers with shuffles, and back after the transform.
+static void
+msh__vb_transform_aos( const msh__vb_rows_t* m, int mode, const msh_vec3_t* in, msh_vec3_t* out,
+                       size_t n )
+{
+  size_t i = 0;
+#if MSH__VB_SSE2
+  for( ; i + 4 <= n; i += 4 )
+  {
+    const float* src = (const float*)( in + i );
+    __m128 v0 = _mm_loadu_ps( src ), v1 = _mm_loadu_ps( src + 4 ), v2 = _mm_loadu_ps( src + 8 );
+    __m128 x01 = _mm_shuffle_ps( v0, v1, _MM_SHUFFLE( 3, 2, 3, 0 ) );   // x0 x1 x2 y2
+    __m128 x23 = _mm_shuffle_ps( x01, v2, _MM_SHUFFLE( 1, 1, 2, 2 ) );  // x2 x2 x3 x3
+    __m128 y01 = _mm_shuffle_ps( v0, v1, _MM_SHUFFLE( 3, 0, 1, 1 ) );   // y0 y0 y1 y2
+    __m128 y23 = _mm_shuffle_ps( y01, v2, _MM_SHUFFLE( 2, 2, 3, 2 ) );  // y1 y2 y3 y3
+    __m128 z01 = _mm_shuffle_ps( v0, v1, _MM_SHUFFLE( 1, 1, 2, 2 ) );   // z0 z0 z1 z1
+    __m128 z23 = _mm_shuffle_ps( v2, v2, _MM_SHUFFLE( 3, 0, 3, 0 ) );   // z2 z3 z2 z3
+    __m128 x = _mm_shuffle_ps( x01, x23, _MM_SHUFFLE( 2, 0, 1, 0 ) );
+    __m128 y = _mm_shuffle_ps( y01, y23, _MM_SHUFFLE( 2, 1, 2, 0 ) );
+    __m128 z = _mm_shuffle_ps( z01, z23, _MM_SHUFFLE( 1, 0, 2, 0 ) );
+
+    msh__vb_transform4( m, mode, &x, &y, &z );
+
+    float* dst = (float*)( out + i );
+    __m128 xy = _mm_unpacklo_ps( x, y );                                // x0 y0 x1 y1
+    __m128 zx = _mm_shuffle_ps( z, x, _MM_SHUFFLE( 1, 1, 0, 0 ) );      // z0 z0 x1 x1
+    __m128 yz = _mm_shuffle_ps( y, z, _MM_SHUFFLE( 1, 1, 1, 1 ) );      // y1 y1 z1 z1
+    __m128 xy2 = _mm_shuffle_ps( x, y, _MM_SHUFFLE( 2, 2, 2, 2 ) );     // x2 x2 y2 y2
+    __m128 zx3 = _mm_shuffle_ps( z, x, _MM_SHUFFLE( 3, 3, 2, 2 ) );     // z2 z2 x3 x3
+    __m128 yz3 = _mm_shuffle_ps( y, z, _MM_SHUFFLE( 3, 3, 3, 3 ) );     // y3 y3 z3 z3
+    _mm_storeu_ps( dst, _mm_shuffle_ps( xy, zx, _MM_SHUFFLE( 2, 0, 1, 0 ) ) );
+    _mm_storeu_ps( dst + 4, _mm_shuffle_ps( yz, xy2, _MM_SHUFFLE( 2, 0, 2, 0 ) ) );
+    _mm_storeu_ps( dst + 8, _mm_shuffle_ps( zx3, yz3, _MM_SHUFFLE( 2, 0, 2, 0 ) ) );
+  }
+#endif
+  for( ; i < n; ++i )
+  {
+    msh_vec3_t p = in[i];
+    msh__vb_transform1( m, mode, p.x, p.y, p.z, &out[i].x, &out[i].y, &out[i].z );
+  }
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+// Points and normals
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+MSH_VEC_BATCH_DEF void
+msh_mat4_transform_points_soa( const msh_mat4_t* m, const msh_vec3_soa_t* in, msh_vec3_soa_t* out,
+                               size_t n )
+{
+  msh__vb_rows_t rows = msh__vb_rows( m );
+  msh__vb_transform_soa( &rows, MSH__VB_POINTS, in, out, n );
+}
+
+MSH_VEC_BATCH_DEF void
+msh_mat4_project_points_soa( const msh_mat4_t* m, const msh_vec3_soa_t* in, msh_vec3_soa_t* out,
+                             size_t n )
+{
+  msh__vb_rows_t rows = msh__vb_rows( m );
+  msh__vb_transform_soa( &rows, MSH__VB_PROJECT, in, out, n );
+}
+
+MSH_VEC_BATCH_DEF void
+msh_mat4_transform_normals_soa( const msh_mat4_t* m, const msh_vec3_soa_t* in, msh_vec3_soa_t* out,
+                                size_t n )
+{
+  msh__vb_rows_t rows = msh__vb_normal_rows( m );
+  msh__vb_transform_soa( &rows, MSH__VB_NORMALS, in, out, n );
+}
+
+MSH_VEC_BATCH_DEF void
+msh_mat4_transform_points( const msh_mat4_t* m, const msh_vec3_t* in, msh_vec3_t* out, size_t n )
+{
+  msh__vb_rows_t rows = msh__vb_rows( m );
+  msh__vb_transform_aos( &rows, MSH__VB_POINTS, in, out, n );
+}
+
+MSH_VEC_BATCH_DEF void
+msh_mat4_project_points( const msh_mat4_t* m, const msh_vec3_t* in, msh_vec3_t* out, size_t n )
+{
+  msh__vb_rows_t rows = msh__vb_rows( m );
+  msh__vb_transform_aos( &rows, MSH__VB_PROJECT, in, out, n );
+}
+
+MSH_VEC_BATCH_DEF void
+msh_mat4_transform_normals( const msh_mat4_t* m, const msh_vec3_t* in, msh_vec3_t* out, size_t n )
+{
+  msh__vb_rows_t rows = msh__vb_normal_rows( m );
+  msh__vb_transform_aos( &rows, MSH__VB_NORMALS, in, out, n );
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+// Matrices
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+// Column j of a * b is the sum of columns of a weighted by column j of b. Columns of 'a' stay in
+// registers for the whole batch; with AVX2 two output columns are computed at once, broadcasting
+// coefficients of b within each 128 bit lane.
+MSH_VEC_BATCH_DEF void
+msh_mat4_mul_many( const msh_mat4_t* a, const msh_mat4_t* b, msh_mat4_t* out, size_t n )
+{
+  size_t i = 0;
+#if MSH__VB_AVX2
+  __m256 a0 = _mm256_broadcast_ps( (const __m128*)( a->data ) );
+  __m256 a1 = _mm256_broadcast_ps( (const __m128*)( a->data + 4 ) );
+  __m256 a2 = _mm256_broadcast_ps( (const __m128*)( a->data + 8 ) );
+  __m256 a3 = _mm256_broadcast_ps( (const __m128*)( a->data + 12 ) );
+  for( ; i < n; ++i )
+  {
+    __m256 b01 = _mm256_loadu_ps( b[i].data ), b23 = _mm256_loadu_ps( b[i].data + 8 );
+    __m256 c01 = _mm256_add_ps( _mm256_add_ps( _mm256_mul_ps( a0, _mm256_permute_ps( b01, 0x00 ) ),
+                                               _mm256_mul_ps( a1, _mm256_permute_ps( b01, 0x55 ) ) ),
+                                _mm256_add_ps( _mm256_mul_ps( a2, _mm256_permute_ps( b01, 0xAA ) ),
+                                               _mm256_mul_ps( a3, _mm256_permute_ps( b01, 0xFF ) ) ) );
+    __m256 c23 = _mm256_add_ps( _mm256_add_ps( _mm256_mul_ps( a0, _mm256_permute_ps( b23, 0x00 ) ),
+                                               _mm256_mul_ps( a1, _mm256_permute_ps( b23, 0x55 ) ) ),
+                                _mm256_add_ps( _mm256_mul_ps( a2, _mm256_permute_ps( b23, 0xAA ) ),
+                                               _mm256_mul_ps( a3, _mm256_permute_ps( b23, 0xFF ) ) ) );
+    _mm256_storeu_ps( out[i].data, c01 );
+    _mm256_storeu_ps( out[i].data + 8, c23 );
+  }
+#elif MSH__VB_SSE2
+  __m128 a0 = _mm_loadu_ps( a->data ), a1 = _mm_loadu_ps( a->data + 4 );
+  __m128 a2 = _mm_loadu_ps( a->data + 8 ), a3 = _mm_loadu_ps( a->data + 12 );
+  for( ; i < n; ++i )
+  {
+    __m128 c[4];
+    for( int j = 0; j < 4; ++j )
+    {
+      __m128 bj = _mm_loadu_ps( b[i].data + 4 * j );
+      c[j] = _mm_add_ps( _mm_add_ps( _mm_mul_ps( a0, _mm_shuffle_ps( bj, bj, 0x00 ) ),
+                                     _mm_mul_ps( a1, _mm_shuffle_ps( bj, bj, 0x55 ) ) ),
+                         _mm_add_ps( _mm_mul_ps( a2, _mm_shuffle_ps( bj, bj, 0xAA ) ),
+                                     _mm_mul_ps( a3, _mm_shuffle_ps( bj, bj, 0xFF ) ) ) );
+    }
+    for( int j = 0; j < 4; ++j ) { _mm_storeu_ps( out[i].data + 4 * j, c[j] ); }
+  }
+#endif
+  for( ; i < n; ++i )
+  {
+    msh_mat4_t c;
+    for( int j = 0; j < 4; ++j )
+    {
+      for( int r = 0; r < 4; ++r )
+      {
+        c.data[j * 4 + r] = a->data[r] * b[i].data[j * 4] + a->data[4 + r] * b[i].data[j * 4 + 1] +
+                            a->data[8 + r] * b[i].data[j * 4 + 2] + a->data[12 + r] * b[i].data[j * 4 + 3];
+      }
+    }
+    out[i] = c;
+  }
+}
+
+#endif /* MSH_VEC_BATCH_IMPLEMENTATION */
@@ -0,0 +1,392 @@
+/*
+  Author: Maciej Halber
+  Date : Oct 18, 2026
+  License: CC0
+
+  Compilation: gcc -std=c99 -O2 -mavx2 -I<path_to_msh_libraries> msh_vec_batch_example.c -o msh_vec_batch_example -lm
+  Usage:       msh_vec_batch_example [--bench]
+  Description: This program showcases msh_vec_batch.h, batched transforms for msh_vec_math.h types.
+               It:
+
+               1) Validates transforming points and normals, projecting points, and multiplying
+               matrices against per-element calls of msh_mat4_vec4_mul and msh_mat4_mul, for SoA
+               and AoS layouts, batch sizes that exercise the vector remainders, and in-place
+               operation.
+
+               2) Compares throughput of per-call transforms (as in deprecated/msh_cam_example.c,
+               which computes an mvp matrix per cube) with the batched AoS and SoA versions, for
+               a million points and normals, and for 121 and a million model matrices.
+
+               Program returns non-zero if validation fails. Compile without -mavx2 for the SSE2
+               paths, or with -DMSH_VEC_BATCH_NO_SIMD for the scalar ones. With --bench, the
+               transforms are measured with msh_bench.h instead.
+*/
+
+#define MSH_STD_INCLUDE_HEADERS
+#define MSH_STD_IMPLEMENTATION
+#define MSH_VEC_MATH_IMPLEMENTATION
+#define MSH_VEC_BATCH_IMPLEMENTATION
+#define MSH_BENCH_IMPLEMENTATION
+#include "msh_std.h"
+#include "msh_vec_math.h"
+#include "msh_vec_batch.h"
+#include "msh_bench.h"
+
+enum { N_POINTS = 1 << 20, N_RUNS = 5 };
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+// Per-call reference
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+msh_vec3_t transform_point( msh_mat4_t m, msh_vec3_t p, int project )
+{
+  msh_vec4_t r = msh_mat4_vec4_mul( m, msh_vec4( p.x, p.y, p.z, 1.0f ) );
+  if( project ) { return msh_vec3( r.x / r.w, r.y / r.w, r.z / r.w ); }
+  return msh_vec3( r.x, r.y, r.z );
+}
+
+// 'normal_matrix' is the inverse transpose of the model matrix, computed once by the caller.
+msh_vec3_t transform_normal( msh_mat4_t normal_matrix, msh_vec3_t n )
+{
+  msh_vec4_t r = msh_mat4_vec4_mul( normal_matrix, msh_vec4( n.x, n.y, n.z, 0.0f ) );
+  return msh_vec3_normalize( msh_vec3( r.x, r.y, r.z ) );
+}
+
+msh_mat4_t random_model( msh_rand_ctx_t* rand_gen )
+{
+  msh_mat4_t m = msh_translate( msh_mat4_identity(),
+                                msh_vec3( msh_rand_nextf( rand_gen ) * 20.0f - 10.0f,
+                                          msh_rand_nextf( rand_gen ) * 20.0f - 10.0f,
+                                          msh_rand_nextf( rand_gen ) * 20.0f - 10.0f ) );
+  m = msh_rotate( m, msh_rand_nextf( rand_gen ) * (float)MSH_TWO_PI,
+                  msh_vec3( msh_rand_nextf( rand_gen ) - 0.5f, msh_rand_nextf( rand_gen ) - 0.5f, 1.0f ) );
+  return msh_scale( m, msh_vec3( 0.5f + msh_rand_nextf( rand_gen ), 0.5f + msh_rand_nextf( rand_gen ),
+                                 0.5f + msh_rand_nextf( rand_gen ) ) );
+}
+
+double rel_error( msh_vec3_t a, msh_vec3_t b )
+{
+  msh_vec3_t d = msh_vec3_sub( a, b );
+  return msh_vec3_norm( d ) / msh_max( 1.0f, msh_vec3_norm( b ) );
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+// Validation
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+enum { POINTS, PROJECT, NORMALS };
+
+int validate( int op, size_t n, msh_rand_ctx_t* rand_gen )
+{
+  static const char* op_names[] = { "points", "project", "normals" };
+  msh_mat4_t model = random_model( rand_gen );
+  msh_mat4_t proj = msh_perspective( 0.75f, 1.5f, 0.1f, 100.0f );
+  msh_mat4_t view = msh_look_at( msh_vec3( 0.0f, 0.0f, 40.0f ), msh_vec3( 0.0f, 0.0f, 0.0f ), msh_vec3( 0.0f, 1.0f, 0.0f ) );
+  msh_mat4_t m = op == PROJECT ? msh_mat4_mul( msh_mat4_mul( proj, view ), model ) : model;
+  msh_mat4_t normal_matrix = msh_mat4_transpose( msh_mat4_inverse( model ) );
+
+  msh_vec3_t* in = calloc( n + 1, sizeof(msh_vec3_t) );
+  msh_vec3_t* aos = malloc( ( n + 1 ) * sizeof(msh_vec3_t) );
+  msh_vec3_t* ref = malloc( ( n + 1 ) * sizeof(msh_vec3_t) );
+  float* soa_data = malloc( 6 * ( n + 1 ) * sizeof(float) );
+  msh_vec3_soa_t soa_in = { soa_data, soa_data + n + 1, soa_data + 2 * ( n + 1 ) };
+  msh_vec3_soa_t soa_out = { soa_data + 3 * ( n + 1 ), soa_data + 4 * ( n + 1 ), soa_data + 5 * ( n + 1 ) };
+  for( size_t i = 0; i < n; ++i )
+  {
+    in[i] = msh_vec3( msh_rand_nextf( rand_gen ) * 10.0f - 5.0f, msh_rand_nextf( rand_gen ) * 10.0f - 5.0f,
+                      msh_rand_nextf( rand_gen ) * 10.0f - 5.0f );
+    if( op == NORMALS ) { in[i] = msh_vec3_normalize( in[i] ); }
+    soa_in.x[i] = in[i].x;
+    soa_in.y[i] = in[i].y;
+    soa_in.z[i] = in[i].z;
+    ref[i] = op == NORMALS ? transform_normal( normal_matrix, in[i] ) : transform_point( m, in[i], op == PROJECT );
+  }
+
+  if( op == POINTS )       { msh_mat4_transform_points( &m, in, aos, n );  msh_mat4_transform_points_soa( &m, &soa_in, &soa_out, n ); }
+  else if( op == PROJECT ) { msh_mat4_project_points( &m, in, aos, n );    msh_mat4_project_points_soa( &m, &soa_in, &soa_out, n ); }
+  else                     { msh_mat4_transform_normals( &m, in, aos, n ); msh_mat4_transform_normals_soa( &m, &soa_in, &soa_out, n ); }
+
+  double max_err = 0.0;
+  for( size_t i = 0; i < n; ++i )
+  {
+    max_err = msh_max( max_err, rel_error( aos[i], ref[i] ) );
+    max_err = msh_max( max_err, rel_error( msh_vec3( soa_out.x[i], soa_out.y[i], soa_out.z[i] ), ref[i] ) );
+  }
+
+  // In place.
+  if( op == POINTS )       { msh_mat4_transform_points( &m, in, in, n );  msh_mat4_transform_points_soa( &m, &soa_in, &soa_in, n ); }
+  else if( op == PROJECT ) { msh_mat4_project_points( &m, in, in, n );    msh_mat4_project_points_soa( &m, &soa_in, &soa_in, n ); }
+  else                     { msh_mat4_transform_normals( &m, in, in, n ); msh_mat4_transform_normals_soa( &m, &soa_in, &soa_in, n ); }
+  for( size_t i = 0; i < n; ++i )
+  {
+    max_err = msh_max( max_err, rel_error( in[i], ref[i] ) );
+    max_err = msh_max( max_err, rel_error( msh_vec3( soa_in.x[i], soa_in.y[i], soa_in.z[i] ), ref[i] ) );
+  }
+
+  int ok = max_err < 1e-5;
+  if( !ok ) { printf("  %-7s n = %5zu: max. relative error %g FAILED\n", op_names[op], n, max_err ); }
+  free( in );
+  free( aos );
+  free( ref );
+  free( soa_data );
+  return ok;
+}
+
+int validate_mul_many( size_t n, msh_rand_ctx_t* rand_gen )
+{
+  msh_mat4_t vp = msh_mat4_mul( msh_perspective( 0.75f, 1.5f, 0.1f, 100.0f ),
+                                msh_look_at( msh_vec3( 3.0f, 4.0f, 30.0f ), msh_vec3( 0.0f, 0.0f, 0.0f ), msh_vec3( 0.0f, 1.0f, 0.0f ) ) );
+  msh_mat4_t* models = calloc( n + 1, sizeof(msh_mat4_t) );
+  msh_mat4_t* mvps = malloc( ( n + 1 ) * sizeof(msh_mat4_t) );
+  double max_err = 0.0;
+  for( size_t i = 0; i < n; ++i ) { models[i] = random_model( rand_gen ); }
+  msh_mat4_mul_many( &vp, models, mvps, n );
+  for( size_t i = 0; i < n; ++i )
+  {
+    msh_mat4_t ref = msh_mat4_mul( vp, models[i] );
+    for( int j = 0; j < 16; ++j ) { max_err = msh_max( max_err, fabs( mvps[i].data[j] - ref.data[j] ) / msh_max( 1.0f, fabsf( ref.data[j] ) ) ); }
+  }
+  msh_mat4_mul_many( &vp, models, models, n );
+  for( size_t i = 0; i < n; ++i ) { max_err = msh_max( max_err, (double)memcmp( &models[i], &mvps[i], sizeof(msh_mat4_t) ) != 0 ); }
+  int ok = max_err < 1e-5;
+  if( !ok ) { printf("  mul_many n = %5zu: max. relative error %g FAILED\n", n, max_err ); }
+  free( models );
+  free( mvps );
+  return ok;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+// Benchmarks, run with --bench
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+#define N_BENCH_POINTS 65536
+
+typedef struct bench_data
+{
+  msh_mat4_t model;
+  msh_mat4_t vp;
+  msh_vec3_t* in;
+  msh_vec3_t* out;
+  msh_vec3_soa_t soa_in;
+  msh_vec3_soa_t soa_out;
+  msh_mat4_t* models;
+  msh_mat4_t* mvps;
+} bench_data_t;
+
+void bench_points_per_call( void* data, size_t n_iters )
+{
+  bench_data_t* d = data;
+  for( size_t it = 0; it < n_iters; ++it )
+  {
+    for( int i = 0; i < N_BENCH_POINTS; ++i ) { d->out[i] = transform_point( d->model, d->in[i], 0 ); }
+    MSH_BENCH_CLOBBER();
+  }
+}
+
+void bench_points_aos( void* data, size_t n_iters )
+{
+  bench_data_t* d = data;
+  for( size_t it = 0; it < n_iters; ++it )
+  {
+    msh_mat4_transform_points( &d->model, d->in, d->out, N_BENCH_POINTS );
+    MSH_BENCH_CLOBBER();
+  }
+}
+
+void bench_points_soa( void* data, size_t n_iters )
+{
+  bench_data_t* d = data;
+  for( size_t it = 0; it < n_iters; ++it )
+  {
+    msh_mat4_transform_points_soa( &d->model, &d->soa_in, &d->soa_out, N_BENCH_POINTS );
+    MSH_BENCH_CLOBBER();
+  }
+}
+
+void bench_project_aos( void* data, size_t n_iters )
+{
+  bench_data_t* d = data;
+  for( size_t it = 0; it < n_iters; ++it )
+  {
+    msh_mat4_project_points( &d->vp, d->in, d->out, N_BENCH_POINTS );
+    MSH_BENCH_CLOBBER();
+  }
+}
+
+void bench_normals_aos( void* data, size_t n_iters )
+{
+  bench_data_t* d = data;
+  for( size_t it = 0; it < n_iters; ++it )
+  {
+    msh_mat4_transform_normals( &d->model, d->in, d->out, N_BENCH_POINTS );
+    MSH_BENCH_CLOBBER();
+  }
+}
+
+void bench_mul_many( void* data, size_t n_iters )
+{
+  bench_data_t* d = data;
+  for( size_t it = 0; it < n_iters; ++it )
+  {
+    msh_mat4_mul_many( &d->vp, d->models, d->mvps, 121 );
+    MSH_BENCH_CLOBBER();
+  }
+}
+
+int run_benchmarks( int argc, char** argv )
+{
+  msh_rand_ctx_t rand_gen = {0};
+  msh_rand_init( &rand_gen, 12345ULL );
+  bench_data_t d;
+  d.model = random_model( &rand_gen );
+  d.vp = msh_mat4_mul( msh_perspective( 0.75f, 1.5f, 0.1f, 100.0f ),
+                       msh_look_at( msh_vec3( 0.0f, 0.0f, 5.0f ), msh_vec3( 0.0f, 0.0f, 0.0f ), msh_vec3( 0.0f, 1.0f, 0.0f ) ) );
+  d.in = malloc( N_BENCH_POINTS * sizeof(msh_vec3_t) );
+  d.out = malloc( N_BENCH_POINTS * sizeof(msh_vec3_t) );
+  float* soa_data = malloc( 6 * N_BENCH_POINTS * sizeof(float) );
+  d.soa_in = (msh_vec3_soa_t){ soa_data, soa_data + N_BENCH_POINTS, soa_data + 2 * N_BENCH_POINTS };
+  d.soa_out = (msh_vec3_soa_t){ soa_data + 3 * N_BENCH_POINTS, soa_data + 4 * N_BENCH_POINTS, soa_data + 5 * N_BENCH_POINTS };
+  for( int i = 0; i < N_BENCH_POINTS; ++i )
+  {
+    d.in[i] = msh_vec3( msh_rand_nextf( &rand_gen ) - 0.5f, msh_rand_nextf( &rand_gen ) - 0.5f, msh_rand_nextf( &rand_gen ) - 0.5f );
+    d.soa_in.x[i] = d.in[i].x;
+    d.soa_in.y[i] = d.in[i].y;
+    d.soa_in.z[i] = d.in[i].z;
+  }
+  d.models = malloc( 121 * sizeof(msh_mat4_t) );
+  d.mvps = malloc( 121 * sizeof(msh_mat4_t) );
+  for( int i = 0; i < 121; ++i ) { d.models[i] = random_model( &rand_gen ); }
+
+  msh_bench_t* b = msh_bench_create( argc, argv );
+  msh_bench_add( b, "points per-call, 64k", bench_points_per_call, &d, N_BENCH_POINTS );
+  msh_bench_add( b, "points AoS, 64k", bench_points_aos, &d, N_BENCH_POINTS );
+  msh_bench_add( b, "points SoA, 64k", bench_points_soa, &d, N_BENCH_POINTS );
+  msh_bench_add( b, "project AoS, 64k", bench_project_aos, &d, N_BENCH_POINTS );
+  msh_bench_add( b, "normals AoS, 64k", bench_normals_aos, &d, N_BENCH_POINTS );
+  msh_bench_add( b, "mat4 mul many, 121", bench_mul_many, &d, 121 );
+  int n_regressions = msh_bench_run( b );
+  msh_bench_destroy( b );
+  free( d.in );
+  free( d.out );
+  free( soa_data );
+  free( d.models );
+  free( d.mvps );
+  return n_regressions ? 1 : 0;
+}
+
+int main( int argc, char** argv )
+{
+  if( msh_bench_requested( argc, argv ) ) { return run_benchmarks( argc, argv ); }
+  int n_failed = 0;
+  msh_rand_ctx_t rand_gen = {0};
+  msh_rand_init( &rand_gen, 12345ULL );
+
+  //----------------------------------------------------------------------------------------------
+  printf("Validation against per-call msh_vec_math functions:\n");
+  {
+    size_t sizes[] = { 0, 1, 3, 4, 5, 8, 13, 1000 };
+    int n_cases = 0, n_ok = 0;
+    for( int s = 0; s < (int)msh_count_of( sizes ); ++s )
+    {
+      for( int op = POINTS; op <= NORMALS; ++op ) { n_ok += validate( op, sizes[s], &rand_gen ); n_cases++; }
+      n_ok += validate_mul_many( sizes[s], &rand_gen );
+      n_cases++;
+    }
+    n_failed += n_cases - n_ok;
+    printf("  %d/%d cases within tolerance\n", n_ok, n_cases );
+  }
+
+  //----------------------------------------------------------------------------------------------
+  printf("Throughput for %d elements in M elements/s (best of %d runs):\n", N_POINTS, N_RUNS );
+  {
+    msh_mat4_t model = random_model( &rand_gen );
+    msh_mat4_t normal_matrix = msh_mat4_transpose( msh_mat4_inverse( model ) );
+    msh_vec3_t* in = malloc( N_POINTS * sizeof(msh_vec3_t) );
+    msh_vec3_t* out = malloc( N_POINTS * sizeof(msh_vec3_t) );
+    float* soa_data = malloc( 6 * N_POINTS * sizeof(float) );
+    msh_vec3_soa_t soa_in = { soa_data, soa_data + N_POINTS, soa_data + 2 * N_POINTS };
+    msh_vec3_soa_t soa_out = { soa_data + 3 * N_POINTS, soa_data + 4 * N_POINTS, soa_data + 5 * N_POINTS };
+    for( int i = 0; i < N_POINTS; ++i )
+    {
+      in[i] = msh_vec3_normalize( msh_vec3( msh_rand_nextf( &rand_gen ) - 0.5f, msh_rand_nextf( &rand_gen ) - 0.5f,
+                                            msh_rand_nextf( &rand_gen ) - 0.5f ) );
+      soa_in.x[i] = in[i].x;
+      soa_in.y[i] = in[i].y;
+      soa_in.z[i] = in[i].z;
+    }
+    memset( out, 0, N_POINTS * sizeof(msh_vec3_t) );
+    memset( soa_out.x, 0, 3 * N_POINTS * sizeof(float) );
+
+    printf("  %-8s %10s %10s %10s\n", "", "per-call", "AoS", "SoA" );
+    for( int op = POINTS; op <= NORMALS; op += 2 )
+    {
+      double best[3] = { 1e30, 1e30, 1e30 };
+      for( int r = 0; r < N_RUNS; ++r )
+      {
+        uint64_t t1 = msh_time_now();
+        if( op == POINTS ) { for( int i = 0; i < N_POINTS; ++i ) { out[i] = transform_point( model, in[i], 0 ); } }
+        else               { for( int i = 0; i < N_POINTS; ++i ) { out[i] = transform_normal( normal_matrix, in[i] ); } }
+        uint64_t t2 = msh_time_now();
+        best[0] = msh_min( best[0], msh_time_diff( MSHT_MILLISECONDS, t2, t1 ) );
+
+        t1 = msh_time_now();
+        if( op == POINTS ) { msh_mat4_transform_points( &model, in, out, N_POINTS ); }
+        else               { msh_mat4_transform_normals( &model, in, out, N_POINTS ); }
+        t2 = msh_time_now();
+        best[1] = msh_min( best[1], msh_time_diff( MSHT_MILLISECONDS, t2, t1 ) );
+
+        t1 = msh_time_now();
+        if( op == POINTS ) { msh_mat4_transform_points_soa( &model, &soa_in, &soa_out, N_POINTS ); }
+        else               { msh_mat4_transform_normals_soa( &model, &soa_in, &soa_out, N_POINTS ); }
+        t2 = msh_time_now();
+        best[2] = msh_min( best[2], msh_time_diff( MSHT_MILLISECONDS, t2, t1 ) );
+      }
+      printf("  %-8s %10.1f %10.1f %10.1f\n", op == POINTS ? "points" : "normals",
+             N_POINTS / ( best[0] * 1e3 ), N_POINTS / ( best[1] * 1e3 ), N_POINTS / ( best[2] * 1e3 ) );
+    }
+    free( in );
+    free( out );
+    free( soa_data );
+
+    // Model-view-projection matrices, per instance as in msh_cam_example.c, and batched.
+    msh_mat4_t projection = msh_perspective( 0.75f, 1.5f, 0.1f, 100.0f );
+    msh_mat4_t view = msh_look_at( msh_vec3( 0.0f, 0.0f, 5.0f ), msh_vec3( 0.0f, 0.0f, 0.0f ), msh_vec3( 0.0f, 1.0f, 0.0f ) );
+    int n_instances[] = { 121, N_POINTS };
+    for( int k = 0; k < (int)msh_count_of( n_instances ); ++k )
+    {
+      int n = n_instances[k];
+      msh_mat4_t* models = malloc( n * sizeof(msh_mat4_t) );
+      msh_mat4_t* mvps = malloc( n * sizeof(msh_mat4_t) );
+      for( int i = 0; i < n; ++i ) { models[i] = random_model( &rand_gen ); }
+      memset( mvps, 0, n * sizeof(msh_mat4_t) );
+      double best[2] = { 1e30, 1e30 };
+      int n_reps = msh_max( 1, N_POINTS / n );
+      for( int r = 0; r < N_RUNS; ++r )
+      {
+        uint64_t t1 = msh_time_now();
+        for( int rep = 0; rep < n_reps; ++rep )
+        {
+          for( int i = 0; i < n; ++i ) { mvps[i] = msh_mat4_mul( msh_mat4_mul( projection, view ), models[i] ); }
+        }
+        uint64_t t2 = msh_time_now();
+        best[0] = msh_min( best[0], msh_time_diff( MSHT_MILLISECONDS, t2, t1 ) );
+        t1 = msh_time_now();
+        for( int rep = 0; rep < n_reps; ++rep )
+        {
+          msh_mat4_t vp = msh_mat4_mul( projection, view );
+          msh_mat4_mul_many( &vp, models, mvps, n );
+        }
+        t2 = msh_time_now();
+        best[1] = msh_min( best[1], msh_time_diff( MSHT_MILLISECONDS, t2, t1 ) );
+      }
+      double n_total = (double)n * n_reps;
+      printf("  mvp for %7d instances: per-call %8.1f, msh_mat4_mul_many %8.1f (%4.1fx)\n", n,
+             n_total / ( best[0] * 1e3 ), n_total / ( best[1] * 1e3 ), best[0] / best[1] );
+      free( models );
+      free( mvps );
+    }
+  }
+
+  printf("%d failed\n", n_failed );
+  return n_failed ? 1 : 0;
+}